@@ -68,23 +68,22 @@ SEXP XGDMatrixCreateFromMat_R(SEXP mat,
   SEXP dim = getAttrib(mat, R_DimSymbol);
   size_t nrow = static_cast<size_t>(INTEGER(dim)[0]);
   size_t ncol = static_cast<size_t>(INTEGER(dim)[1]);
-  const bool is_int = TYPEOF(mat) == INTSXP;
-  double *din;
-  int *iin;
-  if (is_int) {
-    iin = INTEGER(mat);
-  } else {
-    din = REAL(mat);
-  }
-  std::vector<float> data(nrow * ncol);
-  #pragma omp parallel for schedule(static)
-  for (omp_ulong i = 0; i < nrow; ++i) {
-    for (size_t j = 0; j < ncol; ++j) {
-      data[i * ncol +j] = is_int ? static_cast<float>(iin[i + nrow * j]) : din[i + nrow * j];
+  DMatrixHandle handle;
+  if (TYPEOF(mat) == INTSXP) {
+    const int *iin = INTEGER(mat);
+    std::vector<float> data(nrow * ncol);
+    #pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < nrow; ++i) {
+      for (size_t j = 0; j < ncol; ++j) {
+        data[i * ncol +j] = static_cast<float>(iin[i + nrow * j]);
+      }
     }
+    CHECK_CALL(XGDMatrixCreateFromMat(BeginPtr(data), nrow, ncol, asReal(missing), &handle));
+  } else {
+    // numeric matrices are read in place, column major
+    CHECK_CALL(XGDMatrixCreateFromMatColMajor(REAL(mat), nrow, ncol, asReal(missing),
+                                              &handle, 0));
   }
-  DMatrixHandle handle;
-  CHECK_CALL(XGDMatrixCreateFromMat(BeginPtr(data), nrow, ncol, asReal(missing), &handle));
   ret = PROTECT(R_MakeExternalPtr(handle, R_NilValue, R_NilValue));
   R_RegisterCFinalizerEx(ret, _DMatrixFinalizer, TRUE);
   R_API_END();
@@ -311,8 +310,11 @@ SEXP XGBoosterPredict_R(SEXP handle, SEXP dmat, SEXP option_mask, SEXP ntree_lim
                             asInteger(ntree_limit),
                             &olen, &res));
   ret = PROTECT(allocVector(REALSXP, olen));
-  for (size_t i = 0; i < olen; ++i) {
-    REAL(ret)[i] = res[i];
+  // the only copy is the widening of the prediction buffer into the R vector
+  double *out = REAL(ret);
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < olen; ++i) {
+    out[i] = res[i];
   }
   R_API_END();
   UNPROTECT(1);
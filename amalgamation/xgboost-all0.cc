@@ -14,6 +14,7 @@
 #include "../src/metric/elementwise_metric.cc"
 #include "../src/metric/multiclass_metric.cc"
 #include "../src/metric/rank_metric.cc"
+#include "../src/metric/robust_metric.cc"
 
 // objectives
 #include "../src/objective/objective.cc"
@@ -26,10 +27,13 @@
 #include "../src/gbm/gbm.cc"
 #include "../src/gbm/gbtree.cc"
 #include "../src/gbm/gblinear.cc"
+#include "../src/gbm/model_compactor.cc"
+#include "../src/gbm/model_compiler.cc"
 
 // data
 #include "../src/data/data.cc"
 #include "../src/data/simple_csr_source.cc"
+#include "../src/data/mapped_csr_source.cc"
 #include "../src/data/simple_dmatrix.cc"
 #include "../src/data/sparse_page_raw_format.cc"
 
@@ -49,6 +53,7 @@
 #include "../src/tree/tree_updater.cc"
 #include "../src/tree/updater_colmaker.cc"
 #include "../src/tree/updater_robust_colmaker.cc"
+#include "../src/tree/updater_vector_colmaker.cc"
 #include "../src/tree/updater_fast_hist.cc"
 #include "../src/tree/updater_prune.cc"
 #include "../src/tree/updater_refresh.cc"
@@ -56,6 +61,11 @@
 #include "../src/tree/updater_histmaker.cc"
 #include "../src/tree/updater_skmaker.cc"
 
+// robustness
+#include "../src/robust/robust_attack.cc"
+#include "../src/robust/robust_milp.cc"
+#include "../src/robust/robust_verifier.cc"
+
 // linear
 #include "../src/linear/linear_updater.cc"
 #include "../src/linear/updater_coordinate.cc"
@@ -67,6 +77,8 @@
 #include "../src/common/common.cc"
 #include "../src/common/host_device_vector.cc"
 #include "../src/common/hist_util.cc"
+#include "../src/common/memory_tracker.cc"
+#include "../src/common/threading.cc"
 
 // c_api
 #include "../src/c_api/c_api.cc"
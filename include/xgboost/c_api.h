@@ -33,6 +33,14 @@ typedef uint64_t bst_ulong;  // NOLINT(*)
 typedef void *DMatrixHandle;  // NOLINT(*)
 /*! \brief handle to Booster */
 typedef void *BoosterHandle;  // NOLINT(*)
+/*! \brief handle to a read only snapshot of a Booster for prediction */
+typedef void *PredictorHandle;  // NOLINT(*)
+/*! \brief handle to a registry of models served by id */
+typedef void *RegistryHandle;  // NOLINT(*)
+/*! \brief handle to a batcher of single row predictions */
+typedef void *BatcherHandle;  // NOLINT(*)
+/*! \brief handle to a quantized tree model */
+typedef void *QuantizedModelHandle;  // NOLINT(*)
 /*! \brief handle to a data iterator */
 typedef void *DataIterHandle;  // NOLINT(*)
 /*! \brief handle to a internal data holder. */
@@ -84,6 +92,19 @@ XGB_EXTERN_C typedef int XGBCallbackDataIterNext(  // NOLINT(*)
     DataIterHandle data_handle, XGBCallbackSetData *set_function,
     DataHolderHandle set_function_handle);
 
+/*!
+ * \brief The callback of XGBoosterTrain after each round.
+ * \param handle The handle given to XGBoosterTrain.
+ * \param iter The round trained.
+ * \param names Name of each value, <evname>-<metric> as in XGBoosterEvalOneIter.
+ * \param values Metric j of evaluation set i, at i * number of metrics + j.
+ * \param len Number of values, 0 without evaluation sets.
+ * \return 0 to go on training, nonzero to stop after this round.
+ */
+XGB_EXTERN_C typedef int XGBCallbackTrainRound(  // NOLINT(*)
+    void *handle, int iter, const char **names, const float *values,
+    bst_ulong len);
+
 /*!
  * \brief get string message of the last error
  *
@@ -105,6 +126,57 @@ XGB_DLL const char *XGBGetLastError(void);
  */
 XGB_DLL int XGBRegisterLogCallback(void (*callback)(const char*));
 
+/*!
+ * \brief cap the OpenMP threads of the parallel regions of every training,
+ *  evaluation and prediction call, whichever thread makes it, e.g. to the
+ *  cores a host application leaves to the library. The nthread of a booster
+ *  applies to the calling thread only during its calls, within this limit.
+ *  The limit starts as the environment variable XGBOOST_MAX_THREADS.
+ * \param nthread the most threads of a region, 0 for no limit
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBSetThreadLimit(int nthread);
+
+/*!
+ * \brief set where the parallel loops of the library run: "omp", the
+ *  default, for OpenMP regions of the calling thread, or "pool" for a
+ *  persistent pool of the library, whose loops balance by work stealing.
+ *  A loop uses as many threads as an OpenMP region would, see
+ *  XGBSetThreadLimit. The backend starts as the environment variable
+ *  XGBOOST_THREAD_BACKEND.
+ * \param name the backend, or "executor" once an executor is set
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBSetThreadBackend(const char* name);
+
+/*!
+ * \brief run the parallel loops of the library as tasks of an executor of
+ *  the host application. A loop submits a task per thread it may use beside
+ *  the calling thread, which takes part in the loop and finishes it even if
+ *  no task starts, so the executor may queue the tasks behind the caller.
+ *  A task that starts after its loop is done returns at once.
+ * \param submit runs task(arg) once on a thread of the host, it is passed
+ *  ctx as its last argument, NULL to go back to OpenMP
+ * \param ctx the executor of the host
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBSetExecutor(void (*submit)(void (*task)(void*), void* arg, void* ctx),
+                           void* ctx);
+
+/*!
+ * \brief get the bytes held by the major containers of the process as JSON:
+ *  the current and peak bytes of the data pages ("sparse_page"), the
+ *  quantized matrices of hist ("gradient_index"), the histograms
+ *  ("histogram"), the host side of the vectors of predictions, caches and
+ *  gradients ("host_device_vector") and the tree builder workspaces
+ *  ("workspace"), their total, and the resident set size ("rss") of the process
+ * \param reset_peak whether the peaks start over from the current bytes
+ *  after they are read
+ * \param out_json the JSON, valid until the next call in the thread
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBGetMemoryUsage(int reset_peak, const char** out_json);
+
 /*!
  * \brief load a data matrix
  * \param fname the name of the file
@@ -165,6 +237,28 @@ XGB_DLL int XGDMatrixCreateFromCSR(const bst_ulong *indptr,
                                    bst_ulong nindptr,
                                    bst_ulong nelem,
                                    DMatrixHandle *out);
+/*!
+ * \brief append rows in CSR format to a matrix created from in-memory rows.
+ *  The sorted columns it built take the rows by a merge, and the histogram
+ *  indices of the hist updaters that trained on it take them with its cuts.
+ * \param handle the matrix
+ * \param indptr pointer to row headers
+ * \param indices findex
+ * \param data fvalue, NaN are skipped
+ * \param nindptr number of appended rows + 1
+ * \param nelem number of nonzero elements of the appended rows
+ * \param label labels of the rows, must be given iff the matrix has labels
+ * \param weight weights of the rows, must be given iff the matrix has weights
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixAppendCSR(DMatrixHandle handle,
+                               const size_t* indptr,
+                               const unsigned* indices,
+                               const float* data,
+                               size_t nindptr,
+                               size_t nelem,
+                               const float* label,
+                               const float* weight);
 /*!
  * \brief create a matrix content from CSC format
  * \param col_ptr pointer to col headers
@@ -183,6 +277,26 @@ XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
                                      size_t nelem,
                                      size_t num_row,
                                      DMatrixHandle* out);
+/*!
+ * \brief create a matrix content from CSC format of 64 bit row indices, for
+ *  2^32 rows or more. Such a matrix trains with the exact and hist tree
+ *  methods, whose columns then hold 64 bit row ids.
+ * \param col_ptr pointer to col headers
+ * \param indices row index of each element
+ * \param data fvalue
+ * \param nindptr number of columns in the matrix + 1
+ * \param nelem number of nonzero elements in the matrix
+ * \param num_row number of rows; when it's set to 0, then guess from data
+ * \param out created dmatrix
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromCSCEx64(const size_t* col_ptr,
+                                       const uint64_t* indices,
+                                       const float* data,
+                                       size_t nindptr,
+                                       size_t nelem,
+                                       size_t num_row,
+                                       DMatrixHandle* out);
 /*!
  * \deprecated
  * \brief create a matrix content from CSC format
@@ -228,6 +342,24 @@ XGB_DLL int XGDMatrixCreateFromMat_omp(const float *data,  // NOLINT
                                        bst_ulong nrow, bst_ulong ncol,
                                        float missing, DMatrixHandle *out,
                                        int nthread);
+/*!
+ * \brief create matrix content from a column major dense matrix of doubles,
+ *  the layout of R and Fortran. The values are read in place, in blocks of
+ *  rows, and rounded to float as XGDMatrixCreateFromMat would.
+ * \param data pointer to the data space, column j starts at data + j * nrow
+ * \param nrow number of rows
+ * \param ncol number columns
+ * \param missing which value to represent missing value
+ * \param out created dmatrix
+ * \param nthread number of threads, if <=0 the current number of openmp threads
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixCreateFromMatColMajor(const double *data,
+                                           bst_ulong nrow,
+                                           bst_ulong ncol,
+                                           double missing,
+                                           DMatrixHandle *out,
+                                           int nthread);
 /*!
  * \brief create matrix content from python data table
  * \param data pointer to pointer to column data
@@ -256,6 +388,21 @@ XGB_DLL int XGDMatrixSliceDMatrix(DMatrixHandle handle,
                                   const int *idxset,
                                   bst_ulong len,
                                   DMatrixHandle *out);
+/*!
+ * \brief create a new dmatrix where the rows with the same entries, label,
+ *  root index and base margin are merged into their first row, whose weight
+ *  is the sum of their weights. With an objective of independent rows the
+ *  gradient sums of the nodes stay the same, so the exact updaters grow the
+ *  same trees from fewer entries. Evaluate on the original matrix, the rows
+ *  of the new one are not those of the data.
+ * \param handle instance of data matrix, without groups
+ * \param out the new matrix
+ * \param out_num_merged number of rows merged into others, if not NULL
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGDMatrixMergeDuplicateRows(DMatrixHandle handle,
+                                        DMatrixHandle *out,
+                                        bst_ulong *out_num_merged);
 /*!
  * \brief free space in data matrix
  * \return 0 when success, -1 when failure happens
@@ -414,6 +561,81 @@ XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
                                  const char *evnames[],
                                  bst_ulong len,
                                  const char **out_result);
+/*!
+ * \brief train rounds [begin_iteration, num_round) in a loop of the library,
+ *  which evaluates the metrics as numbers and stops early by itself. It does
+ *  what XGBoosterUpdateOneIter and XGBoosterEvalOneIter do each round.
+ * \param handle handle
+ * \param dtrain training data
+ * \param begin_iteration first round
+ * \param num_round end of the rounds
+ * \param dmats data to be evaluated after each round
+ * \param evnames names of each data
+ * \param len length of dmats, may be 0
+ * \param early_stopping_rounds stop when the last metric on the last of dmats
+ *          did not improve for this many rounds, 0 to train all rounds. The
+ *          best value and its round are kept in the attributes best_score
+ *          and best_iteration, where a resumed training also finds them.
+ * \param maximize whether the metric of early stopping is maximized; auc,
+ *          map and ndcg always are
+ * \param checkpoint_interval save a rabit checkpoint every this many rounds,
+ *          with the margins of dtrain in distributed training, 0 for none.
+ *          The booster then first resumes from the last checkpoint, the
+ *          rounds before it are skipped.
+ * \param callback called after each round with the metrics, can be NULL
+ * \param callback_handle handle given to callback
+ * \param out_num_round the end of the rounds trained, less than num_round
+ *          when training stopped early
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterTrain(BoosterHandle handle,
+                           DMatrixHandle dtrain,
+                           int begin_iteration,
+                           int num_round,
+                           DMatrixHandle dmats[],
+                           const char *evnames[],
+                           bst_ulong len,
+                           int early_stopping_rounds,
+                           int maximize,
+                           int checkpoint_interval,
+                           XGBCallbackTrainRound *callback,
+                           void *callback_handle,
+                           int *out_num_round);
+/*!
+ * \brief train a booster for each of several configurations at once, e.g. a
+ *  sweep over robust_eps or max_depth. The columns of dtrain are sorted once
+ *  and all boosters scan the same pages, through views of their own. At most
+ *  max_concurrent boosters are trained at a time, with an equal share of the
+ *  threads each. dtrain and deval must be in-memory matrices of one page.
+ * \param dtrain training data
+ * \param deval data of the early stopping metric, NULL to use dtrain
+ * \param keys names of the parameters of all configurations
+ * \param values values of the parameters of all configurations
+ * \param config_ptr the parameters of configuration i are
+ *          [config_ptr[i], config_ptr[i + 1]), nconfig + 1 offsets
+ * \param nconfig number of configurations
+ * \param num_round most boosting rounds of each configuration
+ * \param early_stopping_rounds stop a configuration whose first metric on deval
+ *          did not improve for this many rounds, 0 to train all rounds
+ * \param max_concurrent most boosters trained at once, 0 for one per thread
+ * \param out_boosters nconfig handles of the trained boosters, with dtrain
+ *          cached, freed by XGBoosterFree. All rounds are kept.
+ * \param out_best_score best value of the first metric of each configuration
+ * \param out_best_iteration round of the best value of each configuration
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterSweep(DMatrixHandle dtrain,
+                           DMatrixHandle deval,
+                           const char **keys,
+                           const char **values,
+                           const bst_ulong *config_ptr,
+                           bst_ulong nconfig,
+                           int num_round,
+                           int early_stopping_rounds,
+                           int max_concurrent,
+                           BoosterHandle *out_boosters,
+                           float *out_best_score,
+                           int *out_best_iteration);
 /*!
  * \brief make prediction based on dmat
  * \param handle handle
@@ -436,6 +658,623 @@ XGB_DLL int XGBoosterPredict(BoosterHandle handle,
                              bst_ulong *out_len,
                              const float **out_result);
 
+/*!
+ * \brief predict the leaf of each tree for each row of dmat as integers,
+ *  straight into a caller buffer instead of the floats of pred_leaf. Only
+ *  booster=gbtree is supported.
+ * \param handle handle
+ * \param dmat data matrix
+ * \param ntree_limit limit number of rounds of trees, 0 uses all the trees
+ * \param one_hot 0 writes the node ids of the leaves; 1 writes the columns of a
+ *          one-hot encoding of the leaves of all the trees, i.e. the indices of
+ *          a CSR matrix whose row i is entries [i * ntree, (i + 1) * ntree)
+ * \param out_index_size used to store the bytes of an index, 2 for uint16_t
+ *          when every index is below 65536 and 4 for uint32_t otherwise
+ * \param out_num_index used to store the number of indices: the largest node
+ *          count of a tree, or the number of one-hot columns
+ * \param out_size number of indices the caller allocated at out_result
+ * \param out_result caller buffer of nrow * ntree indices of out_index_size
+ *          bytes, row major, a null pointer only queries the sizes
+ * \param out_len used to store the number of indices, nrow * ntree
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictLeafIndex(BoosterHandle handle,
+                                      DMatrixHandle dmat,
+                                      unsigned ntree_limit,
+                                      int one_hot,
+                                      int *out_index_size,
+                                      bst_ulong *out_num_index,
+                                      bst_ulong out_size,
+                                      void *out_result,
+                                      bst_ulong *out_len);
+
+/*!
+ * \brief make prediction based on dmat after every stride rounds of trees,
+ *  as XGBoosterPredict with ntree_limit = stride, 2 * stride, ... would, in
+ *  one walk of each row through the trees. The last stage holds all the
+ *  rounds of ntree_limit even when they are not a multiple of stride.
+ *  Only booster=gbtree is supported.
+ * \param handle handle
+ * \param dmat data matrix
+ * \param option_mask bit-mask of options taken in prediction, possible values
+ *          0:normal prediction
+ *          1:output margin instead of transformed value
+ * \param stride number of rounds of trees of a stage, at least 1
+ * \param ntree_limit limit number of trees used for prediction, 0 uses all the trees
+ * \param out_num_stage used to store the number of stages
+ * \param out_len used to store length of returning result, nrow * num_stage * num_output_group
+ * \param out_result used to set a pointer to array, row major over the rows,
+ *          the stages and the output groups
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictStaged(BoosterHandle handle,
+                                   DMatrixHandle dmat,
+                                   int option_mask,
+                                   unsigned stride,
+                                   unsigned ntree_limit,
+                                   bst_ulong *out_num_stage,
+                                   bst_ulong *out_len,
+                                   const float **out_result);
+
+/*!
+ * \brief make prediction from a dense row major matrix owned by the caller.
+ *  The rows go straight to the tree traversal of the cpu predictor, without a
+ *  DMatrix or prediction cache, which makes it cheap for a few rows at a time,
+ *  e.g. online scoring or an attack loop. Only booster=gbtree is supported.
+ * \param handle handle
+ * \param data pointer to the nrow * ncol values
+ * \param nrow number of rows
+ * \param ncol number of columns
+ * \param missing which value to represent missing value, NaN is always missing
+ * \param option_mask bit-mask of options taken in prediction, only
+ *          1:output margin instead of transformed value is supported
+ * \param ntree_limit limit number of trees used for prediction, 0 uses all the trees
+ * \param out_size number of values the caller allocated at out_result
+ * \param out_result caller buffer of at least nrow * num_output_group values,
+ *          if it is NULL, only out_len is set to that size
+ * \param out_len used to store the number of values written
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictFromDense(BoosterHandle handle,
+                                      const float *data,
+                                      bst_ulong nrow,
+                                      bst_ulong ncol,
+                                      float missing,
+                                      int option_mask,
+                                      unsigned ntree_limit,
+                                      bst_ulong out_size,
+                                      float *out_result,
+                                      bst_ulong *out_len);
+
+/*!
+ * \brief make prediction from CSR arrays owned by the caller,
+ *  see XGBoosterPredictFromDense.
+ * \param handle handle
+ * \param indptr pointer to row headers
+ * \param indices findex
+ * \param data fvalue
+ * \param nindptr number of rows in the matrix + 1
+ * \param nelem number of nonzero elements in the matrix
+ * \param option_mask bit-mask of options taken in prediction, only
+ *          1:output margin instead of transformed value is supported
+ * \param ntree_limit limit number of trees used for prediction, 0 uses all the trees
+ * \param out_size number of values the caller allocated at out_result
+ * \param out_result caller buffer of at least nrow * num_output_group values,
+ *          if it is NULL, only out_len is set to that size
+ * \param out_len used to store the number of values written
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterPredictFromCSR(BoosterHandle handle,
+                                    const size_t* indptr,
+                                    const unsigned* indices,
+                                    const float* data,
+                                    size_t nindptr,
+                                    size_t nelem,
+                                    int option_mask,
+                                    unsigned ntree_limit,
+                                    bst_ulong out_size,
+                                    float *out_result,
+                                    bst_ulong *out_len);
+
+/*!
+ * \brief create a read only snapshot of the model of a booster, for prediction
+ *  from caller buffers by many threads at once. The snapshot is a copy, the
+ *  booster may be trained further or freed. The XGPredictor functions never
+ *  modify it and score the rows in the calling thread, so one snapshot can be
+ *  shared by serving threads without locks. Only booster=gbtree is supported.
+ * \param handle handle of the booster
+ * \param out handle of the snapshot, freed by XGPredictorFree
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterCreatePredictor(BoosterHandle handle,
+                                     PredictorHandle *out);
+
+/*!
+ * \brief free a snapshot created by XGBoosterCreatePredictor, no call may use it
+ *  anymore
+ * \param handle handle to be freed
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGPredictorFree(PredictorHandle handle);
+
+/*!
+ * \brief make prediction from a dense row major matrix owned by the caller
+ *  with a snapshot, safe to call concurrently, see XGBoosterPredictFromDense.
+ * \param handle handle of the snapshot
+ * \param data pointer to the nrow * ncol values
+ * \param nrow number of rows
+ * \param ncol number of columns
+ * \param missing which value to represent missing value, NaN is always missing
+ * \param option_mask bit-mask of options taken in prediction, only
+ *          1:output margin instead of transformed value is supported
+ * \param ntree_limit limit number of trees used for prediction, 0 uses all the trees
+ * \param out_size number of values the caller allocated at out_result
+ * \param out_result caller buffer of at least nrow * num_output_group values,
+ *          if it is NULL, only out_len is set to that size
+ * \param out_len used to store the number of values written
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGPredictorPredictFromDense(PredictorHandle handle,
+                                        const float *data,
+                                        bst_ulong nrow,
+                                        bst_ulong ncol,
+                                        float missing,
+                                        int option_mask,
+                                        unsigned ntree_limit,
+                                        bst_ulong out_size,
+                                        float *out_result,
+                                        bst_ulong *out_len);
+
+/*!
+ * \brief make prediction from CSR arrays owned by the caller with a snapshot,
+ *  safe to call concurrently, see XGBoosterPredictFromCSR.
+ * \param handle handle of the snapshot
+ * \param indptr pointer to row headers
+ * \param indices findex
+ * \param data fvalue
+ * \param nindptr number of rows in the matrix + 1
+ * \param nelem number of nonzero elements in the matrix
+ * \param option_mask bit-mask of options taken in prediction, only
+ *          1:output margin instead of transformed value is supported
+ * \param ntree_limit limit number of trees used for prediction, 0 uses all the trees
+ * \param out_size number of values the caller allocated at out_result
+ * \param out_result caller buffer of at least nrow * num_output_group values,
+ *          if it is NULL, only out_len is set to that size
+ * \param out_len used to store the number of values written
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGPredictorPredictFromCSR(PredictorHandle handle,
+                                      const size_t* indptr,
+                                      const unsigned* indices,
+                                      const float* data,
+                                      size_t nindptr,
+                                      size_t nelem,
+                                      int option_mask,
+                                      unsigned ntree_limit,
+                                      bst_ulong out_size,
+                                      float *out_result,
+                                      bst_ulong *out_len);
+
+/*!
+ * \brief decide whether the margins of the rows of a dense row major matrix
+ *  exceed a threshold, with a snapshot of a model of one output group, e.g.
+ *  the class of a binary classifier at threshold 0. The trees are walked in
+ *  the order of decreasing range of their leaf values and a row stops once
+ *  the remaining trees can not change its decision. Safe to call concurrently.
+ * \param handle handle of the snapshot
+ * \param data pointer to the nrow * ncol values
+ * \param nrow number of rows
+ * \param ncol number of columns
+ * \param missing which value to represent missing value, NaN is always missing
+ * \param threshold the margin to exceed
+ * \param out_decision caller buffer of nrow values, 1 when the margin of the
+ *          row exceeds threshold, else 0
+ * \param out_ntree caller buffer of nrow values for the number of trees each
+ *          row walked, or NULL
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGPredictorPredictDecision(PredictorHandle handle,
+                                       const float *data,
+                                       bst_ulong nrow,
+                                       bst_ulong ncol,
+                                       float missing,
+                                       float threshold,
+                                       float *out_decision,
+                                       unsigned *out_ntree);
+/*!
+ * \brief create a batcher of the single row predictions of a snapshot. The rows
+ *  submitted by concurrent XGBatcherPredict calls are scored together by a
+ *  worker thread, in batches closed at max_batch rows or max_delay_us
+ *  microseconds after their first row.
+ * \param handle handle of the snapshot, it must outlive the batcher
+ * \param max_batch most rows of a batch
+ * \param max_delay_us longest wait of a row for others to join its batch
+ * \param option_mask bit-mask of options taken in prediction, only
+ *          1:output margin instead of transformed value is supported
+ * \param ntree_limit limit number of trees used for prediction, 0 uses all the trees
+ * \param out handle of the batcher, freed by XGBatcherFree
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGPredictorCreateBatcher(PredictorHandle handle,
+                                     int max_batch,
+                                     int max_delay_us,
+                                     int option_mask,
+                                     unsigned ntree_limit,
+                                     BatcherHandle *out);
+
+/*!
+ * \brief free a batcher, the pending rows are scored first
+ * \param handle handle to be freed
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBatcherFree(BatcherHandle handle);
+
+/*!
+ * \brief predict a dense row through a batcher, waiting for the result. Safe
+ *  to call from many threads at once.
+ * \param handle handle of the batcher
+ * \param row pointer to the ncol values of the row
+ * \param ncol number of columns
+ * \param missing which value to represent missing value, NaN is always missing
+ * \param out_size number of values the caller allocated at out_result, at
+ *          least num_output_group
+ * \param out_result caller buffer for the result
+ * \param out_len used to store the number of values written
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBatcherPredict(BatcherHandle handle,
+                             const float *row,
+                             bst_ulong ncol,
+                             float missing,
+                             bst_ulong out_size,
+                             float *out_result,
+                             bst_ulong *out_len);
+/*!
+ * \brief create an empty registry of models. The trees of all its models are
+ *  kept in one packed store, where identical trees are stored once. Loading
+ *  models is not thread safe, the predictions may be called from many
+ *  threads at once between loads.
+ * \param out handle of the registry, freed by XGRegistryFree
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGRegistryCreate(RegistryHandle *out);
+
+/*!
+ * \brief free a registry
+ * \param handle handle to be freed
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGRegistryFree(RegistryHandle handle);
+
+/*!
+ * \brief load a model file into the registry as model_id, replacing the model
+ *  of that id. Only booster=gbtree is supported.
+ * \param handle handle of the registry
+ * \param model_id id the predictions name the model by
+ * \param fname file name of a model saved by XGBoosterSaveModel
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGRegistryLoadModel(RegistryHandle handle,
+                                const char *model_id,
+                                const char *fname);
+
+/*!
+ * \brief add a copy of the model of a booster to the registry as model_id,
+ *  see XGRegistryLoadModel
+ * \param handle handle of the registry
+ * \param model_id id the predictions name the model by
+ * \param booster handle of the booster
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGRegistryAddBooster(RegistryHandle handle,
+                                 const char *model_id,
+                                 BoosterHandle booster);
+
+/*!
+ * \brief get the size of the registry
+ * \param handle handle of the registry
+ * \param out_num_model number of models
+ * \param out_num_tree number of trees of all models
+ * \param out_num_stored number of distinct trees kept in the store
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGRegistryGetSize(RegistryHandle handle,
+                              bst_ulong *out_num_model,
+                              bst_ulong *out_num_tree,
+                              bst_ulong *out_num_stored);
+
+/*!
+ * \brief make prediction of model model_id from a dense row major matrix owned
+ *  by the caller, see XGBoosterPredictFromDense. The rows are scored in the
+ *  calling thread.
+ * \param handle handle of the registry
+ * \param model_id id of the model
+ * \param data pointer to the nrow * ncol values
+ * \param nrow number of rows
+ * \param ncol number of columns
+ * \param missing which value to represent missing value, NaN is always missing
+ * \param option_mask bit-mask of options taken in prediction, only
+ *          1:output margin instead of transformed value is supported
+ * \param ntree_limit limit number of trees used for prediction, 0 uses all the trees
+ * \param out_size number of values the caller allocated at out_result
+ * \param out_result caller buffer of at least nrow * num_output_group values,
+ *          if it is NULL, only out_len is set to that size
+ * \param out_len used to store the number of values written
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGRegistryPredictFromDense(RegistryHandle handle,
+                                       const char *model_id,
+                                       const float *data,
+                                       bst_ulong nrow,
+                                       bst_ulong ncol,
+                                       float missing,
+                                       int option_mask,
+                                       unsigned ntree_limit,
+                                       bst_ulong out_size,
+                                       float *out_result,
+                                       bst_ulong *out_len);
+
+/*!
+ * \brief make prediction of model model_id from CSR arrays owned by the caller,
+ *  see XGBoosterPredictFromCSR. The rows are scored in the calling thread.
+ * \param handle handle of the registry
+ * \param model_id id of the model
+ * \param indptr pointer to row headers
+ * \param indices findex
+ * \param data fvalue
+ * \param nindptr number of rows in the matrix + 1
+ * \param nelem number of nonzero elements in the matrix
+ * \param option_mask bit-mask of options taken in prediction, only
+ *          1:output margin instead of transformed value is supported
+ * \param ntree_limit limit number of trees used for prediction, 0 uses all the trees
+ * \param out_size number of values the caller allocated at out_result
+ * \param out_result caller buffer of at least nrow * num_output_group values,
+ *          if it is NULL, only out_len is set to that size
+ * \param out_len used to store the number of values written
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGRegistryPredictFromCSR(RegistryHandle handle,
+                                     const char *model_id,
+                                     const size_t* indptr,
+                                     const unsigned* indices,
+                                     const float* data,
+                                     size_t nindptr,
+                                     size_t nelem,
+                                     int option_mask,
+                                     unsigned ntree_limit,
+                                     bst_ulong out_size,
+                                     float *out_result,
+                                     bst_ulong *out_len);
+
+/*!
+ * \brief save the trees of a booster in the quantized encoding, see
+ *  src/predictor/quantized_forest.h: per feature dictionaries of the split
+ *  thresholds, 8 byte nodes and float16 leaf values. The splits are kept
+ *  exactly, the margins are only off by the rounding of the leaf values.
+ *  Only booster=gbtree is supported.
+ * \param handle handle of the booster
+ * \param fname file name
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterSaveQuantizedModel(BoosterHandle handle,
+                                        const char *fname);
+
+/*!
+ * \brief load a model saved by XGBoosterSaveQuantizedModel
+ * \param fname file name
+ * \param out handle of the model, freed by XGQuantizedModelFree
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGQuantizedModelLoad(const char *fname,
+                                 QuantizedModelHandle *out);
+
+/*!
+ * \brief free a quantized model, no call may use it anymore
+ * \param handle handle to be freed
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGQuantizedModelFree(QuantizedModelHandle handle);
+
+/*!
+ * \brief predict the margins of the rows of a dense row major matrix owned
+ *  by the caller with a quantized model, safe to call concurrently. The model
+ *  keeps no objective, so no transformed predictions are available.
+ * \param handle handle of the model
+ * \param data pointer to the nrow * ncol values
+ * \param nrow number of rows
+ * \param ncol number of columns
+ * \param missing which value to represent missing value, NaN is always missing
+ * \param out_size number of values the caller allocated at out_result
+ * \param out_result caller buffer of at least nrow * num_output_group values,
+ *          if it is NULL, only out_len is set to that size
+ * \param out_len used to store the number of values written
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGQuantizedModelPredictFromDense(QuantizedModelHandle handle,
+                                             const float *data,
+                                             bst_ulong nrow,
+                                             bst_ulong ncol,
+                                             float missing,
+                                             bst_ulong out_size,
+                                             float *out_result,
+                                             bst_ulong *out_len);
+
+/*!
+ * \brief certify the L-inf robustness of the model on a labeled matrix,
+ *  see src/robust/robust_verifier.h. The verify_* parameters of the booster apply.
+ *  The booster keeps the sums of the reachable leaf ranges of its trees at the
+ *  rows of the last matrix verified, so verifying the same matrix again after
+ *  more rounds, or after loading a later checkpoint of the model, only walks
+ *  the new trees wherever those sums certify the row.
+ * \param handle handle
+ * \param dmat data matrix, the labels are the true classes
+ * \param eps L-inf radius of the perturbation
+ * \param out_len used to store the number of rows
+ * \param out_status used to set a pointer to the verification status of each row:
+ *          0:robust by the bound, 1:robust by the exact search, 2:vulnerable,
+ *          3:undecided within verify_max_nodes, 4:misclassified
+ * \param out_bound used to set a pointer to the certified lower bound of the
+ *          worst-case margin of each row
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterVerifyRobustness(BoosterHandle handle,
+                                      DMatrixHandle dmat,
+                                      float eps,
+                                      bst_ulong *out_len,
+                                      const int **out_status,
+                                      const float **out_bound);
+
+/*!
+ * \brief run the greedy L-inf attack of src/robust/robust_attack.h on a labeled
+ *  matrix. The attack_* parameters of the booster apply.
+ * \param handle handle
+ * \param dmat data matrix, the labels are the true classes
+ * \param eps maximum L-inf radius of the perturbation
+ * \param out_len used to store the number of rows
+ * \param out_dist used to set a pointer to the L-inf distortion of the adversarial
+ *          example of each row, 0 for misclassified rows and -1 if none was found
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterAttackLinf(BoosterHandle handle,
+                                DMatrixHandle dmat,
+                                float eps,
+                                bst_ulong *out_len,
+                                const float **out_dist);
+
+/*!
+ * \brief bound the minimal L-inf adversarial radius of each row of a labeled
+ *  matrix. The greedy attack gives an upper bound, then the verifier bisects
+ *  the largest certified radius below it. The attack_* and verify_* parameters
+ *  of the booster apply, verify_radius_tol sets the width of the bisection.
+ * \param handle handle
+ * \param dmat data matrix, the labels are the true classes
+ * \param max_eps largest radius searched
+ * \param out_len used to store the number of rows
+ * \param out_bounds used to set a pointer to 2 * out_len values, the certified
+ *          radius and the radius of an adversarial example of each row in turn;
+ *          the latter is infinity if none was found, both are 0 for
+ *          misclassified rows
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterRadiusLinf(BoosterHandle handle,
+                                DMatrixHandle dmat,
+                                float max_eps,
+                                bst_ulong *out_len,
+                                const float **out_bounds);
+
+/*!
+ * \brief write the MILP of the minimal adversarial perturbation of a row of a
+ *  labeled matrix, the formulation of xgbKantchelianAttack.py, see
+ *  src/robust/robust_milp.h. The milp_* parameters of the booster apply.
+ * \param handle handle
+ * \param dmat data matrix, the labels are the true classes
+ * \param row the row attacked
+ * \param target the class the row is moved to for multiclass models, ignored
+ *          for binary ones
+ * \param eps L-inf radius of the box the leaves and the predicates are pruned
+ *          to, 0 for no pruning
+ * \param format "mps" or "lp"
+ * \param out_model used to set a pointer to the formulation
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterExportMilp(BoosterHandle handle,
+                                DMatrixHandle dmat,
+                                bst_ulong row,
+                                int target,
+                                float eps,
+                                const char *format,
+                                const char **out_model);
+
+/*!
+ * \brief compact the trees of a gbtree booster for serving, see
+ *  src/gbm/model_compactor.h. The sibling leaves of the same output are merged
+ *  and the nodes renumbered, which keeps the margins bit-identical. The other
+ *  compact_* parameters of the booster apply.
+ * \param handle handle
+ * \param fold "none", or "identical" or "structure" to also fold the trees into
+ *          an earlier tree of the same splits, the margins then only agree up
+ *          to float rounding
+ * \param out_num_tree number of trees after the compaction
+ * \param out_num_node number of nodes after the compaction
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterCompactModel(BoosterHandle handle,
+                                  const char *fold,
+                                  bst_ulong *out_num_tree,
+                                  bst_ulong *out_num_node);
+
+/*!
+ * \brief get the split thresholds of every feature over the trees of the model,
+ *  in CSR layout. The index is built when the model is loaded; the returned
+ *  arrays stay valid until the model changes.
+ * \param handle handle
+ * \param out_num_feature used to store the number of features
+ * \param out_feature_ptr used to set a pointer to num_feature + 1 offsets, the
+ *          thresholds of feature f are [feature_ptr[f], feature_ptr[f + 1])
+ * \param out_thresholds used to set a pointer to the sorted unique thresholds
+ * \param out_node_ptr used to set a pointer to num_threshold + 1 offsets, the
+ *          nodes of threshold i are [node_ptr[i], node_ptr[i + 1])
+ * \param out_nodes used to set a pointer to (tree index, node id) pairs,
+ *          two values per node
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterGetThresholdIndex(BoosterHandle handle,
+                                       bst_ulong *out_num_feature,
+                                       const bst_ulong **out_feature_ptr,
+                                       const float **out_thresholds,
+                                       const bst_ulong **out_node_ptr,
+                                       const unsigned **out_nodes);
+
+/*!
+ * \brief get the split statistics of each feature summed over the trees of a
+ *  gbtree model, the gain and cover of the dumps with stats. They are kept
+ *  up to date as the trees are added, so no dump is parsed. The arrays stay
+ *  valid until the next call from the same thread.
+ * \param handle handle
+ * \param out_len used to store the number of features, at least num_feature
+ * \param out_gain used to set a pointer to the sum of the loss change of the
+ *          splits of each feature
+ * \param out_cover used to set a pointer to the sum of the hessian of the data
+ *          reaching the splits of each feature
+ * \param out_count used to set a pointer to the number of splits of each feature
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterGetFeatureImportance(BoosterHandle handle,
+                                          bst_ulong *out_len,
+                                          const double **out_gain,
+                                          const double **out_cover,
+                                          const bst_ulong **out_count);
+
+/*!
+ * \brief export the node arrays of all trees without going through the text
+ *  dump. The nodes of tree t are [tree_ptr[t], tree_ptr[t + 1]) and indexed by
+ *  their node id; split_index, left_child and right_child are -1 for leaves.
+ *  The arrays stay valid until the next call from the same thread.
+ * \param handle handle
+ * \param out_num_tree used to store the number of trees
+ * \param out_tree_ptr used to set a pointer to num_tree + 1 node offsets
+ * \param out_tree_group used to set a pointer to the output group of each tree
+ * \param out_split_index used to set a pointer to the split feature of each node
+ * \param out_split_cond used to set a pointer to the split threshold of each node
+ * \param out_left_child used to set a pointer to the left child of each node
+ * \param out_right_child used to set a pointer to the right child of each node
+ * \param out_default_left used to set a pointer to whether missing values go left
+ * \param out_leaf_value used to set a pointer to the leaf value of each node
+ * \param out_cover used to set a pointer to the sum of hessian of each node
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterExportTrees(BoosterHandle handle,
+                                 bst_ulong *out_num_tree,
+                                 const bst_ulong **out_tree_ptr,
+                                 const int **out_tree_group,
+                                 const int **out_split_index,
+                                 const float **out_split_cond,
+                                 const int **out_left_child,
+                                 const int **out_right_child,
+                                 const int **out_default_left,
+                                 const float **out_leaf_value,
+                                 const float **out_cover);
+
 /*!
  * \brief load model from existing file
  * \param handle handle
@@ -600,4 +1439,28 @@ XGB_DLL int XGBoosterLoadRabitCheckpoint(
  */
 XGB_DLL int XGBoosterSaveRabitCheckpoint(BoosterHandle handle);
 
+/*!
+ * \brief Initialize the booster from a rabit checkpoint saved by
+ *  XGBoosterSaveRabitCheckpointWithState. The margins of the rows of dtrain
+ *  of this worker are restored with the model, so a recovered worker does not
+ *  predict its training data again.
+ * \param handle handle
+ * \param dtrain the training data of this worker, in the cache of the booster
+ * \param version The output version of the model.
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterLoadRabitCheckpointWithState(BoosterHandle handle,
+                                                  DMatrixHandle dtrain,
+                                                  int* version);
+
+/*!
+ * \brief Save the current checkpoint to rabit, with the margins of dtrain
+ *  and the random state as the local model of this worker.
+ * \param handle handle
+ * \param dtrain the training data of this worker, in the cache of the booster
+ * \return 0 when success, -1 when failure happens
+ */
+XGB_DLL int XGBoosterSaveRabitCheckpointWithState(BoosterHandle handle,
+                                                  DMatrixHandle dtrain);
+
 #endif  // XGBOOST_C_API_H_
@@ -9,7 +9,9 @@
 
 #include <dmlc/base.h>
 #include <dmlc/data.h>
+#include <algorithm>
 #include <cstring>
+#include <limits>
 #include <memory>
 #include <numeric>
 #include <string>
@@ -61,6 +63,12 @@ class MetaInfo {
    * can be used to specify initial prediction to boost from.
    */
   std::vector<bst_float> base_margin_;
+  /*!
+   * \brief the features the trees may split on, in ascending order, set by
+   *  DMatrix::InitFeatureMap. A feature missing in all the rows, or with one
+   *  value in all the rows, has no split. Empty for all the features.
+   */
+  std::vector<bst_uint> feature_map_;
   /*! \brief version flag, used to check version of this info */
   static const int kVersion = 2;
   /*! \brief version that introduced qid field */
@@ -83,6 +91,11 @@ class MetaInfo {
   inline unsigned GetRoot(size_t i) const {
     return root_index_.size() != 0 ? root_index_[i] : 0U;
   }
+  /*! \brief whether the trees may split on feature fid, see feature_map_ */
+  inline bool IsSplitFeature(bst_uint fid) const {
+    return feature_map_.size() == 0 ||
+        std::binary_search(feature_map_.begin(), feature_map_.end(), fid);
+  }
   /*! \brief get sorted indexes (argsort) of labels by absolute value (used by cox loss) */
   inline const std::vector<size_t>& LabelAbsSort() const {
     if (label_order_cache_.size() == labels_.size()) {
@@ -122,61 +135,80 @@ class MetaInfo {
   mutable std::vector<size_t> label_order_cache_;
 };
 
-/*! \brief Element from a sparse vector */
-struct Entry {
+/*!
+ * \brief Element from a sparse vector
+ * \tparam IndexType type of the feature id of a row, or of the row id of a
+ *  column
+ */
+template <typename IndexType>
+struct EntryImpl {
+  /*! \brief type of the index */
+  using Index = IndexType;
   /*! \brief feature index */
-  bst_uint index;
+  Index index;
   /*! \brief feature value */
   bst_float fvalue;
   /*! \brief default constructor */
-  Entry() = default;
+  EntryImpl() = default;
   /*!
    * \brief constructor with index and value
    * \param index The feature or row index.
    * \param fvalue THe feature value.
    */
-  Entry(bst_uint index, bst_float fvalue) : index(index), fvalue(fvalue) {}
+  EntryImpl(Index index, bst_float fvalue) : index(index), fvalue(fvalue) {}
   /*! \brief reversely compare feature values */
-  inline static bool CmpValue(const Entry& a, const Entry& b) {
+  inline static bool CmpValue(const EntryImpl& a, const EntryImpl& b) {
     return a.fvalue < b.fvalue;
   }
-  inline bool operator==(const Entry& other) const {
+  inline bool operator==(const EntryImpl& other) const {
     return (this->index == other.index && this->fvalue == other.fvalue);
   }
 };
+/*! \brief entry of the rows, and of the columns of less than 2^32 rows */
+using Entry = EntryImpl<bst_uint>;
+/*! \brief entry of the columns of 2^32 rows or more, of 64 bit row ids */
+using Entry64 = EntryImpl<uint64_t>;
 
 /*!
- * \brief in-memory storage unit of sparse batch
+ * \brief in-memory storage unit of sparse batch. The offsets are 64 bit, so a
+ *  page may hold any number of entries.
+ * \tparam EntryType the entries, whose index type is also that of the length
+ *  of an instance
  */
-class SparsePage {
+template <typename EntryType>
+class SparsePageImpl {
  public:
+  /*! \brief type of the entries */
+  using EntryT = EntryType;
+  /*! \brief type of the indices of the entries */
+  using Index = typename EntryType::Index;
   std::vector<size_t> offset;
   /*! \brief the data of the segments */
-  std::vector<Entry> data;
+  std::vector<EntryType> data;
 
   size_t base_rowid;
   /*! \brief an instance of sparse vector in the batch */
   struct Inst {
     /*! \brief pointer to the elements*/
-    const Entry *data{nullptr};
+    const EntryType *data{nullptr};
     /*! \brief length of the instance */
-    bst_uint length{0};
+    Index length{0};
     /*! \brief constructor */
     Inst()  = default;
-    Inst(const Entry *data, bst_uint length) : data(data), length(length) {}
+    Inst(const EntryType *data, Index length) : data(data), length(length) {}
     /*! \brief get i-th pair in the sparse vector*/
-    inline const Entry& operator[](size_t i) const {
+    inline const EntryType& operator[](size_t i) const {
       return data[i];
     }
   };
 
   /*! \brief get i-th row from the batch */
   inline Inst operator[](size_t i) const {
-    return {data.data() + offset[i], static_cast<bst_uint>(offset[i + 1] - offset[i])};
+    return {data.data() + offset[i], static_cast<Index>(offset[i + 1] - offset[i])};
   }
 
   /*! \brief constructor */
-  SparsePage() {
+  SparsePageImpl() {
     this->Clear();
   }
   /*! \return number of instance in the page */
@@ -185,7 +217,7 @@ class SparsePage {
   }
   /*! \return estimation of memory cost of this page */
   inline size_t MemCostBytes() const {
-    return offset.size() * sizeof(size_t) + data.size() * sizeof(Entry);
+    return offset.size() * sizeof(size_t) + data.size() * sizeof(EntryType);
   }
   /*! \brief clear the page */
   inline void Clear() {
@@ -217,12 +249,12 @@ class SparsePage {
    * \brief Push a sparse page
    * \param batch the row page
    */
-  inline void Push(const SparsePage &batch) {
+  inline void Push(const SparsePageImpl &batch) {
     size_t top = offset.back();
     data.resize(top + batch.data.size());
     std::memcpy(dmlc::BeginPtr(data) + top,
                 dmlc::BeginPtr(batch.data),
-                sizeof(Entry) * batch.data.size());
+                sizeof(EntryType) * batch.data.size());
     size_t begin = offset.size();
     offset.resize(begin + batch.Size());
     for (size_t i = 0; i < batch.Size(); ++i) {
@@ -239,12 +271,16 @@ class SparsePage {
     data.resize(begin + inst.length);
     if (inst.length != 0) {
       std::memcpy(dmlc::BeginPtr(data) + begin, inst.data,
-                  sizeof(Entry) * inst.length);
+                  sizeof(EntryType) * inst.length);
     }
   }
 
   size_t Size() { return offset.size() - 1; }
 };
+/*! \brief the pages of the rows, and of the columns of less than 2^32 rows */
+using SparsePage = SparsePageImpl<Entry>;
+/*! \brief the pages of the columns of 2^32 rows or more, see DMatrix::WideRowIds */
+using SparsePage64 = SparsePageImpl<Entry64>;
 
 
 
@@ -267,15 +303,19 @@ class DataSource : public dmlc::DataIter<SparsePage> {
 /*!
  * \brief A vector-like structure to represent set of rows.
  * But saves the memory when all rows are in the set (common case in xgb)
+ * \tparam IndexType type of the row ids
  */
-class RowSet {
+template <typename IndexType>
+class RowSetImpl {
  public:
+  /*! \brief type of the row ids */
+  using Index = IndexType;
   /*! \return i-th row index */
-  inline bst_uint operator[](size_t i) const;
+  inline Index operator[](size_t i) const;
   /*! \return the size of the set. */
   inline size_t Size() const;
   /*! \brief push the index back to the set */
-  inline void PushBack(bst_uint i);
+  inline void PushBack(Index i);
   /*! \brief clear the set */
   inline void Clear();
   /*!
@@ -290,14 +330,18 @@ class RowSet {
    */
   inline bool Load(dmlc::Stream* fi);
   /*! \brief constructor */
-  RowSet()  = default;
+  RowSetImpl()  = default;
 
  private:
   /*! \brief The internal data structure of size */
   uint64_t size_{0};
   /*! \brief The internal data structure of row set if not all*/
-  std::vector<bst_uint> rows_;
+  std::vector<Index> rows_;
 };
+/*! \brief the rows of the columns of less than 2^32 rows */
+using RowSet = RowSetImpl<bst_uint>;
+/*! \brief the rows of the columns of 2^32 rows or more */
+using RowSet64 = RowSetImpl<uint64_t>;
 
 /*!
  * \brief Internal data structured used by XGBoost during training.
@@ -332,6 +376,26 @@ class DMatrix {
    * \return Number of column blocks in the column access.
    */
   virtual void InitColAccess(size_t max_row_perbatch, bool sorted) = 0;
+  /*!
+   * \brief initialize sorted column access whose columns are built when first
+   *  requested by ColIteratorFor. Implementations that do not build columns
+   *  lazily initialize all of them, as InitColAccess.
+   * \param max_row_perbatch see InitColAccess.
+   * \param max_bytes bound of the memory of the built columns, 0 for none. Over
+   *  it, the columns not requested by the latest call are dropped, least
+   *  recently requested first.
+   */
+  virtual void InitLazyColAccess(size_t max_row_perbatch, size_t max_bytes) {
+    this->InitColAccess(max_row_perbatch, true);
+  }
+  /*!
+   * \brief get column iterator whose batches hold at least the columns of fset,
+   *  reset to the beginning position. The other columns may be empty, while
+   *  GetColSize still tells their sizes. ColIterator holds all the columns.
+   */
+  virtual dmlc::DataIter<SparsePage>* ColIteratorFor(const std::vector<bst_uint>& fset) {
+    return this->ColIterator();
+  }
   // the following are column meta data, should be able to answer them fast.
   /*! \return whether column access is enabled */
   virtual bool HaveColAccess(bool sorted) const = 0;
@@ -343,6 +407,47 @@ class DMatrix {
   virtual float GetColDensity(size_t cidx) const = 0;
   /*! \return reference of buffered rowset, in column access */
   virtual const RowSet& BufferedRowset() const = 0;
+  /*!
+   * \return whether the column pages hold 64 bit row ids, as past 2^32 rows.
+   *  Then the columns are read with ColIterator64, ColIteratorFor64 and
+   *  BufferedRowset64, and the 32 bit ones fail.
+   */
+  virtual bool WideRowIds() const {
+    return this->Info().num_row_ > std::numeric_limits<bst_uint>::max();
+  }
+  /*! \brief ColIterator of the columns of 64 bit row ids, see WideRowIds */
+  virtual dmlc::DataIter<SparsePage64>* ColIterator64() {
+    LOG(FATAL) << "this DMatrix has no columns of 64 bit row ids";
+    return nullptr;
+  }
+  /*! \brief ColIteratorFor of the columns of 64 bit row ids, see WideRowIds */
+  virtual dmlc::DataIter<SparsePage64>* ColIteratorFor64(const std::vector<bst_uint>& fset) {
+    return this->ColIterator64();
+  }
+  /*! \brief BufferedRowset of the columns of 64 bit row ids, see WideRowIds */
+  virtual const RowSet64& BufferedRowset64() const {
+    LOG(FATAL) << "this DMatrix has no columns of 64 bit row ids";
+    static RowSet64 empty;
+    return empty;
+  }
+  /*!
+   * \brief scan the rows for the features that can split, into
+   *  Info().feature_map_. The ids of the features are kept, so the models
+   *  refer to the features of the data.
+   * \param sync_rows whether the rows are split among the workers, then the
+   *  features are those of all the rows. Must be called by all the workers.
+   */
+  void InitFeatureMap(bool sync_rows);
+  /*!
+   * \brief append rows after the last row of the matrix. The column page that
+   *  is built takes the rows by a merge of each of its columns, so the rows
+   *  already in it are not sorted again.
+   * \param rows the rows to append, their base_rowid is ignored
+   * \param labels labels of the rows, given iff the matrix has labels
+   * \param weights weights of the rows, given iff the matrix has weights
+   */
+  virtual void AppendRows(const SparsePage& rows, const std::vector<bst_float>& labels,
+                          const std::vector<bst_float>& weights);
   /*! \brief virtual destructor */
   virtual ~DMatrix() = default;
   /*!
@@ -397,27 +502,60 @@ class DMatrix {
   LearnerImpl* cache_learner_ptr_{nullptr};
 };
 
+/*!
+ * \brief the column access of a DMatrix by the type of its column pages, so
+ *  that a learner templated on the page reads the columns of either width
+ */
+template <typename PageT>
+struct ColumnAccess;
+
+template <>
+struct ColumnAccess<SparsePage> {
+  static dmlc::DataIter<SparsePage>* Iterator(DMatrix* p_fmat,
+                                              const std::vector<bst_uint>& fset) {
+    return p_fmat->ColIteratorFor(fset);
+  }
+  static const RowSet& Rowset(const DMatrix& fmat) {
+    return fmat.BufferedRowset();
+  }
+};
+
+template <>
+struct ColumnAccess<SparsePage64> {
+  static dmlc::DataIter<SparsePage64>* Iterator(DMatrix* p_fmat,
+                                                const std::vector<bst_uint>& fset) {
+    return p_fmat->ColIteratorFor64(fset);
+  }
+  static const RowSet64& Rowset(const DMatrix& fmat) {
+    return fmat.BufferedRowset64();
+  }
+};
+
 // implementation of inline functions
-inline bst_uint RowSet::operator[](size_t i) const {
-  return rows_.size() == 0 ? static_cast<bst_uint>(i) : rows_[i];
+template <typename IndexType>
+inline IndexType RowSetImpl<IndexType>::operator[](size_t i) const {
+  return rows_.size() == 0 ? static_cast<Index>(i) : rows_[i];
 }
 
-inline size_t RowSet::Size() const {
+template <typename IndexType>
+inline size_t RowSetImpl<IndexType>::Size() const {
   return size_;
 }
 
-inline void RowSet::Clear() {
+template <typename IndexType>
+inline void RowSetImpl<IndexType>::Clear() {
   rows_.clear(); size_ = 0;
 }
 
-inline void RowSet::PushBack(bst_uint i) {
+template <typename IndexType>
+inline void RowSetImpl<IndexType>::PushBack(Index i) {
   if (rows_.size() == 0) {
     if (i == size_) {
       ++size_; return;
     } else {
       rows_.resize(size_);
       for (size_t i = 0; i < size_; ++i) {
-        rows_[i] = static_cast<bst_uint>(i);
+        rows_[i] = static_cast<Index>(i);
       }
     }
   }
@@ -425,12 +563,14 @@ inline void RowSet::PushBack(bst_uint i) {
   ++size_;
 }
 
-inline void RowSet::Save(dmlc::Stream* fo) const {
+template <typename IndexType>
+inline void RowSetImpl<IndexType>::Save(dmlc::Stream* fo) const {
   fo->Write(rows_);
   fo->Write(&size_, sizeof(size_));
 }
 
-inline bool RowSet::Load(dmlc::Stream* fi) {
+template <typename IndexType>
+inline bool RowSetImpl<IndexType>::Load(dmlc::Stream* fi) {
   if (!fi->Read(&rows_)) return false;
   if (rows_.size() != 0) return true;
   return fi->Read(&size_, sizeof(size_)) == sizeof(size_);
@@ -439,6 +579,8 @@ inline bool RowSet::Load(dmlc::Stream* fi) {
 
 namespace dmlc {
 DMLC_DECLARE_TRAITS(is_pod, xgboost::Entry, true);
+DMLC_DECLARE_TRAITS(is_pod, xgboost::Entry64, true);
 DMLC_DECLARE_TRAITS(has_saveload, xgboost::RowSet, true);
+DMLC_DECLARE_TRAITS(has_saveload, xgboost::RowSet64, true);
 }
 #endif  // XGBOOST_DATA_H_
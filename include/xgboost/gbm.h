@@ -21,6 +21,11 @@
 #include "../../src/common/host_device_vector.h"
 
 namespace xgboost {
+namespace gbm {
+struct GBTreeModel;
+struct CompactStats;
+struct LeafCodes;
+}  // namespace gbm
 /*!
  * \brief interface of gradient boosting model.
  */
@@ -53,6 +58,36 @@ class GradientBooster {
    * \param fo output stream
    */
   virtual void Save(dmlc::Stream* fo) const = 0;
+  /*!
+   * \brief save the part of the model added after its first tree_begin
+   *  trees, so that periodic checkpoints do not rewrite the whole model.
+   * \param fo output stream
+   * \param tree_begin number of trees of the model the segment extends
+   */
+  virtual void SaveSegment(dmlc::Stream* fo, size_t tree_begin) const {
+    LOG(FATAL) << "model segments are not supported by this booster";
+  }
+  /*!
+   * \brief append a segment written by SaveSegment to the loaded model.
+   * \param fi input stream
+   */
+  virtual void LoadSegment(dmlc::Stream* fi) {
+    LOG(FATAL) << "model segments are not supported by this booster";
+  }
+  /*!
+   * \brief predict the cumulative margins after every stride rounds of trees,
+   *  nrow * num_stage * num_output_group values, see Predictor::PredictStaged.
+   * \param dmat feature matrix
+   * \param out_margins output vector to hold the margins
+   * \param stride number of rounds of a stage
+   * \param ntree_limit limit the number of rounds, 0 uses all of them
+   * \return the number of stages
+   */
+  virtual unsigned PredictStaged(DMatrix* dmat, std::vector<bst_float>* out_margins,
+                                 unsigned stride, unsigned ntree_limit) {
+    LOG(FATAL) << "staged prediction is not supported by this booster";
+    return 0;
+  }
   /*!
    * \brief whether the model allow lazy checkpoint
    * return true if model is only updated in DoBoost
@@ -109,6 +144,19 @@ class GradientBooster {
   virtual void PredictLeaf(DMatrix* dmat,
                            std::vector<bst_float>* out_preds,
                            unsigned ntree_limit = 0) = 0;
+  /*!
+   * \brief predict the leaf of each tree as integers, see gbm::LeafCodes
+   * \param dmat feature matrix
+   * \param ntree_limit limit the number of rounds of trees, 0 uses all of them
+   * \param one_hot whether the codes are the columns of a one-hot encoding
+   * \param out_codes used to store the codes of the leaves
+   * \param out buffer of nrow * out_codes->num_tree codes of out_codes->index_size
+   *    bytes, row major, nullptr only sets out_codes
+   */
+  virtual void PredictLeafCodes(DMatrix* dmat, unsigned ntree_limit, bool one_hot,
+                                gbm::LeafCodes* out_codes, void* out) {
+    LOG(FATAL) << "leaf codes are not supported by this booster";
+  }
 
   /*!
    * \brief feature contributions to individual predictions; the output will be a vector
@@ -140,6 +188,44 @@ class GradientBooster {
   virtual std::vector<std::string> DumpModel(const FeatureMap& fmap,
                                              bool with_stats,
                                              std::string format) const = 0;
+  /*!
+   * \brief the tree ensemble of the booster, used by model analysis such as
+   *  robustness verification.
+   * \return nullptr if the output of the booster is not a plain sum of trees
+   */
+  virtual const gbm::GBTreeModel* GetTreeModel() const {
+    return nullptr;
+  }
+  /*!
+   * \brief whether dmat is one of the cache_mats the booster was created with.
+   *  The booster shares the ownership of those, so state kept per matrix
+   *  pointer stays valid for them as long as the booster lives.
+   * \param dmat the matrix to look up
+   */
+  virtual bool IsCacheMatrix(const DMatrix* dmat) const {
+    return false;
+  }
+  /*!
+   * \brief set the cached margins of a cache matrix of the booster, so that
+   *  training resumed from a saved model does not predict it again.
+   * \param dmat a matrix of cache_mats
+   * \param margin the margins of dmat predicted by the current model
+   * \return whether the margins are used
+   */
+  virtual bool SetCachedMargin(DMatrix* dmat, const std::vector<bst_float>& margin) {
+    return false;
+  }
+  /*!
+   * \brief rewrite the trees of the booster into fewer nodes for serving,
+   *  see gbm::CompactModel.
+   * \param cfg the compaction parameters
+   * \param out_stats the sizes of the model before and after
+   * \return false if the booster has no trees to compact
+   */
+  virtual bool Compact(const std::vector<std::pair<std::string, std::string> >& cfg,
+                       gbm::CompactStats* out_stats) {
+    return false;
+  }
   /*!
    * \brief create a gradient booster from given name
    * \param name name of gradient booster
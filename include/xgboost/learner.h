@@ -9,6 +9,7 @@
 #define XGBOOST_LEARNER_H_
 
 #include <rabit/rabit.h>
+#include <memory>
 #include <utility>
 #include <string>
 #include <vector>
@@ -95,6 +96,15 @@ class Learner : public rabit::Serializable {
   virtual std::string EvalOneIter(int iter,
                                   const std::vector<DMatrix*>& data_sets,
                                   const std::vector<std::string>& data_names) = 0;
+  /*!
+   * \brief evaluate the model using the configured metrics, as numbers.
+   * \param data_sets datasets to be evaluated.
+   * \param out_names name of each metric
+   * \param out_values value of metric j on data set i at i * out_names->size() + j
+   */
+  virtual void EvalMetricValues(const std::vector<DMatrix*>& data_sets,
+                                std::vector<std::string>* out_names,
+                                std::vector<bst_float>* out_values) = 0;
   /*!
    * \brief get prediction given the model.
    * \param data input data
@@ -142,6 +152,12 @@ class Learner : public rabit::Serializable {
    * \return vector of attribute name strings.
    */
   virtual std::vector<std::string> GetAttrNames() const = 0;
+  /*!
+   * \brief the threads of the parallel regions of a call to this learner,
+   *  see common::OmpThreadScope.
+   * \return the nthread parameter, 0 to keep the threads of the caller
+   */
+  virtual int NumThreads() const = 0;
   /*!
    * \return whether the model allow lazy checkpoint in rabit.
    */
@@ -177,6 +193,77 @@ class Learner : public rabit::Serializable {
    * \return Created learner.
    */
   static Learner* Create(const std::vector<std::shared_ptr<DMatrix> >& cache_data);
+  /*!
+   * \brief transform the margins of the model into predictions in place,
+   *  as Predict does unless output_margin is set.
+   * \param io_preds the margins to transform
+   */
+  inline void PredTransform(HostDeviceVector<bst_float>* io_preds) const {
+    obj_->PredTransform(io_preds);
+  }
+  /*!
+   * \brief predict after every stride rounds of trees in one walk of the
+   *  trees, nrow * num_stage * num_output_group values, as Predict with
+   *  ntree_limit = stride, 2 * stride, ... would.
+   * \return the number of stages
+   */
+  inline unsigned PredictStaged(DMatrix* data, bool output_margin, unsigned stride,
+                                unsigned ntree_limit,
+                                HostDeviceVector<bst_float>* out_preds) const {
+    const unsigned num_stage =
+        gbm_->PredictStaged(data, &out_preds->HostVector(), stride, ntree_limit);
+    if (!output_margin) {
+      obj_->PredTransform(out_preds);
+    }
+    return num_stage;
+  }
+  /*!
+   * \brief move the objective function out of the learner, e.g. to keep the
+   *  transform of a model whose trees are stored elsewhere. The learner can
+   *  not train, predict or save afterwards.
+   */
+  inline std::unique_ptr<ObjFunction> ReleaseObjective() {
+    return std::move(obj_);
+  }
+  /*! \return the gradient booster of the model */
+  inline const GradientBooster* GetGradientBooster() const {
+    return gbm_.get();
+  }
+  /*!
+   * \brief set the cached margins of a cache matrix, e.g. the training
+   *  margins saved beside the checkpoint the model is loaded from.
+   * \return whether the margins are used, see GradientBooster::SetCachedMargin
+   */
+  inline bool SetCachedMargin(DMatrix* dmat, const std::vector<bst_float>& margin) {
+    return gbm_->SetCachedMargin(dmat, margin);
+  }
+  /*!
+   * \brief predict the leaf of each tree as integers, see
+   *  GradientBooster::PredictLeafCodes
+   */
+  inline void PredictLeafCodes(DMatrix* data, unsigned ntree_limit, bool one_hot,
+                               gbm::LeafCodes* out_codes, void* out) {
+    gbm_->PredictLeafCodes(data, ntree_limit, one_hot, out_codes, out);
+  }
+  /*!
+   * \brief compact the trees of the model for serving, see GradientBooster::Compact
+   * \return false if the booster has no trees to compact
+   */
+  inline bool Compact(const std::vector<std::pair<std::string, std::string> >& cfg,
+                      gbm::CompactStats* out_stats) {
+    return gbm_->Compact(cfg, out_stats);
+  }
+  /*!
+   * \brief save the trees added after the first tree_begin trees, the other
+   *  parts of the model are those of the model the segment extends.
+   */
+  inline void SaveSegment(dmlc::Stream* fo, size_t tree_begin) const {
+    gbm_->SaveSegment(fo, tree_begin);
+  }
+  /*! \brief append a segment written by SaveSegment to the loaded model */
+  inline void LoadSegment(dmlc::Stream* fi) {
+    gbm_->LoadSegment(fi);
+  }
 
  protected:
   /*! \brief internal base score of the model */
@@ -15,6 +15,7 @@
 #include "./base.h"
 
 namespace xgboost {
+class GradientBooster;
 /*!
  * \brief interface of evaluation metric used to evaluate model performance.
  *  This has nothing to do with training, but merely act as evaluation purpose.
@@ -32,6 +33,47 @@ class Metric {
   virtual bst_float Eval(const std::vector<bst_float>& preds,
                          const MetaInfo& info,
                          bool distributed) const = 0;
+  /*!
+   * \brief evaluate a metric that looks into the model and the features
+   *  instead of the predictions, such as the robust error.
+   * \param gbm the booster being evaluated
+   * \param dmat the data set, the metric may cache state of it across rounds
+   * \param distributed whether a call to Allreduce is needed
+   * \param out the evaluation result
+   * \return false if the metric only needs the predictions, Eval is used then
+   */
+  virtual bool EvalModel(const GradientBooster& gbm, DMatrix* dmat,
+                         bool distributed, bst_float* out) {
+    return false;
+  }
+  /*!
+   * \brief sum the statistics of the rows [begin, end) of a metric that is a
+   *  weighted mean over the rows, so that the learner can evaluate several
+   *  such metrics in one pass over blocks of the predictions.
+   *
+   *  The call with an empty range checks the predictions and labels, it is
+   *  made once before the blocks, which are summed in parallel and must not
+   *  fail.
+   * \param preds prediction of all rows
+   * \param info information, including label etc.
+   * \param begin first row of the block
+   * \param end end of the block
+   * \param stats the weighted sum of the rows is added to stats[0], and the
+   *  sum of their weights to stats[1]
+   * \return false if the metric does not sum over rows, Eval is used then
+   */
+  virtual bool EvalRows(const std::vector<bst_float>& preds,
+                        const MetaInfo& info, size_t begin, size_t end,
+                        double* stats) const {
+    return false;
+  }
+  /*!
+   * \brief the metric from the statistics of all rows summed by EvalRows
+   * \param stats the two statistics, accumulated over all workers if distributed
+   */
+  virtual bst_float EvalFinal(const double* stats) const {
+    return 0.0f;
+  }
   /*! \return name of metric */
   virtual const char* Name() const = 0;
   /*! \brief virtual destructor */
@@ -51,6 +51,17 @@ class Predictor {
   virtual void Init(const std::vector<std::pair<std::string, std::string>>& cfg,
                     const std::vector<std::shared_ptr<DMatrix>>& cache);
 
+  /**
+   * \brief Set the cached predictions of a matrix registered in Init, e.g.
+   * the margins saved beside a checkpoint of the current model.
+   *
+   * \param dmat  Feature matrix.
+   * \param preds The margins of dmat predicted by the current model.
+   *
+   * \return false if dmat is not in the prediction cache.
+   */
+  bool SetCachedPredictions(DMatrix* dmat, const std::vector<bst_float>& preds);
+
   /**
    * \brief Generate batch predictions for a given feature matrix. May use
    * cached predictions if available instead of calculating from scratch.
@@ -110,6 +121,67 @@ class Predictor {
                                unsigned ntree_limit = 0,
                                unsigned root_index = 0) = 0;
 
+  /**
+   * \brief predict the margins of the rows of a dense row major buffer owned
+   * by the caller, without a DMatrix, its MetaInfo or the prediction cache.
+   *
+   * \param           data        The nrow * ncol feature values.
+   * \param           nrow        Number of rows.
+   * \param           ncol        Number of columns.
+   * \param           missing     The value marking a missing feature, NaN is
+   * always missing.
+   * \param           model       The model to predict from.
+   * \param           ntree_limit The ntree limit, 0 uses all the trees.
+   * \param [out]     out_margin  The nrow * num_output_group margins.
+   */
+
+  virtual void PredictFromDense(const bst_float* data, size_t nrow, size_t ncol,
+                                bst_float missing, const gbm::GBTreeModel& model,
+                                unsigned ntree_limit, bst_float* out_margin);
+
+  /**
+   * \brief predict the margins of the rows of CSR buffers owned by the caller,
+   * see PredictFromDense.
+   *
+   * \param           indptr      The nrow + 1 row offsets.
+   * \param           indices     The feature index of each entry.
+   * \param           data        The feature value of each entry.
+   * \param           nrow        Number of rows.
+   * \param           model       The model to predict from.
+   * \param           ntree_limit The ntree limit, 0 uses all the trees.
+   * \param [out]     out_margin  The nrow * num_output_group margins.
+   */
+
+  virtual void PredictFromCSR(const size_t* indptr, const bst_uint* indices,
+                              const bst_float* data, size_t nrow,
+                              const gbm::GBTreeModel& model,
+                              unsigned ntree_limit, bst_float* out_margin);
+
+  /**
+   * \brief predict the cumulative margins after every stride rounds of trees
+   * in one walk of each row through the trees, e.g. to plot a metric against
+   * the number of rounds. Stage s sums the first (s + 1) * stride rounds, the
+   * last stage all the rounds of ntree_limit.
+   *
+   * \param [in,out]  dmat        Feature matrix.
+   * \param [out]     out_margins The nrow * num_stage * num_output_group
+   * margins, row major.
+   * \param           model       The model to predict from.
+   * \param           stride      Number of rounds of a stage, at least 1.
+   * \param           ntree_limit The ntree limit, 0 uses all the trees.
+   */
+
+  virtual void PredictStaged(DMatrix* dmat, std::vector<bst_float>* out_margins,
+                             const gbm::GBTreeModel& model, unsigned stride,
+                             unsigned ntree_limit);
+
+  /**
+   * \brief the number of stages of PredictStaged.
+   */
+
+  static unsigned NumStages(const gbm::GBTreeModel& model, unsigned stride,
+                            unsigned ntree_limit);
+
   /**
    * \fn  virtual void Predictor::PredictLeaf(DMatrix* dmat,
    * std::vector<bst_float>* out_preds, const gbm::GBTreeModel& model, unsigned
@@ -128,6 +200,21 @@ class Predictor {
                            const gbm::GBTreeModel& model,
                            unsigned ntree_limit = 0) = 0;
 
+  /**
+   * \brief predict the leaf of each tree as the integer codes of
+   * gbm::LeafCodes, straight into a buffer instead of the floats of
+   * PredictLeaf.
+   *
+   * \param [in,out]  dmat   The input feature matrix.
+   * \param           model  Model to make predictions from.
+   * \param           codes  The codes of the leaves of the trees predicted.
+   * \param [out]     out    The nrow * codes.num_tree codes of
+   * codes.index_size bytes, row major.
+   */
+
+  virtual void PredictLeafCodes(DMatrix* dmat, const gbm::GBTreeModel& model,
+                                const gbm::LeafCodes& codes, void* out);
+
   /**
    * \fn  virtual void Predictor::PredictContribution( DMatrix* dmat,
    * std::vector<bst_float>* out_contribs, const gbm::GBTreeModel& model,
@@ -170,6 +257,13 @@ class Predictor {
   static Predictor* Create(std::string name);
 
  protected:
+  /**
+   * \brief the end of the trees of each stage of PredictStaged.
+   */
+
+  static std::vector<unsigned> StageEnds(const gbm::GBTreeModel& model, unsigned stride,
+                                         unsigned ntree_limit);
+
   /**
    * \struct  PredictionCacheEntry
    *
@@ -9,7 +9,9 @@
 
 #include <dmlc/io.h>
 #include <dmlc/parameter.h>
+#include <cmath>
 #include <limits>
+#include <memory>
 #include <vector>
 #include <string>
 #include <cstring>
@@ -453,6 +455,35 @@ class RegTree: public TreeModel<bst_float, RTreeNodeStat> {
      * \param inst The sparse instance to drop.
      */
     inline void Drop(const SparsePage::Inst& inst);
+    /*!
+     * \brief fill the vector with a dense instance, whose i-th entry has
+     *  feature index i and whose length is the size of the vector. No Drop is
+     *  needed between two dense fills, each overwrites all the values.
+     * \param inst The dense instance to fill.
+     */
+    inline void FillDense(const SparsePage::Inst& inst);
+    /*!
+     * \brief fill the vector with a dense row of a caller buffer, NaN and
+     *  missing values are marked missing. Like FillDense, every value is
+     *  overwritten and no Drop is needed.
+     * \param values The row values, feature i is values[i].
+     * \param length The number of values.
+     * \param missing The value marking a missing feature.
+     */
+    inline void FillDense(const bst_float* values, size_t length, bst_float missing);
+    /*!
+     * \brief fill the vector with a sparse row of caller CSR buffers
+     * \param index The feature indices of the row.
+     * \param value The feature values of the row.
+     * \param length The number of entries.
+     */
+    inline void Fill(const bst_uint* index, const bst_float* value, size_t length);
+    /*!
+     * \brief drop the trace after a fill from CSR buffers.
+     * \param index The feature indices of the row.
+     * \param length The number of entries.
+     */
+    inline void Drop(const bst_uint* index, size_t length);
     /*!
      * \brief returns the size of the feature vector
      * \return the size of the feature vector
@@ -503,11 +534,14 @@ class RegTree: public TreeModel<bst_float, RTreeNodeStat> {
    * \param out_contribs output vector to hold the contributions
    * \param condition fix one feature to either off (-1) on (1) or not fixed (0 default)
    * \param condition_feature the index of the feature to fix
+   * \param unique_path_data scratch of at least (d + 2) * (d + 3) / 2 elements, d the
+   *  MaxDepth of root_id, allocated by the call when nullptr
    */
   inline void CalculateContributions(const RegTree::FVec& feat, unsigned root_id,
                                      bst_float *out_contribs,
                                      int condition = 0,
-                                     unsigned condition_feature = 0) const;
+                                     unsigned condition_feature = 0,
+                                     PathElement *unique_path_data = nullptr) const;
   /*!
    * \brief Recursive function that computes the feature attributions for a single tree.
    * \param feat dense feature vector, if the feature is missing the field is set to NaN
@@ -580,6 +614,42 @@ inline void RegTree::FVec::Fill(const SparsePage::Inst& inst) {
   }
 }
 
+inline void RegTree::FVec::FillDense(const SparsePage::Inst& inst) {
+  for (bst_uint i = 0; i < inst.length; ++i) {
+    data_[i].fvalue = inst[i].fvalue;
+  }
+}
+
+inline void RegTree::FVec::FillDense(const bst_float* values, size_t length,
+                                     bst_float missing) {
+  const size_t n = std::min(length, data_.size());
+  for (size_t i = 0; i < n; ++i) {
+    if (std::isnan(values[i]) || values[i] == missing) {
+      data_[i].flag = -1;
+    } else {
+      data_[i].fvalue = values[i];
+    }
+  }
+  for (size_t i = n; i < data_.size(); ++i) {
+    data_[i].flag = -1;
+  }
+}
+
+inline void RegTree::FVec::Fill(const bst_uint* index, const bst_float* value,
+                                size_t length) {
+  for (size_t i = 0; i < length; ++i) {
+    if (index[i] >= data_.size()) continue;
+    data_[index[i]].fvalue = value[i];
+  }
+}
+
+inline void RegTree::FVec::Drop(const bst_uint* index, size_t length) {
+  for (size_t i = 0; i < length; ++i) {
+    if (index[i] >= data_.size()) continue;
+    data_[index[i]].flag = -1;
+  }
+}
+
 inline void RegTree::FVec::Drop(const SparsePage::Inst& inst) {
   for (bst_uint i = 0; i < inst.length; ++i) {
     if (inst[i].index >= data_.size()) continue;
@@ -816,7 +886,8 @@ inline void RegTree::TreeShap(const RegTree::FVec& feat, bst_float *phi,
 inline void RegTree::CalculateContributions(const RegTree::FVec& feat, unsigned root_id,
                                             bst_float *out_contribs,
                                             int condition,
-                                            unsigned condition_feature) const {
+                                            unsigned condition_feature,
+                                            PathElement *unique_path_data) const {
   // find the expected value of the tree's predictions
   if (condition == 0) {
     bst_float node_value = this->node_mean_values_[static_cast<int>(root_id)];
@@ -824,12 +895,15 @@ inline void RegTree::CalculateContributions(const RegTree::FVec& feat, unsigned
   }
 
   // Preallocate space for the unique path data
-  const int maxd = this->MaxDepth(root_id) + 2;
-  auto *unique_path_data = new PathElement[(maxd * (maxd + 1)) / 2];
+  std::unique_ptr<PathElement[]> own_path_data;
+  if (unique_path_data == nullptr) {
+    const int maxd = this->MaxDepth(root_id) + 2;
+    own_path_data.reset(new PathElement[(maxd * (maxd + 1)) / 2]);
+    unique_path_data = own_path_data.get();
+  }
 
   TreeShap(feat, out_contribs, root_id, 0, unique_path_data,
            1, 1, -1, condition, condition_feature, 1);
-  delete[] unique_path_data;
 }
 
 /*! \brief get next position of the tree given current pid */
@@ -58,6 +58,21 @@ class TreeUpdater {
                                      HostDeviceVector<bst_float>* out_preds) {
     return false;
   }
+  /*!
+   * \brief whether the updater only deletes nodes of the trees, turning the
+   *  parents of the deleted leaves into leaves, as the pruner does.
+   */
+  virtual bool OnlyDeletesNodes() const {
+    return false;
+  }
+  /*!
+   * \brief whether UpdatePredictionCache stays valid after an updater that
+   *  only deletes nodes ran on the last tree, i.e. the rows of a deleted node
+   *  are moved up to the leaf that replaced it.
+   */
+  virtual bool CacheFollowsDeletedNodes() const {
+    return false;
+  }
 
   /*!
    * \brief Create a tree updater given name
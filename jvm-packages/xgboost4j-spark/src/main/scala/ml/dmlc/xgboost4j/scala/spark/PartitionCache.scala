@@ -0,0 +1,86 @@
+/*
+ Copyright (c) 2018 by Contributors
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+ */
+
+package ml.dmlc.xgboost4j.scala.spark
+
+import scala.collection.mutable
+
+import org.apache.commons.logging.LogFactory
+
+/**
+ * The native DMatrix objects of the training partitions, kept in each executor between fits.
+ *
+ * Building a DMatrix copies every row from the JVM to the native side, and the first tree of
+ * the exact and the robust tree methods sorts its columns, which the DMatrix keeps. A fit
+ * with a partition_cache_key takes the matrices of its partitions from here when a fit of the
+ * same data ran in the executor before, so the checkpoint intervals of a fit, the retries of
+ * its tasks and the fits of a sweep only convert their rows once. A matrix is lent to one task
+ * at a time, a concurrent attempt of the same partition builds its own.
+ */
+private[spark] object PartitionCache {
+  private val logger = LogFactory.getLog("XGBoostSpark")
+
+  /** the data of a partition, the parameters that change its watches are part of it */
+  private[spark] case class Key(
+      name: String,
+      numPartitions: Int,
+      partitionId: Int,
+      missing: Float,
+      trainTestRatio: Double,
+      seed: Long)
+
+  private val cache = mutable.HashMap.empty[Key, Watches]
+  private val lent = mutable.HashSet.empty[Key]
+
+  /**
+   * @return the watches of key and whether they are cached, build creates them when no idle
+   *         cached ones exist. Cached watches are handed back by release, not deleted.
+   */
+  def acquire(key: Key)(build: => Watches): (Watches, Boolean) = {
+    val cached = synchronized {
+      // a fit of other data drops the idle matrices of the former one
+      for (k <- cache.keys.toList if k.name != key.name && !lent.contains(k)) {
+        cache.remove(k).foreach(_.delete())
+      }
+      if (lent.contains(key)) {
+        None
+      } else {
+        lent += key
+        Some(cache.get(key))
+      }
+    }
+    cached match {
+      case None =>
+        (build, false)
+      case Some(Some(watches)) =>
+        logger.info(s"reusing the cached DMatrix of partition ${key.partitionId}")
+        (watches, true)
+      case Some(None) =>
+        val watches = try build catch {
+          case e: Throwable =>
+            synchronized { lent -= key }
+            throw e
+        }
+        synchronized { cache.put(key, watches) }
+        (watches, true)
+    }
+  }
+
+  /** hand back the watches of key taken by acquire */
+  def release(key: Key): Unit = synchronized {
+    lent -= key
+  }
+}
@@ -106,10 +106,12 @@ object XGBoost extends Serializable {
       eval: EvalTrait,
       useExternalMemory: Boolean,
       missing: Float,
-      prevBooster: Booster
+      prevBooster: Booster,
+      partitionCacheKey: Option[String] = None
     ): RDD[(Booster, Map[String, Array[Float]])] = {
 
     val partitionedBaseMargin = data.map(_.baseMargin)
+    val numPartitions = data.getNumPartitions
     // to workaround the empty partitions in training dataset,
     // this might not be the best efficient implementation, see
     // (https://github.com/dmlc/xgboost/issues/1277)
@@ -128,9 +130,18 @@ object XGBoost extends Serializable {
       }
       rabitEnv.put("DMLC_TASK_ID", taskId)
       Rabit.init(rabitEnv)
-      val watches = Watches(params,
+      def buildWatches: Watches = Watches(params,
         removeMissingValues(labeledPoints, missing),
         fromBaseMarginsToArray(baseMargins), cacheDirName)
+      val cacheKey = partitionCacheKey.filter(_ => cacheDirName.isEmpty).map { name =>
+        PartitionCache.Key(name, numPartitions, TaskContext.getPartitionId(), missing,
+          params.get("train_test_ratio").map(_.toString.toDouble).getOrElse(1.0),
+          params.get("seed").map(_.toString.toLong).getOrElse(0L))
+      }
+      val (watches, cached) = cacheKey match {
+        case Some(key) => PartitionCache.acquire(key)(buildWatches)
+        case None => (buildWatches, false)
+      }
 
       try {
         val numEarlyStoppingRounds = params.get("num_early_stopping_rounds")
@@ -142,7 +153,11 @@ object XGBoost extends Serializable {
         Iterator(booster -> watches.toMap.keys.zip(metrics).toMap)
       } finally {
         Rabit.shutdown()
-        watches.delete()
+        if (cached) {
+          cacheKey.foreach(PartitionCache.release)
+        } else {
+          watches.delete()
+        }
       }
     }.cache()
   }
@@ -188,8 +203,8 @@ object XGBoost extends Serializable {
       useExternalMemory: Boolean = false,
       missing: Float = Float.NaN): (Booster, Map[String, Array[Float]]) = {
     if (params.contains("tree_method")) {
-      require(params("tree_method") != "hist", "xgboost4j-spark does not support fast histogram" +
-        " for now")
+      require(params("tree_method") != "hist" && params("tree_method") != "robust_hist",
+        "xgboost4j-spark does not support fast histogram for now")
     }
     require(nWorkers > 0, "you must specify more than 0 workers")
     if (obj != null) {
@@ -209,6 +224,7 @@ object XGBoost extends Serializable {
       case _ => throw new IllegalArgumentException("parameter \"timeout_request_workers\" must be" +
         " an instance of Long.")
     }
+    val partitionCacheKey = params.get("partition_cache_key").map(_.toString).filter(_.nonEmpty)
     val (checkpointPath, checkpointInterval) = CheckpointManager.extractParams(params)
     val partitionedData = repartitionForTraining(trainingData, nWorkers)
 
@@ -226,7 +242,7 @@ object XGBoost extends Serializable {
           val parallelismTracker = new SparkParallelismTracker(sc, timeoutRequestWorkers, nWorkers)
           val boostersAndMetrics = buildDistributedBoosters(partitionedData, overriddenParams,
             tracker.getWorkerEnvs, checkpointRound, obj, eval, useExternalMemory, missing,
-            prevBooster)
+            prevBooster, partitionCacheKey)
           val sparkJobThread = new Thread() {
             override def run() {
               // force the job
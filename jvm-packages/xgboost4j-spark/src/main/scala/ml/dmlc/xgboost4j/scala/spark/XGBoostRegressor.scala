@@ -87,6 +87,8 @@ class XGBoostRegressor (
 
   def setSeed(value: Long): this.type = set(seed, value)
 
+  def setPartitionCacheKey(value: String): this.type = set(partitionCacheKey, value)
+
   def setEta(value: Double): this.type = set(eta, value)
 
   def setGamma(value: Double): this.type = set(gamma, value)
@@ -115,6 +117,8 @@ class XGBoostRegressor (
 
   def setSketchEps(value: Double): this.type = set(sketchEps, value)
 
+  def setRobustEps(value: Double): this.type = set(robustEps, value)
+
   def setScalePosWeight(value: Double): this.type = set(scalePosWeight, value)
 
   def setSampleType(value: String): this.type = set(sampleType, value)
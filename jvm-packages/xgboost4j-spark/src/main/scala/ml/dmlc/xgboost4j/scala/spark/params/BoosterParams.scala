@@ -134,11 +134,12 @@ private[spark] trait BoosterParams extends Params {
   final def getAlpha: Double = $(alpha)
 
   /**
-   * The tree construction algorithm used in XGBoost. options: {'auto', 'exact', 'approx'}
-   *  [default='auto']
+   * The tree construction algorithm used in XGBoost. options: {'auto', 'exact', 'approx',
+   * 'robust_exact', 'robust_approx'} [default='auto']
    */
   final val treeMethod = new Param[String](this, "treeMethod",
-    "The tree construction algorithm used in XGBoost, options: {'auto', 'exact', 'approx', 'hist'}",
+    "The tree construction algorithm used in XGBoost, options: {'auto', 'exact', 'approx', " +
+      "'hist', 'robust_exact', 'robust_approx'}",
     (value: String) => BoosterParams.supportedTreeMethods.contains(value))
 
   final def getTreeMethod: String = $(treeMethod)
@@ -174,6 +175,17 @@ private[spark] trait BoosterParams extends Params {
 
   final def getSketchEps: Double = $(sketchEps)
 
+  /**
+   * This is only used for the robust tree methods. A split value is chosen for its worst case
+   * gain when each feature value may be perturbed by up to robust_eps. [default=0.3]
+   */
+  final val robustEps = new DoubleParam(this, "robustEps",
+    "This is only used for the robust tree methods. A split value is chosen for its worst case" +
+      " gain when each feature value may be perturbed by up to robust_eps.",
+    (value: Double) => value >= 0)
+
+  final def getRobustEps: Double = $(robustEps)
+
   /**
    * Control the balance of positive and negative weights, useful for unbalanced classes. A typical
    * value to consider: sum(negative cases) / sum(positive cases).   [default=1]
@@ -247,6 +259,7 @@ private[spark] trait BoosterParams extends Params {
     growPolicy -> "depthwise", maxBins -> 16,
     subsample -> 1, colsampleBytree -> 1, colsampleBylevel -> 1,
     lambda -> 1, alpha -> 0, treeMethod -> "auto", sketchEps -> 0.03,
+    robustEps -> 0.3,
     scalePosWeight -> 1.0, sampleType -> "uniform", normalizeType -> "tree",
     rateDrop -> 0.0, skipDrop -> 0.0, lambdaBias -> 0, treeLimit -> 0)
 }
@@ -255,7 +268,8 @@ private[spark] object BoosterParams {
 
   val supportedBoosters = HashSet("gbtree", "gblinear", "dart")
 
-  val supportedTreeMethods = HashSet("auto", "exact", "approx", "hist")
+  val supportedTreeMethods = HashSet("auto", "exact", "approx", "hist", "robust_exact",
+    "robust_approx")
 
   val supportedGrowthPolicies = HashSet("depthwise", "lossguide")
 
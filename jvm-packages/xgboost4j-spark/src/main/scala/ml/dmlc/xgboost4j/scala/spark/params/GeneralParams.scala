@@ -150,11 +150,26 @@ private[spark] trait GeneralParams extends Params {
 
   final def getSeed: Long = $(seed)
 
+  /**
+    * The name of the training data under which the executors keep the DMatrix of each training
+    * partition, with its sorted columns, after a fit. A later fit with the same name, the same
+    * number of workers, missing value, train_test_ratio and seed reuses them instead of
+    * building them from the rows again, e.g. the fits of a parameter sweep. The rows of each
+    * partition must then be the same in every fit. A fit with another name drops the kept
+    * matrices. Ignored with external memory. default: `empty_string` (nothing is kept)
+    */
+  final val partitionCacheKey = new Param[String](this, "partitionCacheKey", "the name of " +
+    "the training data under which the executors keep the DMatrix of each training partition " +
+    "between fits. A later fit with the same name and data parameters reuses them, the rows " +
+    "of each partition must be the same in every fit.")
+
+  final def getPartitionCacheKey: String = $(partitionCacheKey)
+
   setDefault(numRound -> 1, numWorkers -> 1, nthread -> 1,
     useExternalMemory -> false, silent -> 0,
     customObj -> null, customEval -> null, missing -> Float.NaN,
     trackerConf -> TrackerConf(), seed -> 0, timeoutRequestWorkers -> 30 * 60 * 1000L,
-    checkpointPath -> "", checkpointInterval -> -1
+    checkpointPath -> "", checkpointInterval -> -1, partitionCacheKey -> ""
   )
 }
 
@@ -109,6 +109,29 @@ class XGBoostGeneralSuite extends FunSuite with PerTest {
   }
 
 
+  test("training with robust_approx") {
+    val eval = new EvalError()
+    val training = buildDataFrame(Classification.train)
+    val testDM = new DMatrix(Classification.test.iterator)
+    val paramMap = Map("eta" -> "1", "max_depth" -> "6", "silent" -> "1",
+      "objective" -> "binary:logistic", "tree_method" -> "robust_approx", "robust_eps" -> "0.1",
+      "num_round" -> 5, "num_workers" -> numWorkers)
+    val model = new XGBoostClassifier(paramMap).fit(training)
+    assert(eval.eval(model._booster.predict(testDM, outPutMargin = true), testDM) < 0.1)
+  }
+
+  test("fits with a partition cache key reuse the partition matrices") {
+    val training = buildDataFrame(Classification.train)
+    val testDM = new DMatrix(Classification.test.iterator)
+    val paramMap = Map("eta" -> "1", "max_depth" -> "6", "silent" -> "1",
+      "objective" -> "binary:logistic", "num_round" -> 5, "num_workers" -> numWorkers,
+      "partition_cache_key" -> "classification")
+    val first = new XGBoostClassifier(paramMap).fit(training)
+    val second = new XGBoostClassifier(paramMap).fit(training)
+    assert(first._booster.predict(testDM, outPutMargin = true).deep ===
+      second._booster.predict(testDM, outPutMargin = true).deep)
+  }
+
   ignore("test with fast histo depthwise") {
     val eval = new EvalError()
     val training = buildDataFrame(Classification.train)
@@ -16,6 +16,7 @@
 package ml.dmlc.xgboost4j.java;
 
 import java.io.*;
+import java.nio.ByteBuffer;
 import java.util.HashMap;
 import java.util.List;
 import java.util.Map;
@@ -318,6 +319,59 @@ public class Booster implements Serializable, KryoSerializable {
     return this.predict(data, outputMargin, treeLimit, false, false);
   }
 
+  /**
+   * Predict the rows of a dense row major matrix in off-heap memory, e.g. an Arrow or Netty
+   * buffer, without copying them. The native side reads the rows and writes the results in
+   * place, no DMatrix is built.
+   *
+   * @param data         direct buffer of nrow * ncol floats in the native byte order
+   * @param nrow         number of rows
+   * @param ncol         number of columns
+   * @param missing      the value of missing entries, NaN is always missing
+   * @param outputMargin output margin
+   * @param treeLimit    limit number of trees, 0 means all trees.
+   * @param out          direct buffer of floats in the native byte order for the results,
+   *                     row major, of at least nrow * number of output groups floats
+   * @return number of floats written to out
+   */
+  public synchronized long predictFromDense(ByteBuffer data, long nrow, long ncol, float missing,
+                                            boolean outputMargin, int treeLimit, ByteBuffer out)
+      throws XGBoostError {
+    XGBoostJNI.checkDirectBuffer(data, nrow * ncol * 4, "data");
+    XGBoostJNI.checkDirectBuffer(out, 0, "out");
+    long[] outLen = new long[1];
+    XGBoostJNI.checkCall(XGBoostJNI.XGBoosterPredictFromDenseBuffer(handle, data, nrow, ncol,
+        missing, outputMargin ? 1 : 0, treeLimit, out, outLen));
+    return outLen[0];
+  }
+
+  /**
+   * Predict the rows of a CSR matrix in off-heap memory without copying them,
+   * see predictFromDense.
+   *
+   * @param indptr       direct buffer of nrow + 1 longs, the offsets of the rows
+   * @param indices      direct buffer of nelem ints, the feature indices
+   * @param data         direct buffer of nelem floats, the values
+   * @param nrow         number of rows
+   * @param nelem        number of entries
+   * @param outputMargin output margin
+   * @param treeLimit    limit number of trees, 0 means all trees.
+   * @param out          direct buffer of floats for the results, see predictFromDense
+   * @return number of floats written to out
+   */
+  public synchronized long predictFromCSR(ByteBuffer indptr, ByteBuffer indices, ByteBuffer data,
+                                          long nrow, long nelem, boolean outputMargin,
+                                          int treeLimit, ByteBuffer out) throws XGBoostError {
+    XGBoostJNI.checkDirectBuffer(indptr, (nrow + 1) * 8, "indptr");
+    XGBoostJNI.checkDirectBuffer(indices, nelem * 4, "indices");
+    XGBoostJNI.checkDirectBuffer(data, nelem * 4, "data");
+    XGBoostJNI.checkDirectBuffer(out, 0, "out");
+    long[] outLen = new long[1];
+    XGBoostJNI.checkCall(XGBoostJNI.XGBoosterPredictFromCSRBuffer(handle, indptr, indices, data,
+        nrow + 1, nelem, outputMargin ? 1 : 0, treeLimit, out, outLen));
+    return outLen[0];
+  }
+
   /**
    * Save model to modelPath
    *
@@ -15,6 +15,7 @@
  */
 package ml.dmlc.xgboost4j.java;
 
+import java.nio.ByteBuffer;
 import java.util.Iterator;
 
 import ml.dmlc.xgboost4j.LabeledPoint;
@@ -142,6 +143,23 @@ public class DMatrix {
     handle = out[0];
   }
 
+  /**
+   * create DMatrix from a dense row major matrix in off-heap memory, e.g. an Arrow or Netty
+   * buffer. The native side reads the floats in place, without pinning or copying a java
+   * array; the buffer is only needed during the call.
+   * @param data direct buffer of nrow * ncol floats in the native byte order, from its start
+   * @param nrow number of rows
+   * @param ncol number of columns
+   * @param missing the specified value to represent the missing value, NaN is always missing
+   */
+  public DMatrix(ByteBuffer data, long nrow, long ncol, float missing) throws XGBoostError {
+    XGBoostJNI.checkDirectBuffer(data, nrow * ncol * 4, "data");
+    long[] out = new long[1];
+    XGBoostJNI.checkCall(XGBoostJNI.XGDMatrixCreateFromMatBuffer(data, nrow, ncol, missing,
+        out));
+    handle = out[0];
+  }
+
   /**
    * used for DMatrix slice
    */
@@ -16,6 +16,7 @@
 package ml.dmlc.xgboost4j.java;
 
 import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 
 import org.apache.commons.logging.Log;
 import org.apache.commons.logging.LogFactory;
@@ -49,6 +50,23 @@ class XGBoostJNI {
     }
   }
 
+  /**
+   * Check that a buffer handed to the native side without a copy is a direct buffer of the
+   * native byte order with at least nbytes bytes from its start.
+   */
+  static void checkDirectBuffer(ByteBuffer buffer, long nbytes, String name) {
+    if (buffer == null) {
+      throw new NullPointerException(name + ": null");
+    }
+    if (!buffer.isDirect() || buffer.order() != ByteOrder.nativeOrder()) {
+      throw new IllegalArgumentException(name + " must be a direct buffer of the native order");
+    }
+    if (buffer.capacity() < nbytes) {
+      throw new IllegalArgumentException(name + " holds " + buffer.capacity() +
+          " bytes, " + nbytes + " are needed");
+    }
+  }
+
   public final static native String XGBGetLastError();
 
   public final static native int XGDMatrixCreateFromFile(String fname, int silent, long[] out);
@@ -65,6 +83,11 @@ class XGBoostJNI {
   public final static native int XGDMatrixCreateFromMat(float[] data, int nrow, int ncol,
                                                         float missing, long[] out);
 
+  // the buffers are direct, their memory is read in place
+  public final static native int XGDMatrixCreateFromMatBuffer(ByteBuffer data, long nrow,
+                                                              long ncol, float missing,
+                                                              long[] out);
+
   public final static native int XGDMatrixSliceDMatrix(long handle, int[] idxset, long[] out);
 
   public final static native int XGDMatrixFree(long handle);
@@ -100,6 +123,20 @@ class XGBoostJNI {
   public final static native int XGBoosterPredict(long handle, long dmat, int option_mask,
                                                   int ntree_limit, float[][] predicts);
 
+  // the buffers are direct, the rows are read and the results written in place
+  public final static native int XGBoosterPredictFromDenseBuffer(long handle, ByteBuffer data,
+                                                                 long nrow, long ncol,
+                                                                 float missing, int option_mask,
+                                                                 int ntree_limit, ByteBuffer out,
+                                                                 long[] out_len);
+
+  public final static native int XGBoosterPredictFromCSRBuffer(long handle, ByteBuffer indptr,
+                                                               ByteBuffer indices,
+                                                               ByteBuffer data, long nindptr,
+                                                               long nelem, int option_mask,
+                                                               int ntree_limit, ByteBuffer out,
+                                                               long[] out_len);
+
   public final static native int XGBoosterLoadModel(long handle, String fname);
 
   public final static native int XGBoosterSaveModel(long handle, String fname);
@@ -16,6 +16,8 @@
 
 package ml.dmlc.xgboost4j.scala
 
+import java.nio.ByteBuffer
+
 import com.esotericsoftware.kryo.io.{Output, Input}
 import com.esotericsoftware.kryo.{Kryo, KryoSerializable}
 import ml.dmlc.xgboost4j.java.{Booster => JBooster}
@@ -130,6 +132,30 @@ class Booster private[xgboost4j](private[xgboost4j] var booster: JBooster)
     booster.predict(data.jDMatrix, outPutMargin, treeLimit)
   }
 
+  /**
+   * Predict the rows of a dense row major off-heap matrix in place, see the java Booster
+   *
+   * @param data         direct buffer of nrow * ncol floats in the native byte order
+   * @param out          direct buffer for the results, nrow * number of output groups floats
+   * @return number of floats written to out
+   */
+  @throws(classOf[XGBoostError])
+  def predictFromDense(data: ByteBuffer, nrow: Long, ncol: Long, missing: Float, out: ByteBuffer,
+      outPutMargin: Boolean = false, treeLimit: Int = 0): Long = {
+    booster.predictFromDense(data, nrow, ncol, missing, outPutMargin, treeLimit, out)
+  }
+
+  /**
+   * Predict the rows of an off-heap CSR matrix in place, see the java Booster
+   *
+   * @return number of floats written to out
+   */
+  @throws(classOf[XGBoostError])
+  def predictFromCSR(indptr: ByteBuffer, indices: ByteBuffer, data: ByteBuffer, nrow: Long,
+      nelem: Long, out: ByteBuffer, outPutMargin: Boolean = false, treeLimit: Int = 0): Long = {
+    booster.predictFromCSR(indptr, indices, data, nrow, nelem, outPutMargin, treeLimit, out)
+  }
+
   /**
    * Predict the leaf indices
    *
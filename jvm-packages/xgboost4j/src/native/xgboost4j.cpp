@@ -265,6 +265,21 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFro
   return ret;
 }
 
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGDMatrixCreateFromMatBuffer
+ * Signature: (Ljava/nio/ByteBuffer;JJF[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGDMatrixCreateFromMatBuffer
+  (JNIEnv *jenv, jclass jcls, jobject jdata, jlong jnrow, jlong jncol, jfloat jmiss, jlongArray jout) {
+  DMatrixHandle result;
+  // the rows are read in place, no java array is pinned or copied
+  const float* data = (const float*) jenv->GetDirectBufferAddress(jdata);
+  jint ret = (jint) XGDMatrixCreateFromMat(data, (bst_ulong) jnrow, (bst_ulong) jncol, jmiss, &result);
+  setHandle(jenv, jout, result);
+  return ret;
+}
+
 /*
  * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
  * Method:    XGDMatrixSliceDMatrix
@@ -565,6 +580,51 @@ JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGBoosterPredict
   return ret;
 }
 
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGBoosterPredictFromDenseBuffer
+ * Signature: (JLjava/nio/ByteBuffer;JJFIILjava/nio/ByteBuffer;[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGBoosterPredictFromDenseBuffer
+  (JNIEnv *jenv, jclass jcls, jlong jhandle, jobject jdata, jlong jnrow, jlong jncol, jfloat jmiss,
+   jint joption_mask, jint jntree_limit, jobject jresult, jlongArray jout_len) {
+  BoosterHandle handle = (BoosterHandle) jhandle;
+  const float* data = (const float*) jenv->GetDirectBufferAddress(jdata);
+  float* result = (float*) jenv->GetDirectBufferAddress(jresult);
+  bst_ulong out_size = (bst_ulong) (jenv->GetDirectBufferCapacity(jresult) / sizeof(float));
+  bst_ulong len = 0;
+  int ret = XGBoosterPredictFromDense(handle, data, (bst_ulong) jnrow, (bst_ulong) jncol, jmiss,
+                                      joption_mask, (unsigned int) jntree_limit, out_size, result,
+                                      &len);
+  jlong jlen = (jlong) len;
+  jenv->SetLongArrayRegion(jout_len, 0, 1, &jlen);
+  return ret;
+}
+
+/*
+ * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
+ * Method:    XGBoosterPredictFromCSRBuffer
+ * Signature: (JLjava/nio/ByteBuffer;Ljava/nio/ByteBuffer;Ljava/nio/ByteBuffer;JJIILjava/nio/ByteBuffer;[J)I
+ */
+JNIEXPORT jint JNICALL Java_ml_dmlc_xgboost4j_java_XGBoostJNI_XGBoosterPredictFromCSRBuffer
+  (JNIEnv *jenv, jclass jcls, jlong jhandle, jobject jindptr, jobject jindices, jobject jdata,
+   jlong jnindptr, jlong jnelem, jint joption_mask, jint jntree_limit, jobject jresult,
+   jlongArray jout_len) {
+  BoosterHandle handle = (BoosterHandle) jhandle;
+  const size_t* indptr = (const size_t*) jenv->GetDirectBufferAddress(jindptr);
+  const unsigned* indices = (const unsigned*) jenv->GetDirectBufferAddress(jindices);
+  const float* data = (const float*) jenv->GetDirectBufferAddress(jdata);
+  float* result = (float*) jenv->GetDirectBufferAddress(jresult);
+  bst_ulong out_size = (bst_ulong) (jenv->GetDirectBufferCapacity(jresult) / sizeof(float));
+  bst_ulong len = 0;
+  int ret = XGBoosterPredictFromCSR(handle, indptr, indices, data, (size_t) jnindptr,
+                                    (size_t) jnelem, joption_mask, (unsigned int) jntree_limit,
+                                    out_size, result, &len);
+  jlong jlen = (jlong) len;
+  jenv->SetLongArrayRegion(jout_len, 0, 1, &jlen);
+  return ret;
+}
+
 /*
  * Class:     ml_dmlc_xgboost4j_java_XGBoostJNI
  * Method:    XGBoosterLoadModel
@@ -16,12 +16,15 @@
 package ml.dmlc.xgboost4j.java;
 
 import java.io.*;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 import java.nio.file.Files;
 import java.nio.file.Path;
 import java.util.Arrays;
 import java.util.HashMap;
 import java.util.LinkedHashMap;
 import java.util.Map;
+import java.util.Random;
 
 import junit.framework.TestCase;
 import org.junit.Test;
@@ -101,6 +104,33 @@ public class BoosterImplTest {
     TestCase.assertTrue(eval.eval(predicts, testMat) < 0.1f);
   }
 
+  @Test
+  public void testPredictFromDirectBuffer() throws XGBoostError {
+    DMatrix trainMat = new DMatrix("../../demo/data/agaricus.txt.train");
+    DMatrix testMat = new DMatrix("../../demo/data/agaricus.txt.test");
+    Booster booster = trainBooster(trainMat, testMat);
+
+    int nrow = 16;
+    int ncol = 127;
+    Random rng = new Random(0);
+    float[] dense = new float[nrow * ncol];
+    ByteBuffer data = ByteBuffer.allocateDirect(dense.length * 4).order(ByteOrder.nativeOrder());
+    for (int i = 0; i < dense.length; i++) {
+      dense[i] = rng.nextInt(4) == 0 ? 1.0f : Float.NaN;
+      data.putFloat(i * 4, dense[i]);
+    }
+    float[][] expected = booster.predict(new DMatrix(dense, nrow, ncol, Float.NaN), true, 0);
+
+    ByteBuffer out = ByteBuffer.allocateDirect(nrow * 4).order(ByteOrder.nativeOrder());
+    long len = booster.predictFromDense(data, nrow, ncol, Float.NaN, true, 0, out);
+    TestCase.assertEquals(nrow, len);
+    float[][] fromBuffer = booster.predict(new DMatrix(data, nrow, ncol, Float.NaN), true, 0);
+    for (int i = 0; i < nrow; i++) {
+      TestCase.assertEquals(expected[i][0], out.getFloat(i * 4), 1e-6f);
+      TestCase.assertEquals(expected[i][0], fromBuffer[i][0], 1e-6f);
+    }
+  }
+
   @Test
   public void saveLoadModelWithPath() throws XGBoostError, IOException {
     DMatrix trainMat = new DMatrix("../../demo/data/agaricus.txt.train");
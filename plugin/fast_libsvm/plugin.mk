@@ -0,0 +1,2 @@
+PLUGIN_OBJS += build_plugin/fast_libsvm/fast_libsvm.o
+PLUGIN_LDFLAGS +=
@@ -9,6 +9,9 @@
 #include <dmlc/parameter.h>
 #include <lz4.h>
 #include <lz4hc.h>
+#include <algorithm>
+#include <string>
+#include <vector>
 #include "../../src/data/sparse_page_writer.h"
 
 namespace xgboost {
@@ -37,6 +40,11 @@ class CompressArray {
     return encoded_chunks_.back() +
         (encoded_chunks_.size() + raw_chunks_.size()) * sizeof(bst_uint);
   }
+  // the chunk holding element i
+  inline int ChunkOf(size_t i) const {
+    return static_cast<int>(std::upper_bound(raw_chunks_.begin(), raw_chunks_.end(), i) -
+                            raw_chunks_.begin()) - 1;
+  }
   // load the array from file.
   inline void Read(dmlc::SeekStream* fi);
   // run decode on chunk_id
@@ -46,8 +54,9 @@ class CompressArray {
   inline void InitCompressChunks(const std::vector<bst_uint>& chunk_ptr);
   // initialize the compression chunks
   inline void InitCompressChunks(size_t chunk_size, size_t max_nchunk);
-  // run decode on chunk_id, level = -1 means default.
-  inline void Compress(int chunk_id, bool use_hc);
+  // run encode on chunk_id, level > 0 is the lz4hc level, level <= 0 the
+  // fast lz4 of acceleration -level, 0 meaning the default.
+  inline void Compress(int chunk_id, int level);
   // save the output buffer into file.
   inline void Write(dmlc::Stream* fo);
 
@@ -118,7 +127,7 @@ inline void CompressArray<DType>::InitCompressChunks(size_t chunk_size, size_t m
 }
 
 template<typename DType>
-inline void CompressArray<DType>::Compress(int chunk_id, bool use_hc) {
+inline void CompressArray<DType>::Compress(int chunk_id, int level) {
   CHECK_LT(static_cast<size_t>(chunk_id + 1), raw_chunks_.size());
   std::string& buf = out_buffer_[chunk_id];
   size_t raw_chunk_size = (raw_chunks_[chunk_id + 1] - raw_chunks_[chunk_id]) * sizeof(DType);
@@ -126,14 +135,14 @@ inline void CompressArray<DType>::Compress(int chunk_id, bool use_hc) {
   CHECK_NE(bound, 0);
   buf.resize(bound);
   int encoded_size;
-  if (use_hc) {
+  if (level > 0) {
     encoded_size = LZ4_compress_HC(
         reinterpret_cast<char*>(dmlc::BeginPtr(data) + raw_chunks_[chunk_id]),
-        dmlc::BeginPtr(buf), raw_chunk_size, buf.length(), 9);
+        dmlc::BeginPtr(buf), raw_chunk_size, buf.length(), level);
   } else {
-    encoded_size = LZ4_compress_default(
+    encoded_size = LZ4_compress_fast(
         reinterpret_cast<char*>(dmlc::BeginPtr(data) + raw_chunks_[chunk_id]),
-        dmlc::BeginPtr(buf), raw_chunk_size, buf.length());
+        dmlc::BeginPtr(buf), raw_chunk_size, buf.length(), std::max(-level, 1));
   }
   CHECK_NE(encoded_size, 0);
   CHECK_LE(static_cast<size_t>(encoded_size), buf.length());
@@ -157,8 +166,8 @@ inline void CompressArray<DType>::Write(dmlc::Stream* fo) {
 template<typename StorageIndex>
 class SparsePageLZ4Format : public SparsePageFormat {
  public:
-  explicit SparsePageLZ4Format(bool use_lz4_hc)
-      : use_lz4_hc_(use_lz4_hc) {
+  explicit SparsePageLZ4Format(int level)
+      : level_(level) {
     raw_bytes_ = raw_bytes_value_ = raw_bytes_index_ = 0;
     encoded_bytes_value_ = encoded_bytes_index_ = 0;
     nthread_ = dmlc::GetEnv("XGBOOST_LZ4_DECODE_NTHREAD", 4);
@@ -179,12 +188,14 @@ class SparsePageLZ4Format : public SparsePageFormat {
   bool Read(SparsePage* page, dmlc::SeekStream* fi) override {
     if (!fi->Read(&(page->offset))) return false;
     CHECK_NE(page->offset.size(), 0) << "Invalid SparsePage file";
-    this->LoadIndexValue(fi);
+    this->LoadIndexValue(fi, nullptr);
 
     page->data.resize(page->offset.back());
     CHECK_EQ(index_.data.size(), value_.data.size());
     CHECK_EQ(index_.data.size(), page->data.size());
-    for (size_t i = 0; i < page->data.size(); ++i) {
+    const auto ndata = static_cast<bst_omp_uint>(page->data.size());
+    #pragma omp parallel for schedule(static) num_threads(nthread_)
+    for (bst_omp_uint i = 0; i < ndata; ++i) {
       page->data[i] = Entry(index_.data[i] + min_index_, value_.data[i]);
     }
     return true;
@@ -194,7 +205,7 @@ class SparsePageLZ4Format : public SparsePageFormat {
             dmlc::SeekStream* fi,
             const std::vector<bst_uint>& sorted_index_set) override {
     if (!fi->Read(&disk_offset_)) return false;
-    this->LoadIndexValue(fi);
+    this->LoadIndexValue(fi, &sorted_index_set);
 
     page->offset.clear();
     page->offset.push_back(0);
@@ -206,7 +217,9 @@ class SparsePageLZ4Format : public SparsePageFormat {
     CHECK_EQ(index_.data.size(), value_.data.size());
     CHECK_EQ(index_.data.size(), disk_offset_.back());
 
-    for (size_t i = 0; i < sorted_index_set.size(); ++i) {
+    const auto ncol = static_cast<bst_omp_uint>(sorted_index_set.size());
+    #pragma omp parallel for schedule(dynamic, 64) num_threads(nthread_)
+    for (bst_omp_uint i = 0; i < ncol; ++i) {
       bst_uint cid = sorted_index_set[i];
       size_t dst_begin = page->offset[i];
       size_t src_begin = disk_offset_[cid];
@@ -247,9 +260,9 @@ class SparsePageLZ4Format : public SparsePageFormat {
     #pragma omp parallel for schedule(dynamic, 1)  num_threads(nthread_write_)
     for (int i = 0; i < ntotal; ++i) {
       if (i < nindex) {
-        index_.Compress(i, use_lz4_hc_);
+        index_.Compress(i, level_);
       } else {
-        value_.Compress(i - nindex, use_lz4_hc_);
+        value_.Compress(i - nindex, level_);
       }
     }
     index_.Write(fo);
@@ -262,16 +275,41 @@ class SparsePageLZ4Format : public SparsePageFormat {
     raw_bytes_ += page.offset.size() * sizeof(size_t);
   }
 
-  inline void LoadIndexValue(dmlc::SeekStream* fi) {
+  // decode the chunks holding the columns of sorted_index_set, or all the
+  // chunks if it is nullptr, the columns outside of them are left undefined
+  inline void LoadIndexValue(dmlc::SeekStream* fi,
+                             const std::vector<bst_uint>* sorted_index_set) {
     fi->Read(&min_index_, sizeof(min_index_));
     index_.Read(fi);
     value_.Read(fi);
 
     int nindex = index_.num_chunk();
     int nvalue = value_.num_chunk();
-    int ntotal = nindex + nvalue;
+    // the index chunks, then the value chunks after nindex
+    std::vector<int> chunks;
+    if (sorted_index_set == nullptr) {
+      for (int i = 0; i < nindex + nvalue; ++i) chunks.push_back(i);
+    } else {
+      std::vector<bool> used(nindex + nvalue, false);
+      for (bst_uint cid : *sorted_index_set) {
+        size_t begin = disk_offset_[cid];
+        size_t end = disk_offset_[cid + 1];
+        if (begin == end) continue;
+        for (int c = index_.ChunkOf(begin); c <= index_.ChunkOf(end - 1); ++c) {
+          used[c] = true;
+        }
+        for (int c = value_.ChunkOf(begin); c <= value_.ChunkOf(end - 1); ++c) {
+          used[nindex + c] = true;
+        }
+      }
+      for (int i = 0; i < nindex + nvalue; ++i) {
+        if (used[i]) chunks.push_back(i);
+      }
+    }
+    int ntotal = static_cast<int>(chunks.size());
     #pragma omp parallel for schedule(dynamic, 1) num_threads(nthread_)
-    for (int i = 0; i < ntotal; ++i) {
+    for (int k = 0; k < ntotal; ++k) {
+      int i = chunks[k];
       if (i < nindex) {
         index_.Decompress(i);
       } else {
@@ -285,8 +323,8 @@ class SparsePageLZ4Format : public SparsePageFormat {
   static const size_t kChunkSize = 64 << 10UL;
   // maximum chunk size.
   static const size_t kMaxChunk = 128;
-  // bool whether use hc
-  bool use_lz4_hc_;
+  // compression level, see CompressArray::Compress
+  int level_;
   // number of threads
   int nthread_;
   // number of writing threads
@@ -308,19 +346,27 @@ class SparsePageLZ4Format : public SparsePageFormat {
 XGBOOST_REGISTER_SPARSE_PAGE_FORMAT(lz4)
 .describe("Apply LZ4 binary data compression for ext memory.")
 .set_body([]() {
-    return new SparsePageLZ4Format<bst_uint>(false);
+    return new SparsePageLZ4Format<bst_uint>(0);
   });
 
 XGBOOST_REGISTER_SPARSE_PAGE_FORMAT(lz4hc)
 .describe("Apply LZ4 binary data compression(high compression ratio) for ext memory.")
 .set_body([]() {
-    return new SparsePageLZ4Format<bst_uint>(true);
+    return new SparsePageLZ4Format<bst_uint>(9);
+  });
+
+XGBOOST_REGISTER_SPARSE_PAGE_FORMAT(lz4fast)
+.describe("Apply LZ4 binary data compression(acceleration XGBOOST_LZ4_ACCELERATION, "
+          "default 8) for ext memory, e.g. for the column pages read every round.")
+.set_body([]() {
+    return new SparsePageLZ4Format<bst_uint>(
+        -std::max(dmlc::GetEnv("XGBOOST_LZ4_ACCELERATION", 8), 1));
   });
 
 XGBOOST_REGISTER_SPARSE_PAGE_FORMAT(lz4i16hc)
 .describe("Apply LZ4 binary data compression(16 bit index mode) for ext memory.")
 .set_body([]() {
-    return new SparsePageLZ4Format<uint16_t>(true);
+    return new SparsePageLZ4Format<uint16_t>(9);
   });
 
 }  // namespace data
@@ -6,9 +6,11 @@ from __future__ import absolute_import
 
 import collections
 import ctypes
+import json
 import os
 import re
 import sys
+import threading
 
 import numpy as np
 import scipy.sparse
@@ -156,7 +158,10 @@ def ctypes2numpy(cptr, length, dtype):
     """
     NUMPY_TO_CTYPES_MAPPING = {
         np.float32: ctypes.c_float,
+        np.int32: ctypes.c_int,
         np.uint32: ctypes.c_uint,
+        np.uint64: ctypes.c_uint64,
+        np.float64: ctypes.c_double,
     }
     if dtype not in NUMPY_TO_CTYPES_MAPPING:
         raise RuntimeError('Supported types: {}'.format(NUMPY_TO_CTYPES_MAPPING.keys()))
@@ -192,12 +197,134 @@ def c_array(ctype, values):
     return (ctype * len(values))(*values)
 
 
+def memory_usage(reset_peak=False):
+    """Bytes held by the major containers of the library.
+
+    Parameters
+    ----------
+    reset_peak : bool
+        Whether the peaks start over from the current bytes after they are read.
+
+    Returns
+    -------
+    usage : dict
+        The current and the peak bytes of each subsystem: ``sparse_page``,
+        ``gradient_index``, ``histogram``, ``host_device_vector`` and
+        ``workspace``, of their ``total`` and the resident set size ``rss`` of
+        the process, e.g. ``usage['histogram']['peak']``.
+    """
+    out = ctypes.c_char_p()
+    _check_call(_LIB.XGBGetMemoryUsage(ctypes.c_int(1 if reset_peak else 0),
+                                       ctypes.byref(out)))
+    return json.loads(py_str(out.value))
+
+
+def set_thread_limit(nthread):
+    """Cap the threads of every training, evaluation and prediction call.
+
+    The ``nthread`` of a booster applies within this limit, whichever thread
+    calls it, e.g. to keep to the cores a host application leaves to the library.
+
+    Parameters
+    ----------
+    nthread : int
+        The most threads of a parallel region, 0 for no limit.
+    """
+    _check_call(_LIB.XGBSetThreadLimit(ctypes.c_int(nthread)))
+
+
+def set_thread_backend(name):
+    """Set where the parallel loops of the library run.
+
+    A loop uses as many threads either way, see :func:`set_thread_limit`;
+    the pool may sum in another order than OpenMP.
+
+    Parameters
+    ----------
+    name : str
+        ``'omp'`` for OpenMP regions of the calling thread, the default, or
+        ``'pool'`` for the persistent pool of the library, which balances
+        its loops by work stealing.
+    """
+    _check_call(_LIB.XGBSetThreadBackend(c_str(name)))
+
+
 PANDAS_DTYPE_MAPPER = {'int8': 'int', 'int16': 'int', 'int32': 'int', 'int64': 'int',
                        'uint8': 'int', 'uint16': 'int', 'uint32': 'int', 'uint64': 'int',
                        'float16': 'float', 'float32': 'float', 'float64': 'float',
                        'bool': 'i'}
 
 
+class _XGBoostBatchCSR(ctypes.Structure):
+    """XGBoostBatchCSR of xgboost/c_api.h, a chunk of rows of a data iterator"""
+    _fields_ = [('size', ctypes.c_size_t),
+                ('offset', ctypes.POINTER(ctypes.c_int64)),
+                ('label', ctypes.POINTER(ctypes.c_float)),
+                ('weight', ctypes.POINTER(ctypes.c_float)),
+                ('index', ctypes.POINTER(ctypes.c_int)),
+                ('value', ctypes.POINTER(ctypes.c_float))]
+
+
+_SET_DATA_FUNC = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, _XGBoostBatchCSR)
+_DATA_ITER_NEXT_FUNC = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p,
+                                        _SET_DATA_FUNC, ctypes.c_void_p)
+_TRAIN_ROUND_FUNC = ctypes.CFUNCTYPE(ctypes.c_int, ctypes.c_void_p, ctypes.c_int,
+                                     ctypes.POINTER(ctypes.c_char_p),
+                                     ctypes.POINTER(ctypes.c_float), c_bst_ulong)
+
+
+def _chunk_to_csr(chunk, missing):
+    """Split a chunk of a data iterator into CSR arrays, label and weight.
+
+    A chunk is a 2-D numpy array or scipy.sparse matrix of rows, or a tuple of
+    it with the labels and optionally the weights of the rows. NaN and missing
+    values of the arrays are dropped, as by DMatrix.
+    """
+    label, weight = None, None
+    if isinstance(chunk, tuple):
+        if len(chunk) not in (2, 3):
+            raise ValueError('a chunk tuple is (data, label) or (data, label, weight)')
+        data, label = chunk[0], chunk[1]
+        if len(chunk) == 3:
+            weight = chunk[2]
+    else:
+        data = chunk
+    if isinstance(data, np.ndarray):
+        if len(data.shape) != 2:
+            raise ValueError('Input numpy.ndarray must be 2 dimensional')
+        mask = ~np.isnan(data)
+        if missing is not None and not np.isnan(missing):
+            mask &= data != missing
+        rows, cols = np.nonzero(mask)
+        value = data[rows, cols]
+        indptr = np.zeros(data.shape[0] + 1, dtype=np.int64)
+        np.cumsum(mask.sum(axis=1), out=indptr[1:])
+        index = cols
+    else:
+        csr = scipy.sparse.csr_matrix(data)
+        csr.sort_indices()
+        indptr, index, value = csr.indptr, csr.indices, csr.data
+        if np.isnan(value).any():
+            keep = ~np.isnan(value)
+            rows = np.repeat(np.arange(csr.shape[0]), np.diff(indptr))
+            counts = np.bincount(rows[keep], minlength=csr.shape[0])
+            indptr = np.zeros(csr.shape[0] + 1, dtype=np.int64)
+            np.cumsum(counts, out=indptr[1:])
+            index, value = index[keep], value[keep]
+    nrow = len(indptr) - 1
+    if label is not None:
+        label = np.ascontiguousarray(label, dtype=np.float32).reshape(-1)
+        if len(label) != nrow:
+            raise ValueError('label of a chunk must have one value per row')
+    if weight is not None:
+        weight = np.ascontiguousarray(weight, dtype=np.float32).reshape(-1)
+        if len(weight) != nrow:
+            raise ValueError('weight of a chunk must have one value per row')
+    return (np.ascontiguousarray(indptr, dtype=np.int64),
+            np.ascontiguousarray(index, dtype=np.int32),
+            np.ascontiguousarray(value, dtype=np.float32), label, weight)
+
+
 def _maybe_pandas_data(data, feature_names, feature_types):
     """ Extract internal data from pd.DataFrame for DMatrix data """
 
@@ -309,14 +436,19 @@ class DMatrix(object):
     def __init__(self, data, label=None, missing=None,
                  weight=None, silent=False,
                  feature_names=None, feature_types=None,
-                 nthread=None):
+                 nthread=None, cache_prefix=None):
         """
         Parameters
         ----------
-        data : string/numpy array/scipy.sparse/pd.DataFrame/DataTable
+        data : string/numpy array/scipy.sparse/pd.DataFrame/DataTable/iterator
             Data source of DMatrix.
             When data is string type, it represents the path libsvm format txt file,
             or binary file that xgboost can read from.
+            When data is an iterator, e.g. a generator, it yields chunks of rows:
+            2-D numpy arrays or scipy.sparse matrices, or tuples of a chunk with
+            its labels and optionally its weights. Each chunk is copied into the
+            DMatrix and released before the next one is taken, so the whole data
+            never has to be in one array.
         label : list or numpy 1-D array, optional
             Label of the training data.
         missing : float, optional
@@ -333,6 +465,9 @@ class DMatrix(object):
         nthread : integer, optional
             Number of threads to use for loading data from numpy array. If -1,
             uses maximum threads available on the system.
+        cache_prefix : string, optional
+            Only used when data is an iterator. The chunks are then written to
+            external memory pages with this prefix instead of kept in memory.
         """
         # force into void_p, mac need to pass things in as void_p
         if data is None:
@@ -363,6 +498,8 @@ class DMatrix(object):
             self._init_from_npy2d(data, missing, nthread)
         elif isinstance(data, DataTable):
             self._init_from_dt(data, nthread)
+        elif hasattr(data, '__next__') or hasattr(data, 'next'):
+            self._init_from_iter(data, missing, cache_prefix)
         else:
             try:
                 csr = scipy.sparse.csr_matrix(data)
@@ -400,6 +537,56 @@ class DMatrix(object):
                                                   ctypes.c_size_t(csr.shape[1]),
                                                   ctypes.byref(self.handle)))
 
+    def _init_from_iter(self, chunks, missing, cache_prefix):
+        """
+        Initialize data from an iterator of chunks of rows, see __init__.
+        """
+        errors = []
+        has_label = []
+
+        def set_batch(set_function, set_handle, chunk):
+            """Hand one chunk to the data holder, which copies it."""
+            indptr, index, value, label, weight = _chunk_to_csr(chunk, missing)
+            has_label.append(label is not None)
+            if any(has_label) != all(has_label):
+                raise ValueError('either all or none of the chunks must have labels')
+            batch = _XGBoostBatchCSR()
+            batch.size = len(indptr) - 1
+            batch.offset = indptr.ctypes.data_as(ctypes.POINTER(ctypes.c_int64))
+            batch.label = (label.ctypes.data_as(ctypes.POINTER(ctypes.c_float))
+                           if label is not None else None)
+            batch.weight = (weight.ctypes.data_as(ctypes.POINTER(ctypes.c_float))
+                            if weight is not None else None)
+            batch.index = index.ctypes.data_as(ctypes.POINTER(ctypes.c_int))
+            batch.value = value.ctypes.data_as(ctypes.POINTER(ctypes.c_float))
+            if set_function(set_handle, batch) != 0:
+                raise XGBoostError(_LIB.XGBGetLastError())
+
+        def next_chunk(_, set_function, set_handle):
+            """Return 1 after setting the next chunk, 0 at the end or on error."""
+            if errors:
+                return 0
+            try:
+                chunk = next(chunks)
+            except StopIteration:
+                return 0
+            try:
+                set_batch(set_function, set_handle, chunk)
+            except Exception as e:  # pylint: disable=broad-except
+                errors.append(e)
+                return 0
+            return 1
+
+        callback = _DATA_ITER_NEXT_FUNC(next_chunk)
+        handle = ctypes.c_void_p()
+        cache_info = c_str(cache_prefix) if cache_prefix is not None else None
+        _check_call(_LIB.XGDMatrixCreateFromDataIter(None, callback, cache_info,
+                                                     ctypes.byref(handle)))
+        if errors:
+            _check_call(_LIB.XGDMatrixFree(handle))
+            raise errors[0]
+        self.handle = handle
+
     def _init_from_csc(self, csc):
         """
         Initialize data from a CSC matrix.
@@ -407,6 +594,16 @@ class DMatrix(object):
         if len(csc.indices) != len(csc.data):
             raise ValueError('length mismatch: {} vs {}'.format(len(csc.indices), len(csc.data)))
         self.handle = ctypes.c_void_p()
+        if csc.shape[0] > 0xffffffff:
+            # row indices past 32 bits
+            _check_call(_LIB.XGDMatrixCreateFromCSCEx64(c_array(ctypes.c_size_t, csc.indptr),
+                                                        c_array(ctypes.c_uint64, csc.indices),
+                                                        c_array(ctypes.c_float, csc.data),
+                                                        ctypes.c_size_t(len(csc.indptr)),
+                                                        ctypes.c_size_t(len(csc.data)),
+                                                        ctypes.c_size_t(csc.shape[0]),
+                                                        ctypes.byref(self.handle)))
+            return
         _check_call(_LIB.XGDMatrixCreateFromCSCEx(c_array(ctypes.c_size_t, csc.indptr),
                                                   c_array(ctypes.c_uint, csc.indices),
                                                   c_array(ctypes.c_float, csc.data),
@@ -580,6 +777,10 @@ class DMatrix(object):
     def save_binary(self, fname, silent=True):
         """Save DMatrix to an XGBoost buffer.
 
+        If the matrix was already used by the exact or robust_exact tree methods,
+        its sorted columns are saved too, and training on the loaded buffer
+        skips the transpose and sort of the columns.
+
         Parameters
         ----------
         fname : string
@@ -688,6 +889,40 @@ class DMatrix(object):
         """
         return self.get_float_info('base_margin')
 
+    def append(self, data, label=None, weight=None, missing=None):
+        """Append rows after the last row of the DMatrix.
+
+        The sorted columns and the histogram indices built on the DMatrix take
+        the new rows without being built again, see XGDMatrixAppendCSR.
+
+        Parameters
+        ----------
+        data : numpy array/scipy.sparse
+            The rows to append.
+        label : list or numpy 1-D array, optional
+            Labels of the rows, needed iff the DMatrix has labels.
+        weight : list or numpy 1-D array, optional
+            Weights of the rows, needed iff the DMatrix has weights.
+        missing : float, optional
+            Value in numpy arrays to treat as missing. If None, defaults to np.nan.
+        """
+        if label is None:
+            if weight is not None:
+                raise ValueError('weights of appended rows need their labels')
+            chunk = data
+        else:
+            chunk = (data, label) if weight is None else (data, label, weight)
+        indptr, index, value, label, weight = _chunk_to_csr(chunk, missing)
+        _check_call(_LIB.XGDMatrixAppendCSR(
+            self.handle,
+            c_array(ctypes.c_size_t, indptr),
+            c_array(ctypes.c_uint, index),
+            value.ctypes.data_as(ctypes.POINTER(ctypes.c_float)),
+            ctypes.c_size_t(len(indptr)),
+            ctypes.c_size_t(len(value)),
+            label.ctypes.data_as(ctypes.POINTER(ctypes.c_float)) if label is not None else None,
+            weight.ctypes.data_as(ctypes.POINTER(ctypes.c_float)) if weight is not None else None))
+
     def num_row(self):
         """Get the number of rows in the DMatrix.
 
@@ -733,6 +968,26 @@ class DMatrix(object):
                                                ctypes.byref(res.handle)))
         return res
 
+    def merge_duplicate_rows(self):
+        """Merge the rows with the same features, label and base margin into
+        one row, whose weight is the sum of their weights.
+
+        Training on the merged DMatrix grows the same trees with the exact
+        methods, from fewer entries. Evaluate on the original DMatrix: the
+        rows of the merged one are not those of the data.
+
+        Returns
+        -------
+        res : DMatrix
+            A new DMatrix with one row for each set of duplicate rows.
+        """
+        res = DMatrix(None, feature_names=self.feature_names)
+        res.handle = ctypes.c_void_p()
+        _check_call(_LIB.XGDMatrixMergeDuplicateRows(self.handle,
+                                                     ctypes.byref(res.handle),
+                                                     None))
+        return res
+
     @property
     def feature_names(self):
         """Get feature names (column labels).
@@ -910,22 +1165,43 @@ class Booster(object):
         """
         return self.__copy__()
 
-    def load_rabit_checkpoint(self):
+    def load_rabit_checkpoint(self, dtrain=None):
         """Initialize the model by load from rabit checkpoint.
 
+        Parameters
+        ----------
+        dtrain : DMatrix, optional
+            The training data of this worker, for checkpoints saved with it.
+            Its margins are restored with the model.
+
         Returns
         -------
         version: integer
             The version number of the model.
         """
         version = ctypes.c_int()
-        _check_call(_LIB.XGBoosterLoadRabitCheckpoint(
-            self.handle, ctypes.byref(version)))
+        if dtrain is None:
+            _check_call(_LIB.XGBoosterLoadRabitCheckpoint(
+                self.handle, ctypes.byref(version)))
+        else:
+            _check_call(_LIB.XGBoosterLoadRabitCheckpointWithState(
+                self.handle, dtrain.handle, ctypes.byref(version)))
         return version.value
 
-    def save_rabit_checkpoint(self):
-        """Save the current booster to rabit checkpoint."""
-        _check_call(_LIB.XGBoosterSaveRabitCheckpoint(self.handle))
+    def save_rabit_checkpoint(self, dtrain=None):
+        """Save the current booster to rabit checkpoint.
+
+        Parameters
+        ----------
+        dtrain : DMatrix, optional
+            The training data of this worker. Its margins and the random state
+            are saved as the local checkpoint of the worker.
+        """
+        if dtrain is None:
+            _check_call(_LIB.XGBoosterSaveRabitCheckpoint(self.handle))
+        else:
+            _check_call(_LIB.XGBoosterSaveRabitCheckpointWithState(
+                self.handle, dtrain.handle))
 
     def attr(self, key):
         """Get attribute string from the Booster.
@@ -1048,6 +1324,79 @@ class Booster(object):
                                                c_array(ctypes.c_float, hess),
                                                c_bst_ulong(len(grad))))
 
+    def train_native(self, dtrain, num_boost_round, evals=(), begin_iteration=0,
+                     early_stopping_rounds=0, maximize=False, checkpoint_interval=0,
+                     callback=None):
+        """Train rounds [begin_iteration, num_boost_round) in the loop of the library.
+
+        Each round does what ``update`` and ``eval_set`` do, without the evaluation
+        string and its parsing.
+
+        Parameters
+        ----------
+        dtrain : DMatrix
+            The training DMatrix.
+        num_boost_round : int
+            End of the rounds.
+        evals : list of tuples (DMatrix, string)
+            List of items to be evaluated after each round.
+        begin_iteration : int
+            First round.
+        early_stopping_rounds : int
+            Stop when the last metric on the last item of evals did not improve for this
+            many rounds, 0 to train all rounds. The best value and its round are kept in
+            the attributes ``best_score`` and ``best_iteration``.
+        maximize : bool
+            Whether the metric of early stopping is maximized, auc, map and ndcg always are.
+        checkpoint_interval : int
+            Save a rabit checkpoint every this many rounds, 0 for none. The booster then
+            first resumes from the last checkpoint.
+        callback : function
+            ``callback(iteration, evaluation_result_list)`` after each round, with a list
+            of (name, value) as in CallbackEnv. Training stops after the round when it
+            returns True.
+
+        Returns
+        -------
+        num_round : int
+            End of the rounds trained.
+        """
+        if not isinstance(dtrain, DMatrix):
+            raise TypeError('invalid training matrix: {}'.format(type(dtrain).__name__))
+        self._validate_features(dtrain)
+        for d in evals:
+            if not isinstance(d[0], DMatrix):
+                raise TypeError('expected DMatrix, got {}'.format(type(d[0]).__name__))
+            self._validate_features(d[0])
+        errors = []
+
+        def after_round(_, iteration, names, values, length):
+            """Return 1 to stop training."""
+            if callback is None:
+                return 0
+            try:
+                result = [(py_str(names[i]), float(values[i])) for i in range(length)]
+                return 1 if callback(iteration, result) else 0
+            except Exception as e:  # pylint: disable=broad-except
+                errors.append(e)
+                return 1
+
+        func = _TRAIN_ROUND_FUNC(after_round)
+        dmats = c_array(ctypes.c_void_p, [d[0].handle for d in evals])
+        evnames = c_array(ctypes.c_char_p, [c_str(d[1]) for d in evals])
+        num_round = ctypes.c_int()
+        _check_call(_LIB.XGBoosterTrain(self.handle, dtrain.handle,
+                                        ctypes.c_int(begin_iteration),
+                                        ctypes.c_int(num_boost_round),
+                                        dmats, evnames, c_bst_ulong(len(evals)),
+                                        ctypes.c_int(early_stopping_rounds or 0),
+                                        ctypes.c_int(1 if maximize else 0),
+                                        ctypes.c_int(checkpoint_interval),
+                                        func, None, ctypes.byref(num_round)))
+        if errors:
+            raise errors[0]
+        return num_round.value
+
     def eval_set(self, evals, iteration=0, feval=None):
         # pylint: disable=invalid-name
         """Evaluate a set of data.
@@ -1223,6 +1572,405 @@ class Booster(object):
                 preds = preds.reshape(nrow, chunk_size)
         return preds
 
+    def predict_staged(self, data, stride, output_margin=False, ntree_limit=0):
+        """
+        Predict after every ``stride`` rounds of trees.
+
+        Stage ``s`` is the prediction of ``predict()`` with
+        ``ntree_limit=(s + 1) * stride``, the last stage that of all the rounds
+        of ``ntree_limit``. Each row is walked through the trees once, instead
+        of once per call of ``predict()``.
+
+        .. note:: This function is not thread safe, see ``predict()``.
+
+          Only booster=gbtree is supported.
+
+        Parameters
+        ----------
+        data : DMatrix
+            The dmatrix storing the input.
+
+        stride : int
+            Number of rounds of trees between two stages.
+
+        output_margin : bool
+            Whether to output the raw untransformed margin value.
+
+        ntree_limit : int
+            Limit number of trees in the prediction; defaults to 0 (use all trees).
+
+        Returns
+        -------
+        prediction : numpy array
+            Of shape (nrow, num_stage), or (nrow, num_stage, num_class) for
+            several output groups.
+        """
+        if stride < 1:
+            raise ValueError('stride must be at least 1')
+        option_mask = 0x01 if output_margin else 0x00
+        num_stage = c_bst_ulong()
+        length = c_bst_ulong()
+        preds = ctypes.POINTER(ctypes.c_float)()
+        _check_call(_LIB.XGBoosterPredictStaged(self.handle, data.handle,
+                                                ctypes.c_int(option_mask),
+                                                ctypes.c_uint(stride),
+                                                ctypes.c_uint(ntree_limit),
+                                                ctypes.byref(num_stage),
+                                                ctypes.byref(length),
+                                                ctypes.byref(preds)))
+        preds = ctypes2numpy(preds, length.value, np.float32)
+        nrow = data.num_row()
+        if nrow == 0 or num_stage.value == 0:
+            return preds.reshape(nrow, num_stage.value)
+        ngroup = preds.size // (nrow * num_stage.value)
+        if ngroup == 1:
+            return preds.reshape(nrow, num_stage.value)
+        return preds.reshape(nrow, num_stage.value, ngroup)
+
+    def predict_leaf_index(self, data, ntree_limit=0, one_hot=False):
+        """
+        Predict the leaf of each tree as integers.
+
+        Unlike ``predict(pred_leaf=True)``, the indices are written straight
+        into an array of uint16, when every index fits, or of uint32.
+
+        .. note:: This function is not thread safe, see ``predict()``.
+
+          Only booster=gbtree is supported.
+
+        Parameters
+        ----------
+        data : DMatrix
+            The dmatrix storing the input.
+
+        ntree_limit : int
+            Limit number of trees in the prediction; defaults to 0 (use all trees).
+
+        one_hot : bool
+            Return the one-hot encoding of the leaves of all the trees instead
+            of their node ids.
+
+        Returns
+        -------
+        prediction : numpy array or scipy.sparse.csr_matrix
+            The node ids of shape (nrow, ntree), or with one_hot a CSR matrix
+            of ones with one column per leaf of the trees.
+        """
+        index_size = ctypes.c_int()
+        num_index = c_bst_ulong()
+        length = c_bst_ulong()
+        _check_call(_LIB.XGBoosterPredictLeafIndex(self.handle, data.handle,
+                                                   ctypes.c_uint(ntree_limit),
+                                                   ctypes.c_int(1 if one_hot else 0),
+                                                   ctypes.byref(index_size),
+                                                   ctypes.byref(num_index),
+                                                   c_bst_ulong(0), None,
+                                                   ctypes.byref(length)))
+        dtype = np.uint16 if index_size.value == 2 else np.uint32
+        index = np.empty(length.value, dtype=dtype)
+        _check_call(_LIB.XGBoosterPredictLeafIndex(self.handle, data.handle,
+                                                   ctypes.c_uint(ntree_limit),
+                                                   ctypes.c_int(1 if one_hot else 0),
+                                                   ctypes.byref(index_size),
+                                                   ctypes.byref(num_index),
+                                                   c_bst_ulong(index.size),
+                                                   index.ctypes.data_as(ctypes.c_void_p),
+                                                   ctypes.byref(length)))
+        nrow = data.num_row()
+        ntree = index.size // nrow if nrow != 0 else 0
+        if not one_hot:
+            return index.reshape(nrow, ntree)
+        indptr = np.arange(nrow + 1, dtype=np.int64) * ntree
+        return scipy.sparse.csr_matrix((np.ones(index.size, dtype=np.float32), index, indptr),
+                                       shape=(nrow, num_index.value))
+
+    def inplace_predict(self, data, output_margin=False, ntree_limit=0, missing=None):
+        """
+        Predict directly from a numpy array or a scipy CSR matrix, without building a DMatrix.
+
+        The buffers of ``data`` are read in place during the call and are not kept
+        afterwards, so this is much cheaper than ``predict()`` for a few rows at a time.
+        Arrays of another dtype or memory layout are converted first.
+
+        .. note:: This function is not thread safe, see ``predict()``.
+
+          Only booster=gbtree is supported.
+
+        Parameters
+        ----------
+        data : numpy array or scipy.sparse.csr_matrix
+            A 2D array (or a single row as a 1D array) of the rows to predict.
+
+        output_margin : bool
+            Whether to output the raw untransformed margin value.
+
+        ntree_limit : int
+            Limit number of trees in the prediction; defaults to 0 (use all trees).
+
+        missing : float, optional
+            Value in a numpy array to treat as missing. If None, defaults to np.nan.
+            The entries not stored in a CSR matrix are missing, as in ``DMatrix``.
+
+        Returns
+        -------
+        prediction : numpy array
+        """
+        option_mask = 0x01 if output_margin else 0x00
+        if isinstance(data, scipy.sparse.csr_matrix):
+            nrow = data.shape[0]
+            # the local references keep the buffers alive during the call
+            indptr = np.ascontiguousarray(data.indptr, dtype=np.uintp)
+            indices = np.ascontiguousarray(data.indices, dtype=np.uint32)
+            values = np.ascontiguousarray(data.data, dtype=np.float32)
+            args = [indptr.ctypes.data_as(ctypes.POINTER(ctypes.c_size_t)),
+                    indices.ctypes.data_as(ctypes.POINTER(ctypes.c_uint)),
+                    values.ctypes.data_as(ctypes.POINTER(ctypes.c_float)),
+                    ctypes.c_size_t(len(indptr)),
+                    ctypes.c_size_t(len(values))]
+            predict_func = _LIB.XGBoosterPredictFromCSR
+        elif isinstance(data, np.ndarray):
+            if data.ndim == 1:
+                data = data.reshape(1, -1)
+            if data.ndim != 2:
+                raise ValueError('Input numpy.ndarray must be 1 or 2 dimensional')
+            nrow = data.shape[0]
+            mat = np.ascontiguousarray(data, dtype=np.float32)
+            missing = missing if missing is not None else np.nan
+            args = [mat.ctypes.data_as(ctypes.POINTER(ctypes.c_float)),
+                    c_bst_ulong(mat.shape[0]),
+                    c_bst_ulong(mat.shape[1]),
+                    ctypes.c_float(missing)]
+            predict_func = _LIB.XGBoosterPredictFromDense
+        else:
+            raise TypeError('inplace_predict only supports numpy.ndarray and '
+                            'scipy.sparse.csr_matrix, got {}'.format(type(data).__name__))
+        args += [ctypes.c_int(option_mask), ctypes.c_uint(ntree_limit)]
+        # query the size of the output, then predict into a numpy buffer
+        length = c_bst_ulong()
+        _check_call(predict_func(self.handle, *(args + [c_bst_ulong(0), None,
+                                                        ctypes.byref(length)])))
+        preds = np.empty(length.value, dtype=np.float32)
+        _check_call(predict_func(self.handle,
+                                 *(args + [c_bst_ulong(preds.size),
+                                           preds.ctypes.data_as(ctypes.POINTER(ctypes.c_float)),
+                                           ctypes.byref(length)])))
+        preds = preds[:length.value]
+        if nrow != 0 and preds.size != nrow and preds.size % nrow == 0:
+            preds = preds.reshape(nrow, preds.size // nrow)
+        return preds
+
+    def predict_chunked(self, data, chunk_size=65536, output_margin=False, ntree_limit=0,
+                        pred_leaf=False, missing=None, nthread=None, overlap=True):
+        """
+        Predict the rows of ``data`` a window of ``chunk_size`` rows at a time.
+
+        Only the DMatrix of one window, or of two with ``overlap``, is alive at
+        once, and the predictions are written into one output array sized after
+        the first window, so the memory beyond the output is bounded by the
+        windows instead of the whole input. The result is that of ``predict()``
+        on a DMatrix of all the rows.
+
+        .. note:: This function is not thread safe, see ``predict()``.
+
+        Parameters
+        ----------
+        data : numpy array/scipy.sparse.csr_matrix/pd.DataFrame
+            The rows to predict.
+        chunk_size : int
+            Number of rows of a window.
+        output_margin : bool
+            Whether to output the raw untransformed margin value.
+        ntree_limit : int
+            Limit number of trees in the prediction; defaults to 0 (use all trees).
+        pred_leaf : bool
+            When this option is on, the output is the leaf index of each tree.
+        missing : float, optional
+            Value in the data to treat as missing. If None, defaults to np.nan.
+        nthread : integer, optional
+            Number of threads to build the DMatrix of a window.
+        overlap : bool
+            Whether to build the DMatrix of the next window in a background
+            thread while the current window is predicted.
+
+        Returns
+        -------
+        prediction : numpy array
+        """
+        if chunk_size <= 0:
+            raise ValueError('chunk_size must be positive')
+        if scipy.sparse.issparse(data) and not isinstance(data, scipy.sparse.csr_matrix):
+            data = scipy.sparse.csr_matrix(data)
+        nrow = data.shape[0]
+        def window(begin):
+            """The rows of the window at begin."""
+            if isinstance(data, DataFrame):
+                return data.iloc[begin:begin + chunk_size]
+            return data[begin:begin + chunk_size]
+
+        def make_dmatrix(begin, out):
+            """Build the DMatrix of the window at begin into out[0], or its error."""
+            try:
+                out[0] = DMatrix(window(begin), missing=missing, nthread=nthread)
+            except Exception as e:  # pylint: disable=broad-except
+                out[1] = e
+
+        preds = None
+        pending = [None, None]
+        make_dmatrix(0, pending)
+        begin = 0
+        while True:
+            if pending[1] is not None:
+                raise pending[1]
+            dmat, pending[0] = pending[0], None
+            following, worker = [None, None], None
+            if begin + chunk_size < nrow:
+                if overlap:
+                    worker = threading.Thread(target=make_dmatrix,
+                                              args=(begin + chunk_size, following))
+                    worker.start()
+            try:
+                chunk = self.predict(dmat, output_margin=output_margin,
+                                     ntree_limit=ntree_limit, pred_leaf=pred_leaf)
+            finally:
+                if worker is not None:
+                    worker.join()
+            del dmat
+            if preds is None:
+                preds = np.empty((nrow,) + chunk.shape[1:], dtype=chunk.dtype)
+            preds[begin:begin + chunk.shape[0]] = chunk
+            begin += chunk_size
+            if begin >= nrow:
+                break
+            if worker is None:
+                make_dmatrix(begin, following)
+            pending = following
+        return preds
+
+    def get_threshold_index(self):
+        """Get the split thresholds of every feature over the trees of the model.
+
+        Returns
+        -------
+        feature_ptr : numpy array
+            The thresholds of feature f are thresholds[feature_ptr[f]:feature_ptr[f + 1]].
+        thresholds : numpy array
+            Sorted unique thresholds of each feature.
+        node_ptr : numpy array
+            The nodes splitting on thresholds[i] are nodes[node_ptr[i]:node_ptr[i + 1]].
+        nodes : numpy array
+            (tree index, node id) pairs of shape (num_node, 2).
+        """
+        num_feature = c_bst_ulong()
+        feature_ptr = ctypes.POINTER(ctypes.c_uint64)()
+        thresholds = ctypes.POINTER(ctypes.c_float)()
+        node_ptr = ctypes.POINTER(ctypes.c_uint64)()
+        nodes = ctypes.POINTER(ctypes.c_uint)()
+        _check_call(_LIB.XGBoosterGetThresholdIndex(self.handle,
+                                                    ctypes.byref(num_feature),
+                                                    ctypes.byref(feature_ptr),
+                                                    ctypes.byref(thresholds),
+                                                    ctypes.byref(node_ptr),
+                                                    ctypes.byref(nodes)))
+        feature_ptr = ctypes2numpy(feature_ptr, num_feature.value + 1, np.uint64)
+        num_threshold = int(feature_ptr[-1])
+        thresholds = ctypes2numpy(thresholds, num_threshold, np.float32)
+        node_ptr = ctypes2numpy(node_ptr, num_threshold + 1, np.uint64)
+        nodes = ctypes2numpy(nodes, 2 * int(node_ptr[-1]), np.uint32).reshape(-1, 2)
+        return feature_ptr, thresholds, node_ptr, nodes
+
+    def export_trees(self):
+        """Export the node arrays of all trees, without the text dump.
+
+        The nodes of tree t are [tree_ptr[t], tree_ptr[t + 1]) of every node
+        array, indexed by their node id.
+
+        Returns
+        -------
+        trees : dict of numpy arrays
+            tree_ptr, tree_group, split_index, split_cond, left_child,
+            right_child, default_left, leaf_value and cover. split_index,
+            left_child and right_child are -1 for leaves.
+        """
+        num_tree = c_bst_ulong()
+        fields = [('tree_ptr', ctypes.c_uint64, np.uint64),
+                  ('tree_group', ctypes.c_int, np.int32),
+                  ('split_index', ctypes.c_int, np.int32),
+                  ('split_cond', ctypes.c_float, np.float32),
+                  ('left_child', ctypes.c_int, np.int32),
+                  ('right_child', ctypes.c_int, np.int32),
+                  ('default_left', ctypes.c_int, np.int32),
+                  ('leaf_value', ctypes.c_float, np.float32),
+                  ('cover', ctypes.c_float, np.float32)]
+        ptrs = [ctypes.POINTER(ctype)() for _, ctype, _ in fields]
+        _check_call(_LIB.XGBoosterExportTrees(self.handle, ctypes.byref(num_tree),
+                                              *[ctypes.byref(ptr) for ptr in ptrs]))
+        tree_ptr = ctypes2numpy(ptrs[0], num_tree.value + 1, np.uint64)
+        trees = {'tree_ptr': tree_ptr,
+                 'tree_group': ctypes2numpy(ptrs[1], num_tree.value, np.int32)}
+        num_node = int(tree_ptr[-1])
+        for (name, _, dtype), ptr in zip(fields[2:], ptrs[2:]):
+            trees[name] = ctypes2numpy(ptr, num_node, dtype)
+        return trees
+
+    def export_milp(self, data, row, eps=0.0, target=-1, fmt='mps'):
+        """Write the MILP of the minimal adversarial perturbation of a row.
+
+        The formulation is that of xgbKantchelianAttack.py, with the leaves and
+        the predicates that the L-inf box of radius eps cannot reach pruned.
+        Gurobi and most other solvers read the result from a .mps or .lp file.
+
+        Parameters
+        ----------
+        data : DMatrix
+            The points, the labels are the true classes.
+        row : int
+            The row attacked.
+        eps : float
+            Radius of the box the adversarial point is searched in, 0 for no box.
+        target : int
+            The class the row is moved to for multiclass models.
+        fmt : str
+            'mps' or 'lp'.
+
+        Returns
+        -------
+        model : str
+        """
+        if not isinstance(data, DMatrix):
+            raise TypeError('data needs to be a DMatrix, got {}'.format(type(data).__name__))
+        ret = ctypes.c_char_p()
+        _check_call(_LIB.XGBoosterExportMilp(self.handle, data.handle,
+                                             c_bst_ulong(row), ctypes.c_int(target),
+                                             ctypes.c_float(eps), c_str(fmt),
+                                             ctypes.byref(ret)))
+        return py_str(ret.value)
+
+    def compact(self, fold='none'):
+        """Compact the trees of the model in place for serving.
+
+        The sibling leaves of the same output are merged and the nodes are
+        renumbered, which keeps the margins bit-identical.
+
+        Parameters
+        ----------
+        fold : str
+            'identical' or 'structure' also fold each tree into an earlier tree
+            of the same output group and the same splits by summing their leaf
+            values. The margins then only agree up to float rounding, and
+            ntree_limit no longer counts rounds.
+
+        Returns
+        -------
+        num_tree, num_node : int
+            Number of trees and of nodes of the compacted model.
+        """
+        num_tree = c_bst_ulong()
+        num_node = c_bst_ulong()
+        _check_call(_LIB.XGBoosterCompactModel(self.handle, c_str(fold),
+                                               ctypes.byref(num_tree),
+                                               ctypes.byref(num_node)))
+        return num_tree.value, num_node.value
+
     def save_model(self, fname):
         """
         Save the model to a file.
@@ -1355,6 +2103,30 @@ class Booster(object):
 
         return self.get_score(fmap, importance_type='weight')
 
+    def feature_importance(self):
+        """Get the split statistics of each feature, without dumping the model.
+
+        They are summed as the trees are added. Only booster=gbtree is supported.
+
+        Returns
+        -------
+        importance : dict of numpy arrays
+            'weight', the number of splits of each feature, 'total_gain', the
+            sum of their loss change, and 'total_cover', the sum of the hessian
+            of the data reaching them, indexed by the feature.
+        """
+        length = c_bst_ulong()
+        gain = ctypes.POINTER(ctypes.c_double)()
+        cover = ctypes.POINTER(ctypes.c_double)()
+        count = ctypes.POINTER(ctypes.c_uint64)()
+        _check_call(_LIB.XGBoosterGetFeatureImportance(self.handle, ctypes.byref(length),
+                                                       ctypes.byref(gain),
+                                                       ctypes.byref(cover),
+                                                       ctypes.byref(count)))
+        return {'weight': ctypes2numpy(count, length.value, np.uint64),
+                'total_gain': ctypes2numpy(gain, length.value, np.float64),
+                'total_cover': ctypes2numpy(cover, length.value, np.float64)}
+
     def get_score(self, fmap='', importance_type='weight'):
         """Get feature importance of each feature.
         Importance type can be defined as:
@@ -1378,6 +2150,27 @@ class Booster(object):
                    repr(allowed_importance_types))
             raise ValueError(msg.format(importance_type))
 
+        if fmap == '':
+            try:
+                importance = self.feature_importance()
+            except XGBoostError:
+                # boosters without a tree model, e.g. dart, are dumped
+                importance = None
+            if importance is not None:
+                count = importance['weight']
+                if importance_type == 'weight':
+                    values = count
+                elif importance_type.startswith('total_'):
+                    values = importance[importance_type]
+                else:
+                    values = importance['total_' + importance_type] / np.maximum(count, 1)
+                names = self.feature_names
+                if names is not None and len(names) < len(count):
+                    names = None
+                return {(names[i] if names is not None else 'f{0}'.format(i)):
+                        (int(values[i]) if importance_type == 'weight' else float(values[i]))
+                        for i in np.flatnonzero(count)}
+
         # if it's weight, then omap stores the number of missing values
         if importance_type == 'weight':
             # do a simpler tree dump to save time
@@ -335,18 +335,32 @@ class XGBModel(XGBModelBase):
             self.best_ntree_limit = self._Booster.best_ntree_limit
         return self
 
-    def predict(self, data, output_margin=False, ntree_limit=None):
-        # pylint: disable=missing-docstring,invalid-name
+    def _predict_booster(self, data, output_margin=False, ntree_limit=0, pred_leaf=False,
+                         chunk_size=None):
+        """Predict data with the booster, in windows of chunk_size rows if not None."""
+        if chunk_size is not None:
+            return self.get_booster().predict_chunked(data, chunk_size=chunk_size,
+                                                      output_margin=output_margin,
+                                                      ntree_limit=ntree_limit,
+                                                      pred_leaf=pred_leaf,
+                                                      missing=self.missing,
+                                                      nthread=self.n_jobs)
         test_dmatrix = DMatrix(data, missing=self.missing, nthread=self.n_jobs)
+        return self.get_booster().predict(test_dmatrix,
+                                          output_margin=output_margin,
+                                          ntree_limit=ntree_limit,
+                                          pred_leaf=pred_leaf)
+
+    def predict(self, data, output_margin=False, ntree_limit=None, chunk_size=None):
+        # pylint: disable=missing-docstring,invalid-name
         # get ntree_limit to use - if none specified, default to
         # best_ntree_limit if defined, otherwise 0.
         if ntree_limit is None:
             ntree_limit = getattr(self, "best_ntree_limit", 0)
-        return self.get_booster().predict(test_dmatrix,
-                                          output_margin=output_margin,
-                                          ntree_limit=ntree_limit)
+        return self._predict_booster(data, output_margin=output_margin,
+                                     ntree_limit=ntree_limit, chunk_size=chunk_size)
 
-    def apply(self, X, ntree_limit=0):
+    def apply(self, X, ntree_limit=0, chunk_size=None):
         """Return the predicted leaf every tree for each sample.
 
         Parameters
@@ -357,6 +371,9 @@ class XGBModel(XGBModelBase):
         ntree_limit : int
             Limit number of trees in the prediction; defaults to 0 (use all trees).
 
+        chunk_size : int, optional
+            Predict X in windows of chunk_size rows, see ``Booster.predict_chunked``.
+
         Returns
         -------
         X_leaves : array_like, shape=[n_samples, n_trees]
@@ -364,10 +381,8 @@ class XGBModel(XGBModelBase):
             leaf x ends up in. Leaves are numbered within
             ``[0; 2**(self.max_depth+1))``, possibly with gaps in the numbering.
         """
-        test_dmatrix = DMatrix(X, missing=self.missing, nthread=self.n_jobs)
-        return self.get_booster().predict(test_dmatrix,
-                                          pred_leaf=True,
-                                          ntree_limit=ntree_limit)
+        return self._predict_booster(X, pred_leaf=True, ntree_limit=ntree_limit,
+                                     chunk_size=chunk_size)
 
     def evals_result(self):
         """Return the evaluation results.
@@ -560,7 +575,7 @@ class XGBClassifier(XGBModel, XGBClassifierBase):
 
         return self
 
-    def predict(self, data, output_margin=False, ntree_limit=None):
+    def predict(self, data, output_margin=False, ntree_limit=None, chunk_size=None):
         """
         Predict with `data`.
 
@@ -590,16 +605,17 @@ class XGBClassifier(XGBModel, XGBClassifierBase):
         ntree_limit : int
             Limit number of trees in the prediction; defaults to best_ntree_limit if defined
             (i.e. it has been trained with early stopping), otherwise 0 (use all trees).
+        chunk_size : int, optional
+            Predict data in windows of chunk_size rows, so that the DMatrix of all
+            the rows is never built, see ``Booster.predict_chunked``.
         Returns
         -------
         prediction : numpy array
         """
-        test_dmatrix = DMatrix(data, missing=self.missing, nthread=self.n_jobs)
         if ntree_limit is None:
             ntree_limit = getattr(self, "best_ntree_limit", 0)
-        class_probs = self.get_booster().predict(test_dmatrix,
-                                                 output_margin=output_margin,
-                                                 ntree_limit=ntree_limit)
+        class_probs = self._predict_booster(data, output_margin=output_margin,
+                                            ntree_limit=ntree_limit, chunk_size=chunk_size)
         if len(class_probs.shape) > 1:
             column_indexes = np.argmax(class_probs, axis=1)
         else:
@@ -607,7 +623,7 @@ class XGBClassifier(XGBModel, XGBClassifierBase):
             column_indexes[class_probs > 0.5] = 1
         return self._le.inverse_transform(column_indexes)
 
-    def predict_proba(self, data, ntree_limit=None):
+    def predict_proba(self, data, ntree_limit=None, chunk_size=None):
         """
         Predict the probability of each `data` example being of a given class.
         NOTE: This function is not thread safe.
@@ -621,22 +637,26 @@ class XGBClassifier(XGBModel, XGBClassifierBase):
         ntree_limit : int
             Limit number of trees in the prediction; defaults to best_ntree_limit if defined
             (i.e. it has been trained with early stopping), otherwise 0 (use all trees).
+        chunk_size : int, optional
+            Predict data in windows of chunk_size rows, so that the DMatrix of all
+            the rows is never built, see ``Booster.predict_chunked``.
         Returns
         -------
         prediction : numpy array
             a numpy array with the probability of each data example being of a given class.
         """
-        test_dmatrix = DMatrix(data, missing=self.missing, nthread=self.n_jobs)
         if ntree_limit is None:
             ntree_limit = getattr(self, "best_ntree_limit", 0)
-        class_probs = self.get_booster().predict(test_dmatrix,
-                                                 ntree_limit=ntree_limit)
+        class_probs = self._predict_booster(data, ntree_limit=ntree_limit,
+                                            chunk_size=chunk_size)
         if self.objective == "multi:softprob":
             return class_probs
         else:
-            classone_probs = class_probs
-            classzero_probs = 1.0 - classone_probs
-            return np.vstack((classzero_probs, classone_probs)).transpose()
+            # filled in place, without the temporaries of a stack and transpose
+            probs = np.empty((class_probs.shape[0], 2), dtype=class_probs.dtype)
+            probs[:, 1] = class_probs
+            np.subtract(1.0, class_probs, out=probs[:, 0])
+            return probs
 
     def evals_result(self):
         """Return the evaluation results.
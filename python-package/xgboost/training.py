@@ -12,13 +12,8 @@ from . import rabit
 from . import callback
 
 
-def _train_internal(params, dtrain,
-                    num_boost_round=10, evals=(),
-                    obj=None, feval=None,
-                    xgb_model=None, callbacks=None):
-    """internal training function"""
-    callbacks = [] if callbacks is None else callbacks
-    evals = list(evals)
+def _init_booster(params, dtrain, evals, xgb_model):
+    """the booster to train, its number of rounds trained and of parallel trees"""
     if isinstance(params, dict) \
             and 'eval_metric' in params \
             and isinstance(params['eval_metric'], list):
@@ -46,9 +41,32 @@ def _train_internal(params, dtrain,
         nboost //= num_parallel_tree
     if 'num_class' in _params:
         nboost //= _params['num_class']
+    return bst, nboost, num_parallel_tree
+
 
-    # Distributed code: Load the checkpoint from rabit.
-    version = bst.load_rabit_checkpoint()
+def _set_best_iteration(bst, nboost, num_parallel_tree):
+    """set the best round of bst from its attributes, its last round otherwise"""
+    if bst.attr('best_score') is not None:
+        bst.best_score = float(bst.attr('best_score'))
+        bst.best_iteration = int(bst.attr('best_iteration'))
+    else:
+        bst.best_iteration = nboost - 1
+    bst.best_ntree_limit = (bst.best_iteration + 1) * num_parallel_tree
+
+
+def _train_internal(params, dtrain,
+                    num_boost_round=10, evals=(),
+                    obj=None, feval=None,
+                    xgb_model=None, callbacks=None):
+    """internal training function"""
+    callbacks = [] if callbacks is None else callbacks
+    evals = list(evals)
+    bst, nboost, num_parallel_tree = _init_booster(params, dtrain, evals, xgb_model)
+
+    # Distributed code: Load the checkpoint from rabit, each worker also
+    # checkpoints the margins of its training data.
+    state = dtrain if rabit.get_world_size() > 1 else None
+    version = bst.load_rabit_checkpoint(state)
     assert(rabit.get_world_size() != 1 or version == 0)
     rank = rabit.get_rank()
     start_iteration = int(version / 2)
@@ -72,7 +90,7 @@ def _train_internal(params, dtrain,
         # Skip the first update if it is a recovery step.
         if version % 2 == 0:
             bst.update(dtrain, i, obj)
-            bst.save_rabit_checkpoint()
+            bst.save_rabit_checkpoint(state)
             version += 1
 
         assert(rabit.get_world_size() == 1 or version == rabit.version_number())
@@ -100,21 +118,53 @@ def _train_internal(params, dtrain,
         except EarlyStopException:
             break
         # do checkpoint after evaluation, in case evaluation also updates booster.
-        bst.save_rabit_checkpoint()
+        bst.save_rabit_checkpoint(state)
         version += 1
 
-    if bst.attr('best_score') is not None:
-        bst.best_score = float(bst.attr('best_score'))
-        bst.best_iteration = int(bst.attr('best_iteration'))
-    else:
-        bst.best_iteration = nboost - 1
-    bst.best_ntree_limit = (bst.best_iteration + 1) * num_parallel_tree
+    _set_best_iteration(bst, nboost, num_parallel_tree)
+    return bst
+
+
+def _train_native(params, dtrain, num_boost_round, evals, xgb_model, callbacks,
+                  early_stopping_rounds, maximize):
+    """training function of the loop of the library, the callbacks run after each round"""
+    evals = list(evals)
+    if early_stopping_rounds and not evals:
+        raise ValueError('For early stopping you need at least one set in evals.')
+    if any(cb.__dict__.get('before_iteration', False) for cb in callbacks):
+        raise ValueError('native training does not run callbacks before the rounds')
+    bst, nboost, num_parallel_tree = _init_booster(params, dtrain, evals, xgb_model)
+    rank = rabit.get_rank()
+
+    def after_round(iteration, evaluation_result_list):
+        """run the callbacks, True to stop"""
+        try:
+            for cb in callbacks:
+                cb(CallbackEnv(model=bst,
+                               cvfolds=None,
+                               iteration=iteration,
+                               begin_iteration=0,
+                               end_iteration=num_boost_round,
+                               rank=rank,
+                               evaluation_result_list=evaluation_result_list))
+        except EarlyStopException:
+            return True
+        return False
+
+    # Distributed code: checkpoint each round with the margins of the training data
+    checkpoint_interval = 1 if rabit.get_world_size() > 1 else 0
+    end = bst.train_native(dtrain, num_boost_round, evals,
+                           early_stopping_rounds=early_stopping_rounds or 0,
+                           maximize=maximize, checkpoint_interval=checkpoint_interval,
+                           callback=after_round if callbacks else None)
+    _set_best_iteration(bst, nboost + end, num_parallel_tree)
     return bst
 
 
 def train(params, dtrain, num_boost_round=10, evals=(), obj=None, feval=None,
           maximize=False, early_stopping_rounds=None, evals_result=None,
-          verbose_eval=True, xgb_model=None, callbacks=None, learning_rates=None):
+          verbose_eval=True, xgb_model=None, callbacks=None, learning_rates=None,
+          native=False):
     # pylint: disable=too-many-statements,too-many-branches, attribute-defined-outside-init
     """Train a booster with given parameters.
 
@@ -171,12 +221,19 @@ def train(params, dtrain, num_boost_round=10, evals=(), obj=None, feval=None,
         List of callback functions that are applied at end of each iteration.
         It is possible to use predefined callbacks by using xgb.callback module.
         Example: [xgb.callback.reset_learning_rate(custom_rates)]
+    native : bool
+        Run the rounds in the loop of the library, see Booster.train_native: the
+        metrics are passed as numbers and early stopping is done natively, the
+        callbacks only run after the rounds. Not supported with obj, feval and
+        learning_rates.
 
     Returns
     -------
     booster : a trained booster model
     """
     callbacks = [] if callbacks is None else callbacks
+    if native and (obj is not None or feval is not None or learning_rates is not None):
+        raise ValueError('native training does not support obj, feval and learning_rates')
 
     # Most of legacy advanced options becomes callbacks
     if isinstance(verbose_eval, bool) and verbose_eval:
@@ -185,7 +242,7 @@ def train(params, dtrain, num_boost_round=10, evals=(), obj=None, feval=None,
         if isinstance(verbose_eval, int):
             callbacks.append(callback.print_evaluation(verbose_eval))
 
-    if early_stopping_rounds is not None:
+    if early_stopping_rounds is not None and not native:
         callbacks.append(callback.early_stop(early_stopping_rounds,
                                              maximize=maximize,
                                              verbose=bool(verbose_eval)))
@@ -197,6 +254,9 @@ def train(params, dtrain, num_boost_round=10, evals=(), obj=None, feval=None,
                       DeprecationWarning)
         callbacks.append(callback.reset_learning_rate(learning_rates))
 
+    if native:
+        return _train_native(params, dtrain, num_boost_round, evals, xgb_model, callbacks,
+                             early_stopping_rounds, maximize)
     return _train_internal(params, dtrain,
                            num_boost_round=num_boost_round,
                            evals=evals,
@@ -2,21 +2,42 @@
 
 #include <xgboost/data.h>
 #include <xgboost/learner.h>
+#include <xgboost/gbm.h>
 #include <xgboost/c_api.h>
 #include <xgboost/logging.h>
+#include <xgboost/predictor.h>
 #include <dmlc/thread_local.h>
 #include <rabit/rabit.h>
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <iomanip>
+#include <limits>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <cstring>
 #include <memory>
+#include <thread>
+#include <utility>
 
 #include "./c_api_error.h"
 #include "../data/simple_csr_source.h"
 #include "../common/math.h"
 #include "../common/io.h"
+#include "../common/memory_tracker.h"
 #include "../common/group_data.h"
+#include "../common/threading.h"
+#include "../common/train_state.h"
+#include "../data/shared_page_view.h"
+#include "../gbm/model_compactor.h"
+#include "../predictor/frozen_predictor.h"
+#include "../predictor/model_registry.h"
+#include "../predictor/quantized_forest.h"
+#include "../predictor/request_batcher.h"
+#include "../robust/robust_attack.h"
+#include "../robust/robust_milp.h"
+#include "../robust/robust_verifier.h"
 
 
 namespace xgboost {
@@ -42,6 +63,9 @@ class Booster {
       });
     if (it == cfg_.end()) {
       cfg_.emplace_back(name, val);
+    } else if ((*it).second == val) {
+      // unchanged, the learner keeps its configuration
+      return;
     } else {
       (*it).second = val;
     }
@@ -66,11 +90,24 @@ class Booster {
     initialized_ = true;
   }
 
+  // predictor of the rows in caller buffers, it holds no prediction cache
+  inline Predictor* buffer_predictor() {  // NOLINT
+    if (buffer_predictor_ == nullptr) {
+      buffer_predictor_.reset(Predictor::Create("cpu_predictor"));
+    }
+    return buffer_predictor_.get();
+  }
+
  public:
   bool configured_;
   bool initialized_;
   std::unique_ptr<Learner> learner_;
+  std::unique_ptr<Predictor> buffer_predictor_;
   std::vector<std::pair<std::string, std::string> > cfg_;
+  // the trees verified at the rows of the last matrix verified, so that the
+  // verification of a later checkpoint of the model only walks the new trees
+  robust::VerifySummary verify_summary_;
+  std::weak_ptr<DMatrix> verify_fmat_;
 };
 
 // declare the data callback.
@@ -195,8 +232,16 @@ struct XGBAPIThreadLocalEntry {
   std::vector<const char *> ret_vec_charp;
   /*! \brief returning float vector. */
   std::vector<bst_float> ret_vec_float;
+  /*! \brief returning int vector. */
+  std::vector<int> ret_vec_int;
+  /*! \brief returning tree node arrays. */
+  gbm::FlatTreeArrays ret_trees;
+  /*! \brief returning feature importance. */
+  gbm::FeatureImportance ret_importance;
   /*! \brief temp variable of gradient pairs. */
   std::vector<GradientPair> tmp_gpair;
+  /*! \brief temp variable of predictions from caller buffers. */
+  HostDeviceVector<bst_float> tmp_preds;
 };
 
 // define the threadlocal store.
@@ -209,10 +254,40 @@ int XGBRegisterLogCallback(void (*callback)(const char*)) {
   API_END();
 }
 
+int XGBSetThreadLimit(int nthread) {
+  API_BEGIN();
+  CHECK_GE(nthread, 0) << "the thread limit can not be negative";
+  common::ThreadLimit() = nthread;
+  API_END();
+}
+
+int XGBSetThreadBackend(const char* name) {
+  API_BEGIN();
+  common::SetThreadBackend(common::ParseThreadBackend(name));
+  API_END();
+}
+
+int XGBSetExecutor(void (*submit)(void (*task)(void*), void* arg, void* ctx), void* ctx) {
+  API_BEGIN();
+  common::SetExecutor(submit, ctx);
+  API_END();
+}
+
+int XGBGetMemoryUsage(int reset_peak, const char** out_json) {
+  API_BEGIN();
+  common::MemoryTracker* tracker = common::MemoryTracker::Get();
+  std::string& ret_str = XGBAPIThreadLocalStore::Get()->ret_str;
+  ret_str = tracker->Json();
+  if (reset_peak != 0) tracker->ResetPeak();
+  *out_json = ret_str.c_str();
+  API_END();
+}
+
 int XGDMatrixCreateFromFile(const char *fname,
                             int silent,
                             DMatrixHandle *out) {
   API_BEGIN();
+  common::OmpThreadScope threads(0);
   bool load_row_split = false;
   if (rabit::IsDistributed()) {
     LOG(CONSOLE) << "XGBoost distributed mode detected, "
@@ -229,6 +304,7 @@ int XGDMatrixCreateFromDataIter(
     const char *cache_info,
     DMatrixHandle *out) {
   API_BEGIN();
+  common::OmpThreadScope threads(0);
 
   std::string scache;
   if (cache_info != nullptr) {
@@ -292,16 +368,44 @@ XGB_DLL int XGDMatrixCreateFromCSR(const xgboost::bst_ulong* indptr,
     static_cast<size_t>(nindptr), static_cast<size_t>(nelem), 0, out);
 }
 
-XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
-                                     const unsigned* indices,
-                                     const bst_float* data,
-                                     size_t nindptr,
-                                     size_t nelem,
-                                     size_t num_row,
-                                     DMatrixHandle* out) {
-  std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
-
+XGB_DLL int XGDMatrixAppendCSR(DMatrixHandle handle,
+                               const size_t* indptr,
+                               const unsigned* indices,
+                               const bst_float* data,
+                               size_t nindptr,
+                               size_t nelem,
+                               const bst_float* label,
+                               const bst_float* weight) {
   API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_GE(nindptr, 1U);
+  const size_t nrow = nindptr - 1;
+  SparsePage rows;
+  rows.data.reserve(nelem);
+  for (size_t i = 1; i < nindptr; ++i) {
+    for (size_t j = indptr[i - 1]; j < indptr[i]; ++j) {
+      if (!common::CheckNAN(data[j])) {
+        rows.data.emplace_back(Entry(indices[j], data[j]));
+      }
+    }
+    rows.offset.push_back(rows.data.size());
+  }
+  std::vector<bst_float> labels, weights;
+  if (label != nullptr) labels.assign(label, label + nrow);
+  if (weight != nullptr) weights.assign(weight, weight + nrow);
+  static_cast<std::shared_ptr<DMatrix>*>(handle)->get()->AppendRows(rows, labels, weights);
+  API_END();
+}
+
+// the rows of a CSC matrix, of 32 or 64 bit row ids
+template <typename RowIndex>
+inline void CSCToRows(const size_t* col_ptr,
+                      const RowIndex* indices,
+                      const bst_float* data,
+                      size_t nindptr,
+                      size_t nelem,
+                      size_t num_row,
+                      data::SimpleCSRSource* source) {
   // FIXME: User should be able to control number of threads
   const int nthread = omp_get_max_threads();
   data::SimpleCSRSource& mat = *source;
@@ -313,7 +417,7 @@ XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
     int tid = omp_get_thread_num();
     for (size_t j = col_ptr[i]; j < col_ptr[i+1]; ++j) {
       if (!common::CheckNAN(data[j])) {
-        builder.AddBudget(indices[j], tid);
+        builder.AddBudget(static_cast<size_t>(indices[j]), tid);
       }
     }
   }
@@ -323,7 +427,7 @@ XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
     int tid = omp_get_thread_num();
     for (size_t j = col_ptr[i]; j < col_ptr[i+1]; ++j) {
       if (!common::CheckNAN(data[j])) {
-        builder.Push(indices[j],
+        builder.Push(static_cast<size_t>(indices[j]),
                      Entry(static_cast<bst_uint>(i), data[j]),
                      tid);
       }
@@ -341,6 +445,36 @@ XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
   }
   mat.info.num_col_ = ncol;
   mat.info.num_nonzero_ = nelem;
+}
+
+XGB_DLL int XGDMatrixCreateFromCSCEx(const size_t* col_ptr,
+                                     const unsigned* indices,
+                                     const bst_float* data,
+                                     size_t nindptr,
+                                     size_t nelem,
+                                     size_t num_row,
+                                     DMatrixHandle* out) {
+  std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+
+  API_BEGIN();
+  common::OmpThreadScope threads(0);
+  CSCToRows(col_ptr, indices, data, nindptr, nelem, num_row, source.get());
+  *out  = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
+  API_END();
+}
+
+XGB_DLL int XGDMatrixCreateFromCSCEx64(const size_t* col_ptr,
+                                       const uint64_t* indices,
+                                       const bst_float* data,
+                                       size_t nindptr,
+                                       size_t nelem,
+                                       size_t num_row,
+                                       DMatrixHandle* out) {
+  std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+
+  API_BEGIN();
+  common::OmpThreadScope threads(0);
+  CSCToRows(col_ptr, indices, data, nindptr, nelem, num_row, source.get());
   *out  = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
   API_END();
 }
@@ -367,6 +501,7 @@ XGB_DLL int XGDMatrixCreateFromMat(const bst_float* data,
   std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
 
   API_BEGIN();
+  common::OmpThreadScope threads(0);
   data::SimpleCSRSource& mat = *source;
   mat.page_.offset.resize(1+nrow);
   bool nan_missing = common::CheckNAN(missing);
@@ -456,8 +591,8 @@ XGB_DLL int XGDMatrixCreateFromMat_omp(const bst_float* data,  // NOLINT
   const int nthreadmax = std::max(omp_get_num_procs() / 2 - 1, 1);
   //  const int nthreadmax = omp_get_max_threads();
   if (nthread <= 0) nthread=nthreadmax;
-  int nthread_orig = omp_get_max_threads();
-  omp_set_num_threads(nthread);
+  common::OmpThreadScope threads(nthread);
+  nthread = omp_get_max_threads();
 
   std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
   data::SimpleCSRSource& mat = *source;
@@ -515,8 +650,69 @@ XGB_DLL int XGDMatrixCreateFromMat_omp(const bst_float* data,  // NOLINT
       }
     }
   }
-  // restore omp state
-  omp_set_num_threads(nthread_orig);
+  mat.info.num_nonzero_ = mat.page_.data.size();
+  *out  = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
+  API_END();
+}
+
+XGB_DLL int XGDMatrixCreateFromMatColMajor(const double* data,
+                                           xgboost::bst_ulong nrow,
+                                           xgboost::bst_ulong ncol,
+                                           double missing,
+                                           DMatrixHandle* out,
+                                           int nthread) {
+  API_BEGIN();
+  // rows of a block, each column of a block is read contiguously
+  const omp_ulong kBlockRows = 1024;
+  const omp_ulong nblock = (nrow + kBlockRows - 1) / kBlockRows;
+  common::OmpThreadScope threads(nthread);
+  nthread = omp_get_max_threads();
+  const auto fmissing = static_cast<bst_float>(missing);
+  const bool nan_missing = common::CheckNAN(fmissing);
+
+  std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+  data::SimpleCSRSource& mat = *source;
+  mat.page_.offset.assign(nrow + 1, 0);
+  mat.info.num_row_ = nrow;
+  mat.info.num_col_ = ncol;
+  int badnan = 0;
+  // count the elements of each row
+#pragma omp parallel for schedule(static) num_threads(nthread) reduction(|:badnan)
+  for (omp_ulong b = 0; b < nblock; ++b) {
+    const omp_ulong begin = b * kBlockRows;
+    const omp_ulong end = std::min(begin + kBlockRows, static_cast<omp_ulong>(nrow));
+    for (xgboost::bst_ulong j = 0; j < ncol; ++j) {
+      const double* col = data + j * nrow;
+      for (omp_ulong i = begin; i < end; ++i) {
+        const auto v = static_cast<bst_float>(col[i]);
+        if (common::CheckNAN(v)) {
+          badnan |= nan_missing ? 0 : 1;
+        } else if (nan_missing || v != fmissing) {
+          ++mat.page_.offset[i + 1];
+        }
+      }
+    }
+  }
+  CHECK(!badnan) << "There are NAN in the matrix, however, you did not set missing=NAN";
+  PrefixSum(&mat.page_.offset[0], mat.page_.offset.size());
+  mat.page_.data.resize(mat.page_.offset.back());
+
+  // fill the rows, the entries of a row are in the order of the columns
+  std::vector<size_t> pos(mat.page_.offset.begin(), mat.page_.offset.end() - 1);
+#pragma omp parallel for schedule(static) num_threads(nthread)
+  for (omp_ulong b = 0; b < nblock; ++b) {
+    const omp_ulong begin = b * kBlockRows;
+    const omp_ulong end = std::min(begin + kBlockRows, static_cast<omp_ulong>(nrow));
+    for (xgboost::bst_ulong j = 0; j < ncol; ++j) {
+      const double* col = data + j * nrow;
+      for (omp_ulong i = begin; i < end; ++i) {
+        const auto v = static_cast<bst_float>(col[i]);
+        if (!common::CheckNAN(v) && (nan_missing || v != fmissing)) {
+          mat.page_.data[pos[i]++] = Entry(static_cast<bst_uint>(j), v);
+        }
+      }
+    }
+  }
 
   mat.info.num_nonzero_ = mat.page_.data.size();
   *out  = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
@@ -606,8 +802,8 @@ XGB_DLL int XGDMatrixCreateFromDT(void** data, const char** feature_stypes,
   API_BEGIN();
   const int nthreadmax = std::max(omp_get_num_procs() / 2 - 1, 1);
   if (nthread <= 0) nthread = nthreadmax;
-  int nthread_orig = omp_get_max_threads();
-  omp_set_num_threads(nthread);
+  common::OmpThreadScope threads(nthread);
+  nthread = omp_get_max_threads();
 
   std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
   data::SimpleCSRSource& mat = *source;
@@ -651,9 +847,6 @@ XGB_DLL int XGDMatrixCreateFromDT(void** data, const char** feature_stypes,
     }
   }
 
-  // restore omp state
-  omp_set_num_threads(nthread_orig);
-
   mat.info.num_nonzero_ = mat.page_.data.size();
   *out = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
   API_END();
@@ -709,6 +902,109 @@ XGB_DLL int XGDMatrixSliceDMatrix(DMatrixHandle handle,
   API_END();
 }
 
+XGB_DLL int XGDMatrixMergeDuplicateRows(DMatrixHandle handle,
+                                        DMatrixHandle* out,
+                                        xgboost::bst_ulong* out_num_merged) {
+  std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+
+  API_BEGIN();
+  CHECK_HANDLE();
+  common::OmpThreadScope threads(0);
+  data::SimpleCSRSource src;
+  src.CopyFrom(static_cast<std::shared_ptr<DMatrix>*>(handle)->get());
+  const MetaInfo& info = src.info;
+  CHECK_EQ(info.group_ptr_.size(), 0U)
+      << "merging duplicate rows does not support group structure";
+  CHECK_EQ(info.qids_.size(), 0U)
+      << "merging duplicate rows does not support qid";
+  const size_t nrow = info.num_row_;
+  const size_t nmargin = nrow == 0 ? 0 : info.base_margin_.size() / nrow;
+  src.BeforeFirst();
+  CHECK(src.Next());
+  const SparsePage& batch = src.Value();
+  // values are compared as floats, 0 and -0 go the same way at all splits
+  auto same_row = [&](size_t a, size_t b) {
+    auto ra = batch[a], rb = batch[b];
+    if (ra.length != rb.length) return false;
+    for (bst_uint j = 0; j < ra.length; ++j) {
+      if (ra[j].index != rb[j].index || ra[j].fvalue != rb[j].fvalue) return false;
+    }
+    if (info.labels_.size() != 0 && info.labels_[a] != info.labels_[b]) return false;
+    if (info.root_index_.size() != 0 && info.root_index_[a] != info.root_index_[b]) return false;
+    for (size_t k = 0; k < nmargin; ++k) {
+      if (info.base_margin_[a * nmargin + k] != info.base_margin_[b * nmargin + k]) return false;
+    }
+    return true;
+  };
+  auto mix = [](uint64_t h, bst_float value) {
+    uint32_t bits = 0;
+    if (value != 0.0f) std::memcpy(&bits, &value, sizeof(bits));
+    return (h ^ bits) * 1099511628211ULL;
+  };
+  std::vector<std::pair<uint64_t, size_t> > hash(nrow);
+  const auto nrow_omp = static_cast<bst_omp_uint>(nrow);
+  #pragma omp parallel for schedule(static)
+  for (bst_omp_uint i = 0; i < nrow_omp; ++i) {
+    auto row = batch[i];
+    uint64_t h = 14695981039346656037ULL;
+    for (bst_uint j = 0; j < row.length; ++j) {
+      h = (h ^ row[j].index) * 1099511628211ULL;
+      h = mix(h, row[j].fvalue);
+    }
+    if (info.labels_.size() != 0) h = mix(h, info.labels_[i]);
+    hash[i] = std::make_pair(h, static_cast<size_t>(i));
+  }
+  std::sort(hash.begin(), hash.end());
+  // the first row of each set of same rows, for all the rows
+  std::vector<size_t> first(nrow);
+  std::vector<size_t> distinct;
+  for (size_t begin = 0; begin < nrow;) {
+    size_t end = begin;
+    while (end < nrow && hash[end].first == hash[begin].first) ++end;
+    distinct.clear();
+    for (size_t k = begin; k < end; ++k) {
+      const size_t ridx = hash[k].second;
+      size_t d = 0;
+      while (d < distinct.size() && !same_row(distinct[d], ridx)) ++d;
+      if (d == distinct.size()) distinct.push_back(ridx);
+      first[ridx] = distinct[d];
+    }
+    begin = end;
+  }
+  // the merged row takes the place of the first, with the sum of the weights
+  data::SimpleCSRSource& ret = *source;
+  ret.Clear();
+  ret.info.num_col_ = info.num_col_;
+  std::vector<size_t> merged_id(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    if (first[i] != i) {
+      ret.info.weights_[merged_id[first[i]]] += info.GetWeight(i);
+      continue;
+    }
+    merged_id[i] = ret.info.weights_.size();
+    auto inst = batch[i];
+    ret.page_.data.insert(ret.page_.data.end(), inst.data, inst.data + inst.length);
+    ret.page_.offset.push_back(ret.page_.offset.back() + inst.length);
+    ret.info.num_nonzero_ += inst.length;
+    ret.info.weights_.push_back(info.GetWeight(i));
+    if (info.labels_.size() != 0) {
+      ret.info.labels_.push_back(info.labels_[i]);
+    }
+    if (info.root_index_.size() != 0) {
+      ret.info.root_index_.push_back(info.root_index_[i]);
+    }
+    ret.info.base_margin_.insert(ret.info.base_margin_.end(),
+                                 info.base_margin_.begin() + i * nmargin,
+                                 info.base_margin_.begin() + (i + 1) * nmargin);
+  }
+  ret.info.num_row_ = ret.info.weights_.size();
+  if (out_num_merged != nullptr) {
+    *out_num_merged = static_cast<xgboost::bst_ulong>(nrow - ret.info.num_row_);
+  }
+  *out = new std::shared_ptr<DMatrix>(DMatrix::Create(std::move(source)));
+  API_END();
+}
+
 XGB_DLL int XGDMatrixFree(DMatrixHandle handle) {
   API_BEGIN();
   CHECK_HANDLE();
@@ -909,6 +1205,268 @@ XGB_DLL int XGBoosterEvalOneIter(BoosterHandle handle,
   API_END();
 }
 
+// whether the early stopping of the python package maximizes metric
+inline bool MaximizedMetric(const std::string& metric) {
+  for (const std::string name : {"auc", "map", "ndcg"}) {
+    if (metric.compare(0, name.size(), name) == 0 &&
+        (metric.size() == name.size() || metric[name.size()] == '@')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+XGB_DLL int XGBoosterTrain(BoosterHandle handle,
+                           DMatrixHandle dtrain,
+                           int begin_iteration,
+                           int num_round,
+                           DMatrixHandle dmats[],
+                           const char* evnames[],
+                           xgboost::bst_ulong len,
+                           int early_stopping_rounds,
+                           int maximize,
+                           int checkpoint_interval,
+                           XGBCallbackTrainRound* callback,
+                           void* callback_handle,
+                           int* out_num_round) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK(dtrain != nullptr) << "DMatrix has not been intialized or has already been disposed.";
+  CHECK_LE(begin_iteration, num_round) << "the first round is after the last";
+  CHECK(early_stopping_rounds <= 0 || len != 0)
+      << "early stopping needs at least one evaluation set";
+  auto* bst = static_cast<Booster*>(handle);
+  Learner* learner = bst->learner();
+  DMatrix* train = static_cast<std::shared_ptr<DMatrix>*>(dtrain)->get();
+  std::vector<DMatrix*> data_sets;
+  for (xgboost::bst_ulong i = 0; i < len; ++i) {
+    data_sets.push_back(static_cast<std::shared_ptr<DMatrix>*>(dmats[i])->get());
+  }
+  // the checkpoints count the intervals trained since begin_iteration
+  int begin = begin_iteration;
+  if (checkpoint_interval > 0) {
+    common::TrainState state(learner, train);
+    const int version = rabit::IsDistributed() ? rabit::LoadCheckPoint(learner, &state)
+                                               : rabit::LoadCheckPoint(learner);
+    if (version != 0) {
+      bst->initialized_ = true;
+      if (rabit::IsDistributed() && !state.Restore()) {
+        LOG(INFO) << "no training state in the rabit checkpoint, the training data are predicted";
+      }
+      begin = std::min(num_round, begin_iteration + version * checkpoint_interval);
+    }
+  }
+  bst->LazyInit();
+  bool maximize_score = maximize != 0;
+  bool has_best = false;
+  bst_float best_score = 0.0f;
+  int best_iteration = 0;
+  std::string attr;
+  if (early_stopping_rounds > 0 && learner->GetAttr("best_score", &attr)) {
+    best_score = static_cast<bst_float>(std::atof(attr.c_str()));
+    has_best = learner->GetAttr("best_iteration", &attr);
+    best_iteration = std::atoi(attr.c_str());
+  }
+  // not the thread local results, the callback may call the API
+  std::vector<std::string> metric_names, names;
+  std::vector<const char*> names_charp;
+  std::vector<bst_float> values;
+  *out_num_round = begin;
+  for (int iter = begin; iter < num_round; ++iter) {
+    learner->UpdateOneIter(iter, train);
+    bool stop = false;
+    if (!data_sets.empty()) {
+      learner->EvalMetricValues(data_sets, &metric_names, &values);
+      if (names.empty()) {
+        for (xgboost::bst_ulong i = 0; i < len; ++i) {
+          for (const std::string& metric : metric_names) {
+            names.push_back(std::string(evnames[i]) + '-' + metric);
+          }
+        }
+        for (const std::string& name : names) names_charp.push_back(name.c_str());
+        maximize_score = maximize_score || MaximizedMetric(metric_names.back());
+      }
+    }
+    if (early_stopping_rounds > 0) {
+      const bst_float score = values.back();
+      if (!has_best || (maximize_score ? score > best_score : score < best_score)) {
+        has_best = true;
+        best_score = score;
+        best_iteration = iter;
+        // kept in the model, so that checkpoints hold them
+        std::ostringstream os;
+        os << std::setprecision(std::numeric_limits<bst_float>::max_digits10) << score;
+        learner->SetAttr("best_score", os.str());
+        learner->SetAttr("best_iteration", std::to_string(iter));
+      } else if (iter - best_iteration >= early_stopping_rounds) {
+        stop = true;
+      }
+    }
+    if (callback != nullptr &&
+        callback(callback_handle, iter, dmlc::BeginPtr(names_charp), dmlc::BeginPtr(values),
+                 static_cast<xgboost::bst_ulong>(values.size())) != 0) {
+      stop = true;
+    }
+    if (checkpoint_interval > 0 && (iter + 1 - begin_iteration) % checkpoint_interval == 0) {
+      if (rabit::IsDistributed()) {
+        common::TrainState state(learner, train);
+        rabit::CheckPoint(learner, &state);
+      } else if (learner->AllowLazyCheckPoint()) {
+        rabit::LazyCheckPoint(learner);
+      } else {
+        rabit::CheckPoint(learner);
+      }
+    }
+    *out_num_round = iter + 1;
+    if (stop) break;
+  }
+  API_END();
+}
+
+// a configuration of XGBoosterSweep and its result
+struct SweepJob {
+  std::vector<std::pair<std::string, std::string> > cfg;
+  // the trained model, saved by Learner::Save
+  std::string model;
+  bst_float best_score{0.0f};
+  int best_iteration{0};
+  std::string error;
+};
+
+// the value of the first metric of an EvalOneIter result, and whether it is
+// maximized, as decided by the early stopping of the python package
+inline bst_float FirstMetric(const std::string& eval, bool* maximize) {
+  const size_t dash = eval.find('-');
+  const size_t colon = eval.find(':', dash);
+  CHECK(dash != std::string::npos && colon != std::string::npos)
+      << "no metric in the evaluation " << eval;
+  const std::string name = eval.substr(dash + 1, colon - dash - 1);
+  *maximize = name.compare(0, 3, "auc") == 0 || name.compare(0, 3, "map") == 0 ||
+      name.compare(0, 4, "ndcg") == 0;
+  return static_cast<bst_float>(std::atof(eval.c_str() + colon + 1));
+}
+
+// the pages of the matrices of a sweep, only read by its jobs
+struct SweepPages {
+  DMatrix* train;
+  const SparsePage* train_row;
+  const SparsePage* train_col;
+  DMatrix* eval;
+  const SparsePage* eval_row;
+};
+
+// train the booster of job on views of the shared pages
+inline void RunSweepJob(const SweepPages& pages, int num_round, int early_stopping_rounds,
+                        int nthread, SweepJob* job) {
+  std::shared_ptr<DMatrix> train(
+      new data::SharedPageView(pages.train, pages.train_row, pages.train_col));
+  std::vector<std::shared_ptr<DMatrix> > cache(1, train);
+  std::shared_ptr<DMatrix> eval = train;
+  if (pages.eval != pages.train) {
+    eval.reset(new data::SharedPageView(pages.eval, pages.eval_row, nullptr));
+    cache.push_back(eval);
+  }
+  std::vector<std::pair<std::string, std::string> > cfg = job->cfg;
+  auto has_nthread = [](const std::pair<std::string, std::string>& kv) {
+    return kv.first == "nthread";
+  };
+  if (std::none_of(cfg.begin(), cfg.end(), has_nthread)) {
+    cfg.emplace_back("nthread", std::to_string(nthread));
+  }
+  common::OmpThreadScope threads(nthread);
+  std::unique_ptr<Learner> learner(Learner::Create(cache));
+  learner->Configure(cfg);
+  learner->InitModel();
+  bool maximize = false;
+  for (int iter = 0; iter < num_round; ++iter) {
+    learner->UpdateOneIter(iter, train.get());
+    const bst_float score =
+        FirstMetric(learner->EvalOneIter(iter, {eval.get()}, {"eval"}), &maximize);
+    if (iter == 0 || (maximize ? score > job->best_score : score < job->best_score)) {
+      job->best_score = score;
+      job->best_iteration = iter;
+    }
+    if (early_stopping_rounds > 0 && iter - job->best_iteration >= early_stopping_rounds) {
+      break;
+    }
+  }
+  common::MemoryBufferStream fo(&job->model);
+  learner->Save(&fo);
+}
+
+XGB_DLL int XGBoosterSweep(DMatrixHandle dtrain,
+                           DMatrixHandle deval,
+                           const char** keys,
+                           const char** values,
+                           const xgboost::bst_ulong* config_ptr,
+                           xgboost::bst_ulong nconfig,
+                           int num_round,
+                           int early_stopping_rounds,
+                           int max_concurrent,
+                           BoosterHandle* out_boosters,
+                           bst_float* out_best_score,
+                           int* out_best_iteration) {
+  API_BEGIN();
+  CHECK(dtrain != nullptr) << "DMatrix has not been intialized or has already been disposed.";
+  // the updaters synchronize through rabit, which is not thread safe
+  CHECK(!rabit::IsDistributed()) << "sweeps are not supported in distributed training";
+  std::shared_ptr<DMatrix> train = *static_cast<std::shared_ptr<DMatrix>*>(dtrain);
+  DMatrix* eval = deval == nullptr ? train.get()
+                                   : static_cast<std::shared_ptr<DMatrix>*>(deval)->get();
+  // sort the columns once for all boosters
+  if (!train->HaveColAccess(true)) {
+    train->InitColAccess(std::numeric_limits<size_t>::max(), true);
+  }
+  SweepPages pages;
+  const SparsePage* eval_col;
+  pages.train = train.get();
+  pages.eval = eval;
+  CHECK(data::SharedPageView::GetPages(pages.train, &pages.train_row, &pages.train_col))
+      << "sweeps need a training matrix of one page";
+  CHECK(data::SharedPageView::GetPages(pages.eval, &pages.eval_row, &eval_col))
+      << "sweeps need an evaluation matrix of one page";
+  std::vector<SweepJob> jobs(nconfig);
+  for (xgboost::bst_ulong i = 0; i < nconfig; ++i) {
+    for (xgboost::bst_ulong j = config_ptr[i]; j < config_ptr[i + 1]; ++j) {
+      jobs[i].cfg.emplace_back(keys[j], values[j]);
+    }
+  }
+  // the jobs share the threads of the caller, within the limit of the process
+  common::OmpThreadScope threads(0);
+  const int nthread = omp_get_max_threads();
+  if (max_concurrent <= 0) max_concurrent = nthread;
+  const auto nworker = static_cast<int>(
+      std::max<xgboost::bst_ulong>(1, std::min<xgboost::bst_ulong>(max_concurrent, nconfig)));
+  const int nthread_job = std::max(1, nthread / nworker);
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> workers;
+  for (int w = 0; w < nworker; ++w) {
+    workers.emplace_back([&]() {
+      for (size_t i = next++; i < jobs.size(); i = next++) {
+        try {
+          RunSweepJob(pages, num_round, early_stopping_rounds, nthread_job, &jobs[i]);
+        } catch (dmlc::Error& e) {
+          jobs[i].error = e.what();
+        }
+      }
+    });
+  }
+  for (std::thread& worker : workers) worker.join();
+  for (const SweepJob& job : jobs) {
+    if (!job.error.empty()) LOG(FATAL) << job.error;
+  }
+  for (xgboost::bst_ulong i = 0; i < nconfig; ++i) {
+    std::unique_ptr<Booster> bst(new Booster({train}));
+    for (const auto& kv : jobs[i].cfg) bst->SetParam(kv.first, kv.second);
+    common::MemoryBufferStream fi(&jobs[i].model);
+    bst->LoadModel(&fi);
+    out_boosters[i] = bst.release();
+    out_best_score[i] = jobs[i].best_score;
+    out_best_iteration[i] = jobs[i].best_iteration;
+  }
+  API_END();
+}
+
 XGB_DLL int XGBoosterPredict(BoosterHandle handle,
                              DMatrixHandle dmat,
                              int option_mask,
@@ -936,6 +1494,662 @@ XGB_DLL int XGBoosterPredict(BoosterHandle handle,
   API_END();
 }
 
+XGB_DLL int XGBoosterPredictStaged(BoosterHandle handle,
+                                   DMatrixHandle dmat,
+                                   int option_mask,
+                                   unsigned stride,
+                                   unsigned ntree_limit,
+                                   xgboost::bst_ulong *out_num_stage,
+                                   xgboost::bst_ulong *len,
+                                   const bst_float **out_result) {
+  std::vector<bst_float>&preds =
+    XGBAPIThreadLocalStore::Get()->ret_vec_float;
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_EQ(option_mask & ~1, 0) << "staged prediction only supports output_margin";
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
+  HostDeviceVector<bst_float> tmp_preds;
+  *out_num_stage = bst->learner()->PredictStaged(
+      static_cast<std::shared_ptr<DMatrix>*>(dmat)->get(),
+      (option_mask & 1) != 0, stride, ntree_limit, &tmp_preds);
+  preds = tmp_preds.HostVector();
+  *out_result = dmlc::BeginPtr(preds);
+  *len = static_cast<xgboost::bst_ulong>(preds.size());
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictLeafIndex(BoosterHandle handle,
+                                      DMatrixHandle dmat,
+                                      unsigned ntree_limit,
+                                      int one_hot,
+                                      int *out_index_size,
+                                      xgboost::bst_ulong *out_num_index,
+                                      xgboost::bst_ulong out_size,
+                                      void *out_result,
+                                      xgboost::bst_ulong *out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
+  DMatrix* p_fmat = static_cast<std::shared_ptr<DMatrix>*>(dmat)->get();
+  gbm::LeafCodes codes;
+  bst->learner()->PredictLeafCodes(p_fmat, ntree_limit, one_hot != 0, &codes, nullptr);
+  const size_t size = p_fmat->Info().num_row_ * codes.num_tree;
+  *out_index_size = codes.index_size;
+  *out_num_index = static_cast<xgboost::bst_ulong>(codes.num_code);
+  *out_len = static_cast<xgboost::bst_ulong>(size);
+  if (out_result != nullptr) {
+    CHECK_GE(out_size, size) << "output buffer is too small";
+    bst->learner()->PredictLeafCodes(p_fmat, ntree_limit, one_hot != 0, &codes, out_result);
+  }
+  API_END();
+}
+
+// predict nrow rows of num_group margins from buffers of the caller with
+// predict_margin(out) into out_result, which holds at least out_size values,
+// and pred_transform(preds) unless output_margin is set. A null out_result
+// only queries the size, nrow * num_group.
+template <typename PredictMargin, typename PredTransform>
+inline void PredictToBuffer(size_t nrow, int num_group, int option_mask,
+                            PredictMargin predict_margin,
+                            PredTransform pred_transform,
+                            xgboost::bst_ulong out_size,
+                            bst_float* out_result,
+                            xgboost::bst_ulong* out_len) {
+  CHECK_EQ(option_mask & ~1, 0)
+      << "prediction from buffers only supports output_margin";
+  const size_t size = nrow * num_group;
+  *out_len = static_cast<xgboost::bst_ulong>(size);
+  if (out_result == nullptr) return;
+  CHECK_GE(out_size, size) << "output buffer is too small";
+  if ((option_mask & 1) != 0) {
+    predict_margin(out_result);
+    return;
+  }
+  HostDeviceVector<bst_float>& preds = XGBAPIThreadLocalStore::Get()->tmp_preds;
+  preds.Resize(size);
+  predict_margin(dmlc::BeginPtr(preds.HostVector()));
+  pred_transform(&preds);
+  const std::vector<bst_float>& preds_h = preds.HostVector();
+  std::copy(preds_h.begin(), preds_h.end(), out_result);
+  *out_len = static_cast<xgboost::bst_ulong>(preds_h.size());
+}
+
+// predict from buffers of the caller with predict_margin(predictor, model, out)
+// into out_result, see PredictToBuffer.
+template <typename PredictMargin>
+inline void PredictFromBuffer(Booster* bst, size_t nrow, int option_mask,
+                              PredictMargin predict_margin,
+                              xgboost::bst_ulong out_size,
+                              bst_float* out_result,
+                              xgboost::bst_ulong* out_len) {
+  bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
+  const gbm::GBTreeModel* model =
+      bst->learner()->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr) << "prediction from buffers only supports booster=gbtree";
+  PredictToBuffer(
+      nrow, model->param.num_output_group, option_mask,
+      [&](bst_float* out) { predict_margin(bst->buffer_predictor(), *model, out); },
+      [&](HostDeviceVector<bst_float>* preds) { bst->learner()->PredTransform(preds); },
+      out_size, out_result, out_len);
+}
+
+XGB_DLL int XGBoosterPredictFromDense(BoosterHandle handle,
+                                      const bst_float* data,
+                                      xgboost::bst_ulong nrow,
+                                      xgboost::bst_ulong ncol,
+                                      bst_float missing,
+                                      int option_mask,
+                                      unsigned ntree_limit,
+                                      xgboost::bst_ulong out_size,
+                                      bst_float* out_result,
+                                      xgboost::bst_ulong* out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  PredictFromBuffer(
+      static_cast<Booster*>(handle), nrow, option_mask,
+      [=](Predictor* predictor, const gbm::GBTreeModel& model, bst_float* out) {
+        predictor->PredictFromDense(data, nrow, ncol, missing, model, ntree_limit, out);
+      }, out_size, out_result, out_len);
+  API_END();
+}
+
+XGB_DLL int XGBoosterPredictFromCSR(BoosterHandle handle,
+                                    const size_t* indptr,
+                                    const unsigned* indices,
+                                    const bst_float* data,
+                                    size_t nindptr,
+                                    size_t nelem,
+                                    int option_mask,
+                                    unsigned ntree_limit,
+                                    xgboost::bst_ulong out_size,
+                                    bst_float* out_result,
+                                    xgboost::bst_ulong* out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_GE(nindptr, 1U);
+  CHECK_EQ(indptr[nindptr - 1], nelem) << "indptr does not match nelem";
+  PredictFromBuffer(
+      static_cast<Booster*>(handle), nindptr - 1, option_mask,
+      [=](Predictor* predictor, const gbm::GBTreeModel& model, bst_float* out) {
+        predictor->PredictFromCSR(indptr, indices, data, nindptr - 1, model, ntree_limit, out);
+      }, out_size, out_result, out_len);
+  API_END();
+}
+
+XGB_DLL int XGBoosterCreatePredictor(BoosterHandle handle,
+                                     PredictorHandle* out) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  *out = new predictor::FrozenPredictor(*bst->learner());
+  API_END();
+}
+
+XGB_DLL int XGPredictorFree(PredictorHandle handle) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  delete static_cast<predictor::FrozenPredictor*>(handle);
+  API_END();
+}
+
+XGB_DLL int XGPredictorPredictFromDense(PredictorHandle handle,
+                                        const bst_float* data,
+                                        xgboost::bst_ulong nrow,
+                                        xgboost::bst_ulong ncol,
+                                        bst_float missing,
+                                        int option_mask,
+                                        unsigned ntree_limit,
+                                        xgboost::bst_ulong out_size,
+                                        bst_float* out_result,
+                                        xgboost::bst_ulong* out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  const auto* frozen = static_cast<const predictor::FrozenPredictor*>(handle);
+  PredictToBuffer(
+      nrow, frozen->NumOutputGroup(), option_mask,
+      [=](bst_float* out) {
+        frozen->PredictFromDense(data, nrow, ncol, missing, ntree_limit, out);
+      },
+      [=](HostDeviceVector<bst_float>* preds) { frozen->PredTransform(preds); },
+      out_size, out_result, out_len);
+  API_END();
+}
+
+XGB_DLL int XGPredictorPredictFromCSR(PredictorHandle handle,
+                                      const size_t* indptr,
+                                      const unsigned* indices,
+                                      const bst_float* data,
+                                      size_t nindptr,
+                                      size_t nelem,
+                                      int option_mask,
+                                      unsigned ntree_limit,
+                                      xgboost::bst_ulong out_size,
+                                      bst_float* out_result,
+                                      xgboost::bst_ulong* out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_GE(nindptr, 1U);
+  CHECK_EQ(indptr[nindptr - 1], nelem) << "indptr does not match nelem";
+  const auto* frozen = static_cast<const predictor::FrozenPredictor*>(handle);
+  PredictToBuffer(
+      nindptr - 1, frozen->NumOutputGroup(), option_mask,
+      [=](bst_float* out) {
+        frozen->PredictFromCSR(indptr, indices, data, nindptr - 1, ntree_limit, out);
+      },
+      [=](HostDeviceVector<bst_float>* preds) { frozen->PredTransform(preds); },
+      out_size, out_result, out_len);
+  API_END();
+}
+
+XGB_DLL int XGPredictorPredictDecision(PredictorHandle handle,
+                                       const bst_float* data,
+                                       xgboost::bst_ulong nrow,
+                                       xgboost::bst_ulong ncol,
+                                       bst_float missing,
+                                       bst_float threshold,
+                                       bst_float* out_decision,
+                                       unsigned* out_ntree) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  static_cast<const predictor::FrozenPredictor*>(handle)->PredictDecision(
+      data, nrow, ncol, missing, threshold, out_decision, out_ntree);
+  API_END();
+}
+
+XGB_DLL int XGPredictorCreateBatcher(PredictorHandle handle,
+                                     int max_batch,
+                                     int max_delay_us,
+                                     int option_mask,
+                                     unsigned ntree_limit,
+                                     BatcherHandle* out) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_EQ(option_mask & ~1, 0) << "batched prediction only supports output_margin";
+  CHECK_GT(max_batch, 0);
+  CHECK_GE(max_delay_us, 0);
+  *out = new predictor::RequestBatcher(
+      *static_cast<const predictor::FrozenPredictor*>(handle), max_batch,
+      std::chrono::microseconds(max_delay_us), (option_mask & 1) != 0, ntree_limit);
+  API_END();
+}
+
+XGB_DLL int XGBatcherFree(BatcherHandle handle) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  delete static_cast<predictor::RequestBatcher*>(handle);
+  API_END();
+}
+
+XGB_DLL int XGBatcherPredict(BatcherHandle handle,
+                             const bst_float* row,
+                             xgboost::bst_ulong ncol,
+                             bst_float missing,
+                             xgboost::bst_ulong out_size,
+                             bst_float* out_result,
+                             xgboost::bst_ulong* out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* batcher = static_cast<predictor::RequestBatcher*>(handle);
+  *out_len = static_cast<xgboost::bst_ulong>(
+      batcher->Submit(row, ncol, missing, out_result, out_size).get());
+  API_END();
+}
+
+XGB_DLL int XGRegistryCreate(RegistryHandle* out) {
+  API_BEGIN();
+  *out = new predictor::ModelRegistry();
+  API_END();
+}
+
+XGB_DLL int XGRegistryFree(RegistryHandle handle) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  delete static_cast<predictor::ModelRegistry*>(handle);
+  API_END();
+}
+
+XGB_DLL int XGRegistryLoadModel(RegistryHandle handle,
+                                const char* model_id,
+                                const char* fname) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname, "r"));
+  static_cast<predictor::ModelRegistry*>(handle)->Load(model_id, fi.get());
+  API_END();
+}
+
+XGB_DLL int XGRegistryAddBooster(RegistryHandle handle,
+                                 const char* model_id,
+                                 BoosterHandle booster) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK(booster != nullptr) << "Booster has not been intialized or has already been disposed.";
+  auto* bst = static_cast<Booster*>(booster);
+  bst->LazyInit();
+  std::string buffer;
+  common::MemoryBufferStream fo(&buffer);
+  bst->learner()->Save(&fo);
+  common::MemoryBufferStream fi(&buffer);
+  static_cast<predictor::ModelRegistry*>(handle)->Load(model_id, &fi,
+                                                       bst->learner()->NumThreads());
+  API_END();
+}
+
+XGB_DLL int XGRegistryGetSize(RegistryHandle handle,
+                              xgboost::bst_ulong* out_num_model,
+                              xgboost::bst_ulong* out_num_tree,
+                              xgboost::bst_ulong* out_num_stored) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  const auto* registry = static_cast<const predictor::ModelRegistry*>(handle);
+  *out_num_model = static_cast<xgboost::bst_ulong>(registry->NumModel());
+  *out_num_tree = static_cast<xgboost::bst_ulong>(registry->NumTreeRef());
+  *out_num_stored = static_cast<xgboost::bst_ulong>(registry->NumTreeStored());
+  API_END();
+}
+
+XGB_DLL int XGRegistryPredictFromDense(RegistryHandle handle,
+                                       const char* model_id,
+                                       const bst_float* data,
+                                       xgboost::bst_ulong nrow,
+                                       xgboost::bst_ulong ncol,
+                                       bst_float missing,
+                                       int option_mask,
+                                       unsigned ntree_limit,
+                                       xgboost::bst_ulong out_size,
+                                       bst_float* out_result,
+                                       xgboost::bst_ulong* out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  const auto* registry = static_cast<const predictor::ModelRegistry*>(handle);
+  const predictor::ModelRegistry::Model& model = registry->Get(model_id);
+  PredictToBuffer(
+      nrow, model.num_output_group, option_mask,
+      [&](bst_float* out) {
+        registry->PredictFromDense(model, data, nrow, ncol, missing, ntree_limit, out);
+      },
+      [&](HostDeviceVector<bst_float>* preds) { model.PredTransform(preds); },
+      out_size, out_result, out_len);
+  API_END();
+}
+
+XGB_DLL int XGRegistryPredictFromCSR(RegistryHandle handle,
+                                     const char* model_id,
+                                     const size_t* indptr,
+                                     const unsigned* indices,
+                                     const bst_float* data,
+                                     size_t nindptr,
+                                     size_t nelem,
+                                     int option_mask,
+                                     unsigned ntree_limit,
+                                     xgboost::bst_ulong out_size,
+                                     bst_float* out_result,
+                                     xgboost::bst_ulong* out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  CHECK_GE(nindptr, 1U);
+  CHECK_EQ(indptr[nindptr - 1], nelem) << "indptr does not match nelem";
+  const auto* registry = static_cast<const predictor::ModelRegistry*>(handle);
+  const predictor::ModelRegistry::Model& model = registry->Get(model_id);
+  PredictToBuffer(
+      nindptr - 1, model.num_output_group, option_mask,
+      [&](bst_float* out) {
+        registry->PredictFromCSR(model, indptr, indices, data, nindptr - 1, ntree_limit, out);
+      },
+      [&](HostDeviceVector<bst_float>* preds) { model.PredTransform(preds); },
+      out_size, out_result, out_len);
+  API_END();
+}
+
+XGB_DLL int XGBoosterSaveQuantizedModel(BoosterHandle handle,
+                                        const char* fname) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
+  const gbm::GBTreeModel* model = bst->learner()->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr) << "quantized models only support booster=gbtree";
+  predictor::QuantizedForest forest;
+  forest.Build(*model);
+  std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname, "w"));
+  forest.Save(fo.get());
+  API_END();
+}
+
+XGB_DLL int XGQuantizedModelLoad(const char* fname,
+                                 QuantizedModelHandle* out) {
+  API_BEGIN();
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname, "r"));
+  std::unique_ptr<predictor::QuantizedForest> forest(new predictor::QuantizedForest());
+  forest->Load(fi.get());
+  *out = forest.release();
+  API_END();
+}
+
+XGB_DLL int XGQuantizedModelFree(QuantizedModelHandle handle) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  delete static_cast<predictor::QuantizedForest*>(handle);
+  API_END();
+}
+
+XGB_DLL int XGQuantizedModelPredictFromDense(QuantizedModelHandle handle,
+                                             const bst_float* data,
+                                             xgboost::bst_ulong nrow,
+                                             xgboost::bst_ulong ncol,
+                                             bst_float missing,
+                                             xgboost::bst_ulong out_size,
+                                             bst_float* out_result,
+                                             xgboost::bst_ulong* out_len) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  const auto* forest = static_cast<const predictor::QuantizedForest*>(handle);
+  PredictToBuffer(
+      nrow, forest->NumOutputGroup(), 1,
+      [=](bst_float* out) { forest->PredictFromDense(data, nrow, ncol, missing, out); },
+      [](HostDeviceVector<bst_float>*) {}, out_size, out_result, out_len);
+  API_END();
+}
+
+XGB_DLL int XGBoosterVerifyRobustness(BoosterHandle handle,
+                                      DMatrixHandle dmat,
+                                      float eps,
+                                      xgboost::bst_ulong *out_len,
+                                      const int **out_status,
+                                      const bst_float **out_bound) {
+  std::vector<int>& status = XGBAPIThreadLocalStore::Get()->ret_vec_int;
+  std::vector<bst_float>& bound = XGBAPIThreadLocalStore::Get()->ret_vec_float;
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
+  const gbm::GBTreeModel* model =
+      bst->learner()->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr) << "robustness verification only supports booster=gbtree";
+  robust::RobustVerifier verifier(*model);
+  std::vector<std::pair<std::string, std::string> > cfg(bst->cfg_);
+  std::ostringstream os;
+  os << std::setprecision(std::numeric_limits<float>::max_digits10) << eps;
+  cfg.emplace_back("verify_eps", os.str());
+  verifier.Configure(cfg);
+  const std::shared_ptr<DMatrix>& fmat = *static_cast<std::shared_ptr<DMatrix>*>(dmat);
+  if (bst->verify_fmat_.lock() != fmat) {
+    bst->verify_summary_.Clear();
+    bst->verify_fmat_ = fmat;
+  }
+  verifier.Verify(fmat.get(), &status, &bound, &bst->verify_summary_);
+  *out_status = dmlc::BeginPtr(status);
+  *out_bound = dmlc::BeginPtr(bound);
+  *out_len = static_cast<xgboost::bst_ulong>(status.size());
+  API_END();
+}
+
+XGB_DLL int XGBoosterAttackLinf(BoosterHandle handle,
+                                DMatrixHandle dmat,
+                                float eps,
+                                xgboost::bst_ulong *out_len,
+                                const bst_float **out_dist) {
+  std::vector<bst_float>& dist = XGBAPIThreadLocalStore::Get()->ret_vec_float;
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
+  const gbm::GBTreeModel* model =
+      bst->learner()->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr) << "attack only supports booster=gbtree";
+  robust::RobustAttack attack(*model);
+  std::vector<std::pair<std::string, std::string> > cfg(bst->cfg_);
+  std::ostringstream os;
+  os << std::setprecision(std::numeric_limits<float>::max_digits10) << eps;
+  cfg.emplace_back("attack_eps", os.str());
+  attack.Configure(cfg);
+  attack.Attack(static_cast<std::shared_ptr<DMatrix>*>(dmat)->get(), &dist, nullptr);
+  *out_dist = dmlc::BeginPtr(dist);
+  *out_len = static_cast<xgboost::bst_ulong>(dist.size());
+  API_END();
+}
+
+XGB_DLL int XGBoosterRadiusLinf(BoosterHandle handle,
+                                DMatrixHandle dmat,
+                                float max_eps,
+                                xgboost::bst_ulong *out_len,
+                                const bst_float **out_bounds) {
+  std::vector<bst_float>& bounds = XGBAPIThreadLocalStore::Get()->ret_vec_float;
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
+  const gbm::GBTreeModel* model =
+      bst->learner()->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr) << "radius search only supports booster=gbtree";
+  DMatrix* fmat = static_cast<std::shared_ptr<DMatrix>*>(dmat)->get();
+  std::ostringstream os;
+  os << std::setprecision(std::numeric_limits<float>::max_digits10) << max_eps;
+  // the attack gives the upper ends the verifier bisects from
+  std::vector<bst_float> dist;
+  robust::RobustAttack attack(*model);
+  std::vector<std::pair<std::string, std::string> > cfg(bst->cfg_);
+  cfg.emplace_back("attack_eps", os.str());
+  attack.Configure(cfg);
+  attack.Attack(fmat, &dist, nullptr);
+  robust::RobustVerifier verifier(*model);
+  cfg = bst->cfg_;
+  cfg.emplace_back("verify_eps", os.str());
+  cfg.emplace_back("verify_norm", "inf");
+  verifier.Configure(cfg);
+  std::vector<bst_float> lower, upper;
+  verifier.SearchRadius(fmat, dist, &lower, &upper);
+  bounds.resize(lower.size() * 2);
+  for (size_t i = 0; i < lower.size(); ++i) {
+    bounds[i * 2] = lower[i];
+    bounds[i * 2 + 1] = upper[i];
+  }
+  *out_bounds = dmlc::BeginPtr(bounds);
+  *out_len = static_cast<xgboost::bst_ulong>(lower.size());
+  API_END();
+}
+
+XGB_DLL int XGBoosterExportMilp(BoosterHandle handle,
+                                DMatrixHandle dmat,
+                                xgboost::bst_ulong row,
+                                int target,
+                                float eps,
+                                const char *format,
+                                const char **out_model) {
+  std::string& model_str = XGBAPIThreadLocalStore::Get()->ret_str;
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
+  const gbm::GBTreeModel* model =
+      bst->learner()->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr) << "MILP export only supports booster=gbtree";
+  robust::RobustMilp milp(*model);
+  std::vector<std::pair<std::string, std::string> > cfg(bst->cfg_);
+  std::ostringstream os;
+  os << std::setprecision(std::numeric_limits<float>::max_digits10) << eps;
+  cfg.emplace_back("milp_eps", os.str());
+  cfg.emplace_back("milp_format", format);
+  milp.Configure(cfg);
+  std::ostringstream out;
+  milp.Export(static_cast<std::shared_ptr<DMatrix>*>(dmat)->get(),
+              static_cast<size_t>(row), target, &out);
+  model_str = out.str();
+  *out_model = model_str.c_str();
+  API_END();
+}
+
+XGB_DLL int XGBoosterCompactModel(BoosterHandle handle,
+                                  const char *fold,
+                                  xgboost::bst_ulong *out_num_tree,
+                                  xgboost::bst_ulong *out_num_node) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
+  std::vector<std::pair<std::string, std::string> > cfg(bst->cfg_);
+  cfg.emplace_back("compact_fold", fold);
+  gbm::CompactStats stats;
+  CHECK(bst->learner()->Compact(cfg, &stats)) << "compaction only supports booster=gbtree";
+  *out_num_tree = static_cast<xgboost::bst_ulong>(stats.num_trees_after);
+  *out_num_node = static_cast<xgboost::bst_ulong>(stats.num_nodes_after);
+  API_END();
+}
+
+XGB_DLL int XGBoosterGetThresholdIndex(BoosterHandle handle,
+                                       xgboost::bst_ulong *out_num_feature,
+                                       const xgboost::bst_ulong **out_feature_ptr,
+                                       const bst_float **out_thresholds,
+                                       const xgboost::bst_ulong **out_node_ptr,
+                                       const unsigned **out_nodes) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
+  const gbm::GBTreeModel* model =
+      bst->learner()->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr) << "threshold index only supports booster=gbtree";
+  const gbm::FeatureThresholdIndex& index = model->GetThresholdIndex();
+  static_assert(sizeof(std::pair<bst_uint, bst_uint>) == 2 * sizeof(unsigned),
+                "node pairs must be two packed unsigned values");
+  *out_num_feature = static_cast<xgboost::bst_ulong>(index.NumFeature());
+  *out_feature_ptr = dmlc::BeginPtr(index.feature_ptr);
+  *out_thresholds = dmlc::BeginPtr(index.thresholds);
+  *out_node_ptr = dmlc::BeginPtr(index.node_ptr);
+  *out_nodes = reinterpret_cast<const unsigned*>(dmlc::BeginPtr(index.nodes));
+  API_END();
+}
+
+XGB_DLL int XGBoosterGetFeatureImportance(BoosterHandle handle,
+                                          xgboost::bst_ulong *out_len,
+                                          const double **out_gain,
+                                          const double **out_cover,
+                                          const xgboost::bst_ulong **out_count) {
+  gbm::FeatureImportance& ret = XGBAPIThreadLocalStore::Get()->ret_importance;
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
+  const gbm::GBTreeModel* model =
+      bst->learner()->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr) << "feature importance only supports booster=gbtree";
+  ret = model->GetImportance();
+  ret.Resize(std::max(ret.count.size(), static_cast<size_t>(model->param.num_feature)));
+  *out_len = static_cast<xgboost::bst_ulong>(ret.count.size());
+  *out_gain = dmlc::BeginPtr(ret.gain);
+  *out_cover = dmlc::BeginPtr(ret.cover);
+  *out_count = dmlc::BeginPtr(ret.count);
+  API_END();
+}
+
+XGB_DLL int XGBoosterExportTrees(BoosterHandle handle,
+                                 xgboost::bst_ulong *out_num_tree,
+                                 const xgboost::bst_ulong **out_tree_ptr,
+                                 const int **out_tree_group,
+                                 const int **out_split_index,
+                                 const bst_float **out_split_cond,
+                                 const int **out_left_child,
+                                 const int **out_right_child,
+                                 const int **out_default_left,
+                                 const bst_float **out_leaf_value,
+                                 const bst_float **out_cover) {
+  gbm::FlatTreeArrays& ret = XGBAPIThreadLocalStore::Get()->ret_trees;
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto *bst = static_cast<Booster*>(handle);
+  bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
+  const gbm::GBTreeModel* model =
+      bst->learner()->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr) << "tree export only supports booster=gbtree";
+  model->ExportFlat(&ret);
+  *out_num_tree = static_cast<xgboost::bst_ulong>(ret.tree_ptr.size() - 1);
+  *out_tree_ptr = dmlc::BeginPtr(ret.tree_ptr);
+  *out_tree_group = dmlc::BeginPtr(ret.tree_group);
+  *out_split_index = dmlc::BeginPtr(ret.split_index);
+  *out_split_cond = dmlc::BeginPtr(ret.split_cond);
+  *out_left_child = dmlc::BeginPtr(ret.left_child);
+  *out_right_child = dmlc::BeginPtr(ret.right_child);
+  *out_default_left = dmlc::BeginPtr(ret.default_left);
+  *out_leaf_value = dmlc::BeginPtr(ret.leaf_value);
+  *out_cover = dmlc::BeginPtr(ret.cover);
+  API_END();
+}
+
 XGB_DLL int XGBoosterLoadModel(BoosterHandle handle, const char* fname) {
   API_BEGIN();
   CHECK_HANDLE();
@@ -992,6 +2206,7 @@ inline void XGBoostDumpModelImpl(
   std::vector<const char*>& charp_vecs = XGBAPIThreadLocalStore::Get()->ret_vec_charp;
   auto *bst = static_cast<Booster*>(handle);
   bst->LazyInit();
+  common::OmpThreadScope threads(bst->learner()->NumThreads());
   str_vecs = bst->learner()->DumpModel(fmap, with_stats != 0, format);
   charp_vecs.resize(str_vecs.size());
   for (size_t i = 0; i < str_vecs.size(); ++i) {
@@ -1128,5 +2343,34 @@ XGB_DLL int XGBoosterSaveRabitCheckpoint(BoosterHandle handle) {
   API_END();
 }
 
+XGB_DLL int XGBoosterLoadRabitCheckpointWithState(BoosterHandle handle,
+                                                  DMatrixHandle dtrain,
+                                                  int* version) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Booster*>(handle);
+  DMatrix* dmat = static_cast<std::shared_ptr<DMatrix>*>(dtrain)->get();
+  common::TrainState state(bst->learner(), dmat);
+  *version = rabit::LoadCheckPoint(bst->learner(), &state);
+  if (*version != 0) {
+    bst->initialized_ = true;
+    if (!state.Restore()) {
+      LOG(INFO) << "no training state in the rabit checkpoint, the training data are predicted";
+    }
+  }
+  API_END();
+}
+
+XGB_DLL int XGBoosterSaveRabitCheckpointWithState(BoosterHandle handle,
+                                                  DMatrixHandle dtrain) {
+  API_BEGIN();
+  CHECK_HANDLE();
+  auto* bst = static_cast<Booster*>(handle);
+  DMatrix* dmat = static_cast<std::shared_ptr<DMatrix>*>(dtrain)->get();
+  common::TrainState state(bst->learner(), dmat);
+  rabit::CheckPoint(bst->learner(), &state);
+  API_END();
+}
+
 // force link rabit
 static DMLC_ATTRIBUTE_UNUSED int XGBOOST_LINK_RABIT_C_API_ = RabitLinkTag();
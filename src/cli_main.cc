@@ -10,17 +10,36 @@
 #define NOMINMAX
 
 #include <xgboost/learner.h>
+#include <xgboost/gbm.h>
 #include <xgboost/data.h>
 #include <xgboost/logging.h>
 #include <dmlc/timer.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <iomanip>
+#include <limits>
+#include <cmath>
 #include <ctime>
+#include <mutex>
 #include <string>
 #include <cstdio>
 #include <cstring>
+#include <sstream>
+#include <thread>
+#include <utility>
 #include <vector>
 #include "./common/sync.h"
 #include "./common/config.h"
+#include "./common/io.h"
+#include "./common/random.h"
+#include "./common/train_state.h"
+#include "./data/simple_csr_source.h"
+#include "./gbm/model_compactor.h"
+#include "./gbm/model_compiler.h"
+#include "./robust/robust_attack.h"
+#include "./robust/robust_verifier.h"
 
 
 namespace xgboost {
@@ -28,7 +47,21 @@ namespace xgboost {
 enum CLITask {
   kTrain = 0,
   kDumpModel = 1,
-  kPredict = 2
+  kPredict = 2,
+  kVerify = 3,
+  kAttack = 4,
+  kCompile = 5,
+  kCompact = 6
+};
+
+/*! \brief the format of the prediction file */
+enum PredFormat {
+  /*! \brief one value per line */
+  kPredText = 0,
+  /*! \brief the raw float32 values of the host byte order */
+  kPredFloat32 = 1,
+  /*! \brief a numpy array of shape (rows,) or (rows, values per row) */
+  kPredNpy = 2
 };
 
 struct CLIParam : public dmlc::Parameter<CLIParam> {
@@ -40,8 +73,16 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
   bool eval_train;
   /*! \brief number of boosting iterations */
   int num_round;
+  /*! \brief the period in rounds of the evaluation, the last round is always evaluated */
+  int eval_period;
   /*! \brief the period to save the model, 0 means only save the final round model */
   int save_period;
+  /*! \brief number of checkpoints that may wait to be written in the background */
+  int save_queue_size;
+  /*! \brief whether checkpoints after the first only save the trees added since */
+  bool save_segments;
+  /*! \brief whether checkpoints save the training margins and random state beside them */
+  bool save_train_state;
   /*! \brief the path of training set */
   std::string train_path;
   /*! \brief path of test dataset */
@@ -54,12 +95,20 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
   std::string model_dir;
   /*! \brief name of predict file */
   std::string name_pred;
+  /*! \brief name of verification result file */
+  std::string name_verify;
+  /*! \brief name of attack result file */
+  std::string name_attack;
+  /*! \brief name of compiled model source file */
+  std::string name_compile;
   /*! \brief data split mode */
   int dsplit;
   /*!\brief limit number of trees in prediction */
   int ntree_limit;
   /*!\brief whether to directly output margin value */
   bool pred_margin;
+  /*! \brief the format of the prediction file, a PredFormat */
+  int pred_format;
   /*! \brief whether dump statistics along with model */
   int dump_stats;
   /*! \brief what format to dump the model in */
@@ -68,6 +117,8 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
   std::string name_fmap;
   /*! \brief name of dump file */
   std::string name_dump;
+  /*! \brief comma separated robust_eps values to train in one run */
+  std::string robust_eps_list;
   /*! \brief the paths of validation data sets */
   std::vector<std::string> eval_data_paths;
   /*! \brief the names of the evaluation data used in output log */
@@ -82,6 +133,10 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
         .add_enum("train", kTrain)
         .add_enum("dump", kDumpModel)
         .add_enum("pred", kPredict)
+        .add_enum("verify", kVerify)
+        .add_enum("attack", kAttack)
+        .add_enum("compile", kCompile)
+        .add_enum("compact", kCompact)
         .describe("Task to be performed by the CLI program.");
     DMLC_DECLARE_FIELD(silent).set_default(0).set_range(0, 2)
         .describe("Silent level during the task.");
@@ -89,6 +144,22 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
         .describe("Whether evaluate on training data during training.");
     DMLC_DECLARE_FIELD(num_round).set_default(10).set_lower_bound(1)
         .describe("Number of boosting iterations");
+    DMLC_DECLARE_FIELD(eval_period).set_default(1).set_lower_bound(1)
+        .describe("Evaluate every eval_period rounds and the last one. The margins of "
+                  "the evaluation sets are updated with the prediction cache each "
+                  "round, so an evaluation only copies them.");
+    DMLC_DECLARE_FIELD(save_queue_size).set_default(2).set_lower_bound(0)
+        .describe("Number of checkpoints that may wait to be written by the "
+                  "background thread, 0 writes them synchronously.");
+    DMLC_DECLARE_FIELD(save_segments).set_default(false)
+        .describe("Whether periodic checkpoints after the first save only the "
+                  "trees added since the previous one.");
+    DMLC_DECLARE_FIELD(save_train_state).set_default(false)
+        .describe("Whether each checkpoint saves the margins of the training data "
+                  "and the random state beside it, which training resumed from "
+                  "it with model_in loads instead of predicting the data again. "
+                  "In distributed training the rabit checkpoints keep them, for "
+                  "the recovery of a worker.");
     DMLC_DECLARE_FIELD(save_period).set_default(0).set_lower_bound(0)
         .describe("The period to save the model, 0 means only save final model.");
     DMLC_DECLARE_FIELD(train_path).set_default("NULL")
@@ -103,6 +174,12 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
         .describe("Output directory of period checkpoint.");
     DMLC_DECLARE_FIELD(name_pred).set_default("pred.txt")
         .describe("Name of the prediction file.");
+    DMLC_DECLARE_FIELD(name_verify).set_default("verify.txt")
+        .describe("Name of the robustness verification result file.");
+    DMLC_DECLARE_FIELD(name_attack).set_default("attack.txt")
+        .describe("Name of the adversarial attack result file.");
+    DMLC_DECLARE_FIELD(name_compile).set_default("model.c")
+        .describe("Name of the C source file of the compiled model.");
     DMLC_DECLARE_FIELD(dsplit).set_default(0)
         .add_enum("auto", 0)
         .add_enum("col", 1)
@@ -112,6 +189,12 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
         .describe("Number of trees used for prediction, 0 means use all trees.");
     DMLC_DECLARE_FIELD(pred_margin).set_default(false)
         .describe("Whether to predict margin value instead of probability.");
+    DMLC_DECLARE_FIELD(pred_format).set_default(kPredText)
+        .add_enum("text", kPredText)
+        .add_enum("float32", kPredFloat32)
+        .add_enum("npy", kPredNpy)
+        .describe("Format of the prediction file: one value per line, the raw "
+                  "float32 values, or a numpy array.");
     DMLC_DECLARE_FIELD(dump_stats).set_default(false)
         .describe("Whether dump the model statistics.");
     DMLC_DECLARE_FIELD(dump_format).set_default("text")
@@ -120,6 +203,10 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
         .describe("Name of the feature map file.");
     DMLC_DECLARE_FIELD(name_dump).set_default("dump.txt")
         .describe("Name of the output dump text file.");
+    DMLC_DECLARE_FIELD(robust_eps_list).set_default("")
+        .describe("Comma separated list of robust_eps values. If set, one model "
+                  "per value is trained on the same loaded data, and the models are "
+                  "saved with an .eps<value> suffix.");
     // alias
     DMLC_DECLARE_ALIAS(train_path, data);
     DMLC_DECLARE_ALIAS(test_path, test:data);
@@ -154,6 +241,322 @@ struct CLIParam : public dmlc::Parameter<CLIParam> {
 
 DMLC_REGISTER_PARAMETER(CLIParam);
 
+/*! \brief magic of the model segment files */
+const char* const kModelSegmentMagic = "xgsg";
+/*! \brief the training state saved beside checkpoint fname */
+inline std::string TrainStateName(const std::string& fname) {
+  return fname + ".state";
+}
+
+/*!
+ * \brief writes model checkpoints on a background thread.
+ *  Save serializes the learner into memory on the calling thread, which is a
+ *  copy at memory speed, and the I/O thread writes the bytes to the stream,
+ *  so training goes on while a checkpoint is written. At most queue_size
+ *  checkpoints are held in memory, Save blocks when they are all waiting.
+ *  An error of the I/O thread is raised by the next Save or Finish.
+ */
+class CheckpointWriter {
+ public:
+  explicit CheckpointWriter(int queue_size) : queue_size_(queue_size) {
+    if (queue_size_ > 0) {
+      thread_ = std::thread([this]() { this->Run(); });
+    }
+  }
+  ~CheckpointWriter() {
+    this->Stop();
+  }
+  /*! \brief save the current model of learner to fname */
+  void Save(Learner* learner, const std::string& fname) {
+    std::string data;
+    common::MemoryBufferStream fs(&data);
+    learner->Save(&fs);
+    this->Push(fname, std::move(data));
+  }
+  /*!
+   * \brief save the trees of learner after the first base_ntree to fname, a
+   *  segment that extends the checkpoint base in the same directory.
+   */
+  void SaveSegment(Learner* learner, const std::string& fname,
+                   const std::string& base, size_t base_ntree) {
+    std::string data;
+    common::MemoryBufferStream fs(&data);
+    dmlc::Stream* fo = &fs;
+    fo->Write(kModelSegmentMagic, 4);
+    fo->Write(base.substr(base.find_last_of("/\\") + 1));
+    const uint64_t ntree = base_ntree;
+    fo->Write(&ntree, sizeof(ntree));
+    learner->SaveSegment(fo, base_ntree);
+    this->Push(fname, std::move(data));
+  }
+  /*!
+   * \brief save the state of training beside a checkpoint of learner: the
+   *  margins of dtrain, served by the prediction cache, and the random state.
+   */
+  void SaveTrainState(Learner* learner, DMatrix* dtrain, const std::string& fname) {
+    if (learner->GetGradientBooster()->GetTreeModel() == nullptr) return;
+    std::string data;
+    common::MemoryBufferStream fo(&data);
+    common::TrainState(learner, dtrain).Save(&fo);
+    this->Push(TrainStateName(fname), std::move(data));
+  }
+  /*! \brief wait until all checkpoints are written */
+  void Finish() {
+    this->Stop();
+    if (error_ != nullptr) std::rethrow_exception(error_);
+  }
+
+ private:
+  void Push(const std::string& fname, std::string&& data) {
+    if (queue_size_ == 0) {
+      Write(fname, data);
+      return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() {
+        return error_ != nullptr || queue_.size() < static_cast<size_t>(queue_size_);
+      });
+    if (error_ != nullptr) std::rethrow_exception(error_);
+    queue_.emplace_back(fname, std::move(data));
+    cond_.notify_all();
+  }
+  static void Write(const std::string& fname, const std::string& data) {
+    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname.c_str(), "w"));
+    fo->Write(data.data(), data.length());
+  }
+  void Stop() {
+    if (!thread_.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    cond_.notify_all();
+    thread_.join();
+  }
+  void Run() {
+    while (true) {
+      std::pair<std::string, std::string> item;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() { return done_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+        // the entry stays in the queue until written, it counts to the bound
+        item = std::move(queue_.front());
+      }
+      std::exception_ptr error;
+      try {
+        Write(item.first, item.second);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.pop_front();
+        if (error != nullptr) {
+          error_ = error;
+          queue_.clear();
+        }
+      }
+      cond_.notify_all();
+      if (error != nullptr) return;
+    }
+  }
+
+  const int queue_size_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  /*! \brief file name and serialized model of the waiting checkpoints */
+  std::deque<std::pair<std::string, std::string> > queue_;
+  bool done_{false};
+  std::exception_ptr error_;
+};
+
+/*!
+ * \brief the periodic checkpoints of a learner. With save_segments, the first
+ *  checkpoint is a full model and every later one a segment of the trees
+ *  added since the previous checkpoint.
+ */
+class CheckpointChain {
+ public:
+  CheckpointChain(const CLIParam& param, CheckpointWriter* writer, DMatrix* dtrain)
+      : segments_(param.save_segments), writer_(writer),
+        dtrain_(param.save_train_state && !rabit::IsDistributed() ? dtrain : nullptr) {
+    for (const auto& kv : param.cfg) {
+      // the update process rewrites the trees of the checkpoints before
+      CHECK(!segments_ || kv.first != "process_type" || kv.second != "update")
+          << "save_segments is not supported with process_type=update";
+    }
+  }
+  /*!
+   * \brief save a periodic checkpoint of learner to fname, the checkpoint of
+   *  the final round is always a full model.
+   */
+  void Save(Learner* learner, const std::string& fname, bool final_round) {
+    if (dtrain_ != nullptr) {
+      writer_->SaveTrainState(learner, dtrain_, fname);
+    }
+    if (!segments_ || final_round) {
+      writer_->Save(learner, fname);
+      return;
+    }
+    const gbm::GBTreeModel* model = learner->GetGradientBooster()->GetTreeModel();
+    CHECK(model != nullptr) << "save_segments requires booster=gbtree";
+    if (last_.length() == 0) {
+      writer_->Save(learner, fname);
+    } else {
+      writer_->SaveSegment(learner, fname, last_, last_ntree_);
+    }
+    last_ = fname;
+    last_ntree_ = model->trees.size();
+  }
+
+ private:
+  const bool segments_;
+  CheckpointWriter* writer_;
+  /*! \brief the training data whose state is saved, nullptr if not save_train_state */
+  DMatrix* dtrain_;
+  /*! \brief the previous checkpoint and its number of trees */
+  std::string last_;
+  size_t last_ntree_{0};
+};
+
+/*!
+ * \brief load the model in fname to learner. A model segment loads the
+ *  checkpoints it extends first, and appends its trees to them.
+ */
+// whether round i of training is evaluated
+inline bool EvalRound(const CLIParam& param, int i) {
+  return (i + 1) % param.eval_period == 0 || i + 1 == param.num_round;
+}
+
+void LoadModel(const std::string& fname, Learner* learner) {
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(fname.c_str(), "r"));
+  common::PeekableInStream fp(fi.get());
+  std::string header;
+  header.resize(4);
+  if (fp.PeekRead(&header[0], 4) != 4 || header != kModelSegmentMagic) {
+    learner->Load(&fp);
+    return;
+  }
+  dmlc::Stream* fs = &fp;
+  CHECK_EQ(fs->Read(&header[0], 4), 4U);
+  std::string base;
+  CHECK(fs->Read(&base)) << "invalid model segment " << fname;
+  uint64_t base_ntree;
+  CHECK_EQ(fs->Read(&base_ntree, sizeof(base_ntree)), sizeof(base_ntree))
+      << "invalid model segment " << fname;
+  const size_t pos = fname.find_last_of("/\\");
+  LoadModel(pos == std::string::npos ? base : fname.substr(0, pos + 1) + base, learner);
+  const gbm::GBTreeModel* model = learner->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr && model->trees.size() == base_ntree)
+      << "model segment " << fname << " does not extend " << base;
+  learner->LoadSegment(fs);
+}
+
+/*!
+ * \brief restore the state saved beside the checkpoint fname that learner is
+ *  loaded from, if there is one: the margins of dtrain go to the prediction
+ *  cache and the random state is resumed.
+ */
+void LoadTrainState(const std::string& fname, Learner* learner, DMatrix* dtrain) {
+  const std::string state = TrainStateName(fname);
+  std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(state.c_str(), "r", true));
+  if (fi == nullptr) {
+    LOG(INFO) << "no training state " << state << ", the training data are predicted";
+    return;
+  }
+  common::TrainState train_state(learner, dtrain);
+  train_state.Load(fi.get());
+  if (!train_state.Restore()) {
+    LOG(WARNING) << "training state " << state << " does not match the model "
+                 << "and the training data, it is ignored";
+  }
+}
+
+/*!
+ * \brief train one model per value of robust_eps_list on shared data.
+ *  The training matrix, and with it the sorted column pages built by the
+ *  first learner, are shared by all models; the models advance round by
+ *  round in lockstep.
+ */
+void CLITrainMultiEps(const CLIParam& param,
+                      std::shared_ptr<DMatrix> dtrain,
+                      const std::vector<std::shared_ptr<DMatrix> >& cache_mats,
+                      const std::vector<DMatrix*>& eval_datasets,
+                      const std::vector<std::string>& eval_data_names) {
+  CHECK(!rabit::IsDistributed())
+      << "robust_eps_list is not supported in distributed training";
+  std::vector<std::string> eps_list;
+  {
+    std::istringstream is(param.robust_eps_list);
+    std::string eps;
+    while (std::getline(is, eps, ',')) {
+      if (eps.length() != 0) eps_list.push_back(eps);
+    }
+  }
+  CHECK_NE(eps_list.size(), 0U) << "robust_eps_list is empty";
+  std::vector<std::unique_ptr<Learner> > learners;
+  for (const auto& eps : eps_list) {
+    std::vector<std::pair<std::string, std::string> > cfg = param.cfg;
+    cfg.emplace_back("robust_eps", eps);
+    learners.emplace_back(Learner::Create(cache_mats));
+    if (param.model_in != "NULL") {
+      LoadModel(param.model_in, learners.back().get());
+      learners.back()->Configure(cfg);
+      if (param.save_train_state) {
+        LoadTrainState(param.model_in, learners.back().get(), dtrain.get());
+      }
+    } else {
+      learners.back()->Configure(cfg);
+      learners.back()->InitModel();
+    }
+  }
+  CheckpointWriter writer(param.save_queue_size);
+  std::vector<CheckpointChain> chains(learners.size(),
+                                     CheckpointChain(param, &writer, dtrain.get()));
+  auto save = [&](size_t k, int nround, bool final_round) {
+    std::ostringstream os;
+    if (final_round && param.model_out != "NULL") {
+      os << param.model_out << ".eps" << eps_list[k];
+    } else {
+      os << param.model_dir << '/'
+         << std::setfill('0') << std::setw(4)
+         << nround << ".eps" << eps_list[k] << ".model";
+    }
+    chains[k].Save(learners[k].get(), os.str(), final_round || nround == param.num_round);
+  };
+  const double start = dmlc::GetTime();
+  for (int i = 0; i < param.num_round; ++i) {
+    if (param.silent == 0) {
+      LOG(CONSOLE) << "boosting round " << i << ", "
+                   << dmlc::GetTime() - start << " sec elapsed";
+    }
+    for (size_t k = 0; k < learners.size(); ++k) {
+      learners[k]->UpdateOneIter(i, dtrain.get());
+      if (EvalRound(param, i)) {
+        std::string res = learners[k]->EvalOneIter(i, eval_datasets, eval_data_names);
+        if (param.silent < 2) {
+          LOG(CONSOLE) << "[eps=" << eps_list[k] << "]" << res;
+        }
+      }
+      if (param.save_period != 0 && (i + 1) % param.save_period == 0) {
+        save(k, i + 1, false);
+      }
+    }
+  }
+  if ((param.save_period == 0 || param.num_round % param.save_period != 0) &&
+      param.model_out != "NONE") {
+    for (size_t k = 0; k < learners.size(); ++k) {
+      save(k, param.num_round, true);
+    }
+  }
+  writer.Finish();
+  if (param.silent == 0) {
+    LOG(CONSOLE) << "update end, " << dmlc::GetTime() - start << " sec in all";
+  }
+}
+
 void CLITrain(const CLIParam& param) {
   const double tstart_data_load = dmlc::GetTime();
   if (rabit::IsDistributed()) {
@@ -179,16 +582,38 @@ void CLITrain(const CLIParam& param) {
     eval_datasets.push_back(dtrain.get());
     eval_data_names.emplace_back("train");
   }
+  if (param.robust_eps_list.length() != 0) {
+    CLITrainMultiEps(param, dtrain, cache_mats, eval_datasets, eval_data_names);
+    return;
+  }
   // initialize the learner.
   std::unique_ptr<Learner> learner(Learner::Create(cache_mats));
-  int version = rabit::LoadCheckPoint(learner.get());
+  // distributed, the margins of the rows of each worker are the local model
+  // of the rabit checkpoints
+  const bool local_state = param.save_train_state && rabit::IsDistributed();
+  common::TrainState train_state(learner.get(), dtrain.get());
+  int version = local_state ? rabit::LoadCheckPoint(learner.get(), &train_state)
+                            : rabit::LoadCheckPoint(learner.get());
+  if (version != 0 && local_state && !train_state.Restore()) {
+    LOG(INFO) << "no training state in the rabit checkpoint, the training data are predicted";
+  }
+  auto checkpoint = [&]() {
+    if (local_state) {
+      rabit::CheckPoint(learner.get(), &train_state);
+    } else if (learner->AllowLazyCheckPoint()) {
+      rabit::LazyCheckPoint(learner.get());
+    } else {
+      rabit::CheckPoint(learner.get());
+    }
+  };
   if (version == 0) {
     // initialize the model if needed.
     if (param.model_in != "NULL") {
-      std::unique_ptr<dmlc::Stream> fi(
-          dmlc::Stream::Create(param.model_in.c_str(), "r"));
-      learner->Load(fi.get());
+      LoadModel(param.model_in, learner.get());
       learner->Configure(param.cfg);
+      if (param.save_train_state && !rabit::IsDistributed()) {
+        LoadTrainState(param.model_in, learner.get(), dtrain.get());
+      }
     } else {
       learner->Configure(param.cfg);
       learner->InitModel();
@@ -198,6 +623,8 @@ void CLITrain(const CLIParam& param) {
     LOG(INFO) << "Loading data: " << dmlc::GetTime() - tstart_data_load << " sec";
   }
   // start training.
+  CheckpointWriter writer(param.save_queue_size);
+  CheckpointChain chain(param, &writer, dtrain.get());
   const double start = dmlc::GetTime();
   for (int i = version / 2; i < param.num_round; ++i) {
     double elapsed = dmlc::GetTime() - start;
@@ -206,22 +633,20 @@ void CLITrain(const CLIParam& param) {
         LOG(CONSOLE) << "boosting round " << i << ", " << elapsed << " sec elapsed";
       }
       learner->UpdateOneIter(i, dtrain.get());
-      if (learner->AllowLazyCheckPoint()) {
-        rabit::LazyCheckPoint(learner.get());
-      } else {
-        rabit::CheckPoint(learner.get());
-      }
+      checkpoint();
       version += 1;
     }
     CHECK_EQ(version, rabit::VersionNumber());
-    std::string res = learner->EvalOneIter(i, eval_datasets, eval_data_names);
-    if (rabit::IsDistributed()) {
-      if (rabit::GetRank() == 0) {
-        LOG(TRACKER) << res;
-      }
-    } else {
-      if (param.silent < 2) {
-        LOG(CONSOLE) << res;
+    if (EvalRound(param, i)) {
+      std::string res = learner->EvalOneIter(i, eval_datasets, eval_data_names);
+      if (rabit::IsDistributed()) {
+        if (rabit::GetRank() == 0) {
+          LOG(TRACKER) << res;
+        }
+      } else {
+        if (param.silent < 2) {
+          LOG(CONSOLE) << res;
+        }
       }
     }
     if (param.save_period != 0 &&
@@ -231,16 +656,10 @@ void CLITrain(const CLIParam& param) {
       os << param.model_dir << '/'
          << std::setfill('0') << std::setw(4)
          << i + 1 << ".model";
-      std::unique_ptr<dmlc::Stream> fo(
-          dmlc::Stream::Create(os.str().c_str(), "w"));
-      learner->Save(fo.get());
+      chain.Save(learner.get(), os.str(), i + 1 == param.num_round);
     }
 
-    if (learner->AllowLazyCheckPoint()) {
-      rabit::LazyCheckPoint(learner.get());
-    } else {
-      rabit::CheckPoint(learner.get());
-    }
+    checkpoint();
     version += 1;
     CHECK_EQ(version, rabit::VersionNumber());
   }
@@ -256,10 +675,12 @@ void CLITrain(const CLIParam& param) {
     } else {
       os << param.model_out;
     }
-    std::unique_ptr<dmlc::Stream> fo(
-        dmlc::Stream::Create(os.str().c_str(), "w"));
-    learner->Save(fo.get());
+    if (param.save_train_state && !rabit::IsDistributed()) {
+      writer.SaveTrainState(learner.get(), dtrain.get(), os.str());
+    }
+    writer.Save(learner.get(), os.str());
   }
+  writer.Finish();
 
   if (param.silent == 0) {
     double elapsed = dmlc::GetTime() - start;
@@ -279,10 +700,8 @@ void CLIDumpModel(const CLIParam& param) {
   CHECK_NE(param.model_in, "NULL")
       << "Must specify model_in for dump";
   std::unique_ptr<Learner> learner(Learner::Create({}));
-  std::unique_ptr<dmlc::Stream> fi(
-      dmlc::Stream::Create(param.model_in.c_str(), "r"));
   learner->Configure(param.cfg);
-  learner->Load(fi.get());
+  LoadModel(param.model_in, learner.get());
   // dump data
   std::vector<std::string> dump = learner->DumpModel(
       fmap, param.dump_stats, param.dump_format);
@@ -306,6 +725,165 @@ void CLIDumpModel(const CLIParam& param) {
   os.set_stream(nullptr);
 }
 
+/*!
+ * \brief writes the predictions of the pages of a test set on a background
+ *  thread, so that the formatting and the I/O of a page overlap the
+ *  prediction of the next one. At most kQueueSize pages wait in memory, Push
+ *  blocks when they are all waiting. An error of the I/O thread is raised by
+ *  the next Push or Finish.
+ */
+class PredictionWriter {
+ public:
+  static const size_t kQueueSize = 2;
+
+  PredictionWriter(const std::string& fname, int format, size_t num_row)
+      : fo_(dmlc::Stream::Create(fname.c_str(), "w")), format_(format), num_row_(num_row) {
+    thread_ = std::thread([this]() { this->Run(); });
+  }
+  ~PredictionWriter() {
+    this->Stop();
+  }
+  /*! \brief write the predictions of the next nrow rows */
+  void Push(const std::vector<bst_float>& preds, size_t nrow) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() {
+        return error_ != nullptr || queue_.size() < kQueueSize;
+      });
+    if (error_ != nullptr) std::rethrow_exception(error_);
+    queue_.emplace_back(nrow, preds);
+    cond_.notify_all();
+  }
+  /*! \brief wait until all predictions are written */
+  void Finish() {
+    this->Stop();
+    if (error_ != nullptr) std::rethrow_exception(error_);
+    if (format_ == kPredNpy && num_written_ == 0) this->WriteNpyHeader(1);
+    CHECK_EQ(num_written_, num_row_) << "the pages miss rows of the test set";
+  }
+
+ private:
+  void Write(size_t nrow, const std::vector<bst_float>& preds) {
+    if (format_ == kPredText) {
+      // %.*g prints as a stream of that precision does
+      const int digits = std::numeric_limits<bst_float>::max_digits10 + 2;
+      char num[32];
+      text_.clear();
+      for (bst_float p : preds) {
+        const int n = snprintf(num, sizeof(num), "%.*g\n", digits, p);
+        text_.append(num, n);
+      }
+      fo_->Write(text_.data(), text_.length());
+    } else {
+      const size_t ncol = nrow == 0 ? ncol_ : preds.size() / nrow;
+      if (format_ == kPredNpy && num_written_ == 0) this->WriteNpyHeader(ncol);
+      CHECK(ncol_ == 0 || ncol == ncol_) << "the rows of the pages have different outputs";
+      ncol_ = ncol;
+      fo_->Write(dmlc::BeginPtr(preds), preds.size() * sizeof(bst_float));
+    }
+    num_written_ += nrow;
+  }
+  // the header of version 1.0 of the npy format, padded so that the data
+  // starts at a multiple of 64 bytes
+  void WriteNpyHeader(size_t ncol) {
+    const uint16_t one = 1;
+    const bool little = *reinterpret_cast<const char*>(&one) == 1;
+    std::ostringstream os;
+    os << "{'descr': '" << (little ? '<' : '>') << "f4', 'fortran_order': False, 'shape': ("
+       << num_row_;
+    if (ncol == 1) {
+      os << ",), }";
+    } else {
+      os << ", " << ncol << "), }";
+    }
+    std::string header = os.str();
+    const size_t kPrefix = 10;
+    const size_t total = (kPrefix + header.length() + 1 + 63) / 64 * 64;
+    header.append(total - kPrefix - header.length() - 1, ' ');
+    header.push_back('\n');
+    const auto length = static_cast<uint16_t>(header.length());
+    const char prefix[kPrefix] = {'\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                                  static_cast<char>(length & 0xff),
+                                  static_cast<char>(length >> 8)};
+    fo_->Write(prefix, kPrefix);
+    fo_->Write(header.data(), header.length());
+  }
+  void Stop() {
+    if (!thread_.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    cond_.notify_all();
+    thread_.join();
+  }
+  void Run() {
+    while (true) {
+      std::pair<size_t, std::vector<bst_float> > item;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() { return done_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+        // the entry stays in the queue until written, it counts to the bound
+        item = std::move(queue_.front());
+      }
+      std::exception_ptr error;
+      try {
+        Write(item.first, item.second);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.pop_front();
+        if (error != nullptr) {
+          error_ = error;
+          queue_.clear();
+        }
+      }
+      cond_.notify_all();
+      if (error != nullptr) return;
+    }
+  }
+
+  std::unique_ptr<dmlc::Stream> fo_;
+  const int format_;
+  const size_t num_row_;
+  /*! \brief the rows written, and the values of a row once known */
+  size_t num_written_{0};
+  size_t ncol_{0};
+  /*! \brief the text of a page, kept for its capacity */
+  std::string text_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  /*! \brief number of rows and predictions of the waiting pages */
+  std::deque<std::pair<size_t, std::vector<bst_float> > > queue_;
+  bool done_{false};
+  std::exception_ptr error_;
+};
+
+// a DMatrix of the rows of a page of a test set of meta information info
+std::unique_ptr<DMatrix> PageDMatrix(const SparsePage& batch, const MetaInfo& info) {
+  auto* source = new data::SimpleCSRSource();
+  std::unique_ptr<DataSource> holder(source);
+  source->page_.Push(batch);
+  MetaInfo& page_info = source->info;
+  page_info.num_row_ = batch.Size();
+  page_info.num_col_ = info.num_col_;
+  page_info.num_nonzero_ = batch.data.size();
+  const size_t begin = batch.base_rowid, end = batch.base_rowid + batch.Size();
+  if (!info.base_margin_.empty()) {
+    const size_t ngroup = info.base_margin_.size() / info.num_row_;
+    page_info.base_margin_.assign(info.base_margin_.begin() + begin * ngroup,
+                                  info.base_margin_.begin() + end * ngroup);
+  }
+  if (!info.root_index_.empty()) {
+    page_info.root_index_.assign(info.root_index_.begin() + begin,
+                                 info.root_index_.begin() + end);
+  }
+  return std::unique_ptr<DMatrix>(DMatrix::Create(std::move(holder)));
+}
+
 void CLIPredict(const CLIParam& param) {
   CHECK_NE(param.test_path, "NULL")
       << "Test dataset parameter test:data must be specified.";
@@ -316,30 +894,189 @@ void CLIPredict(const CLIParam& param) {
   CHECK_NE(param.model_in, "NULL")
       << "Must specify model_in for predict";
   std::unique_ptr<Learner> learner(Learner::Create({}));
-  std::unique_ptr<dmlc::Stream> fi(
-      dmlc::Stream::Create(param.model_in.c_str(), "r"));
-  learner->Load(fi.get());
+  LoadModel(param.model_in, learner.get());
   learner->Configure(param.cfg);
 
   if (param.silent == 0) {
-    LOG(CONSOLE) << "start prediction...";
+    LOG(CONSOLE) << "start prediction, writing to " << param.name_pred;
   }
+  const MetaInfo& info = dtest->Info();
+  PredictionWriter writer(param.name_pred, param.pred_format, info.num_row_);
   HostDeviceVector<bst_float> preds;
-  learner->Predict(dtest.get(), param.pred_margin, &preds, param.ntree_limit);
+  // a page at a time, so that the memory of the predictions of an external
+  // memory test set is bounded by its pages
+  dmlc::DataIter<SparsePage>* iter = dtest->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const SparsePage& batch = iter->Value();
+    const size_t nrow = batch.Size();
+    if (nrow == info.num_row_) {
+      // the single page of an in memory test set is not copied, the
+      // predictor iterates its rows itself
+      learner->Predict(dtest.get(), param.pred_margin, &preds, param.ntree_limit);
+      writer.Push(preds.ConstHostVector(), nrow);
+      break;
+    }
+    std::unique_ptr<DMatrix> dpage = PageDMatrix(batch, info);
+    learner->Predict(dpage.get(), param.pred_margin, &preds, param.ntree_limit);
+    writer.Push(preds.ConstHostVector(), nrow);
+  }
+  writer.Finish();
+}
+
+void CLIVerify(const CLIParam& param) {
+  CHECK_NE(param.test_path, "NULL")
+      << "Test dataset parameter test:data must be specified.";
+  std::unique_ptr<DMatrix> dtest(
+      DMatrix::Load(param.test_path, param.silent != 0, param.dsplit == 2));
+  CHECK_NE(param.model_in, "NULL")
+      << "Must specify model_in for verify";
+  std::unique_ptr<Learner> learner(Learner::Create({}));
+  LoadModel(param.model_in, learner.get());
+  learner->Configure(param.cfg);
+  const gbm::GBTreeModel* model = learner->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr) << "verify only supports booster=gbtree";
+
+  double start = dmlc::GetTime();
+  robust::RobustVerifier verifier(*model);
+  verifier.Configure(param.cfg);
+  std::vector<int> status;
+  std::vector<bst_float> bound;
+  verifier.Verify(dtest.get(), &status, &bound);
+
+  size_t count[robust::kMisclassified + 1] = {0};
+  for (int s : status) ++count[s];
+  if (param.silent == 0) {
+    LOG(CONSOLE) << "verified " << status.size() << " points in "
+                 << dmlc::GetTime() - start << " sec";
+    for (int s = 0; s <= robust::kMisclassified; ++s) {
+      LOG(CONSOLE) << robust::VerifyStatusName(s) << ": " << count[s];
+    }
+  }
+  // the aggregate is printed even when silent, it is what batch jobs collect
+  const size_t nrobust = count[robust::kVerifiedRobust] + count[robust::kSearchedRobust];
+  LOG(CONSOLE) << "robust_error@" << verifier.Param().verify_eps << '\t'
+               << 1.0 - static_cast<double>(nrobust) / std::max<size_t>(status.size(), 1);
+  if (param.silent == 0) {
+    LOG(CONSOLE) << "writing verification result to " << param.name_verify;
+  }
+  std::unique_ptr<dmlc::Stream> fo(
+      dmlc::Stream::Create(param.name_verify.c_str(), "w"));
+  dmlc::ostream os(fo.get());
+  for (size_t i = 0; i < status.size(); ++i) {
+    os << robust::VerifyStatusName(status[i]) << '\t'
+       << std::setprecision(std::numeric_limits<bst_float>::max_digits10 + 2)
+       << bound[i] << '\n';
+  }
+  // force flush before fo destruct.
+  os.set_stream(nullptr);
+}
+
+void CLIAttack(const CLIParam& param) {
+  CHECK_NE(param.test_path, "NULL")
+      << "Test dataset parameter test:data must be specified.";
+  std::unique_ptr<DMatrix> dtest(
+      DMatrix::Load(param.test_path, param.silent != 0, param.dsplit == 2));
+  CHECK_NE(param.model_in, "NULL")
+      << "Must specify model_in for attack";
+  std::unique_ptr<Learner> learner(Learner::Create({}));
+  LoadModel(param.model_in, learner.get());
+  learner->Configure(param.cfg);
+  const gbm::GBTreeModel* model = learner->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr) << "attack only supports booster=gbtree";
+
+  double start = dmlc::GetTime();
+  robust::RobustAttack attack(*model);
+  attack.Configure(param.cfg);
+  std::vector<bst_float> dist, adv;
+  attack.Attack(dtest.get(), &dist, &adv);
+  const size_t nfeature = dist.size() != 0 ? adv.size() / dist.size() : 0;
+
+  size_t ncorrect = 0, nsuccess = 0;
+  double sum_dist = 0.0;
+  for (bst_float d : dist) {
+    if (d == 0.0f) continue;
+    ++ncorrect;
+    if (d > 0.0f) {
+      ++nsuccess;
+      sum_dist += d;
+    }
+  }
   if (param.silent == 0) {
-    LOG(CONSOLE) << "writing prediction to " << param.name_pred;
+    LOG(CONSOLE) << "attacked " << ncorrect << " correctly classified points in "
+                 << dmlc::GetTime() - start << " sec, " << nsuccess << " succeeded";
+    LOG(CONSOLE) << "average linf distortion: " << sum_dist / std::max<size_t>(nsuccess, 1);
+    LOG(CONSOLE) << "writing attack result to " << param.name_attack;
   }
   std::unique_ptr<dmlc::Stream> fo(
-      dmlc::Stream::Create(param.name_pred.c_str(), "w"));
+      dmlc::Stream::Create(param.name_attack.c_str(), "w"));
   dmlc::ostream os(fo.get());
-  for (bst_float p : preds.HostVector()) {
-    os << std::setprecision(std::numeric_limits<bst_float>::max_digits10 + 2)
-       << p << '\n';
+  os << std::setprecision(std::numeric_limits<bst_float>::max_digits10 + 2);
+  auto iter = dtest->RowIterator();
+  iter->BeforeFirst();
+  std::vector<bst_float> x(nfeature);
+  while (iter->Next()) {
+    auto &batch = iter->Value();
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      const size_t ridx = batch.base_rowid + i;
+      os << dist[ridx];
+      // the perturbed features of the adversarial example
+      std::fill(x.begin(), x.end(), 0.0f);
+      for (bst_uint j = 0; j < batch[i].length; ++j) {
+        if (batch[i][j].index < nfeature) x[batch[i][j].index] = batch[i][j].fvalue;
+      }
+      for (size_t f = 0; f < nfeature; ++f) {
+        const bst_float v = adv[ridx * nfeature + f];
+        if (!std::isnan(v) && v != x[f]) os << ' ' << f << ':' << v;
+      }
+      os << '\n';
+    }
   }
   // force flush before fo destruct.
   os.set_stream(nullptr);
 }
 
+void CLICompile(const CLIParam& param) {
+  CHECK_NE(param.model_in, "NULL")
+      << "Must specify model_in for compile";
+  std::unique_ptr<Learner> learner(Learner::Create({}));
+  LoadModel(param.model_in, learner.get());
+  learner->Configure(param.cfg);
+  const gbm::GBTreeModel* model = learner->GetGradientBooster()->GetTreeModel();
+  CHECK(model != nullptr) << "compile only supports booster=gbtree";
+  if (param.silent == 0) {
+    LOG(CONSOLE) << "writing compiled model to " << param.name_compile;
+  }
+  std::unique_ptr<dmlc::Stream> fo(
+      dmlc::Stream::Create(param.name_compile.c_str(), "w"));
+  dmlc::ostream os(fo.get());
+  gbm::CompileModel(*model, param.ntree_limit, &os);
+  // force flush before fo destruct.
+  os.set_stream(nullptr);
+}
+
+void CLICompact(const CLIParam& param) {
+  CHECK_NE(param.model_in, "NULL")
+      << "Must specify model_in for compact";
+  CHECK_NE(param.model_out, "NULL")
+      << "Must specify model_out for compact";
+  std::unique_ptr<Learner> learner(Learner::Create({}));
+  LoadModel(param.model_in, learner.get());
+  learner->Configure(param.cfg);
+  gbm::CompactStats stats;
+  CHECK(learner->Compact(param.cfg, &stats)) << "compact only supports booster=gbtree";
+  if (param.silent == 0) {
+    LOG(CONSOLE) << "compacted " << stats.num_trees_before << " trees of "
+                 << stats.num_nodes_before << " nodes to " << stats.num_trees_after
+                 << " trees of " << stats.num_nodes_after << " nodes, "
+                 << stats.num_merged << " subtrees merged into leaves";
+    LOG(CONSOLE) << "writing compacted model to " << param.model_out;
+  }
+  std::unique_ptr<dmlc::Stream> fo(
+      dmlc::Stream::Create(param.model_out.c_str(), "w"));
+  learner->Save(fo.get());
+}
+
 int CLIRunTask(int argc, char *argv[]) {
   if (argc < 2) {
     printf("Usage: <config>\n");
@@ -368,6 +1105,10 @@ int CLIRunTask(int argc, char *argv[]) {
     case kTrain: CLITrain(param); break;
     case kDumpModel: CLIDumpModel(param); break;
     case kPredict: CLIPredict(param); break;
+    case kVerify: CLIVerify(param); break;
+    case kAttack: CLIAttack(param); break;
+    case kCompile: CLICompile(param); break;
+    case kCompact: CLICompact(param); break;
   }
   rabit::Finalize();
   return 0;
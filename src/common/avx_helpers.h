@@ -7,6 +7,7 @@
 #include "xgboost/base.h"
 
 #ifdef XGBOOST_USE_AVX
+#include <immintrin.h>
 namespace avx {
 /**
  * \struct  Float8
@@ -171,6 +172,11 @@ inline Float8 Sigmoid(Float8 x) {
   return Float8(_mm256_rcp_ps(x.x));
 }
 
+// Store 8 floats to unaligned memory
+inline void Store(float* dst, const Float8& x) {
+  _mm256_storeu_ps(dst, x.x);
+}
+
 // Store 8 gradient pairs given vectors containing gradient and Hessian
 inline void StoreGpair(xgboost::GradientPair* dst, const Float8& grad,
                        const Float8& hess) {
@@ -251,6 +257,13 @@ inline Float8 operator/(Float8 lhs, const Float8& rhs) {
   return lhs;
 }
 
+// Store 8 floats to unaligned memory
+inline void Store(float* dst, const Float8& x) {
+  for (int i = 0; i < 8; i++) {
+    dst[i] = x.x[i];
+  }
+}
+
 // Store 8 gradient pairs given vectors containing gradient and Hessian
 inline void StoreGpair(xgboost::GradientPair* dst, const Float8& grad,
                        const Float8& hess) {
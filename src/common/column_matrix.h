@@ -157,6 +157,10 @@ class ColumnMatrix {
         }
       }
     }
+    bytes_.Set(feature_counts_.size() * sizeof(size_t) + type_.size() * sizeof(ColumnType) +
+               index_.size() * sizeof(uint32_t) + row_ind_.size() * sizeof(size_t) +
+               boundary_.size() * sizeof(ColumnBoundary) +
+               index_base_.size() * sizeof(uint32_t));
   }
 
   /* Fetch an individual column. This code should be used with XGBOOST_TYPE_SWITCH
@@ -187,6 +191,7 @@ class ColumnMatrix {
 
   // index_base_[fid]: least bin id for feature fid
   std::vector<uint32_t> index_base_;
+  TrackedBytes bytes_{kMemGradientIndex};
 };
 
 }  // namespace common
@@ -6,11 +6,14 @@
 #include <thrust/device_vector.h>
 #include <thrust/system/cuda/error.h>
 #include <thrust/system_error.h>
+#include <dmlc/thread_local.h>
 #include <xgboost/logging.h>
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <ctime>
 #include <cub/cub.cuh>
+#include <memory>
 #include <numeric>
 #include <sstream>
 #include <string>
@@ -321,6 +324,19 @@ inline void LaunchN(int device_idx, size_t n, L lambda) {
                                                 lambda);
 }
 
+template <int ITEMS_PER_THREAD = 8, int BLOCK_THREADS = 256, typename L>
+inline void LaunchN(int device_idx, size_t n, cudaStream_t stream, L lambda) {
+  if (n == 0) {
+    return;
+  }
+
+  safe_cuda(cudaSetDevice(device_idx));
+  const int GRID_SIZE =
+      static_cast<int>(DivRoundUp(n, ITEMS_PER_THREAD * BLOCK_THREADS));
+  LaunchNKernel<<<GRID_SIZE, BLOCK_THREADS, 0, stream>>>(
+      static_cast<size_t>(0), n, lambda);
+}
+
 /*
  * Memory
  */
@@ -520,7 +536,11 @@ class BulkAllocator {
   char *AllocateDevice(int device_idx, size_t bytes, MemoryType t) {
     char *ptr;
     safe_cuda(cudaSetDevice(device_idx));
-    safe_cuda(cudaMalloc(&ptr, bytes));
+    if (t == kDeviceManaged) {
+      safe_cuda(cudaMallocManaged(&ptr, bytes));
+    } else {
+      safe_cuda(cudaMalloc(&ptr, bytes));
+    }
     return ptr;
   }
   template <typename T>
@@ -632,6 +652,152 @@ struct CubMemory {
   bool IsAllocated() { return d_temp_storage != nullptr; }
 };
 
+/*
+ *  Caching allocator and pinned staging
+ */
+
+/*!
+ * \brief pool of device memory shared by all threads and devices, with a
+ *  free list per power of two size class and device. Freed blocks are kept
+ *  for reuse instead of being returned with cudaFree, so the vectors that are
+ *  resized every round do not synchronise the device with cudaMalloc.
+ */
+inline cub::CachingDeviceAllocator &GlobalCachingAllocator() {
+  // size classes of 512 bytes to 512MB, larger blocks are freed at once. The
+  // pool is never destroyed: the cached blocks may outlive the cuda runtime.
+  static cub::CachingDeviceAllocator *allocator =
+      new cub::CachingDeviceAllocator(2, 9, 29);
+  return *allocator;
+}
+
+/*! \brief thrust allocator from the pool, on the current device */
+template <typename T>
+struct CachingDeviceAllocator : thrust::device_malloc_allocator<T> {
+  using super_t = thrust::device_malloc_allocator<T>;
+  using pointer = typename super_t::pointer;  // NOLINT
+  template <typename U>
+  struct rebind {  // NOLINT
+    using other = CachingDeviceAllocator<U>;  // NOLINT
+  };
+  pointer allocate(size_t n) {  // NOLINT
+    T *ptr;
+    safe_cuda(GlobalCachingAllocator().DeviceAllocate(reinterpret_cast<void **>(&ptr),
+                                                      n * sizeof(T)));
+    return pointer(ptr);
+  }
+  void deallocate(pointer ptr, size_t n) {  // NOLINT
+    safe_cuda(GlobalCachingAllocator().DeviceFree(ptr.get()));
+  }
+};
+
+/*! \brief device vector whose memory comes from the pool */
+template <typename T>
+using CachingDeviceVector = thrust::device_vector<T, CachingDeviceAllocator<T>>;
+
+/*!
+ * \brief two pinned host buffers of a thread for one device, through which
+ *  pageable host memory is copied in chunks: the host side copy of a chunk
+ *  overlaps the transfer of the previous one.
+ */
+class PinnedStaging {
+ public:
+  static const size_t kChunkBytes = 4 << 20;
+  // copies this small are not worth the staging
+  static const size_t kMinBytes = 64 << 10;
+
+  explicit PinnedStaging(int device_idx) {
+    safe_cuda(cudaSetDevice(device_idx));
+    for (int i = 0; i < 2; ++i) {
+      safe_cuda(cudaMallocHost(&buffer_[i], kChunkBytes));
+      safe_cuda(cudaEventCreateWithFlags(&done_[i], cudaEventDisableTiming));
+    }
+  }
+  PinnedStaging(const PinnedStaging &) = delete;
+  PinnedStaging &operator=(const PinnedStaging &) = delete;
+  ~PinnedStaging() {
+    // errors are ignored, the runtime may be shut down already at thread exit
+    for (int i = 0; i < 2; ++i) {
+      cudaEventDestroy(done_[i]);
+      cudaFreeHost(buffer_[i]);
+    }
+  }
+  /*! \brief copy bytes from pageable host memory to the current device */
+  void HostToDevice(void *dst, const void *src, size_t bytes) {
+    for (size_t offset = 0, k = 0; offset < bytes; offset += kChunkBytes, ++k) {
+      const size_t n = std::min(static_cast<size_t>(kChunkBytes), bytes - offset);
+      const int b = static_cast<int>(k % 2);
+      // the transfer of the chunk before last is done with this buffer
+      if (k >= 2) safe_cuda(cudaEventSynchronize(done_[b]));
+      std::memcpy(buffer_[b], static_cast<const char *>(src) + offset, n);
+      safe_cuda(cudaMemcpyAsync(static_cast<char *>(dst) + offset, buffer_[b], n,
+                                cudaMemcpyHostToDevice));
+      safe_cuda(cudaEventRecord(done_[b]));
+    }
+    safe_cuda(cudaStreamSynchronize(nullptr));
+  }
+  /*! \brief copy bytes from the current device to pageable host memory */
+  void DeviceToHost(void *dst, const void *src, size_t bytes) {
+    size_t prev_offset = 0, prev_n = 0;
+    for (size_t offset = 0, k = 0; offset < bytes; offset += kChunkBytes, ++k) {
+      const size_t n = std::min(static_cast<size_t>(kChunkBytes), bytes - offset);
+      const int b = static_cast<int>(k % 2);
+      safe_cuda(cudaMemcpyAsync(buffer_[b], static_cast<const char *>(src) + offset, n,
+                                cudaMemcpyDeviceToHost));
+      safe_cuda(cudaEventRecord(done_[b]));
+      // the previous chunk is copied out while this one is transferred
+      if (k >= 1) this->CopyOut(1 - b, dst, prev_offset, prev_n);
+      prev_offset = offset;
+      prev_n = n;
+    }
+    if (bytes != 0) {
+      const size_t last = (bytes - 1) / kChunkBytes;
+      this->CopyOut(static_cast<int>(last % 2), dst, prev_offset, prev_n);
+    }
+  }
+
+ private:
+  void CopyOut(int b, void *dst, size_t offset, size_t n) {
+    safe_cuda(cudaEventSynchronize(done_[b]));
+    std::memcpy(static_cast<char *>(dst) + offset, buffer_[b], n);
+  }
+
+  char *buffer_[2];
+  cudaEvent_t done_[2];
+};
+
+// the staging buffers of the calling thread, by device
+struct PinnedStagingStore {
+  std::vector<std::unique_ptr<PinnedStaging>> staging;
+};
+
+/*! \brief the staging buffers of the calling thread for a device */
+inline PinnedStaging &ThreadStaging(int device_idx) {
+  auto &staging = dmlc::ThreadLocalStore<PinnedStagingStore>::Get()->staging;
+  if (staging.size() <= static_cast<size_t>(device_idx)) staging.resize(device_idx + 1);
+  if (staging[device_idx] == nullptr) staging[device_idx].reset(new PinnedStaging(device_idx));
+  return *staging[device_idx];
+}
+
+/*! \brief copy bytes from pageable host memory to device memory of device_idx */
+inline void CopyHostToDevice(int device_idx, void *dst, const void *src, size_t bytes) {
+  safe_cuda(cudaSetDevice(device_idx));
+  if (bytes < PinnedStaging::kMinBytes) {
+    safe_cuda(cudaMemcpy(dst, src, bytes, cudaMemcpyHostToDevice));
+  } else {
+    ThreadStaging(device_idx).HostToDevice(dst, src, bytes);
+  }
+}
+
+/*! \brief copy bytes from device memory of device_idx to pageable host memory */
+inline void CopyDeviceToHost(int device_idx, void *dst, const void *src, size_t bytes) {
+  safe_cuda(cudaSetDevice(device_idx));
+  if (bytes < PinnedStaging::kMinBytes) {
+    safe_cuda(cudaMemcpy(dst, src, bytes, cudaMemcpyDeviceToHost));
+  } else {
+    ThreadStaging(device_idx).DeviceToHost(dst, src, bytes);
+  }
+}
+
 /*
  *  Utility functions
  */
@@ -936,6 +1102,7 @@ class AllReducer {
 #ifdef XGBOOST_USE_NCCL
   std::vector<ncclComm_t> comms;
   std::vector<cudaStream_t> streams;
+  std::vector<cudaEvent_t> events;
   std::vector<int> device_ordinals;
 #endif
  public:
@@ -958,9 +1125,11 @@ class AllReducer {
                                   static_cast<int>(device_ordinals.size()),
                                   device_ordinals.data()));
     streams.resize(device_ordinals.size());
+    events.resize(device_ordinals.size());
     for (size_t i = 0; i < device_ordinals.size(); i++) {
       safe_cuda(cudaSetDevice(device_ordinals[i]));
       safe_cuda(cudaStreamCreate(&streams[i]));
+      safe_cuda(cudaEventCreateWithFlags(&events[i], cudaEventDisableTiming));
     }
     initialised = true;
 #else
@@ -974,6 +1143,9 @@ class AllReducer {
       for (auto &stream : streams) {
         dh::safe_cuda(cudaStreamDestroy(stream));
       }
+      for (auto &event : events) {
+        dh::safe_cuda(cudaEventDestroy(event));
+      }
       for (auto &comm : comms) {
         ncclCommDestroy(comm);
       }
@@ -1055,6 +1227,24 @@ class AllReducer {
       dh::safe_cuda(cudaSetDevice(device_ordinals[i]));
       dh::safe_cuda(cudaStreamSynchronize(streams[i]));
     }
+#endif
+  }
+
+  /**
+   * \fn  void StreamWait(int communication_group_idx, cudaStream_t stream)
+   *
+   * \brief Makes the work enqueued on stream after this call wait for the
+   * reductions enqueued so far on communication group communication_group_idx,
+   * without blocking the host.
+   */
+  void StreamWait(int communication_group_idx, cudaStream_t stream) {
+#ifdef XGBOOST_USE_NCCL
+    CHECK(initialised);
+
+    dh::safe_cuda(cudaSetDevice(device_ordinals[communication_group_idx]));
+    dh::safe_cuda(cudaEventRecord(events[communication_group_idx],
+                                  streams[communication_group_idx]));
+    dh::safe_cuda(cudaStreamWaitEvent(stream, events[communication_group_idx], 0));
 #endif
   }
 };
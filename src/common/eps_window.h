@@ -0,0 +1,104 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file eps_window.h
+ * \brief boundaries of the robust eps windows of the sorted columns.
+ *
+ *  The robust scan of a sorted column evaluates the split at eta = v - eps
+ *  before each entry of value v, with the data in [eta - eps, eta + eps)
+ *  uncertain. The values of the data never change during training, so the
+ *  first entry >= v - eps and the first entry >= (v - eps) - eps of each
+ *  entry are fixed: they are found once per data set and eps, and the scans
+ *  of all the levels and rounds move the windows of a node by comparing
+ *  positions in the column instead of feature values.
+ */
+#ifndef XGBOOST_COMMON_EPS_WINDOW_H_
+#define XGBOOST_COMMON_EPS_WINDOW_H_
+
+#include <dmlc/omp.h>
+#include <xgboost/data.h>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+
+/*! \brief the window boundaries of a column, offsets from its first entry */
+struct EpsWindow {
+  /*! \brief the column, nullptr when the boundaries are not stored */
+  const Entry* data;
+  /*! \brief left[i]: first entry with fvalue >= data[i].fvalue - eps */
+  const uint32_t* left;
+  /*! \brief certain[i]: first entry with fvalue >= (data[i].fvalue - eps) - eps */
+  const uint32_t* certain;
+};
+
+/*! \brief window boundaries of the columns of a sorted column page */
+class EpsWindowMatrix {
+ public:
+  /*! \brief find the boundaries of all the columns of a page for eps */
+  inline void Init(const SparsePage& page, bst_float eps) {
+    const auto ncol = static_cast<bst_omp_uint>(page.Size());
+    base_ = dmlc::BeginPtr(page.data);
+    offset_ = page.offset;
+    eps_ = eps;
+    left_.resize(page.data.size());
+    certain_.resize(page.data.size());
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (bst_omp_uint fid = 0; fid < ncol; ++fid) {
+      SparsePage::Inst col = page[fid];
+      uint32_t* left = dmlc::BeginPtr(left_) + offset_[fid];
+      uint32_t* certain = dmlc::BeginPtr(certain_) + offset_[fid];
+      // the values ascend, so both boundaries only move forward; the bounds
+      // are the expressions of the scan, so they split the values alike
+      uint32_t l = 0, c = 0;
+      for (uint32_t i = 0; i < col.length; ++i) {
+        const bst_float eta = col[i].fvalue - eps;
+        while (col[l].fvalue < eta) ++l;
+        while (col[c].fvalue < eta - eps) ++c;
+        left[i] = l;
+        certain[i] = c;
+      }
+    }
+  }
+  /*! \brief remove all columns */
+  inline void Clear() {
+    base_ = nullptr;
+    offset_.clear();
+    left_.clear();
+    certain_.clear();
+  }
+  /*! \brief eps of the boundaries */
+  inline bst_float Eps() const {
+    return eps_;
+  }
+  /*!
+   * \brief the boundaries of column fid when the column scanned is the one
+   *  stored, data is nullptr otherwise, e.g. for a compacted column
+   */
+  inline EpsWindow GetColumn(bst_uint fid, const Entry* data, bst_uint length) const {
+    EpsWindow win{nullptr, nullptr, nullptr};
+    if (fid + 1 < offset_.size() && data == base_ + offset_[fid] &&
+        length == offset_[fid + 1] - offset_[fid]) {
+      win.data = data;
+      win.left = dmlc::BeginPtr(left_) + offset_[fid];
+      win.certain = dmlc::BeginPtr(certain_) + offset_[fid];
+    }
+    return win;
+  }
+  inline size_t MemCostBytes() const {
+    return offset_.capacity() * sizeof(size_t) +
+        (left_.capacity() + certain_.capacity()) * sizeof(uint32_t);
+  }
+
+ private:
+  /*! \brief first entry of the page */
+  const Entry* base_{nullptr};
+  /*! \brief start of each column, as in the page */
+  std::vector<size_t> offset_;
+  bst_float eps_{0.0f};
+  std::vector<uint32_t> left_;
+  std::vector<uint32_t> certain_;
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_EPS_WINDOW_H_
@@ -0,0 +1,98 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file feature_scheduler.h
+ * \brief cost aware work stealing schedule of the features of a level.
+ *
+ *  The features are sorted by cost, heaviest first, and dealt round robin to
+ *  one queue per thread. A thread takes the features of its own queue and
+ *  then steals from the queues of the others, so the threads finish within
+ *  about the cost of a light feature of each other (greedy LPT scheduling).
+ *  Features costing more than the share of a thread can not be balanced this
+ *  way and are returned apart, to be enumerated by all threads each.
+ */
+#ifndef XGBOOST_COMMON_FEATURE_SCHEDULER_H_
+#define XGBOOST_COMMON_FEATURE_SCHEDULER_H_
+
+#include <xgboost/base.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+
+class FeatureScheduler {
+ public:
+  /*!
+   * \brief plan the features of a level
+   * \param feat_set the features
+   * \param cost cost of each feature of feat_set, e.g. its number of entries
+   * \param nthread number of threads that call Next
+   * \param split_heavy whether to set apart the features heavier than the
+   *  share of a thread, see Heavy()
+   */
+  inline void Init(const std::vector<bst_uint>& feat_set, const std::vector<size_t>& cost,
+                   int nthread, bool split_heavy) {
+    nthread_ = std::max(nthread, 1);
+    size_t total = 0;
+    for (size_t c : cost) total += c;
+    const size_t share = total / nthread_;
+    order_.clear();
+    heavy_.clear();
+    std::vector<std::pair<size_t, bst_uint> > sorted;
+    for (size_t i = 0; i < feat_set.size(); ++i) {
+      if (split_heavy && nthread_ > 1 && cost[i] > share) {
+        heavy_.push_back(feat_set[i]);
+      } else {
+        sorted.emplace_back(cost[i], feat_set[i]);
+      }
+    }
+    // the feature index breaks the ties, so the plan only depends on the costs
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<size_t, bst_uint>& a, const std::pair<size_t, bst_uint>& b) {
+                return a.first != b.first ? a.first > b.first : a.second < b.second;
+              });
+    for (const auto& e : sorted) order_.push_back(e.second);
+    next_.reset(new Counter[nthread_]);
+    for (int tid = 0; tid < nthread_; ++tid) next_[tid].value = 0;
+  }
+  /*! \return the features set apart by Init, in the order of feat_set */
+  inline const std::vector<bst_uint>& Heavy() const {
+    return heavy_;
+  }
+  /*!
+   * \brief take the next feature for thread tid, from its own queue first
+   * \return false when all features are taken
+   */
+  inline bool Next(int tid, bst_uint* fid) {
+    const auto nfeature = order_.size();
+    for (int k = 0; k < nthread_; ++k) {
+      // queue q holds the features q, q + nthread, q + 2 * nthread, ... of order_
+      const int q = (tid + k) % nthread_;
+      if (static_cast<size_t>(q) >= nfeature) continue;
+      const size_t i = q + next_[q].value++ * nthread_;
+      if (i < nfeature) {
+        *fid = order_[i];
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  // a queue front, padded to a cache line against false sharing
+  struct Counter {
+    std::atomic<size_t> value;
+    char pad[64 - sizeof(std::atomic<size_t>)];
+  };
+  int nthread_{1};
+  std::vector<bst_uint> order_;
+  std::vector<bst_uint> heavy_;
+  std::unique_ptr<Counter[]> next_;
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_FEATURE_SCHEDULER_H_
@@ -5,21 +5,42 @@
  * \author Philip Cho, Tianqi Chen
  */
 #include <dmlc/omp.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
 #include <numeric>
+#include <utility>
 #include <vector>
 #include "./sync.h"
 #include "./random.h"
 #include "./column_matrix.h"
 #include "./hist_util.h"
 #include "./quantile.h"
+#include "../data/simple_csr_source.h"
 
 namespace xgboost {
 namespace common {
 
-void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins) {
+// header of the cut cache files
+constexpr uint32_t kCutCacheMagic = 0xffffab05U;
+
+void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins,
+                         const std::string& cache_file, bst_float robust_eps) {
   using WXQSketch = common::WXQuantileSketch<bst_float, bst_float>;
   const MetaInfo& info = p_fmat->Info();
 
+  uint64_t key = 0;
+  if (!cache_file.empty()) {
+    key = CacheKey(p_fmat, max_num_bins, robust_eps);
+    std::unique_ptr<dmlc::Stream> fi(dmlc::Stream::Create(cache_file.c_str(), "r", true));
+    if (fi != nullptr && this->Load(fi.get(), key)) {
+      LOG(CONSOLE) << "Loaded the histogram cuts from " << cache_file;
+      return;
+    }
+  }
+
   // safe factor for better accuracy
   constexpr int kFactor = 8;
   std::vector<WXQSketch> sketchs;
@@ -58,60 +79,168 @@ void HistCutMatrix::Init(DMatrix* p_fmat, uint32_t max_num_bins) {
     }
   }
 
-  Init(&sketchs, max_num_bins);
+  Init(&sketchs, max_num_bins, robust_eps);
+
+  // the cuts are the same on all workers after the allreduce
+  if (!cache_file.empty() && rabit::GetRank() == 0) {
+    std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(cache_file.c_str(), "w"));
+    this->Save(fo.get(), key);
+  }
 }
 
 void HistCutMatrix::Init
-(std::vector<WXQSketch>* in_sketchs, uint32_t max_num_bins) {
+(std::vector<WXQSketch>* in_sketchs, uint32_t max_num_bins, bst_float robust_eps) {
   std::vector<WXQSketch>& sketchs = *in_sketchs;
   constexpr int kFactor = 8;
+  const auto nfeature = static_cast<bst_omp_uint>(sketchs.size());
   // gather the histogram data
   rabit::SerializeReducer<WXQSketch::SummaryContainer> sreducer;
   std::vector<WXQSketch::SummaryContainer> summary_array;
   summary_array.resize(sketchs.size());
-  for (size_t i = 0; i < sketchs.size(); ++i) {
+  #pragma omp parallel
+  {
+    // reused by all features of the thread
     WXQSketch::SummaryContainer out;
-    sketchs[i].GetSummary(&out);
-    summary_array[i].Reserve(max_num_bins * kFactor);
-    summary_array[i].SetPrune(out, max_num_bins * kFactor);
+    #pragma omp for schedule(dynamic)
+    for (bst_omp_uint i = 0; i < nfeature; ++i) {
+      sketchs[i].GetSummary(&out);
+      summary_array[i].Reserve(max_num_bins * kFactor);
+      summary_array[i].SetPrune(out, max_num_bins * kFactor);
+    }
   }
   size_t nbytes = WXQSketch::SummaryContainer::CalcMemCost(max_num_bins * kFactor);
   sreducer.Allreduce(dmlc::BeginPtr(summary_array), nbytes, summary_array.size());
 
+  // the cuts of each feature, concatenated below
+  std::vector<std::vector<bst_float> > feature_cut(nfeature);
   this->min_val.resize(sketchs.size());
-  row_ptr.push_back(0);
-  for (size_t fid = 0; fid < summary_array.size(); ++fid) {
+  #pragma omp parallel
+  {
     WXQSketch::SummaryContainer a;
     a.Reserve(max_num_bins);
-    a.SetPrune(summary_array[fid], max_num_bins);
-    const bst_float mval = a.data[0].value;
-    this->min_val[fid] = mval - (fabs(mval) + 1e-5);
-    if (a.size > 1 && a.size <= 16) {
-      /* specialized code categorial / ordinal data -- use midpoints */
-      for (size_t i = 1; i < a.size; ++i) {
-        bst_float cpt = (a.data[i].value + a.data[i - 1].value) / 2.0f;
-        if (i == 1 || cpt > cut.back()) {
-          cut.push_back(cpt);
+    std::vector<bst_float> boundary;
+    #pragma omp for schedule(dynamic)
+    for (bst_omp_uint fid = 0; fid < nfeature; ++fid) {
+      std::vector<bst_float>& fcut = feature_cut[fid];
+      boundary.clear();
+      if (robust_eps > 0.0f) {
+        RobustBoundary(summary_array[fid], max_num_bins, robust_eps, &boundary);
+      }
+      // the boundary cuts take their share of the budget from the quantiles
+      a.SetPrune(summary_array[fid], max_num_bins - boundary.size());
+      const bst_float mval = a.data[0].value;
+      this->min_val[fid] = mval - (fabs(mval) + 1e-5);
+      if (a.size > 1 && a.size <= 16) {
+        /* specialized code categorial / ordinal data -- use midpoints */
+        for (size_t i = 1; i < a.size; ++i) {
+          bst_float cpt = (a.data[i].value + a.data[i - 1].value) / 2.0f;
+          if (i == 1 || cpt > fcut.back()) {
+            fcut.push_back(cpt);
+          }
+        }
+      } else {
+        for (size_t i = 2; i < a.size; ++i) {
+          bst_float cpt = a.data[i - 1].value;
+          if (i == 2 || cpt > fcut.back()) {
+            fcut.push_back(cpt);
+          }
         }
       }
-    } else {
-      for (size_t i = 2; i < a.size; ++i) {
-        bst_float cpt = a.data[i - 1].value;
-        if (i == 2 || cpt > cut.back()) {
-          cut.push_back(cpt);
+      // push a value that is greater than anything
+      if (a.size != 0) {
+        bst_float cpt = a.data[a.size - 1].value;
+        // this must be bigger than last value in a scale
+        bst_float last = cpt + (fabs(cpt) + 1e-5);
+        // boundary cuts outside the values of the feature only add empty bins
+        for (bst_float b : boundary) {
+          if (b > mval && b < cpt) fcut.push_back(b);
         }
+        std::sort(fcut.begin(), fcut.end());
+        fcut.erase(std::unique(fcut.begin(), fcut.end()), fcut.end());
+        fcut.push_back(last);
       }
     }
-    // push a value that is greater than anything
-    if (a.size != 0) {
-      bst_float cpt = a.data[a.size - 1].value;
-      // this must be bigger than last value in a scale
-      bst_float last = cpt + (fabs(cpt) + 1e-5);
-      cut.push_back(last);
+  }
+  row_ptr.push_back(0);
+  for (bst_omp_uint fid = 0; fid < nfeature; ++fid) {
+    cut.insert(cut.end(), feature_cut[fid].begin(), feature_cut[fid].end());
+    row_ptr.push_back(static_cast<bst_uint>(cut.size()));
+  }
+}
+
+void HistCutMatrix::RobustBoundary(const WXQSketch::Summary& summary, uint32_t max_num_bins,
+                                   bst_float robust_eps, std::vector<bst_float>* out) {
+  if (summary.size == 0) return;
+  // a value is frequent when its own weight exceeds that of an even bin
+  const bst_float min_weight = summary.data[summary.size - 1].rmax / max_num_bins;
+  std::vector<std::pair<bst_float, bst_float> > frequent;
+  for (size_t i = 0; i < summary.size; ++i) {
+    if (summary.data[i].wmin > min_weight) {
+      frequent.emplace_back(summary.data[i].wmin, summary.data[i].value);
     }
+  }
+  // at most half of the budget, two cuts per value, goes to the heaviest values
+  const size_t nvalue = std::min(frequent.size(), static_cast<size_t>(max_num_bins / 4));
+  std::partial_sort(frequent.begin(), frequent.begin() + nvalue, frequent.end(),
+                    [](const std::pair<bst_float, bst_float>& a,
+                       const std::pair<bst_float, bst_float>& b) {
+                      return a.first > b.first;
+                    });
+  for (size_t i = 0; i < nvalue; ++i) {
+    out->push_back(frequent[i].second - robust_eps);
+    out->push_back(frequent[i].second + robust_eps);
+  }
+}
 
-    row_ptr.push_back(static_cast<bst_uint>(cut.size()));
+uint64_t HistCutMatrix::CacheKey(DMatrix* p_fmat, uint32_t max_num_bins,
+                                 bst_float robust_eps) {
+  const MetaInfo& info = p_fmat->Info();
+  uint64_t key = 14695981039346656037ULL;
+  auto mix = [&key](uint64_t v) {
+    key = (key ^ v) * 1099511628211ULL;
+  };
+  mix(info.num_row_);
+  mix(info.num_col_);
+  mix(max_num_bins);
+  uint32_t eps_bits;
+  std::memcpy(&eps_bits, &robust_eps, sizeof(eps_bits));
+  mix(eps_bits);
+  auto iter = p_fmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const auto& batch = iter->Value();
+    mix(data::RowPageHash(dmlc::BeginPtr(batch.offset), batch.offset.size(),
+                          dmlc::BeginPtr(batch.data), batch.data.size()));
   }
+  // the weights change the sketch as well
+  for (bst_float w : info.weights_) {
+    uint32_t bits;
+    std::memcpy(&bits, &w, sizeof(bits));
+    mix(bits);
+  }
+  return key;
+}
+
+void HistCutMatrix::Save(dmlc::Stream* fo, uint64_t key) const {
+  const uint32_t magic = kCutCacheMagic;
+  fo->Write(&magic, sizeof(magic));
+  fo->Write(&key, sizeof(key));
+  fo->Write(row_ptr);
+  fo->Write(min_val);
+  fo->Write(cut);
+}
+
+bool HistCutMatrix::Load(dmlc::Stream* fi, uint64_t key) {
+  uint32_t magic;
+  uint64_t saved_key;
+  if (fi->Read(&magic, sizeof(magic)) != sizeof(magic) || magic != kCutCacheMagic ||
+      fi->Read(&saved_key, sizeof(saved_key)) != sizeof(saved_key) || saved_key != key) {
+    return false;
+  }
+  CHECK(fi->Read(&row_ptr)) << "invalid cut cache";
+  CHECK(fi->Read(&min_val)) << "invalid cut cache";
+  CHECK(fi->Read(&cut)) << "invalid cut cache";
+  return true;
 }
 
 uint32_t HistCutMatrix::GetBinIdx(const Entry& e) {
@@ -125,42 +254,98 @@ uint32_t HistCutMatrix::GetBinIdx(const Entry& e) {
   return idx;
 }
 
-void GHistIndexMatrix::Init(DMatrix* p_fmat, int max_num_bins) {
-  cut.Init(p_fmat, max_num_bins);
-  auto iter = p_fmat->RowIterator();
+void BinIndex::Init(const std::vector<uint32_t>& index, std::vector<uint32_t> offset) {
+  size_ = index.size();
+  offset_ = std::move(offset);
+  const int nthread = omp_get_max_threads();
+  const auto n = static_cast<omp_ulong>(size_);
+  std::vector<uint32_t> max_tloc(nthread, 0);
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+    const int tid = omp_get_thread_num();
+    max_tloc[tid] = std::max(max_tloc[tid], index[i] - this->Offset(i));
+  }
+  const uint32_t max_bin = *std::max_element(max_tloc.begin(), max_tloc.end());
+  width_ = max_bin <= std::numeric_limits<uint8_t>::max() ? 1 :
+      (max_bin <= std::numeric_limits<uint16_t>::max() ? 2 : 4);
+  data_.resize(size_ * width_);
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+    const uint32_t v = index[i] - this->Offset(i);
+    switch (width_) {
+      case 1:
+        data_[i] = static_cast<uint8_t>(v);
+        break;
+      case 2:
+        reinterpret_cast<uint16_t*>(dmlc::BeginPtr(data_))[i] = static_cast<uint16_t>(v);
+        break;
+      default:
+        reinterpret_cast<uint32_t*>(dmlc::BeginPtr(data_))[i] = v;
+    }
+  }
+}
+
+void GHistIndexMatrix::Init(DMatrix* p_fmat, int max_num_bins,
+                            const std::string& cut_cache, bst_float robust_eps) {
+  cut.Init(p_fmat, max_num_bins, cut_cache, robust_eps);
+  row_ptr.assign(1, 0);
+  hit_count.assign(cut.row_ptr.back(), 0);
+  // the global bins, stored in the fewest bytes once all rows are known
+  std::vector<uint32_t> global;
+  this->AddRows(p_fmat, &global);
+  this->StoreIndex(global);
+}
 
+void GHistIndexMatrix::AppendRows(DMatrix* p_fmat) {
+  CHECK_LE(p_fmat->Info().num_col_, cut.row_ptr.size() - 1)
+      << "the appended rows have features without cuts";
+  std::vector<uint32_t> global(index.size());
+  const auto n = static_cast<omp_ulong>(global.size());
+  #pragma omp parallel for schedule(static)
+  for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+    global[i] = index[i];
+  }
+  this->AddRows(p_fmat, &global);
+  this->StoreIndex(global);
+}
+
+void GHistIndexMatrix::AddRows(DMatrix* p_fmat, std::vector<uint32_t>* p_global) {
+  std::vector<uint32_t>& global = *p_global;
   const int nthread = omp_get_max_threads();
   const uint32_t nbins = cut.row_ptr.back();
-  hit_count.resize(nbins, 0);
-  hit_count_tloc_.resize(nthread * nbins, 0);
+  const size_t row_begin = row_ptr.size() - 1;
+  CHECK_GT(cut.cut.size(), 0U);
+  CHECK_EQ(cut.row_ptr.back(), cut.cut.size());
 
+  auto iter = p_fmat->RowIterator();
   iter->BeforeFirst();
-  row_ptr.push_back(0);
   while (iter->Next()) {
-     auto batch = iter->Value();
+    auto batch = iter->Value();
+    // the first row of the batch that is not indexed yet
+    const size_t first = std::min(batch.Size(), row_begin > batch.base_rowid ?
+                                  static_cast<size_t>(row_begin - batch.base_rowid) : 0);
+    if (first == batch.Size()) continue;
     const size_t rbegin = row_ptr.size() - 1;
-    for (size_t i = 0; i < batch.Size(); ++i) {
+    for (size_t i = first; i < batch.Size(); ++i) {
       row_ptr.push_back(batch[i].length + row_ptr.back());
     }
-    index.resize(row_ptr.back());
-
-    CHECK_GT(cut.cut.size(), 0U);
-    CHECK_EQ(cut.row_ptr.back(), cut.cut.size());
+    global.resize(row_ptr.back());
+    hit_count_tloc_.assign(nthread * nbins, 0);
 
-    auto bsize = static_cast<omp_ulong>(batch.Size());
+    auto bsize = static_cast<omp_ulong>(batch.Size() - first);
     #pragma omp parallel for num_threads(nthread) schedule(static)
     for (omp_ulong i = 0; i < bsize; ++i) { // NOLINT(*)
       const int tid = omp_get_thread_num();
       size_t ibegin = row_ptr[rbegin + i];
       size_t iend = row_ptr[rbegin + i + 1];
-      SparsePage::Inst inst = batch[i];
+      SparsePage::Inst inst = batch[first + i];
       CHECK_EQ(ibegin + inst.length, iend);
       for (bst_uint j = 0; j < inst.length; ++j) {
         uint32_t idx = cut.GetBinIdx(inst[j]);
-        index[ibegin + j] = idx;
+        global[ibegin + j] = idx;
         ++hit_count_tloc_[tid * nbins + idx];
       }
-      std::sort(index.begin() + ibegin, index.begin() + iend);
+      std::sort(global.begin() + ibegin, global.begin() + iend);
     }
 
     #pragma omp parallel for num_threads(nthread) schedule(static)
@@ -172,6 +357,32 @@ void GHistIndexMatrix::Init(DMatrix* p_fmat, int max_num_bins) {
   }
 }
 
+void GHistIndexMatrix::StoreIndex(const std::vector<uint32_t>& global) {
+  const int nthread = omp_get_max_threads();
+  // when the k-th entry of every row is of feature k, the bins are stored
+  // relative to the first bin of their feature
+  const size_t nfeature = cut.row_ptr.size() - 1;
+  const size_t nrow = row_ptr.size() - 1;
+  bool dense = nfeature != 0 && global.size() == nrow * nfeature;
+  if (dense) {
+    const auto n = static_cast<omp_ulong>(global.size());
+    size_t nmismatch = 0;
+    #pragma omp parallel for num_threads(nthread) schedule(static) reduction(+ : nmismatch)
+    for (omp_ulong i = 0; i < n; ++i) {  // NOLINT(*)
+      const size_t fid = i % nfeature;
+      if (global[i] < cut.row_ptr[fid] || global[i] >= cut.row_ptr[fid + 1]) ++nmismatch;
+    }
+    dense = nmismatch == 0;
+  }
+  std::vector<uint32_t> offset;
+  if (dense) offset.assign(cut.row_ptr.begin(), cut.row_ptr.end() - 1);
+  index.Init(global, std::move(offset));
+  bytes_.Set(row_ptr.size() * sizeof(size_t) + index.MemCostBytes() +
+             (hit_count.size() + hit_count_tloc_.size()) * sizeof(size_t) +
+             cut.row_ptr.size() * sizeof(uint32_t) +
+             (cut.min_val.size() + cut.cut.size()) * sizeof(bst_float));
+}
+
 static size_t GetConflictCount(const std::vector<bool>& mark,
                                const Column& column,
                                size_t max_cnt) {
@@ -245,10 +456,16 @@ FindGroups(const std::vector<unsigned>& feature_list,
         search_groups.push_back(gid);
       }
     }
-    std::shuffle(search_groups.begin(), search_groups.end(), common::GlobalRandom());
-    if (param.max_search_group > 0 && search_groups.size() > param.max_search_group) {
-      search_groups.resize(param.max_search_group);
+    // only the candidates examined are drawn, the others stay in place
+    const size_t nsearch = param.max_search_group > 0 ?
+        std::min(search_groups.size(), static_cast<size_t>(param.max_search_group)) :
+        search_groups.size();
+    auto& rnd = common::GlobalRandom();
+    for (size_t k = 0; k < nsearch; ++k) {
+      std::uniform_int_distribution<size_t> pick(k, search_groups.size() - 1);
+      std::swap(search_groups[k], search_groups[pick(rnd)]);
     }
+    search_groups.resize(nsearch);
 
     // examine each candidate group: is it okay to insert fid?
     for (auto gid : search_groups) {
@@ -327,6 +544,32 @@ FastFeatureGrouping(const GHistIndexMatrix& gmat,
     groups = std::move(ret);
   }
 
+  // a block only decides which thread adds the bins of its features, so the
+  // sparse singletons share blocks of at most nrow entries even where they
+  // conflict; otherwise each of them costs a pass over the rows of a node
+  {
+    std::vector<std::vector<unsigned>> ret;
+    std::vector<unsigned> block;
+    size_t block_nnz = 0;
+    for (auto& group : groups) {
+      const bool sparse = group.size() == 1 &&
+          static_cast<double>(feature_nnz[group[0]]) / nrow <= param.sparse_threshold;
+      if (!sparse) {
+        ret.push_back(std::move(group));
+        continue;
+      }
+      if (!block.empty() && block_nnz + feature_nnz[group[0]] > nrow) {
+        ret.push_back(std::move(block));
+        block.clear();
+        block_nnz = 0;
+      }
+      block.push_back(group[0]);
+      block_nnz += feature_nnz[group[0]];
+    }
+    if (!block.empty()) ret.push_back(std::move(block));
+    groups = std::move(ret);
+  }
+
   // shuffle groups
   std::shuffle(groups.begin(), groups.end(), common::GlobalRandom());
 
@@ -397,27 +640,33 @@ void GHistIndexBlockMatrix::Init(const GHistIndexMatrix& gmat,
   }
 }
 
-void GHistBuilder::BuildHist(const std::vector<GradientPair>& gpair,
-                             const RowSetCollection::Elem row_indices,
-                             const GHistIndexMatrix& gmat,
-                             const std::vector<bst_uint>& feat_set,
-                             GHistRow hist) {
-  data_.resize(nbins_ * nthread_, GHistEntry());
-  std::fill(data_.begin(), data_.end(), GHistEntry());
-
+/*!
+ * \brief add the gradient statistics of the rows to the per thread
+ *  histograms in data, reading the bin indices as BinIdxType; with kDense
+ *  the k-th entry of a row is of feature k and its bin is relative.
+ */
+template <bool kDense, typename BinIdxType, typename StatType,
+          typename GradientType, typename EntryType>
+static void BuildHistKernel(const GradientType& gpair,
+                            const RowSetCollection::Elem row_indices,
+                            const GHistIndexMatrix& gmat,
+                            size_t nbins, bst_omp_uint nthread,
+                            std::vector<EntryType>* p_data) {
   constexpr int kUnroll = 8;  // loop unrolling factor
-  const auto nthread = static_cast<bst_omp_uint>(this->nthread_);
+  const BinIdxType* index = gmat.index.Data<BinIdxType>();
+  const uint32_t* offset = dmlc::BeginPtr(gmat.index.FeatureOffset());
+  std::vector<EntryType>& data = *p_data;
   const size_t nrows = row_indices.end - row_indices.begin;
   const size_t rest = nrows % kUnroll;
 
   #pragma omp parallel for num_threads(nthread) schedule(guided)
   for (bst_omp_uint i = 0; i < nrows - rest; i += kUnroll) {
     const bst_omp_uint tid = omp_get_thread_num();
-    const size_t off = tid * nbins_;
+    const size_t off = tid * nbins;
     size_t rid[kUnroll];
     size_t ibegin[kUnroll];
     size_t iend[kUnroll];
-    GradientPair stat[kUnroll];
+    StatType stat[kUnroll];
     for (int k = 0; k < kUnroll; ++k) {
       rid[k] = row_indices.begin[i + k];
     }
@@ -430,8 +679,8 @@ void GHistBuilder::BuildHist(const std::vector<GradientPair>& gpair,
     }
     for (int k = 0; k < kUnroll; ++k) {
       for (size_t j = ibegin[k]; j < iend[k]; ++j) {
-        const uint32_t bin = gmat.index[j];
-        data_[off + bin].Add(stat[k]);
+        const uint32_t bin = kDense ? offset[j - ibegin[k]] + index[j] : index[j];
+        data[off + bin].Add(stat[k]);
       }
     }
   }
@@ -439,12 +688,57 @@ void GHistBuilder::BuildHist(const std::vector<GradientPair>& gpair,
     const size_t rid = row_indices.begin[i];
     const size_t ibegin = gmat.row_ptr[rid];
     const size_t iend = gmat.row_ptr[rid + 1];
-    const GradientPair stat = gpair[rid];
+    const StatType stat = gpair[rid];
     for (size_t j = ibegin; j < iend; ++j) {
-      const uint32_t bin = gmat.index[j];
-      data_[bin].Add(stat);
+      const uint32_t bin = kDense ? offset[j - ibegin] + index[j] : index[j];
+      data[bin].Add(stat);
     }
   }
+}
+
+// dispatch BuildHistKernel on the width and layout of the bin indices
+template <typename StatType, typename GradientType, typename EntryType>
+static void DispatchBuildHist(const GradientType& gpair,
+                              const RowSetCollection::Elem row_indices,
+                              const GHistIndexMatrix& gmat,
+                              size_t nbins, bst_omp_uint nthread,
+                              std::vector<EntryType>* p_data) {
+  const bool dense = !gmat.index.FeatureOffset().empty();
+  switch (gmat.index.Width()) {
+    case 1:
+      if (dense) {
+        BuildHistKernel<true, uint8_t, StatType>(gpair, row_indices, gmat, nbins, nthread, p_data);
+      } else {
+        BuildHistKernel<false, uint8_t, StatType>(gpair, row_indices, gmat, nbins, nthread, p_data);
+      }
+      break;
+    case 2:
+      if (dense) {
+        BuildHistKernel<true, uint16_t, StatType>(gpair, row_indices, gmat, nbins, nthread, p_data);
+      } else {
+        BuildHistKernel<false, uint16_t, StatType>(gpair, row_indices, gmat, nbins, nthread, p_data);
+      }
+      break;
+    default:
+      if (dense) {
+        BuildHistKernel<true, uint32_t, StatType>(gpair, row_indices, gmat, nbins, nthread, p_data);
+      } else {
+        BuildHistKernel<false, uint32_t, StatType>(gpair, row_indices, gmat, nbins, nthread, p_data);
+      }
+  }
+}
+
+void GHistBuilder::BuildHist(const std::vector<GradientPair>& gpair,
+                             const RowSetCollection::Elem row_indices,
+                             const GHistIndexMatrix& gmat,
+                             const std::vector<bst_uint>& feat_set,
+                             GHistRow hist) {
+  data_.resize(nbins_ * nthread_, GHistEntry());
+  std::fill(data_.begin(), data_.end(), GHistEntry());
+  bytes_.Set(data_.size() * sizeof(GHistEntry) + data_int_.size() * sizeof(GHistEntryInt));
+
+  const auto nthread = static_cast<bst_omp_uint>(this->nthread_);
+  DispatchBuildHist<GradientPair>(gpair, row_indices, gmat, nbins_, nthread, &data_);
 
   /* reduction */
   const uint32_t nbins = nbins_;
@@ -456,6 +750,254 @@ void GHistBuilder::BuildHist(const std::vector<GradientPair>& gpair,
   }
 }
 
+void QuantizedGradient::Build(const std::vector<GradientPair>& gpair) {
+  const auto ndata = static_cast<bst_omp_uint>(gpair.size());
+  const int nthread = omp_get_max_threads();
+  std::vector<double> grad_max(nthread, 0.0), hess_max(nthread, 0.0);
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint i = 0; i < ndata; ++i) {
+    const int tid = omp_get_thread_num();
+    if (gpair[i].GetHess() < 0.0f) continue;
+    grad_max[tid] = std::max(grad_max[tid], std::abs(static_cast<double>(gpair[i].GetGrad())));
+    hess_max[tid] = std::max(hess_max[tid], static_cast<double>(gpair[i].GetHess()));
+  }
+  const double gmax = *std::max_element(grad_max.begin(), grad_max.end());
+  const double hmax = *std::max_element(hess_max.begin(), hess_max.end());
+  grad_scale_ = gmax > 0.0 ? gmax / 32767.0 : 1.0;
+  hess_scale_ = hmax > 0.0 ? hmax / 32767.0 : 1.0;
+  data_.resize(gpair.size());
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint i = 0; i < ndata; ++i) {
+    if (gpair[i].GetHess() < 0.0f) {
+      data_[i].grad = data_[i].hess = 0;
+    } else {
+      data_[i].grad = static_cast<int16_t>(std::lround(gpair[i].GetGrad() / grad_scale_));
+      data_[i].hess = static_cast<int16_t>(std::lround(gpair[i].GetHess() / hess_scale_));
+    }
+  }
+}
+
+void GHistBuilder::BuildHist(const QuantizedGradient& gpair,
+                             const RowSetCollection::Elem row_indices,
+                             const GHistIndexMatrix& gmat,
+                             const std::vector<bst_uint>& feat_set,
+                             GHistRow hist) {
+  data_int_.resize(nbins_ * nthread_, GHistEntryInt());
+  std::fill(data_int_.begin(), data_int_.end(), GHistEntryInt());
+  bytes_.Set(data_.size() * sizeof(GHistEntry) + data_int_.size() * sizeof(GHistEntryInt));
+
+  const auto nthread = static_cast<bst_omp_uint>(this->nthread_);
+  DispatchBuildHist<QuantizedGradient::Entry>(gpair, row_indices, gmat, nbins_, nthread,
+                                              &data_int_);
+
+  /* reduction, the integer sums are converted once per bin */
+  const uint32_t nbins = nbins_;
+  const double grad_scale = gpair.GradScale();
+  const double hess_scale = gpair.HessScale();
+  #pragma omp parallel for num_threads(nthread) schedule(static)
+  for (bst_omp_uint bin_id = 0; bin_id < bst_omp_uint(nbins); ++bin_id) {
+    GHistEntryInt sum;
+    for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
+      sum.sum_grad += data_int_[tid * nbins_ + bin_id].sum_grad;
+      sum.sum_hess += data_int_[tid * nbins_ + bin_id].sum_hess;
+    }
+    hist.begin[bin_id].sum_grad += sum.sum_grad * grad_scale;
+    hist.begin[bin_id].sum_hess += sum.sum_hess * hess_scale;
+  }
+}
+
+// bytes of the partial histograms of a thread in a BuildHists tile, about an L2 cache
+constexpr size_t kHistTileBytes = 256 * 1024;
+// rows of a work item of BuildHists
+constexpr size_t kHistRowBlock = 256;
+
+// a block of the rows of a node, the work item of BuildHists
+struct HistRowBlock {
+  size_t node;
+  const size_t* begin;
+  const size_t* end;
+};
+
+// add the partial sums of the threads to a bin
+static inline void AddPartials(const GHistEntry* part, int nthread, size_t stride,
+                               double grad_scale, double hess_scale, GHistEntry* out) {
+  for (int tid = 0; tid < nthread; ++tid) {
+    out->Add(part[tid * stride]);
+  }
+}
+
+static inline void AddPartials(const GHistEntryInt* part, int nthread, size_t stride,
+                               double grad_scale, double hess_scale, GHistEntry* out) {
+  GHistEntryInt sum;
+  for (int tid = 0; tid < nthread; ++tid) {
+    sum.sum_grad += part[tid * stride].sum_grad;
+    sum.sum_hess += part[tid * stride].sum_hess;
+  }
+  out->sum_grad += sum.sum_grad * grad_scale;
+  out->sum_hess += sum.sum_hess * hess_scale;
+}
+
+/*!
+ * \brief add the row blocks of nnode nodes to bins [tile_begin, tile_begin +
+ *  tile_size) of their histograms; with kDense only features [fbegin, fend)
+ *  are read, and the sparse rows must fall within the tile. Each thread sums
+ *  into its own partial histograms of the nodes, reduced once at the end.
+ */
+template <bool kDense, typename BinIdxType, typename GradientType, typename EntryType>
+static void BuildHistsTile(const GradientType& gpair,
+                           const std::vector<HistRowBlock>& blocks,
+                           const GHistIndexMatrix& gmat,
+                           uint32_t fbegin, uint32_t fend,
+                           uint32_t tile_begin, uint32_t tile_size,
+                           const GHistRow* hists, size_t nnode,
+                           bst_omp_uint nthread, double grad_scale, double hess_scale,
+                           EntryType* data) {
+  const BinIdxType* index = gmat.index.Data<BinIdxType>();
+  const uint32_t* offset = dmlc::BeginPtr(gmat.index.FeatureOffset());
+  const size_t stride = nnode * tile_size;
+  const auto nblock = static_cast<bst_omp_uint>(blocks.size());
+  const auto nentry = static_cast<bst_omp_uint>(stride);
+
+  #pragma omp parallel num_threads(nthread)
+  {
+    const int nthread_used = omp_get_num_threads();
+    EntryType* part = data + omp_get_thread_num() * stride;
+    std::fill(part, part + stride, EntryType());
+    #pragma omp for schedule(dynamic)
+    for (bst_omp_uint b = 0; b < nblock; ++b) {
+      EntryType* hist = part + blocks[b].node * tile_size;
+      for (const size_t* it = blocks[b].begin; it != blocks[b].end; ++it) {
+        const size_t rid = *it;
+        const auto stat = gpair[rid];
+        const size_t ibegin = gmat.row_ptr[rid];
+        if (kDense) {
+          for (uint32_t k = fbegin; k < fend; ++k) {
+            hist[offset[k] + index[ibegin + k] - tile_begin].Add(stat);
+          }
+        } else {
+          const size_t iend = gmat.row_ptr[rid + 1];
+          for (size_t j = ibegin; j < iend; ++j) {
+            hist[index[j] - tile_begin].Add(stat);
+          }
+        }
+      }
+    }
+    #pragma omp for schedule(static)
+    for (bst_omp_uint i = 0; i < nentry; ++i) {
+      AddPartials(data + i, nthread_used, stride, grad_scale, hess_scale,
+                  hists[i / tile_size].begin + tile_begin + i % tile_size);
+    }
+  }
+}
+
+/*!
+ * \brief build the histograms of several nodes. The nodes are taken in chunks
+ *  and the bins in feature aligned tiles, so that the partial histograms of a
+ *  thread stay within kHistTileBytes; the bins of sparse rows are not aligned
+ *  to features and form a single tile.
+ */
+template <typename GradientType, typename EntryType>
+static void BuildHistsImpl(const GradientType& gpair,
+                           const std::vector<RowSetCollection::Elem>& row_indices,
+                           const GHistIndexMatrix& gmat,
+                           const std::vector<GHistRow>& hists,
+                           bst_omp_uint nthread, double grad_scale, double hess_scale,
+                           std::vector<EntryType>* p_data) {
+  const std::vector<uint32_t>& cut_ptr = gmat.cut.row_ptr;
+  const auto nfeature = static_cast<uint32_t>(cut_ptr.size() - 1);
+  const bool dense = !gmat.index.FeatureOffset().empty();
+  // the widest part of a tile that can not be cut
+  uint32_t unit = dense ? 1 : cut_ptr.back();
+  if (dense) {
+    for (uint32_t fid = 0; fid < nfeature; ++fid) {
+      unit = std::max(unit, cut_ptr[fid + 1] - cut_ptr[fid]);
+    }
+  }
+  const size_t chunk = std::max(kHistTileBytes / (std::max(unit, 1U) * sizeof(EntryType)),
+                                static_cast<size_t>(1));
+  std::vector<HistRowBlock> blocks;
+  for (size_t nbegin = 0; nbegin < row_indices.size(); nbegin += chunk) {
+    const size_t nend = std::min(row_indices.size(), nbegin + chunk);
+    const size_t nnode = nend - nbegin;
+    blocks.clear();
+    for (size_t n = nbegin; n < nend; ++n) {
+      const size_t nrow = row_indices[n].Size();
+      for (size_t i = 0; i < nrow; i += kHistRowBlock) {
+        blocks.push_back({n - nbegin, row_indices[n].begin + i,
+                          row_indices[n].begin + std::min(i + kHistRowBlock, nrow)});
+      }
+    }
+    uint32_t fbegin = 0;
+    while (fbegin < nfeature) {
+      uint32_t fend = dense ? fbegin + 1 : nfeature;
+      while (fend < nfeature && (cut_ptr[fend + 1] - cut_ptr[fbegin]) * nnode *
+             sizeof(EntryType) <= kHistTileBytes) {
+        ++fend;
+      }
+      const uint32_t tile_begin = cut_ptr[fbegin];
+      const uint32_t tile_size = cut_ptr[fend] - tile_begin;
+      if (p_data->size() < nthread * nnode * tile_size) {
+        p_data->resize(nthread * nnode * tile_size);
+      }
+      EntryType* data = dmlc::BeginPtr(*p_data);
+      const GHistRow* tile_hists = dmlc::BeginPtr(hists) + nbegin;
+      switch (gmat.index.Width()) {
+        case 1:
+          if (dense) {
+            BuildHistsTile<true, uint8_t>(gpair, blocks, gmat, fbegin, fend, tile_begin,
+                                          tile_size, tile_hists, nnode, nthread,
+                                          grad_scale, hess_scale, data);
+          } else {
+            BuildHistsTile<false, uint8_t>(gpair, blocks, gmat, fbegin, fend, tile_begin,
+                                           tile_size, tile_hists, nnode, nthread,
+                                           grad_scale, hess_scale, data);
+          }
+          break;
+        case 2:
+          if (dense) {
+            BuildHistsTile<true, uint16_t>(gpair, blocks, gmat, fbegin, fend, tile_begin,
+                                           tile_size, tile_hists, nnode, nthread,
+                                           grad_scale, hess_scale, data);
+          } else {
+            BuildHistsTile<false, uint16_t>(gpair, blocks, gmat, fbegin, fend, tile_begin,
+                                            tile_size, tile_hists, nnode, nthread,
+                                            grad_scale, hess_scale, data);
+          }
+          break;
+        default:
+          if (dense) {
+            BuildHistsTile<true, uint32_t>(gpair, blocks, gmat, fbegin, fend, tile_begin,
+                                           tile_size, tile_hists, nnode, nthread,
+                                           grad_scale, hess_scale, data);
+          } else {
+            BuildHistsTile<false, uint32_t>(gpair, blocks, gmat, fbegin, fend, tile_begin,
+                                            tile_size, tile_hists, nnode, nthread,
+                                            grad_scale, hess_scale, data);
+          }
+      }
+      fbegin = fend;
+    }
+  }
+}
+
+void GHistBuilder::BuildHists(const std::vector<GradientPair>& gpair,
+                              const std::vector<RowSetCollection::Elem>& row_indices,
+                              const GHistIndexMatrix& gmat,
+                              const std::vector<GHistRow>& hists) {
+  CHECK_EQ(row_indices.size(), hists.size());
+  BuildHistsImpl(gpair, row_indices, gmat, hists, static_cast<bst_omp_uint>(nthread_),
+                 1.0, 1.0, &data_);
+}
+
+void GHistBuilder::BuildHists(const QuantizedGradient& gpair,
+                              const std::vector<RowSetCollection::Elem>& row_indices,
+                              const GHistIndexMatrix& gmat,
+                              const std::vector<GHistRow>& hists) {
+  CHECK_EQ(row_indices.size(), hists.size());
+  BuildHistsImpl(gpair, row_indices, gmat, hists, static_cast<bst_omp_uint>(nthread_),
+                 gpair.GradScale(), gpair.HessScale(), &data_int_);
+}
+
 void GHistBuilder::BuildBlockHist(const std::vector<GradientPair>& gpair,
                                   const RowSetCollection::Elem row_indices,
                                   const GHistIndexBlockMatrix& gmatb,
@@ -8,9 +8,13 @@
 #define XGBOOST_COMMON_HIST_UTIL_H_
 
 #include <xgboost/data.h>
+#include <algorithm>
+#include <cstdint>
 #include <limits>
+#include <string>
 #include <vector>
 #include "row_set.h"
+#include "./memory_tracker.h"
 #include "../tree/fast_hist_param.h"
 #include "../tree/param.h"
 #include "./quantile.h"
@@ -54,6 +58,51 @@ struct GHistEntry {
 };
 
 
+/*!
+ * \brief gradient pairs of a round quantized to int16, with one scale for the
+ *  gradients and one for the Hessians: half the bytes of GradientPair to
+ *  stream per row. Histograms sum the integers exactly and are converted to
+ *  GHistEntry once per bin.
+ */
+class QuantizedGradient {
+ public:
+  struct Entry {
+    int16_t grad;
+    int16_t hess;
+  };
+  /*!
+   * \brief quantize the gradient of a round to the nearest multiple of the
+   *  scales that map the largest magnitudes to 32767. Deleted rows, with a
+   *  negative Hessian, become zero.
+   */
+  void Build(const std::vector<GradientPair>& gpair);
+  inline const Entry& operator[](size_t i) const {
+    return data_[i];
+  }
+  inline double GradScale() const {
+    return grad_scale_;
+  }
+  inline double HessScale() const {
+    return hess_scale_;
+  }
+
+ private:
+  std::vector<Entry> data_;
+  double grad_scale_{1.0};
+  double hess_scale_{1.0};
+};
+
+/*! \brief integer sums of quantized gradient statistics of a histogram bin */
+struct GHistEntryInt {
+  int64_t sum_grad{0};
+  int64_t sum_hess{0};
+
+  inline void Add(const QuantizedGradient::Entry& e) {
+    sum_grad += e.grad;
+    sum_hess += e.hess;
+  }
+};
+
 /*! \brief Cut configuration for one feature */
 struct HistCutUnit {
   /*! \brief the index pointer of each histunit */
@@ -85,10 +134,30 @@ struct HistCutMatrix {
   using WXQSketch = common::WXQuantileSketch<bst_float, bst_float>;
 
   // create histogram cut matrix given statistics from data
-  // using approximate quantile sketch approach
-  void Init(DMatrix* p_fmat, uint32_t max_num_bins);
+  // using approximate quantile sketch approach,
+  // the cuts are reused from cache_file when it holds the cuts of the same data
+  void Init(DMatrix* p_fmat, uint32_t max_num_bins,
+            const std::string& cache_file = "", bst_float robust_eps = 0.0f);
+
+  // when robust_eps > 0, the frequent values v of a feature also get the cuts
+  // v - eps and v + eps, the thresholds at which the eps-robust gain changes
+  void Init(std::vector<WXQSketch>* sketchs, uint32_t max_num_bins,
+            bst_float robust_eps = 0.0f);
+
+  /*! \brief key of the rows, weights and parameters the cuts are computed from */
+  static uint64_t CacheKey(DMatrix* p_fmat, uint32_t max_num_bins, bst_float robust_eps);
+  /*! \brief save the cuts along with the key of their data */
+  void Save(dmlc::Stream* fo, uint64_t key) const;
+  /*!
+   * \brief load the cuts saved with the same key
+   * \return false when the stream holds no cuts or the cuts of other data
+   */
+  bool Load(dmlc::Stream* fi, uint64_t key);
 
-  void Init(std::vector<WXQSketch>* sketchs, uint32_t max_num_bins);
+ private:
+  // the eps boundary cuts of the frequent values of a summary, within half of max_num_bins
+  static void RobustBoundary(const WXQSketch::Summary& summary, uint32_t max_num_bins,
+                             bst_float robust_eps, std::vector<bst_float>* out);
 };
 
 /*! \brief Builds the cut matrix on the GPU */
@@ -110,6 +179,61 @@ struct GHistIndexRow {
       : index(index), size(size) {}
 };
 
+/*!
+ * \brief global bin indices of the entries of a GHistIndexMatrix, stored in
+ *  the fewest of 1, 2 or 4 bytes that hold them. When the k-th entry of every
+ *  row is of feature k, as in dense data, the bins are stored relative to the
+ *  first bin of their feature, so max_bin <= 256 takes a byte per entry.
+ */
+class BinIndex {
+ public:
+  /*!
+   * \brief store the bins
+   * \param index global bin of each entry
+   * \param offset first bin of each feature when the rows are dense, or empty
+   */
+  void Init(const std::vector<uint32_t>& index, std::vector<uint32_t> offset);
+  // global bin of the i-th entry
+  inline uint32_t operator[](size_t i) const {
+    switch (width_) {
+      case 1:
+        return this->Offset(i) + data_[i];
+      case 2:
+        return this->Offset(i) + this->Data<uint16_t>()[i];
+      default:
+        return this->Offset(i) + this->Data<uint32_t>()[i];
+    }
+  }
+  inline size_t size() const {
+    return size_;
+  }
+  // number of bytes of an entry
+  inline int Width() const {
+    return width_;
+  }
+  // the stored entries, BinIdxType must have Width() bytes
+  template <typename BinIdxType>
+  inline const BinIdxType* Data() const {
+    return reinterpret_cast<const BinIdxType*>(dmlc::BeginPtr(data_));
+  }
+  // first bin of each feature of dense rows, empty otherwise
+  inline const std::vector<uint32_t>& FeatureOffset() const {
+    return offset_;
+  }
+  inline size_t MemCostBytes() const {
+    return data_.size() + offset_.size() * sizeof(uint32_t);
+  }
+
+ private:
+  inline uint32_t Offset(size_t i) const {
+    return offset_.empty() ? 0 : offset_[i % offset_.size()];
+  }
+  std::vector<uint8_t> data_;
+  std::vector<uint32_t> offset_;
+  size_t size_{0};
+  int width_{4};
+};
+
 /*!
  * \brief preprocessed global index matrix, in CSR format
  *  Transform floating values to integer index in histogram
@@ -119,17 +243,20 @@ struct GHistIndexMatrix {
   /*! \brief row pointer to rows by element position */
   std::vector<size_t> row_ptr;
   /*! \brief The index data */
-  std::vector<uint32_t> index;
+  BinIndex index;
   /*! \brief hit count of each index */
   std::vector<size_t> hit_count;
   /*! \brief The corresponding cuts */
   HistCutMatrix cut;
   // Create a global histogram matrix, given cut
-  void Init(DMatrix* p_fmat, int max_num_bins);
-  // get i-th row
-  inline GHistIndexRow operator[](size_t i) const {
-    return {&index[0] + row_ptr[i], row_ptr[i + 1] - row_ptr[i]};
-  }
+  void Init(DMatrix* p_fmat, int max_num_bins, const std::string& cut_cache = "",
+            bst_float robust_eps = 0.0f);
+  /*!
+   * \brief index the rows appended to p_fmat since it was indexed, with the
+   *  cuts of its first rows. Their values beyond the cuts fall in the bins at
+   *  the ends, so the features must be those of the cuts.
+   */
+  void AppendRows(DMatrix* p_fmat);
   inline void GetFeatureCounts(size_t* counts) const {
     auto nfeature = cut.row_ptr.size() - 1;
     for (unsigned fid = 0; fid < nfeature; ++fid) {
@@ -142,7 +269,13 @@ struct GHistIndexMatrix {
   }
 
  private:
+  // bin the rows of p_fmat after the indexed ones into global
+  void AddRows(DMatrix* p_fmat, std::vector<uint32_t>* p_global);
+  // store the bins of all the rows in index
+  void StoreIndex(const std::vector<uint32_t>& global);
+
   std::vector<size_t> hit_count_tloc_;
+  TrackedBytes bytes_{kMemGradientIndex};
 };
 
 struct GHistIndexBlock {
@@ -205,50 +338,100 @@ struct GHistRow {
 };
 
 /*!
- * \brief histogram of gradient statistics for multiple nodes
+ * \brief histogram of gradient statistics for multiple nodes.
+ *  Each histogram is a buffer of its own in a pool, so adding one never moves
+ *  the others, and the buffers of freed histograms are reused by later nodes
+ *  and trees. The pool may be bounded by a memory budget, the caller then
+ *  evicts histograms with Evict and rebuilds them when needed.
  */
 class HistCollection {
  public:
   // access histogram for i-th node
   inline GHistRow operator[](bst_uint nid) const {
-    constexpr uint32_t kMax = std::numeric_limits<uint32_t>::max();
-    CHECK_NE(row_ptr_[nid], kMax);
-    return {const_cast<GHistEntry*>(dmlc::BeginPtr(data_) + row_ptr_[nid]), nbins_};
+    CHECK(RowExists(nid));
+    return {const_cast<GHistEntry*>(dmlc::BeginPtr(pool_[slot_[nid]])), nbins_};
   }
 
   // have we computed a histogram for i-th node?
   inline bool RowExists(bst_uint nid) const {
-    const uint32_t k_max = std::numeric_limits<uint32_t>::max();
-    return (nid < row_ptr_.size() && row_ptr_[nid] != k_max);
+    return (nid < slot_.size() && slot_[nid] != NoSlot());
   }
 
-  // initialize histogram collection
-  inline void Init(uint32_t nbins) {
+  /*!
+   * \brief initialize histogram collection
+   * \param max_bytes memory budget of the histograms, 0 for no bound
+   */
+  inline void Init(uint32_t nbins, size_t max_bytes = 0) {
+    if (nbins != nbins_) pool_.clear();
     nbins_ = nbins;
-    row_ptr_.clear();
-    data_.clear();
+    bytes_.Set(pool_.size() * nbins_ * sizeof(GHistEntry));
+    slot_.clear();
+    free_.resize(pool_.size());
+    for (size_t i = 0; i < pool_.size(); ++i) free_[i] = pool_.size() - 1 - i;
+    const size_t row_bytes = std::max(static_cast<size_t>(nbins_), static_cast<size_t>(1)) *
+        sizeof(GHistEntry);
+    // a parent and its two children are alive at once
+    max_rows_ = max_bytes == 0 ? 0 : std::max(max_bytes / row_bytes, static_cast<size_t>(3));
   }
 
   // create an empty histogram for i-th node
   inline void AddHistRow(bst_uint nid) {
-    constexpr uint32_t kMax = std::numeric_limits<uint32_t>::max();
-    if (nid >= row_ptr_.size()) {
-      row_ptr_.resize(nid + 1, kMax);
+    if (nid >= slot_.size()) {
+      slot_.resize(nid + 1, NoSlot());
+    }
+    CHECK_EQ(slot_[nid], NoSlot());
+    if (free_.empty()) {
+      free_.push_back(pool_.size());
+      pool_.emplace_back(nbins_);
+      bytes_.Set(pool_.size() * nbins_ * sizeof(GHistEntry));
+    } else {
+      std::vector<GHistEntry>& row = pool_[free_.back()];
+      std::fill(row.begin(), row.end(), GHistEntry());
     }
-    CHECK_EQ(row_ptr_[nid], kMax);
+    slot_[nid] = free_.back();
+    free_.pop_back();
+  }
 
-    row_ptr_[nid] = data_.size();
-    data_.resize(data_.size() + nbins_);
+  // release the histogram of i-th node to the pool
+  inline void FreeHistRow(bst_uint nid) {
+    if (!RowExists(nid)) return;
+    free_.push_back(slot_[nid]);
+    slot_[nid] = NoSlot();
   }
 
- private:
-  /*! \brief number of all bins over all features */
-  uint32_t nbins_;
+  /*!
+   * \brief free the histograms of the oldest nodes other than keep until
+   *  nrow more fit in the memory budget
+   */
+  inline void Evict(size_t nrow, bst_uint keep) {
+    if (max_rows_ == 0) return;
+    for (bst_uint nid = 0; nid < slot_.size() && NumRows() + nrow > max_rows_; ++nid) {
+      if (nid != keep) FreeHistRow(nid);
+    }
+  }
 
-  std::vector<GHistEntry> data_;
+  // number of histograms alive
+  inline size_t NumRows() const {
+    return pool_.size() - free_.size();
+  }
 
-  /*! \brief row_ptr_[nid] locates bin for historgram of node nid */
-  std::vector<size_t> row_ptr_;
+ private:
+  static inline size_t NoSlot() {
+    return std::numeric_limits<size_t>::max();
+  }
+  /*! \brief number of all bins over all features */
+  uint32_t nbins_{0};
+  /*! \brief number of histograms in the memory budget, 0 for no bound */
+  size_t max_rows_{0};
+
+  /*! \brief histogram buffers, alive or free */
+  std::vector<std::vector<GHistEntry> > pool_;
+  /*! \brief slots of pool_ that are free */
+  std::vector<size_t> free_;
+  /*! \brief slot_[nid] is the buffer of the histogram of node nid */
+  std::vector<size_t> slot_;
+  /*! \brief bytes of the buffers of pool_ */
+  TrackedBytes bytes_{kMemHistogram};
 };
 
 /*!
@@ -268,6 +451,23 @@ class GHistBuilder {
                  const GHistIndexMatrix& gmat,
                  const std::vector<bst_uint>& feat_set,
                  GHistRow hist);
+  // same, summing the quantized gradient in integers
+  void BuildHist(const QuantizedGradient& gpair,
+                 const RowSetCollection::Elem row_indices,
+                 const GHistIndexMatrix& gmat,
+                 const std::vector<bst_uint>& feat_set,
+                 GHistRow hist);
+  // construct the histograms of several nodes in one pass over their rows,
+  // tiled by bin range so that the per thread partial histograms stay in cache
+  void BuildHists(const std::vector<GradientPair>& gpair,
+                  const std::vector<RowSetCollection::Elem>& row_indices,
+                  const GHistIndexMatrix& gmat,
+                  const std::vector<GHistRow>& hists);
+  // same, summing the quantized gradient in integers
+  void BuildHists(const QuantizedGradient& gpair,
+                  const std::vector<RowSetCollection::Elem>& row_indices,
+                  const GHistIndexMatrix& gmat,
+                  const std::vector<GHistRow>& hists);
   // same, with feature grouping
   void BuildBlockHist(const std::vector<GradientPair>& gpair,
                       const RowSetCollection::Elem row_indices,
@@ -283,6 +483,9 @@ class GHistBuilder {
   /*! \brief number of all bins over all features */
   uint32_t nbins_;
   std::vector<GHistEntry> data_;
+  std::vector<GHistEntryInt> data_int_;
+  /*! \brief bytes of the per thread histograms */
+  TrackedBytes bytes_{kMemHistogram};
 };
 
 
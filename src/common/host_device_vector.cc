@@ -9,15 +9,19 @@
 
 #include <utility>
 #include "./host_device_vector.h"
+#include "./memory_tracker.h"
 
 namespace xgboost {
 
 template <typename T>
 struct HostDeviceVectorImpl {
-  explicit HostDeviceVectorImpl(size_t size, T v) : data_h_(size, v) {}
-  HostDeviceVectorImpl(std::initializer_list<T> init) : data_h_(init) {}
-  explicit HostDeviceVectorImpl(std::vector<T>  init) : data_h_(std::move(init)) {}
+  explicit HostDeviceVectorImpl(size_t size, T v) : data_h_(size, v) { Track(); }
+  HostDeviceVectorImpl(std::initializer_list<T> init) : data_h_(init) { Track(); }
+  explicit HostDeviceVectorImpl(std::vector<T>  init) : data_h_(std::move(init)) { Track(); }
+  // the vector may be resized through HostVector, it is counted again at the next call
+  void Track() { bytes_.Set(data_h_.capacity() * sizeof(T)); }
   std::vector<T> data_h_;
+  common::TrackedBytes bytes_{common::kMemHostDeviceVector};
 };
 
 template <typename T>
@@ -54,11 +58,30 @@ template <typename T>
 T* HostDeviceVector<T>::DevicePointer(int device) { return nullptr; }
 
 template <typename T>
-std::vector<T>& HostDeviceVector<T>::HostVector() { return impl_->data_h_; }
+const T* HostDeviceVector<T>::ConstDevicePointer(int device) { return nullptr; }
+
+template <typename T>
+std::vector<T>& HostDeviceVector<T>::HostVector() {
+  impl_->Track();
+  return impl_->data_h_;
+}
+
+template <typename T>
+const std::vector<T>& HostDeviceVector<T>::ConstHostVector() { return impl_->data_h_; }
+
+template <typename T>
+T* HostDeviceVector<T>::HostRange(size_t begin, size_t end) {
+  CHECK(begin <= end && end <= Size());
+  return impl_->data_h_.data() + begin;
+}
+
+template <typename T>
+void HostDeviceVector<T>::PrefetchDevices() { }
 
 template <typename T>
 void HostDeviceVector<T>::Resize(size_t new_size, T v) {
   impl_->data_h_.resize(new_size, v);
+  impl_->Track();
 }
 
 template <typename T>
@@ -6,6 +6,7 @@
 #include <thrust/fill.h>
 #include "./host_device_vector.h"
 #include "./device_helpers.cuh"
+#include "./memory_tracker.h"
 
 namespace xgboost {
 
@@ -13,7 +14,9 @@ namespace xgboost {
 template <typename T>
 struct HostDeviceVectorImpl {
   struct DeviceShard {
-    DeviceShard() : index_(-1), device_(-1), start_(0), on_d_(false), vec_(nullptr) {}
+    DeviceShard()
+      : index_(-1), device_(-1), start_(0), on_d_(false), on_h_(false),
+        dirty_begin_(0), dirty_end_(0), vec_(nullptr) {}
 
     static size_t ShardStart(size_t size, int ndevices, int index) {
       size_t portion = dh::DivRoundUp(size, ndevices);
@@ -42,47 +45,90 @@ struct HostDeviceVectorImpl {
       dh::safe_cuda(cudaSetDevice(device_));
       data_.resize(size_d);
       on_d_ = !vec_->on_h_;
+      on_h_ = vec_->on_h_;
+      dirty_begin_ = dirty_end_ = 0;
     }
 
     void ScatterFrom(const T* begin) {
-      // TODO(canonizer): avoid full copy of host data
-      LazySyncDevice();
+      OverwriteDevice();
       dh::safe_cuda(cudaSetDevice(device_));
       dh::safe_cuda(cudaMemcpy(data_.data().get(), begin + start_,
                                data_.size() * sizeof(T), cudaMemcpyDefault));
     }
 
     void GatherTo(thrust::device_ptr<T> begin) {
-      LazySyncDevice();
+      SyncDevice();
       dh::safe_cuda(cudaSetDevice(device_));
       dh::safe_cuda(cudaMemcpy(begin.get() + start_, data_.data().get(),
                                data_.size() * sizeof(T), cudaMemcpyDefault));
     }
 
     void Fill(T v) {
-      // TODO(canonizer): avoid full copy of host data
-      LazySyncDevice();
+      OverwriteDevice();
       dh::safe_cuda(cudaSetDevice(device_));
       thrust::fill(data_.begin(), data_.end(), v);
     }
 
     void Copy(DeviceShard* other) {
-      // TODO(canonizer): avoid full copy of host data for this (but not for other)
-      LazySyncDevice();
-      other->LazySyncDevice();
+      OverwriteDevice();
+      other->SyncDevice();
       dh::safe_cuda(cudaSetDevice(device_));
       dh::safe_cuda(cudaMemcpy(data_.data().get(), other->data_.data().get(),
                                data_.size() * sizeof(T), cudaMemcpyDefault));
     }
 
-    void LazySyncHost() {
-      dh::safe_cuda(cudaSetDevice(device_));
-      thrust::copy(data_.begin(), data_.end(), vec_->data_h_.begin() + start_);
+    // bring the host copy of the shard up to date, the device copy stays valid
+    void SyncHost() {
+      if (on_h_) { return; }
+      // the range written on the host is newer there
+      if (dirty_end_ > dirty_begin_) {
+        CopyToHost(start_, dirty_begin_);
+        CopyToHost(dirty_end_, start_ + data_.size());
+      } else {
+        CopyToHost(start_, start_ + data_.size());
+      }
+      on_h_ = true;
+    }
+
+    // the host writes the elements [begin, end) of the vector
+    void WriteHostRange(size_t begin, size_t end) {
+      begin = std::max(begin, start_);
+      end = std::min(end, start_ + data_.size());
+      // without a device copy, the host copy is the only one
+      if (begin >= end || !on_d_) { return; }
+      const bool dirty = dirty_end_ > dirty_begin_;
+      const size_t range_begin = dirty ? std::min(begin, dirty_begin_) : begin;
+      const size_t range_end = dirty ? std::max(end, dirty_end_) : end;
+      if (!on_h_) {
+        if (dirty) {
+          CopyToHost(range_begin, dirty_begin_);
+          CopyToHost(dirty_end_, range_end);
+        } else {
+          CopyToHost(range_begin, range_end);
+        }
+      }
+      dirty_begin_ = range_begin;
+      dirty_end_ = range_end;
+    }
+
+    // drop the device copy after the host copy is written as a whole
+    void InvalidateDevice() {
       on_d_ = false;
+      dirty_begin_ = dirty_end_ = 0;
     }
 
-    void LazySyncDevice() {
-      if (on_d_) { return; }
+    // bring the device copy up to date, the host copy stays valid
+    void SyncDevice() {
+      if (on_d_) {
+        if (dirty_end_ > dirty_begin_) {
+          // only the range written on the host is copied
+          dh::CopyHostToDevice(device_, data_.data().get() + (dirty_begin_ - start_),
+                               vec_->data_h_.data() + dirty_begin_,
+                               (dirty_end_ - dirty_begin_) * sizeof(T));
+          dirty_begin_ = dirty_end_ = 0;
+        }
+        return;
+      }
       // data is on the host
       size_t size_h = vec_->data_h_.size();
       int ndevices = vec_->devices_.Size();
@@ -90,22 +136,60 @@ struct HostDeviceVectorImpl {
       size_t size_d = ShardSize(size_h, ndevices, index_);
       dh::safe_cuda(cudaSetDevice(device_));
       data_.resize(size_d);
-      thrust::copy(vec_->data_h_.begin() + start_,
-                   vec_->data_h_.begin() + start_ + size_d, data_.begin());
+      dh::CopyHostToDevice(device_, data_.data().get(), vec_->data_h_.data() + start_,
+                           size_d * sizeof(T));
       on_d_ = true;
+      dirty_begin_ = dirty_end_ = 0;
+      vec_->size_d_ = vec_->data_h_.size();
+    }
+
+    // bring the device copy up to date for writing, the host copy is stale then
+    void LazySyncDevice() {
+      SyncDevice();
+      on_h_ = false;
       // this may cause a race condition if LazySyncDevice() is called
       // from multiple threads in parallel;
       // however, the race condition is benign, and will not cause problems
       vec_->on_h_ = false;
-      vec_->size_d_ = vec_->data_h_.size();
+    }
+
+    // the device copy is about to be written as a whole, so the host copy is
+    // not copied to it
+    void OverwriteDevice() {
+      if (!on_d_) {
+        size_t size_h = vec_->data_h_.size();
+        int ndevices = vec_->devices_.Size();
+        start_ = ShardStart(size_h, ndevices, index_);
+        dh::safe_cuda(cudaSetDevice(device_));
+        data_.resize(ShardSize(size_h, ndevices, index_));
+        on_d_ = true;
+        vec_->size_d_ = size_h;
+      }
+      dirty_begin_ = dirty_end_ = 0;
+      on_h_ = false;
+      vec_->on_h_ = false;
+    }
+
+    // copy the elements [begin, end) of the vector from the device to the host
+    void CopyToHost(size_t begin, size_t end) {
+      if (end <= begin) { return; }
+      dh::CopyDeviceToHost(device_, vec_->data_h_.data() + begin,
+                           data_.data().get() + (begin - start_), (end - begin) * sizeof(T));
     }
 
     int index_;
     int device_;
-    thrust::device_vector<T> data_;
+    // resized with the data, from the pool rather than cudaMalloc
+    dh::CachingDeviceVector<T> data_;
     size_t start_;
-    // true if there is an up-to-date copy of data on device, false otherwise
+    // true if there is an up-to-date copy of data on device, false otherwise;
+    // the elements [dirty_begin_, dirty_end_) written on the host since are
+    // copied at the next access
     bool on_d_;
+    // true if the host copy of the shard is up to date
+    bool on_h_;
+    size_t dirty_begin_;
+    size_t dirty_end_;
     HostDeviceVectorImpl<T>* vec_;
   };
 
@@ -117,6 +201,7 @@ struct HostDeviceVectorImpl {
       Fill(v);
     } else {
       data_h_.resize(size, v);
+      TrackHost();
     }
   }
 
@@ -130,6 +215,7 @@ struct HostDeviceVectorImpl {
       Copy(init);
     } else {
       data_h_ = init;
+      TrackHost();
     }
   }
 
@@ -156,15 +242,21 @@ struct HostDeviceVectorImpl {
     return shards_[devices_.Index(device)].data_.data().get();
   }
 
+  const T* ConstDevicePointer(int device) {
+    CHECK(devices_.Contains(device));
+    shards_[devices_.Index(device)].SyncDevice();
+    return shards_[devices_.Index(device)].data_.data().get();
+  }
+
   size_t DeviceSize(int device) {
     CHECK(devices_.Contains(device));
-    LazySyncDevice(device);
+    shards_[devices_.Index(device)].SyncDevice();
     return shards_[devices_.Index(device)].data_.size();
   }
 
   size_t DeviceStart(int device) {
     CHECK(devices_.Contains(device));
-    LazySyncDevice(device);
+    shards_[devices_.Index(device)].SyncDevice();
     return shards_[devices_.Index(device)].start_;
   }
 
@@ -180,6 +272,7 @@ struct HostDeviceVectorImpl {
     CHECK_EQ(end - begin, Size());
     if (on_h_) {
       thrust::copy(begin, end, data_h_.begin());
+      InvalidateDevices();
     } else {
       dh::ExecuteShards(&shards_, [&](DeviceShard& shard) {
           shard.ScatterFrom(begin.get());
@@ -199,6 +292,7 @@ struct HostDeviceVectorImpl {
   void Fill(T v) {
     if (on_h_) {
       std::fill(data_h_.begin(), data_h_.end(), v);
+      InvalidateDevices();
     } else {
       dh::ExecuteShards(&shards_, [&](DeviceShard& shard) { shard.Fill(v); });
     }
@@ -208,6 +302,7 @@ struct HostDeviceVectorImpl {
     CHECK_EQ(Size(), other->Size());
     if (on_h_ && other->on_h_) {
       std::copy(other->data_h_.begin(), other->data_h_.end(), data_h_.begin());
+      InvalidateDevices();
     } else {
       CHECK(devices_ == other->devices_);
       dh::ExecuteIndexShards(&shards_, [&](int i, DeviceShard& shard) {
@@ -220,6 +315,7 @@ struct HostDeviceVectorImpl {
     CHECK_EQ(Size(), other.size());
     if (on_h_) {
       std::copy(other.begin(), other.end(), data_h_.begin());
+      InvalidateDevices();
     } else {
       dh::ExecuteShards(&shards_, [&](DeviceShard& shard) {
           shard.ScatterFrom(other.data());
@@ -231,6 +327,7 @@ struct HostDeviceVectorImpl {
     CHECK_EQ(Size(), other.size());
     if (on_h_) {
       std::copy(other.begin(), other.end(), data_h_.begin());
+      InvalidateDevices();
     } else {
       dh::ExecuteShards(&shards_, [&](DeviceShard& shard) {
           shard.ScatterFrom(other.begin());
@@ -240,9 +337,29 @@ struct HostDeviceVectorImpl {
 
   std::vector<T>& HostVector() {
     LazySyncHost();
+    InvalidateDevices();
     return data_h_;
   }
 
+  const std::vector<T>& ConstHostVector() {
+    LazySyncHost();
+    return data_h_;
+  }
+
+  T* HostRange(size_t begin, size_t end) {
+    CHECK(begin <= end && end <= Size());
+    if (!on_h_ && data_h_.size() != size_d_) {
+      data_h_.resize(size_d_);
+      TrackHost();
+    }
+    for (auto& shard : shards_) { shard.WriteHostRange(begin, end); }
+    return data_h_.data() + begin;
+  }
+
+  void PrefetchDevices() {
+    dh::ExecuteShards(&shards_, [&](DeviceShard& shard) { shard.SyncDevice(); });
+  }
+
   void Reshard(GPUSet new_devices) {
     if (devices_ == new_devices)
       return;
@@ -263,7 +380,9 @@ struct HostDeviceVectorImpl {
     } else {
       // resize on host
       LazySyncHost();
+      InvalidateDevices();
       data_h_.resize(new_size, v);
+      TrackHost();
     }
   }
 
@@ -272,10 +391,19 @@ struct HostDeviceVectorImpl {
       return;
     if (data_h_.size() != size_d_)
       data_h_.resize(size_d_);
-    dh::ExecuteShards(&shards_, [&](DeviceShard& shard) { shard.LazySyncHost(); });
+    dh::ExecuteShards(&shards_, [&](DeviceShard& shard) { shard.SyncHost(); });
     on_h_ = true;
+    TrackHost();
+  }
+
+  void InvalidateDevices() {
+    for (auto& shard : shards_) { shard.InvalidateDevice(); }
   }
 
+  // the host copy may be resized through HostVector, it is counted again at the next call;
+  // the device memory is not counted
+  void TrackHost() { bytes_.Set(data_h_.capacity() * sizeof(T)); }
+
   void LazySyncDevice(int device) {
     CHECK(devices_.Contains(device));
     shards_[devices_.Index(device)].LazySyncDevice();
@@ -287,6 +415,7 @@ struct HostDeviceVectorImpl {
   size_t size_d_;
   GPUSet devices_;
   std::vector<DeviceShard> shards_;
+  common::TrackedBytes bytes_{common::kMemHostDeviceVector};
 };
 
 template <typename T>
@@ -323,6 +452,11 @@ GPUSet HostDeviceVector<T>::Devices() const { return impl_->Devices(); }
 template <typename T>
 T* HostDeviceVector<T>::DevicePointer(int device) { return impl_->DevicePointer(device); }
 
+template <typename T>
+const T* HostDeviceVector<T>::ConstDevicePointer(int device) {
+  return impl_->ConstDevicePointer(device);
+}
+
 template <typename T>
 size_t HostDeviceVector<T>::DeviceStart(int device) { return impl_->DeviceStart(device); }
 
@@ -374,6 +508,19 @@ void HostDeviceVector<T>::Copy(std::initializer_list<T> other) {
 template <typename T>
 std::vector<T>& HostDeviceVector<T>::HostVector() { return impl_->HostVector(); }
 
+template <typename T>
+const std::vector<T>& HostDeviceVector<T>::ConstHostVector() {
+  return impl_->ConstHostVector();
+}
+
+template <typename T>
+T* HostDeviceVector<T>::HostRange(size_t begin, size_t end) {
+  return impl_->HostRange(begin, end);
+}
+
+template <typename T>
+void HostDeviceVector<T>::PrefetchDevices() { impl_->PrefetchDevices(); }
+
 template <typename T>
 void HostDeviceVector<T>::Reshard(GPUSet new_devices) {
   impl_->Reshard(new_devices);
@@ -87,6 +87,16 @@ class GPUSet {
  * DevicePointer and data on GPU  --> no problems, the device ptr 
  *                        will be returned immediately.
  *
+ * Read-only access and partial writes:<br/>
+ * 'ConstHostVector' and 'ConstDevicePointer' bring their copy up to date but
+ * keep the other one valid, so a buffer read on the host and on the devices in
+ * turn, e.g. the gradients computed by a CPU objective for a GPU updater, is
+ * not copied again each round. 'HostRange' hands out a range of the host copy
+ * for writing: only that range is copied to the host, and back to the devices
+ * at their next access, instead of the whole buffer. The ranges written on the
+ * host since the last device access are tracked as one interval per device,
+ * the elements between two ranges are copied as well.
+ *
  * What if xgboost is compiled without CUDA?<br/>
  * In that case, there's a special implementation which always falls-back to
  * working with std::vector. This logic can be found in host_device_vector.cc
@@ -97,7 +107,8 @@ class GPUSet {
  * 'HostDeviceVector' with a special-case implementation in host_device_vector.cc
  *
  * @note: Size and Devices methods are thread-safe.
- * DevicePointer, DeviceStart, DeviceSize, tbegin and tend methods are thread-safe 
+ * DevicePointer, ConstDevicePointer, DeviceStart, DeviceSize, tbegin and tend methods
+ * are thread-safe
  * if different threads call these methods with different values of the device argument.
  * All other methods are not thread safe. 
  */
@@ -117,6 +128,8 @@ class HostDeviceVector {
   size_t Size() const;
   GPUSet Devices() const;
   T* DevicePointer(int device);
+  /*! \brief the device copy for reading, the host copy stays valid */
+  const T* ConstDevicePointer(int device);
 
   T* HostPointer() { return HostVector().data(); }
   size_t DeviceStart(int device);
@@ -137,6 +150,18 @@ class HostDeviceVector {
   void Copy(std::initializer_list<T> other);
 
   std::vector<T>& HostVector();
+  /*! \brief the host copy for reading, the device copies stay valid */
+  const std::vector<T>& ConstHostVector();
+  /*!
+   * \brief the host copy of the elements [begin, end) for writing; the device
+   *  copies keep the other elements, the pointer is valid until the next call
+   */
+  T* HostRange(size_t begin, size_t end);
+  /*!
+   * \brief bring the copies on all the devices up to date, in parallel, ahead
+   *  of their access; the host copy stays valid
+   */
+  void PrefetchDevices();
   void Reshard(GPUSet devices);
   void Resize(size_t new_size, T v = T());
 
@@ -0,0 +1,73 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file memory_tracker.cc
+ * \brief the tracker of the process and the resident set size.
+ */
+#include <cstdio>
+#include <sstream>
+#include "./memory_tracker.h"
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace xgboost {
+namespace common {
+
+MemoryTracker* MemoryTracker::Get() {
+  // never destroyed, owners with static storage may outlive any static tracker
+  static MemoryTracker* inst = new MemoryTracker();
+  return inst;
+}
+
+const char* MemoryTracker::Name(int kind) {
+  static const char* names[kNumMemKind] = {
+    "sparse_page", "gradient_index", "histogram", "host_device_vector", "workspace"};
+  return names[kind];
+}
+
+void MemoryTracker::ReadRSS(uint64_t* current, uint64_t* peak) {
+  *current = 0;
+  *peak = 0;
+#if defined(__linux__)
+  // pages of the resident set are the second field of statm
+  std::FILE* fp = std::fopen("/proc/self/statm", "r");
+  if (fp != nullptr) {
+    unsigned long size, resident;  // NOLINT(*)
+    if (std::fscanf(fp, "%lu %lu", &size, &resident) == 2) {
+      *current = static_cast<uint64_t>(resident) * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+    std::fclose(fp);
+  }
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    // in kilobytes on linux
+    *peak = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+  }
+#endif
+}
+
+void MemoryTracker::ResetPeak() {
+  for (int k = 0; k < kNumMemKind; ++k) {
+    peak_[k].store(current_[k].load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+  total_peak_.store(total_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+std::string MemoryTracker::Json() const {
+  std::ostringstream os;
+  os << '{';
+  for (int k = 0; k < kNumMemKind; ++k) {
+    const auto kind = static_cast<MemoryKind>(k);
+    os << '"' << Name(k) << "\":{\"current\":" << this->Current(kind)
+       << ",\"peak\":" << this->Peak(kind) << "},";
+  }
+  os << "\"total\":{\"current\":" << this->Total() << ",\"peak\":" << this->TotalPeak() << '}';
+  uint64_t rss, peak_rss;
+  ReadRSS(&rss, &peak_rss);
+  os << ",\"rss\":{\"current\":" << rss << ",\"peak\":" << peak_rss << "}}";
+  return os.str();
+}
+
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,137 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file memory_tracker.h
+ * \brief accounting of the bytes held by the major containers of training.
+ *
+ *  The containers keep their allocators: each owner holds a TrackedBytes of
+ *  its subsystem and sets it to the bytes of its buffers when it builds,
+ *  grows or frees them. MemoryTracker sums the current and the peak bytes of
+ *  each subsystem over all the owners alive, and reads the resident set size
+ *  of the process beside them, so that growing memory can be attributed.
+ *  The bytes are those of the buffers, not of the heap blocks holding them.
+ */
+#ifndef XGBOOST_COMMON_MEMORY_TRACKER_H_
+#define XGBOOST_COMMON_MEMORY_TRACKER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace xgboost {
+namespace common {
+
+/*! \brief the subsystems whose bytes are tracked */
+enum MemoryKind {
+  /*! \brief row and column pages of the in-memory DMatrix */
+  kMemSparsePage = 0,
+  /*! \brief quantized matrices of hist: GHistIndexMatrix and ColumnMatrix */
+  kMemGradientIndex,
+  /*! \brief node histograms of hist */
+  kMemHistogram,
+  /*! \brief host side of HostDeviceVector: predictions, caches and gradients */
+  kMemHostDeviceVector,
+  /*! \brief per node and per thread records of the tree builders */
+  kMemWorkspace,
+  kNumMemKind
+};
+
+class MemoryTracker {
+ public:
+  /*! \brief the tracker of the process */
+  static MemoryTracker* Get();
+  /*! \brief name of a subsystem in the report */
+  static const char* Name(int kind);
+  /*!
+   * \brief current and peak resident set size of the process in bytes,
+   *  0 where the system does not tell
+   */
+  static void ReadRSS(uint64_t* current, uint64_t* peak);
+
+  inline void Change(MemoryKind kind, int64_t delta) {
+    Add(&current_[kind], &peak_[kind], delta);
+    Add(&total_, &total_peak_, delta);
+  }
+  inline int64_t Current(MemoryKind kind) const {
+    return current_[kind].load(std::memory_order_relaxed);
+  }
+  inline int64_t Peak(MemoryKind kind) const {
+    return peak_[kind].load(std::memory_order_relaxed);
+  }
+  inline int64_t Total() const {
+    return total_.load(std::memory_order_relaxed);
+  }
+  inline int64_t TotalPeak() const {
+    return total_peak_.load(std::memory_order_relaxed);
+  }
+  /*! \brief start the peaks over from the current bytes */
+  void ResetPeak();
+  /*!
+   * \brief the bytes as one line of JSON: current and peak of each subsystem
+   *  and of their total, and the resident set size of the process
+   */
+  std::string Json() const;
+
+ private:
+  static inline void Add(std::atomic<int64_t>* current, std::atomic<int64_t>* peak,
+                         int64_t delta) {
+    const int64_t now = current->fetch_add(delta, std::memory_order_relaxed) + delta;
+    int64_t seen = peak->load(std::memory_order_relaxed);
+    while (now > seen && !peak->compare_exchange_weak(seen, now, std::memory_order_relaxed)) {}
+  }
+
+  std::atomic<int64_t> current_[kNumMemKind] = {};
+  std::atomic<int64_t> peak_[kNumMemKind] = {};
+  std::atomic<int64_t> total_{0};
+  std::atomic<int64_t> total_peak_{0};
+};
+
+/*!
+ * \brief the bytes an owner holds in a subsystem, counted in MemoryTracker
+ *  until it is destroyed. A copy holds as many bytes as the original, a
+ *  moved from one none.
+ */
+class TrackedBytes {
+ public:
+  explicit TrackedBytes(MemoryKind kind) : kind_(kind) {}
+  TrackedBytes(const TrackedBytes& other) : kind_(other.kind_) {
+    this->Set(other.bytes_);
+  }
+  TrackedBytes(TrackedBytes&& other) noexcept : kind_(other.kind_), bytes_(other.bytes_) {
+    other.bytes_ = 0;
+  }
+  TrackedBytes& operator=(const TrackedBytes& other) {
+    this->Set(other.bytes_);
+    return *this;
+  }
+  TrackedBytes& operator=(TrackedBytes&& other) noexcept {
+    if (this != &other) {
+      this->Set(0);
+      // other was counted in its own subsystem
+      kind_ = other.kind_;
+      bytes_ = other.bytes_;
+      other.bytes_ = 0;
+    }
+    return *this;
+  }
+  ~TrackedBytes() {
+    this->Set(0);
+  }
+  /*! \brief the owner now holds bytes */
+  inline void Set(size_t bytes) {
+    if (bytes == bytes_) return;
+    MemoryTracker::Get()->Change(kind_, static_cast<int64_t>(bytes) -
+                                 static_cast<int64_t>(bytes_));
+    bytes_ = bytes;
+  }
+  inline size_t Bytes() const {
+    return bytes_;
+  }
+
+ private:
+  MemoryKind kind_;
+  size_t bytes_{0};
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_MEMORY_TRACKER_H_
@@ -0,0 +1,74 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file mpsc_queue.h
+ * \brief lock free intrusive queue of many producers and one consumer.
+ *
+ *  The queue of Vyukov: Push is one atomic exchange of the head and never
+ *  waits, Pop is only called by the consumer. The nodes are owned by the
+ *  caller, a node is pushed once and belongs to the consumer once popped.
+ *  The links are sequentially consistent, so a consumer that marks itself
+ *  asleep before a failed Pop and a producer that checks for a sleeping
+ *  consumer after its Push can not miss each other.
+ */
+#ifndef XGBOOST_COMMON_MPSC_QUEUE_H_
+#define XGBOOST_COMMON_MPSC_QUEUE_H_
+
+#include <atomic>
+
+namespace xgboost {
+namespace common {
+
+class MPSCQueue {
+ public:
+  /*! \brief the link of an element, the elements derive from it */
+  struct Node {
+    std::atomic<Node*> next{nullptr};
+  };
+  MPSCQueue() : head_(&stub_), tail_(&stub_) {}
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+  /*! \brief append node, from any thread */
+  inline void Push(Node* node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node* prev = head_.exchange(node);
+    prev->next.store(node);
+  }
+  /*!
+   * \brief take the oldest node, from the consumer only
+   * \return nullptr when the queue is empty, or while the push of the next
+   *  node is not complete yet
+   */
+  inline Node* Pop() {
+    Node* tail = tail_;
+    Node* next = tail->next.load();
+    if (tail == &stub_) {
+      if (next == nullptr) return nullptr;
+      tail_ = next;
+      tail = next;
+      next = next->next.load();
+    }
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load()) return nullptr;
+    // tail is the last node, put the stub behind it to take it out
+    this->Push(&stub_);
+    next = tail->next.load();
+    if (next != nullptr) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+ private:
+  Node stub_;
+  std::atomic<Node*> head_;
+  // only touched by the consumer
+  Node* tail_;
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_MPSC_QUEUE_H_
@@ -0,0 +1,69 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file node_arena.h
+ * \brief storage of the per node records of the tree builders, kept across trees.
+ *
+ *  The records of a tree are grown level by level as the nodes are added.
+ *  The arena keeps the records of the previous trees constructed: Clear only
+ *  rewinds its size, and growing over the slots used before assigns the
+ *  prototype record to them, so neither the records nor the buffers they own
+ *  are destroyed and allocated again. Slots are only constructed when a tree
+ *  has more nodes than all trees before. The bytes of the records are
+ *  counted as workspace by the memory tracker, not those of their buffers.
+ */
+#ifndef XGBOOST_COMMON_NODE_ARENA_H_
+#define XGBOOST_COMMON_NODE_ARENA_H_
+
+#include <algorithm>
+#include <vector>
+#include "./memory_tracker.h"
+
+namespace xgboost {
+namespace common {
+
+template <typename T>
+class NodeArena {
+ public:
+  /*! \brief start a new tree, the records are kept for reuse */
+  inline void Clear() {
+    size_ = 0;
+  }
+  /*!
+   * \brief grow to n records, the new ones equal to proto. A reused record is
+   *  reset by copy assignment, which keeps the capacity of the vectors it owns.
+   */
+  inline void Resize(size_t n, const T& proto) {
+    const size_t nbuilt = std::min(n, data_.size());
+    for (size_t i = size_; i < nbuilt; ++i) {
+      data_[i] = proto;
+    }
+    if (n > data_.size()) {
+      data_.resize(n, proto);
+      bytes_.Set(data_.capacity() * sizeof(T));
+    }
+    size_ = n;
+  }
+  inline void Reserve(size_t n) {
+    data_.reserve(n);
+    bytes_.Set(data_.capacity() * sizeof(T));
+  }
+  inline size_t Size() const {
+    return size_;
+  }
+  inline T& operator[](size_t i) {
+    return data_[i];
+  }
+  inline const T& operator[](size_t i) const {
+    return data_[i];
+  }
+
+ private:
+  // records constructed so far, the first size_ belong to the current tree
+  std::vector<T> data_;
+  size_t size_{0};
+  TrackedBytes bytes_{kMemWorkspace};
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_NODE_ARENA_H_
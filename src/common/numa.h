@@ -0,0 +1,142 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file numa.h
+ * \brief placement of the OpenMP threads and of their buffers by NUMA node.
+ *
+ *  Linux places a page on the node of the thread that first writes it. The
+ *  threads are pinned to the cpus node by node, and the buffers they scan in a
+ *  static schedule are first written in parallel with the same schedule, so
+ *  that each thread reads its share from local memory.
+ */
+#ifndef XGBOOST_COMMON_NUMA_H_
+#define XGBOOST_COMMON_NUMA_H_
+
+#include <dmlc/logging.h>
+#include <dmlc/omp.h>
+#include <xgboost/base.h>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace xgboost {
+namespace common {
+
+/*!
+ * \brief allocator that leaves the new elements of a resize default
+ *  initialized, i.e. unwritten for trivial types, so that ParallelFill
+ *  is their first touch.
+ */
+template <typename T>
+struct FirstTouchAllocator : public std::allocator<T> {
+  template <typename U>
+  struct rebind {
+    using other = FirstTouchAllocator<U>;
+  };
+  FirstTouchAllocator() = default;
+  template <typename U>
+  FirstTouchAllocator(const FirstTouchAllocator<U>&) {}  // NOLINT(*)
+  template <typename U>
+  void construct(U* p) {
+    ::new (static_cast<void*>(p)) U;
+  }
+  template <typename U, typename... Args>
+  void construct(U* p, Args&&... args) {
+    ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+};
+
+/*!
+ * \brief write value to all elements in the static schedule of nthread
+ *  threads, the schedule of the loops that consume them.
+ */
+template <typename T, typename Alloc>
+inline void ParallelFill(std::vector<T, Alloc>* data, T value, int nthread) {
+  const auto ndata = static_cast<bst_omp_uint>(data->size());
+  T* ptr = data->data();
+  #pragma omp parallel for schedule(static) num_threads(nthread)
+  for (bst_omp_uint i = 0; i < ndata; ++i) {
+    ptr[i] = value;
+  }
+}
+
+/*! \brief the cpus of each NUMA node, one node of all cpus when unknown */
+inline std::vector<std::vector<int> > NumaNodeCpus() {
+  std::vector<std::vector<int> > nodes;
+#if defined(__linux__)
+  // node ids may have gaps, e.g. with offline nodes
+  constexpr int kMaxNode = 64;
+  for (int node = 0; node < kMaxNode; ++node) {
+    std::ifstream fi("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    if (!fi) continue;
+    // a list of ranges, e.g. 0-15,32-47
+    std::vector<int> cpus;
+    std::string range;
+    while (std::getline(fi, range, ',')) {
+      std::istringstream is(range);
+      int first, last;
+      if (!(is >> first)) continue;
+      last = first;
+      if (is.peek() == '-') {
+        is.get();
+        is >> last;
+      }
+      for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    if (!cpus.empty()) nodes.push_back(cpus);
+  }
+#endif
+  if (nodes.empty()) {
+    nodes.emplace_back();
+    for (int cpu = 0; cpu < omp_get_num_procs(); ++cpu) nodes.back().push_back(cpu);
+  }
+  return nodes;
+}
+
+/*!
+ * \brief pin the threads of the parallel regions of nthread threads to the
+ *  cpus, spread evenly over the cpus listed node by node, so each node gets
+ *  a contiguous share of the threads in proportion to its cpus.
+ * \return the node of each thread, indexed into NumaNodeCpus()
+ */
+inline std::vector<int> PinThreadsByNode(int nthread) {
+  const std::vector<std::vector<int> > nodes = NumaNodeCpus();
+  std::vector<std::pair<int, int> > cpus;  // (node, cpu)
+  for (size_t node = 0; node < nodes.size(); ++node) {
+    for (int cpu : nodes[node]) cpus.emplace_back(static_cast<int>(node), cpu);
+  }
+  const size_t ncpu = cpus.size();
+  std::vector<int> thread_node(nthread), thread_cpu(nthread);
+  for (int tid = 0; tid < nthread; ++tid) {
+    const size_t i = static_cast<size_t>(nthread) <= ncpu ?
+        static_cast<size_t>(tid) * ncpu / nthread : tid % ncpu;
+    thread_node[tid] = cpus[i].first;
+    thread_cpu[tid] = cpus[i].second;
+  }
+#if defined(__linux__)
+  int nfail = 0;
+  #pragma omp parallel num_threads(nthread) reduction(+:nfail)
+  {
+    const int tid = omp_get_thread_num();
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(thread_cpu[tid], &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) ++nfail;
+  }
+  if (nfail != 0) {
+    LOG(WARNING) << nfail << " of " << nthread << " threads could not be pinned";
+  }
+#endif
+  return thread_node;
+}
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_NUMA_H_
@@ -0,0 +1,142 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file perf_counters.h
+ * \brief hardware event counters of the OpenMP threads, for common::Monitor.
+ *
+ *  On Linux the counters are perf events opened by each thread of the OpenMP
+ *  pool for itself, user space only, so perf_event_paranoid up to 2 allows
+ *  them. A counter can be read from any thread, so the thread that starts and
+ *  stops a phase reads the counts of all the threads without waking them. The
+ *  pool is that of the first Open, threads started later are not counted.
+ *  Counters the kernel multiplexes are scaled by their running time. Other
+ *  systems, or a kernel that refuses the events, have no counters.
+ */
+#ifndef XGBOOST_COMMON_PERF_COUNTERS_H_
+#define XGBOOST_COMMON_PERF_COUNTERS_H_
+
+#include <dmlc/base.h>
+#include <dmlc/omp.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define XGBOOST_PERF_EVENTS 1
+#endif
+
+namespace xgboost {
+namespace common {
+
+/*! \brief counts of the hardware events of a thread */
+struct PerfCounts {
+  enum Event { kCycles = 0, kInstructions, kLLCMisses, kBranchMisses, kNumEvents };
+  uint64_t value[kNumEvents] = {0, 0, 0, 0};
+  /*! \brief name of an event in the JSON of Monitor */
+  static const char* Name(int event) {
+    static const char* names[kNumEvents] = {
+      "cycles", "instructions", "llc_misses", "branch_misses"};
+    return names[event];
+  }
+  inline void Add(const PerfCounts& other) {
+    for (int e = 0; e < kNumEvents; ++e) value[e] += other.value[e];
+  }
+  /*! \brief the counts from begin to this, 0 for counters that went back */
+  inline PerfCounts Since(const PerfCounts& begin) const {
+    PerfCounts out;
+    for (int e = 0; e < kNumEvents; ++e) {
+      out.value[e] = value[e] >= begin.value[e] ? value[e] - begin.value[e] : 0;
+    }
+    return out;
+  }
+};
+
+class PerfCounters {
+ public:
+  PerfCounters() = default;
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+  ~PerfCounters() {
+    this->Close();
+  }
+  /*!
+   * \brief open the counters of each thread of the OpenMP pool
+   * \return false when no counter could be opened
+   */
+  inline bool Open() {
+    this->Close();
+#if XGBOOST_PERF_EVENTS
+    const int nthread = omp_get_max_threads();
+    fds_.assign(static_cast<size_t>(nthread) * PerfCounts::kNumEvents, -1);
+    #pragma omp parallel num_threads(nthread)
+    {
+      int* fds = dmlc::BeginPtr(fds_) + omp_get_thread_num() * PerfCounts::kNumEvents;
+      for (int e = 0; e < PerfCounts::kNumEvents; ++e) fds[e] = OpenEvent(e);
+    }
+    for (int fd : fds_) {
+      if (fd >= 0) return true;
+    }
+    fds_.clear();
+#endif
+    return false;
+  }
+  /*! \return number of threads counted */
+  inline size_t NumThread() const {
+    return fds_.size() / PerfCounts::kNumEvents;
+  }
+  /*! \brief read the current counts of each thread, 0 for the counters not opened */
+  inline void Read(std::vector<PerfCounts>* out) const {
+    out->assign(this->NumThread(), PerfCounts());
+#if XGBOOST_PERF_EVENTS
+    for (size_t tid = 0; tid < out->size(); ++tid) {
+      for (int e = 0; e < PerfCounts::kNumEvents; ++e) {
+        const int fd = fds_[tid * PerfCounts::kNumEvents + e];
+        // value, time enabled, time running
+        uint64_t buf[3];
+        if (fd < 0 || read(fd, buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf))) {
+          continue;
+        }
+        double value = static_cast<double>(buf[0]);
+        if (buf[2] != 0 && buf[2] < buf[1]) {
+          value *= static_cast<double>(buf[1]) / static_cast<double>(buf[2]);
+        }
+        (*out)[tid].value[e] = static_cast<uint64_t>(value);
+      }
+    }
+#endif
+  }
+
+ private:
+  inline void Close() {
+#if XGBOOST_PERF_EVENTS
+    for (int fd : fds_) {
+      if (fd >= 0) close(fd);
+    }
+#endif
+    fds_.clear();
+  }
+#if XGBOOST_PERF_EVENTS
+  // open an event of the calling thread, -1 if the kernel refuses it
+  static int OpenEvent(int event) {
+    static const uint64_t configs[PerfCounts::kNumEvents] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[event];
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+#endif
+  // counter of event e of thread tid at tid * kNumEvents + e, -1 if not opened
+  std::vector<int> fds_;
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_PERF_COUNTERS_H_
@@ -0,0 +1,138 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file radix_sort.h
+ * \brief radix sorts by float keys: a parallel sort of (prediction, index)
+ *  pairs and a sort of the entries of a column by value.
+ *
+ *  The float keys are mapped to unsigned integers of the same order and
+ *  sorted with an LSD radix sort of 11 bit digits. Each pass counts the digits
+ *  of a static chunk of the pairs per thread and scatters them stably, so the
+ *  cost is linear in the number of pairs and all passes run in parallel. A
+ *  pass is skipped when all keys share its digit, e.g. the exponent bits of
+ *  probabilities. A column is sorted in the calling thread with 8 bit digits,
+ *  the digits of all passes are counted in one read of the column.
+ */
+#ifndef XGBOOST_COMMON_RADIX_SORT_H_
+#define XGBOOST_COMMON_RADIX_SORT_H_
+
+#include <dmlc/base.h>
+#include <dmlc/omp.h>
+#include <xgboost/data.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+
+/*! \return an unsigned key whose ascending order is the ascending order of f */
+inline uint32_t AscendingRadixKey(float f) {
+  uint32_t u;
+  std::memcpy(&u, &f, sizeof(u));
+  return (u & 0x80000000U) ? ~u : (u | 0x80000000U);
+}
+
+/*! \return an unsigned key whose ascending order is the descending order of f */
+inline uint32_t DescendingRadixKey(float f) {
+  return ~AscendingRadixKey(f);
+}
+
+/*!
+ * \brief sort the entries in [begin, end) by fvalue, the order of
+ *  Entry::CmpValue, in the calling thread. Entries of equal values keep their
+ *  order, but for short ranges, which std::sort sorts.
+ * \param scratch buffer of at least end - begin entries
+ */
+template <typename EntryT>
+inline void SortEntriesByValue(EntryT* begin, EntryT* end, EntryT* scratch) {
+  constexpr size_t kMinRadix = 512;
+  constexpr int kPasses = 4;
+  constexpr uint32_t kBins = 256;
+  const auto n = static_cast<size_t>(end - begin);
+  if (n < kMinRadix) {
+    std::sort(begin, end, EntryT::CmpValue);
+    return;
+  }
+  size_t count[kPasses][kBins] = {};
+  for (const EntryT* e = begin; e != end; ++e) {
+    const uint32_t key = AscendingRadixKey(e->fvalue);
+    for (int p = 0; p < kPasses; ++p) ++count[p][(key >> (8 * p)) & (kBins - 1)];
+  }
+  EntryT* src = begin;
+  EntryT* dst = scratch;
+  for (int p = 0; p < kPasses; ++p) {
+    const int shift = 8 * p;
+    if (count[p][(AscendingRadixKey(begin->fvalue) >> shift) & (kBins - 1)] == n) continue;
+    size_t sum = 0;
+    for (uint32_t d = 0; d < kBins; ++d) {
+      const size_t c = count[p][d];
+      count[p][d] = sum;
+      sum += c;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      dst[count[p][(AscendingRadixKey(src[i].fvalue) >> shift) & (kBins - 1)]++] = src[i];
+    }
+    std::swap(src, dst);
+  }
+  if (src != begin) std::copy(src, src + n, begin);
+}
+
+/*!
+ * \brief sort the pairs by first in descending order, the order of CmpFirst.
+ *  Pairs of equal keys keep their order.
+ * \param data the pairs to sort
+ * \param scratch buffer swapped with data, kept by the caller across calls
+ */
+inline void RadixSortFirstDescending(std::vector<std::pair<float, unsigned> >* data,
+                                     std::vector<std::pair<float, unsigned> >* scratch) {
+  constexpr int kBits = 11;
+  constexpr uint32_t kBins = 1U << kBits;
+  const size_t n = data->size();
+  scratch->resize(n);
+  std::vector<size_t> count(static_cast<size_t>(omp_get_max_threads()) * kBins);
+  std::pair<float, unsigned>* src = dmlc::BeginPtr(*data);
+  std::pair<float, unsigned>* dst = dmlc::BeginPtr(*scratch);
+  for (int shift = 0; shift < 32; shift += kBits) {
+    bool skip = false;
+    #pragma omp parallel
+    {
+      const auto tid = static_cast<size_t>(omp_get_thread_num());
+      const auto nthread = static_cast<size_t>(omp_get_num_threads());
+      const size_t begin = n * tid / nthread;
+      const size_t end = n * (tid + 1) / nthread;
+      size_t* tcount = dmlc::BeginPtr(count) + tid * kBins;
+      std::fill(tcount, tcount + kBins, 0);
+      for (size_t i = begin; i < end; ++i) {
+        ++tcount[(DescendingRadixKey(src[i].first) >> shift) & (kBins - 1)];
+      }
+      #pragma omp barrier
+      #pragma omp single
+      {
+        // exclusive scan in (digit, thread) order, keeps the sort stable
+        size_t sum = 0;
+        for (uint32_t d = 0; d < kBins; ++d) {
+          const size_t digit_begin = sum;
+          for (size_t t = 0; t < nthread; ++t) {
+            const size_t c = count[t * kBins + d];
+            count[t * kBins + d] = sum;
+            sum += c;
+          }
+          if (sum - digit_begin == n) skip = true;
+        }
+      }
+      if (!skip) {
+        for (size_t i = begin; i < end; ++i) {
+          dst[tcount[(DescendingRadixKey(src[i].first) >> shift) & (kBins - 1)]++] = src[i];
+        }
+      }
+    }
+    if (!skip) std::swap(src, dst);
+  }
+  if (src != dmlc::BeginPtr(*data)) data->swap(*scratch);
+}
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_RADIX_SORT_H_
@@ -0,0 +1,121 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file run_column.h
+ * \brief compact column storage of features with few distinct values.
+ *
+ *  A sorted column of a feature with at most kMaxRuns distinct values, such
+ *  as the pixel intensities of image data, is stored as its row indices and
+ *  the boundaries of the runs of equal values. The value of an entry is then
+ *  implicit in its run, so an entry takes 4 bytes instead of the 8 bytes of
+ *  an Entry and a scan can handle all the rows of a value at once.
+ */
+#ifndef XGBOOST_COMMON_RUN_COLUMN_H_
+#define XGBOOST_COMMON_RUN_COLUMN_H_
+
+#include <dmlc/omp.h>
+#include <xgboost/data.h>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+
+/*! \brief a column as runs of equal values in ascending order */
+struct RunColumn {
+  /*! \brief row indices of the column, grouped by value */
+  const bst_uint* index;
+  /*! \brief rows of run i are index[run_ptr[i]:run_ptr[i + 1]] */
+  const uint32_t* run_ptr;
+  /*! \brief value of each run, ascending */
+  const bst_float* value;
+  /*! \brief number of runs */
+  uint32_t num_run;
+};
+
+/*! \brief run storage of the columns of a sorted column page */
+class RunColumnMatrix {
+ public:
+  /*! \brief maximum number of distinct values of a stored column */
+  static const uint32_t kMaxRuns = 256;
+  /*!
+   * \brief build from a sorted column page, columns with more than kMaxRuns
+   *  distinct values are not stored.
+   */
+  inline void Init(const SparsePage& page) {
+    const auto ncol = static_cast<bst_omp_uint>(page.Size());
+    num_run_.assign(ncol, 0);
+    // count the runs of each column, 0 marks a column that is not stored
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (bst_omp_uint fid = 0; fid < ncol; ++fid) {
+      SparsePage::Inst col = page[fid];
+      uint32_t nrun = 0;
+      for (bst_uint i = 0; i < col.length && nrun <= kMaxRuns; ++i) {
+        if (i == 0 || col[i].fvalue != col[i - 1].fvalue) ++nrun;
+      }
+      num_run_[fid] = nrun <= kMaxRuns ? nrun : 0;
+    }
+    index_ptr_.assign(ncol + 1, 0);
+    run_begin_.assign(ncol + 1, 0);
+    for (bst_omp_uint fid = 0; fid < ncol; ++fid) {
+      index_ptr_[fid + 1] = index_ptr_[fid] + (num_run_[fid] != 0 ? page[fid].length : 0);
+      run_begin_[fid + 1] = run_begin_[fid] + (num_run_[fid] != 0 ? num_run_[fid] + 1 : 0);
+    }
+    index_.resize(index_ptr_.back());
+    run_ptr_.resize(run_begin_.back());
+    value_.resize(run_begin_.back());
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (bst_omp_uint fid = 0; fid < ncol; ++fid) {
+      if (num_run_[fid] == 0) continue;
+      SparsePage::Inst col = page[fid];
+      bst_uint* index = dmlc::BeginPtr(index_) + index_ptr_[fid];
+      uint32_t* run_ptr = dmlc::BeginPtr(run_ptr_) + run_begin_[fid];
+      bst_float* value = dmlc::BeginPtr(value_) + run_begin_[fid];
+      uint32_t r = 0;
+      for (bst_uint i = 0; i < col.length; ++i) {
+        if (i == 0 || col[i].fvalue != col[i - 1].fvalue) {
+          run_ptr[r] = i;
+          value[r] = col[i].fvalue;
+          ++r;
+        }
+        index[i] = col[i].index;
+      }
+      run_ptr[r] = col.length;
+    }
+  }
+  /*! \brief remove all columns */
+  inline void Clear() {
+    num_run_.clear();
+    index_ptr_.clear();
+    run_begin_.clear();
+    index_.clear();
+    run_ptr_.clear();
+    value_.clear();
+  }
+  /*! \return whether column fid is stored */
+  inline bool HasColumn(bst_uint fid) const {
+    return fid < num_run_.size() && num_run_[fid] != 0;
+  }
+  /*! \brief get a stored column */
+  inline RunColumn GetColumn(bst_uint fid) const {
+    RunColumn col;
+    col.index = dmlc::BeginPtr(index_) + index_ptr_[fid];
+    col.run_ptr = dmlc::BeginPtr(run_ptr_) + run_begin_[fid];
+    col.value = dmlc::BeginPtr(value_) + run_begin_[fid];
+    col.num_run = num_run_[fid];
+    return col;
+  }
+
+ private:
+  /*! \brief number of runs of each column, 0 if not stored */
+  std::vector<uint32_t> num_run_;
+  /*! \brief start of each column in index_ */
+  std::vector<size_t> index_ptr_;
+  /*! \brief start of each column in run_ptr_ and value_ */
+  std::vector<size_t> run_begin_;
+  std::vector<bst_uint> index_;
+  std::vector<uint32_t> run_ptr_;
+  std::vector<bst_float> value_;
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_RUN_COLUMN_H_
@@ -0,0 +1,111 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file strategy_tuner.h
+ * \brief online choice of the fastest of a few strategies of a recurring task.
+ *
+ *  The calls of a task are grouped into buckets of similar workloads, e.g.
+ *  the levels of the trees. The first calls of a bucket try each strategy in
+ *  turn and time it per unit of work, then the bucket keeps the fastest for
+ *  all its later calls.
+ */
+#ifndef XGBOOST_COMMON_STRATEGY_TUNER_H_
+#define XGBOOST_COMMON_STRATEGY_TUNER_H_
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+
+class StrategyTuner {
+ public:
+  /*!
+   * \param num_strategy number of strategies, numbered from 0
+   * \param num_trial number of timed calls of each strategy in a bucket
+   */
+  explicit StrategyTuner(int num_strategy = 2, int num_trial = 1)
+      : num_strategy_(num_strategy), num_trial_(num_trial) {}
+  /*! \brief the strategy of the next call of bucket */
+  inline int Choose(uint64_t bucket) {
+    const Bucket& b = this->Get(bucket);
+    if (b.chosen >= 0) return b.chosen;
+    // the strategy with the fewest trials, the lowest first
+    int next = 0;
+    for (int s = 1; s < num_strategy_; ++s) {
+      if (b.trials[s] < b.trials[next]) next = s;
+    }
+    return next;
+  }
+  /*!
+   * \brief record a call of bucket
+   * \param units the work of the call, e.g. entries scanned, 0 if unknown
+   * \return whether the call decided the strategy of the bucket
+   */
+  inline bool Record(uint64_t bucket, int strategy, double seconds, double units) {
+    Bucket& b = this->Get(bucket);
+    if (b.chosen >= 0) return false;
+    b.seconds[strategy] += seconds;
+    b.units[strategy] += units;
+    ++b.trials[strategy];
+    for (int s = 0; s < num_strategy_; ++s) {
+      if (b.trials[s] < num_trial_) return false;
+    }
+    b.chosen = 0;
+    for (int s = 1; s < num_strategy_; ++s) {
+      if (b.Cost(s) < b.Cost(b.chosen)) b.chosen = s;
+    }
+    return true;
+  }
+  /*! \return the strategy kept by bucket, -1 while it is tried */
+  inline int Chosen(uint64_t bucket) const {
+    auto it = buckets_.find(bucket);
+    return it == buckets_.end() ? -1 : it->second.chosen;
+  }
+  /*! \return seconds per unit of a strategy in bucket, 0 if not tried */
+  inline double Cost(uint64_t bucket, int strategy) const {
+    auto it = buckets_.find(bucket);
+    return it == buckets_.end() ? 0.0 : it->second.Cost(strategy);
+  }
+  /*! \brief the kept strategy of each bucket decided, in the order of the buckets */
+  inline std::map<uint64_t, int> Decisions() const {
+    std::map<uint64_t, int> out;
+    for (const auto& kv : buckets_) {
+      if (kv.second.chosen >= 0) out[kv.first] = kv.second.chosen;
+    }
+    return out;
+  }
+  /*! \brief forget all the buckets */
+  inline void Clear() {
+    buckets_.clear();
+  }
+
+ private:
+  struct Bucket {
+    std::vector<double> seconds;
+    std::vector<double> units;
+    std::vector<int> trials;
+    int chosen{-1};
+    inline double Cost(int s) const {
+      if (trials[s] == 0) return 0.0;
+      return units[s] > 0.0 ? seconds[s] / units[s] : seconds[s] / trials[s];
+    }
+  };
+  inline Bucket& Get(uint64_t bucket) {
+    Bucket& b = buckets_[bucket];
+    if (b.trials.empty()) {
+      b.seconds.assign(num_strategy_, 0.0);
+      b.units.assign(num_strategy_, 0.0);
+      b.trials.assign(num_strategy_, 0);
+    }
+    return b;
+  }
+
+  int num_strategy_;
+  int num_trial_;
+  std::map<uint64_t, Bucket> buckets_;
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_STRATEGY_TUNER_H_
@@ -0,0 +1,257 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file threading.cc
+ * \brief the pool of the library and the loops of the pool and the executors.
+ */
+#include <dmlc/logging.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "./threading.h"
+
+namespace xgboost {
+namespace common {
+namespace {
+std::atomic<int>& Backend() {
+  static std::atomic<int> backend(static_cast<int>(
+      ParseThreadBackend(dmlc::GetEnv("XGBOOST_THREAD_BACKEND", std::string("omp")))));
+  return backend;
+}
+
+// the executor of the host, read once by each loop
+struct Executor {
+  std::mutex mutex;
+  ExecutorSubmit submit{nullptr};
+  void* ctx{nullptr};
+};
+Executor* GetExecutor() {
+  static Executor* inst = new Executor();
+  return inst;
+}
+
+// persistent threads running the tasks of the loops in the order submitted
+class ThreadPool {
+ public:
+  static ThreadPool* Get() {
+    // never destroyed, its threads may still wait for tasks at exit
+    static ThreadPool* inst = new ThreadPool();
+    return inst;
+  }
+  // queue a task, with at least nworker threads to run the tasks
+  void Submit(std::function<void()> task, int nworker) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (static_cast<int>(workers_.size()) < nworker) {
+      workers_.emplace_back([this]() { this->Work(); });
+      workers_.back().detach();
+    }
+    queue_.push_back(std::move(task));
+    cv_.notify_one();
+  }
+
+ private:
+  void Work() {
+    // the regions not going through ParallelFor stay within the task
+    omp_set_num_threads(1);
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return !queue_.empty(); });
+        task = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()> > queue_;
+  std::vector<std::thread> workers_;
+};
+
+// the iterations [begin, end) not taken yet by the slot owning them
+struct Range {
+  std::mutex mutex;
+  size_t begin{0};
+  size_t end{0};
+};
+
+// a loop run by the slots of its tasks, shared with the tasks that may
+// start after it is done
+struct Job {
+  detail::RangeBody body;
+  void* fn;
+  size_t grain;
+  int nslot;
+  std::unique_ptr<Range[]> ranges;
+  // the next slot taken by a task, the caller is slot 0
+  std::atomic<int> next_slot{1};
+  // iterations not run or skipped yet
+  std::atomic<size_t> remaining{0};
+  std::atomic<bool> failed{false};
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::exception_ptr error;
+
+  // take the next iterations of slot, from the front of its range, else
+  // from the back half of the range of another slot
+  bool Take(int slot, size_t* begin, size_t* end) {
+    Range& own = ranges[slot];
+    {
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (own.begin < own.end) {
+        *begin = own.begin;
+        *end = std::min(own.end, own.begin + grain);
+        own.begin = *end;
+        return true;
+      }
+    }
+    for (int k = 1; k < nslot; ++k) {
+      Range& victim = ranges[(slot + k) % nslot];
+      size_t stolen_begin, stolen_end;
+      {
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.begin >= victim.end) continue;
+        stolen_end = victim.end;
+        stolen_begin = victim.end - std::max<size_t>((victim.end - victim.begin) / 2, 1);
+        victim.end = stolen_begin;
+      }
+      *begin = stolen_begin;
+      *end = std::min(stolen_end, stolen_begin + grain);
+      std::lock_guard<std::mutex> lock(own.mutex);
+      own.begin = *end;
+      own.end = stolen_end;
+      return true;
+    }
+    return false;
+  }
+
+  // run the iterations taken by slot until none is left
+  void Run(int slot) {
+    detail::SlotScope ids(slot);
+    // the regions of an iteration run in its thread, as in a nested region
+    const int nthread = omp_get_max_threads();
+    omp_set_num_threads(1);
+    size_t begin, end;
+    while (this->Take(slot, &begin, &end)) {
+      if (!failed) {
+        try {
+          body(fn, begin, end);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!error) error = std::current_exception();
+          failed = true;
+        }
+      }
+      if (remaining.fetch_sub(end - begin) == end - begin) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cv.notify_all();
+      }
+    }
+    omp_set_num_threads(nthread);
+  }
+};
+
+void RunJobTask(void* arg) {
+  std::unique_ptr<std::shared_ptr<Job> > job(static_cast<std::shared_ptr<Job>*>(arg));
+  const int slot = (*job)->next_slot++;
+  if (slot < (*job)->nslot) (*job)->Run(slot);
+}
+}  // namespace
+
+ThreadBackend GetThreadBackend() {
+  return static_cast<ThreadBackend>(Backend().load(std::memory_order_relaxed));
+}
+
+void SetThreadBackend(ThreadBackend backend) {
+  if (backend == ThreadBackend::kExecutor) {
+    Executor* executor = GetExecutor();
+    std::lock_guard<std::mutex> lock(executor->mutex);
+    CHECK(executor->submit != nullptr) << "no executor to run the loops, see SetExecutor";
+  }
+  Backend() = static_cast<int>(backend);
+}
+
+ThreadBackend ParseThreadBackend(const std::string& name) {
+  if (name == "omp") return ThreadBackend::kOpenMP;
+  if (name == "pool") return ThreadBackend::kPool;
+  if (name == "executor") return ThreadBackend::kExecutor;
+  LOG(FATAL) << "unknown thread backend " << name << ", expected omp, pool or executor";
+  return ThreadBackend::kOpenMP;
+}
+
+void SetExecutor(ExecutorSubmit submit, void* ctx) {
+  Executor* executor = GetExecutor();
+  {
+    std::lock_guard<std::mutex> lock(executor->mutex);
+    executor->submit = submit;
+    executor->ctx = ctx;
+  }
+  Backend() = static_cast<int>(submit != nullptr ? ThreadBackend::kExecutor
+                                                 : ThreadBackend::kOpenMP);
+}
+
+namespace detail {
+void RunTasks(size_t n, Sched sched, int nthread, RangeBody body, void* fn) {
+  nthread = std::max(nthread, 1);
+  // a few parts of the range of each slot, so that the slots can balance
+  size_t grain = sched.chunk;
+  if (grain == 0) {
+    grain = sched.kind == Sched::kDynamic
+        ? 1 : std::max<size_t>(n / (static_cast<size_t>(nthread) * 8), 1);
+  }
+  const auto nslot = static_cast<int>(
+      std::min<size_t>(static_cast<size_t>(nthread), (n + grain - 1) / grain));
+  if (nslot <= 1) {
+    // in the calling thread, the loops of the iterations may still be parallel
+    body(fn, 0, n);
+    return;
+  }
+  ExecutorSubmit submit = nullptr;
+  void* ctx = nullptr;
+  if (GetThreadBackend() == ThreadBackend::kExecutor) {
+    Executor* executor = GetExecutor();
+    std::lock_guard<std::mutex> lock(executor->mutex);
+    submit = executor->submit;
+    ctx = executor->ctx;
+  }
+
+  std::shared_ptr<Job> job = std::make_shared<Job>();
+  job->body = body;
+  job->fn = fn;
+  job->grain = grain;
+  job->nslot = nslot;
+  job->remaining = n;
+  job->ranges.reset(new Range[nslot]);
+  // the slots start with the blocks of a static schedule
+  for (int s = 0; s < nslot; ++s) {
+    job->ranges[s].begin = n * s / nslot;
+    job->ranges[s].end = n * (s + 1) / nslot;
+  }
+  for (int s = 1; s < nslot; ++s) {
+    if (submit != nullptr) {
+      submit(RunJobTask, new std::shared_ptr<Job>(job), ctx);
+    } else {
+      ThreadPool::Get()->Submit([job]() {
+        const int slot = job->next_slot++;
+        if (slot < job->nslot) job->Run(slot);
+      }, nslot - 1);
+    }
+  }
+  // the caller takes part, so the loop is done even if no task starts
+  job->Run(0);
+  {
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->cv.wait(lock, [&job]() { return job->remaining == 0; });
+  }
+  if (job->error) std::rethrow_exception(job->error);
+}
+}  // namespace detail
+}  // namespace common
+}  // namespace xgboost
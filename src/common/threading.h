@@ -0,0 +1,217 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file threading.h
+ * \brief the OpenMP threads of the library inside a host application.
+ *
+ *  The number of threads of an OpenMP region is a setting of the thread that
+ *  starts it. A Booster called from the threads of a service sets its nthread
+ *  on the calling thread for the duration of each call, and every call is
+ *  capped by a process-wide limit, so that the regions started by several
+ *  callers at once share the cores left to the library by the host.
+ *
+ *  The loops of the library go through ParallelFor. By default it is an
+ *  OpenMP region. A host with thread pools of its own can instead run the
+ *  loops on a persistent pool of the library, or submit them as tasks to an
+ *  executor of its own, see ThreadBackend. Either way the range of a loop is
+ *  split between the slots of the threads of the call, and a slot out of work
+ *  steals the back half of the range of another, so a loop completes even if
+ *  only the calling thread ever takes part in it.
+ */
+#ifndef XGBOOST_COMMON_THREADING_H_
+#define XGBOOST_COMMON_THREADING_H_
+
+#include <dmlc/omp.h>
+#include <dmlc/parameter.h>
+#include <xgboost/base.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace xgboost {
+namespace common {
+/*!
+ * \brief the most threads a region of a call may use, 0 for no limit,
+ *  initially the environment variable XGBOOST_MAX_THREADS
+ */
+inline std::atomic<int>& ThreadLimit() {
+  static std::atomic<int> limit(std::max(dmlc::GetEnv("XGBOOST_MAX_THREADS", 0), 0));
+  return limit;
+}
+
+/*!
+ * \brief set the threads of the regions started by the calling thread, and
+ *  restore them when the scope ends
+ */
+class OmpThreadScope {
+ public:
+  /*! \param nthread threads of the regions, 0 to keep those of the thread */
+  explicit OmpThreadScope(int nthread) : saved_(omp_get_max_threads()) {
+    int n = nthread > 0 ? nthread : saved_;
+    const int limit = ThreadLimit();
+    if (limit > 0) n = std::min(n, limit);
+    if (n != saved_) omp_set_num_threads(n);
+  }
+  ~OmpThreadScope() {
+    if (omp_get_max_threads() != saved_) omp_set_num_threads(saved_);
+  }
+
+ private:
+  int saved_;
+};
+
+/*! \brief where the loops of ParallelFor run */
+enum class ThreadBackend : int {
+  /*! \brief an OpenMP region started by the calling thread */
+  kOpenMP = 0,
+  /*! \brief the persistent pool of the library */
+  kPool = 1,
+  /*! \brief tasks submitted to the executor of the host, see SetExecutor */
+  kExecutor = 2
+};
+
+/*! \brief runs task(arg) once on a thread of the host, now or later */
+using ExecutorSubmit = void (*)(void (*task)(void*), void* arg, void* ctx);
+
+/*!
+ * \return the backend of the loops, initially the environment variable
+ *  XGBOOST_THREAD_BACKEND, see ParseThreadBackend
+ */
+ThreadBackend GetThreadBackend();
+/*! \brief set the backend of the loops, kExecutor needs an executor */
+void SetThreadBackend(ThreadBackend backend);
+/*! \return the backend of name: "omp", "pool" or "executor" */
+ThreadBackend ParseThreadBackend(const std::string& name);
+/*!
+ * \brief run the loops as tasks of the host, submit is passed ctx as its last
+ *  argument. Sets the backend to kExecutor, or back to kOpenMP if submit is
+ *  nullptr. The tasks of a loop may start after it is done, they return at
+ *  once then.
+ */
+void SetExecutor(ExecutorSubmit submit, void* ctx);
+
+/*! \brief the schedule of the iterations of a ParallelFor */
+struct Sched {
+  enum Kind { kStatic, kDynamic, kGuided };
+  Kind kind;
+  /*! \brief iterations taken at once, 0 for the default of the kind */
+  size_t chunk;
+  static Sched Static(size_t chunk = 0) {
+    return Sched{kStatic, chunk};
+  }
+  static Sched Dyn(size_t chunk = 0) {
+    return Sched{kDynamic, chunk};
+  }
+  static Sched Guided() {
+    return Sched{kGuided, 0};
+  }
+};
+
+namespace detail {
+// the slot of the calling thread in the loop of a pool or an executor it
+// takes part in, -1 outside of those
+inline int& PoolSlot() {
+  static thread_local int slot = -1;
+  return slot;
+}
+// set the slot of the calling thread, and restore it when the scope ends
+class SlotScope {
+ public:
+  explicit SlotScope(int slot) : saved_(PoolSlot()) {
+    PoolSlot() = slot;
+  }
+  ~SlotScope() {
+    PoolSlot() = saved_;
+  }
+
+ private:
+  int saved_;
+};
+// runs the iterations [begin, end) of the loop fn
+using RangeBody = void (*)(void* fn, size_t begin, size_t end);
+// runs the n iterations of fn in the slots of nthread threads of the backend
+void RunTasks(size_t n, Sched sched, int nthread, RangeBody body, void* fn);
+}  // namespace detail
+
+/*!
+ * \brief the id of the calling thread in the loop it runs, below the threads
+ *  of the loop, as omp_get_thread_num() in an OpenMP region
+ */
+inline int ThreadId() {
+  const int slot = detail::PoolSlot();
+  return slot >= 0 ? slot : omp_get_thread_num();
+}
+
+/*!
+ * \brief run fn(i) for i in [0, n) on the threads of the call, as many as
+ *  omp_get_max_threads() of the calling thread, see OmpThreadScope, with the
+ *  ThreadId of each below that number. A loop inside another runs in the
+ *  thread of the outer iteration, as a region of one thread of id 0.
+ *
+ *  An OpenMP region can not throw. On a pool or an executor the first
+ *  exception of an iteration is rethrown once the loop is done, and the
+ *  iterations not started by then are skipped.
+ */
+template <typename Func>
+inline void ParallelFor(size_t n, Sched sched, Func fn) {
+  if (n == 0) return;
+  bool in_region = false;
+#if defined(_OPENMP)
+  in_region = omp_in_parallel() != 0;
+#endif
+  if (!in_region && detail::PoolSlot() < 0 &&
+      GetThreadBackend() != ThreadBackend::kOpenMP) {
+    detail::RunTasks(n, sched, omp_get_max_threads(), [](void* f, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) (*static_cast<Func*>(f))(i);
+    }, &fn);
+    return;
+  }
+  // the ids of the region are those of OpenMP
+  detail::SlotScope ids(-1);
+  const auto end = static_cast<omp_ulong>(n);
+  const auto chunk = static_cast<int>(std::max<size_t>(sched.chunk, 1));
+  if (sched.kind == Sched::kDynamic) {
+#pragma omp parallel for schedule(dynamic, chunk)
+    for (omp_ulong i = 0; i < end; ++i) fn(static_cast<size_t>(i));
+  } else if (sched.kind == Sched::kGuided) {
+#pragma omp parallel for schedule(guided)
+    for (omp_ulong i = 0; i < end; ++i) fn(static_cast<size_t>(i));
+  } else if (sched.chunk != 0) {
+#pragma omp parallel for schedule(static, chunk)
+    for (omp_ulong i = 0; i < end; ++i) fn(static_cast<size_t>(i));
+  } else {
+#pragma omp parallel for schedule(static)
+    for (omp_ulong i = 0; i < end; ++i) fn(static_cast<size_t>(i));
+  }
+}
+
+/*! \brief ParallelFor of the static schedule */
+template <typename Func>
+inline void ParallelFor(size_t n, Func fn) {
+  ParallelFor(n, Sched::Static(), fn);
+}
+
+/*!
+ * \brief K sums over i in [0, n), fn(i, sums) adds the values of i to
+ *  sums[0, K). The iterations are summed in blocks of a fixed size and the
+ *  blocks in order, so the sums do not depend on the threads or the backend.
+ */
+template <int K, typename Func>
+inline void ParallelSum(size_t n, double (&out)[K], Func fn) {
+  const size_t kBlock = 2048;
+  const size_t nblock = (n + kBlock - 1) / kBlock;
+  std::vector<double> block_sums(nblock * K);
+  ParallelFor(nblock, [&](size_t b) {
+    double sums[K] = {0};
+    const size_t end = std::min(n, (b + 1) * kBlock);
+    for (size_t i = b * kBlock; i < end; ++i) fn(i, sums);
+    std::copy(sums, sums + K, &block_sums[b * K]);
+  });
+  std::fill(out, out + K, 0.0);
+  for (size_t b = 0; b < nblock; ++b) {
+    for (int k = 0; k < K; ++k) out[k] += block_sums[b * K + k];
+  }
+}
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_THREADING_H_
@@ -0,0 +1,115 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file train_state.h
+ * \brief the state of training beside the model: the margins of the
+ *  training data and the random state.
+ *
+ *  The margins are served by the prediction cache of the booster, so saving
+ *  them costs a copy, while a learner loaded from the model alone predicts
+ *  the whole training data again before its next round. A TrainState is
+ *  written beside model checkpoints, and in distributed training it is the
+ *  local model of the rabit checkpoints: each worker holds the margins of its
+ *  own rows, rabit keeps them on other workers too, and a restarted worker
+ *  gets them back with the model instead of predicting its rows.
+ *
+ *  The cuts and the sorted columns are not part of the state, a restarted
+ *  worker builds them from its data; fast_hist reuses its cuts from the file
+ *  of cut_cache when one is given.
+ */
+#ifndef XGBOOST_COMMON_TRAIN_STATE_H_
+#define XGBOOST_COMMON_TRAIN_STATE_H_
+
+#include <dmlc/io.h>
+#include <xgboost/data.h>
+#include <xgboost/gbm.h>
+#include <xgboost/learner.h>
+#include <xgboost/logging.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "./host_device_vector.h"
+#include "./random.h"
+#include "./sync.h"
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace common {
+
+/*! \brief magic of the training states */
+const char* const kTrainStateMagic = "xgts";
+
+class TrainState : public rabit::Serializable {
+ public:
+  /*! \brief the state of learner trained on dtrain, both must outlive it */
+  TrainState(Learner* learner, DMatrix* dtrain) : learner_(learner), dtrain_(dtrain) {}
+  /*! \brief write the current margins of dtrain and the random state */
+  void Save(dmlc::Stream* fo) const override {
+    fo->Write(kTrainStateMagic, 4);
+    const gbm::GBTreeModel* model = learner_->GetGradientBooster()->GetTreeModel();
+    // no margins but those of tree models are cached
+    const uint64_t ntree = model == nullptr ? 0 : model->trees.size();
+    const uint64_t nrow = dtrain_->Info().num_row_;
+    fo->Write(&ntree, sizeof(ntree));
+    fo->Write(&nrow, sizeof(nrow));
+    if (model == nullptr) {
+      fo->Write(std::vector<bst_float>());
+    } else {
+      HostDeviceVector<bst_float> margin;
+      learner_->Predict(dtrain_, true, &margin);
+      fo->Write(margin.HostVector());
+    }
+    std::ostringstream os;
+#if !XGBOOST_CUSTOMIZE_GLOBAL_PRNG
+    os << GlobalRandom();
+#endif
+    fo->Write(os.str());
+  }
+  /*! \brief read a state, Restore hands it to the learner */
+  void Load(dmlc::Stream* fi) override {
+    std::string header;
+    header.resize(4);
+    CHECK(fi->Read(&header[0], 4) == 4 && header == kTrainStateMagic)
+        << "invalid training state";
+    CHECK_EQ(fi->Read(&ntree_, sizeof(ntree_)), sizeof(ntree_)) << "invalid training state";
+    CHECK_EQ(fi->Read(&nrow_, sizeof(nrow_)), sizeof(nrow_)) << "invalid training state";
+    CHECK(fi->Read(&margin_) && fi->Read(&random_)) << "invalid training state";
+    loaded_ = true;
+  }
+  /*!
+   * \brief put the margins of the loaded state in the prediction cache and
+   *  resume its random state, once the model of the state is loaded
+   * \return false when no state was loaded or it does not match the model
+   *  and the training data
+   */
+  inline bool Restore() {
+    if (!loaded_) return false;
+    loaded_ = false;
+    const gbm::GBTreeModel* model = learner_->GetGradientBooster()->GetTreeModel();
+    if (model == nullptr || model->trees.size() != ntree_ ||
+        dtrain_->Info().num_row_ != nrow_ ||
+        margin_.size() != nrow_ * model->param.num_output_group ||
+        !learner_->SetCachedMargin(dtrain_, margin_)) {
+      return false;
+    }
+#if !XGBOOST_CUSTOMIZE_GLOBAL_PRNG
+    std::istringstream is(random_);
+    is >> GlobalRandom();
+#endif
+    margin_.clear();
+    return true;
+  }
+
+ private:
+  Learner* learner_;
+  DMatrix* dtrain_;
+  // the loaded state
+  bool loaded_{false};
+  uint64_t ntree_{0};
+  uint64_t nrow_{0};
+  std::vector<bst_float> margin_;
+  std::string random_;
+};
+
+}  // namespace common
+}  // namespace xgboost
+#endif  // XGBOOST_COMMON_TRAIN_STATE_H_
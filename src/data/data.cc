@@ -5,12 +5,17 @@
 #include <xgboost/data.h>
 #include <xgboost/logging.h>
 #include <dmlc/registry.h>
+#include <algorithm>
 #include <cstring>
+#include <limits>
+#include <vector>
 #include "./sparse_page_writer.h"
 #include "./simple_dmatrix.h"
 #include "./simple_csr_source.h"
+#include "./mapped_csr_source.h"
 #include "../common/common.h"
 #include "../common/io.h"
+#include "../common/sync.h"
 
 #if DMLC_ENABLE_STD_THREAD
 #include "./sparse_page_source.h"
@@ -31,6 +36,7 @@ void MetaInfo::Clear() {
   qids_.clear();
   weights_.clear();
   base_margin_.clear();
+  feature_map_.clear();
 }
 
 void MetaInfo::SaveBinary(dmlc::Stream *fo) const {
@@ -200,9 +206,17 @@ DMatrix* DMatrix::Load(const std::string& uri,
       common::PeekableInStream is(fi.get());
       if (is.PeekRead(&magic, sizeof(magic)) == sizeof(magic) &&
           magic == data::SimpleCSRSource::kMagic) {
-        std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
-        source->LoadBinary(&is);
-        DMatrix* dmat = DMatrix::Create(std::move(source), cache_file);
+        DMatrix* dmat;
+        // local files are mapped instead of read into memory
+        std::unique_ptr<data::MappedCSRSource> mapped(
+            cache_file.length() == 0 ? data::MappedCSRSource::Open(fname) : nullptr);
+        if (mapped != nullptr) {
+          dmat = DMatrix::Create(std::move(mapped), cache_file);
+        } else {
+          std::unique_ptr<data::SimpleCSRSource> source(new data::SimpleCSRSource());
+          source->LoadBinary(&is);
+          dmat = DMatrix::Create(std::move(source), cache_file);
+        }
         if (!silent) {
           LOG(CONSOLE) << dmat->Info().num_row_ << 'x' << dmat->Info().num_col_ << " matrix with "
                        << dmat->Info().num_nonzero_ << " entries loaded from " << uri;
@@ -262,9 +276,53 @@ DMatrix* DMatrix::Create(dmlc::Parser<uint32_t>* parser,
   }
 }
 
+void DMatrix::InitFeatureMap(bool sync_rows) {
+  MetaInfo& info = this->Info();
+  uint64_t ncol = info.num_col_;
+  uint64_t nrow = info.num_row_;
+  if (sync_rows) {
+    rabit::Allreduce<rabit::op::Max>(&ncol, 1);
+    rabit::Allreduce<rabit::op::Sum>(&nrow, 1);
+  }
+  std::vector<uint64_t> count(ncol, 0);
+  std::vector<bst_float> fmin(ncol, std::numeric_limits<bst_float>::max());
+  std::vector<bst_float> fmax(ncol, std::numeric_limits<bst_float>::lowest());
+  auto iter = this->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    for (const Entry& e : iter->Value().data) {
+      ++count[e.index];
+      fmin[e.index] = std::min(fmin[e.index], e.fvalue);
+      fmax[e.index] = std::max(fmax[e.index], e.fvalue);
+    }
+  }
+  if (sync_rows) {
+    rabit::Allreduce<rabit::op::Sum>(dmlc::BeginPtr(count), count.size());
+    rabit::Allreduce<rabit::op::Min>(dmlc::BeginPtr(fmin), fmin.size());
+    rabit::Allreduce<rabit::op::Max>(dmlc::BeginPtr(fmax), fmax.size());
+  }
+  info.feature_map_.clear();
+  for (uint64_t fid = 0; fid < ncol; ++fid) {
+    if (count[fid] != 0 && (count[fid] < nrow || fmin[fid] < fmax[fid])) {
+      info.feature_map_.push_back(static_cast<bst_uint>(fid));
+    }
+  }
+}
+
+void DMatrix::AppendRows(const SparsePage& rows, const std::vector<bst_float>& labels,
+                         const std::vector<bst_float>& weights) {
+  LOG(FATAL) << "only DMatrix of in-memory rows support appending rows";
+}
+
 void DMatrix::SaveToLocalFile(const std::string& fname) {
   data::SimpleCSRSource source;
   source.CopyFrom(this);
+  // keep the sorted columns, so that loading the file skips the transpose and sort
+  if (this->HaveColAccess(true) && this->SingleColBlock() && !this->WideRowIds()) {
+    auto iter = this->ColIterator();
+    iter->BeforeFirst();
+    if (iter->Next()) source.sorted_column_ = iter->Value();
+  }
   std::unique_ptr<dmlc::Stream> fo(dmlc::Stream::Create(fname.c_str(), "w"));
   source.SaveBinary(fo.get());
 }
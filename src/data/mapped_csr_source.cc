@@ -0,0 +1,141 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file mapped_csr_source.cc
+ */
+#include <dmlc/base.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include "./mapped_csr_source.h"
+#include "./simple_csr_source.h"
+#include "../common/io.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace xgboost {
+namespace data {
+
+MappedCSRSource::~MappedCSRSource() {
+#if !defined(_WIN32)
+  if (base_ != nullptr) munmap(base_, size_);
+#endif
+}
+
+MappedCSRSource* MappedCSRSource::Open(const std::string& fname) {
+#if defined(_WIN32)
+  return nullptr;
+#else
+  std::string path = fname;
+  if (path.compare(0, 7, "file://") == 0) path = path.substr(7);
+  if (path.find("://") != std::string::npos) return nullptr;
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return nullptr;
+  }
+  const auto size = static_cast<size_t>(st.st_size);
+  void* ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (ptr == MAP_FAILED) return nullptr;
+  madvise(ptr, size, MADV_SEQUENTIAL);
+  std::unique_ptr<MappedCSRSource> source(new MappedCSRSource());
+  source->base_ = static_cast<char*>(ptr);
+  source->size_ = size;
+  // the header goes through the usual reader, the rows stay in the file
+  common::MemoryFixSizeBuffer fi(source->base_, size);
+  int tmagic;
+  CHECK(size >= sizeof(tmagic) && fi.Read(&tmagic, sizeof(tmagic)) == sizeof(tmagic))
+      << "invalid input file format";
+  CHECK_EQ(tmagic, SimpleCSRSource::kMagic) << "invalid format, magic number mismatch";
+  source->info.LoadBinary(&fi);
+  auto array = [&fi, size](size_t elem_size, size_t* out_len) {
+    uint64_t len;
+    CHECK(fi.Tell() + sizeof(len) <= size && fi.Read(&len, sizeof(len)) == sizeof(len))
+        << "invalid input file format";
+    const size_t pos = fi.Tell();
+    CHECK_LE(len, (size - pos) / elem_size) << "invalid input file format, file truncated";
+    fi.Seek(pos + static_cast<size_t>(len) * elem_size);
+    *out_len = static_cast<size_t>(len);
+    return pos;
+  };
+  size_t noffset;
+  source->offset_ = source->base_ + array(sizeof(size_t), &noffset);
+  source->data_ = source->base_ + array(sizeof(Entry), &source->num_entry_);
+  CHECK_EQ(noffset, source->info.num_row_ + 1) << "invalid input file format";
+  int cmagic;
+  if (fi.Tell() + sizeof(cmagic) <= size) {
+    fi.Read(&cmagic, sizeof(cmagic));
+    CHECK_EQ(cmagic, SimpleCSRSource::kSortedColumnMagic)
+        << "invalid format, unknown data after the rows";
+    source->column_pos_ = fi.Tell();
+  }
+  source->page_row_ = source->info.num_row_;
+  return source.release();
+#endif
+}
+
+bool MappedCSRSource::CopySortedColumn(SparsePage* out) const {
+  if (column_pos_ == 0) return false;
+  common::MemoryFixSizeBuffer fi(base_, size_);
+  fi.Seek(column_pos_);
+  uint64_t hash;
+  CHECK(column_pos_ + sizeof(hash) <= size_ && fi.Read(&hash, sizeof(hash)) == sizeof(hash))
+      << "invalid sorted column page";
+  if (hash != RowPageHash(offset_, info.num_row_ + 1, data_, num_entry_)) {
+    LOG(WARNING) << "sorted column page does not match the rows, it is ignored";
+    return false;
+  }
+  out->Clear();
+  CHECK(fi.Read(&out->offset)) << "invalid sorted column page";
+  CHECK(fi.Read(&out->data)) << "invalid sorted column page";
+  return out->data.size() == num_entry_;
+}
+
+void MappedCSRSource::BeforeFirst() {
+  next_row_ = 0;
+}
+
+bool MappedCSRSource::Next() {
+  const size_t nrow = info.num_row_;
+  if (next_row_ >= nrow) return false;
+  if (page_row_ == next_row_) {
+    // the page is still loaded, e.g. the rows fit in one page
+    next_row_ += page_.Size();
+    return true;
+  }
+  const size_t begin = this->Offset(next_row_);
+  size_t end_row = next_row_ + 1;
+  while (end_row < nrow && this->Offset(end_row + 1) - begin <= kMaxPageEntries) {
+    ++end_row;
+  }
+  const size_t end = this->Offset(end_row);
+  page_.Clear();
+  page_.base_rowid = next_row_;
+  page_.offset.resize(end_row - next_row_ + 1);
+  for (size_t i = next_row_; i <= end_row; ++i) {
+    page_.offset[i - next_row_] = this->Offset(i) - begin;
+  }
+  page_.data.resize(end - begin);
+  if (end != begin) {
+    std::memcpy(dmlc::BeginPtr(page_.data), data_ + begin * sizeof(Entry),
+                (end - begin) * sizeof(Entry));
+  }
+  page_row_ = next_row_;
+  next_row_ = end_row;
+  return true;
+}
+
+const SparsePage& MappedCSRSource::Value() const {
+  return page_;
+}
+
+}  // namespace data
+}  // namespace xgboost
@@ -0,0 +1,72 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file mapped_csr_source.h
+ * \brief Row oriented data source over a memory mapped binary DMatrix file.
+ *
+ *  The rows of a file written by SimpleCSRSource::SaveBinary are not read
+ *  into memory at load time. The file is mapped and every pass over the rows
+ *  copies them into a reused page of at most kMaxPageEntries entries, so the
+ *  resident memory of the rows is one page plus the page cache of the file.
+ */
+#ifndef XGBOOST_DATA_MAPPED_CSR_SOURCE_H_
+#define XGBOOST_DATA_MAPPED_CSR_SOURCE_H_
+
+#include <xgboost/base.h>
+#include <xgboost/data.h>
+#include <cstring>
+#include <string>
+
+namespace xgboost {
+namespace data {
+
+class MappedCSRSource : public DataSource {
+ public:
+  /*! \brief maximum number of entries of a row page */
+  static const size_t kMaxPageEntries = static_cast<size_t>(1) << 26;
+  /*! \brief destructor, unmaps the file */
+  ~MappedCSRSource() override;
+  /*!
+   * \brief map a binary file written by SimpleCSRSource::SaveBinary.
+   * \param fname the file name
+   * \return the source, or nullptr if the file cannot be mapped,
+   *   e.g. it is not a local file
+   */
+  static MappedCSRSource* Open(const std::string& fname);
+  /*!
+   * \brief copy the sorted column page saved after the rows.
+   * \return false if there is none or it does not match the rows
+   */
+  bool CopySortedColumn(SparsePage* out) const;
+  // implement Next
+  bool Next() override;
+  // implement BeforeFirst
+  void BeforeFirst() override;
+  // implement Value
+  const SparsePage &Value() const override;
+
+ private:
+  MappedCSRSource() = default;
+  // i-th row offset, the array in the file is not necessarily aligned
+  inline size_t Offset(size_t i) const {
+    size_t value;
+    std::memcpy(&value, offset_ + i * sizeof(size_t), sizeof(value));
+    return value;
+  }
+  /*! \brief the mapped file */
+  char* base_{nullptr};
+  size_t size_{0};
+  /*! \brief row offsets and entries of the rows in the file */
+  const char* offset_{nullptr};
+  const char* data_{nullptr};
+  size_t num_entry_{0};
+  /*! \brief position of the sorted column page in the file, 0 if none */
+  size_t column_pos_{0};
+  /*! \brief first row of the next page */
+  size_t next_row_{0};
+  /*! \brief first row held in page_, num_row when page_ is empty */
+  size_t page_row_{0};
+  SparsePage page_;
+};
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_MAPPED_CSR_SOURCE_H_
@@ -0,0 +1,122 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file shared_page_view.h
+ * \brief views of an in-memory matrix that scan its pages independently.
+ */
+#ifndef XGBOOST_DATA_SHARED_PAGE_VIEW_H_
+#define XGBOOST_DATA_SHARED_PAGE_VIEW_H_
+
+#include <dmlc/data.h>
+#include <dmlc/logging.h>
+#include <xgboost/data.h>
+
+namespace xgboost {
+namespace data {
+
+/*! \brief iterator over a single page that is owned elsewhere */
+class SinglePageIter : public dmlc::DataIter<SparsePage> {
+ public:
+  explicit SinglePageIter(const SparsePage* page) : page_(page) {}
+  void BeforeFirst() override {
+    at_head_ = true;
+  }
+  bool Next() override {
+    if (!at_head_ || page_ == nullptr) return false;
+    at_head_ = false;
+    return true;
+  }
+  const SparsePage& Value() const override {
+    return *page_;
+  }
+
+ private:
+  const SparsePage* page_;
+  bool at_head_{true};
+};
+
+/*!
+ * \brief view of an in-memory matrix with iterators of its own, so that
+ *  several updaters or boosters can scan the same row and sorted column
+ *  pages at once.
+ *  The iterators of the base matrix must not be used while a view is alive.
+ */
+class SharedPageView : public DMatrix {
+ public:
+  SharedPageView(DMatrix* base, const SparsePage* row_page, const SparsePage* col_page)
+      : base_(base), row_page_(row_page), col_page_(col_page),
+        row_iter_(row_page), col_iter_(col_page) {}
+  /*!
+   * \brief the row page and the column page of a matrix, for views of it
+   * \param row_page set to the only row page, nullptr for an empty matrix
+   * \param col_page set to the only column page, nullptr without column access
+   * \return false if the matrix has several pages, or columns of 64 bit row ids
+   */
+  inline static bool GetPages(DMatrix* dmat, const SparsePage** row_page,
+                              const SparsePage** col_page) {
+    *row_page = nullptr;
+    *col_page = nullptr;
+    auto row_iter = dmat->RowIterator();
+    row_iter->BeforeFirst();
+    if (row_iter->Next()) {
+      *row_page = &row_iter->Value();
+      if (row_iter->Next()) return false;
+    }
+    if (dmat->HaveColAccess(true) || dmat->HaveColAccess(false)) {
+      if (!dmat->SingleColBlock() || dmat->WideRowIds()) return false;
+      auto col_iter = dmat->ColIterator();
+      col_iter->BeforeFirst();
+      if (col_iter->Next()) *col_page = &col_iter->Value();
+    }
+    return true;
+  }
+  /*! \return whether this is a view of the given matrix and pages */
+  inline bool Views(const DMatrix* base, const SparsePage* row_page,
+                    const SparsePage* col_page) const {
+    return base_ == base && row_page_ == row_page && col_page_ == col_page;
+  }
+  MetaInfo& Info() override {
+    return base_->Info();
+  }
+  const MetaInfo& Info() const override {
+    return base_->Info();
+  }
+  dmlc::DataIter<SparsePage>* RowIterator() override {
+    row_iter_.BeforeFirst();
+    return &row_iter_;
+  }
+  dmlc::DataIter<SparsePage>* ColIterator() override {
+    CHECK(col_page_ != nullptr) << "column access is not initialized";
+    col_iter_.BeforeFirst();
+    return &col_iter_;
+  }
+  void InitColAccess(size_t max_row_perbatch, bool sorted) override {
+    CHECK(base_->HaveColAccess(sorted))
+        << "column access must be initialized before growing trees concurrently";
+  }
+  bool HaveColAccess(bool sorted) const override {
+    return col_page_ != nullptr && base_->HaveColAccess(sorted);
+  }
+  bool SingleColBlock() const override {
+    return true;
+  }
+  size_t GetColSize(size_t cidx) const override {
+    return base_->GetColSize(cidx);
+  }
+  float GetColDensity(size_t cidx) const override {
+    return base_->GetColDensity(cidx);
+  }
+  const RowSet& BufferedRowset() const override {
+    return base_->BufferedRowset();
+  }
+
+ private:
+  DMatrix* base_;
+  const SparsePage* row_page_;
+  const SparsePage* col_page_;
+  SinglePageIter row_iter_;
+  SinglePageIter col_iter_;
+};
+
+}  // namespace data
+}  // namespace xgboost
+#endif  // XGBOOST_DATA_SHARED_PAGE_VIEW_H_
@@ -3,15 +3,40 @@
  * \file simple_csr_source.cc
  */
 #include <dmlc/base.h>
+#include <dmlc/omp.h>
 #include <xgboost/logging.h>
+#include <algorithm>
 #include <limits>
+#include <vector>
 #include "./simple_csr_source.h"
 
 namespace xgboost {
 namespace data {
 
+uint64_t RowPageHash(const void* offset, size_t noffset, const void* data, size_t ndata) {
+  uint64_t hash = 14695981039346656037ULL;
+  auto mix = [&hash](const void* ptr, size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(ptr);
+    for (size_t i = 0; i < size; ++i) {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+  };
+  mix(offset, noffset * sizeof(size_t));
+  mix(data, ndata * sizeof(Entry));
+  return hash;
+}
+
+namespace {
+inline uint64_t PageHash(const SparsePage& page) {
+  return RowPageHash(dmlc::BeginPtr(page.offset), page.offset.size(),
+                     dmlc::BeginPtr(page.data), page.data.size());
+}
+}  // namespace
+
 void SimpleCSRSource::Clear() {
   page_.Clear();
+  sorted_column_.Clear();
   this->info.Clear();
 }
 
@@ -61,17 +86,38 @@ void SimpleCSRSource::CopyFrom(dmlc::Parser<uint32_t>* parser) {
 
     // update information
     this->info.num_row_ += batch.size;
-    // copy the data over
-    for (size_t i = batch.offset[0]; i < batch.offset[batch.size]; ++i) {
-      uint32_t index = batch.index[i];
-      bst_float fvalue = batch.value == nullptr ? 1.0f : batch.value[i];
-      page_.data.emplace_back(index, fvalue);
-      this->info.num_col_ = std::max(this->info.num_col_,
-                                    static_cast<uint64_t>(index + 1));
+    // copy the data over in parallel, directly into their place in the page
+    const size_t batch_begin = batch.offset[0];
+    const size_t data_top = page_.data.size();
+    const auto nnz = static_cast<omp_ulong>(batch.offset[batch.size] - batch_begin);
+    page_.data.resize(data_top + nnz);
+    Entry* data = dmlc::BeginPtr(page_.data) + data_top;
+    const int nthread = omp_get_max_threads();
+    std::vector<uint64_t> num_col(nthread, 0);
+    #pragma omp parallel num_threads(nthread)
+    {
+      uint64_t ncol = 0;
+      #pragma omp for schedule(static)
+      for (omp_ulong i = 0; i < nnz; ++i) {
+        const uint32_t index = batch.index[batch_begin + i];
+        const bst_float fvalue = batch.value == nullptr ? 1.0f : batch.value[batch_begin + i];
+        data[i] = Entry(index, fvalue);
+        ncol = std::max(ncol, static_cast<uint64_t>(index) + 1);
+      }
+      num_col[omp_get_thread_num()] = ncol;
+    }
+    for (uint64_t ncol : num_col) {
+      this->info.num_col_ = std::max(this->info.num_col_, ncol);
     }
-    size_t top = page_.offset.size();
-    for (size_t i = 0; i < batch.size; ++i) {
-      page_.offset.push_back(page_.offset[top - 1] + batch.offset[i + 1] - batch.offset[0]);
+    // the row offsets of the batch shifted to the end of the page
+    const size_t top = page_.offset.size();
+    const size_t base = page_.offset[top - 1] - batch_begin;
+    page_.offset.resize(top + batch.size);
+    size_t* offset = dmlc::BeginPtr(page_.offset) + top;
+    const auto nrow = static_cast<omp_ulong>(batch.size);
+    #pragma omp parallel for schedule(static) num_threads(nthread)
+    for (omp_ulong i = 0; i < nrow; ++i) {
+      offset[i] = base + batch.offset[i + 1];
     }
   }
   if (last_group_id != default_max) {
@@ -91,6 +137,20 @@ void SimpleCSRSource::LoadBinary(dmlc::Stream* fi) {
   info.LoadBinary(fi);
   fi->Read(&page_.offset);
   fi->Read(&page_.data);
+  // optional sorted column page, not present in files of older versions
+  sorted_column_.Clear();
+  int cmagic;
+  if (fi->Read(&cmagic, sizeof(cmagic)) == sizeof(cmagic)) {
+    CHECK_EQ(cmagic, kSortedColumnMagic) << "invalid format, unknown data after the rows";
+    uint64_t hash;
+    CHECK(fi->Read(&hash, sizeof(hash)) == sizeof(hash)) << "invalid sorted column page";
+    CHECK(fi->Read(&sorted_column_.offset)) << "invalid sorted column page";
+    CHECK(fi->Read(&sorted_column_.data)) << "invalid sorted column page";
+    if (hash != PageHash(page_) || sorted_column_.data.size() != page_.data.size()) {
+      LOG(WARNING) << "sorted column page does not match the rows, it is ignored";
+      sorted_column_.Clear();
+    }
+  }
 }
 
 void SimpleCSRSource::SaveBinary(dmlc::Stream* fo) const {
@@ -99,6 +159,14 @@ void SimpleCSRSource::SaveBinary(dmlc::Stream* fo) const {
   info.SaveBinary(fo);
   fo->Write(page_.offset);
   fo->Write(page_.data);
+  if (sorted_column_.Size() != 0) {
+    int cmagic = kSortedColumnMagic;
+    fo->Write(&cmagic, sizeof(cmagic));
+    const uint64_t hash = PageHash(page_);
+    fo->Write(&hash, sizeof(hash));
+    fo->Write(sorted_column_.offset);
+    fo->Write(sorted_column_.data);
+  }
 }
 
 void SimpleCSRSource::BeforeFirst() {
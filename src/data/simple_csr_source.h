@@ -16,6 +16,14 @@
 
 namespace xgboost {
 namespace data {
+/*!
+ * \brief FNV-1a hash of the offset and data arrays of a row page, ties the
+ *  sorted column page of a binary file to its rows.
+ * \param noffset number of offsets
+ * \param ndata number of entries
+ */
+uint64_t RowPageHash(const void* offset, size_t noffset, const void* data, size_t ndata);
+
 /*!
  * \brief The simplest form of data holder, can be used to create DMatrix.
  *  This is an in-memory data structure that holds the data in row oriented format.
@@ -30,6 +38,12 @@ class SimpleCSRSource : public DataSource {
   // public data members
   // MetaInfo info;  // inheritated from DataSource
   SparsePage page_;
+  /*!
+   * \brief sorted column page of page_, saved after the rows in the binary
+   *  format so that loading the file skips the transpose and sort.
+   *  Empty if not available.
+   */
+  SparsePage sorted_column_;
   /*! \brief default constructor */
   SimpleCSRSource() = default;
   /*! \brief destructor */
@@ -65,6 +79,8 @@ class SimpleCSRSource : public DataSource {
   const SparsePage &Value() const override;
   /*! \brief magic number used to identify SimpleCSRSource */
   static const int kMagic = 0xffffab01;
+  /*! \brief magic number of the sorted column page after the rows */
+  static const int kSortedColumnMagic = 0xffffab11;
 
  private:
   /*! \brief internal variable, used to support iterator interface */
@@ -7,98 +7,484 @@
 #include <xgboost/data.h>
 #include <limits>
 #include <algorithm>
+#include <numeric>
 #include <vector>
 #include "./simple_dmatrix.h"
-#include "../common/random.h"
+#include "./simple_csr_source.h"
+#include "./mapped_csr_source.h"
 #include "../common/group_data.h"
+#include "../common/random.h"
+#include "../common/radix_sort.h"
 
 namespace xgboost {
 namespace data {
 
-bool SimpleDMatrix::ColBatchIter::Next() {
-  if (data_ >= 1) return false;
-  data_ += 1;
-  return true;
+dmlc::DataIter<SparsePage>* SimpleDMatrix::ColIterator() {
+  CHECK(!this->WideRowIds()) << "the columns have 64 bit row ids, see ColIterator64";
+  if (lazy_.enabled) {
+    // all the columns are built for good
+    std::vector<bst_uint> fset(Info().num_col_);
+    std::iota(fset.begin(), fset.end(), 0);
+    this->BuildColumns(fset);
+    lazy_ = LazyColumns();
+  }
+  col_iter_.BeforeFirst();
+  return &col_iter_;
 }
 
-  dmlc::DataIter<SparsePage>* SimpleDMatrix::ColIterator() {
+dmlc::DataIter<SparsePage>* SimpleDMatrix::ColIteratorFor(const std::vector<bst_uint>& fset) {
+  CHECK(!this->WideRowIds()) << "the columns have 64 bit row ids, see ColIteratorFor64";
+  if (lazy_.enabled) this->BuildColumns(fset);
   col_iter_.BeforeFirst();
   return &col_iter_;
 }
 
+dmlc::DataIter<SparsePage64>* SimpleDMatrix::ColIterator64() {
+  CHECK(this->WideRowIds()) << "the columns have 32 bit row ids, see ColIterator";
+  col_iter64_.BeforeFirst();
+  return &col_iter64_;
+}
+
 void SimpleDMatrix::InitColAccess(
   size_t max_row_perbatch, bool sorted) {
   if (this->HaveColAccess(sorted)) return;
+  lazy_ = LazyColumns();
+  if (this->WideRowIds()) {
+    // the columns of a binary file or a mapped source have 32 bit row ids
+    col_iter_.column_page_.reset();
+    buffered_rowset_.Clear();
+    col_iter64_.sorted_ = sorted;
+    col_iter64_.column_page_.reset(new SparsePage64());
+    this->MakeOneBatch(col_iter64_.column_page_.get(), &buffered_rowset64_, sorted);
+    this->TrackMemory();
+    return;
+  }
   col_iter_.sorted_ = sorted;
   col_iter_.column_page_.reset(new SparsePage());
-  this->MakeOneBatch(col_iter_.column_page_.get(), sorted);
+  if (!sorted || !this->TakeSortedColumn(col_iter_.column_page_.get())) {
+    this->MakeOneBatch(col_iter_.column_page_.get(), &buffered_rowset_, sorted);
+  }
+  this->TrackMemory();
+}
+
+void SimpleDMatrix::InitLazyColAccess(size_t max_row_perbatch, size_t max_bytes) {
+  if (this->HaveColAccess(true)) return;
+  // the columns are built at once past 2^32 rows
+  if (this->WideRowIds()) return this->InitColAccess(max_row_perbatch, true);
+  lazy_ = LazyColumns();
+  col_iter_.sorted_ = true;
+  col_iter_.column_page_.reset(new SparsePage());
+  if (this->TakeSortedColumn(col_iter_.column_page_.get())) {
+    this->TrackMemory();
+    return;
+  }
+  // only count the entries of the columns, the page holds none of them
+  const size_t ncol = Info().num_col_;
+  lazy_.enabled = true;
+  lazy_.max_bytes = max_bytes;
+  lazy_.col_size.assign(ncol, 0);
+  lazy_.last_use.assign(ncol, 0);
+  buffered_rowset_.Clear();
+  auto iter = this->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    const auto& batch = iter->Value();
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      buffered_rowset_.PushBack(static_cast<bst_uint>(batch.base_rowid + i));
+    }
+    for (const Entry& e : batch.data) {
+      CHECK_LT(e.index, ncol) << "feature index exceeds the number of columns";
+      ++lazy_.col_size[e.index];
+    }
+  }
+  col_iter_.column_page_->offset.assign(ncol + 1, 0);
+  this->TrackMemory();
+}
+
+void SimpleDMatrix::BuildColumns(const std::vector<bst_uint>& fset) {
+  const size_t ncol = Info().num_col_;
+  const uint64_t now = ++lazy_.clock;
+  std::vector<bst_uint> missing;
+  size_t nmissing = 0;
+  for (bst_uint fid : fset) {
+    CHECK_LT(fid, ncol) << "feature index exceeds the number of columns";
+    if (lazy_.last_use[fid] == 0) {
+      missing.push_back(fid);
+      nmissing += lazy_.col_size[fid];
+    }
+    lazy_.last_use[fid] = now;
+  }
+  if (missing.size() == 0) return;
+  std::sort(missing.begin(), missing.end());
+  if (lazy_.max_bytes != 0 &&
+      (lazy_.num_built + nmissing) * sizeof(Entry) > lazy_.max_bytes) {
+    // drop the columns not requested now, least recently requested first
+    std::vector<bst_uint> built;
+    for (size_t fid = 0; fid < ncol; ++fid) {
+      if (lazy_.last_use[fid] != 0 && lazy_.last_use[fid] != now) {
+        built.push_back(static_cast<bst_uint>(fid));
+      }
+    }
+    std::sort(built.begin(), built.end(), [&](bst_uint a, bst_uint b) {
+      return lazy_.last_use[a] < lazy_.last_use[b];
+    });
+    for (size_t k = 0; k < built.size() &&
+             (lazy_.num_built + nmissing) * sizeof(Entry) > lazy_.max_bytes; ++k) {
+      lazy_.last_use[built[k]] = 0;
+      lazy_.num_built -= lazy_.col_size[built[k]];
+    }
+  }
+  // the entries of the missing columns, in row order
+  const int nthread = omp_get_max_threads();
+  std::vector<int> slot(ncol, -1);
+  for (size_t k = 0; k < missing.size(); ++k) slot[missing[k]] = static_cast<int>(k);
+  std::vector<size_t> new_offset;
+  std::vector<Entry> new_data;
+  {
+    common::ParallelGroupBuilder<Entry> builder(&new_offset, &new_data);
+    new_offset.assign(1, 0);
+    builder.InitBudget(missing.size(), nthread);
+    auto iter = this->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const auto& batch = iter->Value();
+      #pragma omp parallel for schedule(static) num_threads(nthread)
+      for (long i = 0; i < static_cast<long>(batch.Size()); ++i) { // NOLINT(*)
+        const int tid = omp_get_thread_num();
+        auto inst = batch[i];
+        for (bst_uint j = 0; j < inst.length; ++j) {
+          if (slot[inst[j].index] >= 0) builder.AddBudget(slot[inst[j].index], tid);
+        }
+      }
+    }
+    builder.InitStorage();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const auto& batch = iter->Value();
+      #pragma omp parallel for schedule(static) num_threads(nthread)
+      for (long i = 0; i < static_cast<long>(batch.Size()); ++i) { // NOLINT(*)
+        const int tid = omp_get_thread_num();
+        auto inst = batch[i];
+        const auto ridx = static_cast<bst_uint>(batch.base_rowid + i);
+        for (bst_uint j = 0; j < inst.length; ++j) {
+          if (slot[inst[j].index] >= 0) {
+            builder.Push(slot[inst[j].index], Entry(ridx, inst[j].fvalue), tid);
+          }
+        }
+      }
+    }
+  }
+  // lay out the kept and the new columns in a new page
+  SparsePage* pcol = col_iter_.column_page_.get();
+  std::vector<size_t> offset(ncol + 1, 0);
+  for (size_t fid = 0; fid < ncol; ++fid) {
+    offset[fid + 1] = offset[fid] + (lazy_.last_use[fid] != 0 ? lazy_.col_size[fid] : 0);
+  }
+  std::vector<Entry> data(offset[ncol]);
+  const auto ncol_omp = static_cast<bst_omp_uint>(ncol);
+  std::vector<std::vector<Entry> > scratch(nthread);
+  #pragma omp parallel for schedule(dynamic, 64) num_threads(nthread)
+  for (bst_omp_uint fid = 0; fid < ncol_omp; ++fid) {
+    if (offset[fid] == offset[fid + 1]) continue;
+    Entry* out = dmlc::BeginPtr(data) + offset[fid];
+    if (slot[fid] < 0) {
+      std::copy(dmlc::BeginPtr(pcol->data) + pcol->offset[fid],
+                dmlc::BeginPtr(pcol->data) + pcol->offset[fid + 1], out);
+      continue;
+    }
+    const size_t begin = new_offset[slot[fid]], end = new_offset[slot[fid] + 1];
+    std::copy(dmlc::BeginPtr(new_data) + begin, dmlc::BeginPtr(new_data) + end, out);
+    std::vector<Entry>& tscratch = scratch[omp_get_thread_num()];
+    if (tscratch.size() < end - begin) tscratch.resize(end - begin);
+    common::SortEntriesByValue(out, out + (end - begin), dmlc::BeginPtr(tscratch));
+  }
+  pcol->offset.swap(offset);
+  pcol->data.swap(data);
+  lazy_.num_built += nmissing;
+  this->TrackMemory();
+}
+
+bool SimpleDMatrix::TakeSortedColumn(SparsePage* pcol) {
+  if (auto* mapped = dynamic_cast<MappedCSRSource*>(source_.get())) {
+    if (!mapped->CopySortedColumn(pcol) || pcol->Size() != Info().num_col_) {
+      pcol->Clear();
+      return false;
+    }
+  } else {
+    auto* source = dynamic_cast<SimpleCSRSource*>(source_.get());
+    if (source == nullptr || source->sorted_column_.Size() != Info().num_col_) {
+      return false;
+    }
+    // the page is used once, the source does not keep a copy
+    std::swap(pcol->offset, source->sorted_column_.offset);
+    std::swap(pcol->data, source->sorted_column_.data);
+    source->sorted_column_.Clear();
+  }
+  pcol->base_rowid = 0;
+  buffered_rowset_.Clear();
+  for (size_t i = 0; i < Info().num_row_; ++i) {
+    buffered_rowset_.PushBack(static_cast<bst_uint>(i));
+  }
+  return true;
 }
 
 // internal function to make one batch from row iter.
-void SimpleDMatrix::MakeOneBatch(SparsePage* pcol, bool sorted) {
+//
+// The entries are radix partitioned by the high bits of their column into at
+// most kPartitionBins buckets, so the scatter of a thread writes to few places
+// at once. Each bucket is then a contiguous range of columns, whose entries are
+// distributed to their columns and sorted while the bucket is in cache. With
+// few columns the buckets are the columns, and the entries are scattered to
+// their place directly. The rows of a column stay in their order.
+template <typename PageT>
+void SimpleDMatrix::MakeOneBatch(PageT* pcol, RowSetImpl<typename PageT::Index>* rowset,
+                                 bool sorted) {
+  using EntryT = typename PageT::EntryT;
+  using Index = typename PageT::Index;
+  // entry of the partition, with its column
+  struct ColEntry {
+    bst_uint col;
+    EntryT entry;
+  };
+  constexpr size_t kPartitionBins = 256;
   // clear rowset
-  buffered_rowset_.Clear();
-  // bit map
+  rowset->Clear();
   const int nthread = omp_get_max_threads();
   pcol->Clear();
-  common::ParallelGroupBuilder<Entry>
-      builder(&pcol->offset, &pcol->data);
-  builder.InitBudget(Info().num_col_, nthread);
-  // start working
+  const size_t ncol = Info().num_col_;
+  unsigned shift = 0;
+  while ((ncol >> shift) >= kPartitionBins) ++shift;
+  const size_t nbucket = (ncol >> shift) + 1;
+  // count the entries of each (bucket, thread)
+  std::vector<size_t> count(nbucket * nthread, 0);
+  int bad_index = 0;
   auto iter = this->RowIterator();
   iter->BeforeFirst();
   while (iter->Next()) {
     const  auto& batch = iter->Value();
     long batch_size = static_cast<long>(batch.Size()); // NOLINT(*)
     for (long i = 0; i < batch_size; ++i) { // NOLINT(*)
-      auto ridx = static_cast<bst_uint>(batch.base_rowid + i);
-      buffered_rowset_.PushBack(ridx);
+      rowset->PushBack(static_cast<Index>(batch.base_rowid + i));
     }
-    #pragma omp parallel for schedule(static)
+    #pragma omp parallel for schedule(static) num_threads(nthread) reduction(|:bad_index)
     for (long i = 0; i < batch_size; ++i) { // NOLINT(*)
-      int tid = omp_get_thread_num();
+      size_t* tcount = dmlc::BeginPtr(count) + omp_get_thread_num() * nbucket;
       auto inst = batch[i];
       for (bst_uint j = 0; j < inst.length; ++j) {
-        builder.AddBudget(inst[j].index, tid);
+        if (inst[j].index >= ncol) {
+          bad_index = 1;
+        } else {
+          ++tcount[inst[j].index >> shift];
+        }
       }
     }
   }
-  builder.InitStorage();
+  CHECK_EQ(bad_index, 0) << "feature index exceeds the number of columns";
+  // exclusive scan in (bucket, thread) order
+  std::vector<size_t> bucket_ptr(nbucket + 1, 0);
+  size_t total = 0;
+  for (size_t b = 0; b < nbucket; ++b) {
+    bucket_ptr[b] = total;
+    for (int t = 0; t < nthread; ++t) {
+      const size_t c = count[t * nbucket + b];
+      count[t * nbucket + b] = total;
+      total += c;
+    }
+  }
+  bucket_ptr[nbucket] = total;
+  pcol->data.resize(total);
+  pcol->offset.resize(ncol + 1);
+  std::vector<ColEntry> partition(shift == 0 ? 0 : total);
 
   iter->BeforeFirst();
   while (iter->Next()) {
-     auto batch = iter->Value();
-    #pragma omp parallel for schedule(static)
+    auto batch = iter->Value();
+    #pragma omp parallel for schedule(static) num_threads(nthread)
     for (long i = 0; i < static_cast<long>(batch.Size()); ++i) { // NOLINT(*)
-      int tid = omp_get_thread_num();
+      size_t* tcount = dmlc::BeginPtr(count) + omp_get_thread_num() * nbucket;
       auto inst = batch[i];
+      const auto ridx = static_cast<Index>(batch.base_rowid + i);
       for (bst_uint j = 0; j < inst.length; ++j) {
-        builder.Push(
-            inst[j].index,
-            Entry(static_cast<bst_uint>(batch.base_rowid + i), inst[j].fvalue),
-            tid);
+        const bst_uint col = inst[j].index;
+        const size_t pos = tcount[col >> shift]++;
+        if (shift == 0) {
+          pcol->data[pos] = EntryT(ridx, inst[j].fvalue);
+        } else {
+          partition[pos].col = col;
+          partition[pos].entry = EntryT(ridx, inst[j].fvalue);
+        }
+      }
+    }
+  }
+
+  // distribute the buckets to their columns and sort them
+  const auto nbucket_omp = static_cast<bst_omp_uint>(nbucket);
+  const size_t width = static_cast<size_t>(1) << shift;
+  std::vector<std::vector<EntryT> > scratch(nthread);
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(nthread)
+  for (bst_omp_uint b = 0; b < nbucket_omp; ++b) {
+    const size_t col_begin = b * width;
+    const size_t col_end = std::min(col_begin + width, ncol);
+    if (col_begin >= col_end) continue;
+    const size_t begin = bucket_ptr[b], end = bucket_ptr[b + 1];
+    if (shift == 0) {
+      pcol->offset[col_begin] = begin;
+    } else {
+      std::vector<size_t> cursor(col_end - col_begin + 1, 0);
+      for (size_t k = begin; k < end; ++k) ++cursor[partition[k].col - col_begin + 1];
+      cursor[0] = begin;
+      for (size_t c = 1; c < cursor.size(); ++c) cursor[c] += cursor[c - 1];
+      for (size_t c = col_begin; c < col_end; ++c) pcol->offset[c] = cursor[c - col_begin];
+      for (size_t k = begin; k < end; ++k) {
+        pcol->data[cursor[partition[k].col - col_begin]++] = partition[k].entry;
       }
     }
+    if (!sorted) continue;
+    std::vector<EntryT>& tscratch = scratch[omp_get_thread_num()];
+    for (size_t c = col_begin; c < col_end; ++c) {
+      const size_t cbegin = pcol->offset[c];
+      const size_t cend = c + 1 < col_end ? pcol->offset[c + 1] : end;
+      if (cend - cbegin > tscratch.size()) tscratch.resize(cend - cbegin);
+      common::SortEntriesByValue(dmlc::BeginPtr(pcol->data) + cbegin,
+                                 dmlc::BeginPtr(pcol->data) + cend,
+                                 dmlc::BeginPtr(tscratch));
+    }
   }
+  pcol->offset[ncol] = total;
 
   CHECK_EQ(pcol->Size(), Info().num_col_);
+}
 
-  if (sorted) {
-    // sort columns
-    auto ncol = static_cast<bst_omp_uint>(pcol->Size());
-#pragma omp parallel for schedule(dynamic, 1) num_threads(nthread)
-    for (bst_omp_uint i = 0; i < ncol; ++i) {
-      if (pcol->offset[i] < pcol->offset[i + 1]) {
-        std::sort(dmlc::BeginPtr(pcol->data) + pcol->offset[i],
-          dmlc::BeginPtr(pcol->data) + pcol->offset[i + 1],
-          Entry::CmpValue);
+// The new rows are laid out in columns as by MakeOneBatch, and each column of
+// the page is merged with their part of it: the entries of the page keep
+// their order and the new ones follow them at equal values, as a sort of all
+// the rows would place them.
+void SimpleDMatrix::AppendRows(const SparsePage& rows, const std::vector<bst_float>& labels,
+                               const std::vector<bst_float>& weights) {
+  auto* source = dynamic_cast<SimpleCSRSource*>(source_.get());
+  CHECK(source != nullptr) << "only DMatrix of in-memory rows support appending rows";
+  MetaInfo& info = source->info;
+  const size_t nrow = rows.Size();
+  const size_t old_nrow = info.num_row_;
+  CHECK(info.base_margin_.empty() && info.root_index_.empty() && info.group_ptr_.empty() &&
+        info.qids_.empty())
+      << "rows can not be appended to a DMatrix with base margins, root indices or groups";
+  CHECK(labels.empty() || labels.size() == nrow) << "one label per appended row is needed";
+  CHECK(weights.empty() || weights.size() == nrow) << "one weight per appended row is needed";
+  if (old_nrow != 0) {
+    CHECK_EQ(labels.empty(), info.labels_.empty())
+        << "the appended rows must have labels iff the DMatrix has labels";
+    CHECK_EQ(weights.empty(), info.weights_.empty())
+        << "the appended rows must have weights iff the DMatrix has weights";
+  }
+  if (nrow == 0) return;
+  CHECK(col_iter64_.column_page_ == nullptr)
+      << "rows can not be appended to the columns of 64 bit row ids";
+  CHECK(col_iter_.column_page_ == nullptr ||
+        old_nrow + nrow <= std::numeric_limits<bst_uint>::max())
+      << "the columns of 32 bit row ids can not take 2^32 rows or more";
+  const Entry* first = dmlc::BeginPtr(rows.data) + rows.offset[0];
+  const Entry* last = dmlc::BeginPtr(rows.data) + rows.offset[nrow];
+  size_t ncol = info.num_col_;
+  for (const Entry* e = first; e != last; ++e) {
+    ncol = std::max(ncol, static_cast<size_t>(e->index) + 1);
+  }
+  SparsePage& page = source->page_;
+  const size_t old_nnz = page.data.size();
+  page.data.insert(page.data.end(), first, last);
+  for (size_t i = 1; i <= nrow; ++i) {
+    page.offset.push_back(old_nnz + rows.offset[i] - rows.offset[0]);
+  }
+  // the column page of a binary file is not that of the rows anymore
+  source->sorted_column_.Clear();
+  info.labels_.insert(info.labels_.end(), labels.begin(), labels.end());
+  info.weights_.insert(info.weights_.end(), weights.begin(), weights.end());
+  info.num_row_ += nrow;
+  info.num_col_ = ncol;
+  info.num_nonzero_ = page.data.size();
+  // a feature may split on the new rows
+  info.feature_map_.clear();
+
+  SparsePage* pcol = col_iter_.column_page_.get();
+  if (pcol == nullptr) {
+    this->TrackMemory();
+    return;
+  }
+  for (size_t i = 0; i < nrow; ++i) {
+    buffered_rowset_.PushBack(static_cast<bst_uint>(old_nrow + i));
+  }
+  if (lazy_.enabled) {
+    // count the new entries, the built columns are built again when requested
+    lazy_.col_size.resize(ncol, 0);
+    for (const Entry* e = first; e != last; ++e) ++lazy_.col_size[e->index];
+    lazy_.last_use.assign(ncol, 0);
+    lazy_.num_built = 0;
+    pcol->offset.assign(ncol + 1, 0);
+    pcol->data.clear();
+    this->TrackMemory();
+    return;
+  }
+  // the columns of the new rows
+  std::vector<size_t> new_offset(ncol + 1, 0);
+  for (const Entry* e = first; e != last; ++e) ++new_offset[e->index + 1];
+  for (size_t fid = 0; fid < ncol; ++fid) new_offset[fid + 1] += new_offset[fid];
+  std::vector<Entry> new_data(new_offset[ncol]);
+  {
+    std::vector<size_t> cursor(new_offset.begin(), new_offset.end() - 1);
+    for (size_t i = 0; i < nrow; ++i) {
+      const auto ridx = static_cast<bst_uint>(old_nrow + i);
+      for (size_t j = rows.offset[i]; j < rows.offset[i + 1]; ++j) {
+        const Entry& e = rows.data[j];
+        new_data[cursor[e.index]++] = Entry(ridx, e.fvalue);
       }
     }
   }
+  const size_t old_ncol = pcol->Size();
+  std::vector<size_t> offset(ncol + 1, 0);
+  for (size_t fid = 0; fid < ncol; ++fid) {
+    const size_t old_size = fid < old_ncol ? pcol->offset[fid + 1] - pcol->offset[fid] : 0;
+    offset[fid + 1] = offset[fid] + old_size + new_offset[fid + 1] - new_offset[fid];
+  }
+  std::vector<Entry> data(offset[ncol]);
+  const bool sorted = col_iter_.sorted_;
+  const int nthread = omp_get_max_threads();
+  const auto ncol_omp = static_cast<bst_omp_uint>(ncol);
+  std::vector<std::vector<Entry> > scratch(nthread);
+  #pragma omp parallel for schedule(dynamic, 64) num_threads(nthread)
+  for (bst_omp_uint fid = 0; fid < ncol_omp; ++fid) {
+    const Entry* obegin = dmlc::BeginPtr(pcol->data) + (fid < old_ncol ? pcol->offset[fid] : 0);
+    const Entry* oend = dmlc::BeginPtr(pcol->data) + (fid < old_ncol ? pcol->offset[fid + 1] : 0);
+    Entry* nbegin = dmlc::BeginPtr(new_data) + new_offset[fid];
+    Entry* nend = dmlc::BeginPtr(new_data) + new_offset[fid + 1];
+    Entry* out = dmlc::BeginPtr(data) + offset[fid];
+    if (!sorted) {
+      std::copy(nbegin, nend, std::copy(obegin, oend, out));
+      continue;
+    }
+    std::vector<Entry>& tscratch = scratch[omp_get_thread_num()];
+    if (tscratch.size() < static_cast<size_t>(nend - nbegin)) tscratch.resize(nend - nbegin);
+    common::SortEntriesByValue(nbegin, nend, dmlc::BeginPtr(tscratch));
+    std::merge(obegin, oend, nbegin, nend, out, Entry::CmpValue);
+  }
+  pcol->offset.swap(offset);
+  pcol->data.swap(data);
+  this->TrackMemory();
 }
 
 bool SimpleDMatrix::SingleColBlock() const {
   return true;
 }
+
+void SimpleDMatrix::TrackMemory() {
+  size_t row_bytes = 0;
+  source_->BeforeFirst();
+  while (source_->Next()) row_bytes += source_->Value().MemCostBytes();
+  source_->BeforeFirst();
+  row_bytes_.Set(row_bytes);
+  const SparsePage* pcol = col_iter_.column_page_.get();
+  const SparsePage64* pcol64 = col_iter64_.column_page_.get();
+  col_bytes_.Set((pcol == nullptr ? 0 : pcol->MemCostBytes()) +
+                 (pcol64 == nullptr ? 0 : pcol64->MemCostBytes()));
+}
 }  // namespace data
 }  // namespace xgboost
@@ -12,6 +12,7 @@
 #include <vector>
 #include <algorithm>
 #include <cstring>
+#include "../common/memory_tracker.h"
 
 namespace xgboost {
 namespace data {
@@ -19,7 +20,9 @@ namespace data {
 class SimpleDMatrix : public DMatrix {
  public:
   explicit SimpleDMatrix(std::unique_ptr<DataSource>&& source)
-      : source_(std::move(source)) {}
+      : source_(std::move(source)) {
+    this->TrackMemory();
+  }
 
   MetaInfo& Info() override {
     return source_->info;
@@ -36,48 +39,91 @@ class SimpleDMatrix : public DMatrix {
   }
 
   bool HaveColAccess(bool sorted) const override {
+    if (this->WideRowIds()) {
+      return col_iter64_.sorted_ == sorted && col_iter64_.column_page_ != nullptr;
+    }
     return col_iter_.sorted_ == sorted && col_iter_.column_page_!= nullptr;
   }
 
   const RowSet& BufferedRowset() const override {
+    CHECK(!this->WideRowIds()) << "the columns have 64 bit row ids, see BufferedRowset64";
     return buffered_rowset_;
   }
 
   size_t GetColSize(size_t cidx) const override {
+    if (lazy_.enabled) return lazy_.col_size[cidx];
+    if (this->WideRowIds()) return (*col_iter64_.column_page_)[cidx].length;
     auto& batch = *col_iter_.column_page_;
     return batch[cidx].length;
   }
 
   float GetColDensity(size_t cidx) const override {
-    size_t nmiss = buffered_rowset_.Size() - GetColSize(cidx);
-    return 1.0f - (static_cast<float>(nmiss)) / buffered_rowset_.Size();
+    const size_t nrow = this->WideRowIds() ? buffered_rowset64_.Size() : buffered_rowset_.Size();
+    size_t nmiss = nrow - GetColSize(cidx);
+    return 1.0f - (static_cast<float>(nmiss)) / nrow;
   }
 
   dmlc::DataIter<SparsePage>* ColIterator() override;
 
+  dmlc::DataIter<SparsePage>* ColIteratorFor(const std::vector<bst_uint>& fset) override;
+
+  bool WideRowIds() const override {
+    return wide_row_ids_ || DMatrix::WideRowIds();
+  }
+  /*!
+   * \brief build the columns with 64 bit row ids from now on, as past 2^32
+   *  rows, e.g. to check a learner on them with less rows. Before the columns
+   *  are initialized.
+   */
+  void UseWideRowIds() {
+    CHECK(col_iter_.column_page_ == nullptr) << "the columns are initialized already";
+    wide_row_ids_ = true;
+  }
+
+  dmlc::DataIter<SparsePage64>* ColIterator64() override;
+
+  dmlc::DataIter<SparsePage64>* ColIteratorFor64(const std::vector<bst_uint>& fset) override {
+    return this->ColIterator64();
+  }
+
+  const RowSet64& BufferedRowset64() const override {
+    CHECK(this->WideRowIds()) << "the columns have 32 bit row ids, see BufferedRowset";
+    return buffered_rowset64_;
+  }
+
   void InitColAccess(
     size_t max_row_perbatch, bool sorted) override;
 
+  void InitLazyColAccess(size_t max_row_perbatch, size_t max_bytes) override;
+
   bool SingleColBlock() const override;
 
+  void AppendRows(const SparsePage& rows, const std::vector<bst_float>& labels,
+                  const std::vector<bst_float>& weights) override;
+
  private:
   // in-memory column batch iterator.
-  struct ColBatchIter: dmlc::DataIter<SparsePage> {
+  template <typename PageT>
+  struct ColBatchIter: dmlc::DataIter<PageT> {
    public:
     ColBatchIter()  = default;
     void BeforeFirst() override {
       data_ = 0;
     }
-    const SparsePage &Value() const override {
+    const PageT &Value() const override {
       return *column_page_;
     }
-    bool Next() override;
+    bool Next() override {
+      if (data_ >= 1) return false;
+      data_ += 1;
+      return true;
+    }
 
    private:
     // allow SimpleDMatrix to access it.
     friend class SimpleDMatrix;
     // column sparse page
-    std::unique_ptr<SparsePage> column_page_;
+    std::unique_ptr<PageT> column_page_;
     // data pointer
     size_t data_{0};
     // Is column sorted?
@@ -87,13 +133,43 @@ class SimpleDMatrix : public DMatrix {
   // source data pointer.
   std::unique_ptr<DataSource> source_;
   // column iterator
-  ColBatchIter col_iter_;
+  ColBatchIter<SparsePage> col_iter_;
   // list of row index that are buffered.
   RowSet buffered_rowset_;
+  // the columns and the rows of 64 bit row ids, held instead of the above ones
+  // past 2^32 rows, see WideRowIds
+  ColBatchIter<SparsePage64> col_iter64_;
+  RowSet64 buffered_rowset64_;
+  bool wide_row_ids_{false};
+  // the columns of the sorted page that are built, see InitLazyColAccess
+  struct LazyColumns {
+    // whether the page may miss columns
+    bool enabled{false};
+    // bound of the memory of the built columns, 0 for none
+    size_t max_bytes{0};
+    // number of entries of each column
+    std::vector<size_t> col_size;
+    // request of the latest call that asked for each column, 0 if not built
+    std::vector<uint64_t> last_use;
+    // number of requests so far
+    uint64_t clock{0};
+    // number of entries of the built columns
+    size_t num_built{0};
+  };
+  LazyColumns lazy_;
+  // bytes of the row and of the column pages
+  common::TrackedBytes row_bytes_{common::kMemSparsePage};
+  common::TrackedBytes col_bytes_{common::kMemSparsePage};
 
   // internal function to make one batch from row iter.
-  void MakeOneBatch(
-    SparsePage *pcol, bool sorted);
+  template <typename PageT>
+  void MakeOneBatch(PageT *pcol, RowSetImpl<typename PageT::Index>* rowset, bool sorted);
+  // use the sorted column page loaded with a binary file, false if there is none
+  bool TakeSortedColumn(SparsePage *pcol);
+  // build the columns of fset that are not built yet
+  void BuildColumns(const std::vector<bst_uint>& fset);
+  // report the bytes of the pages to the memory tracker
+  void TrackMemory();
 };
 }  // namespace data
 }  // namespace xgboost
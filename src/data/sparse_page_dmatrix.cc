@@ -11,6 +11,7 @@
 
 #if DMLC_ENABLE_STD_THREAD
 #include "./sparse_page_dmatrix.h"
+#include "./sparse_page_source.h"
 #include "../common/random.h"
 #include "../common/common.h"
 #include "../common/group_data.h"
@@ -32,7 +33,7 @@ SparsePageDMatrix::ColPageIter::ColPageIter(
     formats_[i].reset(SparsePageFormat::Create(format));
     SparsePageFormat* fmt = formats_[i].get();
     size_t fbegin = fi->Tell();
-    prefetchers_[i].reset(new dmlc::ThreadedIter<SparsePage>(4));
+    prefetchers_[i].reset(new dmlc::ThreadedIter<SparsePage>(SparsePageSource::PrefetchDepth()));
     prefetchers_[i]->Init([this, fi, fmt] (SparsePage** dptr) {
         if (*dptr == nullptr) {
           *dptr = new SparsePage();
@@ -121,6 +122,9 @@ bool SparsePageDMatrix::TryInitColData(bool sorted) {
 void SparsePageDMatrix::InitColAccess(
   size_t max_row_perbatch, bool sorted) {
   if (HaveColAccess(sorted)) return;
+  CHECK(!this->WideRowIds())
+      << "the columns of external memory hold less than 2^32 rows, "
+      << "load the data in memory for more rows";
   if (TryInitColData(sorted)) return;
   const MetaInfo& info = this->Info();
   if (max_row_perbatch == std::numeric_limits<size_t>::max()) {
@@ -131,6 +135,8 @@ void SparsePageDMatrix::InitColAccess(
   std::fill(col_size_.begin(), col_size_.end(), 0);
   auto iter = this->RowIterator();
   size_t batch_ptr = 0, batch_top = 0;
+  // the MemCostBytes of a column batch, tuned by the writer
+  size_t page_size = kPageSize;
   SparsePage tmp;
 
   // function to create the page.
@@ -193,7 +199,7 @@ void SparsePageDMatrix::InitColAccess(
           tmp.Push(batch[i]);
 
           if (tmp.Size() >= max_row_perbatch ||
-              tmp.MemCostBytes() >= kPageSize) {
+              tmp.MemCostBytes() >= page_size) {
             make_col_batch(tmp, btop, dptr);
             batch_ptr = i + 1;
             return true;
@@ -241,6 +247,7 @@ void SparsePageDMatrix::InitColAccess(
       writer.PushWrite(std::move(page));
       writer.Alloc(&page);
       page->Clear();
+      page_size = writer.PageSize(kPageSize);
 
       double tdiff = dmlc::GetTime() - tstart;
       if (tdiff >= tick_expected) {
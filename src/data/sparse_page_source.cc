@@ -3,8 +3,10 @@
  * \file sparse_page_source.cc
  */
 #include <dmlc/base.h>
+#include <dmlc/parameter.h>
 #include <dmlc/timer.h>
 #include <xgboost/logging.h>
+#include <algorithm>
 #include <memory>
 
 #if DMLC_ENABLE_STD_THREAD
@@ -15,7 +17,7 @@ namespace xgboost {
 namespace data {
 
 SparsePageSource::SparsePageSource(const std::string& cache_info)
-    : base_rowid_(0), page_(nullptr), clock_ptr_(0) {
+    : base_rowid_(0), page_(nullptr), clock_ptr_(0), at_begin_(true) {
   // read in the info files
   std::vector<std::string> cache_shards = common::Split(cache_info, ':');
   CHECK_NE(cache_shards.size(), 0U);
@@ -40,7 +42,7 @@ SparsePageSource::SparsePageSource(const std::string& cache_info)
     formats_[i].reset(SparsePageFormat::Create(format));
     SparsePageFormat* fmt = formats_[i].get();
     size_t fbegin = fi->Tell();
-    prefetchers_[i].reset(new dmlc::ThreadedIter<SparsePage>(4));
+    prefetchers_[i].reset(new dmlc::ThreadedIter<SparsePage>(PrefetchDepth()));
     prefetchers_[i]->Init([fi, fmt] (SparsePage** dptr) {
         if (*dptr == nullptr) {
           *dptr = new SparsePage();
@@ -55,6 +57,7 @@ SparsePageSource::~SparsePageSource() {
 }
 
 bool SparsePageSource::Next() {
+  at_begin_ = false;
   // doing clock rotation over shards.
   if (page_ != nullptr) {
     size_t n = prefetchers_.size();
@@ -72,6 +75,10 @@ bool SparsePageSource::Next() {
 }
 
 void SparsePageSource::BeforeFirst() {
+  // the prefetchers already read from the first pages, restarting them would
+  // wait for the page being read and read it again
+  if (at_begin_) return;
+  at_begin_ = true;
   base_rowid_ = 0;
   clock_ptr_ = 0;
   for (auto& p : prefetchers_) {
@@ -79,6 +86,10 @@ void SparsePageSource::BeforeFirst() {
   }
 }
 
+int SparsePageSource::PrefetchDepth() {
+  return std::max(dmlc::GetEnv("XGBOOST_PAGE_PREFETCH", 4), 1);
+}
+
 const SparsePage& SparsePageSource::Value() const {
   return *page_;
 }
@@ -154,7 +165,7 @@ void SparsePageSource::Create(dmlc::Parser<uint32_t>* src,
                                 static_cast<uint64_t>(index + 1));
       }
       page->Push(batch);
-      if (page->MemCostBytes() >= kPageSize) {
+      if (page->MemCostBytes() >= writer.PageSize(kPageSize)) {
         bytes_write += page->MemCostBytes();
         writer.PushWrite(std::move(page));
         writer.Alloc(&page);
@@ -213,7 +224,7 @@ void SparsePageSource::Create(DMatrix* src,
 
     while (iter->Next()) {
       page->Push(iter->Value());
-      if (page->MemCostBytes() >= kPageSize) {
+      if (page->MemCostBytes() >= writer.PageSize(kPageSize)) {
         bytes_write += page->MemCostBytes();
         writer.PushWrite(std::move(page));
         writer.Alloc(&page);
@@ -59,6 +59,11 @@ class SparsePageSource : public DataSource {
    * \return Whether cache file already exists.
    */
   static bool CacheExist(const std::string& cache_info);
+  /*!
+   * \brief number of pages each cache file reads ahead of their use, from the
+   *  environment variable XGBOOST_PAGE_PREFETCH, default 4.
+   */
+  static int PrefetchDepth();
   /*! \brief page size 32 MB */
   static const size_t kPageSize = 32UL << 20UL;
   /*! \brief magic number used to identify Page */
@@ -71,6 +76,8 @@ class SparsePageSource : public DataSource {
   SparsePage *page_;
   /*! \brief internal clock ptr */
   size_t clock_ptr_;
+  /*! \brief whether no page was taken since the last BeforeFirst */
+  bool at_begin_;
   /*! \brief file pointer to the row blob file. */
   std::vector<std::unique_ptr<dmlc::SeekStream> > files_;
   /*! \brief Sparse page format file. */
@@ -5,7 +5,10 @@
  */
 #include <xgboost/base.h>
 #include <xgboost/logging.h>
+#include <dmlc/parameter.h>
+#include <algorithm>
 #include "./sparse_page_writer.h"
+#include "../common/io.h"
 
 #if DMLC_ENABLE_STD_THREAD
 namespace xgboost {
@@ -14,50 +17,83 @@ namespace data {
 SparsePageWriter::SparsePageWriter(
     const std::vector<std::string>& name_shards,
     const std::vector<std::string>& format_shards,
-    size_t extra_buffer_capacity)
-    : num_free_buffer_(extra_buffer_capacity + name_shards.size()),
-      clock_ptr_(0),
-      workers_(name_shards.size()),
+    size_t extra_buffer_capacity,
+    int nthread)
+    : clock_ptr_(0),
+      raw_bytes_(0),
+      encoded_bytes_(0),
       qworkers_(name_shards.size()) {
   CHECK_EQ(name_shards.size(), format_shards.size());
+  if (nthread <= 0) {
+    nthread = std::max(dmlc::GetEnv("XGBOOST_PAGE_WRITER_NTHREAD", 1), 1);
+  }
+  target_bytes_ = dmlc::GetEnv("XGBOOST_PAGE_TARGET_BYTES", static_cast<size_t>(0));
+  num_free_buffer_ = extra_buffer_capacity + name_shards.size() * nthread;
   // start writer threads
   for (size_t i = 0; i < name_shards.size(); ++i) {
-    std::string name_shard = name_shards[i];
     std::string format_shard = format_shards[i];
+    shards_.emplace_back(new Shard());
+    Shard* shard = shards_.back().get();
+    shard->name = name_shards[i];
+    shard->fo.reset(dmlc::Stream::Create(shard->name.c_str(), "w"));
+    shard->fo->Write(format_shard);
     auto* wqueue = &qworkers_[i];
-    workers_[i].reset(new std::thread(
-        [this, name_shard, format_shard, wqueue] () {
-          std::unique_ptr<dmlc::Stream> fo(
-              dmlc::Stream::Create(name_shard.c_str(), "w"));
-          std::unique_ptr<SparsePageFormat> fmt(
-              SparsePageFormat::Create(format_shard));
-          fo->Write(format_shard);
-          std::shared_ptr<SparsePage> page;
-          while (wqueue->Pop(&page)) {
-            if (page == nullptr) break;
-            fmt->Write(*page, fo.get());
-            qrecycle_.Push(std::move(page));
-          }
-          fo.reset(nullptr);
-          LOG(CONSOLE) << "SparsePage::Writer Finished writing to " << name_shard;
-        }));
+    for (int k = 0; k < nthread; ++k) {
+      workers_.emplace_back(new std::thread(
+          [this, format_shard, shard, wqueue] () {
+            std::unique_ptr<SparsePageFormat> fmt(
+                SparsePageFormat::Create(format_shard));
+            Job job;
+            while (wqueue->Pop(&job)) {
+              if (job.second == nullptr) break;
+              std::string buffer;
+              common::MemoryBufferStream fbuf(&buffer);
+              fmt->Write(*job.second, &fbuf);
+              raw_bytes_ += job.second->MemCostBytes();
+              encoded_bytes_ += buffer.length();
+              qrecycle_.Push(std::move(job.second));
+              // append after the pages pushed before it
+              std::unique_lock<std::mutex> lock(shard->mutex);
+              shard->cond.wait(lock, [shard, &job] { return shard->next_page == job.first; });
+              shard->fo->Write(dmlc::BeginPtr(buffer), buffer.length());
+              ++shard->next_page;
+              shard->cond.notify_all();
+            }
+          }));
+    }
   }
 }
 
 SparsePageWriter::~SparsePageWriter() {
   for (auto& queue : qworkers_) {
-    // use nullptr to signal termination.
-    std::shared_ptr<SparsePage> sig(nullptr);
-    queue.Push(std::move(sig));
+    // use nullptr to signal termination, once to each thread of the shard.
+    for (size_t k = 0; k < workers_.size() / qworkers_.size(); ++k) {
+      queue.Push(Job(0, nullptr));
+    }
   }
   for (auto& thread : workers_) {
     thread->join();
   }
+  for (auto& shard : shards_) {
+    shard->fo.reset(nullptr);
+    LOG(CONSOLE) << "SparsePage::Writer Finished writing to " << shard->name;
+  }
 }
 
 void SparsePageWriter::PushWrite(std::shared_ptr<SparsePage>&& page) {
-  qworkers_[clock_ptr_].Push(std::move(page));
-  clock_ptr_ = (clock_ptr_ + 1) % workers_.size();
+  Shard* shard = shards_[clock_ptr_].get();
+  qworkers_[clock_ptr_].Push(Job(shard->num_page++, std::move(page)));
+  clock_ptr_ = (clock_ptr_ + 1) % shards_.size();
+}
+
+size_t SparsePageWriter::PageSize(size_t page_size) const {
+  if (target_bytes_ == 0) return page_size;
+  const size_t encoded = encoded_bytes_;
+  if (encoded == 0) return target_bytes_;
+  // the compression ratio, bounded as the first pages may be unlike the rest
+  double ratio = static_cast<double>(raw_bytes_) / encoded;
+  ratio = std::min(std::max(ratio, 1.0), 16.0);
+  return static_cast<size_t>(target_bytes_ * ratio);
 }
 
 void SparsePageWriter::Alloc(std::shared_ptr<SparsePage>* out_page) {
@@ -18,6 +18,9 @@
 
 #if DMLC_ENABLE_STD_THREAD
 #include <dmlc/concurrency.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 #endif
 
@@ -67,6 +70,10 @@ class SparsePageFormat {
 #if DMLC_ENABLE_STD_THREAD
 /*!
  * \brief A threaded writer to write sparse batch page to sharded files.
+ *
+ *  The pages are striped over the shards in turn, and each shard encodes its
+ *  pages with nthread threads into memory, then appends them to its file in
+ *  the order they were pushed, which is the order the page sources read them.
  */
 class SparsePageWriter {
  public:
@@ -75,11 +82,14 @@ class SparsePageWriter {
    * \param name_shards name of shard files.
    * \param format_shards format of each shard.
    * \param extra_buffer_capacity Extra buffer capacity before block.
+   * \param nthread encoding threads of each shard, 0 to read it from the
+   *  environment variable XGBOOST_PAGE_WRITER_NTHREAD, default 1.
    */
   explicit SparsePageWriter(
       const std::vector<std::string>& name_shards,
       const std::vector<std::string>& format_shards,
-      size_t extra_buffer_capacity);
+      size_t extra_buffer_capacity,
+      int nthread = 0);
   /*! \brief destructor, will close the files automatically */
   ~SparsePageWriter();
   /*!
@@ -96,18 +106,44 @@ class SparsePageWriter {
    * \param out_page Used to store the allocated pages.
    */
   void Alloc(std::shared_ptr<SparsePage>* out_page);
+  /*!
+   * \brief the MemCostBytes at which to cut the next page. Without a target
+   *  set in XGBOOST_PAGE_TARGET_BYTES it is page_size, else the size expected
+   *  to encode into the target bytes from the pages written so far.
+   * \param page_size the page size of the caller
+   */
+  size_t PageSize(size_t page_size) const;
 
  private:
+  /*! \brief a page and its position among the pages of its shard */
+  using Job = std::pair<size_t, std::shared_ptr<SparsePage> >;
+  /*! \brief the output file of a shard, appended in page order */
+  struct Shard {
+    std::string name;
+    std::unique_ptr<dmlc::Stream> fo;
+    std::mutex mutex;
+    std::condition_variable cond;
+    /*! \brief the position of the next page to append */
+    size_t next_page{0};
+    /*! \brief number of pages pushed */
+    size_t num_page{0};
+  };
   /*! \brief number of allocated pages */
   size_t num_free_buffer_;
   /*! \brief clock_pointer */
   size_t clock_ptr_;
+  /*! \brief target encoded bytes of a page, 0 for fixed page sizes */
+  size_t target_bytes_;
+  /*! \brief MemCostBytes and encoded bytes of the pages written */
+  std::atomic<size_t> raw_bytes_, encoded_bytes_;
+  /*! \brief the shard files */
+  std::vector<std::unique_ptr<Shard> > shards_;
   /*! \brief writer threads */
   std::vector<std::unique_ptr<std::thread> > workers_;
   /*! \brief recycler queue */
   dmlc::ConcurrentBlockingQueue<std::shared_ptr<SparsePage> > qrecycle_;
-  /*! \brief worker threads */
-  std::vector<dmlc::ConcurrentBlockingQueue<std::shared_ptr<SparsePage> > > qworkers_;
+  /*! \brief job queue of each shard */
+  std::vector<dmlc::ConcurrentBlockingQueue<Job> > qworkers_;
 };
 #endif  // DMLC_ENABLE_STD_THREAD
 
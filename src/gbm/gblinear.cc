@@ -83,6 +83,7 @@ class GBLinear : public GradientBooster {
                ObjFunction* obj) override {
     monitor_.Start("DoBoost");
 
+    CHECK(!p_fmat->WideRowIds()) << "gblinear: 2^32 rows or more are not supported";
     if (!p_fmat->HaveColAccess(false)) {
       monitor_.Start("InitColAccess");
       std::vector<bool> enabled(p_fmat->Info().num_col_, true);
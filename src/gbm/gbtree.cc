@@ -16,12 +16,21 @@
 #include <utility>
 #include <string>
 #include <limits>
+#include <unordered_map>
 #include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <sstream>
 #include "../common/common.h"
 #include "../common/host_device_vector.h"
 #include "../common/random.h"
+#include "../common/sync.h"
 #include "gbtree_model.h"
+#include "./model_compactor.h"
 #include "../common/timer.h"
+#include "../data/shared_page_view.h"
+#include "../tree/param.h"
 
 namespace xgboost {
 namespace gbm {
@@ -48,6 +57,18 @@ struct GBTreeTrainParam : public dmlc::Parameter<GBTreeTrainParam> {
   // flag to print out detailed breakdown of runtime
   int debug_verbose;
   std::string predictor;
+  /*! \brief whether to grow the trees of the output groups of a round concurrently */
+  bool parallel_groups;
+  /*! \brief whether to grow the parallel trees of a group concurrently on bootstrap samples */
+  bool parallel_forest;
+  /*! \brief fraction of the rows with the largest gradients kept by GOSS, 0 for no GOSS */
+  float goss_top_rate;
+  /*! \brief fraction of the rows sampled by GOSS from the others */
+  float goss_other_rate;
+  /*! \brief whether to grow one tree of vector leaves for all output groups a round */
+  bool multi_output_tree;
+  /*! \brief whether to save the trees in the packed layout */
+  bool packed_model;
   // declare parameters
   DMLC_DECLARE_PARAMETER(GBTreeTrainParam) {
     DMLC_DECLARE_FIELD(num_parallel_tree)
@@ -73,6 +94,39 @@ struct GBTreeTrainParam : public dmlc::Parameter<GBTreeTrainParam> {
     DMLC_DECLARE_FIELD(predictor)
       .set_default("cpu_predictor")
       .describe("Predictor algorithm type");
+    DMLC_DECLARE_FIELD(parallel_groups)
+        .set_default(false)
+        .describe("Grow the trees of all output groups of a round concurrently, "\
+                  "splitting the threads between them. Only used on a single "\
+                  "machine with in-memory data.");
+    DMLC_DECLARE_FIELD(parallel_forest)
+        .set_default(false)
+        .describe("Grow the num_parallel_tree trees of a group concurrently, "\
+                  "splitting the threads between them, each tree on a bootstrap "\
+                  "sample of the rows drawn as Poisson weights of the gradients. "\
+                  "Only used on a single machine with in-memory data.");
+    DMLC_DECLARE_FIELD(goss_top_rate)
+        .set_range(0.0f, 1.0f)
+        .set_default(0.0f)
+        .describe("Gradient based one side sampling: each tree keeps this fraction "\
+                  "of the rows with the largest absolute gradients, and samples "\
+                  "goss_other_rate of the rows from the others, whose gradients are "\
+                  "scaled up to match. 0 means no GOSS.");
+    DMLC_DECLARE_FIELD(goss_other_rate)
+        .set_range(0.0f, 1.0f)
+        .set_default(0.1f)
+        .describe("Fraction of all the rows sampled by GOSS from the rows "\
+                  "without the largest gradients.");
+    DMLC_DECLARE_FIELD(multi_output_tree)
+        .set_default(false)
+        .describe("Grow one tree a round for all the output groups, whose leaves "\
+                  "keep a weight per group, instead of a tree per group. Only used "\
+                  "when the model has no trees yet.");
+    DMLC_DECLARE_FIELD(packed_model)
+        .set_default(false)
+        .describe("Save the trees in the packed layout, which a process predicting "\
+                  "with the cpu predictor loads without building the trees; they "\
+                  "are built when the model is trained further or inspected.");
   }
 };
 
@@ -142,23 +196,64 @@ class GBTree : public GradientBooster {
     cache_ = cache;
   }
 
+  bool IsCacheMatrix(const DMatrix* dmat) const override {
+    for (const std::shared_ptr<DMatrix>& d : cache_) {
+      if (d.get() == dmat) return true;
+    }
+    return false;
+  }
+
   void Configure(const std::vector<std::pair<std::string, std::string> >& cfg) override {
+    // the updaters keep their workspaces and the predictor its cache when
+    // the learner passes the configuration it passed last
+    if (predictor_ != nullptr && !configured_cfg_.empty() && cfg == configured_cfg_) return;
+    configured_cfg_ = cfg;
     this->cfg_ = cfg;
     model_.Configure(cfg);
     // initialize the updaters only when needed.
     std::string updater_seq = tparam_.updater_seq;
     tparam_.InitAllowUnknown(cfg);
-    if (updater_seq != tparam_.updater_seq) updaters_.clear();
+    if (tparam_.multi_output_tree && model_.param.num_trees == 0 &&
+        model_.param.num_output_group > 1) {
+      model_.param.size_leaf_vector = model_.param.num_output_group;
+    }
+    if (model_.param.size_leaf_vector != 0) {
+      this->ConfigureVectorLeaf();
+    }
+    this->ConfigureTreeParam();
+    if (updater_seq != tparam_.updater_seq) {
+      updaters_.clear();
+      group_updaters_.clear();
+      forest_updaters_.clear();
+    }
     for (const auto& up : updaters_) {
       up->Init(cfg);
     }
+    for (const auto& ups : group_updaters_) {
+      for (const auto& up : ups) {
+        up->Init(cfg);
+      }
+    }
+    if (forest_updaters_.size() != 0) {
+      const auto forest_cfg = this->ForestConfig();
+      for (const auto& ups : forest_updaters_) {
+        for (const auto& up : ups) {
+          up->Init(forest_cfg);
+        }
+      }
+    }
     // for the 'update' process_type, move trees into trees_to_update
     if (tparam_.process_type == kUpdate) {
       model_.InitTreesToUpdate();
     }
 
-    // configure predictor
-    predictor_ = std::unique_ptr<Predictor>(Predictor::Create(tparam_.predictor));
+    // configure predictor, a new one drops the cached predictions: only for
+    // another kind, or when the trees were moved to be updated
+    if (predictor_ == nullptr || predictor_name_ != tparam_.predictor ||
+        tparam_.process_type == kUpdate) {
+      predictor_ = std::unique_ptr<Predictor>(Predictor::Create(tparam_.predictor));
+      predictor_name_ = tparam_.predictor;
+    }
     predictor_->Init(cfg, cache_);
     monitor_.Init("GBTree", tparam_.debug_verbose);
   }
@@ -169,10 +264,28 @@ class GBTree : public GradientBooster {
     this->cfg_.clear();
     this->cfg_.emplace_back(std::string("num_feature"),
                                        common::ToString(model_.param.num_feature));
+    if (model_.param.size_leaf_vector != 0) {
+      this->cfg_.emplace_back(std::string("size_leaf_vector"),
+                              common::ToString(model_.param.size_leaf_vector));
+    }
+    this->ConfigureTreeParam();
+    configured_cfg_.clear();
   }
 
   void Save(dmlc::Stream* fo) const override {
-    model_.Save(fo);
+    if (tparam_.packed_model) {
+      model_.SavePacked(fo);
+    } else {
+      model_.Save(fo);
+    }
+  }
+
+  void SaveSegment(dmlc::Stream* fo, size_t tree_begin) const override {
+    model_.SaveSegment(fo, tree_begin);
+  }
+
+  void LoadSegment(dmlc::Stream* fi) override {
+    model_.LoadSegment(fi);
   }
 
   bool AllowLazyCheckPoint() const override {
@@ -186,10 +299,14 @@ class GBTree : public GradientBooster {
     std::vector<std::vector<std::unique_ptr<RegTree> > > new_trees;
     const int ngroup = model_.param.num_output_group;
     monitor_.Start("BoostNewTrees");
-    if (ngroup == 1) {
+    if (ngroup == 1 || model_.param.size_leaf_vector != 0) {
+      // a tree of vector leaves takes the gradients of all groups at once
       std::vector<std::unique_ptr<RegTree> > ret;
       BoostNewTrees(in_gpair, p_fmat, 0, &ret);
       new_trees.push_back(std::move(ret));
+    } else if (tparam_.parallel_groups && this->BoostGroupsConcurrently(in_gpair, p_fmat,
+                                                                        &new_trees)) {
+      // trees of all groups are grown
     } else {
       CHECK_EQ(in_gpair->Size() % ngroup, 0U)
           << "must have exactly ngroup*nrow gpairs";
@@ -218,13 +335,27 @@ class GBTree : public GradientBooster {
   void PredictBatch(DMatrix* p_fmat,
                HostDeviceVector<bst_float>* out_preds,
                unsigned ntree_limit) override {
+    // a model loaded in the packed layout is predicted from the packed arrays
+    // by the cpu predictor, the other predictions walk the trees
+    if (predictor_name_ != "cpu_predictor" || model_.param.size_leaf_vector != 0 ||
+        !model_.GetPackedForest().single_root || p_fmat->Info().root_index_.size() != 0) {
+      model_.MaterializeTrees();
+    }
     predictor_->PredictBatch(p_fmat, out_preds, model_, 0, ntree_limit);
   }
 
+  unsigned PredictStaged(DMatrix* p_fmat, std::vector<bst_float>* out_margins,
+                         unsigned stride, unsigned ntree_limit) override {
+    model_.MaterializeTrees();
+    predictor_->PredictStaged(p_fmat, out_margins, model_, stride, ntree_limit);
+    return Predictor::NumStages(model_, stride, ntree_limit);
+  }
+
   void PredictInstance(const SparsePage::Inst& inst,
                std::vector<bst_float>* out_preds,
                unsigned ntree_limit,
                unsigned root_index) override {
+    model_.MaterializeTrees();
     predictor_->PredictInstance(inst, out_preds, model_,
                                ntree_limit, root_index);
   }
@@ -232,19 +363,28 @@ class GBTree : public GradientBooster {
   void PredictLeaf(DMatrix* p_fmat,
                    std::vector<bst_float>* out_preds,
                    unsigned ntree_limit) override {
+    model_.MaterializeTrees();
     predictor_->PredictLeaf(p_fmat, out_preds, model_, ntree_limit);
   }
 
+  void PredictLeafCodes(DMatrix* p_fmat, unsigned ntree_limit, bool one_hot,
+                        LeafCodes* out_codes, void* out) override {
+    model_.InitLeafCodes(ntree_limit, one_hot, out_codes);
+    if (out != nullptr) predictor_->PredictLeafCodes(p_fmat, model_, *out_codes, out);
+  }
+
   void PredictContribution(DMatrix* p_fmat,
                            std::vector<bst_float>* out_contribs,
                            unsigned ntree_limit, bool approximate, int condition,
                            unsigned condition_feature) override {
+    model_.MaterializeTrees();
     predictor_->PredictContribution(p_fmat, out_contribs, model_, ntree_limit, approximate);
   }
 
   void PredictInteractionContributions(DMatrix* p_fmat,
                                        std::vector<bst_float>* out_contribs,
                                        unsigned ntree_limit, bool approximate) override {
+    model_.MaterializeTrees();
     predictor_->PredictInteractionContributions(p_fmat, out_contribs, model_,
                                                ntree_limit, approximate);
   }
@@ -255,25 +395,275 @@ class GBTree : public GradientBooster {
     return model_.DumpModel(fmap, with_stats, format);
   }
 
+  const GBTreeModel* GetTreeModel() const override {
+    model_.MaterializeTrees();
+    return &model_;
+  }
+
+  bool SetCachedMargin(DMatrix* dmat, const std::vector<bst_float>& margin) override {
+    model_.MaterializeTrees();
+    return predictor_->SetCachedPredictions(dmat, margin);
+  }
+
+  bool Compact(const std::vector<std::pair<std::string, std::string> >& cfg,
+               CompactStats* out_stats) override {
+    CompactParam param;
+    param.InitAllowUnknown(cfg);
+    model_.MaterializeTrees();
+    CompactModel(param, &model_, out_stats);
+    return true;
+  }
+
  protected:
   // initialize updater before using them
-  inline void InitUpdater() {
-    if (updaters_.size() != 0) return;
+  inline void InitUpdater(std::vector<std::unique_ptr<TreeUpdater> >* updaters) {
+    this->InitUpdater(updaters, this->cfg_);
+  }
+  inline void InitUpdater(std::vector<std::unique_ptr<TreeUpdater> >* updaters,
+                          const std::vector<std::pair<std::string, std::string> >& cfg) {
+    if (updaters->size() != 0) return;
     std::string tval = tparam_.updater_seq;
     std::vector<std::string> ups = common::Split(tval, ',');
     for (const std::string& pstr : ups) {
       std::unique_ptr<TreeUpdater> up(TreeUpdater::Create(pstr.c_str()));
-      up->Init(this->cfg_);
-      updaters_.push_back(std::move(up));
+      up->Init(cfg);
+      updaters->push_back(std::move(up));
     }
   }
+  // the configuration of the updaters of a concurrent forest: each of them
+  // grows one tree, so the learning rate is divided as the updaters divide
+  // it over the trees of one update
+  inline std::vector<std::pair<std::string, std::string> > ForestConfig() const {
+    tree::TrainParam param;
+    param.InitAllowUnknown(this->cfg_);
+    std::ostringstream os;
+    os << std::setprecision(std::numeric_limits<float>::max_digits10)
+       << param.learning_rate / tparam_.num_parallel_tree;
+    std::vector<std::pair<std::string, std::string> > cfg(this->cfg_);
+    cfg.emplace_back(std::string("learning_rate"), os.str());
+    return cfg;
+  }
+
+  /*!
+   * \brief grow the parallel trees of a group at once on bootstrap samples,
+   *  each tree with its own updaters and a view of the shared data pages, and
+   *  the threads split between the trees. A row gets a weight of Poisson(1)
+   *  in each tree that scales its gradient, rows of weight 0 are deleted.
+   * \return false if the matrix has several pages or training is distributed,
+   *  nothing is grown then
+   */
+  inline bool BoostForestConcurrently(HostDeviceVector<GradientPair>* gpair,
+                                      DMatrix* p_fmat,
+                                      std::vector<std::unique_ptr<RegTree> >* ret) {
+    const int ntree = tparam_.num_parallel_tree;
+    // the updaters synchronize through rabit, which is not thread safe
+    if (rabit::IsDistributed()) return false;
+    const SparsePage* row_page;
+    const SparsePage* col_page;
+    if (!data::SharedPageView::GetPages(p_fmat, &row_page, &col_page)) return false;
+    if (forest_updaters_.size() != static_cast<size_t>(ntree)) {
+      forest_updaters_.clear();
+      forest_updaters_.resize(ntree);
+    }
+    const auto forest_cfg = this->ForestConfig();
+    for (auto& ups : forest_updaters_) {
+      this->InitUpdater(&ups, forest_cfg);
+    }
+    // the views are kept across rounds, as updaters cache data per matrix
+    if (forest_views_.size() != static_cast<size_t>(ntree) ||
+        !forest_views_[0]->Views(p_fmat, row_page, col_page)) {
+      forest_views_.clear();
+      for (int i = 0; i < ntree; ++i) {
+        forest_views_.emplace_back(new data::SharedPageView(p_fmat, row_page, col_page));
+      }
+    }
+    // the samples are drawn in the order of the trees, the random state is
+    // shared; the gradients of all groups of a row of vector leaves share
+    // its weight
+    const std::vector<GradientPair>& gpair_h = gpair->HostVector();
+    const size_t nrow = p_fmat->Info().num_row_;
+    const size_t stride = nrow == 0 ? 1 : gpair_h.size() / nrow;
+    const GradientPair deleted(0.0f, -1.0f);
+    std::poisson_distribution<int> poisson(1.0);
+    auto& rnd = common::GlobalRandom();
+    std::vector<HostDeviceVector<GradientPair> > gpairs(ntree);
+    for (int i = 0; i < ntree; ++i) {
+      std::vector<GradientPair>& tmp_h = gpairs[i].HostVector();
+      tmp_h.resize(gpair_h.size());
+      for (size_t ridx = 0; ridx < nrow; ++ridx) {
+        const int weight = poisson(rnd);
+        const GradientPair* g = &gpair_h[ridx * stride];
+        const bool drop = weight == 0 || g[0].GetHess() < 0.0f;
+        for (size_t k = 0; k < stride; ++k) {
+          tmp_h[ridx * stride + k] = drop ? deleted
+              : GradientPair(g[k].GetGrad() * weight, g[k].GetHess() * weight);
+        }
+      }
+    }
+    ret->clear();
+    for (int i = 0; i < ntree; ++i) {
+      std::unique_ptr<RegTree> ptr(new RegTree());
+      ptr->param.InitAllowUnknown(this->cfg_);
+      ptr->InitModel();
+      ret->push_back(std::move(ptr));
+    }
+    // the updaters sample from the thread local random engine of the thread
+    // growing the tree, it is seeded per tree from the engine of this thread
+    std::vector<uint32_t> seeds(ntree + 1);
+    for (auto& seed : seeds) seed = static_cast<uint32_t>(rnd());
+    const int nthread = omp_get_max_threads();
+    const int nconcurrent = std::min(ntree, nthread);
+    const int nthread_tree = std::max(1, nthread / nconcurrent);
+#if defined(_OPENMP)
+    const int nested = omp_get_nested();
+    omp_set_nested(1);
+#endif
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(nconcurrent)
+    for (int i = 0; i < ntree; ++i) {
+      omp_set_num_threads(nthread_tree);
+      common::GlobalRandom().seed(seeds[i]);
+      std::vector<RegTree*> trees(1, (*ret)[i].get());
+      for (auto& up : forest_updaters_[i]) {
+        up->Update(&gpairs[i], forest_views_[i].get(), trees);
+      }
+    }
+#if defined(_OPENMP)
+    omp_set_nested(nested);
+#endif
+    // this thread may have grown some of the trees
+    rnd.seed(seeds[ntree]);
+    return true;
+  }
+
+  /*!
+   * \brief grow the trees of all output groups at once, each group with its
+   *  own updaters and a view of the shared data pages, and the threads split
+   *  between the groups. Groups whose trees finish early leave their thread
+   *  to the next group.
+   * \return false if the matrix has several pages or training is distributed,
+   *  nothing is grown then
+   */
+  inline bool BoostGroupsConcurrently(
+      HostDeviceVector<GradientPair>* in_gpair, DMatrix* p_fmat,
+      std::vector<std::vector<std::unique_ptr<RegTree> > >* new_trees) {
+    const int ngroup = model_.param.num_output_group;
+    // the updaters synchronize through rabit, which is not thread safe
+    if (rabit::IsDistributed()) return false;
+    const SparsePage* row_page;
+    const SparsePage* col_page;
+    if (!data::SharedPageView::GetPages(p_fmat, &row_page, &col_page)) return false;
+    // updaters of each group
+    if (group_updaters_.size() != static_cast<size_t>(ngroup)) {
+      group_updaters_.clear();
+      group_updaters_.resize(ngroup);
+    }
+    for (auto& ups : group_updaters_) {
+      this->InitUpdater(&ups);
+    }
+    // the views are kept across rounds, as updaters cache data per matrix
+    if (group_views_.size() != static_cast<size_t>(ngroup) ||
+        !group_views_[0]->Views(p_fmat, row_page, col_page)) {
+      group_views_.clear();
+      for (int gid = 0; gid < ngroup; ++gid) {
+        group_views_.emplace_back(new data::SharedPageView(p_fmat, row_page, col_page));
+      }
+    }
+    std::vector<HostDeviceVector<GradientPair> > gpairs(ngroup);
+    const std::vector<GradientPair>& gpair_h = in_gpair->HostVector();
+    const auto nsize = static_cast<bst_omp_uint>(gpair_h.size() / ngroup);
+    for (int gid = 0; gid < ngroup; ++gid) {
+      gpairs[gid].Resize(nsize, GradientPair());
+      std::vector<GradientPair>& tmp_h = gpairs[gid].HostVector();
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        tmp_h[i] = gpair_h[i * ngroup + gid];
+      }
+      // sampled in the order of the groups, the random state is shared
+      if (tparam_.goss_top_rate > 0.0f) {
+        std::vector<GradientPair> group_gpair;
+        group_gpair.swap(tmp_h);
+        this->GossSample(group_gpair, &tmp_h);
+      }
+    }
+    // the updaters sample from the thread local random engine of the thread
+    // growing the group, it is seeded per group from the engine of this thread
+    auto& rnd = common::GlobalRandom();
+    std::vector<uint32_t> seeds(ngroup + 1);
+    for (auto& seed : seeds) seed = static_cast<uint32_t>(rnd());
+    const int nthread = omp_get_max_threads();
+    const int nconcurrent = std::min(ngroup, nthread);
+    const int nthread_group = std::max(1, nthread / nconcurrent);
+    new_trees->resize(ngroup);
+#if defined(_OPENMP)
+    const int nested = omp_get_nested();
+    omp_set_nested(1);
+#endif
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(nconcurrent)
+    for (int gid = 0; gid < ngroup; ++gid) {
+      omp_set_num_threads(nthread_group);
+      common::GlobalRandom().seed(seeds[gid]);
+      this->GrowNewTrees(&gpairs[gid], group_views_[gid].get(), gid,
+                         &group_updaters_[gid], &(*new_trees)[gid]);
+    }
+#if defined(_OPENMP)
+    omp_set_nested(nested);
+#endif
+    // this thread may have grown some of the groups
+    rnd.seed(seeds[ngroup]);
+    return true;
+  }
 
   // do group specific group
   inline void BoostNewTrees(HostDeviceVector<GradientPair>* gpair,
                             DMatrix *p_fmat,
                             int bst_group,
                             std::vector<std::unique_ptr<RegTree> >* ret) {
-    this->InitUpdater();
+    this->InitUpdater(&updaters_);
+    // the rows left out by GOSS are deleted, as the updaters delete the rows
+    // of negative hessians
+    HostDeviceVector<GradientPair> sampled;
+    if (tparam_.goss_top_rate > 0.0f) {
+      this->GossSample(gpair->HostVector(), &sampled.HostVector());
+      gpair = &sampled;
+    }
+    if (tparam_.parallel_forest && tparam_.num_parallel_tree > 1 &&
+        tparam_.process_type == kDefault &&
+        this->BoostForestConcurrently(gpair, p_fmat, ret)) {
+      return;
+    }
+    this->GrowNewTrees(gpair, p_fmat, bst_group, &updaters_, ret);
+  }
+
+  // parse the parameters of the new trees from cfg_
+  inline void ConfigureTreeParam() {
+    tree_param_ = TreeParam();
+    tree_param_.InitAllowUnknown(this->cfg_);
+  }
+
+  // trees of vector leaves are grown by the vector colmaker, whatever the
+  // updaters of the tree method
+  inline void ConfigureVectorLeaf() {
+    CHECK_EQ(model_.param.size_leaf_vector, model_.param.num_output_group)
+        << "the leaf vectors must have a weight per output group";
+    CHECK_EQ(tparam_.goss_top_rate, 0.0f)
+        << "GOSS does not support trees of vector leaves";
+    const std::string seq = tparam_.updater_seq.find("robust") != std::string::npos
+        ? "robust_grow_vector_colmaker,prune" : "grow_vector_colmaker,prune";
+    if (tparam_.updater_seq != seq) {
+      LOG(INFO) << "updater " << tparam_.updater_seq << " is replaced by " << seq
+                << " for the trees of vector leaves";
+      tparam_.updater_seq = seq;
+    }
+    cfg_.emplace_back(std::string("size_leaf_vector"),
+                      common::ToString(model_.param.size_leaf_vector));
+  }
+
+  // create or fetch the trees of a group and run the updaters on them
+  inline void GrowNewTrees(HostDeviceVector<GradientPair>* gpair,
+                           DMatrix *p_fmat,
+                           int bst_group,
+                           std::vector<std::unique_ptr<TreeUpdater> >* updaters,
+                           std::vector<std::unique_ptr<RegTree> >* ret) {
     std::vector<RegTree*> new_trees;
     ret->clear();
     // create the trees
@@ -281,7 +671,7 @@ class GBTree : public GradientBooster {
       if (tparam_.process_type == kDefault) {
         // create new tree
         std::unique_ptr<RegTree> ptr(new RegTree());
-        ptr->param.InitAllowUnknown(this->cfg_);
+        ptr->param = tree_param_;
         ptr->InitModel();
         new_trees.push_back(ptr.get());
         ret->push_back(std::move(ptr));
@@ -295,16 +685,49 @@ class GBTree : public GradientBooster {
       }
     }
     // update the trees
-    for (auto& up : updaters_) {
+    for (auto& up : *updaters) {
       up->Update(gpair, p_fmat, new_trees);
-}
+    }
+  }
+
+  // keep the rows of the goss_top_rate largest absolute gradients, and a
+  // sample of goss_other_rate of all the rows from the others; the gradients
+  // of the sample are scaled so that their sums estimate those of the others
+  inline void GossSample(const std::vector<GradientPair>& gpair,
+                         std::vector<GradientPair>* out) const {
+    const float top_rate = tparam_.goss_top_rate;
+    const float other_rate = tparam_.goss_other_rate;
+    CHECK_LE(top_rate + other_rate, 1.0f)
+        << "goss_top_rate + goss_other_rate must not exceed 1";
+    const GradientPair deleted(0.0f, -1.0f);
+    out->assign(gpair.size(), deleted);
+    std::vector<size_t> rows;
+    for (size_t i = 0; i < gpair.size(); ++i) {
+      if (gpair[i].GetHess() >= 0.0f) rows.push_back(i);
+    }
+    const auto ntop = std::min(rows.size(),
+                               static_cast<size_t>(std::ceil(top_rate * rows.size())));
+    std::nth_element(rows.begin(), rows.begin() + ntop, rows.end(), [&](size_t a, size_t b) {
+      return std::abs(gpair[a].GetGrad()) > std::abs(gpair[b].GetGrad());
+    });
+    for (size_t k = 0; k < ntop; ++k) (*out)[rows[k]] = gpair[rows[k]];
+    if (top_rate >= 1.0f || other_rate <= 0.0f) return;
+    // the rest is sampled with the order of the rows, to keep it reproducible
+    std::sort(rows.begin() + ntop, rows.end());
+    std::bernoulli_distribution coin_flip(other_rate / (1.0f - top_rate));
+    const float scale = (1.0f - top_rate) / other_rate;
+    auto& rnd = common::GlobalRandom();
+    for (size_t k = ntop; k < rows.size(); ++k) {
+      const GradientPair& g = gpair[rows[k]];
+      if (coin_flip(rnd)) (*out)[rows[k]] = GradientPair(g.GetGrad() * scale, g.GetHess() * scale);
+    }
   }
 
   // commit new trees all at once
   virtual void
   CommitModel(std::vector<std::vector<std::unique_ptr<RegTree>>>&& new_trees) {
     int num_new_trees = 0;
-    for (int gid = 0; gid < model_.param.num_output_group; ++gid) {
+    for (int gid = 0; gid < static_cast<int>(new_trees.size()); ++gid) {
       num_new_trees += new_trees[gid].size();
       model_.CommitModel(std::move(new_trees[gid]), gid);
     }
@@ -318,11 +741,23 @@ class GBTree : public GradientBooster {
   // ----training fields----
   // configurations for tree
   std::vector<std::pair<std::string, std::string> > cfg_;
+  // the configuration of the last Configure, empty after Load
+  std::vector<std::pair<std::string, std::string> > configured_cfg_;
+  // parameters of the new trees, parsed from cfg_ once
+  TreeParam tree_param_;
   // the updaters that can be applied to each of tree
   std::vector<std::unique_ptr<TreeUpdater>> updaters_;
+  // updaters of each output group, used when the groups are grown concurrently
+  std::vector<std::vector<std::unique_ptr<TreeUpdater>>> group_updaters_;
+  // views of the training matrix of each output group
+  std::vector<std::unique_ptr<data::SharedPageView>> group_views_;
+  // updaters and views of the matrix of each tree of a concurrent forest
+  std::vector<std::vector<std::unique_ptr<TreeUpdater>>> forest_updaters_;
+  std::vector<std::unique_ptr<data::SharedPageView>> forest_views_;
   // Cached matrices
   std::vector<std::shared_ptr<DMatrix>> cache_;
   std::unique_ptr<Predictor> predictor_;
+  std::string predictor_name_;
   common::Monitor monitor_;
 };
 
@@ -333,13 +768,34 @@ class Dart : public GBTree {
 
   void Configure(const std::vector<std::pair<std::string, std::string> >& cfg) override {
     GBTree::Configure(cfg);
+    CHECK_EQ(model_.param.size_leaf_vector, 0)
+        << "dart does not support trees of vector leaves";
     if (model_.trees.size() == 0) {
       dparam_.InitAllowUnknown(cfg);
     }
   }
 
+  // the trees are scaled by weight_drop_
+  const GBTreeModel* GetTreeModel() const override {
+    return nullptr;
+  }
+
+  // the predictions drop trees, they are not served from the cache
+  bool SetCachedMargin(DMatrix* dmat, const std::vector<bst_float>& margin) override {
+    return false;
+  }
+
+  // weight_drop_ is indexed by the position of the trees
+  bool Compact(const std::vector<std::pair<std::string, std::string> >& cfg,
+               CompactStats* out_stats) override {
+    return false;
+  }
+
   void Load(dmlc::Stream* fi) override {
     GBTree::Load(fi);
+    // the predictions of dart scale the trees by their weights
+    model_.MaterializeTrees();
+    margin_cache_.clear();
     weight_drop_.resize(model_.param.num_trees);
     if (model_.param.num_trees != 0) {
       fi->Read(&weight_drop_);
@@ -353,12 +809,45 @@ class Dart : public GBTree {
     }
   }
 
+  void SaveSegment(dmlc::Stream* fo, size_t tree_begin) const override {
+    LOG(FATAL) << "model segments are not supported by dart, its tree weights change";
+  }
+
+  unsigned PredictStaged(DMatrix* p_fmat, std::vector<bst_float>* out_margins,
+                         unsigned stride, unsigned ntree_limit) override {
+    LOG(FATAL) << "staged prediction is not supported by dart, its tree weights change";
+    return 0;
+  }
+
+  void LoadSegment(dmlc::Stream* fi) override {
+    LOG(FATAL) << "model segments are not supported by dart, its tree weights change";
+  }
+
   // predict the leaf scores with dropout if ntree_limit = 0
   void PredictBatch(DMatrix* p_fmat,
                     HostDeviceVector<bst_float>* out_preds,
                     unsigned ntree_limit) override {
     DropTrees(ntree_limit);
-    PredLoopInternal<Dart>(p_fmat, &out_preds->HostVector(), 0, ntree_limit, true);
+    MarginCacheEntry* entry = ntree_limit == 0 ? this->FindMarginCache(p_fmat) : nullptr;
+    if (entry == nullptr) {
+      PredLoopInternal<Dart>(p_fmat, &out_preds->HostVector(), 0, ntree_limit, true);
+      return;
+    }
+    // the cached sum of all trees, less the dropped trees
+    this->UpdateMarginCache(p_fmat, entry);
+    this->ComputeDropMargin(p_fmat, entry);
+    std::vector<bst_float>& preds = out_preds->HostVector();
+    const std::vector<bst_float>& base_margin = p_fmat->Info().base_margin_;
+    preds.resize(entry->margin.size());
+    if (base_margin.size() != 0) {
+      CHECK_EQ(base_margin.size(), preds.size());
+      std::copy(base_margin.begin(), base_margin.end(), preds.begin());
+    } else {
+      std::fill(preds.begin(), preds.end(), model_.base_margin);
+    }
+    for (size_t i = 0; i < preds.size(); ++i) {
+      preds[i] += static_cast<bst_float>(entry->margin[i] - entry->drop_margin[i]);
+    }
   }
 
   void PredictInstance(const SparsePage::Inst& inst,
@@ -385,6 +874,16 @@ class Dart : public GBTree {
 
  protected:
   friend class GBTree;
+  // margins of a matrix of cache_ without the base margin, so a prediction
+  // only walks the new and the dropped trees
+  struct MarginCacheEntry {
+    // weighted leaf values of the first num_tree trees, summed per row and group
+    std::vector<double> margin;
+    size_t num_tree{0};
+    // the share of the trees dropped by the DropTrees call of drop_version
+    std::vector<double> drop_margin;
+    uint64_t drop_version{0};
+  };
   // internal prediction loop
   // add predictions to out_preds
   template<typename Derived>
@@ -485,7 +984,7 @@ class Dart : public GBTree {
   void
   CommitModel(std::vector<std::vector<std::unique_ptr<RegTree>>>&& new_trees) override {
     int num_new_trees = 0;
-    for (int gid = 0; gid < model_.param.num_output_group; ++gid) {
+    for (int gid = 0; gid < static_cast<int>(new_trees.size()); ++gid) {
       num_new_trees += new_trees[gid].size();
       model_.CommitModel(std::move(new_trees[gid]), gid);
     }
@@ -521,6 +1020,7 @@ class Dart : public GBTree {
   // select which trees to drop
   inline void DropTrees(unsigned ntree_limit_drop) {
     idx_drop_.clear();
+    ++drop_version_;
     if (ntree_limit_drop > 0) return;
 
     std::uniform_real_distribution<> runif(0.0, 1.0);
@@ -576,6 +1076,7 @@ class Dart : public GBTree {
       if (dparam_.normalize_type == 1) {
         // normalize_type 1
         float factor = 1.0 / (1.0 + lr);
+        this->ScaleCachedDrop(factor);
         for (auto i : idx_drop_) {
           weight_drop_[i] *= factor;
         }
@@ -585,6 +1086,7 @@ class Dart : public GBTree {
       } else {
         // normalize_type 0
         float factor = 1.0 * num_drop / (num_drop + lr);
+        this->ScaleCachedDrop(factor);
         for (auto i : idx_drop_) {
           weight_drop_[i] *= factor;
         }
@@ -598,6 +1100,79 @@ class Dart : public GBTree {
     return num_drop;
   }
 
+  // the margin cache of a matrix registered at construction, nullptr for others
+  inline MarginCacheEntry* FindMarginCache(DMatrix* p_fmat) {
+    for (const std::shared_ptr<DMatrix>& d : cache_) {
+      if (d.get() == p_fmat) return &margin_cache_[p_fmat];
+    }
+    return nullptr;
+  }
+  // add the trees committed since the last call to the cached margins
+  inline void UpdateMarginCache(DMatrix* p_fmat, MarginCacheEntry* entry) {
+    const size_t size = p_fmat->Info().num_row_ * model_.param.num_output_group;
+    if (entry->margin.size() != size) {
+      entry->margin.assign(size, 0.0);
+      entry->num_tree = 0;
+    }
+    std::vector<size_t> trees;
+    for (size_t i = entry->num_tree; i < model_.trees.size(); ++i) trees.push_back(i);
+    this->AccumulateTrees(p_fmat, trees, &entry->margin);
+    entry->num_tree = model_.trees.size();
+  }
+  // the share of the dropped trees in the cached margins
+  inline void ComputeDropMargin(DMatrix* p_fmat, MarginCacheEntry* entry) {
+    std::vector<size_t> trees;
+    for (size_t i : idx_drop_) {
+      if (i < entry->num_tree) trees.push_back(i);
+    }
+    entry->drop_margin.assign(entry->margin.size(), 0.0);
+    this->AccumulateTrees(p_fmat, trees, &entry->drop_margin);
+    entry->drop_version = drop_version_;
+  }
+  // the dropped trees are about to be scaled by factor, so is their share
+  // of the cached margins
+  inline void ScaleCachedDrop(float factor) {
+    for (auto& kv : margin_cache_) {
+      MarginCacheEntry& entry = kv.second;
+      if (entry.num_tree == 0) continue;
+      if (entry.drop_version != drop_version_) this->ComputeDropMargin(kv.first, &entry);
+      for (size_t i = 0; i < entry.margin.size(); ++i) {
+        entry.margin[i] += (factor - 1.0) * entry.drop_margin[i];
+      }
+      // the share is stale once the weights are scaled
+      entry.drop_version = 0;
+    }
+  }
+  // add the weighted leaf values of trees to the margins of the rows of p_fmat
+  inline void AccumulateTrees(DMatrix* p_fmat, const std::vector<size_t>& trees,
+                              std::vector<double>* out_margin) {
+    if (trees.size() == 0) return;
+    const MetaInfo& info = p_fmat->Info();
+    const int num_group = model_.param.num_output_group;
+    InitThreadTemp(omp_get_max_threads());
+    auto iter = p_fmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      auto batch = iter->Value();
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nsize; ++i) {
+        RegTree::FVec& feats = thread_temp_[omp_get_thread_num()];
+        const auto ridx = static_cast<size_t>(batch.base_rowid + i);
+        const SparsePage::Inst inst = batch[i];
+        const unsigned root_index = info.GetRoot(ridx);
+        double* margin = dmlc::BeginPtr(*out_margin) + ridx * num_group;
+        feats.Fill(inst);
+        for (size_t t : trees) {
+          const RegTree& tree = *model_.trees[t];
+          const int tid = tree.GetLeafIndex(feats, root_index);
+          margin[model_.tree_info[t]] += weight_drop_[t] * tree[tid].LeafValue();
+        }
+        feats.Drop(inst);
+      }
+    }
+  }
+
   // init thread buffers
   inline void InitThreadTemp(int nthread) {
     int prev_thread_temp_size = thread_temp_.size();
@@ -618,6 +1193,9 @@ class Dart : public GBTree {
   std::vector<size_t> idx_drop_;
   // temporal storage for per thread
   std::vector<RegTree::FVec> thread_temp_;
+  std::unordered_map<DMatrix*, MarginCacheEntry> margin_cache_;
+  // counts the DropTrees calls, from 1 on
+  uint64_t drop_version_{0};
 };
 
 // register the objective functions
@@ -636,6 +1214,7 @@ XGBOOST_REGISTER_GBM(Dart, "dart")
 .describe("Tree booster, dart.")
 .set_body([](const std::vector<std::shared_ptr<DMatrix> >& cached_mats, bst_float base_margin) {
     GBTree* p = new Dart(base_margin);
+    p->InitCache(cached_mats);
     return p;
   });
 }  // namespace gbm
@@ -2,12 +2,18 @@
  * Copyright by Contributors 2017
  */
 #pragma once
+#include <dmlc/omp.h>
 #include <dmlc/parameter.h>
 #include <dmlc/io.h>
 #include <xgboost/tree_model.h>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <utility>
 #include <string>
 #include <vector>
+#include "../common/io.h"
 
 namespace xgboost {
 namespace gbm {
@@ -31,12 +37,14 @@ struct GBTreeModelParam : public dmlc::Parameter<GBTreeModelParam> {
   int num_output_group;
   /*! \brief size of leaf vector needed in tree */
   int size_leaf_vector;
+  /*! \brief 1 if the trees follow in the packed layout of GBTreeModel::SavePacked */
+  int packed_layout;
   /*! \brief reserved parameters */
-  int reserved[32];
+  int reserved[31];
   /*! \brief constructor */
   GBTreeModelParam() {
     std::memset(this, 0, sizeof(GBTreeModelParam));
-    static_assert(sizeof(GBTreeModelParam) == (4 + 2 + 2 + 32) * sizeof(int),
+    static_assert(sizeof(GBTreeModelParam) == (4 + 2 + 3 + 31) * sizeof(int),
                   "64/32 bit compatibility issue");
   }
   // declare parameters, only declare those that need to be set.
@@ -55,7 +63,277 @@ struct GBTreeModelParam : public dmlc::Parameter<GBTreeModelParam> {
     DMLC_DECLARE_FIELD(size_leaf_vector)
         .set_lower_bound(0)
         .set_default(0)
-        .describe("Reserved option for vector tree.");
+        .describe("Size of the leaf vectors of the trees, the number of output "
+                  "groups for multi output trees and 0 otherwise.");
+  }
+};
+
+/*!
+ * \brief split thresholds of every feature over the trees of a model, in CSR
+ *  layout. Used by robustness verification and attacks, which otherwise have
+ *  to scan all trees for the thresholds of a feature.
+ */
+struct FeatureThresholdIndex {
+  /*! \brief thresholds of feature f are [feature_ptr[f], feature_ptr[f + 1]) */
+  std::vector<bst_ulong> feature_ptr;
+  /*! \brief sorted unique thresholds of each feature */
+  std::vector<bst_float> thresholds;
+  /*! \brief nodes of threshold i are [node_ptr[i], node_ptr[i + 1]) */
+  std::vector<bst_ulong> node_ptr;
+  /*! \brief (tree, node) pairs splitting on each threshold */
+  std::vector<std::pair<bst_uint, bst_uint> > nodes;
+  /*! \brief number of trees indexed */
+  size_t num_trees{0};
+
+  void Build(const std::vector<std::unique_ptr<RegTree> >& trees, int num_feature) {
+    struct Split {
+      bst_uint fid;
+      bst_float cond;
+      bst_uint tree, nid;
+    };
+    std::vector<Split> splits;
+    size_t nfeature = static_cast<size_t>(num_feature);
+    for (size_t t = 0; t < trees.size(); ++t) {
+      const std::vector<RegTree::Node>& tnodes = trees[t]->GetNodes();
+      for (size_t nid = 0; nid < tnodes.size(); ++nid) {
+        const RegTree::Node& node = tnodes[nid];
+        if (node.IsLeaf() || node.IsDeleted()) continue;
+        splits.push_back({node.SplitIndex(), node.SplitCond(),
+                          static_cast<bst_uint>(t), static_cast<bst_uint>(nid)});
+        nfeature = std::max(nfeature, static_cast<size_t>(node.SplitIndex()) + 1);
+      }
+    }
+    std::sort(splits.begin(), splits.end(), [](const Split& a, const Split& b) {
+        if (a.fid != b.fid) return a.fid < b.fid;
+        if (a.cond != b.cond) return a.cond < b.cond;
+        return a.tree != b.tree ? a.tree < b.tree : a.nid < b.nid;
+      });
+    feature_ptr.assign(nfeature + 1, 0);
+    thresholds.clear();
+    node_ptr.assign(1, 0);
+    nodes.clear();
+    for (size_t i = 0; i < splits.size(); ++i) {
+      if (i == 0 || splits[i].fid != splits[i - 1].fid ||
+          splits[i].cond != splits[i - 1].cond) {
+        if (i != 0) node_ptr.push_back(nodes.size());
+        thresholds.push_back(splits[i].cond);
+        ++feature_ptr[splits[i].fid + 1];
+      }
+      nodes.emplace_back(splits[i].tree, splits[i].nid);
+    }
+    if (splits.size() != 0) node_ptr.push_back(nodes.size());
+    for (size_t f = 0; f < nfeature; ++f) feature_ptr[f + 1] += feature_ptr[f];
+    num_trees = trees.size();
+  }
+  /*! \return number of features in the index */
+  inline size_t NumFeature() const {
+    return feature_ptr.size() != 0 ? feature_ptr.size() - 1 : 0;
+  }
+  /*! \return pointer to the first threshold of feature fid */
+  inline const bst_float* FeatureBegin(size_t fid) const {
+    return dmlc::BeginPtr(thresholds) + feature_ptr[fid];
+  }
+  /*! \return pointer after the last threshold of feature fid */
+  inline const bst_float* FeatureEnd(size_t fid) const {
+    return dmlc::BeginPtr(thresholds) + feature_ptr[fid + 1];
+  }
+};
+
+/*!
+ * \brief node arrays of all trees of a model, the nodes of tree t are
+ *  [tree_ptr[t], tree_ptr[t + 1]) and indexed by their node id.
+ */
+struct FlatTreeArrays {
+  std::vector<bst_ulong> tree_ptr;
+  /*! \brief output group of each tree */
+  std::vector<int> tree_group;
+  /*! \brief split feature, -1 for leaves and deleted nodes */
+  std::vector<int> split_index;
+  std::vector<bst_float> split_cond;
+  /*! \brief children node ids, -1 for leaves */
+  std::vector<int> left_child;
+  std::vector<int> right_child;
+  std::vector<int> default_left;
+  /*! \brief leaf value, 0 for split nodes */
+  std::vector<bst_float> leaf_value;
+  /*! \brief sum of hessian of the node */
+  std::vector<bst_float> cover;
+};
+
+/*!
+ * \brief the split statistics of each feature summed over the trees of a
+ *  model, the gain and cover importance of the dumps without a dump.
+ */
+struct FeatureImportance {
+  /*! \brief sum of the loss change of the splits of each feature */
+  std::vector<double> gain;
+  /*! \brief sum of the hessian of the data reaching the splits */
+  std::vector<double> cover;
+  /*! \brief number of splits */
+  std::vector<bst_ulong> count;
+
+  /*! \brief add the splits of a tree */
+  inline void Add(const RegTree& tree) {
+    const std::vector<RegTree::Node>& nodes = tree.GetNodes();
+    for (size_t nid = 0; nid < nodes.size(); ++nid) {
+      const RegTree::Node& node = nodes[nid];
+      if (node.IsLeaf() || node.IsDeleted()) continue;
+      const size_t fid = node.SplitIndex();
+      if (fid >= count.size()) this->Resize(fid + 1);
+      const RTreeNodeStat& stat = tree.Stat(static_cast<int>(nid));
+      gain[fid] += stat.loss_chg;
+      cover[fid] += stat.sum_hess;
+      ++count[fid];
+    }
+  }
+  /*! \brief sum the splits of all the trees again */
+  inline void Build(const std::vector<std::unique_ptr<RegTree> >& trees) {
+    this->Clear();
+    for (const auto& tree : trees) this->Add(*tree);
+  }
+  inline void Resize(size_t nfeature) {
+    gain.resize(nfeature, 0.0);
+    cover.resize(nfeature, 0.0);
+    count.resize(nfeature, 0);
+  }
+  inline void Clear() {
+    gain.clear();
+    cover.clear();
+    count.clear();
+  }
+};
+
+/*!
+ * \brief integer codes of the leaves of the first num_tree trees of a model,
+ *  for the leaf prediction into integers. The code of a leaf is its node id,
+ *  or with one_hot its column in a one-hot encoding of the leaves of all the
+ *  trees, where the leaves of a tree take consecutive columns in node order.
+ */
+struct LeafCodes {
+  bool one_hot{false};
+  unsigned num_tree{0};
+  /*! \brief bytes of a code, 2 when every code fits in uint16_t and 4 otherwise */
+  int index_size{4};
+  /*! \brief number of codes: the largest node count of a tree, or the number of columns */
+  size_t num_code{0};
+  /*! \brief column of each node for one_hot, the nodes of tree t start at node_ptr[t] */
+  std::vector<uint32_t> column;
+  std::vector<size_t> node_ptr;
+
+  /*! \return the code of leaf nid of tree t */
+  inline uint32_t Code(unsigned t, int nid) const {
+    return one_hot ? column[node_ptr[t] + nid] : static_cast<uint32_t>(nid);
+  }
+};
+
+/*!
+ * \brief the trees of a model packed for prediction. The split nodes of a
+ *  tree are numbered in breadth first order, so the nodes of a level are
+ *  contiguous, and kept as arrays of split feature, threshold and children.
+ *  A child reference c >= 0 is split node c, and c < 0 is leaf_value[~c].
+ */
+struct PackedForest {
+  /*! \brief split feature, the highest bit is set if missing values go left */
+  std::vector<bst_uint> split_index;
+  std::vector<bst_float> split_cond;
+  /*! \brief left and right child references of node i are children[2i], children[2i + 1] */
+  std::vector<int> children;
+  std::vector<bst_float> leaf_value;
+  /*! \brief reference of root 0 of each tree */
+  std::vector<int> tree_root;
+  /*! \brief the packed trees, a replaced tree repacks all of them */
+  std::vector<const RegTree*> source;
+  /*! \brief whether every packed tree has a single root */
+  bool single_root{true};
+
+  /*! \brief pack the trees added since the last update */
+  void Update(const std::vector<std::unique_ptr<RegTree> >& trees) {
+    bool valid = source.size() <= trees.size();
+    for (size_t t = 0; valid && t < source.size(); ++t) {
+      valid = source[t] == trees[t].get();
+    }
+    if (!valid) this->Clear();
+    for (size_t t = source.size(); t < trees.size(); ++t) {
+      this->Append(*trees[t]);
+    }
+  }
+  void Clear() {
+    split_index.clear();
+    split_cond.clear();
+    children.clear();
+    leaf_value.clear();
+    tree_root.clear();
+    source.clear();
+    single_root = true;
+  }
+  /*! \return the child reference of split node ref taken by the row */
+  inline int Next(int ref, const RegTree::FVec& feat) const {
+    const bst_uint sindex = split_index[ref];
+    const bst_uint fid = sindex & ((1U << 31) - 1U);
+    const bool left = feat.IsMissing(fid)
+        ? (sindex >> 31) != 0 : feat.Fvalue(fid) < split_cond[ref];
+    return children[2 * ref + (left ? 0 : 1)];
+  }
+  /*! \return the leaf value of tree t for the row */
+  inline bst_float Predict(size_t t, const RegTree::FVec& feat) const {
+    int ref = tree_root[t];
+    while (ref >= 0) ref = this->Next(ref, feat);
+    return leaf_value[~ref];
+  }
+  /*! \brief most rows PredictBlock walks together */
+  static constexpr int kMaxBlockRows = 8;
+  /*!
+   * \brief add the leaf values of the trees [tree_begin, tree_end) to the
+   *  margins of nrow <= kMaxBlockRows rows, out[k * num_group + group]. The
+   *  rows walk each tree in lockstep, so the independent node loads of the
+   *  rows overlap instead of one row at a time.
+   */
+  inline void PredictBlock(const std::vector<int>& tree_info, const RegTree::FVec* feats,
+                           int nrow, int num_group, unsigned tree_begin, unsigned tree_end,
+                           bst_float* out) const {
+    int ref[kMaxBlockRows];
+    for (unsigned t = tree_begin; t < tree_end; ++t) {
+      for (int k = 0; k < nrow; ++k) ref[k] = tree_root[t];
+      bool active = tree_root[t] >= 0;
+      while (active) {
+        active = false;
+        for (int k = 0; k < nrow; ++k) {
+          if (ref[k] < 0) continue;
+          ref[k] = this->Next(ref[k], feats[k]);
+          active = active || ref[k] >= 0;
+        }
+      }
+      for (int k = 0; k < nrow; ++k) {
+        out[k * num_group + tree_info[t]] += leaf_value[~ref[k]];
+      }
+    }
+  }
+
+ private:
+  void Append(const RegTree& tree) {
+    if (tree.param.num_roots != 1) single_root = false;
+    const int base = static_cast<int>(split_cond.size());
+    // split nodes of the tree in breadth first order
+    std::vector<int> order;
+    auto reference = [&](int nid) {
+      if (tree[nid].IsLeaf()) {
+        leaf_value.push_back(tree[nid].LeafValue());
+        return ~static_cast<int>(leaf_value.size() - 1);
+      }
+      order.push_back(nid);
+      return base + static_cast<int>(order.size() - 1);
+    };
+    tree_root.push_back(reference(0));
+    for (size_t i = 0; i < order.size(); ++i) {
+      const RegTree::Node& node = tree[order[i]];
+      split_index.push_back(node.SplitIndex() | (node.DefaultLeft() ? (1U << 31) : 0U));
+      split_cond.push_back(node.SplitCond());
+      const int left = reference(node.LeftChild());
+      const int right = reference(node.RightChild());
+      children.push_back(left);
+      children.push_back(right);
+    }
+    source.push_back(&tree);
   }
 };
 
@@ -63,12 +341,13 @@ struct GBTreeModel {
   explicit GBTreeModel(bst_float base_margin) : base_margin(base_margin) {}
   void Configure(const std::vector<std::pair<std::string, std::string> >& cfg) {
     // initialize model parameters if not yet been initialized.
-    if (trees.size() == 0) {
+    if (param.num_trees == 0) {
       param.InitAllowUnknown(cfg);
     }
   }
 
   void InitTreesToUpdate() {
+    this->MaterializeTrees();
     if (trees_to_update.size() == 0u) {
       for (auto & tree : trees) {
         trees_to_update.push_back(std::move(tree));
@@ -76,6 +355,9 @@ struct GBTreeModel {
       trees.clear();
       param.num_trees = 0;
       tree_info.clear();
+      threshold_index_.feature_ptr.clear();
+      packed_forest_.Clear();
+      importance_.Clear();
     }
   }
 
@@ -84,6 +366,12 @@ struct GBTreeModel {
         << "GBTree: invalid model file";
     trees.clear();
     trees_to_update.clear();
+    tree_records_.clear();
+    if (param.packed_layout != 0) {
+      this->LoadPacked(fi);
+      return;
+    }
+    trees.reserve(param.num_trees);
     for (int i = 0; i < param.num_trees; ++i) {
       std::unique_ptr<RegTree> ptr(new RegTree());
       ptr->Load(fi);
@@ -95,11 +383,19 @@ struct GBTreeModel {
           fi->Read(dmlc::BeginPtr(tree_info), sizeof(int) * param.num_trees),
           sizeof(int) * param.num_trees);
     }
+    // the index is only needed by robustness verification and attacks, it is
+    // built on their first use rather than on every model load
+    threshold_index_.feature_ptr.clear();
+    packed_forest_.Clear();
+    importance_.Build(trees);
   }
 
   void Save(dmlc::Stream* fo) const {
+    this->MaterializeTrees();
     CHECK_EQ(param.num_trees, static_cast<int>(trees.size()));
-    fo->Write(&param, sizeof(param));
+    GBTreeModelParam saved = param;
+    saved.packed_layout = 0;
+    fo->Write(&saved, sizeof(saved));
     for (const auto & tree : trees) {
       tree->Save(fo);
     }
@@ -108,33 +404,325 @@ struct GBTreeModel {
     }
   }
 
+  /*!
+   * \brief save the trees from begin on, a segment appended to a model
+   *  with begin trees by LoadSegment.
+   */
+  void SaveSegment(dmlc::Stream* fo, size_t begin) const {
+    this->MaterializeTrees();
+    CHECK_LE(begin, trees.size());
+    const uint64_t ntree = trees.size() - begin;
+    fo->Write(&ntree, sizeof(ntree));
+    for (size_t i = begin; i < trees.size(); ++i) {
+      trees[i]->Save(fo);
+    }
+    if (ntree != 0) {
+      fo->Write(dmlc::BeginPtr(tree_info) + begin, sizeof(int) * ntree);
+    }
+  }
+  /*!
+   * \brief save the model in the packed layout: the parameters, then the
+   *  size of a blob of the counts, the tree groups, the arrays of the packed
+   *  forest and the records of the trees as Save writes them. The arrays hold
+   *  4 byte elements after a header of 8 byte counts, so a blob mapped at an
+   *  aligned address can be used in place. Load reads the arrays straight into
+   *  the packed forest and builds the trees from their records on first use.
+   */
+  void SavePacked(dmlc::Stream* fo) const {
+    std::string records;
+    if (tree_records_.empty()) {
+      common::MemoryBufferStream rs(&records);
+      for (const auto& tree : trees) tree->Save(&rs);
+    }
+    const std::string& rec = tree_records_.empty() ? records : tree_records_;
+    const PackedForest& forest = this->GetPackedForest();
+    CHECK_EQ(forest.tree_root.size(), static_cast<size_t>(param.num_trees));
+    PackedHeader header;
+    header.num_tree = forest.tree_root.size();
+    header.num_split = forest.split_cond.size();
+    header.num_leaf = forest.leaf_value.size();
+    header.record_bytes = rec.size();
+    header.single_root = forest.single_root ? 1 : 0;
+    GBTreeModelParam saved = param;
+    saved.packed_layout = 1;
+    fo->Write(&saved, sizeof(saved));
+    const uint64_t size = PackedBytes(header);
+    fo->Write(&size, sizeof(size));
+    fo->Write(&header, sizeof(header));
+    WritePacked(fo, tree_info);
+    WritePacked(fo, forest.tree_root);
+    WritePacked(fo, forest.split_index);
+    WritePacked(fo, forest.split_cond);
+    WritePacked(fo, forest.children);
+    WritePacked(fo, forest.leaf_value);
+    if (rec.size() != 0) fo->Write(rec.data(), rec.size());
+  }
+  /*! \brief append the trees of a segment written by SaveSegment */
+  void LoadSegment(dmlc::Stream* fi) {
+    this->MaterializeTrees();
+    uint64_t ntree;
+    CHECK_EQ(fi->Read(&ntree, sizeof(ntree)), sizeof(ntree))
+        << "GBTree: invalid model segment";
+    for (uint64_t i = 0; i < ntree; ++i) {
+      std::unique_ptr<RegTree> ptr(new RegTree());
+      ptr->Load(fi);
+      trees.push_back(std::move(ptr));
+    }
+    const size_t begin = tree_info.size();
+    tree_info.resize(begin + ntree);
+    if (ntree != 0) {
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(tree_info) + begin, sizeof(int) * ntree),
+               sizeof(int) * ntree);
+    }
+    param.num_trees += static_cast<int>(ntree);
+    threshold_index_.feature_ptr.clear();
+    packed_forest_.Clear();
+    for (size_t i = begin; i < trees.size(); ++i) importance_.Add(*trees[i]);
+  }
+
   std::vector<std::string> DumpModel(const FeatureMap& fmap, bool with_stats,
                                      std::string format) const {
-    std::vector<std::string> dump;
-    for (const auto & tree : trees) {
-      dump.push_back(tree->DumpModel(fmap, with_stats, format));
+    this->MaterializeTrees();
+    std::vector<std::string> dump(trees.size());
+    const auto ntree = static_cast<bst_omp_uint>(trees.size());
+    #pragma omp parallel for schedule(dynamic)
+    for (bst_omp_uint i = 0; i < ntree; ++i) {
+      dump[i] = trees[i]->DumpModel(fmap, with_stats, format);
     }
     return dump;
   }
+  /*! \brief copy the nodes of all trees into flat arrays, without text */
+  void ExportFlat(FlatTreeArrays* out) const {
+    CHECK_EQ(param.size_leaf_vector, 0) << "flat arrays keep one value per leaf";
+    this->MaterializeTrees();
+    out->tree_ptr.assign(1, 0);
+    for (const auto & tree : trees) {
+      out->tree_ptr.push_back(out->tree_ptr.back() + tree->GetNodes().size());
+    }
+    const size_t nnode = out->tree_ptr.back();
+    out->tree_group = tree_info;
+    out->split_index.resize(nnode);
+    out->split_cond.resize(nnode);
+    out->left_child.resize(nnode);
+    out->right_child.resize(nnode);
+    out->default_left.resize(nnode);
+    out->leaf_value.resize(nnode);
+    out->cover.resize(nnode);
+    const auto ntree = static_cast<bst_omp_uint>(trees.size());
+    #pragma omp parallel for schedule(dynamic)
+    for (bst_omp_uint t = 0; t < ntree; ++t) {
+      const RegTree& tree = *trees[t];
+      const std::vector<RegTree::Node>& nodes = tree.GetNodes();
+      for (size_t nid = 0; nid < nodes.size(); ++nid) {
+        const size_t i = out->tree_ptr[t] + nid;
+        const RegTree::Node& node = nodes[nid];
+        const bool split = !node.IsLeaf() && !node.IsDeleted();
+        out->split_index[i] = split ? static_cast<int>(node.SplitIndex()) : -1;
+        out->split_cond[i] = split ? node.SplitCond() : 0.0f;
+        out->left_child[i] = split ? node.LeftChild() : -1;
+        out->right_child[i] = split ? node.RightChild() : -1;
+        out->default_left[i] = split && node.DefaultLeft() ? 1 : 0;
+        out->leaf_value[i] = node.IsLeaf() ? node.LeafValue() : 0.0f;
+        out->cover[i] = tree.Stat(static_cast<int>(nid)).sum_hess;
+      }
+    }
+  }
+  /*! \brief the leaf codes of the first ntree_limit rounds of trees, 0 for all */
+  void InitLeafCodes(unsigned ntree_limit, bool one_hot, LeafCodes* out) const {
+    this->MaterializeTrees();
+    size_t ntree = static_cast<size_t>(ntree_limit) * TreesPerRound();
+    if (ntree == 0 || ntree > trees.size()) ntree = trees.size();
+    out->one_hot = one_hot;
+    out->num_tree = static_cast<unsigned>(ntree);
+    out->column.clear();
+    out->node_ptr.assign(1, 0);
+    size_t ncode = 0;
+    for (size_t t = 0; t < ntree; ++t) {
+      const std::vector<RegTree::Node>& nodes = trees[t]->GetNodes();
+      if (!one_hot) {
+        ncode = std::max(ncode, nodes.size());
+        continue;
+      }
+      for (const RegTree::Node& node : nodes) {
+        const bool leaf = node.IsLeaf() && !node.IsDeleted();
+        out->column.push_back(leaf ? static_cast<uint32_t>(ncode++) : 0U);
+      }
+      out->node_ptr.push_back(out->column.size());
+    }
+    CHECK_LE(ncode, static_cast<size_t>(std::numeric_limits<uint32_t>::max()))
+        << "too many leaves for 32 bit leaf codes";
+    out->num_code = ncode;
+    out->index_size = ncode <= (1U << 16) ? 2 : 4;
+  }
+  /*!
+   * \brief threshold index of the trees, built on first use and rebuilt
+   *  when trees were loaded or added since. Not thread safe while it is built.
+   */
+  const FeatureThresholdIndex& GetThresholdIndex() const {
+    this->MaterializeTrees();
+    if (threshold_index_.feature_ptr.size() == 0 ||
+        threshold_index_.num_trees != trees.size()) {
+      threshold_index_.Build(trees, param.num_feature);
+    }
+    return threshold_index_;
+  }
+  /*!
+   * \brief the trees packed for prediction, the trees added since the last
+   *  call are packed on demand. A model of the packed layout is served from
+   *  the loaded arrays without building its trees. Not thread safe while it
+   *  is updated.
+   */
+  const PackedForest& GetPackedForest() const {
+    packed_forest_.Update(trees);
+    return packed_forest_;
+  }
+  /*! \brief the split statistics of each feature, kept as the trees are added */
+  const FeatureImportance& GetImportance() const {
+    this->MaterializeTrees();
+    return importance_;
+  }
+  /*!
+   * \brief number of trees of a boosting round without parallel trees: one
+   *  per output group, or one for all of them when the trees have vector leaves
+   */
+  inline unsigned TreesPerRound() const {
+    return param.size_leaf_vector != 0 ? 1U : static_cast<unsigned>(param.num_output_group);
+  }
   void CommitModel(std::vector<std::unique_ptr<RegTree> >&& new_trees,
                    int bst_group) {
+    this->MaterializeTrees();
     for (auto & new_tree : new_trees) {
+      importance_.Add(*new_tree);
       trees.push_back(std::move(new_tree));
       tree_info.push_back(bst_group);
     }
     param.num_trees += static_cast<int>(new_trees.size());
   }
+  /*!
+   * \brief replace all the trees, e.g. by a rewrite of the model that keeps
+   *  its outputs, the indexes of the trees are built again on their next use
+   */
+  void ReplaceTrees(std::vector<std::unique_ptr<RegTree> >&& new_trees,
+                    std::vector<int>&& new_tree_info) {
+    CHECK_EQ(new_trees.size(), new_tree_info.size());
+    tree_records_.clear();
+    trees = std::move(new_trees);
+    tree_info = std::move(new_tree_info);
+    param.num_trees = static_cast<int>(trees.size());
+    threshold_index_.feature_ptr.clear();
+    packed_forest_.Clear();
+    importance_.Build(trees);
+  }
+
+  /*!
+   * \brief build the trees of a model loaded in the packed layout from their
+   *  records, on the first use of the trees. Not thread safe while they are built.
+   */
+  void MaterializeTrees() const {
+    if (tree_records_.empty()) return;
+    CHECK(trees.empty());
+    common::MemoryFixSizeBuffer fs(&tree_records_[0], tree_records_.size());
+    trees.reserve(param.num_trees);
+    for (int i = 0; i < param.num_trees; ++i) {
+      std::unique_ptr<RegTree> ptr(new RegTree());
+      ptr->Load(&fs);
+      trees.push_back(std::move(ptr));
+    }
+    std::string().swap(tree_records_);
+    // the loaded arrays are those of the trees built, they are not packed again
+    packed_forest_.source.clear();
+    for (const auto& tree : trees) packed_forest_.source.push_back(tree.get());
+    importance_.Build(trees);
+  }
 
   // base margin
   bst_float base_margin;
   // model parameter
   GBTreeModelParam param;
-  /*! \brief vector of trees stored in the model */
-  std::vector<std::unique_ptr<RegTree> > trees;
+  /*!
+   * \brief vector of trees stored in the model, built on first use when the
+   *  model was loaded in the packed layout, see MaterializeTrees
+   */
+  mutable std::vector<std::unique_ptr<RegTree> > trees;
   /*! \brief for the update process, a place to keep the initial trees */
   std::vector<std::unique_ptr<RegTree> > trees_to_update;
   /*! \brief some information indicator of the tree, reserved */
   std::vector<int> tree_info;
+
+ private:
+  /*! \brief counts of the packed layout, before its arrays */
+  struct PackedHeader {
+    uint64_t num_tree;
+    uint64_t num_split;
+    uint64_t num_leaf;
+    uint64_t record_bytes;
+    uint64_t single_root;
+  };
+  static_assert(sizeof(bst_uint) == 4 && sizeof(bst_float) == 4 && sizeof(int) == 4,
+                "the packed layout holds arrays of 4 byte elements");
+  /*! \return bytes of the blob of the packed layout after its size */
+  static uint64_t PackedBytes(const PackedHeader& header) {
+    return sizeof(PackedHeader) +
+        4 * (2 * header.num_tree + 4 * header.num_split + header.num_leaf) +
+        header.record_bytes;
+  }
+  template <typename T>
+  static void WritePacked(dmlc::Stream* fo, const std::vector<T>& data) {
+    if (data.size() != 0) fo->Write(dmlc::BeginPtr(data), sizeof(T) * data.size());
+  }
+  template <typename T>
+  static void ReadPacked(dmlc::Stream* fi, std::vector<T>* data) {
+    const size_t nbytes = sizeof(T) * data->size();
+    if (nbytes != 0) {
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(*data), nbytes), nbytes)
+          << "GBTree: invalid packed model";
+    }
+  }
+  /*!
+   * \brief read the blob of the packed layout, the arrays are read into the
+   *  packed forest sized from the counts, and the records of the trees into
+   *  one buffer, the trees are not built
+   */
+  void LoadPacked(dmlc::Stream* fi) {
+    uint64_t size;
+    PackedHeader header;
+    CHECK_EQ(fi->Read(&size, sizeof(size)), sizeof(size)) << "GBTree: invalid packed model";
+    CHECK_EQ(fi->Read(&header, sizeof(header)), sizeof(header))
+        << "GBTree: invalid packed model";
+    CHECK_EQ(header.num_tree, static_cast<uint64_t>(param.num_trees))
+        << "GBTree: invalid packed model";
+    CHECK_EQ(size, PackedBytes(header)) << "GBTree: invalid packed model";
+    CHECK_EQ(header.num_tree == 0, header.record_bytes == 0)
+        << "GBTree: invalid packed model";
+    PackedForest& forest = packed_forest_;
+    forest.Clear();
+    tree_info.resize(header.num_tree);
+    forest.tree_root.resize(header.num_tree);
+    forest.split_index.resize(header.num_split);
+    forest.split_cond.resize(header.num_split);
+    forest.children.resize(2 * header.num_split);
+    forest.leaf_value.resize(header.num_leaf);
+    ReadPacked(fi, &tree_info);
+    ReadPacked(fi, &forest.tree_root);
+    ReadPacked(fi, &forest.split_index);
+    ReadPacked(fi, &forest.split_cond);
+    ReadPacked(fi, &forest.children);
+    ReadPacked(fi, &forest.leaf_value);
+    forest.single_root = header.single_root != 0;
+    tree_records_.resize(header.record_bytes);
+    if (header.record_bytes != 0) {
+      CHECK_EQ(fi->Read(&tree_records_[0], tree_records_.size()), tree_records_.size())
+          << "GBTree: invalid packed model";
+    }
+    threshold_index_.feature_ptr.clear();
+    importance_.Clear();
+  }
+
+  mutable FeatureThresholdIndex threshold_index_;
+  mutable PackedForest packed_forest_;
+  mutable FeatureImportance importance_;
+  /*! \brief records of the trees of a packed model not built yet, see MaterializeTrees */
+  mutable std::string tree_records_;
 };
 }  // namespace gbm
 }  // namespace xgboost
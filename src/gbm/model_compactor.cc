@@ -0,0 +1,187 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file model_compactor.cc
+ * \brief rewrite the trees of a model into fewer nodes for serving.
+ */
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "./model_compactor.h"
+
+namespace xgboost {
+namespace gbm {
+
+DMLC_REGISTER_PARAMETER(CompactParam);
+
+namespace {
+// whether leaf a of tree ta and leaf b of tree tb have the same output
+bool SameOutput(const RegTree& ta, int a, const RegTree& tb, int b) {
+  if (ta[a].LeafValue() != tb[b].LeafValue()) return false;
+  const bst_float* va = ta.Leafvec(a);
+  const bst_float* vb = tb.Leafvec(b);
+  if (va == nullptr || vb == nullptr) return va == vb;
+  return std::equal(va, va + ta.param.size_leaf_vector, vb);
+}
+
+// the leaf of the output of every row reaching nid, -1 if the rows differ
+int MergedLeaf(const RegTree& tree, int nid, std::vector<int>* merged) {
+  const RegTree::Node& node = tree[nid];
+  int leaf = nid;
+  if (!node.IsLeaf()) {
+    const int left = MergedLeaf(tree, node.LeftChild(), merged);
+    const int right = MergedLeaf(tree, node.RightChild(), merged);
+    leaf = left >= 0 && right >= 0 && SameOutput(tree, left, tree, right) ? left : -1;
+  }
+  (*merged)[nid] = leaf;
+  return leaf;
+}
+
+// copy the nodes of a tree reachable from its roots in breadth first order,
+// with the splits of merged leaves turned into leaves if merge is set
+std::unique_ptr<RegTree> CopyTree(const RegTree& tree, bool merge, size_t* num_merged) {
+  std::vector<int> merged;
+  if (merge) {
+    merged.resize(tree.param.num_nodes);
+    for (int r = 0; r < tree.param.num_roots; ++r) MergedLeaf(tree, r, &merged);
+  }
+  std::unique_ptr<RegTree> out(new RegTree());
+  out->param = tree.param;
+  out->param.num_deleted = 0;
+  out->InitModel();
+  const int nvec = tree.param.size_leaf_vector;
+  // (node of tree, node of the copy)
+  std::vector<std::pair<int, int> > queue;
+  for (int r = 0; r < tree.param.num_roots; ++r) queue.emplace_back(r, r);
+  for (size_t i = 0; i < queue.size(); ++i) {
+    const int src = queue[i].first;
+    const int dst = queue[i].second;
+    const RegTree::Node& node = tree[src];
+    const int leaf = merge ? merged[src] : (node.IsLeaf() ? src : -1);
+    out->Stat(dst) = tree.Stat(src);
+    if (leaf >= 0) {
+      if (!node.IsLeaf()) ++*num_merged;
+      (*out)[dst].SetLeaf(tree[leaf].LeafValue());
+      if (nvec != 0) std::copy(tree.Leafvec(leaf), tree.Leafvec(leaf) + nvec, out->Leafvec(dst));
+      continue;
+    }
+    out->AddChilds(dst);
+    RegTree::Node& copy = (*out)[dst];
+    copy.SetSplit(node.SplitIndex(), node.SplitCond(), node.DefaultLeft());
+    queue.emplace_back(node.LeftChild(), copy.LeftChild());
+    queue.emplace_back(node.RightChild(), copy.RightChild());
+  }
+  return out;
+}
+
+// hash of the group and the splits of a tree copied by CopyTree
+uint64_t SplitHash(const RegTree& tree, int group) {
+  uint64_t hash = 14695981039346656037ULL ^ static_cast<uint64_t>(group);
+  for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+    const RegTree::Node& node = tree[nid];
+    uint64_t key = 0;
+    if (!node.IsLeaf()) {
+      const bst_float split_cond = node.SplitCond();
+      uint32_t cond;
+      std::memcpy(&cond, &split_cond, sizeof(cond));
+      key = (static_cast<uint64_t>(node.SplitIndex()) << 33) |
+          (node.DefaultLeft() ? 1ULL << 32 : 0ULL) | cond;
+    }
+    hash = (hash ^ key) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// whether two trees copied by CopyTree have the same splits, and the same
+// leaf outputs if same_leaves
+bool SameTree(const RegTree& a, const RegTree& b, bool same_leaves) {
+  if (a.param.num_nodes != b.param.num_nodes || a.param.num_roots != b.param.num_roots) {
+    return false;
+  }
+  for (int nid = 0; nid < a.param.num_nodes; ++nid) {
+    const RegTree::Node& na = a[nid];
+    const RegTree::Node& nb = b[nid];
+    if (na.IsLeaf() != nb.IsLeaf()) return false;
+    if (na.IsLeaf()) {
+      if (same_leaves && !SameOutput(a, nid, b, nid)) return false;
+    } else if (na.SplitIndex() != nb.SplitIndex() || na.DefaultLeft() != nb.DefaultLeft() ||
+               na.SplitCond() != nb.SplitCond() || na.LeftChild() != nb.LeftChild() ||
+               na.RightChild() != nb.RightChild()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// add the leaf outputs of src to those of tree dst of the same splits
+void AddLeaves(const RegTree& src, RegTree* dst) {
+  const int nvec = src.param.size_leaf_vector;
+  for (int nid = 0; nid < src.param.num_nodes; ++nid) {
+    if (!src[nid].IsLeaf()) continue;
+    (*dst)[nid].SetLeaf((*dst)[nid].LeafValue() + src[nid].LeafValue());
+    for (int k = 0; k < nvec; ++k) dst->Leafvec(nid)[k] += src.Leafvec(nid)[k];
+  }
+}
+}  // namespace
+
+void CompactModel(const CompactParam& param, GBTreeModel* model, CompactStats* out_stats) {
+  CHECK_EQ(model->trees_to_update.size(), 0U)
+      << "can not compact a model in the middle of an update";
+  CompactStats stats;
+  const size_t ntree = model->trees.size();
+  stats.num_trees_before = ntree;
+  std::vector<std::unique_ptr<RegTree> > copies(ntree);
+  for (size_t t = 0; t < ntree; ++t) {
+    stats.num_nodes_before += model->trees[t]->param.num_nodes;
+    copies[t] = CopyTree(*model->trees[t], param.compact_leaves, &stats.num_merged);
+  }
+  // the tree each tree is folded into, the first tree of the same splits
+  std::vector<size_t> folded(ntree);
+  for (size_t t = 0; t < ntree; ++t) folded[t] = t;
+  if (param.compact_fold != kFoldNone) {
+    std::unordered_map<uint64_t, std::vector<size_t> > kept;
+    for (size_t t = 0; t < ntree; ++t) {
+      std::vector<size_t>& bucket = kept[SplitHash(*copies[t], model->tree_info[t])];
+      for (size_t r : bucket) {
+        if (model->tree_info[r] == model->tree_info[t] &&
+            SameTree(*copies[r], *copies[t], param.compact_fold == kFoldIdentical)) {
+          folded[t] = r;
+          break;
+        }
+      }
+      if (folded[t] == t) bucket.push_back(t);
+    }
+    // the leaves are compared above before any of them is summed
+    std::vector<bool> summed(ntree, false);
+    for (size_t t = 0; t < ntree; ++t) {
+      if (folded[t] == t) continue;
+      AddLeaves(*copies[t], copies[folded[t]].get());
+      summed[folded[t]] = true;
+    }
+    // the sums may give sibling leaves the same output
+    for (size_t t = 0; t < ntree; ++t) {
+      if (summed[t] && param.compact_leaves) {
+        copies[t] = CopyTree(*copies[t], true, &stats.num_merged);
+      }
+    }
+  }
+  std::vector<std::unique_ptr<RegTree> > trees;
+  std::vector<int> tree_info;
+  for (size_t t = 0; t < ntree; ++t) {
+    if (folded[t] != t) continue;
+    stats.num_nodes_after += copies[t]->param.num_nodes;
+    trees.push_back(std::move(copies[t]));
+    tree_info.push_back(model->tree_info[t]);
+  }
+  stats.num_trees_after = trees.size();
+  // the copies are allocated while the old trees live, so the indexes of the
+  // predictors that compare tree pointers see the trees replaced
+  model->ReplaceTrees(std::move(trees), std::move(tree_info));
+  if (out_stats != nullptr) *out_stats = stats;
+}
+}  // namespace gbm
+}  // namespace xgboost
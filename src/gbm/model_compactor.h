@@ -0,0 +1,77 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file model_compactor.h
+ * \brief rewrite the trees of a model into fewer nodes for serving.
+ *
+ *  A split whose two children are leaves of the same value, and of the same
+ *  leaf vector, predicts that value whichever way a row goes, so it becomes a
+ *  leaf, and its parent may merge in turn. The trees are then copied with
+ *  their remaining nodes in breadth first order, which also drops the nodes
+ *  the pruner deleted. Neither changes a leaf value a row reaches, so the
+ *  margins stay bit-identical.
+ *
+ *  Folding adds the leaf values of a tree to those of an earlier tree of the
+ *  same output group and the same splits, and removes it. The leaves are
+ *  summed before the margins instead of one tree after the other, so the
+ *  margins of a folded model only agree up to float rounding, and its rounds
+ *  no longer have a fixed number of trees for ntree_limit.
+ */
+#ifndef XGBOOST_GBM_MODEL_COMPACTOR_H_
+#define XGBOOST_GBM_MODEL_COMPACTOR_H_
+
+#include <dmlc/parameter.h>
+#include "./gbtree_model.h"
+
+namespace xgboost {
+namespace gbm {
+
+/*! \brief which trees are folded into an earlier tree */
+enum CompactFold : int {
+  kFoldNone = 0,
+  /*! \brief trees of the same splits and the same leaf values */
+  kFoldIdentical = 1,
+  /*! \brief trees of the same splits */
+  kFoldStructure = 2
+};
+
+/*! \brief parameters of the model compaction */
+struct CompactParam : public dmlc::Parameter<CompactParam> {
+  /*! \brief whether the splits of two leaves of the same output become leaves */
+  bool compact_leaves;
+  /*! \brief which trees are folded, a CompactFold */
+  int compact_fold;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(CompactParam) {
+    DMLC_DECLARE_FIELD(compact_leaves).set_default(true)
+        .describe("Merge the sibling leaves of the same output into their parent.");
+    DMLC_DECLARE_FIELD(compact_fold).set_default(kFoldNone)
+        .add_enum("none", kFoldNone)
+        .add_enum("identical", kFoldIdentical)
+        .add_enum("structure", kFoldStructure)
+        .describe("Fold the trees identical to, or of the same splits as, an "
+                  "earlier tree of their output group into it. The margins then "
+                  "only agree up to float rounding.");
+  }
+};
+
+/*! \brief sizes of a model before and after its compaction */
+struct CompactStats {
+  size_t num_trees_before{0};
+  size_t num_trees_after{0};
+  /*! \brief nodes stored, including the deleted ones */
+  size_t num_nodes_before{0};
+  size_t num_nodes_after{0};
+  /*! \brief subtrees of a single output turned into leaves */
+  size_t num_merged{0};
+};
+
+/*!
+ * \brief compact the trees of a model in place
+ * \param param the compaction parameters
+ * \param model the model, not in the middle of an update
+ * \param out_stats the sizes of the model before and after, may be nullptr
+ */
+void CompactModel(const CompactParam& param, GBTreeModel* model, CompactStats* out_stats);
+}  // namespace gbm
+}  // namespace xgboost
+#endif  // XGBOOST_GBM_MODEL_COMPACTOR_H_
@@ -0,0 +1,118 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file model_compiler.cc
+ * \brief generate the C source of a scoring library from a tree ensemble.
+ */
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include "./model_compiler.h"
+
+namespace xgboost {
+namespace gbm {
+
+namespace {
+// a float literal that reads back to the same value
+std::string FloatLiteral(bst_float value) {
+  if (std::isinf(value)) return value > 0 ? "INFINITY" : "-INFINITY";
+  std::ostringstream os;
+  os << std::scientific
+     << std::setprecision(std::numeric_limits<bst_float>::max_digits10 - 1)
+     << value << 'f';
+  return os.str();
+}
+
+void CompileNode(const RegTree& tree, int nid, int depth, std::ostream* os) {
+  const std::string indent(2 * depth, ' ');
+  const RegTree::Node& node = tree[nid];
+  if (node.IsLeaf()) {
+    *os << indent << "return " << FloatLiteral(node.LeafValue()) << ";\n";
+    return;
+  }
+  // a comparison with NaN is false, so !(x >= c) sends a missing value left
+  // and (x < c) sends it right
+  const unsigned fid = node.SplitIndex();
+  const std::string cond = FloatLiteral(node.SplitCond());
+  if (node.DefaultLeft()) {
+    *os << indent << "if (!(x[" << fid << "] >= " << cond << ")) {\n";
+  } else {
+    *os << indent << "if (x[" << fid << "] < " << cond << ") {\n";
+  }
+  CompileNode(tree, node.LeftChild(), depth + 1, os);
+  *os << indent << "} else {\n";
+  CompileNode(tree, node.RightChild(), depth + 1, os);
+  *os << indent << "}\n";
+}
+}  // namespace
+
+void CompileModel(const GBTreeModel& model, unsigned ntree_limit, std::ostream* os) {
+  CHECK_EQ(model.param.size_leaf_vector, 0)
+      << "size_leaf_vector is enforced to 0 so far";
+  const int ngroup = model.param.num_output_group;
+  size_t ntree = static_cast<size_t>(ntree_limit) * ngroup;
+  if (ntree == 0 || ntree > model.trees.size()) ntree = model.trees.size();
+  // the compiled functions read any feature the trees split on
+  int nfeature = model.param.num_feature;
+  for (size_t t = 0; t < ntree; ++t) {
+    const RegTree& tree = *model.trees[t];
+    CHECK_EQ(tree.param.num_roots, 1) << "compile does not support multiple roots";
+    for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+      if (!tree[nid].IsLeaf() && !tree[nid].IsDeleted()) {
+        nfeature = std::max(nfeature, static_cast<int>(tree[nid].SplitIndex()) + 1);
+      }
+    }
+  }
+  *os << "/* Generated by xgboost task=compile: " << ntree << " trees, "
+      << ngroup << " output groups, " << nfeature << " features. */\n"
+      << "#include <math.h>\n"
+      << "#include <stddef.h>\n"
+      << "\n"
+      << "#if defined(_WIN32)\n"
+      << "#define XGB_COMPILED_API __declspec(dllexport)\n"
+      << "#else\n"
+      << "#define XGB_COMPILED_API __attribute__((visibility(\"default\")))\n"
+      << "#endif\n"
+      << "\n"
+      << "#ifdef __cplusplus\n"
+      << "extern \"C\" {\n"
+      << "#endif\n"
+      << "\n";
+  for (size_t t = 0; t < ntree; ++t) {
+    *os << "static float tree_" << t << "(const float* x) {\n";
+    CompileNode(*model.trees[t], 0, 1, os);
+    *os << "}\n\n";
+  }
+  *os << "XGB_COMPILED_API int num_feature(void) {\n"
+      << "  return " << nfeature << ";\n"
+      << "}\n\n"
+      << "XGB_COMPILED_API int num_output_group(void) {\n"
+      << "  return " << ngroup << ";\n"
+      << "}\n\n"
+      << "XGB_COMPILED_API void predict(const float* x, float* out) {\n";
+  for (int gid = 0; gid < ngroup; ++gid) {
+    *os << "  out[" << gid << "] = " << FloatLiteral(model.base_margin) << ";\n";
+  }
+  for (size_t t = 0; t < ntree; ++t) {
+    // the sum follows the tree order, as the predictors do
+    *os << "  out[" << model.tree_info[t] << "] += tree_" << t << "(x);\n";
+  }
+  *os << "}\n\n"
+      << "XGB_COMPILED_API void predict_batch(const float* x, size_t nrow, float* out) {\n"
+      << "  long i;\n"
+      << "#pragma omp parallel for schedule(static) if (nrow > 64)\n"
+      << "  for (i = 0; i < (long)nrow; ++i) {\n"
+      << "    predict(x + (size_t)i * " << nfeature << ", out + (size_t)i * "
+      << ngroup << ");\n"
+      << "  }\n"
+      << "}\n\n"
+      << "#ifdef __cplusplus\n"
+      << "}  /* extern \"C\" */\n"
+      << "#endif\n";
+}
+
+}  // namespace gbm
+}  // namespace xgboost
@@ -0,0 +1,35 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file model_compiler.h
+ * \brief generate the C source of a scoring library from a tree ensemble.
+ */
+#ifndef XGBOOST_GBM_MODEL_COMPILER_H_
+#define XGBOOST_GBM_MODEL_COMPILER_H_
+
+#include <ostream>
+#include "./gbtree_model.h"
+
+namespace xgboost {
+namespace gbm {
+/*!
+ * \brief write the trees of a model as C functions of nested if/else, with
+ *  no tree structure left to load at prediction time. The source compiles as
+ *  C99 or C++ into a shared object exporting
+ *
+ *    int num_feature(void);
+ *    int num_output_group(void);
+ *    void predict(const float* x, float* out);
+ *    void predict_batch(const float* x, size_t nrow, float* out);
+ *
+ *  x holds num_feature values per row, NaN marking a missing value, and out
+ *  receives num_output_group margins per row, the objective transform is left
+ *  to the caller. predict_batch runs over the rows with OpenMP when it is
+ *  compiled with it.
+ * \param model the model to compile
+ * \param ntree_limit number of rounds of trees to compile, 0 for all
+ * \param os the output stream of the source
+ */
+void CompileModel(const GBTreeModel& model, unsigned ntree_limit, std::ostream* os);
+}  // namespace gbm
+}  // namespace xgboost
+#endif  // XGBOOST_GBM_MODEL_COMPILER_H_
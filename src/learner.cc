@@ -5,21 +5,29 @@
  * \author Tianqi Chen
  */
 #include <dmlc/io.h>
+#include <dmlc/omp.h>
 #include <dmlc/timer.h>
 #include <xgboost/learner.h>
 #include <xgboost/logging.h>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
 #include <iomanip>
 #include <limits>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 #include "./common/common.h"
 #include "./common/host_device_vector.h"
 #include "./common/io.h"
+#include "./common/memory_tracker.h"
 #include "./common/random.h"
+#include "./common/threading.h"
 #include "common/timer.h"
+#include "./robust/robust_attack.h"
 
 namespace {
 
@@ -87,11 +95,23 @@ struct LearnerTrainParam : public dmlc::Parameter<LearnerTrainParam> {
   std::string test_flag;
   // maximum row per batch.
   size_t max_row_perbatch;
+  // whether to build the sorted columns of the features when first used
+  bool lazy_columns;
+  // bound of the memory of the lazily built columns in MB, 0 for none
+  size_t lazy_columns_budget;
   // number of threads to use if OpenMP is enabled
   // if equals 0, use system default
   int nthread;
   // flag to print out detailed breakdown of runtime
   int debug_verbose;
+  // whether to log the tracked memory after each round
+  bool memory_log;
+  // period in rounds of the adversarial copies of the training rows, 0 for none
+  int adv_train_period;
+  // L-inf radius of the adversarial copies, robust_eps if 0
+  float adv_train_eps;
+  // whether the metrics of several evaluation sets are evaluated at once
+  bool eval_parallel;
   // declare parameters
   DMLC_DECLARE_PARAMETER(LearnerTrainParam) {
     DMLC_DECLARE_FIELD(seed).set_default(0).describe(
@@ -116,19 +136,55 @@ struct LearnerTrainParam : public dmlc::Parameter<LearnerTrainParam> {
         .add_enum("hist", 3)
         .add_enum("gpu_exact", 4)
         .add_enum("gpu_hist", 5)
-        .add_enum("robust_exact", 6) 
+        .add_enum("robust_exact", 6)
+        .add_enum("robust_hist", 7)
+        .add_enum("robust_approx", 8)
+        .add_enum("robust_gpu_hist", 9)
+        .add_enum("robust_gpu_exact", 10)
         .describe("Choice of tree construction method.");
     DMLC_DECLARE_FIELD(test_flag).set_default("").describe(
         "Internal test flag");
     DMLC_DECLARE_FIELD(max_row_perbatch)
         .set_default(std::numeric_limits<size_t>::max())
         .describe("maximum row per batch.");
+    DMLC_DECLARE_FIELD(lazy_columns)
+        .set_default(false)
+        .describe("Build and sort the columns of the features when a tree first "
+                  "uses them, e.g. with colsample_bytree on wide data.");
+    DMLC_DECLARE_FIELD(lazy_columns_budget)
+        .set_default(0)
+        .describe("Memory of the lazily built columns in MB, over it the "
+                  "least recently used columns are dropped; 0 for no bound.");
     DMLC_DECLARE_FIELD(nthread).set_default(0).describe(
         "Number of threads to use.");
     DMLC_DECLARE_FIELD(debug_verbose)
         .set_lower_bound(0)
         .set_default(0)
         .describe("flag to print out detailed breakdown of runtime");
+    DMLC_DECLARE_FIELD(memory_log)
+        .set_default(false)
+        .describe("Log the bytes of the data pages, quantized matrices, histograms, "
+                  "vectors and builder workspaces after each round, with their peaks "
+                  "in the round and the resident set size of the process.");
+    DMLC_DECLARE_FIELD(adv_train_period)
+        .set_default(0)
+        .set_lower_bound(0)
+        .describe("Adversarial training: every adv_train_period rounds the rows the "
+                  "training matrix had in the first round are attacked against the "
+                  "current model, see src/robust/robust_attack.h, and their "
+                  "successful adversarial copies are appended to the matrix with "
+                  "the labels and weights of the rows. 0 disables it.");
+    DMLC_DECLARE_FIELD(adv_train_eps)
+        .set_default(0.0f)
+        .set_lower_bound(0.0f)
+        .describe("L-inf radius of the adversarial copies, robust_eps if 0. The "
+                  "other attack_* parameters apply to the attack.");
+    DMLC_DECLARE_FIELD(eval_parallel)
+        .set_default(false)
+        .describe("Evaluate the metrics of the evaluation sets at once, each set "
+                  "on a share of nthread proportional to its rows. The predictions "
+                  "are still computed one set after another. Ignored in distributed "
+                  "training.");
   }
 };
 
@@ -188,13 +244,66 @@ class LearnerImpl : public Learner {
       }
     } else if (tparam_.tree_method == 6) {
       if (cfg_.count("updater") == 0) {
-        cfg_["updater"] = "robust_grow_colmaker,prune";
+        if (tparam_.dsplit == 1) {
+          cfg_["updater"] = "robust_distcol";
+        } else if (tparam_.dsplit == 2) {
+          // row-split data: the candidates are proposed from the merged
+          // sketches and only their window statistics are reduced
+          cfg_["updater"] = "robust_distrow,prune";
+        } else {
+          // the grow step prunes its trees, the prune updater would only
+          // repeat the same pass
+          cfg_["updater"] = "robust_grow_colmaker";
+          cfg_["robust_fused_prune"] = "1";
+        }
+      }
+    } else if (tparam_.tree_method == 7) {
+      /* histogram-based robust algorithm */
+      LOG(CONSOLE) << "Tree method is selected to be \'robust_hist\', which uses a "
+                      "single updater "
+                   << "robust_grow_fast_histmaker.";
+      cfg_["updater"] = "robust_grow_fast_histmaker";
+    } else if (tparam_.tree_method == 8) {
+      /* sketch-based robust algorithm, also for row-split distributed data */
+      if (cfg_.count("updater") == 0) {
+        if (tparam_.dsplit == 1) {
+          cfg_["updater"] = "robust_distcol";
+        } else {
+          cfg_["updater"] = "robust_grow_histmaker,prune";
+        }
+      }
+    } else if (tparam_.tree_method == 9) {
+      this->AssertGPUSupport();
+      if (cfg_.count("updater") == 0) {
+        cfg_["updater"] = "robust_grow_gpu_hist";
+      }
+      if (cfg_.count("predictor") == 0) {
+        cfg_["predictor"] = "gpu_predictor";
+      }
+    } else if (tparam_.tree_method == 10) {
+      /* exact robust algorithm on GPU */
+      this->AssertGPUSupport();
+      if (cfg_.count("updater") == 0) {
+        cfg_["updater"] = "robust_grow_gpu,prune";
       }
-    } 
+      if (cfg_.count("predictor") == 0) {
+        cfg_["predictor"] = "gpu_predictor";
+      }
+    }
   }
 
   void Configure(
       const std::vector<std::pair<std::string, std::string> >& args) override {
+    // the same arguments as last time derive the same configuration, e.g. a
+    // parameter set again to its value between the rounds of online updates
+    if (args_configured_ && args == configured_args_) {
+      if (tparam_.nthread != 0) {
+        omp_set_num_threads(tparam_.nthread);
+      }
+      return;
+    }
+    configured_args_ = args;
+    args_configured_ = true;
     // add to configurations
     tparam_.InitAllowUnknown(args);
     monitor_.Init("Learner", tparam_.debug_verbose);
@@ -275,6 +384,9 @@ class LearnerImpl : public Learner {
     if (fp.PeekRead(&header[0], 4) == 4) {
       CHECK_NE(header, "bs64")
           << "Base64 format is no longer supported in brick.";
+      CHECK_NE(header, "xgsg")
+          << "This is a model segment written with save_segments, "
+          << "load it with the command line program, or load the final model.";
       if (header == "binf") {
         CHECK_EQ(fp.Read(&header[0], 4), 4U);
       }
@@ -327,6 +439,8 @@ class LearnerImpl : public Learner {
     cfg_["num_class"] = common::ToString(mparam_.num_class);
     cfg_["num_feature"] = common::ToString(mparam_.num_feature);
     obj_->Configure(cfg_.begin(), cfg_.end());
+    // the loaded booster is configured again by the next Configure
+    args_configured_ = false;
   }
 
   // rabit save model to rabit checkpoint
@@ -375,12 +489,14 @@ class LearnerImpl : public Learner {
   }
 
   void UpdateOneIter(int iter, DMatrix* train) override {
+    common::OmpThreadScope threads(tparam_.nthread);
     monitor_.Start("UpdateOneIter");
     CHECK(ModelInitialized())
         << "Always call InitModel or LoadModel before update";
     if (tparam_.seed_per_iteration || rabit::IsDistributed()) {
       common::GlobalRandom().seed(tparam_.seed * kRandSeedMagic + iter);
     }
+    if (tparam_.adv_train_period != 0) this->AppendAdversarial(iter, train);
     this->LazyInitDMatrix(train);
     monitor_.Start("PredictRaw");
     this->PredictRaw(train, &preds_);
@@ -390,10 +506,12 @@ class LearnerImpl : public Learner {
     monitor_.Stop("GetGradient");
     gbm_->DoBoost(train, &gpair_, obj_.get());
     monitor_.Stop("UpdateOneIter");
+    if (tparam_.memory_log) this->LogMemory(iter);
   }
 
   void BoostOneIter(int iter, DMatrix* train,
                     HostDeviceVector<GradientPair>* in_gpair) override {
+    common::OmpThreadScope threads(tparam_.nthread);
     monitor_.Start("BoostOneIter");
     if (tparam_.seed_per_iteration || rabit::IsDistributed()) {
       common::GlobalRandom().seed(tparam_.seed * kRandSeedMagic + iter);
@@ -401,27 +519,50 @@ class LearnerImpl : public Learner {
     this->LazyInitDMatrix(train);
     gbm_->DoBoost(train, in_gpair);
     monitor_.Stop("BoostOneIter");
+    if (tparam_.memory_log) this->LogMemory(iter);
   }
 
   std::string EvalOneIter(int iter, const std::vector<DMatrix*>& data_sets,
                           const std::vector<std::string>& data_names) override {
-    monitor_.Start("EvalOneIter");
+    std::vector<std::string> names;
+    std::vector<bst_float> values;
+    this->EvalMetricValues(data_sets, &names, &values);
     std::ostringstream os;
     os << '[' << iter << ']' << std::setiosflags(std::ios::fixed);
+    for (size_t i = 0; i < data_sets.size(); ++i) {
+      for (size_t j = 0; j < names.size(); ++j) {
+        os << '\t' << data_names[i] << '-' << names[j] << ':' << values[i * names.size() + j];
+      }
+    }
+    return os.str();
+  }
+
+  void EvalMetricValues(const std::vector<DMatrix*>& data_sets,
+                        std::vector<std::string>* out_names,
+                        std::vector<bst_float>* out_values) override {
+    common::OmpThreadScope threads(tparam_.nthread);
+    monitor_.Start("EvalOneIter");
     if (metrics_.size() == 0) {
       metrics_.emplace_back(Metric::Create(obj_->DefaultEvalMetric()));
     }
-    for (size_t i = 0; i < data_sets.size(); ++i) {
-      this->PredictRaw(data_sets[i], &preds_);
+    out_names->clear();
+    for (const auto& metric : metrics_) out_names->emplace_back(metric->Name());
+    out_values->clear();
+    // the statistics of distributed metrics are reduced in the same order on all workers
+    if (tparam_.eval_parallel && data_sets.size() > 1 && tparam_.dsplit != 2 &&
+        !rabit::IsDistributed()) {
+      this->EvalConcurrently(data_sets, out_values);
+      monitor_.Stop("EvalOneIter");
+      return;
+    }
+    std::vector<bst_float> values;
+    for (DMatrix* data : data_sets) {
+      this->PredictRaw(data, &preds_);
       obj_->EvalTransform(&preds_);
-      for (auto& ev : metrics_) {
-        os << '\t' << data_names[i] << '-' << ev->Name() << ':'
-           << ev->Eval(preds_.HostVector(), data_sets[i]->Info(), tparam_.dsplit == 2);
-      }
+      this->EvalMetrics(data, &values);
+      out_values->insert(out_values->end(), values.begin(), values.end());
     }
-
     monitor_.Stop("EvalOneIter");
-    return os.str();
   }
 
   void SetAttr(const std::string& key, const std::string& value) override {
@@ -452,20 +593,30 @@ class LearnerImpl : public Learner {
     return out;
   }
 
+  int NumThreads() const override {
+    return tparam_.nthread;
+  }
+
   std::pair<std::string, bst_float> Evaluate(DMatrix* data,
                                              std::string metric) {
+    common::OmpThreadScope threads(tparam_.nthread);
     if (metric == "auto") metric = obj_->DefaultEvalMetric();
     std::unique_ptr<Metric> ev(Metric::Create(metric.c_str()));
+    bst_float value;
+    if (ev->EvalModel(*gbm_, data, tparam_.dsplit == 2, &value)) {
+      return std::make_pair(metric, value);
+    }
     this->PredictRaw(data, &preds_);
     obj_->EvalTransform(&preds_);
     return std::make_pair(metric,
-                          ev->Eval(preds_.HostVector(), data->Info(), tparam_.dsplit == 2));
+                          ev->Eval(preds_.ConstHostVector(), data->Info(), tparam_.dsplit == 2));
   }
 
   void Predict(DMatrix* data, bool output_margin,
                HostDeviceVector<bst_float>* out_preds, unsigned ntree_limit,
                bool pred_leaf, bool pred_contribs, bool approx_contribs,
                bool pred_interactions) const override {
+    common::OmpThreadScope threads(tparam_.nthread);
     if (pred_contribs) {
       gbm_->PredictContribution(data, &out_preds->HostVector(), ntree_limit, approx_contribs);
     } else if (pred_interactions) {
@@ -482,11 +633,84 @@ class LearnerImpl : public Learner {
   }
 
  protected:
+  // log the tracked memory of round iter, the peaks start over for the next round
+  inline void LogMemory(int iter) {
+    common::MemoryTracker* tracker = common::MemoryTracker::Get();
+    LOG(CONSOLE) << "[" << iter << "]\tmemory: " << tracker->Json();
+    tracker->ResetPeak();
+  }
+  // append the adversarial copies of round iter of the first rows of p_train
+  inline void AppendAdversarial(int iter, DMatrix* p_train) {
+    // the rows before the first round are the originals, the later ones copies
+    if (p_train != adv_train_data_) {
+      adv_train_data_ = p_train;
+      adv_train_rows_ = p_train->Info().num_row_;
+    }
+    if (iter == 0 || iter % tparam_.adv_train_period != 0) return;
+    const gbm::GBTreeModel* model = gbm_->GetTreeModel();
+    CHECK(model != nullptr) << "adversarial training only supports booster=gbtree";
+    if (model->trees.empty()) return;
+    bst_float eps = tparam_.adv_train_eps;
+    if (eps == 0.0f && cfg_.count("robust_eps") != 0) {
+      eps = static_cast<bst_float>(std::stod(cfg_.at("robust_eps")));
+    }
+    CHECK_GT(eps, 0.0f) << "adversarial training needs adv_train_eps or robust_eps";
+    monitor_.Start("AppendAdversarial");
+    std::vector<std::pair<std::string, std::string> > cfg(cfg_.begin(), cfg_.end());
+    std::ostringstream os;
+    os << std::setprecision(std::numeric_limits<float>::max_digits10) << eps;
+    cfg.emplace_back("attack_eps", os.str());
+    robust::RobustAttack attack(*model);
+    attack.Configure(cfg);
+    std::vector<bst_float> dist, adv;
+    attack.Attack(p_train, &dist, &adv, adv_train_rows_);
+    const size_t nfeature = dist.empty() ? 0 : adv.size() / dist.size();
+    const MetaInfo& info = p_train->Info();
+    // the copies keep the entries of their rows, and the absent features the
+    // attack moved off 0
+    SparsePage rows;
+    std::vector<bst_float> labels, weights;
+    std::vector<bool> present(nfeature);
+    auto iter_rows = p_train->RowIterator();
+    iter_rows->BeforeFirst();
+    while (iter_rows->Next()) {
+      auto &batch = iter_rows->Value();
+      for (size_t i = 0; i < batch.Size() && batch.base_rowid + i < dist.size(); ++i) {
+        const size_t ridx = batch.base_rowid + i;
+        if (!(dist[ridx] > 0.0f)) continue;
+        const bst_float* x = dmlc::BeginPtr(adv) + ridx * nfeature;
+        SparsePage::Inst inst = batch[i];
+        present.assign(nfeature, false);
+        for (bst_uint j = 0; j < inst.length; ++j) {
+          if (inst[j].index < nfeature) present[inst[j].index] = true;
+        }
+        for (size_t f = 0; f < nfeature; ++f) {
+          if (std::isnan(x[f]) || (!present[f] && x[f] == 0.0f)) continue;
+          rows.data.emplace_back(static_cast<bst_uint>(f), x[f]);
+        }
+        rows.offset.push_back(rows.data.size());
+        labels.push_back(info.labels_[ridx]);
+        if (!info.weights_.empty()) weights.push_back(info.weights_[ridx]);
+      }
+    }
+    if (!labels.empty()) p_train->AppendRows(rows, labels, weights);
+    monitor_.Stop("AppendAdversarial");
+    if (tparam_.debug_verbose > 0) {
+      LOG(CONSOLE) << "[" << iter << "]\tadversarial copies: " << labels.size() << " of "
+                   << adv_train_rows_ << " rows, " << p_train->Info().num_row_ << " rows in all";
+    }
+  }
   // check if p_train is ready to used by training.
   // if not, initialize the column access.
   inline void LazyInitDMatrix(DMatrix* p_train) {
+    if (name_gbm_ != "gblinear" && p_train->Info().feature_map_.size() == 0) {
+      // all the workers get an empty map when no feature can split
+      p_train->InitFeatureMap(tparam_.dsplit == 2);
+    }
     if (tparam_.tree_method == 3 || tparam_.tree_method == 4 ||
-        tparam_.tree_method == 5 || name_gbm_ == "gblinear") {
+        tparam_.tree_method == 5 || tparam_.tree_method == 7 ||
+        tparam_.tree_method == 9 || tparam_.tree_method == 10 ||
+        name_gbm_ == "gblinear") {
       return;
     }
 
@@ -513,11 +737,20 @@ class LearnerImpl : public Learner {
         max_row_perbatch = std::min(max_row_perbatch, safe_max_row);
       }
 
+      if (tparam_.tree_method == 8) {
+        LOG(CONSOLE) << "Tree method is selected to be \'robust_approx\'";
+        max_row_perbatch = std::min(max_row_perbatch, safe_max_row);
+      }
+
       if (tparam_.test_flag == "block" || tparam_.dsplit == 2) {
         max_row_perbatch = std::min(max_row_perbatch, safe_max_row);
       }
       // initialize column access
-      p_train->InitColAccess(max_row_perbatch, true);
+      if (tparam_.lazy_columns) {
+        p_train->InitLazyColAccess(max_row_perbatch, tparam_.lazy_columns_budget << 20);
+      } else {
+        p_train->InitColAccess(max_row_perbatch, true);
+      }
     }
 
     if (!p_train->SingleColBlock() && cfg_.count("updater") == 0) {
@@ -534,6 +767,137 @@ class LearnerImpl : public Learner {
     monitor_.Stop("LazyInitDMatrix");
   }
 
+  /*!
+   * \brief evaluate metrics_ on the transformed predictions in preds_.
+   *
+   *  The metrics that are weighted means over the rows are summed together
+   *  in one pass over blocks of rows, so a block is read by all of them while
+   *  it is in cache, and their statistics are reduced over the workers in
+   *  one call. The other metrics read the whole predictions on their own.
+   */
+  inline void EvalMetrics(DMatrix* data, std::vector<bst_float>* out) {
+    const std::vector<bst_float>& preds = preds_.ConstHostVector();
+    std::vector<size_t> rowwise, others;
+    this->PrepareMetrics(metrics_, data, preds, out, &rowwise, &others);
+    this->EvalPrepared(metrics_, data, preds, rowwise, others, out);
+  }
+  /*!
+   * \brief the first step of EvalMetrics: evaluate the metrics that look into
+   *  the model and check the predictions of the others, the second step
+   *  evaluating them without failing but for the metrics of rowwise.
+   */
+  inline void PrepareMetrics(const std::vector<std::unique_ptr<Metric> >& metrics,
+                             DMatrix* data, const std::vector<bst_float>& preds,
+                             std::vector<bst_float>* out, std::vector<size_t>* rowwise,
+                             std::vector<size_t>* others) {
+    const bool distributed = tparam_.dsplit == 2;
+    out->resize(metrics.size());
+    for (size_t j = 0; j < metrics.size(); ++j) {
+      Metric* ev = metrics[j].get();
+      double stats[2] = {0.0, 0.0};
+      if (ev->EvalModel(*gbm_, data, distributed, &(*out)[j])) continue;
+      if (ev->EvalRows(preds, data->Info(), 0, 0, stats)) {
+        rowwise->push_back(j);
+      } else {
+        others->push_back(j);
+      }
+    }
+  }
+  // the second step of EvalMetrics, the metrics of the predictions
+  inline void EvalPrepared(const std::vector<std::unique_ptr<Metric> >& metrics,
+                           DMatrix* data, const std::vector<bst_float>& preds,
+                           const std::vector<size_t>& rowwise,
+                           const std::vector<size_t>& others, std::vector<bst_float>* out) {
+    const bool distributed = tparam_.dsplit == 2;
+    const MetaInfo& info = data->Info();
+    for (size_t j : others) {
+      (*out)[j] = metrics[j]->Eval(preds, info, distributed);
+    }
+    if (rowwise.empty()) return;
+    const size_t nstats = rowwise.size() * 2;
+    const size_t nrow = info.labels_.size();
+    const auto nblock = static_cast<bst_omp_uint>((nrow + kEvalBlockRows - 1) / kEvalBlockRows);
+    std::vector<double> stats(static_cast<size_t>(omp_get_max_threads()) * nstats, 0.0);
+    #pragma omp parallel for schedule(static)
+    for (bst_omp_uint b = 0; b < nblock; ++b) {
+      double* tstats = dmlc::BeginPtr(stats) + omp_get_thread_num() * nstats;
+      const size_t begin = static_cast<size_t>(b) * kEvalBlockRows;
+      const size_t end = std::min(begin + kEvalBlockRows, nrow);
+      for (size_t m = 0; m < rowwise.size(); ++m) {
+        metrics[rowwise[m]]->EvalRows(preds, info, begin, end, tstats + m * 2);
+      }
+    }
+    for (size_t k = nstats; k < stats.size(); ++k) {
+      stats[k % nstats] += stats[k];
+    }
+    if (distributed) {
+      rabit::Allreduce<rabit::op::Sum>(dmlc::BeginPtr(stats), nstats);
+    }
+    for (size_t m = 0; m < rowwise.size(); ++m) {
+      (*out)[rowwise[m]] = metrics[rowwise[m]]->EvalFinal(dmlc::BeginPtr(stats) + m * 2);
+    }
+  }
+  /*!
+   * \brief evaluate the metrics of several data sets at once, each set on a
+   *  thread with a share of the threads of the call proportional to its rows.
+   *
+   *  The predictions, their transforms and the metrics that look into the
+   *  model are computed one set after another, as the predictors keep per
+   *  thread buffers; the metrics of the predictions then run on the thread of
+   *  their set, with their own copies of the metrics for all but the first
+   *  set, as some metrics keep scratch buffers.
+   */
+  void EvalConcurrently(const std::vector<DMatrix*>& data_sets,
+                        std::vector<bst_float>* out_values) {
+    const size_t nset = data_sets.size();
+    while (eval_preds_.size() < nset) {
+      eval_preds_.emplace_back(new HostDeviceVector<bst_float>());
+    }
+    eval_metrics_.resize(nset);
+    for (size_t i = 1; i < nset; ++i) {
+      std::vector<std::unique_ptr<Metric> >& metrics = eval_metrics_[i];
+      bool same = metrics.size() == metrics_.size();
+      for (size_t j = 0; same && j < metrics.size(); ++j) {
+        same = std::strcmp(metrics[j]->Name(), metrics_[j]->Name()) == 0;
+      }
+      if (same) continue;
+      metrics.clear();
+      for (const auto& ev : metrics_) metrics.emplace_back(Metric::Create(ev->Name()));
+    }
+    std::vector<const std::vector<bst_float>*> preds(nset);
+    std::vector<std::vector<bst_float> > values(nset);
+    std::vector<std::vector<size_t> > rowwise(nset), others(nset);
+    size_t total_rows = 0;
+    for (size_t i = 0; i < nset; ++i) {
+      this->PredictRaw(data_sets[i], eval_preds_[i].get());
+      obj_->EvalTransform(eval_preds_[i].get());
+      preds[i] = &eval_preds_[i]->ConstHostVector();
+      this->PrepareMetrics(i == 0 ? metrics_ : eval_metrics_[i], data_sets[i], *preds[i],
+                           &values[i], &rowwise[i], &others[i]);
+      total_rows += data_sets[i]->Info().num_row_;
+    }
+    const size_t nthread = static_cast<size_t>(omp_get_max_threads());
+    std::vector<std::exception_ptr> errors(nset);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < nset; ++i) {
+      const int share = static_cast<int>(std::max<size_t>(
+          nthread * data_sets[i]->Info().num_row_ / std::max<size_t>(total_rows, 1), 1));
+      threads.emplace_back([&, i, share]() {
+          try {
+            common::OmpThreadScope scope(share);
+            this->EvalPrepared(i == 0 ? metrics_ : eval_metrics_[i], data_sets[i], *preds[i],
+                               rowwise[i], others[i], &values[i]);
+          } catch (...) {
+            errors[i] = std::current_exception();
+          }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    for (const auto& error : errors) {
+      if (error != nullptr) std::rethrow_exception(error);
+    }
+    for (const auto& v : values) out_values->insert(out_values->end(), v.begin(), v.end());
+  }
   // return whether model is already initialized.
   inline bool ModelInitialized() const { return gbm_ != nullptr; }
   // lazily initialize the model if it haven't yet been initialized.
@@ -581,6 +945,9 @@ class LearnerImpl : public Learner {
   LearnerTrainParam tparam_;
   // configurations
   std::map<std::string, std::string> cfg_;
+  // arguments of the last Configure, valid when args_configured_
+  std::vector<std::pair<std::string, std::string> > configured_args_;
+  bool args_configured_{false};
   // attributes
   std::map<std::string, std::string> attributes_;
   // name of gbm
@@ -591,10 +958,19 @@ class LearnerImpl : public Learner {
   HostDeviceVector<bst_float> preds_;
   // gradient pairs
   HostDeviceVector<GradientPair> gpair_;
+  // the predictions of the data sets of EvalConcurrently, and the copies of
+  // the metrics of all but the first set
+  std::vector<std::unique_ptr<HostDeviceVector<bst_float> > > eval_preds_;
+  std::vector<std::vector<std::unique_ptr<Metric> > > eval_metrics_;
+  // the training matrix of adversarial training and its number of original rows
+  DMatrix* adv_train_data_{nullptr};
+  size_t adv_train_rows_{0};
 
  private:
   /*! \brief random number transformation seed. */
   static const int kRandSeedMagic = 127;
+  /*! \brief number of rows of a block in EvalMetrics */
+  static const size_t kEvalBlockRows = 4096;
   // internal cached dmatrix
   std::vector<std::shared_ptr<DMatrix> > cache_;
 
@@ -4,10 +4,12 @@
  */
 #pragma once
 #include <algorithm>
+#include <cmath>
 #include <string>
 #include <utility>
 #include <vector>
 #include <limits>
+#include "../common/avx_helpers.h"
 #include "../common/random.h"
 
 namespace xgboost {
@@ -113,6 +115,69 @@ inline std::pair<double, double> GetGradientParallel(int group_idx, int num_grou
   return std::make_pair(sum_grad, sum_hess);
 }
 
+/**
+ * \brief Get the gradient with respect to a single feature, summed eight
+ *        entries at a time with avx::Float8. The gradient pairs of a column
+ *        entry block are gathered into lanes, zero for deleted rows, and the
+ *        lane sums are added in double precision once per chunk of entries.
+ *        Row-wise multithreaded.
+ *
+ * \param group_idx Zero-based index of the group.
+ * \param num_group Number of groups.
+ * \param fidx      The target feature.
+ * \param gpair     Gradients.
+ * \param p_fmat    The feature matrix.
+ *
+ * \return  The gradient and diagonal Hessian entry for a given feature.
+ */
+inline std::pair<double, double> GetGradientVector(int group_idx, int num_group, int fidx,
+                                                   const std::vector<GradientPair> &gpair,
+                                                   DMatrix *p_fmat) {
+  constexpr bst_omp_uint kChunk = 256;
+  double sum_grad = 0.0, sum_hess = 0.0;
+  auto iter = p_fmat->ColIterator();
+  while (iter->Next()) {
+    auto batch = iter->Value();
+    auto col = batch[fidx];
+    const auto ndata = static_cast<bst_omp_uint>(col.length);
+    const bst_omp_uint nchunk = (ndata + kChunk - 1) / kChunk;
+#pragma omp parallel for schedule(static) reduction(+ : sum_grad, sum_hess)
+    for (bst_omp_uint c = 0; c < nchunk; ++c) {
+      const bst_omp_uint begin = c * kChunk;
+      const bst_omp_uint end = std::min(begin + kChunk, ndata);
+      avx::Float8 lane_grad(0.0f), lane_hess(0.0f);
+      float grad[8], hess[8], fvalue[8];
+      bst_omp_uint j = begin;
+      for (; j + 8 <= end; j += 8) {
+        for (int k = 0; k < 8; ++k) {
+          const GradientPair &p = gpair[col[j + k].index * num_group + group_idx];
+          const bool keep = p.GetHess() >= 0.0f;
+          grad[k] = keep ? p.GetGrad() : 0.0f;
+          hess[k] = keep ? p.GetHess() : 0.0f;
+          fvalue[k] = col[j + k].fvalue;
+        }
+        const avx::Float8 v(fvalue);
+        lane_grad += avx::Float8(grad) * v;
+        lane_hess += avx::Float8(hess) * v * v;
+      }
+      avx::Store(grad, lane_grad);
+      avx::Store(hess, lane_hess);
+      for (int k = 0; k < 8; ++k) {
+        sum_grad += grad[k];
+        sum_hess += hess[k];
+      }
+      for (; j < end; ++j) {
+        const bst_float v = col[j].fvalue;
+        auto &p = gpair[col[j].index * num_group + group_idx];
+        if (p.GetHess() < 0.0f) continue;
+        sum_grad += p.GetGrad() * v;
+        sum_hess += p.GetHess() * v * v;
+      }
+    }
+  }
+  return std::make_pair(sum_grad, sum_hess);
+}
+
 /**
  * \brief Get the gradient with respect to the bias. Row-wise multithreaded.
  *
@@ -192,6 +257,56 @@ inline void UpdateBiasResidualParallel(int group_idx, int num_group, float dbias
   }
 }
 
+/**
+ * \brief L1 norm of the feature weights of a group.
+ *
+ * \param model     The linear model.
+ * \param group_idx Zero-based index of the group.
+ *
+ * \return  The sum of the absolute weights, without the bias.
+ */
+inline double WeightL1Norm(const gbm::GBLinearModel &model, int group_idx) {
+  double norm = 0.0;
+  for (unsigned fidx = 0; fidx < model.param.num_feature; ++fidx) {
+    norm += std::abs(model[fidx][group_idx]);
+  }
+  return norm;
+}
+
+/**
+ * \brief Moves the gradient of a binary model to the worst case margin when
+ *        the features of a row may be perturbed by eps in L-inf norm. With
+ *        labels y in {-1, 1} that margin is y * margin - eps * ||w||_1, and
+ *        the gradient is shifted to first order, g -= y * shift * h. The
+ *        derivative of the robust loss in w_j then has the extra term
+ *        eps * sign(w_j) * sum_i -y_i g_i, an L1 penalty that the caller adds
+ *        to reg_alpha.
+ *
+ * \param group_idx Zero-based index of the group.
+ * \param num_group Number of groups.
+ * \param shift     The margin shift, eps * ||w||_1.
+ * \param labels    The labels, positive when above 0.5.
+ * \param in_gpair  The gradient vector to be shifted.
+ *
+ * \return  sum_i -y_i g_i at the shifted margin, the L1 penalty per unit of eps.
+ */
+inline double ShiftRobustGradient(int group_idx, int num_group, double shift,
+                                  const std::vector<bst_float> &labels,
+                                  std::vector<GradientPair> *in_gpair) {
+  const auto ndata = static_cast<bst_omp_uint>(in_gpair->size() / num_group);
+  CHECK_EQ(labels.size(), ndata) << "robust linear models need one label per row";
+  double penalty = 0.0;
+#pragma omp parallel for schedule(static) reduction(+ : penalty)
+  for (bst_omp_uint i = 0; i < ndata; ++i) {
+    GradientPair &p = (*in_gpair)[i * num_group + group_idx];
+    if (p.GetHess() < 0.0f) continue;
+    const double y = labels[i] > 0.5f ? 1.0 : -1.0;
+    p += GradientPair(static_cast<bst_float>(-y * shift * p.GetHess()), 0);
+    penalty -= y * p.GetGrad();
+  }
+  return std::max(penalty, 0.0);
+}
+
 /**
  * \brief Abstract class for stateful feature selection or ordering
  *        in coordinate descent algorithms.
@@ -4,6 +4,9 @@
  */
 
 #include <xgboost/linear_updater.h>
+#include <dmlc/omp.h>
+#include <algorithm>
+#include <vector>
 #include "../common/timer.h"
 #include "coordinate_common.h"
 
@@ -22,6 +25,10 @@ struct CoordinateTrainParam : public dmlc::Parameter<CoordinateTrainParam> {
   float reg_alpha;
   int feature_selector;
   int top_k;
+  /*! \brief L-inf radius of the feature perturbations the model is robust to */
+  float robust_eps;
+  /*! \brief number of selected features updated from the same passes over the rows */
+  int feature_block;
   int debug_verbose;
   // declare parameters
   DMLC_DECLARE_PARAMETER(CoordinateTrainParam) {
@@ -50,6 +57,18 @@ struct CoordinateTrainParam : public dmlc::Parameter<CoordinateTrainParam> {
         .set_default(0)
         .describe("The number of top features to select in 'thrifty' feature_selector. "
                   "The value of zero means using all the features.");
+    DMLC_DECLARE_FIELD(robust_eps)
+        .set_lower_bound(0.0f)
+        .set_default(0.0f)
+        .describe("Train a binary model on the worst case margin under L-inf "
+                  "perturbations of the features of this radius.");
+    DMLC_DECLARE_FIELD(feature_block)
+        .set_lower_bound(1)
+        .set_default(1)
+        .describe("Number of selected features updated from two passes over blocks "
+                  "of rows, with the same result as updating them one at a time. "
+                  "Values above one keep a copy of the columns sorted by row. "
+                  "Not used by the greedy feature_selector.");
     DMLC_DECLARE_FIELD(debug_verbose)
         .set_lower_bound(0)
         .set_default(0)
@@ -69,10 +88,49 @@ struct CoordinateTrainParam : public dmlc::Parameter<CoordinateTrainParam> {
   float reg_alpha_denorm;
 };
 
+/**
+ * \brief Sum of a[i] * b[i] over n floats, n a multiple of 8, in the lanes of
+ *        avx::Float8 and then in double.
+ */
+inline double DotBlock(const float *a, const float *b, size_t n) {
+  avx::Float8 lane(0.0f);
+  for (size_t i = 0; i < n; i += 8) {
+    lane += avx::Float8(a + i) * avx::Float8(b + i);
+  }
+  float out[8];
+  avx::Store(out, lane);
+  double sum = 0.0;
+  for (int k = 0; k < 8; ++k) sum += out[k];
+  return sum;
+}
+
+/*! \brief Sum of a[i] * b[i] * c[i] over n floats, n a multiple of 8. */
+inline double DotBlock(const float *a, const float *b, const float *c, size_t n) {
+  avx::Float8 lane(0.0f);
+  for (size_t i = 0; i < n; i += 8) {
+    lane += avx::Float8(a + i) * avx::Float8(b + i) * avx::Float8(c + i);
+  }
+  float out[8];
+  avx::Store(out, lane);
+  double sum = 0.0;
+  for (int k = 0; k < 8; ++k) sum += out[k];
+  return sum;
+}
+
 /**
  * \class CoordinateUpdater
  *
  * \brief Coordinate descent algorithm that updates one feature per iteration
+ *
+ * \note With feature_block = B > 1 the selected features are taken B at a time.
+ * The residual updates only change the gradients, by h_i * x_ij * dw_j, so the
+ * gradient of the k-th feature of a block after the updates of the features
+ * before it is its gradient at the start of the block plus
+ * sum_{j<k} dw_j * sum_i h_i * x_ij * x_ik. One pass over blocks of rows sums
+ * the gradients, hessians and these cross terms of all the features of the
+ * block, against dense row blocks of their values and of the gradients that
+ * stay in cache, and a second pass applies all the weight changes to the
+ * residuals. The weights are then those of updating the features one at a time.
  */
 
 class CoordinateUpdater : public LinearUpdater {
@@ -88,6 +146,14 @@ class CoordinateUpdater : public LinearUpdater {
               gbm::GBLinearModel *model, double sum_instance_weight) override {
     param.DenormalizePenalties(sum_instance_weight);
     const int ngroup = model->param.num_output_group;
+    if (param.robust_eps > 0.0f) {
+      CHECK_EQ(ngroup, 1) << "robust_eps of gblinear supports binary objectives only";
+      // the robust loss adds eps * ||w||_1 to the margin of every row
+      const double penalty = ShiftRobustGradient(
+          0, ngroup, param.robust_eps * WeightL1Norm(*model, 0),
+          p_fmat->Info().labels_, &in_gpair->HostVector());
+      param.reg_alpha_denorm += static_cast<float>(param.robust_eps * penalty);
+    }
     // update bias
     for (int group_idx = 0; group_idx < ngroup; ++group_idx) {
       auto grad = GetBiasGradientParallel(group_idx, ngroup, in_gpair->HostVector(), p_fmat);
@@ -100,13 +166,28 @@ class CoordinateUpdater : public LinearUpdater {
     // prepare for updating the weights
     selector->Setup(*model, in_gpair->HostVector(), p_fmat, param.reg_alpha_denorm,
                     param.reg_lambda_denorm, param.top_k);
+    // the greedy selector picks each feature from the gradients of the last update
+    const bool blocked = param.feature_block > 1 && param.feature_selector != kGreedy;
+    if (blocked) this->InitRowSortedColumns(p_fmat);
     // update weights
     for (int group_idx = 0; group_idx < ngroup; ++group_idx) {
+      block_fids.clear();
       for (unsigned i = 0U; i < model->param.num_feature; i++) {
         int fidx = selector->NextFeature(i, *model, group_idx, in_gpair->HostVector(), p_fmat,
                                          param.reg_alpha_denorm, param.reg_lambda_denorm);
         if (fidx < 0) break;
-        this->UpdateFeature(fidx, group_idx, &in_gpair->HostVector(), p_fmat, model);
+        if (!blocked) {
+          this->UpdateFeature(fidx, group_idx, &in_gpair->HostVector(), p_fmat, model);
+          continue;
+        }
+        block_fids.push_back(fidx);
+        if (block_fids.size() == static_cast<size_t>(param.feature_block)) {
+          this->UpdateFeatureBlock(block_fids, group_idx, &in_gpair->HostVector(), model);
+          block_fids.clear();
+        }
+      }
+      if (!block_fids.empty()) {
+        this->UpdateFeatureBlock(block_fids, group_idx, &in_gpair->HostVector(), model);
       }
     }
     monitor.Stop("UpdateFeature");
@@ -116,7 +197,8 @@ class CoordinateUpdater : public LinearUpdater {
                             DMatrix *p_fmat, gbm::GBLinearModel *model) {
     const int ngroup = model->param.num_output_group;
     bst_float &w = (*model)[fidx][group_idx];
-    auto gradient =
+    auto gradient = param.robust_eps > 0.0f ?
+        GetGradientVector(group_idx, ngroup, fidx, *in_gpair, p_fmat) :
         GetGradientParallel(group_idx, ngroup, fidx, *in_gpair, p_fmat);
     auto dw = static_cast<float>(
         param.learning_rate *
@@ -126,12 +208,175 @@ class CoordinateUpdater : public LinearUpdater {
     UpdateResidualParallel(fidx, group_idx, ngroup, dw, in_gpair, p_fmat);
   }
 
+  // copy the columns of p_fmat with their entries sorted by row, once per matrix
+  inline void InitRowSortedColumns(DMatrix *p_fmat) {
+    const MetaInfo &info = p_fmat->Info();
+    if (sorted_fmat == p_fmat && sorted_num_row == info.num_row_ &&
+        sorted_col_ptr.size() == info.num_col_ + 1) {
+      return;
+    }
+    const auto ncol = static_cast<bst_omp_uint>(info.num_col_);
+    sorted_col_ptr.assign(ncol + 1, 0);
+    auto iter = p_fmat->ColIterator();
+    while (iter->Next()) {
+      auto batch = iter->Value();
+      for (bst_omp_uint fid = 0; fid < ncol; ++fid) {
+        sorted_col_ptr[fid + 1] += batch[fid].length;
+      }
+    }
+    for (bst_omp_uint fid = 0; fid < ncol; ++fid) {
+      sorted_col_ptr[fid + 1] += sorted_col_ptr[fid];
+    }
+    sorted_data.resize(sorted_col_ptr.back());
+    std::vector<size_t> fill(sorted_col_ptr.begin(), sorted_col_ptr.end() - 1);
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      auto batch = iter->Value();
+      for (bst_omp_uint fid = 0; fid < ncol; ++fid) {
+        auto col = batch[fid];
+        std::copy(col.data, col.data + col.length, sorted_data.begin() + fill[fid]);
+        fill[fid] += col.length;
+      }
+    }
+#pragma omp parallel for schedule(dynamic)
+    for (bst_omp_uint fid = 0; fid < ncol; ++fid) {
+      std::sort(sorted_data.begin() + sorted_col_ptr[fid],
+                sorted_data.begin() + sorted_col_ptr[fid + 1],
+                [](const Entry &a, const Entry &b) { return a.index < b.index; });
+    }
+    sorted_fmat = p_fmat;
+    sorted_num_row = info.num_row_;
+  }
+  // the dense values of the features of fids in the rows [begin, begin + size)
+  // into x, feature k at x[k * kBlockRows], zero padded to a multiple of 8
+  inline void FillRowBlock(const std::vector<int> &fids, size_t begin, size_t size,
+                           float *x) const {
+    const size_t padded = (size + 7) / 8 * 8;
+    const auto cmp = [](const Entry &e, size_t row) { return e.index < row; };
+    for (size_t k = 0; k < fids.size(); ++k) {
+      float *xk = x + k * kBlockRows;
+      std::fill(xk, xk + padded, 0.0f);
+      const Entry *first = dmlc::BeginPtr(sorted_data) + sorted_col_ptr[fids[k]];
+      const Entry *last = dmlc::BeginPtr(sorted_data) + sorted_col_ptr[fids[k] + 1];
+      const Entry *it = std::lower_bound(first, last, begin, cmp);
+      for (; it != last && it->index < begin + size; ++it) {
+        xk[it->index - begin] = it->fvalue;
+      }
+    }
+  }
+  // update the features of fids in turn, from two passes over the rows
+  inline void UpdateFeatureBlock(const std::vector<int> &fids, int group_idx,
+                                 std::vector<GradientPair> *in_gpair,
+                                 gbm::GBLinearModel *model) {
+    const int ngroup = model->param.num_output_group;
+    const size_t nfeat = fids.size();
+    const size_t nrow = in_gpair->size() / ngroup;
+    const auto nblock = static_cast<bst_omp_uint>((nrow + kBlockRows - 1) / kBlockRows);
+    // the gradients of the features, their hessians, then the cross terms of
+    // features j < k at 2 * nfeat + j * nfeat + k
+    const size_t nsum = nfeat * (nfeat + 2);
+    const int nthread = omp_get_max_threads();
+    thread_sum.assign(nthread * nsum, 0.0);
+    thread_buffer.resize(nthread);
+#pragma omp parallel num_threads(nthread)
+    {
+      double *sum = dmlc::BeginPtr(thread_sum) + omp_get_thread_num() * nsum;
+      std::vector<float> &buf = thread_buffer[omp_get_thread_num()];
+      buf.resize((nfeat + 2) * kBlockRows);
+      float *x = dmlc::BeginPtr(buf);
+      float *grad = x + nfeat * kBlockRows, *hess = grad + kBlockRows;
+#pragma omp for schedule(static)
+      for (bst_omp_uint b = 0; b < nblock; ++b) {
+        const size_t begin = static_cast<size_t>(b) * kBlockRows;
+        const size_t size = std::min(kBlockRows, nrow - begin);
+        const size_t padded = (size + 7) / 8 * 8;
+        this->FillRowBlock(fids, begin, size, x);
+        for (size_t i = 0; i < padded; ++i) {
+          const GradientPair p = i < size ? (*in_gpair)[(begin + i) * ngroup + group_idx]
+                                          : GradientPair(0.0f, 0.0f);
+          // the deleted rows add nothing
+          const bool keep = p.GetHess() >= 0.0f;
+          grad[i] = keep ? p.GetGrad() : 0.0f;
+          hess[i] = keep ? p.GetHess() : 0.0f;
+        }
+        for (size_t k = 0; k < nfeat; ++k) {
+          const float *xk = x + k * kBlockRows;
+          sum[k] += DotBlock(grad, xk, padded);
+          sum[nfeat + k] += DotBlock(hess, xk, xk, padded);
+          for (size_t j = 0; j < k; ++j) {
+            sum[2 * nfeat + j * nfeat + k] += DotBlock(hess, x + j * kBlockRows, xk, padded);
+          }
+        }
+      }
+    }
+    for (int t = 1; t < nthread; ++t) {
+      for (size_t i = 0; i < nsum; ++i) thread_sum[i] += thread_sum[t * nsum + i];
+    }
+    std::vector<float> dws(nfeat);
+    bool changed = false;
+    for (size_t k = 0; k < nfeat; ++k) {
+      double sum_grad = thread_sum[k];
+      for (size_t j = 0; j < k; ++j) {
+        sum_grad += thread_sum[2 * nfeat + j * nfeat + k] * dws[j];
+      }
+      bst_float &w = (*model)[fids[k]][group_idx];
+      dws[k] = static_cast<float>(
+          param.learning_rate *
+          CoordinateDelta(sum_grad, thread_sum[nfeat + k], w, param.reg_alpha_denorm,
+                          param.reg_lambda_denorm));
+      w += dws[k];
+      changed = changed || dws[k] != 0.0f;
+    }
+    if (!changed) return;
+#pragma omp parallel num_threads(nthread)
+    {
+      std::vector<float> &buf = thread_buffer[omp_get_thread_num()];
+      float *x = dmlc::BeginPtr(buf);
+      float *delta = x + nfeat * kBlockRows;
+#pragma omp for schedule(static)
+      for (bst_omp_uint b = 0; b < nblock; ++b) {
+        const size_t begin = static_cast<size_t>(b) * kBlockRows;
+        const size_t size = std::min(kBlockRows, nrow - begin);
+        const size_t padded = (size + 7) / 8 * 8;
+        this->FillRowBlock(fids, begin, size, x);
+        // the change of the margin of each row
+        for (size_t i = 0; i < padded; i += 8) {
+          avx::Float8 lane(0.0f);
+          for (size_t k = 0; k < nfeat; ++k) {
+            lane += avx::Float8(x + k * kBlockRows + i) * avx::Float8(dws[k]);
+          }
+          avx::Store(delta + i, lane);
+        }
+        for (size_t i = 0; i < size; ++i) {
+          GradientPair &p = (*in_gpair)[(begin + i) * ngroup + group_idx];
+          if (p.GetHess() < 0.0f) continue;
+          p += GradientPair(p.GetHess() * delta[i], 0);
+        }
+      }
+    }
+  }
+
+  // rows of a block of UpdateFeatureBlock, the values of a block of features
+  // and the gradients of its rows stay in the L2 cache
+  static constexpr size_t kBlockRows = 2048;
   // training parameter
   CoordinateTrainParam param;
   std::unique_ptr<FeatureSelector> selector;
   common::Monitor monitor;
+  // the features of the current block
+  std::vector<int> block_fids;
+  // the columns of sorted_fmat with their entries sorted by row
+  const DMatrix *sorted_fmat{nullptr};
+  uint64_t sorted_num_row{0};
+  std::vector<size_t> sorted_col_ptr;
+  std::vector<Entry> sorted_data;
+  // sums and row block buffers of each thread
+  std::vector<double> thread_sum;
+  std::vector<std::vector<float> > thread_buffer;
 };
 
+constexpr size_t CoordinateUpdater::kBlockRows;
+
 DMLC_REGISTER_PARAMETER(CoordinateTrainParam);
 XGBOOST_REGISTER_LINEAR_UPDATER(CoordinateUpdater, "coord_descent")
     .describe("Update linear model according to coordinate descent algorithm.")
@@ -4,6 +4,11 @@
  */
 
 #include <xgboost/linear_updater.h>
+#include <dmlc/omp.h>
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
 #include "coordinate_common.h"
 
 namespace xgboost {
@@ -11,6 +16,9 @@ namespace linear {
 
 DMLC_REGISTRY_FILE_TAG(updater_shotgun);
 
+/*! \brief how the features are shared by the threads */
+enum FeaturePartition { kHogwild = 0, kBlock = 1 };
+
 // training parameter
 struct ShotgunTrainParam : public dmlc::Parameter<ShotgunTrainParam> {
   /*! \brief learning_rate */
@@ -20,6 +28,8 @@ struct ShotgunTrainParam : public dmlc::Parameter<ShotgunTrainParam> {
   /*! \brief regularization weight for L1 norm */
   float reg_alpha;
   int feature_selector;
+  /*! \brief how the features are shared by the threads */
+  int feature_partition;
   // declare parameters
   DMLC_DECLARE_PARAMETER(ShotgunTrainParam) {
     DMLC_DECLARE_FIELD(learning_rate)
@@ -39,6 +49,14 @@ struct ShotgunTrainParam : public dmlc::Parameter<ShotgunTrainParam> {
         .add_enum("cyclic", kCyclic)
         .add_enum("shuffle", kShuffle)
         .describe("Feature selection or ordering method.");
+    DMLC_DECLARE_FIELD(feature_partition)
+        .set_default(kHogwild)
+        .add_enum("hogwild", kHogwild)
+        .add_enum("block", kBlock)
+        .describe("hogwild: threads update any feature and the shared gradient "
+                  "directly. block: each thread updates a block of features that "
+                  "touch few rows of the other blocks, in a residual buffer of "
+                  "its own that is merged at the end of each pass.");
     // alias of parameters
     DMLC_DECLARE_ALIAS(learning_rate, eta);
     DMLC_DECLARE_ALIAS(reg_lambda, lambda);
@@ -76,6 +94,10 @@ class ShotgunUpdater : public LinearUpdater {
       UpdateBiasResidualParallel(gid, ngroup, dbias, &in_gpair->HostVector(), p_fmat);
     }
 
+    if (param_.feature_partition == kBlock) {
+      this->UpdateBlocks(&gpair, p_fmat, model);
+      return;
+    }
     // lock-free parallel updates of weights
     selector_->Setup(*model, in_gpair->HostVector(), p_fmat,
                      param_.reg_alpha_denorm, param_.reg_lambda_denorm, 0);
@@ -118,10 +140,148 @@ class ShotgunUpdater : public LinearUpdater {
   }
 
  protected:
+  /*!
+   * \brief one pass over the features in blocks. A thread reads the shared
+   *  gradient plus its own residual and writes only the residual, so that no
+   *  gradient line is written by several threads during the pass; the
+   *  residuals are added to the gradient after each column batch.
+   */
+  void UpdateBlocks(std::vector<GradientPair> *gpair, DMatrix *p_fmat,
+                    gbm::GBLinearModel *model) {
+    const int ngroup = model->param.num_output_group;
+    const int nthread = omp_get_max_threads();
+    if (block_fmat_ != p_fmat || blocks_.size() != static_cast<size_t>(nthread)) {
+      this->InitBlocks(p_fmat, nthread);
+    }
+    if (param_.feature_selector == kShuffle) {
+      for (auto &block : blocks_) {
+        std::shuffle(block.begin(), block.end(), common::GlobalRandom());
+      }
+    }
+    residual_.resize(nthread);
+    for (auto &r : residual_) r.assign(gpair->size(), 0.0f);
+    auto iter = p_fmat->ColIterator();
+    while (iter->Next()) {
+      auto batch = iter->Value();
+      const auto nblock = static_cast<bst_omp_uint>(blocks_.size());
+#pragma omp parallel for schedule(dynamic, 1)
+      for (bst_omp_uint b = 0; b < nblock; ++b) {
+        bst_float *residual = dmlc::BeginPtr(residual_[omp_get_thread_num()]);
+        for (bst_uint fid : blocks_[b]) {
+          if (fid >= batch.Size()) continue;
+          auto col = batch[fid];
+          for (int gid = 0; gid < ngroup; ++gid) {
+            double sum_grad = 0.0, sum_hess = 0.0;
+            for (bst_uint j = 0; j < col.length; ++j) {
+              const size_t ridx = col[j].index * ngroup + gid;
+              const GradientPair &p = (*gpair)[ridx];
+              if (p.GetHess() < 0.0f) continue;
+              const bst_float v = col[j].fvalue;
+              sum_grad += (p.GetGrad() + residual[ridx]) * v;
+              sum_hess += p.GetHess() * v * v;
+            }
+            bst_float &w = (*model)[fid][gid];
+            auto dw = static_cast<bst_float>(
+                param_.learning_rate *
+                CoordinateDelta(sum_grad, sum_hess, w, param_.reg_alpha_denorm,
+                                param_.reg_lambda_denorm));
+            if (dw == 0.f) continue;
+            w += dw;
+            for (bst_uint j = 0; j < col.length; ++j) {
+              const size_t ridx = col[j].index * ngroup + gid;
+              const GradientPair &p = (*gpair)[ridx];
+              if (p.GetHess() < 0.0f) continue;
+              residual[ridx] += p.GetHess() * col[j].fvalue * dw;
+            }
+          }
+        }
+      }
+      // merge the residuals of the threads
+      const auto ndata = static_cast<bst_omp_uint>(gpair->size());
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < ndata; ++i) {
+        bst_float sum = 0.0f;
+        for (auto &r : residual_) {
+          sum += r[i];
+          r[i] = 0.0f;
+        }
+        if (sum != 0.0f) (*gpair)[i] += GradientPair(sum, 0);
+      }
+    }
+  }
+  /*!
+   * \brief assign the features to nthread blocks of balanced nonzeros. The
+   *  rows are cut in 64 ranges and each feature, largest first, joins the
+   *  block below the average size whose ranges it overlaps least, so that
+   *  the blocks update mostly disjoint parts of the gradient.
+   */
+  void InitBlocks(DMatrix *p_fmat, int nthread) {
+    const size_t nrow = std::max(p_fmat->Info().num_row_, static_cast<uint64_t>(1));
+    const size_t ncol = p_fmat->Info().num_col_;
+    std::vector<uint64_t> range_mask(ncol, 0);
+    std::vector<size_t> nnz(ncol, 0);
+    auto iter = p_fmat->ColIterator();
+    while (iter->Next()) {
+      auto batch = iter->Value();
+      const auto nfeat = static_cast<bst_omp_uint>(std::min(batch.Size(), ncol));
+#pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nfeat; ++i) {
+        auto col = batch[i];
+        nnz[i] += col.length;
+        for (bst_uint j = 0; j < col.length; ++j) {
+          range_mask[i] |= static_cast<uint64_t>(1) << (static_cast<size_t>(col[j].index) * 64 / nrow);
+        }
+      }
+    }
+    std::vector<bst_uint> order(ncol);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](bst_uint a, bst_uint b) { return nnz[a] > nnz[b]; });
+    const double average =
+        std::accumulate(nnz.begin(), nnz.end(), 0.0) / std::max(nthread, 1);
+    blocks_.assign(nthread, std::vector<bst_uint>());
+    std::vector<uint64_t> block_mask(nthread, 0);
+    std::vector<size_t> block_nnz(nthread, 0);
+    for (bst_uint fid : order) {
+      if (nnz[fid] == 0) continue;
+      int best = 0;
+      for (int b = 1; b < nthread; ++b) {
+        if (block_nnz[b] < block_nnz[best]) best = b;
+      }
+      int best_overlap = PopCount(block_mask[best] & range_mask[fid]);
+      for (int b = 0; b < nthread; ++b) {
+        if (block_nnz[b] + nnz[fid] > average + nnz[fid] / 2) continue;
+        const int overlap = PopCount(block_mask[b] & range_mask[fid]);
+        if (overlap < best_overlap) {
+          best = b;
+          best_overlap = overlap;
+        }
+      }
+      blocks_[best].push_back(fid);
+      block_mask[best] |= range_mask[fid];
+      block_nnz[best] += nnz[fid];
+    }
+    block_fmat_ = p_fmat;
+  }
+  static inline int PopCount(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    for (; x != 0; x &= x - 1) ++n;
+    return n;
+#endif
+  }
+
   // training parameters
   ShotgunTrainParam param_;
 
   std::unique_ptr<FeatureSelector> selector_;
+  /*! \brief features of the blocks, built for block_fmat_ */
+  std::vector<std::vector<bst_uint> > blocks_;
+  const DMatrix *block_fmat_{nullptr};
+  /*! \brief per thread changes of the gradient during a pass */
+  std::vector<std::vector<bst_float> > residual_;
 };
 
 DMLC_REGISTER_PARAMETER(ShotgunTrainParam);
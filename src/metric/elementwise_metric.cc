@@ -9,6 +9,7 @@
 #include <cmath>
 #include "../common/math.h"
 #include "../common/sync.h"
+#include "../common/threading.h"
 
 namespace xgboost {
 namespace metric {
@@ -28,20 +29,40 @@ struct EvalEWiseBase : public Metric {
     CHECK_EQ(preds.size(), info.labels_.size())
         << "label and prediction size not match, "
         << "hint: use merror or mlogloss for multi-class classification";
-    const auto ndata = static_cast<omp_ulong>(info.labels_.size());
-    double sum = 0.0, wsum = 0.0;
-    #pragma omp parallel for reduction(+: sum, wsum) schedule(static)
-    for (omp_ulong i = 0; i < ndata; ++i) {
+    double dat[2];
+    common::ParallelSum(info.labels_.size(), dat, [&](size_t i, double* sums) {
       const bst_float wt = info.GetWeight(i);
-      sum += static_cast<const Derived*>(this)->EvalRow(info.labels_[i], preds[i]) * wt;
-      wsum += wt;
-    }
-    double dat[2]; dat[0] = sum, dat[1] = wsum;
+      sums[0] += static_cast<const Derived*>(this)->EvalRow(info.labels_[i], preds[i]) * wt;
+      sums[1] += wt;
+    });
     if (distributed) {
       rabit::Allreduce<rabit::op::Sum>(dat, 2);
     }
     return Derived::GetFinal(dat[0], dat[1]);
   }
+  bool EvalRows(const std::vector<bst_float>& preds,
+                const MetaInfo& info, size_t begin, size_t end,
+                double* stats) const override {
+    if (begin == end) {
+      CHECK_NE(info.labels_.size(), 0U) << "label set cannot be empty";
+      CHECK_EQ(preds.size(), info.labels_.size())
+          << "label and prediction size not match, "
+          << "hint: use merror or mlogloss for multi-class classification";
+      return true;
+    }
+    double sum = 0.0, wsum = 0.0;
+    for (size_t i = begin; i < end; ++i) {
+      const bst_float wt = info.GetWeight(i);
+      sum += static_cast<const Derived*>(this)->EvalRow(info.labels_[i], preds[i]) * wt;
+      wsum += wt;
+    }
+    stats[0] += sum;
+    stats[1] += wsum;
+    return true;
+  }
+  bst_float EvalFinal(const double* stats) const override {
+    return Derived::GetFinal(stats[0], stats[1]);
+  }
   /*!
    * \brief to be implemented by subclass,
    *   get evaluation result from one row
@@ -38,5 +38,6 @@ namespace metric {
 DMLC_REGISTRY_LINK_TAG(elementwise_metric);
 DMLC_REGISTRY_LINK_TAG(multiclass_metric);
 DMLC_REGISTRY_LINK_TAG(rank_metric);
+DMLC_REGISTRY_LINK_TAG(robust_metric);
 }  // namespace metric
 }  // namespace xgboost
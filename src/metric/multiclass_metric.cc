@@ -6,7 +6,11 @@
  */
 #include <xgboost/metric.h>
 #include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <string>
 #include "../common/sync.h"
+#include "../common/threading.h"
 #include "../common/math.h"
 
 namespace xgboost {
@@ -16,6 +20,11 @@ DMLC_REGISTRY_FILE_TAG(multiclass_metric);
 
 /*!
  * \brief base class of multi-class evaluation
+ *
+ *  The metrics are weighted means over the rows, so the learner sums them
+ *  with EvalRows together with the other such metrics in one pass over
+ *  blocks of the predictions, each block of class scores read by all of them
+ *  while it is in cache.
  * \tparam Derived the name of subclass
  */
 template<typename Derived>
@@ -23,39 +32,58 @@ struct EvalMClassBase : public Metric {
   bst_float Eval(const std::vector<bst_float> &preds,
                  const MetaInfo &info,
                  bool distributed) const override {
-    CHECK_NE(info.labels_.size(), 0U) << "label set cannot be empty";
-    CHECK(preds.size() % info.labels_.size() == 0)
-        << "label and prediction size not match";
-    const size_t nclass = preds.size() / info.labels_.size();
-    CHECK_GE(nclass, 1U)
-        << "mlogloss and merror are only used for multi-class classification,"
-        << " use logloss for binary classification";
-    const auto ndata = static_cast<bst_omp_uint>(info.labels_.size());
-    double sum = 0.0, wsum = 0.0;
+    const size_t nclass = NumClass(preds, info);
     int label_error = 0;
-    #pragma omp parallel for reduction(+: sum, wsum) schedule(static)
-    for (bst_omp_uint i = 0; i < ndata; ++i) {
+    double dat[2];
+    common::ParallelSum(info.labels_.size(), dat, [&](size_t i, double* sums) {
       const bst_float wt = info.GetWeight(i);
       auto label =  static_cast<int>(info.labels_[i]);
       if (label >= 0 && label < static_cast<int>(nclass)) {
-        sum += Derived::EvalRow(label,
-                                preds.data() + i * nclass,
-                                nclass) * wt;
-        wsum += wt;
+        sums[0] += static_cast<const Derived*>(this)->EvalRow(label,
+                                                              preds.data() + i * nclass,
+                                                              nclass) * wt;
+        sums[1] += wt;
       } else {
         label_error = label;
       }
-    }
-    CHECK(label_error >= 0 && label_error < static_cast<int>(nclass))
-        << "MultiClassEvaluation: label must be in [0, num_class),"
-        << " num_class=" << nclass << " but found " << label_error << " in label";
+    });
+    CheckLabel(label_error, nclass);
 
-    double dat[2]; dat[0] = sum, dat[1] = wsum;
     if (distributed) {
       rabit::Allreduce<rabit::op::Sum>(dat, 2);
     }
     return Derived::GetFinal(dat[0], dat[1]);
   }
+  bool EvalRows(const std::vector<bst_float>& preds,
+                const MetaInfo& info, size_t begin, size_t end,
+                double* stats) const override {
+    const size_t nclass = NumClass(preds, info);
+    if (begin == end) {
+      // the blocks must not fail, so the labels are checked up front
+      int label_error = 0;
+      for (bst_float label : info.labels_) {
+        if (label < 0 || label >= static_cast<bst_float>(nclass)) {
+          label_error = static_cast<int>(label);
+        }
+      }
+      CheckLabel(label_error, nclass);
+      return true;
+    }
+    double sum = 0.0, wsum = 0.0;
+    for (size_t i = begin; i < end; ++i) {
+      const bst_float wt = info.GetWeight(i);
+      sum += static_cast<const Derived*>(this)->EvalRow(static_cast<int>(info.labels_[i]),
+                                                        preds.data() + i * nclass,
+                                                        nclass) * wt;
+      wsum += wt;
+    }
+    stats[0] += sum;
+    stats[1] += wsum;
+    return true;
+  }
+  bst_float EvalFinal(const double* stats) const override {
+    return Derived::GetFinal(stats[0], stats[1]);
+  }
   /*!
    * \brief to be implemented by subclass,
    *   get evaluation result from one row
@@ -63,9 +91,9 @@ struct EvalMClassBase : public Metric {
    * \param pred prediction value of current instance
    * \param nclass number of class in the prediction
    */
-  inline static bst_float EvalRow(int label,
-                                  const bst_float *pred,
-                                  size_t nclass);
+  inline bst_float EvalRow(int label,
+                           const bst_float *pred,
+                           size_t nclass) const;
   /*!
    * \brief to be overridden by subclass, final transformation
    * \param esum the sum statistics returned by EvalRow
@@ -74,20 +102,65 @@ struct EvalMClassBase : public Metric {
   inline static bst_float GetFinal(bst_float esum, bst_float wsum) {
     return esum / wsum;
   }
-  // used to store error message
-  const char *error_msg_;
+
+ private:
+  // the number of classes of the predictions
+  static size_t NumClass(const std::vector<bst_float> &preds, const MetaInfo &info) {
+    CHECK_NE(info.labels_.size(), 0U) << "label set cannot be empty";
+    CHECK(preds.size() % info.labels_.size() == 0)
+        << "label and prediction size not match";
+    const size_t nclass = preds.size() / info.labels_.size();
+    CHECK_GE(nclass, 1U)
+        << "mlogloss and merror are only used for multi-class classification,"
+        << " use logloss for binary classification";
+    return nclass;
+  }
+  static void CheckLabel(int label_error, size_t nclass) {
+    CHECK(label_error >= 0 && label_error < static_cast<int>(nclass))
+        << "MultiClassEvaluation: label must be in [0, num_class),"
+        << " num_class=" << nclass << " but found " << label_error << " in label";
+  }
 };
 
-/*! \brief match error */
+/*! \brief match error, or the error of the top k classes with merror@k */
 struct EvalMatchError : public EvalMClassBase<EvalMatchError> {
+  explicit EvalMatchError(const char* param) {
+    if (param != nullptr) {
+      std::ostringstream os;
+      os << "merror";
+      CHECK_EQ(sscanf(param, "%d", &topk_), 1)
+        << "unable to parse the number of classes for the merror metric";
+      CHECK_GE(topk_, 1) << "merror@k needs k >= 1";
+      if (topk_ != 1) os << '@' << topk_;
+      name_ = os.str();
+    } else {
+      topk_ = 1;
+      name_ = "merror";
+    }
+  }
   const char* Name() const override {
-    return "merror";
+    return name_.c_str();
   }
-  inline static bst_float EvalRow(int label,
-                                  const bst_float *pred,
-                                  size_t nclass) {
-    return common::FindMaxIndex(pred, pred + nclass) != pred + static_cast<int>(label);
+  inline bst_float EvalRow(int label,
+                           const bst_float *pred,
+                           size_t nclass) const {
+    // the classes ranked before the label, the first of equal scores ranked
+    // first as by FindMaxIndex; counting instead of an arg-max keeps the
+    // loops free of branches, so they are vectorised
+    const bst_float score = pred[label];
+    int rank = 0;
+    for (int j = 0; j < label; ++j) {
+      rank += pred[j] >= score;
+    }
+    for (int j = label + 1; j < static_cast<int>(nclass); ++j) {
+      rank += pred[j] > score;
+    }
+    return rank >= topk_ ? 1.0f : 0.0f;
   }
+
+ protected:
+  int topk_;
+  std::string name_;
 };
 
 /*! \brief match error */
@@ -95,9 +168,9 @@ struct EvalMultiLogLoss : public EvalMClassBase<EvalMultiLogLoss> {
   const char* Name() const override {
     return "mlogloss";
   }
-  inline static bst_float EvalRow(int label,
-                                  const bst_float *pred,
-                                  size_t nclass) {
+  inline bst_float EvalRow(int label,
+                           const bst_float *pred,
+                           size_t nclass) const {
     const bst_float eps = 1e-16f;
     auto k = static_cast<size_t>(label);
     if (pred[k] > eps) {
@@ -109,8 +182,8 @@ struct EvalMultiLogLoss : public EvalMClassBase<EvalMultiLogLoss> {
 };
 
 XGBOOST_REGISTER_METRIC(MatchError, "merror")
-.describe("Multiclass classification error.")
-.set_body([](const char* param) { return new EvalMatchError(); });
+.describe("Multiclass classification error, of the top k classes with merror@k.")
+.set_body([](const char* param) { return new EvalMatchError(param); });
 
 XGBOOST_REGISTER_METRIC(MultiLogLoss, "mlogloss")
 .describe("Multiclass negative loglikelihood.")
@@ -8,13 +8,31 @@
 #include <dmlc/registry.h>
 #include <cmath>
 #include "../common/sync.h"
+#include "../common/threading.h"
 #include "../common/math.h"
+#include "../common/radix_sort.h"
 
 namespace xgboost {
 namespace metric {
 // tag the this file, used by force static link later.
 DMLC_REGISTRY_FILE_TAG(rank_metric);
 
+/*! \brief number of predictions from which a group is radix sorted */
+constexpr size_t kRadixSortSize = 1 << 16;
+
+/*!
+ * \brief sort the (prediction, index) pairs of a group by descending prediction,
+ *  large groups, e.g. the single group of a binary task, are radix sorted
+ */
+inline void SortByPrediction(std::vector<std::pair<bst_float, unsigned> >* rec,
+                             std::vector<std::pair<bst_float, unsigned> >* scratch) {
+  if (rec->size() >= kRadixSortSize) {
+    common::RadixSortFirstDescending(rec, scratch);
+  } else {
+    XGBOOST_PARALLEL_SORT(rec->begin(), rec->end(), common::CmpFirst);
+  }
+}
+
 /*! \brief AMS: also records best threshold */
 struct EvalAMS : public Metric {
  public:
@@ -35,10 +53,9 @@ struct EvalAMS : public Metric {
     const auto ndata = static_cast<bst_omp_uint>(info.labels_.size());
     std::vector<std::pair<bst_float, unsigned> > rec(ndata);
 
-    #pragma omp parallel for schedule(static)
-    for (bst_omp_uint i = 0; i < ndata; ++i) {
+    common::ParallelFor(ndata, [&](size_t i) {
       rec[i] = std::make_pair(preds[i], i);
-    }
+    });
     std::sort(rec.begin(), rec.end(), common::CmpFirst);
     auto ntop = static_cast<unsigned>(ratio_ * ndata);
     if (ntop == 0) ntop = ndata;
@@ -97,14 +114,16 @@ struct EvalAuc : public Metric {
     // sum statistics
     bst_float sum_auc = 0.0f;
     int auc_error = 0;
-    // each thread takes a local rec
-    std::vector< std::pair<bst_float, unsigned> > rec;
+    // the buffers are kept across rounds
+    std::vector< std::pair<bst_float, unsigned> > &rec = rec_;
     for (bst_omp_uint k = 0; k < ngroup; ++k) {
-      rec.clear();
-      for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
-        rec.emplace_back(preds[j], j);
+      const auto nrec = static_cast<bst_omp_uint>(gptr[k + 1] - gptr[k]);
+      rec.resize(nrec);
+      #pragma omp parallel for schedule(static) if (nrec >= kRadixSortSize)
+      for (bst_omp_uint j = 0; j < nrec; ++j) {
+        rec[j] = std::make_pair(preds[gptr[k] + j], gptr[k] + j);
       }
-      XGBOOST_PARALLEL_SORT(rec.begin(), rec.end(), common::CmpFirst);
+      SortByPrediction(&rec, &scratch_);
       // calculate AUC
       double sum_pospair = 0.0;
       double sum_npos = 0.0, sum_nneg = 0.0, buf_pos = 0.0, buf_neg = 0.0;
@@ -148,6 +167,10 @@ struct EvalAuc : public Metric {
   const char* Name() const override {
     return "auc";
   }
+
+ private:
+  mutable std::vector< std::pair<bst_float, unsigned> > rec_;
+  mutable std::vector< std::pair<bst_float, unsigned> > scratch_;
 };
 
 /*! \brief Evaluate rank list */
@@ -167,20 +190,18 @@ struct EvalRankList : public Metric {
         << "EvalRanklist: group structure must match number of prediction";
     const auto ngroup = static_cast<bst_omp_uint>(gptr.size() - 1);
     // sum statistics
-    double sum_metric = 0.0f;
-    #pragma omp parallel reduction(+:sum_metric)
-    {
-      // each thread takes a local rec
-      std::vector< std::pair<bst_float, unsigned> > rec;
-      #pragma omp for schedule(static)
-      for (bst_omp_uint k = 0; k < ngroup; ++k) {
-        rec.clear();
-        for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
-          rec.emplace_back(preds[j], static_cast<int>(info.labels_[j]));
-        }
-        sum_metric += this->EvalMetric(rec);
+    double sum[1];
+    thread_rec_.resize(omp_get_max_threads());
+    common::ParallelSum(ngroup, sum, [&](size_t k, double* sums) {
+      // each thread takes a local rec, kept across rounds
+      std::vector< std::pair<bst_float, unsigned> > &rec = thread_rec_[common::ThreadId()];
+      rec.clear();
+      for (unsigned j = gptr[k]; j < gptr[k + 1]; ++j) {
+        rec.emplace_back(preds[j], static_cast<int>(info.labels_[j]));
       }
-    }
+      sums[0] += this->EvalMetric(rec);
+    });
+    const double sum_metric = sum[0];
     if (distributed) {
       bst_float dat[2];
       dat[0] = static_cast<bst_float>(sum_metric);
@@ -222,6 +243,9 @@ struct EvalRankList : public Metric {
   unsigned topn_;
   std::string name_;
   bool minus_;
+
+ private:
+  mutable std::vector<std::vector<std::pair<bst_float, unsigned> > > thread_rec_;
 };
 
 /*! \brief Precision at N, for both classification and rank */
@@ -371,8 +395,8 @@ struct EvalAucPR : public Metric {
     // sum statistics
     double auc = 0.0;
     int auc_error = 0, auc_gt_one = 0;
-    // each thread takes a local rec
-    std::vector<std::pair<bst_float, unsigned>> rec;
+    // the buffers are kept across rounds
+    std::vector<std::pair<bst_float, unsigned>> &rec = rec_;
     for (bst_omp_uint k = 0; k < ngroup; ++k) {
       double total_pos = 0.0;
       double total_neg = 0.0;
@@ -382,7 +406,7 @@ struct EvalAucPR : public Metric {
         total_neg += info.GetWeight(j) * (1.0f - info.labels_[j]);
         rec.emplace_back(preds[j], j);
       }
-      XGBOOST_PARALLEL_SORT(rec.begin(), rec.end(), common::CmpFirst);
+      SortByPrediction(&rec, &scratch_);
       // we need pos > 0 && neg > 0
       if (0.0 == total_pos || 0.0 == total_neg) {
         auc_error = 1;
@@ -434,6 +458,10 @@ struct EvalAucPR : public Metric {
     }
   }
   const char *Name() const override { return "aucpr"; }
+
+ private:
+  mutable std::vector<std::pair<bst_float, unsigned>> rec_;
+  mutable std::vector<std::pair<bst_float, unsigned>> scratch_;
 };
 
 
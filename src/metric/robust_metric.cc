@@ -0,0 +1,197 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file robust_metric.cc
+ * \brief certified adversarial robustness metrics of tree ensembles.
+ */
+#include <xgboost/metric.h>
+#include <xgboost/gbm.h>
+#include <dmlc/omp.h>
+#include <dmlc/registry.h>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../common/sync.h"
+#include "../common/threading.h"
+#include "../robust/robust_verifier.h"
+#ifdef XGBOOST_USE_CUDA
+#include "../robust/robust_gpu.h"
+#endif
+
+namespace xgboost {
+namespace metric {
+// tag the this file, used by force static link later.
+DMLC_REGISTRY_FILE_TAG(robust_metric);
+
+/*!
+ * \brief error under L-inf perturbations of radius eps, counting every point
+ *  that cannot be certified as an error. This is an upper bound of the error
+ *  under the strongest attack.
+ *
+ *  A point is certified when the smallest reachable output of its class beats
+ *  the largest reachable output of every other class, each summed over the
+ *  trees of the class. The sums of the cache matrices of the booster are kept
+ *  and extended with the trees added since the last evaluation, so a round
+ *  costs one box traversal of the new trees. Absent features are treated as
+ *  0, as in task=verify. CUDA builds traverse the trees on the current
+ *  device when there is one.
+ */
+struct EvalRobustError : public Metric {
+  explicit EvalRobustError(const char* param) {
+    CHECK(param != nullptr)
+        << "robust_error needs the perturbation radius, e.g. robust_error@0.3";
+    CHECK_EQ(sscanf(param, "%f", &eps_), 1)
+        << "unable to parse the eps value for the robust_error metric";
+    std::ostringstream os;
+    os << "robust_error@" << eps_;
+    name_ = os.str();
+  }
+  bst_float Eval(const std::vector<bst_float>& preds,
+                 const MetaInfo& info,
+                 bool distributed) const override {
+    LOG(FATAL) << "robust_error is computed from the model, not from the predictions";
+    return 0.0f;
+  }
+  bool EvalModel(const GradientBooster& gbm, DMatrix* dmat,
+                 bool distributed, bst_float* out) override {
+    const gbm::GBTreeModel* model = gbm.GetTreeModel();
+    CHECK(model != nullptr) << "robust_error only supports booster=gbtree";
+    CHECK_EQ(model->param.size_leaf_vector, 0)
+        << "robust_error does not support trees of vector leaves";
+    const MetaInfo& info = dmat->Info();
+    CHECK_NE(info.labels_.size(), 0U) << "label set cannot be empty";
+    CHECK_EQ(info.labels_.size(), info.num_row_);
+    const int ngroup = model->param.num_output_group;
+    if (ngroup > 1) {
+      for (bst_float label : info.labels_) {
+        CHECK(label >= 0 && label < static_cast<bst_float>(ngroup))
+            << "robust_error: label must be in [0, num_class), num_class=" << ngroup
+            << " but found " << label << " in label";
+      }
+    }
+    // any other matrix may be freed and its address reused by a new one, so
+    // the state of the matrices the booster no longer holds is dropped
+    for (auto it = cache_.begin(); it != cache_.end();) {
+      if (gbm.IsCacheMatrix(it->first)) {
+        ++it;
+      } else {
+        it = cache_.erase(it);
+      }
+    }
+    Cache uncached;
+    Cache& cache = gbm.IsCacheMatrix(dmat) ? cache_[dmat] : uncached;
+    this->Extend(*model, dmat, &cache);
+
+    double dat[2];
+    common::ParallelSum(info.num_row_, dat, [&](size_t i, double* sums) {
+      const bst_float wt = info.GetWeight(i);
+      const size_t base = i * ngroup;
+      auto margin = [&](int k) {
+        return info.base_margin_.size() != 0 ? info.base_margin_[base + k] : model->base_margin;
+      };
+      bool robust;
+      if (ngroup == 1) {
+        robust = info.labels_[i] > 0.5f
+            ? margin(0) + cache.lower[base] > 0.0f
+            : margin(0) + cache.upper[base] < 0.0f;
+      } else {
+        const int label = static_cast<int>(info.labels_[i]);
+        const bst_float worst = margin(label) + cache.lower[base + label];
+        robust = true;
+        for (int k = 0; k < ngroup; ++k) {
+          if (k != label && worst - (margin(k) + cache.upper[base + k]) <= 0.0f) {
+            robust = false;
+            break;
+          }
+        }
+      }
+      sums[0] += robust ? 0.0 : wt;
+      sums[1] += wt;
+    });
+    if (distributed) {
+      rabit::Allreduce<rabit::op::Sum>(dat, 2);
+    }
+    *out = static_cast<bst_float>(dat[0] / dat[1]);
+    return true;
+  }
+  const char* Name() const override {
+    return name_.c_str();
+  }
+
+ private:
+  /*! \brief reachable output range of each row and output group */
+  struct Cache {
+    /*! \brief number of trees added to the sums */
+    size_t num_tree{0};
+    std::vector<bst_float> lower;
+    std::vector<bst_float> upper;
+  };
+  // add the trees of the model that are not yet in the cache
+  inline void Extend(const gbm::GBTreeModel& model, DMatrix* dmat, Cache* cache) const {
+    const MetaInfo& info = dmat->Info();
+    const int ngroup = model.param.num_output_group;
+    const size_t ntree = model.trees.size();
+    const size_t n = static_cast<size_t>(info.num_row_) * ngroup;
+    if (cache->lower.size() != n || cache->num_tree > ntree) {
+      // new data set or a model that was reset
+      cache->num_tree = 0;
+      cache->lower.assign(n, 0.0f);
+      cache->upper.assign(n, 0.0f);
+    }
+    if (cache->num_tree == ntree) return;
+#ifdef XGBOOST_USE_CUDA
+    if (robust::ReachableRangeGPU(model, dmat, cache->num_tree, ntree, eps_,
+                                  &cache->lower, &cache->upper)) {
+      cache->num_tree = ntree;
+      return;
+    }
+#endif
+    const size_t nfeature = std::max(static_cast<size_t>(model.param.num_feature),
+                                     static_cast<size_t>(info.num_col_));
+    const int nthread = omp_get_max_threads();
+    std::vector<std::vector<bst_float> > thread_x(nthread);
+    std::vector<std::vector<robust::FeatureInterval> > thread_path(nthread);
+    auto iter = dmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      auto &batch = iter->Value();
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+      common::ParallelFor(nsize, [&](size_t i) {
+        const int tid = common::ThreadId();
+        std::vector<bst_float>& x = thread_x[tid];
+        const size_t ridx = static_cast<size_t>(batch.base_rowid + i);
+        SparsePage::Inst inst = batch[i];
+        x.assign(nfeature, 0.0f);
+        for (bst_uint j = 0; j < inst.length; ++j) {
+          if (inst[j].index < nfeature) x[inst[j].index] = inst[j].fvalue;
+        }
+        for (size_t t = cache->num_tree; t < ntree; ++t) {
+          bst_float vmin, vmax;
+          robust::RobustVerifier::ReachableRange(*model.trees[t], info.GetRoot(ridx), x, eps_,
+                                                 &thread_path[tid], &vmin, &vmax);
+          const size_t k = ridx * ngroup + model.tree_info[t];
+          cache->lower[k] += vmin;
+          cache->upper[k] += vmax;
+        }
+      });
+    }
+    cache->num_tree = ntree;
+  }
+
+  bst_float eps_;
+  std::string name_;
+  /*!
+   * \brief state of each evaluated cache matrix of the booster. Like the
+   *  prediction cache, an entry is only valid while the existing trees are
+   *  not modified.
+   */
+  std::unordered_map<DMatrix*, Cache> cache_;
+};
+
+XGBOOST_REGISTER_METRIC(RobustError, "robust_error")
+.describe("Certified upper bound of the error under L-inf perturbations of radius eps.")
+.set_body([](const char* param) { return new EvalRobustError(param); });
+}  // namespace metric
+}  // namespace xgboost
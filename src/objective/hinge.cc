@@ -30,7 +30,7 @@ class HingeObj : public ObjFunction {
         << "labels are not correctly provided"
         << "preds.size=" << preds->Size()
         << ", label.size=" << info.labels_.size();
-    auto& preds_h = preds->HostVector();
+    const auto& preds_h = preds->ConstHostVector();
 
     out_gpair->Resize(preds_h.size());
     auto& gpair = out_gpair->HostVector();
@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <utility>
 #include "../common/math.h"
+#include "../common/threading.h"
 
 namespace xgboost {
 namespace obj {
@@ -42,29 +43,30 @@ class SoftmaxMultiClassObj : public ObjFunction {
     CHECK_NE(info.labels_.size(), 0U) << "label set cannot be empty";
     CHECK(preds->Size() == (static_cast<size_t>(param_.num_class) * info.labels_.size()))
         << "SoftmaxMultiClassObj: label size and pred size does not match";
-    std::vector<bst_float>& preds_h = preds->HostVector();
+    const std::vector<bst_float>& preds_h = preds->ConstHostVector();
     out_gpair->Resize(preds_h.size());
     std::vector<GradientPair>& gpair = out_gpair->HostVector();
     const int nclass = param_.num_class;
     const auto ndata = static_cast<omp_ulong>(preds_h.size() / nclass);
+    const omp_ulong nblock = (ndata + kBlockRows - 1) / kBlockRows;
 
     int label_error = 0;
-    #pragma omp parallel
-    {
-      std::vector<bst_float> rec(nclass);
-      #pragma omp for schedule(static)
-      for (omp_ulong i = 0; i < ndata; ++i) {
-        for (int k = 0; k < nclass; ++k) {
-          rec[k] = preds_h[i * nclass + k];
-        }
-        common::Softmax(&rec);
+    std::vector<std::vector<bst_float> > thread_prob(
+        omp_get_max_threads(), std::vector<bst_float>(nclass * kBlockRows));
+    common::ParallelFor(nblock, [&](size_t b) {
+      std::vector<bst_float>& prob = thread_prob[common::ThreadId()];
+      const omp_ulong begin = b * kBlockRows;
+      const omp_ulong nrow = std::min(kBlockRows, ndata - begin);
+      SoftmaxBlock(&preds_h[begin * nclass], nclass, nrow, dmlc::BeginPtr(prob));
+      for (omp_ulong r = 0; r < nrow; ++r) {
+        const omp_ulong i = begin + r;
         auto label = static_cast<int>(info.labels_[i]);
         if (label < 0 || label >= nclass)  {
           label_error = label; label = 0;
         }
         const bst_float wt = info.GetWeight(i);
         for (int k = 0; k < nclass; ++k) {
-          bst_float p = rec[k];
+          bst_float p = prob[k * kBlockRows + r];
           const float eps = 1e-16f;
           const bst_float h = fmax(2.0f * p * (1.0f - p) * wt, eps);
           if (label == k) {
@@ -74,7 +76,7 @@ class SoftmaxMultiClassObj : public ObjFunction {
           }
         }
       }
-    }
+    });
     CHECK(label_error >= 0 && label_error < nclass)
         << "SoftmaxMultiClassObj: label must be in [0, num_class),"
         << " num_class=" << nclass
@@ -91,33 +93,89 @@ class SoftmaxMultiClassObj : public ObjFunction {
   }
 
  private:
+  /*! \brief number of rows whose softmax is computed together */
+  static constexpr omp_ulong kBlockRows = 8;
+  /*!
+   * \brief softmax of nrow <= kBlockRows rows of nclass margins.
+   *
+   *  The probability of class k of row r is written to prob[k * kBlockRows + r],
+   *  so that a class of all rows of the block is one Float8. A full block is
+   *  computed with the AVX exp when XGBOOST_USE_AVX is set, the other blocks
+   *  give the same result as common::Softmax.
+   */
+  inline static void SoftmaxBlock(const bst_float *margin, int nclass,
+                                  omp_ulong nrow, bst_float *prob) {
+    for (omp_ulong r = 0; r < nrow; ++r) {
+      for (int k = 0; k < nclass; ++k) {
+        prob[k * kBlockRows + r] = margin[r * nclass + k];
+      }
+    }
+#ifdef XGBOOST_USE_AVX
+    if (nrow == kBlockRows) {
+      avx::Float8 wmax(prob);
+      for (int k = 1; k < nclass; ++k) {
+        wmax = std::max(wmax, avx::Float8(prob + k * kBlockRows));
+      }
+      avx::Float8 wsum(0.0f);
+      for (int k = 0; k < nclass; ++k) {
+        avx::Float8 x = avx::ExpAgner(avx::Float8(prob + k * kBlockRows) - wmax);
+        avx::Store(prob + k * kBlockRows, x);
+        wsum += x;
+      }
+      for (int k = 0; k < nclass; ++k) {
+        avx::Store(prob + k * kBlockRows, avx::Float8(prob + k * kBlockRows) / wsum);
+      }
+      return;
+    }
+#endif
+    for (omp_ulong r = 0; r < nrow; ++r) {
+      bst_float *p = prob + r;
+      float wmax = p[0];
+      for (int k = 1; k < nclass; ++k) {
+        wmax = std::max(p[k * kBlockRows], wmax);
+      }
+      double wsum = 0.0f;
+      for (int k = 0; k < nclass; ++k) {
+        p[k * kBlockRows] = std::exp(p[k * kBlockRows] - wmax);
+        wsum += p[k * kBlockRows];
+      }
+      for (int k = 0; k < nclass; ++k) {
+        p[k * kBlockRows] /= static_cast<float>(wsum);
+      }
+    }
+  }
+  // the probabilities are written back in place, the class index of a
+  // row is found on its margins directly
   inline void Transform(HostDeviceVector<bst_float> *io_preds, bool prob) {
     std::vector<bst_float> &preds = io_preds->HostVector();
     std::vector<bst_float> tmp;
     const int nclass = param_.num_class;
     const auto ndata = static_cast<omp_ulong>(preds.size() / nclass);
-    if (!prob) tmp.resize(ndata);
-
-    #pragma omp parallel
-    {
-      std::vector<bst_float> rec(nclass);
-      #pragma omp for schedule(static)
-      for (omp_ulong j = 0; j < ndata; ++j) {
+    if (!prob) {
+      tmp.resize(ndata);
+      common::ParallelFor(ndata, [&](size_t j) {
+        const bst_float *row = &preds[j * nclass];
+        tmp[j] = static_cast<bst_float>(
+            common::FindMaxIndex(row, row + nclass) - row);
+      });
+      preds = tmp;
+      return;
+    }
+    const omp_ulong nblock = (ndata + kBlockRows - 1) / kBlockRows;
+    std::vector<std::vector<bst_float> > thread_rec(
+        omp_get_max_threads(), std::vector<bst_float>(nclass * kBlockRows));
+    common::ParallelFor(nblock, [&](size_t b) {
+      std::vector<bst_float>& rec = thread_rec[common::ThreadId()];
+      const omp_ulong begin = b * kBlockRows;
+      const omp_ulong nrow = std::min(kBlockRows, ndata - begin);
+      bst_float *margin = &preds[begin * nclass];
+      SoftmaxBlock(margin, nclass, nrow, dmlc::BeginPtr(rec));
+      for (omp_ulong r = 0; r < nrow; ++r) {
         for (int k = 0; k < nclass; ++k) {
-          rec[k] = preds[j * nclass + k];
-        }
-        if (!prob) {
-          tmp[j] = static_cast<bst_float>(
-              common::FindMaxIndex(rec.begin(), rec.end()) - rec.begin());
-        } else {
-          common::Softmax(&rec);
-          for (int k = 0; k < nclass; ++k) {
-            preds[j * nclass + k] = rec[k];
-          }
+          margin[r * nclass + k] = rec[k * kBlockRows + r];
         }
       }
-    }
-    if (!prob) preds = tmp;
+    });
   }
   // output probability
   bool output_prob_;
@@ -125,6 +183,8 @@ class SoftmaxMultiClassObj : public ObjFunction {
   SoftmaxMultiClassParam param_;
 };
 
+constexpr omp_ulong SoftmaxMultiClassObj::kBlockRows;
+
 // register the objective functions
 DMLC_REGISTER_PARAMETER(SoftmaxMultiClassParam);
 
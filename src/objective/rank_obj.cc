@@ -5,13 +5,16 @@
  * \author Tianqi Chen, Kailong Chen
  */
 #include <dmlc/omp.h>
+#include <dmlc/thread_local.h>
 #include <xgboost/logging.h>
 #include <xgboost/objective.h>
 #include <vector>
 #include <algorithm>
+#include <cmath>
 #include <utility>
 #include "../common/math.h"
 #include "../common/random.h"
+#include "../common/threading.h"
 
 namespace xgboost {
 namespace obj {
@@ -43,7 +46,7 @@ class LambdaRankObj : public ObjFunction {
                    int iter,
                    HostDeviceVector<GradientPair>* out_gpair) override {
     CHECK_EQ(preds->Size(), info.labels_.size()) << "label size predict size not match";
-    auto& preds_h = preds->HostVector();
+    const auto& preds_h = preds->ConstHostVector();
     out_gpair->Resize(preds_h.size());
     std::vector<GradientPair>& gpair = out_gpair->HostVector();
     // quick consistency when group is not available
@@ -53,77 +56,71 @@ class LambdaRankObj : public ObjFunction {
         << "group structure not consistent with #rows";
 
     const auto ngroup = static_cast<bst_omp_uint>(gptr.size() - 1);
-    #pragma omp parallel
-    {
-      // parall construct, declare random number generator here, so that each
-      // thread use its own random number generator, seed by thread id and current iteration
-      common::RandomEngine rnd(iter * 1111 + omp_get_thread_num());
-
-      std::vector<LambdaPair> pairs;
-      std::vector<ListEntry>  lst;
-      std::vector< std::pair<bst_float, unsigned> > rec;
-      bst_float sum_weights = 0;
-      for (bst_omp_uint k = 0; k < ngroup; ++k) {
-        sum_weights += info.GetWeight(k);
+    bst_float sum_weights = 0;
+    for (bst_omp_uint k = 0; k < ngroup; ++k) {
+      sum_weights += info.GetWeight(k);
+    }
+    const bst_float weight_normalization_factor = ngroup/sum_weights;
+    // each thread uses its own random number generator, seeded by thread id
+    // and current iteration
+    std::vector<common::RandomEngine> thread_rnd;
+    for (int tid = 0; tid < omp_get_max_threads(); ++tid) {
+      thread_rnd.emplace_back(iter * 1111 + tid);
+    }
+    common::ParallelFor(ngroup, [&](size_t k) {
+      common::RandomEngine& rnd = thread_rnd[common::ThreadId()];
+      // the buffers of the thread are kept across groups and iterations
+      ThreadBuffer& buf = *dmlc::ThreadLocalStore<ThreadBuffer>::Get();
+      std::vector<LambdaPair>& pairs = buf.pairs;
+      std::vector<ListEntry>& lst = buf.lst;
+      std::vector< std::pair<bst_float, unsigned> >& rec = buf.rec;
+      lst.clear(); pairs.clear();
+      for (unsigned j = gptr[k]; j < gptr[k+1]; ++j) {
+        lst.emplace_back(preds_h[j], info.labels_[j], j);
+        gpair[j] = GradientPair(0.0f, 0.0f);
       }
-      bst_float weight_normalization_factor = ngroup/sum_weights;
-      #pragma omp for schedule(static)
-      for (bst_omp_uint k = 0; k < ngroup; ++k) {
-        lst.clear(); pairs.clear();
-        for (unsigned j = gptr[k]; j < gptr[k+1]; ++j) {
-          lst.emplace_back(preds_h[j], info.labels_[j], j);
-          gpair[j] = GradientPair(0.0f, 0.0f);
-        }
-        std::sort(lst.begin(), lst.end(), ListEntry::CmpPred);
-        rec.resize(lst.size());
-        for (unsigned i = 0; i < lst.size(); ++i) {
-          rec[i] = std::make_pair(lst[i].label, i);
-        }
-        std::sort(rec.begin(), rec.end(), common::CmpFirst);
-        // enumerate buckets with same label, for each item in the lst, grab another sample randomly
-        for (unsigned i = 0; i < rec.size(); ) {
-          unsigned j = i + 1;
-          while (j < rec.size() && rec[j].first == rec[i].first) ++j;
-          // bucket in [i,j), get a sample outside bucket
-          unsigned nleft = i, nright = static_cast<unsigned>(rec.size() - j);
-          if (nleft + nright != 0) {
-            int nsample = param_.num_pairsample;
-            while (nsample --) {
-              for (unsigned pid = i; pid < j; ++pid) {
-                unsigned ridx = std::uniform_int_distribution<unsigned>(0, nleft + nright - 1)(rnd);
-                if (ridx < nleft) {
-                  pairs.emplace_back(rec[ridx].second, rec[pid].second,
-                      info.GetWeight(k) * weight_normalization_factor);
-                } else {
-                  pairs.emplace_back(rec[pid].second, rec[ridx+j-i].second,
-                      info.GetWeight(k) * weight_normalization_factor);
-                }
+      std::sort(lst.begin(), lst.end(), ListEntry::CmpPred);
+      BucketByLabel(lst, &buf);
+      // enumerate buckets with same label, for each item in the lst, grab another sample randomly
+      for (unsigned i = 0; i < rec.size(); ) {
+        unsigned j = i + 1;
+        while (j < rec.size() && rec[j].first == rec[i].first) ++j;
+        // bucket in [i,j), get a sample outside bucket
+        unsigned nleft = i, nright = static_cast<unsigned>(rec.size() - j);
+        if (nleft + nright != 0) {
+          std::uniform_int_distribution<unsigned> sample(0, nleft + nright - 1);
+          int nsample = param_.num_pairsample;
+          while (nsample --) {
+            for (unsigned pid = i; pid < j; ++pid) {
+              unsigned ridx = sample(rnd);
+              if (ridx < nleft) {
+                pairs.emplace_back(rec[ridx].second, rec[pid].second,
+                    info.GetWeight(k) * weight_normalization_factor);
+              } else {
+                pairs.emplace_back(rec[pid].second, rec[ridx+j-i].second,
+                    info.GetWeight(k) * weight_normalization_factor);
               }
             }
           }
-          i = j;
-        }
-        // get lambda weight for the pairs
-        this->GetLambdaWeight(lst, &pairs);
-        // rescale each gradient and hessian so that the lst have constant weighted
-        float scale = 1.0f / param_.num_pairsample;
-        if (param_.fix_list_weight != 0.0f) {
-          scale *= param_.fix_list_weight / (gptr[k + 1] - gptr[k]);
-        }
-        for (auto & pair : pairs) {
-          const ListEntry &pos = lst[pair.pos_index];
-          const ListEntry &neg = lst[pair.neg_index];
-          const bst_float w = pair.weight * scale;
-          const float eps = 1e-16f;
-          bst_float p = common::Sigmoid(pos.pred - neg.pred);
-          bst_float g = p - 1.0f;
-          bst_float h = std::max(p * (1.0f - p), eps);
-          // accumulate gradient and hessian in both pid, and nid
-          gpair[pos.rindex] += GradientPair(g * w, 2.0f*w*h);
-          gpair[neg.rindex] += GradientPair(-g * w, 2.0f*w*h);
         }
+        i = j;
       }
-    }
+      // get lambda weight for the pairs
+      this->GetLambdaWeight(lst, &pairs);
+      // rescale each gradient and hessian so that the lst have constant weighted
+      float scale = 1.0f / param_.num_pairsample;
+      if (param_.fix_list_weight != 0.0f) {
+        scale *= param_.fix_list_weight / (gptr[k + 1] - gptr[k]);
+      }
+      PairGradients(lst, pairs, &buf);
+      for (size_t i = 0; i < pairs.size(); ++i) {
+        const bst_float w = pairs[i].weight * scale;
+        const bst_float g = buf.grad[i], h = buf.hess[i];
+        // accumulate gradient and hessian in both pid, and nid
+        gpair[lst[pairs[i].pos_index].rindex] += GradientPair(g * w, 2.0f*w*h);
+        gpair[lst[pairs[i].neg_index].rindex] += GradientPair(-g * w, 2.0f*w*h);
+      }
+    });
   }
   const char* DefaultEvalMetric() const override {
     return "map";
@@ -165,6 +162,80 @@ class LambdaRankObj : public ObjFunction {
     LambdaPair(unsigned pos_index, unsigned neg_index, bst_float weight)
         : pos_index(pos_index), neg_index(neg_index), weight(weight) {}
   };
+  /*! \brief the buffers of a thread, reused over the groups and the iterations */
+  struct ThreadBuffer {
+    std::vector<LambdaPair> pairs;
+    std::vector<ListEntry> lst;
+    /*! \brief (label, position in lst) of the list, grouped by ascending label */
+    std::vector<std::pair<bst_float, unsigned> > rec;
+    /*! \brief number of entries of each label, for the counting sort */
+    std::vector<unsigned> count;
+    /*! \brief prediction differences, gradients and hessians of the pairs */
+    std::vector<bst_float> diff;
+    std::vector<bst_float> grad;
+    std::vector<bst_float> hess;
+  };
+  /*! \brief largest label bucketed by counting, the grades of relevance are small */
+  static constexpr unsigned kMaxCountLabel = 31;
+  /*!
+   * \brief fill buf->rec with the positions of the list ordered by label and
+   *  then by position: a counting sort when the labels are small non-negative
+   *  integers, a sort otherwise.
+   */
+  inline static void BucketByLabel(const std::vector<ListEntry> &lst, ThreadBuffer *buf) {
+    std::vector<std::pair<bst_float, unsigned> > &rec = buf->rec;
+    rec.resize(lst.size());
+    unsigned max_label = 0;
+    bool counting = true;
+    for (const ListEntry &e : lst) {
+      if (!(e.label >= 0.0f && e.label <= static_cast<bst_float>(kMaxCountLabel)) ||
+          e.label != std::floor(e.label)) {
+        counting = false;
+        break;
+      }
+      max_label = std::max(max_label, static_cast<unsigned>(e.label));
+    }
+    if (!counting) {
+      for (unsigned i = 0; i < lst.size(); ++i) {
+        rec[i] = std::make_pair(lst[i].label, i);
+      }
+      std::sort(rec.begin(), rec.end());
+      return;
+    }
+    std::vector<unsigned> &count = buf->count;
+    count.assign(max_label + 2, 0);
+    for (const ListEntry &e : lst) ++count[static_cast<unsigned>(e.label) + 1];
+    for (unsigned l = 1; l < count.size(); ++l) count[l] += count[l - 1];
+    for (unsigned i = 0; i < lst.size(); ++i) {
+      rec[count[static_cast<unsigned>(lst[i].label)]++] = std::make_pair(lst[i].label, i);
+    }
+  }
+  /*!
+   * \brief the logistic gradient and hessian of each pair into buf->grad and
+   *  buf->hess, eight pairs at a time
+   */
+  inline static void PairGradients(const std::vector<ListEntry> &lst,
+                                   const std::vector<LambdaPair> &pairs, ThreadBuffer *buf) {
+    const size_t npair = pairs.size();
+    const size_t nblock = npair / 8 * 8;
+    const float eps = 1e-16f;
+    buf->diff.resize(npair);
+    buf->grad.resize(npair);
+    buf->hess.resize(npair);
+    for (size_t i = 0; i < npair; ++i) {
+      buf->diff[i] = lst[pairs[i].pos_index].pred - lst[pairs[i].neg_index].pred;
+    }
+    for (size_t i = 0; i < nblock; i += 8) {
+      avx::Float8 p = common::Sigmoid(avx::Float8(&buf->diff[i]));
+      avx::Store(&buf->grad[i], p - avx::Float8(1.0f));
+      avx::Store(&buf->hess[i], std::max(p * (avx::Float8(1.0f) - p), avx::Float8(eps)));
+    }
+    for (size_t i = nblock; i < npair; ++i) {
+      bst_float p = common::Sigmoid(buf->diff[i]);
+      buf->grad[i] = p - 1.0f;
+      buf->hess[i] = std::max(p * (1.0f - p), eps);
+    }
+  }
   /*!
    * \brief get lambda weight for existing pairs
    * \param list a list that is sorted by pred score
@@ -191,7 +262,8 @@ class LambdaRankObjNDCG : public LambdaRankObj {
     std::vector<LambdaPair> &pairs = *io_pairs;
     float IDCG;  // NOLINT
     {
-      std::vector<bst_float> labels(sorted_list.size());
+      std::vector<bst_float> &labels = dmlc::ThreadLocalStore<LabelBuffer>::Get()->labels;
+      labels.resize(sorted_list.size());
       for (size_t i = 0; i < sorted_list.size(); ++i) {
         labels[i] = sorted_list[i].label;
       }
@@ -221,6 +293,10 @@ class LambdaRankObjNDCG : public LambdaRankObj {
       }
     }
   }
+  // the sorted labels of a list, per thread
+  struct LabelBuffer {
+    std::vector<bst_float> labels;
+  };
   inline static bst_float CalcDCG(const std::vector<bst_float> &labels) {
     double sumdcg = 0.0;
     for (size_t i = 0; i < labels.size(); ++i) {
@@ -254,6 +330,10 @@ class LambdaRankObjMAP : public LambdaRankObj {
     MAPStats(float ap_acc, float ap_acc_miss, float ap_acc_add, float hits)
         : ap_acc(ap_acc), ap_acc_miss(ap_acc_miss), ap_acc_add(ap_acc_add), hits(hits) {}
   };
+  // the statistics of a list, per thread
+  struct MAPBuffer {
+    std::vector<MAPStats> map_stats;
+  };
   /*!
    * \brief Obtain the delta MAP if trying to switch the positions of instances in index1 or index2
    *        in sorted triples
@@ -310,7 +390,7 @@ class LambdaRankObjMAP : public LambdaRankObj {
   void GetLambdaWeight(const std::vector<ListEntry> &sorted_list,
                        std::vector<LambdaPair> *io_pairs) override {
     std::vector<LambdaPair> &pairs = *io_pairs;
-    std::vector<MAPStats> map_stats;
+    std::vector<MAPStats> &map_stats = dmlc::ThreadLocalStore<MAPBuffer>::Get()->map_stats;
     GetMAPStats(sorted_list, &map_stats);
     for (auto & pair : pairs) {
       pair.weight *=
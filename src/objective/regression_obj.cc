@@ -12,6 +12,7 @@
 #include <utility>
 #include "../common/math.h"
 #include "../common/avx_helpers.h"
+#include "../common/threading.h"
 #include "./regression_loss.h"
 
 namespace xgboost {
@@ -45,7 +46,7 @@ class RegLossObj : public ObjFunction {
         << "labels are not correctly provided"
         << "preds.size=" << preds->Size()
         << ", label.size=" << info.labels_.size();
-    auto& preds_h = preds->HostVector();
+    const auto& preds_h = preds->ConstHostVector();
 
     this->LazyCheckLabels(info.labels_);
     out_gpair->Resize(preds_h.size());
@@ -55,8 +56,8 @@ class RegLossObj : public ObjFunction {
     avx::Float8 scale(param_.scale_pos_weight);
 
     const omp_ulong remainder = n % 8;
-#pragma omp parallel for schedule(static)
-    for (omp_ulong i = 0; i < n - remainder; i += 8) {
+    common::ParallelFor((n - remainder) / 8, [&](size_t k) {
+      const size_t i = k * 8;
       avx::Float8 y(&info.labels_[i]);
       avx::Float8 p = Loss::PredTransform(avx::Float8(&preds_h[i]));
       avx::Float8 w = info.weights_.empty() ? avx::Float8(1.0f)
@@ -66,7 +67,7 @@ class RegLossObj : public ObjFunction {
       avx::Float8 grad = Loss::FirstOrderGradient(p, y);
       avx::Float8 hess = Loss::SecondOrderGradient(p, y);
       avx::StoreGpair(gpair_ptr + i, grad * w, hess * w);
-    }
+    });
     for (omp_ulong i = n - remainder; i < n; ++i) {
       auto y = info.labels_[i];
       bst_float p = Loss::PredTransform(preds_h[i]);
@@ -82,10 +83,9 @@ class RegLossObj : public ObjFunction {
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
     std::vector<bst_float> &preds = io_preds->HostVector();
     const auto ndata = static_cast<bst_omp_uint>(preds.size());
-#pragma omp parallel for schedule(static)
-    for (bst_omp_uint j = 0; j < ndata; ++j) {
+    common::ParallelFor(ndata, [&](size_t j) {
       preds[j] = Loss::PredTransform(preds[j]);
-    }
+    });
   }
   bst_float ProbToMargin(bst_float base_score) const override {
     return Loss::ProbToMargin(base_score);
@@ -146,15 +146,14 @@ class PoissonRegression : public ObjFunction {
                    HostDeviceVector<GradientPair> *out_gpair) override {
     CHECK_NE(info.labels_.size(), 0U) << "label set cannot be empty";
     CHECK_EQ(preds->Size(), info.labels_.size()) << "labels are not correctly provided";
-    auto& preds_h = preds->HostVector();
+    const auto& preds_h = preds->ConstHostVector();
     out_gpair->Resize(preds->Size());
     auto& gpair = out_gpair->HostVector();
     // check if label in range
     bool label_correct = true;
     // start calculating gradient
     const omp_ulong ndata = static_cast<omp_ulong>(preds_h.size()); // NOLINT(*)
-#pragma omp parallel for schedule(static)
-    for (omp_ulong i = 0; i < ndata; ++i) { // NOLINT(*)
+    common::ParallelFor(ndata, [&](size_t i) {
       bst_float p = preds_h[i];
       bst_float w = info.GetWeight(i);
       bst_float y = info.labels_[i];
@@ -164,16 +163,14 @@ class PoissonRegression : public ObjFunction {
       } else {
         label_correct = false;
       }
-    }
+    });
     CHECK(label_correct) << "PoissonRegression: label must be nonnegative";
   }
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
     std::vector<bst_float> &preds = io_preds->HostVector();
-    const long ndata = static_cast<long>(preds.size()); // NOLINT(*)
-#pragma omp parallel for schedule(static)
-    for (long j = 0; j < ndata; ++j) {  // NOLINT(*)
+    common::ParallelFor(preds.size(), [&](size_t j) {
       preds[j] = std::exp(preds[j]);
-    }
+    });
   }
   void EvalTransform(HostDeviceVector<bst_float> *io_preds) override {
     PredTransform(io_preds);
@@ -207,7 +204,7 @@ class CoxRegression : public ObjFunction {
                    HostDeviceVector<GradientPair> *out_gpair) override {
     CHECK_NE(info.labels_.size(), 0U) << "label set cannot be empty";
     CHECK_EQ(preds->Size(), info.labels_.size()) << "labels are not correctly provided";
-    auto& preds_h = preds->HostVector();
+    const auto& preds_h = preds->ConstHostVector();
     out_gpair->Resize(preds_h.size());
     auto& gpair = out_gpair->HostVector();
     const std::vector<size_t> &label_order = info.LabelAbsSort();
@@ -260,11 +257,9 @@ class CoxRegression : public ObjFunction {
   }
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
     std::vector<bst_float> &preds = io_preds->HostVector();
-    const long ndata = static_cast<long>(preds.size()); // NOLINT(*)
-    #pragma omp parallel for schedule(static)
-    for (long j = 0; j < ndata; ++j) {  // NOLINT(*)
+    common::ParallelFor(preds.size(), [&](size_t j) {
       preds[j] = std::exp(preds[j]);
-    }
+    });
   }
   void EvalTransform(HostDeviceVector<bst_float> *io_preds) override {
     PredTransform(io_preds);
@@ -295,15 +290,14 @@ class GammaRegression : public ObjFunction {
                    HostDeviceVector<GradientPair> *out_gpair) override {
     CHECK_NE(info.labels_.size(), 0U) << "label set cannot be empty";
     CHECK_EQ(preds->Size(), info.labels_.size()) << "labels are not correctly provided";
-    auto& preds_h = preds->HostVector();
+    const auto& preds_h = preds->ConstHostVector();
     out_gpair->Resize(preds_h.size());
     auto& gpair = out_gpair->HostVector();
     // check if label in range
     bool label_correct = true;
     // start calculating gradient
     const omp_ulong ndata = static_cast<omp_ulong>(preds_h.size()); // NOLINT(*)
-    #pragma omp parallel for schedule(static)
-    for (omp_ulong i = 0; i < ndata; ++i) { // NOLINT(*)
+    common::ParallelFor(ndata, [&](size_t i) {
       bst_float p = preds_h[i];
       bst_float w = info.GetWeight(i);
       bst_float y = info.labels_[i];
@@ -312,16 +306,14 @@ class GammaRegression : public ObjFunction {
       } else {
         label_correct = false;
       }
-    }
+    });
     CHECK(label_correct) << "GammaRegression: label must be positive";
   }
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
     std::vector<bst_float> &preds = io_preds->HostVector();
-    const long ndata = static_cast<long>(preds.size()); // NOLINT(*)
-    #pragma omp parallel for schedule(static)
-    for (long j = 0; j < ndata; ++j) {  // NOLINT(*)
+    common::ParallelFor(preds.size(), [&](size_t j) {
       preds[j] = std::exp(preds[j]);
-    }
+    });
   }
   void EvalTransform(HostDeviceVector<bst_float> *io_preds) override {
     PredTransform(io_preds);
@@ -362,15 +354,14 @@ class TweedieRegression : public ObjFunction {
                    HostDeviceVector<GradientPair> *out_gpair) override {
     CHECK_NE(info.labels_.size(), 0U) << "label set cannot be empty";
     CHECK_EQ(preds->Size(), info.labels_.size()) << "labels are not correctly provided";
-    auto& preds_h = preds->HostVector();
+    const auto& preds_h = preds->ConstHostVector();
     out_gpair->Resize(preds->Size());
     auto& gpair = out_gpair->HostVector();
     // check if label in range
     bool label_correct = true;
     // start calculating gradient
     const omp_ulong ndata = static_cast<omp_ulong>(preds->Size()); // NOLINT(*)
-    #pragma omp parallel for schedule(static)
-    for (omp_ulong i = 0; i < ndata; ++i) { // NOLINT(*)
+    common::ParallelFor(ndata, [&](size_t i) {
       bst_float p = preds_h[i];
       bst_float w = info.GetWeight(i);
       bst_float y = info.labels_[i];
@@ -383,16 +374,14 @@ class TweedieRegression : public ObjFunction {
       } else {
         label_correct = false;
       }
-    }
+    });
     CHECK(label_correct) << "TweedieRegression: label must be nonnegative";
   }
   void PredTransform(HostDeviceVector<bst_float> *io_preds) override {
     std::vector<bst_float> &preds = io_preds->HostVector();
-    const long ndata = static_cast<long>(preds.size()); // NOLINT(*)
-#pragma omp parallel for schedule(static)
-    for (long j = 0; j < ndata; ++j) {  // NOLINT(*)
+    common::ParallelFor(preds.size(), [&](size_t j) {
       preds[j] = std::exp(preds[j]);
-    }
+    });
   }
 
   bst_float ProbToMargin(bst_float base_score) const override {
@@ -145,8 +145,8 @@ class GPURegLossObj : public ObjFunction {
       if (n > 0) {
         get_gradient_k<Loss><<<dh::DivRoundUp(n, block), block>>>
           (out_gpair->DevicePointer(d), label_correct_.DevicePointer(d),
-           preds->DevicePointer(d), labels_.DevicePointer(d),
-           info.weights_.size() > 0 ? weights_.DevicePointer(d) : nullptr,
+           preds->ConstDevicePointer(d), labels_.ConstDevicePointer(d),
+           info.weights_.size() > 0 ? weights_.ConstDevicePointer(d) : nullptr,
            n, param_.scale_pos_weight);
         dh::safe_cuda(cudaGetLastError());
       }
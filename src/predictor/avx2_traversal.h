@@ -0,0 +1,95 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file avx2_traversal.h
+ * \brief AVX2 walk of 8 rows through a packed tree at once.
+ *
+ *  The kernel is compiled for AVX2 with a target attribute and selected at
+ *  runtime, so the library still runs on CPUs without it. The rows of a block
+ *  are stored with a stride of num_feature values, a missing value is the bit
+ *  pattern -1 as in RegTree::FVec, and the feature values of the 8 rows are
+ *  loaded with one gather per level. The result is the same as the scalar walk.
+ */
+#ifndef XGBOOST_PREDICTOR_AVX2_TRAVERSAL_H_
+#define XGBOOST_PREDICTOR_AVX2_TRAVERSAL_H_
+
+#include <xgboost/base.h>
+#include <cstdint>
+#include <vector>
+#include "../gbm/gbtree_model.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define XGBOOST_PREDICT_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace xgboost {
+namespace predictor {
+
+/*! \return whether the CPU supports the AVX2 kernel */
+inline bool SupportsAVX2() {
+#ifdef XGBOOST_PREDICT_AVX2
+  static const bool supported = __builtin_cpu_supports("avx2") != 0;
+  return supported;
+#else
+  return false;
+#endif
+}
+
+#ifdef XGBOOST_PREDICT_AVX2
+/*!
+ * \brief add the outputs of packed trees [tree_begin, tree_end) for a block
+ *  of nrow <= 8 rows. Row k holds its feature values at
+ *  block[k * num_feature], rows beyond nrow are not read.
+ */
+__attribute__((target("avx2")))
+inline void PredBlockAVX2(const gbm::PackedForest& forest,
+                          const std::vector<int>& tree_info,
+                          const int32_t* block, int num_feature, int nrow,
+                          int num_group, unsigned tree_begin, unsigned tree_end,
+                          bst_float* out) {
+  // the missing lanes walk row 0 again, their leaves are dropped
+  alignas(32) int32_t offset[8];
+  for (int k = 0; k < 8; ++k) offset[k] = (k < nrow ? k : 0) * num_feature;
+  const __m256i row_offset = _mm256_load_si256(reinterpret_cast<const __m256i*>(offset));
+  const __m256i all_ones = _mm256_set1_epi32(-1);
+  const __m256i fid_mask = _mm256_set1_epi32(0x7fffffff);
+  const __m256i one = _mm256_set1_epi32(1);
+  const int* split_index = reinterpret_cast<const int*>(forest.split_index.data());
+  const float* split_cond = forest.split_cond.data();
+  const int* children = forest.children.data();
+  alignas(32) float leaf[8];
+  for (unsigned t = tree_begin; t < tree_end; ++t) {
+    __m256i ref = _mm256_set1_epi32(forest.tree_root[t]);
+    __m256i active = _mm256_cmpgt_epi32(ref, all_ones);
+    while (!_mm256_testz_si256(active, active)) {
+      // the lanes at a leaf read node 0, their reference is kept
+      const __m256i node = _mm256_and_si256(ref, active);
+      const __m256i sindex = _mm256_i32gather_epi32(split_index, node, 4);
+      const __m256 cond = _mm256_i32gather_ps(split_cond, node, 4);
+      const __m256i fid = _mm256_and_si256(sindex, fid_mask);
+      const __m256i fvalue = _mm256_i32gather_epi32(
+          block, _mm256_add_epi32(fid, row_offset), 4);
+      const __m256i missing = _mm256_cmpeq_epi32(fvalue, all_ones);
+      const __m256i default_left = _mm256_srai_epi32(sindex, 31);
+      const __m256i less = _mm256_castps_si256(
+          _mm256_cmp_ps(_mm256_castsi256_ps(fvalue), cond, _CMP_LT_OQ));
+      const __m256i left = _mm256_or_si256(_mm256_and_si256(missing, default_left),
+                                           _mm256_andnot_si256(missing, less));
+      const __m256i child = _mm256_add_epi32(_mm256_add_epi32(node, node),
+                                             _mm256_andnot_si256(left, one));
+      const __m256i next = _mm256_i32gather_epi32(children, child, 4);
+      ref = _mm256_blendv_epi8(ref, next, active);
+      active = _mm256_cmpgt_epi32(ref, all_ones);
+    }
+    const __m256 value = _mm256_i32gather_ps(forest.leaf_value.data(),
+                                             _mm256_xor_si256(ref, all_ones), 4);
+    _mm256_store_ps(leaf, value);
+    const int gid = tree_info[t];
+    for (int k = 0; k < nrow; ++k) out[k * num_group + gid] += leaf[k];
+  }
+}
+#endif  // XGBOOST_PREDICT_AVX2
+
+}  // namespace predictor
+}  // namespace xgboost
+#endif  // XGBOOST_PREDICTOR_AVX2_TRAVERSAL_H_
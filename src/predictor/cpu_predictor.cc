@@ -4,8 +4,16 @@
 #include <xgboost/predictor.h>
 #include <xgboost/tree_model.h>
 #include <xgboost/tree_updater.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 #include "dmlc/logging.h"
 #include "../common/host_device_vector.h"
+#include "../common/threading.h"
+#include "./avx2_traversal.h"
+#include "./quickscorer.h"
 
 namespace xgboost {
 namespace predictor {
@@ -14,6 +22,8 @@ DMLC_REGISTRY_FILE_TAG(cpu_predictor);
 
 class CPUPredictor : public Predictor {
  protected:
+  // number of rows walked through a packed tree in lockstep
+  static constexpr int kBlockRows = gbm::PackedForest::kMaxBlockRows;
   static bst_float PredValue(const  SparsePage::Inst& inst,
                              const std::vector<std::unique_ptr<RegTree>>& trees,
                              const std::vector<int>& tree_info, int bst_group,
@@ -22,15 +32,32 @@ class CPUPredictor : public Predictor {
     bst_float psum = 0.0f;
     p_feats->Fill(inst);
     for (size_t i = tree_begin; i < tree_end; ++i) {
-      if (tree_info[i] == bst_group) {
+      // a tree of vector leaves serves all the groups
+      const bool vector_leaf = trees[i]->param.size_leaf_vector != 0;
+      if (vector_leaf || tree_info[i] == bst_group) {
         int tid = trees[i]->GetLeafIndex(*p_feats, root_index);
-        psum += (*trees[i])[tid].LeafValue();
+        psum += vector_leaf ? trees[i]->Leafvec(tid)[bst_group] : (*trees[i])[tid].LeafValue();
       }
     }
     p_feats->Drop(inst);
     return psum;
   }
 
+  // let the last updater update the cache. A trailing pruner only deletes
+  // nodes, so the updater before it may still do it when it moves the rows of
+  // the deleted nodes up to their new leaves; any other updater may have
+  // changed the tree after the positions were taken
+  static bool UpdateCacheByUpdater(std::vector<std::unique_ptr<TreeUpdater>>* updaters,
+                                   PredictionCacheEntry* e) {
+    if (updaters->size() == 0) return false;
+    TreeUpdater* last = updaters->back().get();
+    if (last->UpdatePredictionCache(e->data.get(), &(e->predictions))) return true;
+    if (!last->OnlyDeletesNodes() || updaters->size() < 2) return false;
+    TreeUpdater* grower = (*updaters)[updaters->size() - 2].get();
+    return grower->CacheFollowsDeletedNodes() &&
+        grower->UpdatePredictionCache(e->data.get(), &(e->predictions));
+  }
+
   // init thread buffers
   inline void InitThreadTemp(int nthread, int num_feature) {
     int prev_thread_temp_size = thread_temp.size();
@@ -41,64 +68,182 @@ class CPUPredictor : public Predictor {
       }
     }
   }
+  // fill the node mean values of the first ntree_limit trees and size the
+  // TreeShap path scratch of each thread for the deepest of them
+  inline void InitTreeShap(const gbm::GBTreeModel& model, unsigned ntree_limit, int nthread) {
+    std::vector<int> depth(ntree_limit);
+    common::ParallelFor(ntree_limit, [&](size_t i) {
+      model.trees[i]->FillNodeMeanValues();
+      depth[i] = model.trees[i]->MaxDepth();
+    });
+    const int maxd = (ntree_limit == 0 ? 0 : *std::max_element(depth.begin(), depth.end())) + 2;
+    path_temp.resize(nthread);
+    for (std::vector<PathElement>& path : path_temp) {
+      if (path.size() < static_cast<size_t>((maxd * (maxd + 1)) / 2)) {
+        path.resize((maxd * (maxd + 1)) / 2);
+      }
+    }
+  }
+  // add the outputs of the trees [tree_begin, tree_end) to the margins of a row
+  static void PredRow(const RegTree::FVec& feats, const gbm::GBTreeModel& model,
+                      unsigned root_index, unsigned tree_begin, unsigned tree_end,
+                      bst_float* out) {
+    for (unsigned t = tree_begin; t < tree_end; ++t) {
+      const int tid = model.trees[t]->GetLeafIndex(feats, root_index);
+      out[model.tree_info[t]] += (*model.trees[t])[tid].LeafValue();
+    }
+  }
+  // the same over trees of vector leaves, a leaf adds to all the groups
+  static void PredRowVector(const RegTree::FVec& feats, const gbm::GBTreeModel& model,
+                            unsigned root_index, unsigned tree_begin, unsigned tree_end,
+                            bst_float* out) {
+    const int num_group = model.param.num_output_group;
+    for (unsigned t = tree_begin; t < tree_end; ++t) {
+      const bst_float* leaf =
+          model.trees[t]->Leafvec(model.trees[t]->GetLeafIndex(feats, root_index));
+      for (int gid = 0; gid < num_group; ++gid) out[gid] += leaf[gid];
+    }
+  }
+  // the same over the packed trees
+  static void PredRow(const gbm::PackedForest& forest, const std::vector<int>& tree_info,
+                      const RegTree::FVec& feats, unsigned tree_begin, unsigned tree_end,
+                      bst_float* out) {
+    for (unsigned t = tree_begin; t < tree_end; ++t) {
+      out[tree_info[t]] += forest.Predict(t, feats);
+    }
+  }
+  // copy rows [begin, begin + nrow) of the batch into a block of rows with a
+  // stride of num_feature values, missing values keep the bit pattern -1
+  static void FillBlock(const SparsePage& batch, bst_omp_uint begin, int nrow,
+                        size_t num_feature, int32_t* block) {
+    for (int k = 0; k < nrow; ++k) {
+      const SparsePage::Inst inst = batch[begin + k];
+      int32_t* row = block + k * num_feature;
+      for (bst_uint j = 0; j < inst.length; ++j) {
+        if (inst[j].index >= num_feature) continue;
+        std::memcpy(row + inst[j].index, &inst[j].fvalue, sizeof(int32_t));
+      }
+    }
+  }
+  static void DropBlock(const SparsePage& batch, bst_omp_uint begin, int nrow,
+                        size_t num_feature, int32_t* block) {
+    for (int k = 0; k < nrow; ++k) {
+      const SparsePage::Inst inst = batch[begin + k];
+      int32_t* row = block + k * num_feature;
+      for (bst_uint j = 0; j < inst.length; ++j) {
+        if (inst[j].index < num_feature) row[inst[j].index] = -1;
+      }
+    }
+  }
+  // init the blocks of the vectorised walk, all values missing
+  inline void InitBlockTemp(int nthread, size_t num_feature) {
+    block_temp.resize(nthread);
+    for (std::vector<int32_t>& block : block_temp) {
+      if (block.size() != kBlockRows * num_feature) {
+        block.assign(kBlockRows * num_feature, -1);
+      }
+    }
+  }
+  // whether every row of the batch has all num_feature features in index order
+  static bool IsDenseBatch(const SparsePage& batch, size_t num_feature) {
+    if (batch.data.size() != batch.Size() * num_feature) return false;
+    std::atomic<bool> dense(true);
+    common::ParallelFor(batch.Size(), [&](size_t i) {
+      const SparsePage::Inst inst = batch[i];
+      bool in_order = inst.length == num_feature;
+      for (bst_uint j = 0; j < inst.length && in_order; ++j) {
+        in_order = inst[j].index == j;
+      }
+      if (!in_order) dense = false;
+    });
+    return dense;
+  }
   inline void PredLoopSpecalize(DMatrix* p_fmat,
                                 std::vector<bst_float>* out_preds,
                                 const gbm::GBTreeModel& model, int num_group,
                                 unsigned tree_begin, unsigned tree_end) {
     const MetaInfo& info = p_fmat->Info();
     const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread, model.param.num_feature);
+    InitThreadTemp(nthread * kBlockRows, model.param.num_feature);
     std::vector<bst_float>& preds = *out_preds;
-    CHECK_EQ(model.param.size_leaf_vector, 0)
-        << "size_leaf_vector is enforced to 0 so far";
     CHECK_EQ(preds.size(), p_fmat->Info().num_row_ * num_group);
+    // the packed trees start from root 0 and keep one value per leaf
+    const bool vector_leaf = model.param.size_leaf_vector != 0;
+    const gbm::PackedForest& forest = model.GetPackedForest();
+    const bool packed = !vector_leaf && forest.single_root && info.root_index_.size() == 0;
+    const size_t num_feature = model.param.num_feature;
+    const bool simd = packed && SupportsAVX2() && num_feature != 0 &&
+        num_feature < (static_cast<size_t>(1) << 27);
+    if (simd) InitBlockTemp(nthread, num_feature);
     // start collecting the prediction
-     auto iter = p_fmat->RowIterator();
+    auto iter = p_fmat->RowIterator();
     iter->BeforeFirst();
     while (iter->Next()) {
-      const  auto& batch = iter->Value();
-      // parallel over local batch
-      constexpr int kUnroll = 8;
+      const auto& batch = iter->Value();
+      // the rows of a dense batch overwrite the whole feature vector,
+      // they are filled without index lookups and never dropped
+      const bool dense = IsDenseBatch(batch, model.param.num_feature);
+      // parallel over blocks of rows of the local batch, each row is filled
+      // once for all groups
       const auto nsize = static_cast<bst_omp_uint>(batch.Size());
-      const bst_omp_uint rest = nsize % kUnroll;
-#pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nsize - rest; i += kUnroll) {
-        const int tid = omp_get_thread_num();
-        RegTree::FVec& feats = thread_temp[tid];
-        int64_t ridx[kUnroll];
-        SparsePage::Inst inst[kUnroll];
-        for (int k = 0; k < kUnroll; ++k) {
-          ridx[k] = static_cast<int64_t>(batch.base_rowid + i + k);
+      const bst_omp_uint nblock = (nsize + kBlockRows - 1) / kBlockRows;
+      common::ParallelFor(nblock, [&](size_t b) {
+        RegTree::FVec* feats = &thread_temp[common::ThreadId() * kBlockRows];
+        const bst_omp_uint begin = b * kBlockRows;
+        const int nrow = static_cast<int>(
+            std::min(nsize - begin, static_cast<bst_omp_uint>(kBlockRows)));
+        const auto ridx = static_cast<size_t>(batch.base_rowid + begin);
+        bst_float* out = dmlc::BeginPtr(preds) + ridx * num_group;
+#ifdef XGBOOST_PREDICT_AVX2
+        if (simd) {
+          int32_t* block = dmlc::BeginPtr(block_temp[common::ThreadId()]);
+          FillBlock(batch, begin, nrow, num_feature, block);
+          PredBlockAVX2(forest, model.tree_info, block, static_cast<int>(num_feature),
+                        nrow, num_group, tree_begin, tree_end, out);
+          if (!dense) DropBlock(batch, begin, nrow, num_feature, block);
+          return;
         }
-        for (int k = 0; k < kUnroll; ++k) {
-          inst[k] = batch[i + k];
+#endif  // XGBOOST_PREDICT_AVX2
+        for (int k = 0; k < nrow; ++k) {
+          if (dense) {
+            feats[k].FillDense(batch[begin + k]);
+          } else {
+            feats[k].Fill(batch[begin + k]);
+          }
         }
-        for (int k = 0; k < kUnroll; ++k) {
-          for (int gid = 0; gid < num_group; ++gid) {
-            const size_t offset = ridx[k] * num_group + gid;
-            preds[offset] += this->PredValue(
-                inst[k], model.trees, model.tree_info, gid,
-                info.GetRoot(ridx[k]), &feats, tree_begin, tree_end);
+        if (packed) {
+          forest.PredictBlock(model.tree_info, feats, nrow, num_group,
+                              tree_begin, tree_end, out);
+        } else {
+          for (int k = 0; k < nrow; ++k) {
+            if (vector_leaf) {
+              PredRowVector(feats[k], model, info.GetRoot(ridx + k), tree_begin, tree_end,
+                            out + k * num_group);
+            } else {
+              PredRow(feats[k], model, info.GetRoot(ridx + k), tree_begin, tree_end,
+                      out + k * num_group);
+            }
           }
         }
-      }
-      for (bst_omp_uint i = nsize - rest; i < nsize; ++i) {
-        RegTree::FVec& feats = thread_temp[0];
-        const auto ridx = static_cast<int64_t>(batch.base_rowid + i);
-         auto inst = batch[i];
-        for (int gid = 0; gid < num_group; ++gid) {
-          const size_t offset = ridx * num_group + gid;
-          preds[offset] +=
-              this->PredValue(inst, model.trees, model.tree_info, gid,
-                              info.GetRoot(ridx), &feats, tree_begin, tree_end);
+        if (!dense) {
+          for (int k = 0; k < nrow; ++k) feats[k].Drop(batch[begin + k]);
+        }
+      });
+      if (dense) {
+        // mark all the features missing again
+        for (RegTree::FVec& feats : thread_temp) {
+          feats.Init(model.param.num_feature);
+        }
+        for (std::vector<int32_t>& block : block_temp) {
+          std::fill(block.begin(), block.end(), -1);
         }
       }
     }
   }
 
-  void PredLoopInternal(DMatrix* dmat, std::vector<bst_float>* out_preds,
-                        const gbm::GBTreeModel& model, int tree_begin,
-                        unsigned ntree_limit) {
+  virtual void PredLoopInternal(DMatrix* dmat, std::vector<bst_float>* out_preds,
+                                const gbm::GBTreeModel& model, int tree_begin,
+                                unsigned ntree_limit) {
     // TODO(Rory): Check if this specialisation actually improves performance
     PredLoopSpecalize(dmat, out_preds, model, model.param.num_output_group,
                       tree_begin, ntree_limit);
@@ -109,11 +254,12 @@ class CPUPredictor : public Predictor {
                         const gbm::GBTreeModel& model,
                         unsigned ntree_limit) {
     if (ntree_limit == 0 ||
-        ntree_limit * model.param.num_output_group >= model.trees.size()) {
+        ntree_limit * model.TreesPerRound() >= static_cast<unsigned>(model.param.num_trees)) {
       auto it = cache_.find(dmat);
       if (it != cache_.end()) {
         HostDeviceVector<bst_float>& y = it->second.predictions;
-        if (y.Size() != 0) {
+        // rows appended to the matrix are not in the cache yet
+        if (y.Size() != 0 && y.Size() == model.param.num_output_group * dmat->Info().num_row_) {
           out_preds->Resize(y.Size());
           std::copy(y.HostVector().begin(), y.HostVector().end(),
                     out_preds->HostVector().begin());
@@ -164,15 +310,128 @@ class CPUPredictor : public Predictor {
 
     this->InitOutPredictions(dmat->Info(), out_preds, model);
 
-    ntree_limit *= model.param.num_output_group;
-    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
-      ntree_limit = static_cast<unsigned>(model.trees.size());
+    // the trees of a model loaded in the packed layout may not be built, the
+    // packed prediction only reads the packed arrays
+    ntree_limit *= model.TreesPerRound();
+    if (ntree_limit == 0 || ntree_limit > static_cast<unsigned>(model.param.num_trees)) {
+      ntree_limit = static_cast<unsigned>(model.param.num_trees);
     }
 
     this->PredLoopInternal(dmat, &out_preds->HostVector(), model,
                            tree_begin, ntree_limit);
   }
 
+  void PredictFromDense(const bst_float* data, size_t nrow, size_t ncol,
+                        bst_float missing, const gbm::GBTreeModel& model,
+                        unsigned ntree_limit, bst_float* out_margin) override {
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
+    const int num_group = model.param.num_output_group;
+    ntree_limit *= model.TreesPerRound();
+    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model.trees.size());
+    }
+    std::fill(out_margin, out_margin + nrow * num_group, model.base_margin);
+    const bool vector_leaf = model.param.size_leaf_vector != 0;
+    const gbm::PackedForest& forest = model.GetPackedForest();
+    const auto nsize = static_cast<bst_omp_uint>(nrow);
+    common::ParallelFor(nsize, [&](size_t i) {
+      RegTree::FVec& feats = thread_temp[common::ThreadId()];
+      feats.FillDense(data + static_cast<size_t>(i) * ncol, ncol, missing);
+      bst_float* out = out_margin + static_cast<size_t>(i) * num_group;
+      if (vector_leaf) {
+        PredRowVector(feats, model, 0, 0, ntree_limit, out);
+      } else {
+        PredRow(forest, model.tree_info, feats, 0, ntree_limit, out);
+      }
+    });
+    // mark all the features missing again
+    for (int tid = 0; tid < nthread; ++tid) {
+      thread_temp[tid].Init(model.param.num_feature);
+    }
+  }
+
+  void PredictFromCSR(const size_t* indptr, const bst_uint* indices,
+                      const bst_float* data, size_t nrow,
+                      const gbm::GBTreeModel& model,
+                      unsigned ntree_limit, bst_float* out_margin) override {
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
+    const int num_group = model.param.num_output_group;
+    ntree_limit *= model.TreesPerRound();
+    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model.trees.size());
+    }
+    std::fill(out_margin, out_margin + nrow * num_group, model.base_margin);
+    const bool vector_leaf = model.param.size_leaf_vector != 0;
+    const gbm::PackedForest& forest = model.GetPackedForest();
+    const auto nsize = static_cast<bst_omp_uint>(nrow);
+    common::ParallelFor(nsize, [&](size_t i) {
+      RegTree::FVec& feats = thread_temp[common::ThreadId()];
+      const size_t begin = indptr[i], length = indptr[i + 1] - indptr[i];
+      feats.Fill(indices + begin, data + begin, length);
+      bst_float* out = out_margin + static_cast<size_t>(i) * num_group;
+      if (vector_leaf) {
+        PredRowVector(feats, model, 0, 0, ntree_limit, out);
+      } else {
+        PredRow(forest, model.tree_info, feats, 0, ntree_limit, out);
+      }
+      feats.Drop(indices + begin, length);
+    });
+  }
+
+  void PredictStaged(DMatrix* dmat, std::vector<bst_float>* out_margins,
+                     const gbm::GBTreeModel& model, unsigned stride,
+                     unsigned ntree_limit) override {
+    const std::vector<unsigned> stage_ends = StageEnds(model, stride, ntree_limit);
+    const MetaInfo& info = dmat->Info();
+    const int num_group = model.param.num_output_group;
+    const size_t num_stage = stage_ends.size();
+    const size_t row_size = num_stage * num_group;
+    std::vector<bst_float>& out = *out_margins;
+    out.resize(info.num_row_ * row_size);
+    if (num_stage == 0) return;
+    // the margins before the first tree
+    HostDeviceVector<bst_float> base;
+    this->InitOutPredictions(info, &base, model);
+    const std::vector<bst_float>& base_h = base.HostVector();
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
+    const bool vector_leaf = model.param.size_leaf_vector != 0;
+    const gbm::PackedForest& forest = model.GetPackedForest();
+    const bool packed = !vector_leaf && forest.single_root && info.root_index_.size() == 0;
+    auto iter = dmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const auto& batch = iter->Value();
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+      common::ParallelFor(nsize, [&](size_t i) {
+        RegTree::FVec& feats = thread_temp[common::ThreadId()];
+        const auto ridx = static_cast<size_t>(batch.base_rowid + i);
+        const unsigned root = info.GetRoot(ridx);
+        feats.Fill(batch[i]);
+        // each stage starts from the margins of the previous one and adds its trees
+        bst_float* row = dmlc::BeginPtr(out) + ridx * row_size;
+        std::copy(base_h.begin() + ridx * num_group, base_h.begin() + (ridx + 1) * num_group,
+                  row);
+        unsigned tree_begin = 0;
+        for (size_t s = 0; s < num_stage; ++s) {
+          bst_float* stage = row + s * num_group;
+          if (s != 0) std::copy(stage - num_group, stage, stage);
+          if (vector_leaf) {
+            PredRowVector(feats, model, root, tree_begin, stage_ends[s], stage);
+          } else if (packed) {
+            PredRow(forest, model.tree_info, feats, tree_begin, stage_ends[s], stage);
+          } else {
+            PredRow(feats, model, root, tree_begin, stage_ends[s], stage);
+          }
+          tree_begin = stage_ends[s];
+        }
+        feats.Drop(batch[i]);
+      });
+    }
+  }
+
   void UpdatePredictionCache(
       const gbm::GBTreeModel& model,
       std::vector<std::unique_ptr<TreeUpdater>>* updaters,
@@ -182,14 +441,13 @@ class CPUPredictor : public Predictor {
     for (auto& kv : cache_) {
       PredictionCacheEntry& e = kv.second;
 
-      if (e.predictions.Size() == 0) {
+      if (e.predictions.Size() != model.param.num_output_group * e.data->Info().num_row_) {
         InitOutPredictions(e.data->Info(), &(e.predictions), model);
         PredLoopInternal(e.data.get(), &(e.predictions.HostVector()), model, 0,
                          model.trees.size());
-      } else if (model.param.num_output_group == 1 && updaters->size() > 0 &&
+      } else if ((model.param.num_output_group == 1 || model.param.size_leaf_vector != 0) &&
                  num_new_trees == 1 &&
-                 updaters->back()->UpdatePredictionCache(e.data.get(),
-                                                         &(e.predictions))) {
+                 this->UpdateCacheByUpdater(updaters, &e)) {
         {}  // do nothing
       } else {
         PredLoopInternal(e.data.get(), &(e.predictions.HostVector()), model, old_ntree,
@@ -206,12 +464,11 @@ class CPUPredictor : public Predictor {
       thread_temp.resize(1, RegTree::FVec());
       thread_temp[0].Init(model.param.num_feature);
     }
-    ntree_limit *= model.param.num_output_group;
+    ntree_limit *= model.TreesPerRound();
     if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
       ntree_limit = static_cast<unsigned>(model.trees.size());
     }
-    out_preds->resize(model.param.num_output_group *
-                      (model.param.size_leaf_vector + 1));
+    out_preds->resize(model.param.num_output_group);
     // loop over output groups
     for (int gid = 0; gid < model.param.num_output_group; ++gid) {
       (*out_preds)[gid] =
@@ -226,7 +483,7 @@ class CPUPredictor : public Predictor {
     InitThreadTemp(nthread, model.param.num_feature);
     const MetaInfo& info = p_fmat->Info();
     // number of valid trees
-    ntree_limit *= model.param.num_output_group;
+    ntree_limit *= model.TreesPerRound();
     if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
       ntree_limit = static_cast<unsigned>(model.trees.size());
     }
@@ -239,9 +496,8 @@ class CPUPredictor : public Predictor {
       auto batch = iter->Value();
       // parallel over local batch
       const auto nsize = static_cast<bst_omp_uint>(batch.Size());
-#pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nsize; ++i) {
-        const int tid = omp_get_thread_num();
+      common::ParallelFor(nsize, [&](size_t i) {
+        const int tid = common::ThreadId();
         auto ridx = static_cast<size_t>(batch.base_rowid + i);
         RegTree::FVec& feats = thread_temp[tid];
         feats.Fill(batch[i]);
@@ -250,7 +506,44 @@ class CPUPredictor : public Predictor {
           preds[ridx * ntree_limit + j] = static_cast<bst_float>(tid);
         }
         feats.Drop(batch[i]);
-      }
+      });
+    }
+  }
+
+  void PredictLeafCodes(DMatrix* p_fmat, const gbm::GBTreeModel& model,
+                        const gbm::LeafCodes& codes, void* out) override {
+    if (codes.index_size == 2) {
+      this->WriteLeafCodes(p_fmat, model, codes, static_cast<uint16_t*>(out));
+    } else {
+      this->WriteLeafCodes(p_fmat, model, codes, static_cast<uint32_t*>(out));
+    }
+  }
+
+  // PredictLeaf into codes of IndexType, each row writes its own codes
+  template <typename IndexType>
+  void WriteLeafCodes(DMatrix* p_fmat, const gbm::GBTreeModel& model,
+                      const gbm::LeafCodes& codes, IndexType* out) {
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
+    const MetaInfo& info = p_fmat->Info();
+    const unsigned ntree = codes.num_tree;
+    auto iter = p_fmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      auto batch = iter->Value();
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+      common::ParallelFor(nsize, [&](size_t i) {
+        const int tid = common::ThreadId();
+        auto ridx = static_cast<size_t>(batch.base_rowid + i);
+        RegTree::FVec& feats = thread_temp[tid];
+        feats.Fill(batch[i]);
+        IndexType* row = out + ridx * ntree;
+        for (unsigned j = 0; j < ntree; ++j) {
+          const int nid = model.trees[j]->GetLeafIndex(feats, info.GetRoot(ridx));
+          row[j] = static_cast<IndexType>(codes.Code(j, nid));
+        }
+        feats.Drop(batch[i]);
+      });
     }
   }
 
@@ -259,8 +552,10 @@ class CPUPredictor : public Predictor {
                            bool approximate,
                            int condition,
                            unsigned condition_feature) override {
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "feature contributions do not support trees of vector leaves";
     const int nthread = omp_get_max_threads();
-    InitThreadTemp(nthread,  model.param.num_feature);
+    InitThreadTemp(nthread * kBlockRows, model.param.num_feature);
     const MetaInfo& info = p_fmat->Info();
     // number of valid trees
     ntree_limit *= model.param.num_output_group;
@@ -276,100 +571,231 @@ class CPUPredictor : public Predictor {
     // allocated one
     std::fill(contribs.begin(), contribs.end(), 0);
     // initialize tree node mean values
-    #pragma omp parallel for schedule(static)
-    for (bst_omp_uint i = 0; i < ntree_limit; ++i) {
-      model.trees[i]->FillNodeMeanValues();
-    }
+    InitTreeShap(model, ntree_limit, nthread);
     // start collecting the contributions
     auto iter = p_fmat->RowIterator();
     const std::vector<bst_float>& base_margin = info.base_margin_;
     iter->BeforeFirst();
     while (iter->Next()) {
       auto batch = iter->Value();
-      // parallel over local batch
+      // parallel over blocks of rows of the local batch, all rows of a block
+      // walk a tree in turn while its nodes are in cache
       const auto nsize = static_cast<bst_omp_uint>(batch.Size());
-#pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nsize; ++i) {
-        auto row_idx = static_cast<size_t>(batch.base_rowid + i);
-        unsigned root_id = info.GetRoot(row_idx);
-        RegTree::FVec& feats = thread_temp[omp_get_thread_num()];
-        // loop over all classes
-        for (int gid = 0; gid < ngroup; ++gid) {
-          bst_float* p_contribs =
-              &contribs[(row_idx * ngroup + gid) * ncolumns];
-          feats.Fill(batch[i]);
-          // calculate contributions
-          for (unsigned j = 0; j < ntree_limit; ++j) {
-            if (model.tree_info[j] != gid) {
-              continue;
-            }
+      const bst_omp_uint nblock = (nsize + kBlockRows - 1) / kBlockRows;
+      common::ParallelFor(nblock, [&](size_t b) {
+        const int tid = common::ThreadId();
+        RegTree::FVec* feats = &thread_temp[tid * kBlockRows];
+        PathElement* path = dmlc::BeginPtr(path_temp[tid]);
+        const bst_omp_uint begin = b * kBlockRows;
+        const int nrow = static_cast<int>(
+            std::min(nsize - begin, static_cast<bst_omp_uint>(kBlockRows)));
+        const auto ridx = static_cast<size_t>(batch.base_rowid + begin);
+        for (int k = 0; k < nrow; ++k) feats[k].Fill(batch[begin + k]);
+        // calculate contributions, the trees of a group add to the row in order
+        for (unsigned j = 0; j < ntree_limit; ++j) {
+          const RegTree& tree = *model.trees[j];
+          const int gid = model.tree_info[j];
+          for (int k = 0; k < nrow; ++k) {
+            bst_float* p_contribs = &contribs[((ridx + k) * ngroup + gid) * ncolumns];
+            const unsigned root_id = info.GetRoot(ridx + k);
             if (!approximate) {
-              model.trees[j]->CalculateContributions(feats, root_id, p_contribs,
-                                                     condition, condition_feature);
+              tree.CalculateContributions(feats[k], root_id, p_contribs,
+                                          condition, condition_feature, path);
             } else {
-              model.trees[j]->CalculateContributionsApprox(feats, root_id, p_contribs);
+              tree.CalculateContributionsApprox(feats[k], root_id, p_contribs);
             }
           }
-          feats.Drop(batch[i]);
+        }
+        for (int k = 0; k < nrow; ++k) {
+          feats[k].Drop(batch[begin + k]);
           // add base margin to BIAS
-          if (base_margin.size() != 0) {
-            p_contribs[ncolumns - 1] += base_margin[row_idx * ngroup + gid];
-          } else {
-            p_contribs[ncolumns - 1] += model.base_margin;
+          for (int gid = 0; gid < ngroup; ++gid) {
+            bst_float* p_contribs = &contribs[((ridx + k) * ngroup + gid) * ncolumns];
+            if (base_margin.size() != 0) {
+              p_contribs[ncolumns - 1] += base_margin[(ridx + k) * ngroup + gid];
+            } else {
+              p_contribs[ncolumns - 1] += model.base_margin;
+            }
           }
         }
-      }
+      });
     }
   }
 
   void PredictInteractionContributions(DMatrix* p_fmat, std::vector<bst_float>* out_contribs,
                                        const gbm::GBTreeModel& model, unsigned ntree_limit,
                                        bool approximate) override {
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "feature contributions do not support trees of vector leaves";
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
     const MetaInfo& info = p_fmat->Info();
+    // number of valid trees
+    ntree_limit *= model.param.num_output_group;
+    if (ntree_limit == 0 || ntree_limit > model.trees.size()) {
+      ntree_limit = static_cast<unsigned>(model.trees.size());
+    }
     const int ngroup = model.param.num_output_group;
-    size_t ncolumns = model.param.num_feature;
-    const unsigned row_chunk = ngroup * (ncolumns + 1) * (ncolumns + 1);
-    const unsigned mrow_chunk = (ncolumns + 1) * (ncolumns + 1);
-    const unsigned crow_chunk = ngroup * (ncolumns + 1);
-
-    // allocate space for (number of features^2) times the number of rows and tmp off/on contribs
+    const size_t ncolumns = model.param.num_feature + 1;
+    // allocate space for (number of features + bias)^2 times the number of rows
     std::vector<bst_float>& contribs = *out_contribs;
-    contribs.resize(info.num_row_ * ngroup * (ncolumns + 1) * (ncolumns + 1));
-    std::vector<bst_float> contribs_off(info.num_row_ * ngroup * (ncolumns + 1));
-    std::vector<bst_float> contribs_on(info.num_row_ * ngroup * (ncolumns + 1));
-    std::vector<bst_float> contribs_diag(info.num_row_ * ngroup * (ncolumns + 1));
+    contribs.resize(info.num_row_ * ngroup * ncolumns * ncolumns);
+    std::fill(contribs.begin(), contribs.end(), 0);
+    // the features each tree splits on, conditioning a tree on any other
+    // feature leaves its contributions unchanged, so they interact with none
+    std::vector<std::vector<unsigned>> tree_features(ntree_limit);
+    common::ParallelFor(ntree_limit, [&](size_t i) {
+      const RegTree& tree = *model.trees[i];
+      std::vector<unsigned>& features = tree_features[i];
+      for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+        if (!tree[nid].IsLeaf() && !tree[nid].IsDeleted()) {
+          features.push_back(tree[nid].SplitIndex());
+        }
+      }
+      std::sort(features.begin(), features.end());
+      features.erase(std::unique(features.begin(), features.end()), features.end());
+    });
+    InitTreeShap(model, ntree_limit, nthread);
+    // per thread contributions of a row: all features, then the tree
+    // conditioned on and off a feature
+    std::vector<std::vector<bst_float>> phi_temp(nthread,
+                                                 std::vector<bst_float>(3 * ncolumns));
 
     // Compute the difference in effects when conditioning on each of the features on and off
     // see: Axiomatic characterizations of probabilistic and
     //      cardinal-probabilistic interaction indices
-    PredictContribution(p_fmat, &contribs_diag, model, ntree_limit, approximate, 0, 0);
-    for (size_t i = 0; i < ncolumns + 1; ++i) {
-      PredictContribution(p_fmat, &contribs_off, model, ntree_limit, approximate, -1, i);
-      PredictContribution(p_fmat, &contribs_on, model, ntree_limit, approximate, 1, i);
-
-      for (size_t j = 0; j < info.num_row_; ++j) {
-        for (int l = 0; l < ngroup; ++l) {
-          const unsigned o_offset = j * row_chunk + l * mrow_chunk + i * (ncolumns + 1);
-          const unsigned c_offset = j * crow_chunk + l * (ncolumns + 1);
-          contribs[o_offset + i] = 0;
-          for (size_t k = 0; k < ncolumns + 1; ++k) {
-            // fill in the diagonal with additive effects, and off-diagonal with the interactions
-            if (k == i) {
-              contribs[o_offset + i] += contribs_diag[c_offset + k];
-            } else {
-              contribs[o_offset + k] = (contribs_on[c_offset + k] - contribs_off[c_offset + k])/2.0;
-              contribs[o_offset + i] -= contribs[o_offset + k];
+    auto iter = p_fmat->RowIterator();
+    const std::vector<bst_float>& base_margin = info.base_margin_;
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      auto batch = iter->Value();
+      // parallel over local batch
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+      common::ParallelFor(nsize, [&](size_t i) {
+        const int tid = common::ThreadId();
+        auto row_idx = static_cast<size_t>(batch.base_rowid + i);
+        unsigned root_id = info.GetRoot(row_idx);
+        RegTree::FVec& feats = thread_temp[tid];
+        bst_float* diag = dmlc::BeginPtr(phi_temp[tid]);
+        bst_float* on = diag + ncolumns;
+        bst_float* off = on + ncolumns;
+        PathElement* path = dmlc::BeginPtr(path_temp[tid]);
+        feats.Fill(batch[i]);
+        // loop over all classes
+        for (int gid = 0; gid < ngroup; ++gid) {
+          bst_float* p_contribs = &contribs[(row_idx * ngroup + gid) * ncolumns * ncolumns];
+          std::fill(diag, diag + ncolumns, 0.0f);
+          for (unsigned j = 0; j < ntree_limit; ++j) {
+            if (model.tree_info[j] != gid) {
+              continue;
+            }
+            const RegTree& tree = *model.trees[j];
+            if (approximate) {
+              // the approximation ignores the condition, it sees no interactions
+              tree.CalculateContributionsApprox(feats, root_id, diag);
+              continue;
             }
+            tree.CalculateContributions(feats, root_id, diag, 0, 0, path);
+            // the tree only writes the contributions of its own features
+            const std::vector<unsigned>& features = tree_features[j];
+            for (unsigned fid : features) {
+              for (unsigned k : features) {
+                on[k] = 0;
+                off[k] = 0;
+              }
+              tree.CalculateContributions(feats, root_id, on, 1, fid, path);
+              tree.CalculateContributions(feats, root_id, off, -1, fid, path);
+              bst_float* p_row = p_contribs + fid * ncolumns;
+              for (unsigned k : features) {
+                if (k == fid) continue;
+                const bst_float interaction = (on[k] - off[k]) / 2.0f;
+                p_row[k] += interaction;
+                p_row[fid] -= interaction;
+              }
+            }
+          }
+          // fill in the diagonal with the additive effects, base margin to BIAS
+          for (size_t k = 0; k < ncolumns; ++k) {
+            p_contribs[k * ncolumns + k] += diag[k];
+          }
+          if (base_margin.size() != 0) {
+            p_contribs[ncolumns * ncolumns - 1] += base_margin[row_idx * ngroup + gid];
+          } else {
+            p_contribs[ncolumns * ncolumns - 1] += model.base_margin;
           }
         }
-      }
+        feats.Drop(batch[i]);
+      });
     }
   }
   std::vector<RegTree::FVec> thread_temp;
+  // per thread blocks of kBlockRows rows for the vectorised walk
+  std::vector<std::vector<int32_t>> block_temp;
+  // per thread TreeShap unique path scratch, see InitTreeShap
+  std::vector<std::vector<PathElement>> path_temp;
 };
 
 XGBOOST_REGISTER_PREDICTOR(CPUPredictor, "cpu_predictor")
     .describe("Make predictions using CPU.")
     .set_body([]() { return new CPUPredictor(); });
+
+/*!
+ * \brief CPU predictor scoring batches from the first tree on with the
+ *  QuickScorer index, see quickscorer.h. The rest, e.g. the prediction cache
+ *  updates with a few new trees, leaf and contribution prediction, is the
+ *  same as cpu_predictor.
+ */
+class QuickScorerPredictor : public CPUPredictor {
+ protected:
+  void PredLoopInternal(DMatrix* dmat, std::vector<bst_float>* out_preds,
+                        const gbm::GBTreeModel& model, int tree_begin,
+                        unsigned tree_end) override {
+    if (model.param.size_leaf_vector != 0) {
+      // the index keeps one value per leaf
+      CPUPredictor::PredLoopInternal(dmat, out_preds, model, tree_begin, tree_end);
+      return;
+    }
+    if (!index_.Matches(model)) index_.Build(model);
+    const MetaInfo& info = dmat->Info();
+    if (tree_begin != 0 || !index_.SingleRoot() || info.root_index_.size() != 0) {
+      CPUPredictor::PredLoopInternal(dmat, out_preds, model, tree_begin, tree_end);
+      return;
+    }
+    const int num_group = model.param.num_output_group;
+    std::vector<bst_float>& preds = *out_preds;
+    CHECK_EQ(preds.size(), info.num_row_ * num_group);
+    const int nthread = omp_get_max_threads();
+    InitThreadTemp(nthread, model.param.num_feature);
+    bits_temp_.resize(nthread);
+    for (std::vector<uint64_t>& bits : bits_temp_) {
+      bits.resize(static_cast<size_t>(tree_end) * index_.NumWord());
+    }
+    auto iter = dmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const auto& batch = iter->Value();
+      const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+      common::ParallelFor(nsize, [&](size_t i) {
+        const int tid = common::ThreadId();
+        RegTree::FVec& feats = thread_temp[tid];
+        const auto ridx = static_cast<size_t>(batch.base_rowid + i);
+        const SparsePage::Inst inst = batch[i];
+        feats.Fill(inst);
+        index_.Predict(feats, model.tree_info, tree_end, dmlc::BeginPtr(bits_temp_[tid]),
+                       dmlc::BeginPtr(preds) + ridx * num_group);
+        feats.Drop(inst);
+      });
+    }
+  }
+
+ private:
+  QuickScorerIndex index_;
+  // per thread leaf bitvectors
+  std::vector<std::vector<uint64_t>> bits_temp_;
+};
+
+XGBOOST_REGISTER_PREDICTOR(QuickScorerPredictor, "quickscorer_cpu")
+    .describe("Make predictions using CPU, scoring shallow ensembles with QuickScorer.")
+    .set_body([]() { return new QuickScorerPredictor(); });
 }  // namespace predictor
 }  // namespace xgboost
@@ -0,0 +1,100 @@
+/*!
+ * Copyright by Contributors 2018
+ * \file device_tree.cuh
+ * \brief device copy of the trees of a model, shared by the GPU predictor and
+ *  the GPU robustness bounds.
+ */
+#ifndef XGBOOST_PREDICTOR_DEVICE_TREE_CUH_
+#define XGBOOST_PREDICTOR_DEVICE_TREE_CUH_
+
+#include <thrust/host_vector.h>
+#include <xgboost/tree_model.h>
+#include <algorithm>
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace predictor {
+
+/**
+ * \struct  DevicePredictionNode
+ *
+ * \brief Packed 16 byte representation of a tree node for use in device
+ * prediction
+ */
+
+struct DevicePredictionNode {
+  XGBOOST_DEVICE DevicePredictionNode()
+      : fidx(-1), left_child_idx(-1), right_child_idx(-1) {}
+
+  union NodeValue {
+    float leaf_weight;
+    float fvalue;
+  };
+
+  int fidx;
+  int left_child_idx;
+  int right_child_idx;
+  NodeValue val;
+
+  DevicePredictionNode(const RegTree::Node& n) {  // NOLINT
+    this->left_child_idx = n.LeftChild();
+    this->right_child_idx = n.RightChild();
+    this->fidx = n.SplitIndex();
+    if (n.DefaultLeft()) {
+      fidx |= (1U << 31);
+    }
+
+    if (n.IsLeaf()) {
+      this->val.leaf_weight = n.LeafValue();
+    } else {
+      this->val.fvalue = n.SplitCond();
+    }
+  }
+
+  XGBOOST_DEVICE bool IsLeaf() const { return left_child_idx == -1; }
+
+  XGBOOST_DEVICE int GetFidx() const { return fidx & ((1U << 31) - 1U); }
+
+  XGBOOST_DEVICE bool MissingLeft() const { return (fidx >> 31) != 0; }
+
+  XGBOOST_DEVICE int MissingIdx() const {
+    if (MissingLeft()) {
+      return this->left_child_idx;
+    } else {
+      return this->right_child_idx;
+    }
+  }
+
+  XGBOOST_DEVICE float GetFvalue() const { return val.fvalue; }
+
+  XGBOOST_DEVICE float GetWeight() const { return val.leaf_weight; }
+};
+
+/**
+ * \brief Flatten trees [tree_begin, tree_end) of a model. The nodes of tree
+ *  tree_begin + i are [h_tree_segments[i], h_tree_segments[i + 1]) of h_nodes.
+ */
+inline void FlattenTrees(const gbm::GBTreeModel& model, size_t tree_begin,
+                         size_t tree_end,
+                         thrust::host_vector<size_t>* h_tree_segments,
+                         thrust::host_vector<DevicePredictionNode>* h_nodes) {
+  h_tree_segments->clear();
+  h_tree_segments->reserve((tree_end - tree_begin) + 1);
+  size_t sum = 0;
+  h_tree_segments->push_back(sum);
+  for (auto tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
+    sum += model.trees[tree_idx]->GetNodes().size();
+    h_tree_segments->push_back(sum);
+  }
+
+  h_nodes->resize(h_tree_segments->back());
+  for (auto tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
+    auto& src_nodes = model.trees[tree_idx]->GetNodes();
+    std::copy(src_nodes.begin(), src_nodes.end(),
+              h_nodes->begin() + (*h_tree_segments)[tree_idx - tree_begin]);
+  }
+}
+
+}  // namespace predictor
+}  // namespace xgboost
+#endif  // XGBOOST_PREDICTOR_DEVICE_TREE_CUH_
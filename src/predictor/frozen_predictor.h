@@ -0,0 +1,216 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file frozen_predictor.h
+ * \brief read only snapshot of a tree model, shared by concurrent predictions.
+ *
+ *  The predictions of a Learner go through the prediction cache of its booster
+ *  and the per thread buffers of its predictor, so a Learner can not serve
+ *  several threads at once. A FrozenPredictor loads a copy of the model and
+ *  packs its trees once; it is not modified after construction. A call scores
+ *  the rows of caller buffers in the calling thread, a block of rows through
+ *  each tree at a time, with the feature vectors of the block kept per thread,
+ *  so any number of threads can predict from one snapshot without locks.
+ */
+#ifndef XGBOOST_PREDICTOR_FROZEN_PREDICTOR_H_
+#define XGBOOST_PREDICTOR_FROZEN_PREDICTOR_H_
+
+#include <dmlc/thread_local.h>
+#include <xgboost/base.h>
+#include <xgboost/gbm.h>
+#include <xgboost/learner.h>
+#include <xgboost/tree_model.h>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../common/host_device_vector.h"
+#include "../common/io.h"
+#include "../common/threading.h"
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace predictor {
+
+class FrozenPredictor {
+ public:
+  /*! \brief snapshot of the model of learner, later changes of it are not seen */
+  explicit FrozenPredictor(const Learner& learner) : nthread_(learner.NumThreads()) {
+    std::string buffer;
+    common::MemoryBufferStream fo(&buffer);
+    learner.Save(&fo);
+    common::MemoryBufferStream fi(&buffer);
+    learner_.reset(Learner::Create({}));
+    learner_->Load(&fi);
+    model_ = learner_->GetGradientBooster()->GetTreeModel();
+    CHECK(model_ != nullptr) << "frozen predictors only support booster=gbtree";
+    CHECK_EQ(model_->param.size_leaf_vector, 0)
+        << "size_leaf_vector is enforced to 0 so far";
+    forest_ = model_->GetPackedForest();
+    CHECK(forest_.single_root) << "frozen predictors only support trees of one root";
+    if (model_->param.num_output_group == 1) this->InitDecisionOrder();
+  }
+  /*! \return number of features of the model */
+  inline int NumFeature() const {
+    return model_->param.num_feature;
+  }
+  /*! \return number of margins of a row */
+  inline int NumOutputGroup() const {
+    return model_->param.num_output_group;
+  }
+  /*! \brief the margins of the rows of a dense row major buffer, see Predictor */
+  inline void PredictFromDense(const bst_float* data, size_t nrow, size_t ncol,
+                               bst_float missing, unsigned ntree_limit,
+                               bst_float* out_margin) const {
+    RegTree::FVec* feats = ThreadFeatures();
+    const unsigned tree_end = TreeEnd(ntree_limit);
+    const int num_group = NumOutputGroup();
+    std::fill(out_margin, out_margin + nrow * num_group, model_->base_margin);
+    for (size_t begin = 0; begin < nrow; begin += kBlockRows) {
+      const int nblock = static_cast<int>(
+          std::min(nrow - begin, static_cast<size_t>(kBlockRows)));
+      for (int k = 0; k < nblock; ++k) {
+        feats[k].FillDense(data + (begin + k) * ncol, ncol, missing);
+      }
+      forest_.PredictBlock(model_->tree_info, feats, nblock, num_group, 0, tree_end,
+                           out_margin + begin * num_group);
+    }
+    // mark all the features missing again
+    for (int k = 0; k < kBlockRows; ++k) feats[k].Init(model_->param.num_feature);
+  }
+  /*! \brief the margins of the rows of CSR buffers, see Predictor */
+  inline void PredictFromCSR(const size_t* indptr, const bst_uint* indices,
+                             const bst_float* data, size_t nrow, unsigned ntree_limit,
+                             bst_float* out_margin) const {
+    RegTree::FVec* feats = ThreadFeatures();
+    const unsigned tree_end = TreeEnd(ntree_limit);
+    const int num_group = NumOutputGroup();
+    std::fill(out_margin, out_margin + nrow * num_group, model_->base_margin);
+    for (size_t begin = 0; begin < nrow; begin += kBlockRows) {
+      const int nblock = static_cast<int>(
+          std::min(nrow - begin, static_cast<size_t>(kBlockRows)));
+      for (int k = 0; k < nblock; ++k) {
+        const size_t i = begin + k;
+        feats[k].Fill(indices + indptr[i], data + indptr[i], indptr[i + 1] - indptr[i]);
+      }
+      forest_.PredictBlock(model_->tree_info, feats, nblock, num_group, 0, tree_end,
+                           out_margin + begin * num_group);
+      for (int k = 0; k < nblock; ++k) {
+        const size_t i = begin + k;
+        feats[k].Drop(indices + indptr[i], indptr[i + 1] - indptr[i]);
+      }
+    }
+  }
+  /*!
+   * \brief whether the margins of the rows of a dense row major buffer exceed
+   *  threshold, for models of one output group. The trees are walked in the
+   *  order of decreasing range of their leaf values, and a row stops once the
+   *  bounds of the remaining trees can not move its margin across threshold.
+   *  The margin is summed in that order, in double, so a margin within
+   *  rounding of threshold may be decided otherwise than the full prediction.
+   * \param out_decision 1 for the rows whose margin exceeds threshold, else 0
+   * \param out_ntree number of trees walked by each row if not nullptr
+   */
+  inline void PredictDecision(const bst_float* data, size_t nrow, size_t ncol,
+                              bst_float missing, bst_float threshold,
+                              bst_float* out_decision, unsigned* out_ntree) const {
+    CHECK_EQ(NumOutputGroup(), 1) << "decisions are only defined for one output group";
+    RegTree::FVec& feats = ThreadFeatures()[0];
+    const size_t ntree = decision_order_.size();
+    for (size_t i = 0; i < nrow; ++i) {
+      feats.FillDense(data + i * ncol, ncol, missing);
+      double margin = model_->base_margin;
+      size_t k = 0;
+      // undecided while margin + rest_min_[k] <= threshold < margin + rest_max_[k]
+      while (k < ntree && margin + rest_min_[k] <= threshold &&
+             margin + rest_max_[k] > threshold) {
+        margin += forest_.Predict(decision_order_[k], feats);
+        ++k;
+      }
+      out_decision[i] = margin + rest_min_[k] > threshold ? 1.0f : 0.0f;
+      if (out_ntree != nullptr) out_ntree[i] = static_cast<unsigned>(k);
+    }
+    feats.Init(model_->param.num_feature);
+  }
+  /*! \brief transform margins into predictions in place, as Learner::PredTransform */
+  inline void PredTransform(HostDeviceVector<bst_float>* io_preds) const {
+    common::OmpThreadScope threads(nthread_);
+    learner_->PredTransform(io_preds);
+  }
+
+ private:
+  // rows scored together, see PackedForest::PredictBlock
+  static constexpr int kBlockRows = gbm::PackedForest::kMaxBlockRows;
+  // feature vectors of a block of rows of the calling thread, all missing
+  // between calls
+  struct ThreadEntry {
+    std::vector<RegTree::FVec> feats;
+  };
+  inline RegTree::FVec* ThreadFeatures() const {
+    std::vector<RegTree::FVec>& feats = dmlc::ThreadLocalStore<ThreadEntry>::Get()->feats;
+    feats.resize(kBlockRows);
+    for (RegTree::FVec& f : feats) {
+      if (f.Size() != static_cast<size_t>(model_->param.num_feature)) {
+        f.Init(model_->param.num_feature);
+      }
+    }
+    return dmlc::BeginPtr(feats);
+  }
+  inline unsigned TreeEnd(unsigned ntree_limit) const {
+    ntree_limit *= model_->param.num_output_group;
+    if (ntree_limit == 0 || ntree_limit > model_->trees.size()) {
+      ntree_limit = static_cast<unsigned>(model_->trees.size());
+    }
+    return ntree_limit;
+  }
+
+  // order the trees for PredictDecision, and bound the trees after each
+  inline void InitDecisionOrder() {
+    const size_t ntree = forest_.tree_root.size();
+    std::vector<double> lower(ntree), upper(ntree);
+    for (size_t t = 0; t < ntree; ++t) {
+      lower[t] = std::numeric_limits<double>::max();
+      upper[t] = std::numeric_limits<double>::lowest();
+      std::vector<int> queue(1, forest_.tree_root[t]);
+      for (size_t i = 0; i < queue.size(); ++i) {
+        const int ref = queue[i];
+        if (ref < 0) {
+          lower[t] = std::min(lower[t], static_cast<double>(forest_.leaf_value[~ref]));
+          upper[t] = std::max(upper[t], static_cast<double>(forest_.leaf_value[~ref]));
+        } else {
+          queue.push_back(forest_.children[2 * ref]);
+          queue.push_back(forest_.children[2 * ref + 1]);
+        }
+      }
+    }
+    // the trees that can move the margin most go first, ties by tree index
+    decision_order_.resize(ntree);
+    for (size_t t = 0; t < ntree; ++t) decision_order_[t] = static_cast<unsigned>(t);
+    std::stable_sort(decision_order_.begin(), decision_order_.end(),
+                     [&](unsigned a, unsigned b) {
+                       return upper[a] - lower[a] > upper[b] - lower[b];
+                     });
+    rest_min_.assign(ntree + 1, 0.0);
+    rest_max_.assign(ntree + 1, 0.0);
+    for (size_t k = ntree; k > 0; --k) {
+      rest_min_[k - 1] = rest_min_[k] + lower[decision_order_[k - 1]];
+      rest_max_[k - 1] = rest_max_[k] + upper[decision_order_[k - 1]];
+    }
+  }
+
+  // the copy of the model, only read after construction
+  std::unique_ptr<Learner> learner_;
+  // the nthread of the learner, the copy is loaded without its parameters
+  int nthread_;
+  const gbm::GBTreeModel* model_;
+  gbm::PackedForest forest_;
+  // trees in the order of PredictDecision, and the sums of the smallest and
+  // largest leaf values of the trees from the k-th of that order on
+  std::vector<unsigned> decision_order_;
+  std::vector<double> rest_min_;
+  std::vector<double> rest_max_;
+};
+
+}  // namespace predictor
+}  // namespace xgboost
+#endif  // XGBOOST_PREDICTOR_FROZEN_PREDICTOR_H_
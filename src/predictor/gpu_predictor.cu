@@ -10,9 +10,12 @@
 #include <xgboost/predictor.h>
 #include <xgboost/tree_model.h>
 #include <xgboost/tree_updater.h>
+#include <algorithm>
 #include <memory>
 #include "../common/device_helpers.cuh"
 #include "../common/host_device_vector.h"
+#include "./device_tree.cuh"
+#include "./shap_paths.h"
 
 namespace xgboost {
 namespace predictor {
@@ -54,6 +57,9 @@ struct DeviceMatrix {
   dh::DVec<size_t> row_ptr;
   dh::DVec<Entry> data;
   thrust::device_vector<float> predictions;
+  /*! \brief feature major dense copy of the rows, NaN for a missing value */
+  thrust::device_vector<float> dense;
+  size_t dense_cols{0};
 
   DeviceMatrix(DMatrix* dmat, int device_idx, bool silent) : p_mat(dmat) {
     dh::safe_cuda(cudaSetDevice(device_idx));
@@ -83,60 +89,41 @@ struct DeviceMatrix {
   }
 };
 
-/**
- * \struct  DevicePredictionNode
- *
- * \brief Packed 16 byte representation of a tree node for use in device
- * prediction
- */
-
-struct DevicePredictionNode {
-  XGBOOST_DEVICE DevicePredictionNode()
-      : fidx(-1), left_child_idx(-1), right_child_idx(-1) {}
-
-  union NodeValue {
-    float leaf_weight;
-    float fvalue;
-  };
-
-  int fidx;
-  int left_child_idx;
-  int right_child_idx;
-  NodeValue val;
-
-  DevicePredictionNode(const RegTree::Node& n) {  // NOLINT
-    this->left_child_idx = n.LeftChild();
-    this->right_child_idx = n.RightChild();
-    this->fidx = n.SplitIndex();
-    if (n.DefaultLeft()) {
-      fidx |= (1U << 31);
-    }
-
-    if (n.IsLeaf()) {
-      this->val.leaf_weight = n.LeafValue();
-    } else {
-      this->val.fvalue = n.SplitCond();
-    }
+__global__ void DenseTransposeKernel(const size_t* d_row_ptr,
+                                     const Entry* d_data, size_t num_rows,
+                                     size_t num_cols, float* d_dense) {
+  size_t ridx = static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x;
+  if (ridx >= num_rows) return;
+  for (size_t elem_idx = d_row_ptr[ridx]; elem_idx < d_row_ptr[ridx + 1];
+       elem_idx++) {
+    Entry elem = d_data[elem_idx];
+    if (elem.index < num_cols) d_dense[elem.index * num_rows + ridx] = elem.fvalue;
   }
+}
 
-  XGBOOST_DEVICE bool IsLeaf() const { return left_child_idx == -1; }
-
-  XGBOOST_DEVICE int GetFidx() const { return fidx & ((1U << 31) - 1U); }
-
-  XGBOOST_DEVICE bool MissingLeft() const { return (fidx >> 31) != 0; }
-
-  XGBOOST_DEVICE int MissingIdx() const {
-    if (MissingLeft()) {
-      return this->left_child_idx;
-    } else {
-      return this->right_child_idx;
-    }
+/**
+ * \brief Build the feature major dense copy of a matrix with num_cols columns.
+ *  The lanes of a warp hold consecutive rows, so the loads of a feature tested
+ *  by the whole warp are coalesced.
+ */
+void InitDense(DeviceMatrix* device_matrix, size_t num_cols) {
+  if (device_matrix->dense_cols == num_cols &&
+      device_matrix->dense.size() != 0) {
+    return;
   }
-
-  XGBOOST_DEVICE float GetFvalue() const { return val.fvalue; }
-
-  XGBOOST_DEVICE float GetWeight() const { return val.leaf_weight; }
-};
+  const size_t num_rows = device_matrix->row_ptr.Size() - 1;
+  device_matrix->dense.resize(num_rows * num_cols);
+  thrust::fill(device_matrix->dense.begin(), device_matrix->dense.end(),
+               nanf(""));
+  const int BLOCK_THREADS = 256;
+  const int GRID_SIZE =
+      static_cast<int>(dh::DivRoundUp(num_rows, BLOCK_THREADS));
+  DenseTransposeKernel<<<GRID_SIZE, BLOCK_THREADS>>>(
+      device_matrix->row_ptr.Data(), device_matrix->data.Data(), num_rows,
+      num_cols, dh::Raw(device_matrix->dense));
+  dh::safe_cuda(cudaGetLastError());
+  device_matrix->dense_cols = num_cols;
+}
 
 struct ElementLoader {
   bool use_shared;
@@ -251,6 +238,115 @@ __global__ void PredictKernel(const DevicePredictionNode* d_nodes,
   }
 }
 
+__device__ float GetLeafWeightDense(size_t ridx, const DevicePredictionNode* tree,
+                                    const float* d_dense, size_t num_rows) {
+  DevicePredictionNode n = tree[0];
+  while (!n.IsLeaf()) {
+    float fvalue = d_dense[n.GetFidx() * num_rows + ridx];
+    // Missing value
+    if (isnan(fvalue)) {
+      n = tree[n.MissingIdx()];
+    } else {
+      if (fvalue < n.GetFvalue()) {
+        n = tree[n.left_child_idx];
+      } else {
+        n = tree[n.right_child_idx];
+      }
+    }
+  }
+  return n.GetWeight();
+}
+
+/**
+ * \brief Prediction over the dense copy of the rows, staging the trees in
+ *  shared memory. Tile i holds trees [d_tile_segments[i],
+ *  d_tile_segments[i + 1]), counted from tree_begin, and all threads of a block
+ *  copy it before walking it, so the node fetches of a tree are read from
+ *  global memory once per block instead of once per row.
+ */
+template <int BLOCK_THREADS>
+__global__ void PredictTiledKernel(const DevicePredictionNode* d_nodes,
+                                   float* d_out_predictions,
+                                   const size_t* d_tree_segments,
+                                   const int* d_tree_group,
+                                   const size_t* d_tile_segments,
+                                   size_t num_tiles, const float* d_dense,
+                                   size_t tree_begin, size_t num_rows,
+                                   int num_group) {
+  extern __shared__ int4 tile_storage[];
+  DevicePredictionNode* s_nodes =
+      reinterpret_cast<DevicePredictionNode*>(tile_storage);
+  size_t global_idx = static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x;
+  float sum = 0;
+  for (size_t tile = 0; tile < num_tiles; tile++) {
+    size_t tile_begin = d_tile_segments[tile];
+    size_t tile_end = d_tile_segments[tile + 1];
+    size_t node_begin = d_tree_segments[tile_begin];
+    size_t num_nodes = d_tree_segments[tile_end] - node_begin;
+    // the previous tile is no longer read
+    __syncthreads();
+    for (auto i : dh::BlockStrideRange(static_cast<size_t>(0), num_nodes)) {
+      s_nodes[i] = d_nodes[node_begin + i];
+    }
+    __syncthreads();
+    if (global_idx >= num_rows) continue;
+    for (size_t tree_idx = tile_begin; tree_idx < tile_end; tree_idx++) {
+      float weight = GetLeafWeightDense(
+          global_idx, s_nodes + (d_tree_segments[tree_idx] - node_begin),
+          d_dense, num_rows);
+      if (num_group == 1) {
+        sum += weight;
+      } else {
+        int tree_group = d_tree_group[tree_begin + tree_idx];
+        d_out_predictions[global_idx * num_group + tree_group] += weight;
+      }
+    }
+  }
+  if (num_group == 1 && global_idx < num_rows) {
+    d_out_predictions[global_idx] += sum;
+  }
+}
+
+/**
+ * \brief Prediction of the cumulative margins after each stage of the trees.
+ *  Stage s ends before tree d_stage_ends[s], the margins of a row start from
+ *  d_base and are written once per stage, row major over the stages and the
+ *  groups, while its trees are walked once.
+ */
+template <int BLOCK_THREADS>
+__global__ void PredictStagedKernel(const DevicePredictionNode* d_nodes,
+                                    const float* d_base, float* d_out_margins,
+                                    const size_t* d_tree_segments,
+                                    const int* d_tree_group,
+                                    const unsigned* d_stage_ends,
+                                    size_t num_stages, size_t* d_row_ptr,
+                                    Entry* d_data, size_t num_features,
+                                    size_t num_rows, bool use_shared,
+                                    int num_group) {
+  extern __shared__ float smem[];
+  bst_uint global_idx = blockDim.x * blockIdx.x + threadIdx.x;
+  ElementLoader loader(use_shared, d_row_ptr, d_data, num_features, smem,
+                       num_rows);
+  if (global_idx >= num_rows) return;
+  float* out = d_out_margins + static_cast<size_t>(global_idx) * num_stages * num_group;
+  for (int gid = 0; gid < num_group; gid++) {
+    out[gid] = d_base[global_idx * num_group + gid];
+  }
+  size_t tree_idx = 0;
+  for (size_t stage = 0; stage < num_stages; stage++) {
+    float* stage_out = out + stage * num_group;
+    if (stage != 0) {
+      for (int gid = 0; gid < num_group; gid++) {
+        stage_out[gid] = stage_out[gid - num_group];
+      }
+    }
+    for (; tree_idx < d_stage_ends[stage]; tree_idx++) {
+      const DevicePredictionNode* d_tree = d_nodes + d_tree_segments[tree_idx];
+      stage_out[d_tree_group[tree_idx]] += GetLeafWeight(global_idx, d_tree, &loader);
+    }
+  }
+}
+
 class GPUPredictor : public xgboost::Predictor {
  protected:
   struct DevicePredictionCacheEntry {
@@ -259,14 +355,8 @@ class GPUPredictor : public xgboost::Predictor {
   };
 
  private:
-  void DevicePredictInternal(DMatrix* dmat,
-                             HostDeviceVector<bst_float>* out_preds,
-                             const gbm::GBTreeModel& model, size_t tree_begin,
-                             size_t tree_end) {
-    if (tree_end - tree_begin == 0) {
-      return;
-    }
-
+  // the rows of dmat on the device, kept while dmat is in the prediction cache
+  std::shared_ptr<DeviceMatrix> GetDeviceMatrix(DMatrix* dmat) {
     std::shared_ptr<DeviceMatrix> device_matrix;
     // Matrix is not in host cache, create a temporary matrix
     if (this->cache_.find(dmat) == this->cache_.end()) {
@@ -282,25 +372,16 @@ class GPUPredictor : public xgboost::Predictor {
       }
       device_matrix = device_matrix_cache_.find(dmat)->second;
     }
+    return device_matrix;
+  }
 
-    dh::safe_cuda(cudaSetDevice(param.gpu_id));
+  // copy trees [tree_begin, tree_end) and the groups of all the trees to the device
+  void CopyTrees(const gbm::GBTreeModel& model, size_t tree_begin, size_t tree_end,
+                 thrust::host_vector<size_t>* p_tree_segments) {
+    thrust::host_vector<size_t>& h_tree_segments = *p_tree_segments;
     CHECK_EQ(model.param.size_leaf_vector, 0);
-    // Copy decision trees to device
-    thrust::host_vector<size_t> h_tree_segments;
-    h_tree_segments.reserve((tree_end - tree_begin) + 1);
-    size_t sum = 0;
-    h_tree_segments.push_back(sum);
-    for (auto tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
-      sum += model.trees[tree_idx]->GetNodes().size();
-      h_tree_segments.push_back(sum);
-    }
-
-    thrust::host_vector<DevicePredictionNode> h_nodes(h_tree_segments.back());
-    for (auto tree_idx = tree_begin; tree_idx < tree_end; tree_idx++) {
-      auto& src_nodes = model.trees[tree_idx]->GetNodes();
-      std::copy(src_nodes.begin(), src_nodes.end(),
-                h_nodes.begin() + h_tree_segments[tree_idx - tree_begin]);
-    }
+    thrust::host_vector<DevicePredictionNode> h_nodes;
+    FlattenTrees(model, tree_begin, tree_end, &h_tree_segments, &h_nodes);
 
     nodes.resize(h_nodes.size());
     dh::safe_cuda(cudaMemcpy(dh::Raw(nodes), h_nodes.data(),
@@ -314,6 +395,112 @@ class GPUPredictor : public xgboost::Predictor {
     dh::safe_cuda(cudaMemcpy(dh::Raw(tree_group), model.tree_info.data(),
                              sizeof(int) * model.tree_info.size(),
                              cudaMemcpyHostToDevice));
+  }
+
+  // the SHAP values, or the interactions, of the rows of dmat from the trees
+  // [0, ntree_limit rounds) evaluated by (row, path) pairs, false when the
+  // model has several roots or paths too long for the kernel
+  bool DevicePredictShap(DMatrix* dmat, std::vector<bst_float>* out_contribs,
+                         const gbm::GBTreeModel& model, unsigned ntree_limit,
+                         bool interactions, int condition, unsigned condition_feature) {
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "feature contributions do not support trees of vector leaves";
+    const MetaInfo& info = dmat->Info();
+    if (info.root_index_.size() != 0) return false;
+    const int ngroup = model.param.num_output_group;
+    size_t tree_end = static_cast<size_t>(ntree_limit) * ngroup;
+    if (tree_end == 0 || tree_end > model.trees.size()) tree_end = model.trees.size();
+    for (size_t i = 0; i < tree_end; ++i) {
+      if (model.trees[i]->param.num_roots != 1) return false;
+    }
+    ShapPaths paths;
+    ExtractShapPaths(model, 0, tree_end, &paths);
+    if (paths.max_length > static_cast<size_t>(kMaxShapPathLength)) return false;
+
+    const size_t ncolumns = model.param.num_feature + 1;
+    const size_t row_size = interactions ? ncolumns * ncolumns : ncolumns;
+    const size_t num_rows = info.num_row_;
+    std::vector<bst_float>& contribs = *out_contribs;
+    contribs.assign(num_rows * ngroup * row_size, 0.0f);
+    if (num_rows != 0 && paths.Size() != 0) {
+      std::shared_ptr<DeviceMatrix> device_matrix = this->GetDeviceMatrix(dmat);
+      dh::safe_cuda(cudaSetDevice(param.gpu_id));
+      thrust::device_vector<ShapPathElement> d_elements(paths.elements.begin(),
+                                                        paths.elements.end());
+      thrust::device_vector<size_t> d_path_ptr(paths.path_ptr.begin(), paths.path_ptr.end());
+      thrust::device_vector<float> d_leaf_value(paths.leaf_value.begin(),
+                                                paths.leaf_value.end());
+      thrust::device_vector<int> d_group(paths.group.begin(), paths.group.end());
+      thrust::device_vector<float> d_contribs(contribs.size(), 0.0f);
+      const ShapPathElement* p_elements = dh::Raw(d_elements);
+      const size_t* p_path_ptr = dh::Raw(d_path_ptr);
+      const float* p_leaf_value = dh::Raw(d_leaf_value);
+      const int* p_group = dh::Raw(d_group);
+      float* p_contribs = dh::Raw(d_contribs);
+      size_t* p_row_ptr = device_matrix->row_ptr.Data();
+      Entry* p_data = device_matrix->data.Data();
+      const int num_feature = model.param.num_feature;
+      const int fixed = static_cast<int>(condition_feature);
+      // the lanes of a warp take consecutive rows of the same path
+      dh::LaunchN(param.gpu_id, paths.Size() * num_rows, [=] __device__(size_t idx) {
+        const size_t path = idx / num_rows;
+        const size_t ridx = idx % num_rows;
+        ElementLoader loader(false, p_row_ptr, p_data, num_feature, nullptr,
+                             static_cast<int>(num_rows));
+        const ShapPathElement* elements = p_elements + p_path_ptr[path];
+        const int n = static_cast<int>(p_path_ptr[path + 1] - p_path_ptr[path]);
+        float fvalue[kMaxShapPathLength];
+        bool missing[kMaxShapPathLength];
+        for (int i = 0; i < n; ++i) {
+          const int fidx = elements[i].feature_idx;
+          fvalue[i] = fidx < 0 ? 0.0f : loader.GetFvalue(static_cast<int>(ridx), fidx);
+          missing[i] = fidx >= 0 && isnan(fvalue[i]);
+        }
+        float* row = p_contribs + (ridx * ngroup + p_group[path]) * row_size;
+        const size_t bias = ncolumns - 1;
+        if (interactions) {
+          ShapPathInteractions(elements, fvalue, missing, n, p_leaf_value[path],
+                               [=](int i, int j, float v) {
+                                 const size_t ci = i < 0 ? bias : i;
+                                 const size_t cj = j < 0 ? bias : j;
+                                 atomicAdd(row + ci * ncolumns + cj, v);
+                               });
+        } else {
+          ShapPathContributions(elements, fvalue, missing, n, p_leaf_value[path],
+                                condition, fixed, [=](int f, float v) {
+                                  atomicAdd(row + (f < 0 ? bias : f), v);
+                                });
+        }
+      });
+      dh::safe_cuda(cudaDeviceSynchronize());
+      thrust::copy(d_contribs.begin(), d_contribs.end(), contribs.begin());
+    }
+    // add base margin to BIAS
+    const std::vector<bst_float>& base_margin = info.base_margin_;
+    for (size_t ridx = 0; ridx < num_rows; ++ridx) {
+      for (int gid = 0; gid < ngroup; ++gid) {
+        bst_float* p_row = &contribs[(ridx * ngroup + gid) * row_size];
+        p_row[row_size - 1] += base_margin.size() != 0 ?
+            base_margin[ridx * ngroup + gid] : model.base_margin;
+      }
+    }
+    return true;
+  }
+
+  void DevicePredictInternal(DMatrix* dmat,
+                             HostDeviceVector<bst_float>* out_preds,
+                             const gbm::GBTreeModel& model, size_t tree_begin,
+                             size_t tree_end) {
+    if (tree_end - tree_begin == 0) {
+      return;
+    }
+
+    std::shared_ptr<DeviceMatrix> device_matrix = this->GetDeviceMatrix(dmat);
+
+    dh::safe_cuda(cudaSetDevice(param.gpu_id));
+    // Copy decision trees to device
+    thrust::host_vector<size_t> h_tree_segments;
+    this->CopyTrees(model, tree_begin, tree_end, &h_tree_segments);
 
     device_matrix->predictions.resize(out_preds->Size());
     auto& predictions = device_matrix->predictions;
@@ -323,6 +510,61 @@ class GPUPredictor : public xgboost::Predictor {
     dh::safe_cuda(cudaSetDevice(param.gpu_id));
 
     const int BLOCK_THREADS = 128;
+    const MetaInfo& info = device_matrix->p_mat->Info();
+    const size_t num_rows = info.num_row_;
+    if (num_rows == 0) return;
+    // The trees are staged in tiles in shared memory when the largest of them,
+    // whose size is bounded by the depth of the model, fits in it. A quarter of
+    // the shared memory is the goal of a tile, so that several blocks stay
+    // resident on a multiprocessor. The rows are read from a dense copy, which
+    // is only built when it is not much larger than the sparse rows.
+    const size_t dense_cols = std::max(static_cast<size_t>(info.num_col_),
+                                       static_cast<size_t>(model.param.num_feature));
+    size_t max_tree_nodes = 0;
+    for (size_t i = 0; i + 1 < h_tree_segments.size(); i++) {
+      max_tree_nodes = std::max(max_tree_nodes,
+                                h_tree_segments[i + 1] - h_tree_segments[i]);
+    }
+    const size_t max_tile_nodes =
+        max_shared_memory_bytes / sizeof(DevicePredictionNode);
+    if (dense_cols != 0 && max_tree_nodes <= max_tile_nodes &&
+        info.num_nonzero_ * 4 >= num_rows * dense_cols) {
+      const size_t tile_nodes = std::max(max_tree_nodes, max_tile_nodes / 4);
+      thrust::host_vector<size_t> h_tile_segments;
+      h_tile_segments.push_back(0);
+      size_t max_nodes_in_tile = 0;
+      for (size_t i = 1; i < h_tree_segments.size(); i++) {
+        size_t nodes_in_tile = h_tree_segments[i] - h_tree_segments[h_tile_segments.back()];
+        if (nodes_in_tile > tile_nodes) {
+          h_tile_segments.push_back(i - 1);
+          nodes_in_tile = h_tree_segments[i] - h_tree_segments[i - 1];
+        }
+        max_nodes_in_tile = std::max(max_nodes_in_tile, nodes_in_tile);
+      }
+      h_tile_segments.push_back(h_tree_segments.size() - 1);
+      tile_segments.resize(h_tile_segments.size());
+      dh::safe_cuda(cudaMemcpy(dh::Raw(tile_segments), h_tile_segments.data(),
+                               sizeof(size_t) * h_tile_segments.size(),
+                               cudaMemcpyHostToDevice));
+      InitDense(device_matrix.get(), dense_cols);
+
+      const int GRID_SIZE =
+          static_cast<int>(dh::DivRoundUp(num_rows, BLOCK_THREADS));
+      PredictTiledKernel<BLOCK_THREADS>
+          <<<GRID_SIZE, BLOCK_THREADS,
+             sizeof(DevicePredictionNode) * max_nodes_in_tile>>>(
+              dh::Raw(nodes), dh::Raw(device_matrix->predictions),
+              dh::Raw(tree_segments), dh::Raw(tree_group),
+              dh::Raw(tile_segments), h_tile_segments.size() - 1,
+              dh::Raw(device_matrix->dense), tree_begin, num_rows,
+              model.param.num_output_group);
+
+      dh::safe_cuda(cudaDeviceSynchronize());
+      out_preds->ScatterFrom(predictions.data(),
+                             predictions.data() + predictions.size());
+      return;
+    }
+
     const int GRID_SIZE = static_cast<int>(
         dh::DivRoundUp(device_matrix->row_ptr.Size() - 1, BLOCK_THREADS));
 
@@ -368,6 +610,46 @@ class GPUPredictor : public xgboost::Predictor {
     DevicePredictInternal(dmat, out_preds, model, tree_begin, tree_end);
   }
 
+  void PredictStaged(DMatrix* dmat, std::vector<bst_float>* out_margins,
+                     const gbm::GBTreeModel& model, unsigned stride,
+                     unsigned ntree_limit) override {
+    const std::vector<unsigned> stage_ends = StageEnds(model, stride, ntree_limit);
+    const MetaInfo& info = dmat->Info();
+    const int num_group = model.param.num_output_group;
+    const size_t num_rows = info.num_row_;
+    out_margins->resize(num_rows * stage_ends.size() * num_group);
+    if (num_rows == 0 || stage_ends.empty()) return;
+    HostDeviceVector<bst_float> base;
+    this->InitOutPredictions(info, &base, model);
+
+    std::shared_ptr<DeviceMatrix> device_matrix = this->GetDeviceMatrix(dmat);
+    dh::safe_cuda(cudaSetDevice(param.gpu_id));
+    thrust::host_vector<size_t> h_tree_segments;
+    this->CopyTrees(model, 0, stage_ends.back(), &h_tree_segments);
+    thrust::device_vector<unsigned> d_stage_ends(stage_ends.begin(), stage_ends.end());
+    device_matrix->predictions.resize(base.Size());
+    base.GatherTo(device_matrix->predictions.data(),
+                  device_matrix->predictions.data() + device_matrix->predictions.size());
+    thrust::device_vector<bst_float> d_out_margins(out_margins->size());
+
+    const int BLOCK_THREADS = 128;
+    const int GRID_SIZE = static_cast<int>(dh::DivRoundUp(num_rows, BLOCK_THREADS));
+    int shared_memory_bytes = static_cast<int>(sizeof(float) * info.num_col_ * BLOCK_THREADS);
+    bool use_shared = true;
+    if (shared_memory_bytes > max_shared_memory_bytes) {
+      shared_memory_bytes = 0;
+      use_shared = false;
+    }
+    PredictStagedKernel<BLOCK_THREADS>
+        <<<GRID_SIZE, BLOCK_THREADS, shared_memory_bytes>>>(
+            dh::Raw(nodes), dh::Raw(device_matrix->predictions),
+            dh::Raw(d_out_margins), dh::Raw(tree_segments), dh::Raw(tree_group),
+            dh::Raw(d_stage_ends), stage_ends.size(), device_matrix->row_ptr.Data(),
+            device_matrix->data.Data(), info.num_col_, num_rows, use_shared, num_group);
+    dh::safe_cuda(cudaDeviceSynchronize());
+    thrust::copy(d_out_margins.begin(), d_out_margins.end(), out_margins->begin());
+  }
+
  protected:
   void InitOutPredictions(const MetaInfo& info,
                           HostDeviceVector<bst_float>* out_preds,
@@ -391,7 +673,8 @@ class GPUPredictor : public xgboost::Predictor {
       auto it = cache_.find(dmat);
       if (it != cache_.end()) {
         HostDeviceVector<bst_float>& y = it->second.predictions;
-        if (y.Size() != 0) {
+        // rows appended to the matrix are not in the cache yet
+        if (y.Size() != 0 && y.Size() == model.param.num_output_group * dmat->Info().num_row_) {
           out_preds->Reshard(devices);
           out_preds->Resize(y.Size());
           out_preds->Copy(&y);
@@ -416,6 +699,11 @@ class GPUPredictor : public xgboost::Predictor {
 
       if (predictions.Size() == 0) {
         this->InitOutPredictions(dmat->Info(), &predictions, model);
+      } else if (predictions.Size() != model.param.num_output_group * dmat->Info().num_row_) {
+        // rows were appended to the matrix, predict all of them again
+        this->InitOutPredictions(dmat->Info(), &predictions, model);
+        DevicePredictInternal(dmat, &predictions, model, 0, model.trees.size());
+        continue;
       }
 
       if (model.param.num_output_group == 1 && updaters->size() > 0 &&
@@ -440,14 +728,23 @@ class GPUPredictor : public xgboost::Predictor {
     cpu_predictor->PredictLeaf(p_fmat, out_preds, model, ntree_limit);
   }
 
+  void PredictLeafCodes(DMatrix* p_fmat, const gbm::GBTreeModel& model,
+                        const gbm::LeafCodes& codes, void* out) override {
+    cpu_predictor->PredictLeafCodes(p_fmat, model, codes, out);
+  }
+
   void PredictContribution(DMatrix* p_fmat,
                            std::vector<bst_float>* out_contribs,
                            const gbm::GBTreeModel& model, unsigned ntree_limit,
                            bool approximate, int condition,
                            unsigned condition_feature) override {
-    cpu_predictor->PredictContribution(p_fmat, out_contribs, model, ntree_limit,
-                                       approximate, condition,
-                                       condition_feature);
+    // the approximation walks one path per tree, it stays on the CPU
+    if (approximate || !this->DevicePredictShap(p_fmat, out_contribs, model, ntree_limit,
+                                                false, condition, condition_feature)) {
+      cpu_predictor->PredictContribution(p_fmat, out_contribs, model, ntree_limit,
+                                         approximate, condition,
+                                         condition_feature);
+    }
   }
 
   void PredictInteractionContributions(DMatrix* p_fmat,
@@ -455,8 +752,11 @@ class GPUPredictor : public xgboost::Predictor {
                                        const gbm::GBTreeModel& model,
                                        unsigned ntree_limit,
                                        bool approximate) override {
-    cpu_predictor->PredictInteractionContributions(p_fmat, out_contribs, model,
-                                                   ntree_limit, approximate);
+    if (approximate ||
+        !this->DevicePredictShap(p_fmat, out_contribs, model, ntree_limit, true, 0, 0)) {
+      cpu_predictor->PredictInteractionContributions(p_fmat, out_contribs, model,
+                                                     ntree_limit, approximate);
+    }
   }
 
   void Init(const std::vector<std::pair<std::string, std::string>>& cfg,
@@ -475,6 +775,7 @@ class GPUPredictor : public xgboost::Predictor {
       device_matrix_cache_;
   thrust::device_vector<DevicePredictionNode> nodes;
   thrust::device_vector<size_t> tree_segments;
+  thrust::device_vector<size_t> tile_segments;
   thrust::device_vector<int> tree_group;
   thrust::device_vector<bst_float> preds;
   GPUSet devices;
@@ -0,0 +1,232 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file model_registry.h
+ * \brief models served by id from one store of packed trees.
+ *
+ *  Variants of a model, e.g. robust models of several eps and the natural
+ *  one, often share trees: the first rounds agree, or a model is the prefix
+ *  of another. The registry keeps the trees of all its models in a single
+ *  PackedForest and stores identical trees once, so a model only costs its
+ *  tree indices, its group of each tree and its objective. No Learner is kept
+ *  once a model is loaded.
+ *
+ *  Loading a model is not thread safe. Predictions only read the registry
+ *  and keep their feature vector per thread, so any number of threads can
+ *  predict from it at once between loads.
+ */
+#ifndef XGBOOST_PREDICTOR_MODEL_REGISTRY_H_
+#define XGBOOST_PREDICTOR_MODEL_REGISTRY_H_
+
+#include <dmlc/io.h>
+#include <dmlc/thread_local.h>
+#include <xgboost/base.h>
+#include <xgboost/gbm.h>
+#include <xgboost/learner.h>
+#include <xgboost/objective.h>
+#include <xgboost/tree_model.h>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "../common/host_device_vector.h"
+#include "../common/threading.h"
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace predictor {
+
+class ModelRegistry {
+ public:
+  /*! \brief a model of the registry, its trees are in the store */
+  struct Model {
+    /*! \brief index of each tree of the model in the store */
+    std::vector<uint32_t> tree;
+    /*! \brief output group of each tree */
+    std::vector<int> tree_info;
+    bst_float base_margin{0.0f};
+    int num_feature{0};
+    int num_output_group{1};
+    /*! \brief threads of the transform of the predictions, see common::OmpThreadScope */
+    int nthread{0};
+    std::unique_ptr<ObjFunction> obj;
+    /*! \brief transform margins into predictions in place */
+    inline void PredTransform(HostDeviceVector<bst_float>* io_preds) const {
+      common::OmpThreadScope threads(nthread);
+      obj->PredTransform(io_preds);
+    }
+  };
+  /*!
+   * \brief load a model saved by Learner::Save as model_id, replacing the
+   *  model of that id. The trees of a replaced model stay in the store.
+   * \param nthread threads of the transform of its predictions, 0 for those
+   *  of the caller
+   */
+  inline void Load(const std::string& model_id, dmlc::Stream* fi, int nthread = 0) {
+    std::unique_ptr<Learner> learner(Learner::Create({}));
+    learner->Load(fi);
+    const gbm::GBTreeModel* gbtree = learner->GetGradientBooster()->GetTreeModel();
+    CHECK(gbtree != nullptr) << "the model registry only supports booster=gbtree";
+    CHECK_EQ(gbtree->param.size_leaf_vector, 0)
+        << "size_leaf_vector is enforced to 0 so far";
+    const gbm::PackedForest& forest = gbtree->GetPackedForest();
+    CHECK(forest.single_root) << "the model registry only supports trees of one root";
+    Model model;
+    model.tree_info = gbtree->tree_info;
+    model.base_margin = gbtree->base_margin;
+    model.num_feature = gbtree->param.num_feature;
+    model.num_output_group = gbtree->param.num_output_group;
+    model.nthread = nthread;
+    for (size_t t = 0; t < gbtree->trees.size(); ++t) {
+      model.tree.push_back(this->Intern(forest, t));
+    }
+    model.obj = learner->ReleaseObjective();
+    num_feature_ = std::max(num_feature_, model.num_feature);
+    models_[model_id] = std::move(model);
+  }
+  /*! \return the model of model_id */
+  inline const Model& Get(const std::string& model_id) const {
+    auto it = models_.find(model_id);
+    CHECK(it != models_.end()) << "no model " << model_id << " in the registry";
+    return it->second;
+  }
+  /*! \return number of models */
+  inline size_t NumModel() const {
+    return models_.size();
+  }
+  /*! \return number of trees of all models, counted once per model */
+  inline size_t NumTreeRef() const {
+    size_t n = 0;
+    for (const auto& kv : models_) n += kv.second.tree.size();
+    return n;
+  }
+  /*! \return number of distinct trees in the store */
+  inline size_t NumTreeStored() const {
+    return store_.tree_root.size();
+  }
+  /*! \brief the margins of the rows of a dense row major buffer, see Predictor */
+  inline void PredictFromDense(const Model& model, const bst_float* data, size_t nrow,
+                               size_t ncol, bst_float missing, unsigned ntree_limit,
+                               bst_float* out_margin) const {
+    RegTree::FVec& feats = ThreadFeatures();
+    const unsigned tree_end = TreeEnd(model, ntree_limit);
+    const int num_group = model.num_output_group;
+    std::fill(out_margin, out_margin + nrow * num_group, model.base_margin);
+    for (size_t i = 0; i < nrow; ++i) {
+      feats.FillDense(data + i * ncol, ncol, missing);
+      PredRow(model, feats, tree_end, out_margin + i * num_group);
+    }
+    // mark all the features missing again
+    feats.Init(num_feature_);
+  }
+  /*! \brief the margins of the rows of CSR buffers, see Predictor */
+  inline void PredictFromCSR(const Model& model, const size_t* indptr,
+                             const bst_uint* indices, const bst_float* data, size_t nrow,
+                             unsigned ntree_limit, bst_float* out_margin) const {
+    RegTree::FVec& feats = ThreadFeatures();
+    const unsigned tree_end = TreeEnd(model, ntree_limit);
+    const int num_group = model.num_output_group;
+    std::fill(out_margin, out_margin + nrow * num_group, model.base_margin);
+    for (size_t i = 0; i < nrow; ++i) {
+      const size_t begin = indptr[i], length = indptr[i + 1] - indptr[i];
+      feats.Fill(indices + begin, data + begin, length);
+      PredRow(model, feats, tree_end, out_margin + i * num_group);
+      feats.Drop(indices + begin, length);
+    }
+  }
+
+ private:
+  // feature vector of the calling thread, all missing between calls
+  struct ThreadEntry {
+    RegTree::FVec feats;
+  };
+  inline RegTree::FVec& ThreadFeatures() const {
+    RegTree::FVec& feats = dmlc::ThreadLocalStore<ThreadEntry>::Get()->feats;
+    if (feats.Size() != static_cast<size_t>(num_feature_)) feats.Init(num_feature_);
+    return feats;
+  }
+  inline static unsigned TreeEnd(const Model& model, unsigned ntree_limit) {
+    ntree_limit *= model.num_output_group;
+    if (ntree_limit == 0 || ntree_limit > model.tree.size()) {
+      ntree_limit = static_cast<unsigned>(model.tree.size());
+    }
+    return ntree_limit;
+  }
+  inline void PredRow(const Model& model, const RegTree::FVec& feats, unsigned tree_end,
+                      bst_float* out) const {
+    for (unsigned t = 0; t < tree_end; ++t) {
+      out[model.tree_info[t]] += store_.Predict(model.tree[t], feats);
+    }
+  }
+  template <typename T>
+  inline static void AppendBytes(std::string* key, T value) {
+    key->append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  // the nodes of tree t in breadth first order, equal for identical trees
+  inline static std::string TreeKey(const gbm::PackedForest& forest, size_t t) {
+    std::string key;
+    std::vector<int> queue(1, forest.tree_root[t]);
+    for (size_t i = 0; i < queue.size(); ++i) {
+      const int ref = queue[i];
+      if (ref < 0) {
+        AppendBytes(&key, 'l');
+        AppendBytes(&key, forest.leaf_value[~ref]);
+        continue;
+      }
+      AppendBytes(&key, 's');
+      AppendBytes(&key, forest.split_index[ref]);
+      AppendBytes(&key, forest.split_cond[ref]);
+      queue.push_back(forest.children[2 * ref]);
+      queue.push_back(forest.children[2 * ref + 1]);
+    }
+    return key;
+  }
+  // index of tree t of forest in the store, copied there unless it is already
+  inline uint32_t Intern(const gbm::PackedForest& forest, size_t t) {
+    const std::string key = TreeKey(forest, t);
+    const size_t hash = std::hash<std::string>()(key);
+    auto range = index_.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (TreeKey(store_, it->second) == key) return it->second;
+    }
+    const auto id = static_cast<uint32_t>(store_.tree_root.size());
+    // the split nodes in breadth first order, as PackedForest packs a tree
+    const int base = static_cast<int>(store_.split_cond.size());
+    std::vector<int> order;
+    auto reference = [&](int ref) {
+      if (ref < 0) {
+        store_.leaf_value.push_back(forest.leaf_value[~ref]);
+        return ~static_cast<int>(store_.leaf_value.size() - 1);
+      }
+      order.push_back(ref);
+      return base + static_cast<int>(order.size() - 1);
+    };
+    store_.tree_root.push_back(reference(forest.tree_root[t]));
+    for (size_t i = 0; i < order.size(); ++i) {
+      const int ref = order[i];
+      store_.split_index.push_back(forest.split_index[ref]);
+      store_.split_cond.push_back(forest.split_cond[ref]);
+      const int left = reference(forest.children[2 * ref]);
+      const int right = reference(forest.children[2 * ref + 1]);
+      store_.children.push_back(left);
+      store_.children.push_back(right);
+    }
+    index_.emplace(hash, id);
+    return id;
+  }
+
+  // the trees of all models, only appended to; its source is not kept
+  gbm::PackedForest store_;
+  // the store trees by the hash of their TreeKey
+  std::unordered_multimap<size_t, uint32_t> index_;
+  std::map<std::string, Model> models_;
+  // largest num_feature of the models, the size of the feature vectors
+  int num_feature_{0};
+};
+
+}  // namespace predictor
+}  // namespace xgboost
+#endif  // XGBOOST_PREDICTOR_MODEL_REGISTRY_H_
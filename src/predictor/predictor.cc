@@ -3,6 +3,8 @@
  */
 #include <dmlc/registry.h>
 #include <xgboost/predictor.h>
+#include <algorithm>
+#include <vector>
 
 namespace dmlc {
 DMLC_REGISTRY_ENABLE(::xgboost::PredictorReg);
@@ -15,6 +17,53 @@ void Predictor::Init(
     cache_[d.get()].data = d;
   }
 }
+bool Predictor::SetCachedPredictions(DMatrix* dmat, const std::vector<bst_float>& preds) {
+  auto it = cache_.find(dmat);
+  if (it == cache_.end()) return false;
+  HostDeviceVector<bst_float>& y = it->second.predictions;
+  y.Resize(preds.size());
+  std::copy(preds.begin(), preds.end(), y.HostVector().begin());
+  return true;
+}
+void Predictor::PredictFromDense(const bst_float* data, size_t nrow, size_t ncol,
+                                 bst_float missing, const gbm::GBTreeModel& model,
+                                 unsigned ntree_limit, bst_float* out_margin) {
+  LOG(FATAL) << "prediction from buffers is not supported by this predictor";
+}
+void Predictor::PredictFromCSR(const size_t* indptr, const bst_uint* indices,
+                               const bst_float* data, size_t nrow,
+                               const gbm::GBTreeModel& model,
+                               unsigned ntree_limit, bst_float* out_margin) {
+  LOG(FATAL) << "prediction from buffers is not supported by this predictor";
+}
+void Predictor::PredictLeafCodes(DMatrix* dmat, const gbm::GBTreeModel& model,
+                                 const gbm::LeafCodes& codes, void* out) {
+  LOG(FATAL) << "leaf codes are not supported by this predictor";
+}
+void Predictor::PredictStaged(DMatrix* dmat, std::vector<bst_float>* out_margins,
+                              const gbm::GBTreeModel& model, unsigned stride,
+                              unsigned ntree_limit) {
+  LOG(FATAL) << "staged prediction is not supported by this predictor";
+}
+std::vector<unsigned> Predictor::StageEnds(const gbm::GBTreeModel& model, unsigned stride,
+                                           unsigned ntree_limit) {
+  CHECK_GE(stride, 1U) << "the stride of staged prediction must be at least 1";
+  const unsigned per_round = model.TreesPerRound();
+  const auto num_trees = static_cast<unsigned>(model.trees.size());
+  unsigned tree_end = ntree_limit * per_round;
+  if (ntree_limit == 0 || tree_end > num_trees) tree_end = num_trees;
+  std::vector<unsigned> ends;
+  const size_t step = static_cast<size_t>(stride) * per_round;
+  for (size_t end = step; end < tree_end; end += step) {
+    ends.push_back(static_cast<unsigned>(end));
+  }
+  if (tree_end != 0) ends.push_back(tree_end);
+  return ends;
+}
+unsigned Predictor::NumStages(const gbm::GBTreeModel& model, unsigned stride,
+                              unsigned ntree_limit) {
+  return static_cast<unsigned>(StageEnds(model, stride, ntree_limit).size());
+}
 Predictor* Predictor::Create(std::string name) {
   auto* e = ::dmlc::Registry<PredictorReg>::Get()->Find(name);
   if (e == nullptr) {
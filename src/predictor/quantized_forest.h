@@ -0,0 +1,252 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file quantized_forest.h
+ * \brief compact encoding of a tree ensemble with bin index traversal.
+ *
+ *  The thresholds of each feature are kept once, sorted, in a dictionary and
+ *  a split node refers to its threshold by its index there. A node is 8
+ *  bytes: the split feature with the default direction in its high bit, the
+ *  threshold index and the index of its left child, the right child is next
+ *  to it. A leaf keeps its value as a float16 in place of the threshold.
+ *
+ *  A row is binned once: a value falls in bin b when b thresholds of its
+ *  feature are at most the value. It goes left at threshold i iff b <= i, so
+ *  the traversal compares integers. The dictionaries are kept in float, the
+ *  decisions are those of the model; only the leaf values are rounded.
+ */
+#ifndef XGBOOST_PREDICTOR_QUANTIZED_FOREST_H_
+#define XGBOOST_PREDICTOR_QUANTIZED_FOREST_H_
+
+#include <dmlc/io.h>
+#include <dmlc/logging.h>
+#include <dmlc/thread_local.h>
+#include <xgboost/base.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace predictor {
+
+/*! \brief round a float to the nearest float16, ties to even */
+inline uint16_t FloatToHalf(float value) {
+  uint32_t x;
+  std::memcpy(&x, &value, sizeof(x));
+  const auto sign = static_cast<uint16_t>((x >> 16) & 0x8000U);
+  if ((x & 0x7FFFFFFFU) > 0x7F800000U) return sign | 0x7E00U;  // NaN
+  const int exp = static_cast<int>((x >> 23) & 0xFFU) - 127 + 15;
+  uint32_t mant = x & 0x7FFFFFU;
+  if (exp >= 31) return sign | 0x7C00U;  // overflow to infinity
+  if (exp <= 0) {
+    // subnormal half, the implicit bit is shifted in
+    if (exp < -10) return sign;
+    mant |= 0x800000U;
+    const int shift = 14 - exp;
+    uint32_t half = mant >> shift;
+    const uint32_t rem = mant & ((1U << shift) - 1U), halfway = 1U << (shift - 1);
+    if (rem > halfway || (rem == halfway && (half & 1U) != 0)) ++half;
+    return static_cast<uint16_t>(sign | half);
+  }
+  uint32_t half = (static_cast<uint32_t>(exp) << 10) | (mant >> 13);
+  const uint32_t rem = mant & 0x1FFFU;
+  // a carry out of the mantissa rounds up the exponent, as it should
+  if (rem > 0x1000U || (rem == 0x1000U && (half & 1U) != 0)) ++half;
+  return static_cast<uint16_t>(sign | half);
+}
+
+/*! \brief the float of a float16 */
+inline float HalfToFloat(uint16_t half) {
+  const uint32_t sign = static_cast<uint32_t>(half & 0x8000U) << 16;
+  uint32_t exp = (half >> 10) & 0x1FU;
+  uint32_t mant = half & 0x3FFU;
+  uint32_t x;
+  if (exp == 0) {
+    if (mant == 0) {
+      x = sign;
+    } else {
+      // normalise the subnormal
+      exp = 127 - 15 + 1;
+      while ((mant & 0x400U) == 0) {
+        mant <<= 1;
+        --exp;
+      }
+      x = sign | (exp << 23) | ((mant & 0x3FFU) << 13);
+    }
+  } else if (exp == 31) {
+    x = sign | 0x7F800000U | (mant << 13);
+  } else {
+    x = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+  }
+  float value;
+  std::memcpy(&value, &x, sizeof(value));
+  return value;
+}
+
+class QuantizedForest {
+ public:
+  /*! \brief a split node or a leaf */
+  struct Node {
+    /*! \brief split feature, default left in the high bit, kLeaf for a leaf */
+    uint16_t split;
+    /*! \brief index of the threshold in the dictionary, float16 leaf value of a leaf */
+    uint16_t threshold;
+    /*! \brief index of the left child, the right child is left + 1 */
+    uint32_t left;
+  };
+  static constexpr uint16_t kLeaf = 0x7FFFU;
+  static constexpr uint16_t kDefaultLeft = 0x8000U;
+
+  /*! \brief encode the trees of a model, all trees must have a single root */
+  inline void Build(const gbm::GBTreeModel& model) {
+    CHECK_EQ(model.param.size_leaf_vector, 0) << "size_leaf_vector is enforced to 0 so far";
+    const gbm::PackedForest& forest = model.GetPackedForest();
+    CHECK(forest.single_root) << "quantized models only support trees of one root";
+    const gbm::FeatureThresholdIndex& index = model.GetThresholdIndex();
+    num_output_group_ = model.param.num_output_group;
+    base_margin_ = model.base_margin;
+    tree_info_ = model.tree_info;
+    feature_ptr_.assign(index.feature_ptr.begin(), index.feature_ptr.end());
+    thresholds_ = index.thresholds;
+    CHECK_LT(NumFeature(), static_cast<size_t>(kLeaf))
+        << "quantized models support less than 32767 features";
+    tree_root_.clear();
+    nodes_.clear();
+    std::vector<int> refs;
+    for (size_t t = 0; t < forest.tree_root.size(); ++t) {
+      // breadth first, the two children of a node are allocated together
+      const size_t begin = nodes_.size();
+      tree_root_.push_back(static_cast<uint32_t>(begin));
+      refs.assign(1, forest.tree_root[t]);
+      nodes_.emplace_back();
+      for (size_t i = begin; i < nodes_.size(); ++i) {
+        const int ref = refs[i - begin];
+        Node node;
+        if (ref < 0) {
+          node.split = kLeaf;
+          node.threshold = FloatToHalf(forest.leaf_value[~ref]);
+          node.left = 0;
+        } else {
+          const bst_uint sindex = forest.split_index[ref];
+          const bst_uint fid = sindex & ((1U << 31) - 1U);
+          const bst_float* first = dmlc::BeginPtr(thresholds_) + feature_ptr_[fid];
+          const bst_float* last = dmlc::BeginPtr(thresholds_) + feature_ptr_[fid + 1];
+          const size_t id = std::lower_bound(first, last, forest.split_cond[ref]) - first;
+          CHECK_LE(id, static_cast<size_t>(std::numeric_limits<uint16_t>::max()))
+              << "quantized models support at most 65536 thresholds of a feature";
+          node.split = static_cast<uint16_t>(fid | ((sindex >> 31) != 0 ? kDefaultLeft : 0U));
+          node.threshold = static_cast<uint16_t>(id);
+          node.left = static_cast<uint32_t>(nodes_.size());
+          nodes_.emplace_back();
+          nodes_.emplace_back();
+          refs.push_back(forest.children[2 * ref]);
+          refs.push_back(forest.children[2 * ref + 1]);
+        }
+        nodes_[i] = node;
+      }
+    }
+  }
+  inline void Save(dmlc::Stream* fo) const {
+    const uint32_t magic = kMagic;
+    fo->Write(&magic, sizeof(magic));
+    fo->Write(&num_output_group_, sizeof(num_output_group_));
+    fo->Write(&base_margin_, sizeof(base_margin_));
+    fo->Write(tree_info_);
+    fo->Write(feature_ptr_);
+    fo->Write(thresholds_);
+    fo->Write(tree_root_);
+    const uint64_t nnode = nodes_.size();
+    fo->Write(&nnode, sizeof(nnode));
+    if (nnode != 0) fo->Write(dmlc::BeginPtr(nodes_), sizeof(Node) * nnode);
+  }
+  inline void Load(dmlc::Stream* fi) {
+    uint32_t magic;
+    CHECK(fi->Read(&magic, sizeof(magic)) == sizeof(magic) && magic == kMagic)
+        << "invalid quantized model";
+    CHECK_EQ(fi->Read(&num_output_group_, sizeof(num_output_group_)),
+             sizeof(num_output_group_));
+    CHECK_EQ(fi->Read(&base_margin_, sizeof(base_margin_)), sizeof(base_margin_));
+    CHECK(fi->Read(&tree_info_)) << "invalid quantized model";
+    CHECK(fi->Read(&feature_ptr_)) << "invalid quantized model";
+    CHECK(fi->Read(&thresholds_)) << "invalid quantized model";
+    CHECK(fi->Read(&tree_root_)) << "invalid quantized model";
+    uint64_t nnode;
+    CHECK_EQ(fi->Read(&nnode, sizeof(nnode)), sizeof(nnode)) << "invalid quantized model";
+    nodes_.resize(nnode);
+    if (nnode != 0) {
+      CHECK_EQ(fi->Read(dmlc::BeginPtr(nodes_), sizeof(Node) * nnode), sizeof(Node) * nnode)
+          << "invalid quantized model";
+    }
+    CHECK_EQ(tree_info_.size(), tree_root_.size()) << "invalid quantized model";
+  }
+  /*! \return number of margins of a row */
+  inline int NumOutputGroup() const {
+    return num_output_group_;
+  }
+  /*! \return number of features with a threshold dictionary */
+  inline size_t NumFeature() const {
+    return feature_ptr_.size() == 0 ? 0 : feature_ptr_.size() - 1;
+  }
+  /*! \return number of nodes of all trees */
+  inline size_t NumNode() const {
+    return nodes_.size();
+  }
+  /*!
+   * \brief the margins of the rows of a dense row major buffer owned by the
+   *  caller, in the calling thread. Safe to call concurrently.
+   */
+  inline void PredictFromDense(const bst_float* data, size_t nrow, size_t ncol,
+                               bst_float missing, bst_float* out_margin) const {
+    std::vector<uint32_t>& bins = dmlc::ThreadLocalStore<ThreadEntry>::Get()->bins;
+    const size_t nfeature = NumFeature();
+    bins.resize(nfeature);
+    std::fill(out_margin, out_margin + nrow * num_output_group_, base_margin_);
+    for (size_t i = 0; i < nrow; ++i) {
+      const bst_float* row = data + i * ncol;
+      for (size_t f = 0; f < nfeature; ++f) {
+        if (f >= ncol || std::isnan(row[f]) || row[f] == missing) {
+          bins[f] = kMissingBin;
+        } else {
+          const bst_float* first = dmlc::BeginPtr(thresholds_) + feature_ptr_[f];
+          const bst_float* last = dmlc::BeginPtr(thresholds_) + feature_ptr_[f + 1];
+          bins[f] = static_cast<uint32_t>(std::upper_bound(first, last, row[f]) - first);
+        }
+      }
+      bst_float* out = out_margin + i * num_output_group_;
+      for (size_t t = 0; t < tree_root_.size(); ++t) {
+        const Node* node = dmlc::BeginPtr(nodes_) + tree_root_[t];
+        while (node->split != kLeaf) {
+          const uint32_t bin = bins[node->split & kLeaf];
+          const bool left = bin == kMissingBin ? (node->split & kDefaultLeft) != 0
+                                               : bin <= node->threshold;
+          node = dmlc::BeginPtr(nodes_) + node->left + (left ? 0 : 1);
+        }
+        out[tree_info_[t]] += HalfToFloat(node->threshold);
+      }
+    }
+  }
+
+ private:
+  static constexpr uint32_t kMagic = 0xffffab08U;
+  static constexpr uint32_t kMissingBin = std::numeric_limits<uint32_t>::max();
+  // bins of a row of the calling thread
+  struct ThreadEntry {
+    std::vector<uint32_t> bins;
+  };
+
+  int num_output_group_{1};
+  bst_float base_margin_{0.0f};
+  std::vector<int> tree_info_;
+  // thresholds of feature f are [feature_ptr_[f], feature_ptr_[f + 1])
+  std::vector<uint64_t> feature_ptr_;
+  std::vector<bst_float> thresholds_;
+  std::vector<uint32_t> tree_root_;
+  std::vector<Node> nodes_;
+};
+
+}  // namespace predictor
+}  // namespace xgboost
+#endif  // XGBOOST_PREDICTOR_QUANTIZED_FOREST_H_
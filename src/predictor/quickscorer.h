@@ -0,0 +1,189 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file quickscorer.h
+ * \brief feature major bitvector scoring of tree ensembles.
+ *
+ *  QuickScorer (Lucchese et al., SIGIR 2015) numbers the leaves of every tree
+ *  from left to right and keeps, for every split node, a mask that removes the
+ *  leaves of its left subtree. A row clears the masks of the nodes it sends
+ *  right, which are found feature by feature as a prefix of the nodes sorted by
+ *  threshold, and the exit leaf of a tree is the lowest leaf left. The cost of
+ *  a row is the number of nodes it sends right, instead of a dependent load per
+ *  level of every tree, which pays off for many shallow trees.
+ */
+#ifndef XGBOOST_PREDICTOR_QUICKSCORER_H_
+#define XGBOOST_PREDICTOR_QUICKSCORER_H_
+
+#include <xgboost/base.h>
+#include <xgboost/tree_model.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace predictor {
+
+class QuickScorerIndex {
+ public:
+  /*! \return whether the index was built from the trees of the model */
+  inline bool Matches(const gbm::GBTreeModel& model) const {
+    if (source_.size() != model.trees.size()) return false;
+    for (size_t t = 0; t < source_.size(); ++t) {
+      if (source_[t] != model.trees[t].get()) return false;
+    }
+    return true;
+  }
+  /*! \return whether every tree has a single root, required by the index */
+  inline bool SingleRoot() const {
+    return single_root_;
+  }
+  /*! \return number of 64 bit words of the leaf bitvector of a tree */
+  inline size_t NumWord() const {
+    return nword_;
+  }
+  /*! \brief build the index of all trees of the model */
+  inline void Build(const gbm::GBTreeModel& model) {
+    const std::vector<std::unique_ptr<RegTree> >& trees = model.trees;
+    std::vector<Split> splits;
+    leaf_ptr_.assign(1, 0);
+    leaf_value_.clear();
+    source_.clear();
+    single_root_ = true;
+    for (size_t t = 0; t < trees.size(); ++t) {
+      if (trees[t]->param.num_roots != 1) single_root_ = false;
+      uint32_t nleaf = 0;
+      this->Visit(*trees[t], 0, static_cast<uint32_t>(t), &nleaf, &splits);
+      leaf_ptr_.push_back(leaf_value_.size());
+      source_.push_back(trees[t].get());
+    }
+    nword_ = 1;
+    for (size_t t = 0; t + 1 < leaf_ptr_.size(); ++t) {
+      nword_ = std::max(nword_, (leaf_ptr_[t + 1] - leaf_ptr_[t] + 63) / 64);
+    }
+    std::sort(splits.begin(), splits.end(), [](const Split& a, const Split& b) {
+        if (a.fid != b.fid) return a.fid < b.fid;
+        return a.cond != b.cond ? a.cond < b.cond : a.tree < b.tree;
+      });
+    bst_uint nfeature = 0;
+    for (const Split& s : splits) nfeature = std::max(nfeature, s.fid + 1);
+    feature_ptr_.assign(nfeature + 1, 0);
+    threshold_.resize(splits.size());
+    node_tree_.resize(splits.size());
+    default_left_.resize(splits.size());
+    mask_.assign(splits.size() * nword_, ~static_cast<uint64_t>(0));
+    for (size_t i = 0; i < splits.size(); ++i) {
+      const Split& s = splits[i];
+      ++feature_ptr_[s.fid + 1];
+      threshold_[i] = s.cond;
+      node_tree_[i] = s.tree;
+      default_left_[i] = s.default_left ? 1 : 0;
+      uint64_t* mask = dmlc::BeginPtr(mask_) + i * nword_;
+      for (uint32_t leaf = s.left_begin; leaf < s.left_end; ++leaf) {
+        mask[leaf / 64] &= ~(static_cast<uint64_t>(1) << (leaf % 64));
+      }
+    }
+    for (bst_uint f = 0; f < nfeature; ++f) feature_ptr_[f + 1] += feature_ptr_[f];
+  }
+  /*!
+   * \brief add the outputs of trees [0, tree_end) for a row to out, indexed
+   *  by output group.
+   * \param bits buffer of the leaf bitvectors, tree_end * NumWord() words
+   */
+  inline void Predict(const RegTree::FVec& feat, const std::vector<int>& tree_info,
+                      unsigned tree_end, uint64_t* bits, bst_float* out) const {
+    std::fill(bits, bits + static_cast<size_t>(tree_end) * nword_,
+              ~static_cast<uint64_t>(0));
+    const size_t nfeature = feature_ptr_.size() - 1;
+    for (size_t f = 0; f < nfeature; ++f) {
+      const size_t begin = feature_ptr_[f], end = feature_ptr_[f + 1];
+      if (f >= feat.Size() || feat.IsMissing(f)) {
+        // a missing value goes right at the nodes without default left
+        for (size_t i = begin; i < end; ++i) {
+          if (!default_left_[i]) this->Apply(i, tree_end, bits);
+        }
+      } else {
+        // the nodes with threshold <= fvalue send the row right, NaN goes
+        // right at every node
+        const bst_float fvalue = feat.Fvalue(f);
+        const bool nan = std::isnan(fvalue);
+        for (size_t i = begin; i < end && (nan || threshold_[i] <= fvalue); ++i) {
+          this->Apply(i, tree_end, bits);
+        }
+      }
+    }
+    for (unsigned t = 0; t < tree_end; ++t) {
+      const uint64_t* tree_bits = bits + static_cast<size_t>(t) * nword_;
+      size_t w = 0;
+      while (tree_bits[w] == 0) ++w;
+      const size_t leaf = w * 64 + LowestBit(tree_bits[w]);
+      out[tree_info[t]] += leaf_value_[leaf_ptr_[t] + leaf];
+    }
+  }
+
+ private:
+  struct Split {
+    bst_uint fid;
+    bst_float cond;
+    uint32_t tree;
+    bool default_left;
+    /*! \brief the leaves of the left subtree */
+    uint32_t left_begin, left_end;
+  };
+  // number the leaves of the subtree of nid from *nleaf on, left to right,
+  // and record its split nodes
+  inline void Visit(const RegTree& tree, int nid, uint32_t t, uint32_t* nleaf,
+                    std::vector<Split>* splits) {
+    const RegTree::Node& node = tree[nid];
+    if (node.IsLeaf()) {
+      leaf_value_.push_back(node.LeafValue());
+      ++*nleaf;
+      return;
+    }
+    const uint32_t left_begin = *nleaf;
+    this->Visit(tree, node.LeftChild(), t, nleaf, splits);
+    splits->push_back({node.SplitIndex(), node.SplitCond(), t, node.DefaultLeft(),
+                       left_begin, *nleaf});
+    this->Visit(tree, node.RightChild(), t, nleaf, splits);
+  }
+  // remove the leaves of the left subtree of split node i
+  inline void Apply(size_t i, unsigned tree_end, uint64_t* bits) const {
+    if (node_tree_[i] >= tree_end) return;
+    uint64_t* tree_bits = bits + static_cast<size_t>(node_tree_[i]) * nword_;
+    const uint64_t* mask = dmlc::BeginPtr(mask_) + i * nword_;
+    for (size_t w = 0; w < nword_; ++w) tree_bits[w] &= mask[w];
+  }
+  static inline size_t LowestBit(uint64_t x) {
+#if defined(__GNUC__)
+    return static_cast<size_t>(__builtin_ctzll(x));
+#else
+    size_t n = 0;
+    while ((x & 1) == 0) {
+      x >>= 1;
+      ++n;
+    }
+    return n;
+#endif
+  }
+
+  /*! \brief split nodes of feature f are [feature_ptr_[f], feature_ptr_[f + 1]) */
+  std::vector<size_t> feature_ptr_;
+  /*! \brief threshold, tree and default direction of each split node */
+  std::vector<bst_float> threshold_;
+  std::vector<uint32_t> node_tree_;
+  std::vector<uint8_t> default_left_;
+  /*! \brief leaf masks of the split nodes, nword_ words each */
+  std::vector<uint64_t> mask_;
+  /*! \brief leaves of tree t, left to right, are [leaf_ptr_[t], leaf_ptr_[t + 1]) */
+  std::vector<size_t> leaf_ptr_;
+  std::vector<bst_float> leaf_value_;
+  /*! \brief the indexed trees */
+  std::vector<const RegTree*> source_;
+  size_t nword_{1};
+  bool single_root_{true};
+};
+
+}  // namespace predictor
+}  // namespace xgboost
+#endif  // XGBOOST_PREDICTOR_QUICKSCORER_H_
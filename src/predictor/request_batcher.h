@@ -0,0 +1,180 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file request_batcher.h
+ * \brief coalesce concurrent single row predictions into small batches.
+ *
+ *  A row scored alone walks the trees one node load at a time. The serving
+ *  threads push their rows to a lock free queue and a worker thread takes
+ *  them in batches: a batch closes when it has max_batch rows or when the
+ *  max_delay after its first row has passed, so a lone request waits at most
+ *  max_delay. The batch is scored by the FrozenPredictor, a block of rows
+ *  through each tree at a time, and every request gets its result through
+ *  a future.
+ */
+#ifndef XGBOOST_PREDICTOR_REQUEST_BATCHER_H_
+#define XGBOOST_PREDICTOR_REQUEST_BATCHER_H_
+
+#include <dmlc/logging.h>
+#include <xgboost/base.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../common/host_device_vector.h"
+#include "../common/mpsc_queue.h"
+#include "./frozen_predictor.h"
+
+namespace xgboost {
+namespace predictor {
+
+class RequestBatcher {
+ public:
+  using Clock = std::chrono::steady_clock;
+  /*!
+   * \param predictor the model, it must outlive the batcher
+   * \param max_batch most rows of a batch
+   * \param max_delay longest wait of the first row of a batch for others
+   * \param output_margin whether to return the margins instead of the
+   *  transformed predictions
+   * \param ntree_limit limit number of trees used for prediction, 0 uses all
+   */
+  RequestBatcher(const FrozenPredictor& predictor, size_t max_batch,
+                 std::chrono::microseconds max_delay, bool output_margin,
+                 unsigned ntree_limit)
+      : predictor_(predictor), max_batch_(std::max(max_batch, static_cast<size_t>(1))),
+        max_delay_(max_delay), output_margin_(output_margin), ntree_limit_(ntree_limit) {
+    worker_ = std::thread([this]() { this->Run(); });
+  }
+  RequestBatcher(const RequestBatcher&) = delete;
+  RequestBatcher& operator=(const RequestBatcher&) = delete;
+  /*! \brief score the pending requests and stop the worker */
+  ~RequestBatcher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    worker_.join();
+  }
+  /*!
+   * \brief queue a dense row for prediction, from any thread
+   * \param row the ncol values of the row, kept valid until the result is ready
+   * \param missing which value to represent missing value, NaN is always missing
+   * \param out buffer of out_size >= num_output_group values for the result
+   * \return the number of values written to out, once they are
+   */
+  inline std::future<size_t> Submit(const bst_float* row, size_t ncol, bst_float missing,
+                                    bst_float* out, size_t out_size) {
+    CHECK_GE(out_size, static_cast<size_t>(predictor_.NumOutputGroup()))
+        << "output buffer is too small";
+    auto* request = new Request();
+    request->row = row;
+    request->ncol = ncol;
+    request->missing = missing;
+    request->out = out;
+    std::future<size_t> result = request->done.get_future();
+    queue_.Push(request);
+    if (sleeping_.load()) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cv_.notify_one();
+    }
+    return result;
+  }
+
+ private:
+  struct Request : public common::MPSCQueue::Node {
+    const bst_float* row;
+    size_t ncol;
+    bst_float missing;
+    bst_float* out;
+    std::promise<size_t> done;
+  };
+  // take the next request, waiting for one until deadline or, without a
+  // deadline, until the batcher stops; nullptr when none came
+  inline Request* PopUntil(const Clock::time_point* deadline) {
+    common::MPSCQueue::Node* node = queue_.Pop();
+    if (node != nullptr) return static_cast<Request*>(node);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      // a producer seeing sleeping_ notifies under the mutex, after the wait began
+      sleeping_.store(true);
+      node = queue_.Pop();
+      if (node != nullptr || stop_) break;
+      if (deadline == nullptr) {
+        cv_.wait(lock);
+      } else if (cv_.wait_until(lock, *deadline) == std::cv_status::timeout) {
+        node = queue_.Pop();
+        break;
+      }
+    }
+    sleeping_.store(false);
+    return static_cast<Request*>(node);
+  }
+  inline void Run() {
+    std::vector<Request*> batch;
+    while (Request* first = this->PopUntil(nullptr)) {
+      batch.assign(1, first);
+      const Clock::time_point deadline = Clock::now() + max_delay_;
+      while (batch.size() < max_batch_) {
+        Request* request = this->PopUntil(&deadline);
+        if (request == nullptr) break;
+        batch.push_back(request);
+      }
+      this->Process(batch);
+    }
+  }
+  inline void Process(const std::vector<Request*>& batch) {
+    const size_t nrow = batch.size();
+    const auto ncol = static_cast<size_t>(predictor_.NumFeature());
+    const bst_float nan = std::numeric_limits<bst_float>::quiet_NaN();
+    rows_.assign(nrow * ncol, nan);
+    for (size_t i = 0; i < nrow; ++i) {
+      const Request& request = *batch[i];
+      for (size_t j = 0; j < std::min(request.ncol, ncol); ++j) {
+        const bst_float value = request.row[j];
+        if (value != request.missing) rows_[i * ncol + j] = value;
+      }
+    }
+    try {
+      preds_.Resize(nrow * predictor_.NumOutputGroup());
+      std::vector<bst_float>& preds = preds_.HostVector();
+      predictor_.PredictFromDense(dmlc::BeginPtr(rows_), nrow, ncol, nan, ntree_limit_,
+                                  dmlc::BeginPtr(preds));
+      if (!output_margin_) predictor_.PredTransform(&preds_);
+      const size_t width = preds.size() / nrow;
+      for (size_t i = 0; i < nrow; ++i) {
+        std::copy(preds.begin() + i * width, preds.begin() + (i + 1) * width, batch[i]->out);
+        batch[i]->done.set_value(width);
+      }
+    } catch (...) {
+      for (Request* request : batch) request->done.set_exception(std::current_exception());
+    }
+    for (Request* request : batch) delete request;
+  }
+
+  const FrozenPredictor& predictor_;
+  const size_t max_batch_;
+  const std::chrono::microseconds max_delay_;
+  const bool output_margin_;
+  const unsigned ntree_limit_;
+  common::MPSCQueue queue_;
+  // wakes the worker when it waits for requests
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::atomic<bool> sleeping_{false};
+  bool stop_{false};
+  // rows and predictions of the batch, only touched by the worker
+  std::vector<bst_float> rows_;
+  HostDeviceVector<bst_float> preds_;
+  std::thread worker_;
+};
+
+}  // namespace predictor
+}  // namespace xgboost
+#endif  // XGBOOST_PREDICTOR_REQUEST_BATCHER_H_
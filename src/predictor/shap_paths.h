@@ -0,0 +1,249 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file shap_paths.h
+ * \brief TreeShap decomposed into the root to leaf paths of the trees, for
+ *  the GPU predictor.
+ *
+ *  The SHAP values of a tree are the sums of those of its leaves, and those
+ *  of a leaf only depend on the splits of the path to it. The splits of a
+ *  feature on a path are merged into one element: the rows following the
+ *  path have a value in [lower_bound, upper_bound), or are missing and the
+ *  path takes the default branches, and the fraction of the cover of the tree
+ *  going down the path is the product of those of the splits. The paths are
+ *  extracted once on the host, then each (row, path) pair runs the extension
+ *  of the unique path of TreeShap on at most depth + 1 elements, without the
+ *  recursion over the tree, see Mitchell et al., GPUTreeShap: massively
+ *  parallel exact calculation of SHAP scores for tree ensembles.
+ *
+ *  The values agree with RegTree::CalculateContributions up to float
+ *  rounding, the features of a path being extended in another order.
+ */
+#ifndef XGBOOST_PREDICTOR_SHAP_PATHS_H_
+#define XGBOOST_PREDICTOR_SHAP_PATHS_H_
+
+#include <xgboost/base.h>
+#include <xgboost/tree_model.h>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace predictor {
+
+/*! \brief the most elements of a path, the root element included */
+constexpr int kMaxShapPathLength = 32;
+
+/*! \brief the splits of a feature on a path, or the root element */
+struct ShapPathElement {
+  /*! \brief the feature, -1 for the root element followed by all rows */
+  int feature_idx;
+  /*! \brief whether the rows missing the feature follow the path */
+  bool is_missing_branch;
+  float lower_bound;
+  float upper_bound;
+  /*! \brief the fraction of the cover following the splits */
+  float zero_fraction;
+
+  /*! \brief whether a row of value fvalue, or missing, follows the splits */
+  XGBOOST_DEVICE float OneFraction(bool missing, float fvalue) const {
+    if (feature_idx < 0) return 1.0f;
+    if (missing) return is_missing_branch ? 1.0f : 0.0f;
+    return lower_bound <= fvalue && fvalue < upper_bound ? 1.0f : 0.0f;
+  }
+};
+
+/*! \brief the root to leaf paths of the trees of a model */
+struct ShapPaths {
+  /*! \brief the elements of path i are [path_ptr[i], path_ptr[i + 1]), the root first */
+  std::vector<ShapPathElement> elements;
+  std::vector<size_t> path_ptr;
+  /*! \brief the leaf value and the output group of each path */
+  std::vector<float> leaf_value;
+  std::vector<int> group;
+  /*! \brief the most elements of a path */
+  size_t max_length{0};
+
+  size_t Size() const { return leaf_value.size(); }
+};
+
+// add the paths of the subtree of nid, the path to nid being path
+inline void ExtractShapPaths(const RegTree& tree, int group, int nid,
+                             std::vector<ShapPathElement> path, ShapPaths* out) {
+  const RegTree::Node& node = tree[nid];
+  if (node.IsLeaf()) {
+    out->elements.insert(out->elements.end(), path.begin(), path.end());
+    out->path_ptr.push_back(out->elements.size());
+    out->leaf_value.push_back(node.LeafValue());
+    out->group.push_back(group);
+    out->max_length = std::max(out->max_length, path.size());
+    return;
+  }
+  const int fid = static_cast<int>(node.SplitIndex());
+  const float inf = std::numeric_limits<float>::infinity();
+  const float w = tree.Stat(nid).sum_hess;
+  for (int child : {node.LeftChild(), node.RightChild()}) {
+    const bool left = child == node.LeftChild();
+    const ShapPathElement split{fid, node.DefaultChild() == child,
+                                left ? -inf : node.SplitCond(),
+                                left ? node.SplitCond() : inf,
+                                tree.Stat(child).sum_hess / w};
+    std::vector<ShapPathElement> child_path = path;
+    auto it = std::find_if(child_path.begin() + 1, child_path.end(),
+                           [fid](const ShapPathElement& e) { return e.feature_idx == fid; });
+    if (it == child_path.end()) {
+      child_path.push_back(split);
+    } else {
+      it->is_missing_branch = it->is_missing_branch && split.is_missing_branch;
+      it->lower_bound = std::max(it->lower_bound, split.lower_bound);
+      it->upper_bound = std::min(it->upper_bound, split.upper_bound);
+      it->zero_fraction *= split.zero_fraction;
+    }
+    ExtractShapPaths(tree, group, child, std::move(child_path), out);
+  }
+}
+
+/*!
+ * \brief extract the paths of the trees [tree_begin, tree_end) of a model,
+ *  from root 0 of each tree
+ */
+inline void ExtractShapPaths(const gbm::GBTreeModel& model, size_t tree_begin,
+                             size_t tree_end, ShapPaths* out) {
+  out->elements.clear();
+  out->leaf_value.clear();
+  out->group.clear();
+  out->path_ptr.assign(1, 0);
+  out->max_length = 0;
+  const float inf = std::numeric_limits<float>::infinity();
+  for (size_t t = tree_begin; t < tree_end; ++t) {
+    ExtractShapPaths(*model.trees[t], model.tree_info[t], 0,
+                     {ShapPathElement{-1, true, -inf, inf, 1.0f}}, out);
+  }
+}
+
+/*!
+ * \brief the SHAP values of the elements [1, n) of a path whose fractions are
+ *  set for a row, element 0 being the root, see ExtendPath and UnwoundPathSum
+ *  of tree_model.h
+ * \param feature the feature of each element
+ * \param zero the zero fraction of each element
+ * \param one the one fraction of each element for the row
+ * \param pweight scratch of n permutation weights
+ * \param n the number of elements
+ * \param scale the factor of the values, the leaf value and the condition
+ * \param add called with the feature and the value of each element
+ */
+template <typename AddT>
+XGBOOST_DEVICE void ShapPathValues(const int* feature, const float* zero, const float* one,
+                                   float* pweight, int n, float scale, AddT add) {
+  // extend the path with each element in turn
+  for (int d = 0; d < n; ++d) {
+    pweight[d] = d == 0 ? 1.0f : 0.0f;
+    for (int i = d - 1; i >= 0; --i) {
+      pweight[i + 1] += one[d] * pweight[i] * (i + 1) / static_cast<float>(d + 1);
+      pweight[i] = zero[d] * pweight[i] * (d - i) / static_cast<float>(d + 1);
+    }
+  }
+  const int depth = n - 1;
+  for (int k = 1; k < n; ++k) {
+    // the total permutation weight of the path without element k
+    float next_one_portion = pweight[depth];
+    float total = 0;
+    for (int i = depth - 1; i >= 0; --i) {
+      if (one[k] != 0) {
+        const float tmp = next_one_portion * (depth + 1) / static_cast<float>((i + 1) * one[k]);
+        total += tmp;
+        next_one_portion = pweight[i] - tmp * zero[k] * ((depth - i) /
+                                                         static_cast<float>(depth + 1));
+      } else {
+        total += (pweight[i] / zero[k]) / ((depth - i) / static_cast<float>(depth + 1));
+      }
+    }
+    add(feature[k], total * (one[k] - zero[k]) * scale);
+  }
+}
+
+// the SHAP values of a row along a path without its element skip, -1 for
+// none, see ShapPathContributions
+template <typename AddT>
+XGBOOST_DEVICE void ShapPathSkip(const ShapPathElement* elements, const float* fvalue,
+                                 const bool* missing, int n, int skip, float scale,
+                                 AddT add) {
+  int feature[kMaxShapPathLength];
+  float zero[kMaxShapPathLength];
+  float one[kMaxShapPathLength];
+  float pweight[kMaxShapPathLength];
+  int m = 0;
+  for (int i = 0; i < n; ++i) {
+    if (i == skip) continue;
+    feature[m] = elements[i].feature_idx;
+    zero[m] = elements[i].zero_fraction;
+    one[m] = elements[i].OneFraction(missing[i], fvalue[i]);
+    ++m;
+  }
+  ShapPathValues(feature, zero, one, pweight, m, scale, add);
+}
+
+/*!
+ * \brief the SHAP values of a row along a path, conditioned on a feature as
+ *  RegTree::CalculateContributions is
+ * \param elements the n elements of the path, at most kMaxShapPathLength
+ * \param fvalue the value of the feature of element i, missing[i] if missing
+ * \param leaf_value the value of the leaf of the path
+ * \param condition 1 to fix the feature on, -1 off, 0 for no condition
+ * \param condition_feature the feature fixed
+ * \param add called with the feature and the value, and with -1 for the
+ *  contribution of the path to the bias without a condition
+ */
+template <typename AddT>
+XGBOOST_DEVICE void ShapPathContributions(const ShapPathElement* elements, const float* fvalue,
+                                          const bool* missing, int n, float leaf_value,
+                                          int condition, int condition_feature, AddT add) {
+  if (condition == 0) {
+    float mean = leaf_value;
+    for (int i = 0; i < n; ++i) mean *= elements[i].zero_fraction;
+    add(-1, mean);
+    ShapPathSkip(elements, fvalue, missing, n, -1, leaf_value, add);
+    return;
+  }
+  int skip = -1;
+  for (int i = 1; i < n; ++i) {
+    if (elements[i].feature_idx == condition_feature) skip = i;
+  }
+  float scale = leaf_value;
+  if (skip >= 0) {
+    // the condition splits the weight of the path instead of its feature
+    scale *= condition > 0 ? elements[skip].OneFraction(missing[skip], fvalue[skip])
+                           : elements[skip].zero_fraction;
+  }
+  if (scale != 0) ShapPathSkip(elements, fvalue, missing, n, skip, scale, add);
+}
+
+/*!
+ * \brief the SHAP interaction values of a row along a path, see
+ *  CPUPredictor::PredictInteractionContributions
+ * \param add called with two features and the value, the diagonal with the
+ *  same feature twice, and -1 twice for the bias
+ */
+template <typename AddT>
+XGBOOST_DEVICE void ShapPathInteractions(const ShapPathElement* elements, const float* fvalue,
+                                         const bool* missing, int n, float leaf_value,
+                                         AddT add) {
+  ShapPathContributions(elements, fvalue, missing, n, leaf_value, 0, 0,
+                        [&](int f, float v) { add(f, f, v); });
+  for (int j = 1; j < n; ++j) {
+    const int fj = elements[j].feature_idx;
+    const float one_j = elements[j].OneFraction(missing[j], fvalue[j]);
+    // the values conditioned on and off feature fj differ by this factor
+    const float scale = leaf_value * (one_j - elements[j].zero_fraction) / 2.0f;
+    if (scale == 0) continue;
+    ShapPathSkip(elements, fvalue, missing, n, j, scale, [&](int f, float v) {
+      add(fj, f, v);
+      add(fj, fj, -v);
+    });
+  }
+}
+}  // namespace predictor
+}  // namespace xgboost
+#endif  // XGBOOST_PREDICTOR_SHAP_PATHS_H_
@@ -0,0 +1,255 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file robust_attack.cc
+ * \brief heuristic L-inf adversarial attack on tree ensembles.
+ */
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "./robust_attack.h"
+
+namespace xgboost {
+namespace robust {
+
+DMLC_REGISTER_PARAMETER(AttackParam);
+
+namespace {
+// L-inf distance of two points, missing features are equal
+inline bst_float Distortion(const std::vector<bst_float>& x,
+                            const std::vector<bst_float>& adv) {
+  bst_float ret = 0.0f;
+  for (size_t i = 0; i < x.size(); ++i) {
+    if (!std::isnan(x[i])) ret = std::max(ret, std::abs(adv[i] - x[i]));
+  }
+  return ret;
+}
+}  // namespace
+
+void RobustAttack::Configure(
+    const std::vector<std::pair<std::string, std::string> >& cfg) {
+  param_.InitAllowUnknown(cfg);
+}
+
+bst_float RobustAttack::EvalTree(size_t t, unsigned root,
+                                 const std::vector<bst_float>& x,
+                                 std::vector<bst_uint>* path) const {
+  const RegTree& tree = *model_.trees[t];
+  path->clear();
+  int nid = static_cast<int>(root);
+  while (!tree[nid].IsLeaf()) {
+    const unsigned fid = tree[nid].SplitIndex();
+    const bst_float fvalue = fid < x.size() ? x[fid] : std::numeric_limits<bst_float>::quiet_NaN();
+    const bool missing = std::isnan(fvalue);
+    // a missing feature is never perturbed, the tree does not depend on it
+    if (!missing) path->push_back(fid);
+    nid = tree.GetNext(nid, fvalue, missing);
+  }
+  return tree[nid].LeafValue();
+}
+
+bst_float RobustAttack::Gap(const std::vector<bst_float>& sum, int label) const {
+  if (sum.size() == 1) {
+    return label != 0 ? sum[0] : -sum[0];
+  }
+  bst_float other = -std::numeric_limits<bst_float>::max();
+  for (size_t k = 0; k < sum.size(); ++k) {
+    if (static_cast<int>(k) != label) other = std::max(other, sum[k]);
+  }
+  return sum[label] - other;
+}
+
+bool RobustAttack::Descent(Workspace* ws, unsigned root, int label,
+                           bst_float radius) const {
+  const size_t ngroup = ws->base.size();
+  ws->sum = ws->base;
+  for (size_t t = 0; t < ntree_; ++t) {
+    ws->out[t] = this->EvalTree(t, root, ws->adv, &ws->path[t]);
+    ws->sum[model_.tree_info[t]] += ws->out[t];
+  }
+  bst_float gap = this->Gap(ws->sum, label);
+  std::vector<bst_uint> path;
+  for (int iter = 0; iter < param_.attack_max_iter && gap > 0.0f; ++iter) {
+    // invert the paths: a feature only changes the trees whose path tests it
+    for (bst_uint fid : ws->touched) ws->feat_trees[fid].clear();
+    ws->touched.clear();
+    for (size_t t = 0; t < ntree_; ++t) {
+      for (bst_uint fid : ws->path[t]) {
+        std::vector<bst_uint>& trees = ws->feat_trees[fid];
+        if (trees.size() == 0) ws->touched.push_back(fid);
+        if (trees.size() == 0 || trees.back() != static_cast<bst_uint>(t)) {
+          trees.push_back(static_cast<bst_uint>(t));
+        }
+      }
+    }
+    bst_float best_gap = gap, best_value = 0.0f, best_dist = 0.0f;
+    bst_uint best_fid = 0;
+    bool found = false;
+    for (bst_uint fid : ws->touched) {
+      const bst_float x = ws->x[fid];
+      const bst_float lo = x - radius, hi = x + radius;
+      // the value closest to x of every cell of the threshold grid in the box
+      const bst_float* begin = std::upper_bound(index_->FeatureBegin(fid),
+                                                index_->FeatureEnd(fid), lo);
+      const bst_float* end = std::upper_bound(begin, index_->FeatureEnd(fid), hi);
+      for (const bst_float* it = begin; it != end; ++it) {
+        const bst_float value = *it > x
+            ? *it : std::nextafter(*it, -std::numeric_limits<bst_float>::infinity());
+        if (value == ws->adv[fid]) continue;
+        const bst_float saved = ws->adv[fid];
+        ws->adv[fid] = value;
+        ws->delta.assign(ngroup, 0.0f);
+        for (bst_uint t : ws->feat_trees[fid]) {
+          ws->delta[model_.tree_info[t]] += this->EvalTree(t, root, ws->adv, &path) - ws->out[t];
+        }
+        ws->adv[fid] = saved;
+        for (size_t k = 0; k < ngroup; ++k) ws->delta[k] += ws->sum[k];
+        const bst_float g = this->Gap(ws->delta, label);
+        const bst_float dist = std::abs(value - x);
+        if (g < best_gap || (found && g == best_gap && dist < best_dist)) {
+          best_gap = g;
+          best_fid = fid;
+          best_value = value;
+          best_dist = dist;
+          found = true;
+        }
+      }
+      // moving back to x itself
+      if (ws->adv[fid] != x) {
+        const bst_float saved = ws->adv[fid];
+        ws->adv[fid] = x;
+        ws->delta.assign(ngroup, 0.0f);
+        for (bst_uint t : ws->feat_trees[fid]) {
+          ws->delta[model_.tree_info[t]] += this->EvalTree(t, root, ws->adv, &path) - ws->out[t];
+        }
+        ws->adv[fid] = saved;
+        for (size_t k = 0; k < ngroup; ++k) ws->delta[k] += ws->sum[k];
+        const bst_float g = this->Gap(ws->delta, label);
+        if (g < best_gap || (found && g == best_gap)) {
+          best_gap = g;
+          best_fid = fid;
+          best_value = x;
+          best_dist = 0.0f;
+          found = true;
+        }
+      }
+    }
+    if (!found || best_gap >= gap) break;
+    ws->adv[best_fid] = best_value;
+    for (bst_uint t : ws->feat_trees[best_fid]) {
+      const bst_float out = this->EvalTree(t, root, ws->adv, &ws->path[t]);
+      ws->sum[model_.tree_info[t]] += out - ws->out[t];
+      ws->out[t] = out;
+    }
+    gap = this->Gap(ws->sum, label);
+  }
+  return gap <= 0.0f;
+}
+
+void RobustAttack::Attack(DMatrix* p_fmat, std::vector<bst_float>* out_dist,
+                          std::vector<bst_float>* out_adv, size_t num_row) {
+  const MetaInfo& info = p_fmat->Info();
+  CHECK_EQ(info.labels_.size(), info.num_row_)
+      << "attack needs the labels of the points";
+  const int ngroup = model_.param.num_output_group;
+  ntree_ = static_cast<size_t>(param_.ntree_limit) * ngroup;
+  if (ntree_ == 0 || ntree_ > model_.trees.size()) ntree_ = model_.trees.size();
+  const size_t nfeature = std::max(static_cast<size_t>(model_.param.num_feature),
+                                   static_cast<size_t>(info.num_col_));
+  // the grid of all trees, the thresholds of trees beyond ntree_limit only add cells
+  index_ = &model_.GetThresholdIndex();
+  if (ngroup != 1) {
+    for (bst_float label : info.labels_) {
+      CHECK(label >= 0.0f && label < ngroup)
+          << "label must be in [0, num_class), label=" << label;
+    }
+  }
+  const bst_float kMissing = param_.attack_dense
+      ? 0.0f : std::numeric_limits<bst_float>::quiet_NaN();
+  if (num_row == 0 || num_row > info.num_row_) num_row = info.num_row_;
+  out_dist->resize(num_row);
+  if (out_adv != nullptr) out_adv->resize(num_row * nfeature);
+
+  std::vector<Workspace> workspace(omp_get_max_threads());
+  for (Workspace& ws : workspace) {
+    ws.out.resize(ntree_);
+    ws.path.resize(ntree_);
+    ws.feat_trees.resize(nfeature);
+  }
+  auto iter = p_fmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    auto &batch = iter->Value();
+    if (batch.base_rowid >= num_row) break;
+    const auto nsize = static_cast<bst_omp_uint>(
+        std::min(batch.Size(), static_cast<size_t>(num_row - batch.base_rowid)));
+    #pragma omp parallel for schedule(dynamic)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      Workspace& ws = workspace[omp_get_thread_num()];
+      const size_t ridx = static_cast<size_t>(batch.base_rowid + i);
+      const unsigned root = info.GetRoot(ridx);
+      const int label = ngroup == 1
+          ? (info.labels_[ridx] > 0.5f ? 1 : 0) : static_cast<int>(info.labels_[ridx]);
+      SparsePage::Inst inst = batch[i];
+      ws.x.assign(nfeature, kMissing);
+      for (bst_uint j = 0; j < inst.length; ++j) {
+        if (inst[j].index < nfeature) ws.x[inst[j].index] = inst[j].fvalue;
+      }
+      ws.base.resize(ngroup);
+      for (int k = 0; k < ngroup; ++k) {
+        ws.base[k] = info.base_margin_.size() != 0
+            ? info.base_margin_[ridx * ngroup + k] : model_.base_margin;
+      }
+      std::vector<bst_float> best(ws.x);
+      bst_float dist = -1.0f;
+      ws.adv = ws.x;
+      if (this->Descent(&ws, root, label, 0.0f)) {
+        // misclassified without perturbation
+        dist = 0.0f;
+      } else {
+        std::mt19937 rnd(static_cast<unsigned>(param_.attack_seed) + static_cast<unsigned>(ridx));
+        std::uniform_real_distribution<bst_float> uniform(-1.0f, 1.0f);
+        const bst_float radius = param_.attack_eps;
+        for (int r = 0; r <= param_.attack_restarts; ++r) {
+          ws.adv = ws.x;
+          if (r != 0) {
+            for (size_t f = 0; f < nfeature; ++f) {
+              if (!std::isnan(ws.x[f])) ws.adv[f] += radius * uniform(rnd);
+            }
+          }
+          if (this->Descent(&ws, root, label, radius)) {
+            const bst_float d = Distortion(ws.x, ws.adv);
+            if (dist < 0.0f || d < dist) {
+              dist = d;
+              best = ws.adv;
+            }
+          }
+        }
+        // shrink the radius while the descent from x still succeeds
+        bst_float lo = 0.0f;
+        for (int s = 0; s < param_.attack_search_steps && dist > 0.0f; ++s) {
+          const bst_float mid = 0.5f * (lo + dist);
+          ws.adv = ws.x;
+          if (this->Descent(&ws, root, label, mid)) {
+            dist = std::min(mid, Distortion(ws.x, ws.adv));
+            best = ws.adv;
+          } else {
+            lo = mid;
+          }
+        }
+      }
+      (*out_dist)[ridx] = dist;
+      if (out_adv != nullptr) {
+        std::copy(best.begin(), best.end(), out_adv->begin() + ridx * nfeature);
+      }
+    }
+  }
+}
+
+}  // namespace robust
+}  // namespace xgboost
@@ -0,0 +1,121 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file robust_attack.h
+ * \brief heuristic L-inf adversarial attack on tree ensembles.
+ *
+ *  The attack is a greedy coordinate descent over the threshold grid of the
+ *  model: at every step one feature is moved to the cell between two of its
+ *  thresholds that lowers the margin of the true class the most. Since only
+ *  the trees whose current decision path tests a feature can change when the
+ *  feature moves, a candidate move is evaluated on those trees only. Found
+ *  adversarial examples are shrunk by a bisection on the radius, so the
+ *  distortions are upper bounds of the minimum ones computed by the MILP of
+ *  xgbKantchelianAttack.py.
+ */
+#ifndef XGBOOST_ROBUST_ROBUST_ATTACK_H_
+#define XGBOOST_ROBUST_ROBUST_ATTACK_H_
+
+#include <dmlc/parameter.h>
+#include <xgboost/data.h>
+#include <xgboost/tree_model.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace robust {
+
+/*! \brief parameters of the attack */
+struct AttackParam : public dmlc::Parameter<AttackParam> {
+  /*! \brief maximum L-inf radius of the perturbation */
+  float attack_eps;
+  /*! \brief maximum number of coordinate moves of a descent */
+  int attack_max_iter;
+  /*! \brief number of descents from random points of the box */
+  int attack_restarts;
+  /*! \brief number of bisection steps on the radius after a success */
+  int attack_search_steps;
+  /*! \brief whether absent features are treated as value 0 instead of missing */
+  bool attack_dense;
+  /*! \brief random seed of the restarts */
+  int attack_seed;
+  /*! \brief limit number of trees used in the attack, 0 means all trees */
+  int ntree_limit;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(AttackParam) {
+    DMLC_DECLARE_FIELD(attack_eps).set_default(1.0f).set_lower_bound(0.0f)
+        .describe("Maximum L-inf radius of the adversarial perturbation.");
+    DMLC_DECLARE_FIELD(attack_max_iter).set_default(200).set_lower_bound(1)
+        .describe("Maximum number of coordinate moves of a descent.");
+    DMLC_DECLARE_FIELD(attack_restarts).set_default(0).set_lower_bound(0)
+        .describe("Number of additional descents from random points of the box.");
+    DMLC_DECLARE_FIELD(attack_search_steps).set_default(6).set_lower_bound(0)
+        .describe("Number of bisection steps on the radius to shrink a found "
+                  "adversarial example.");
+    DMLC_DECLARE_FIELD(attack_dense).set_default(true)
+        .describe("Treat absent features as value 0, as the dense arrays of "
+                  "xgbKantchelianAttack.py do. Otherwise absent features stay "
+                  "missing and are not perturbed.");
+    DMLC_DECLARE_FIELD(attack_seed).set_default(0)
+        .describe("Random seed of the restarts.");
+    DMLC_DECLARE_FIELD(ntree_limit).set_default(0).set_lower_bound(0)
+        .describe("Number of trees used for the attack, 0 means use all trees.");
+  }
+};
+
+/*! \brief greedy attack of a gbtree model */
+class RobustAttack {
+ public:
+  explicit RobustAttack(const gbm::GBTreeModel& model) : model_(model) {
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "robustness attacks do not support trees of vector leaves";
+  }
+  /*! \brief set the attack parameters */
+  void Configure(const std::vector<std::pair<std::string, std::string> >& cfg);
+  /*!
+   * \brief attack every row of a matrix.
+   * \param p_fmat the points, labels are the true classes
+   * \param out_dist L-inf distortion of the adversarial example of each row,
+   *   0 for misclassified rows and -1 if none was found within attack_eps
+   * \param out_adv if not nullptr, the adversarial examples as dense rows of
+   *   num_feature values, missing features are NaN
+   * \param num_row if not 0, only the first num_row rows are attacked
+   */
+  void Attack(DMatrix* p_fmat, std::vector<bst_float>* out_dist,
+              std::vector<bst_float>* out_adv, size_t num_row = 0);
+
+ private:
+  /*! \brief per thread buffers */
+  struct Workspace {
+    /*! \brief the original point and the current candidate */
+    std::vector<bst_float> x, adv;
+    /*! \brief base margin of each group */
+    std::vector<bst_float> base;
+    /*! \brief output of each tree and sum of each group at adv */
+    std::vector<bst_float> out, sum, delta;
+    /*! \brief features tested on the current path of each tree */
+    std::vector<std::vector<bst_uint> > path;
+    /*! \brief trees whose current path tests a feature */
+    std::vector<std::vector<bst_uint> > feat_trees;
+    std::vector<bst_uint> touched;
+  };
+  // output of tree t at adv, records the features of its path
+  bst_float EvalTree(size_t t, unsigned root, const std::vector<bst_float>& x,
+                     std::vector<bst_uint>* path) const;
+  // margin of the true class over the best other class
+  bst_float Gap(const std::vector<bst_float>& sum, int label) const;
+  // descent from ws->adv within the given radius, true if adv becomes adversarial
+  bool Descent(Workspace* ws, unsigned root, int label, bst_float radius) const;
+
+  const gbm::GBTreeModel& model_;
+  AttackParam param_;
+  /*! \brief number of trees used */
+  size_t ntree_;
+  /*! \brief split thresholds of each feature */
+  const gbm::FeatureThresholdIndex* index_;
+};
+
+}  // namespace robust
+}  // namespace xgboost
+#endif  // XGBOOST_ROBUST_ROBUST_ATTACK_H_
@@ -0,0 +1,183 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file robust_gpu.cu
+ * \brief GPU computation of the per-tree robustness bounds.
+ *
+ *  A thread walks the trees for one point, visiting every leaf reachable from
+ *  the perturbation box with an explicit stack, and the lanes of a warp hold
+ *  consecutive points whose features are stored feature major.
+ */
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+#include "./robust_gpu.h"
+#include "../common/device_helpers.cuh"
+#include "../predictor/device_tree.cuh"
+
+namespace xgboost {
+namespace robust {
+
+using predictor::DevicePredictionNode;
+
+namespace {
+/*! \brief maximum depth of a tree supported by the stack of a thread */
+constexpr int kMaxDepth = 62;
+
+/*! \brief constraint of a path on one feature, fid -1 for none */
+struct PathInterval {
+  int fid;
+  float lo;
+  float hi;
+};
+
+/*! \brief a node to visit and the constraint added by the edge to it */
+struct PendingNode {
+  int nid;
+  int depth;
+  PathInterval cons;
+};
+
+__device__ void ReachableRangeDevice(const DevicePredictionNode* tree,
+                                     const float* d_x, size_t stride,
+                                     int num_features, float eps, PathInterval* path,
+                                     PendingNode* stack, float* out_min,
+                                     float* out_max) {
+  float vmin = FLT_MAX, vmax = -FLT_MAX;
+  int top = 0;
+  stack[top++] = {0, 0, {-1, 0.0f, 0.0f}};
+  while (top > 0) {
+    const PendingNode e = stack[--top];
+    path[e.depth] = e.cons;
+    const int path_size = e.depth + 1;
+    const DevicePredictionNode n = tree[e.nid];
+    if (n.IsLeaf()) {
+      vmin = fminf(vmin, n.GetWeight());
+      vmax = fmaxf(vmax, n.GetWeight());
+      continue;
+    }
+    const int fid = n.GetFidx();
+    const float fvalue = fid < num_features ? d_x[fid * stride] : nanf("");
+    if (isnan(fvalue)) {
+      stack[top++] = {n.MissingIdx(), path_size, {-1, 0.0f, 0.0f}};
+      continue;
+    }
+    // the tightest constraint on fid is the latest on the path
+    PathInterval cur = {fid, fvalue - eps, nextafterf(fvalue + eps, INFINITY)};
+    for (int i = path_size - 1; i >= 0; --i) {
+      if (path[i].fid == fid) {
+        cur = path[i];
+        break;
+      }
+    }
+    const float split = n.GetFvalue();
+    // the left child is pushed last to be visited first, as on the CPU
+    if (cur.hi > split) {
+      stack[top++] = {n.right_child_idx, path_size,
+                      {fid, fmaxf(cur.lo, split), cur.hi}};
+    }
+    if (cur.lo < split) {
+      stack[top++] = {n.left_child_idx, path_size,
+                      {fid, cur.lo, fminf(cur.hi, split)}};
+    }
+  }
+  *out_min = vmin;
+  *out_max = vmax;
+}
+
+__global__ void ReachableRangeKernel(const DevicePredictionNode* d_nodes,
+                                     const size_t* d_tree_segments,
+                                     const int* d_tree_group, size_t num_trees,
+                                     const float* d_x, size_t num_rows,
+                                     int num_features, float eps, int num_group, float* d_lower,
+                                     float* d_upper) {
+  size_t ridx = static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x;
+  if (ridx >= num_rows) return;
+  PathInterval path[kMaxDepth + 2];
+  PendingNode stack[kMaxDepth + 2];
+  for (size_t tree_idx = 0; tree_idx < num_trees; tree_idx++) {
+    float vmin, vmax;
+    ReachableRangeDevice(d_nodes + d_tree_segments[tree_idx], d_x + ridx,
+                         num_rows, num_features, eps, path, stack, &vmin, &vmax);
+    const size_t k = ridx * num_group + d_tree_group[tree_idx];
+    d_lower[k] += vmin;
+    d_upper[k] += vmax;
+  }
+}
+}  // namespace
+
+bool ReachableRangeGPU(const gbm::GBTreeModel& model, DMatrix* dmat,
+                       size_t tree_begin, size_t tree_end, bst_float eps,
+                       std::vector<bst_float>* lower,
+                       std::vector<bst_float>* upper) {
+  int n_devices = 0;
+  if (cudaGetDeviceCount(&n_devices) != cudaSuccess || n_devices == 0) {
+    // clear the error of a machine without a driver
+    cudaGetLastError();
+    return false;
+  }
+  const MetaInfo& info = dmat->Info();
+  if (info.root_index_.size() != 0) return false;
+  for (size_t t = tree_begin; t < tree_end; ++t) {
+    if (model.trees[t]->param.num_roots != 1 ||
+        model.trees[t]->MaxDepth() > kMaxDepth) {
+      return false;
+    }
+  }
+  if (tree_end == tree_begin) return true;
+  const int ngroup = model.param.num_output_group;
+  const size_t nfeature = std::max(static_cast<size_t>(model.param.num_feature),
+                                   static_cast<size_t>(info.num_col_));
+
+  thrust::host_vector<size_t> h_tree_segments;
+  thrust::host_vector<DevicePredictionNode> h_nodes;
+  predictor::FlattenTrees(model, tree_begin, tree_end, &h_tree_segments, &h_nodes);
+  thrust::device_vector<DevicePredictionNode> nodes(h_nodes);
+  thrust::device_vector<size_t> tree_segments(h_tree_segments);
+  thrust::device_vector<int> tree_group(model.tree_info.begin() + tree_begin,
+                                        model.tree_info.begin() + tree_end);
+
+  // the points are copied in chunks of at most 2^26 feature values
+  const size_t chunk_rows = std::max(static_cast<size_t>(1),
+                                     (static_cast<size_t>(1) << 26) / nfeature);
+  std::vector<float> h_x;
+  thrust::device_vector<float> x, chunk_lower, chunk_upper;
+  auto iter = dmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    auto &batch = iter->Value();
+    for (size_t begin = 0; begin < batch.Size(); begin += chunk_rows) {
+      const size_t nrow = std::min(chunk_rows, batch.Size() - begin);
+      h_x.assign(nrow * nfeature, 0.0f);
+      for (size_t i = 0; i < nrow; ++i) {
+        SparsePage::Inst inst = batch[begin + i];
+        for (bst_uint j = 0; j < inst.length; ++j) {
+          if (inst[j].index < nfeature) {
+            h_x[inst[j].index * nrow + i] = inst[j].fvalue;
+          }
+        }
+      }
+      x.assign(h_x.begin(), h_x.end());
+      const size_t offset = (batch.base_rowid + begin) * ngroup;
+      chunk_lower.assign(lower->begin() + offset,
+                         lower->begin() + offset + nrow * ngroup);
+      chunk_upper.assign(upper->begin() + offset,
+                         upper->begin() + offset + nrow * ngroup);
+      const int BLOCK_THREADS = 128;
+      const int GRID_SIZE = static_cast<int>(dh::DivRoundUp(nrow, BLOCK_THREADS));
+      ReachableRangeKernel<<<GRID_SIZE, BLOCK_THREADS>>>(
+          dh::Raw(nodes), dh::Raw(tree_segments), dh::Raw(tree_group),
+          tree_end - tree_begin, dh::Raw(x), nrow, static_cast<int>(nfeature), eps, ngroup,
+          dh::Raw(chunk_lower), dh::Raw(chunk_upper));
+      dh::safe_cuda(cudaGetLastError());
+      thrust::copy(chunk_lower.begin(), chunk_lower.end(), lower->begin() + offset);
+      thrust::copy(chunk_upper.begin(), chunk_upper.end(), upper->begin() + offset);
+    }
+  }
+  return true;
+}
+
+}  // namespace robust
+}  // namespace xgboost
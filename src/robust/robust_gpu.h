@@ -0,0 +1,32 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file robust_gpu.h
+ * \brief GPU computation of the per-tree robustness bounds.
+ */
+#ifndef XGBOOST_ROBUST_ROBUST_GPU_H_
+#define XGBOOST_ROBUST_ROBUST_GPU_H_
+
+#include <xgboost/data.h>
+#include <vector>
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace robust {
+/*!
+ * \brief add the range of the leaf values of trees [tree_begin, tree_end)
+ *  reachable from the L-inf box of radius eps around every row, on the
+ *  current CUDA device. The result equals RobustVerifier::ReachableRange with
+ *  absent features treated as 0, summed in tree order.
+ * \param lower the sums of the minimum per row and output group,
+ *   num_row * num_output_group values that the trees are added to
+ * \param upper the sums of the maximum, in the same layout
+ * \return false if no device is available or the model is not supported, e.g.
+ *   it has multiple roots, the sums are then unchanged
+ */
+bool ReachableRangeGPU(const gbm::GBTreeModel& model, DMatrix* dmat,
+                       size_t tree_begin, size_t tree_end, bst_float eps,
+                       std::vector<bst_float>* lower,
+                       std::vector<bst_float>* upper);
+}  // namespace robust
+}  // namespace xgboost
+#endif  // XGBOOST_ROBUST_ROBUST_GPU_H_
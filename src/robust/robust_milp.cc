@@ -0,0 +1,344 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file robust_milp.cc
+ * \brief export of the MILP of the minimal adversarial perturbation of a point.
+ */
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "./robust_milp.h"
+
+namespace xgboost {
+namespace robust {
+
+DMLC_REGISTER_PARAMETER(MilpParam);
+
+namespace {
+// a node whose split the box can cross, its leaves are [begin, mid) on the
+// left and [mid, end) on the right in the leaf order of the tree
+struct FreeNode {
+  bst_uint fid;
+  bst_float cond;
+  size_t begin, mid, end;
+};
+
+// the leaves reachable from the box of radius eps around x and the nodes
+// between them, the others are followed; eps 0 is no box
+void VisitBox(const RegTree& tree, int nid, const std::vector<bst_float>& x, bst_float eps,
+              std::vector<FreeNode>* nodes, std::vector<bst_float>* leaves) {
+  const RegTree::Node& node = tree[nid];
+  if (node.IsLeaf()) {
+    leaves->push_back(node.LeafValue());
+    return;
+  }
+  const unsigned fid = node.SplitIndex();
+  const bst_float fvalue = fid < x.size() ? x[fid] : std::numeric_limits<bst_float>::quiet_NaN();
+  const bst_float cond = node.SplitCond();
+  // a missing feature is never perturbed
+  if (std::isnan(fvalue)) {
+    VisitBox(tree, node.DefaultChild(), x, eps, nodes, leaves);
+    return;
+  }
+  if (eps > 0.0f && fvalue + eps < cond) {
+    VisitBox(tree, node.LeftChild(), x, eps, nodes, leaves);
+    return;
+  }
+  if (eps > 0.0f && fvalue - eps >= cond) {
+    VisitBox(tree, node.RightChild(), x, eps, nodes, leaves);
+    return;
+  }
+  const size_t idx = nodes->size();
+  nodes->push_back({fid, cond, leaves->size(), 0, 0});
+  VisitBox(tree, node.LeftChild(), x, eps, nodes, leaves);
+  (*nodes)[idx].mid = leaves->size();
+  VisitBox(tree, node.RightChild(), x, eps, nodes, leaves);
+  (*nodes)[idx].end = leaves->size();
+}
+
+const char* LpSense(char sense) {
+  switch (sense) {
+    case 'L': return "<=";
+    case 'G': return ">=";
+    default: return "=";
+  }
+}
+
+// the terms of a linear expression in LP, a few per line
+void WriteLpTerms(const MilpProblem& prob, const std::vector<std::pair<size_t, double> >& terms,
+                  std::ostream* os) {
+  if (terms.empty()) {
+    // an expression needs a variable, the distance always exists
+    *os << " 0 " << prob.var_name.back();
+    return;
+  }
+  for (size_t i = 0; i < terms.size(); ++i) {
+    if (i != 0 && i % 8 == 0) *os << "\n   ";
+    *os << (terms[i].second < 0.0 ? " - " : " + ") << std::abs(terms[i].second)
+        << ' ' << prob.var_name[terms[i].first];
+  }
+}
+}  // namespace
+
+size_t MilpProblem::AddVar(const std::string& name, double ub, bool binary) {
+  var_name.push_back(name);
+  var_ub.push_back(ub);
+  var_binary.push_back(binary);
+  return var_name.size() - 1;
+}
+
+void MilpProblem::WriteMps(std::ostream* os) const {
+  const std::streamsize precision = os->precision(std::numeric_limits<double>::max_digits10);
+  for (const std::string& line : comments) *os << "* " << line << '\n';
+  *os << "NAME robust_attack\nROWS\n N obj\n";
+  for (const Row& row : rows) *os << ' ' << row.sense << ' ' << row.name << '\n';
+  // the entries are written by column
+  std::vector<std::vector<std::pair<const std::string*, double> > > columns(var_name.size());
+  const std::string obj = "obj";
+  for (const auto& term : objective) columns[term.first].emplace_back(&obj, term.second);
+  for (const Row& row : rows) {
+    for (const auto& term : row.terms) columns[term.first].emplace_back(&row.name, term.second);
+  }
+  *os << "COLUMNS\n";
+  for (size_t v = 0; v < columns.size(); ++v) {
+    for (const auto& entry : columns[v]) {
+      *os << "    " << var_name[v] << ' ' << *entry.first << ' ' << entry.second << '\n';
+    }
+  }
+  *os << "RHS\n";
+  for (const Row& row : rows) {
+    if (row.rhs != 0.0) *os << "    rhs " << row.name << ' ' << row.rhs << '\n';
+  }
+  *os << "BOUNDS\n";
+  for (size_t v = 0; v < var_name.size(); ++v) {
+    if (var_binary[v]) {
+      *os << " BV bnd " << var_name[v] << '\n';
+    } else if (var_ub[v] != std::numeric_limits<double>::infinity()) {
+      *os << " UP bnd " << var_name[v] << ' ' << var_ub[v] << '\n';
+    }
+  }
+  *os << "ENDATA\n";
+  os->precision(precision);
+}
+
+void MilpProblem::WriteLp(std::ostream* os) const {
+  const std::streamsize precision = os->precision(std::numeric_limits<double>::max_digits10);
+  for (const std::string& line : comments) *os << "\\ " << line << '\n';
+  *os << "Minimize\n obj:";
+  WriteLpTerms(*this, objective, os);
+  *os << "\nSubject To\n";
+  for (const Row& row : rows) {
+    *os << ' ' << row.name << ':';
+    WriteLpTerms(*this, row.terms, os);
+    *os << ' ' << LpSense(row.sense) << ' ' << row.rhs << '\n';
+  }
+  *os << "Bounds\n";
+  for (size_t v = 0; v < var_name.size(); ++v) {
+    if (!var_binary[v] && var_ub[v] != std::numeric_limits<double>::infinity()) {
+      *os << ' ' << var_name[v] << " <= " << var_ub[v] << '\n';
+    }
+  }
+  if (std::find(var_binary.begin(), var_binary.end(), true) != var_binary.end()) {
+    *os << "Binaries\n";
+    for (size_t v = 0; v < var_name.size(); ++v) {
+      if (var_binary[v]) *os << ' ' << var_name[v] << '\n';
+    }
+  }
+  *os << "End\n";
+  os->precision(precision);
+}
+
+void RobustMilp::Configure(
+    const std::vector<std::pair<std::string, std::string> >& cfg) {
+  param_.InitAllowUnknown(cfg);
+}
+
+void RobustMilp::Build(DMatrix* p_fmat, size_t row, int target, MilpProblem* out) const {
+  const MetaInfo& info = p_fmat->Info();
+  CHECK_LT(row, info.num_row_) << "row out of range";
+  CHECK_EQ(info.labels_.size(), info.num_row_)
+      << "MILP export needs the labels of the points";
+  const int ngroup = model_.param.num_output_group;
+  size_t ntree = static_cast<size_t>(param_.ntree_limit) * ngroup;
+  if (ntree == 0 || ntree > model_.trees.size()) ntree = model_.trees.size();
+  const size_t nfeature = std::max(static_cast<size_t>(model_.param.num_feature),
+                                   static_cast<size_t>(info.num_col_));
+  const bst_float kMissing = param_.milp_dense
+      ? 0.0f : std::numeric_limits<bst_float>::quiet_NaN();
+  std::vector<bst_float> x(nfeature, kMissing);
+  auto iter = p_fmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    auto &batch = iter->Value();
+    if (row < batch.base_rowid || row >= batch.base_rowid + batch.Size()) continue;
+    SparsePage::Inst inst = batch[row - batch.base_rowid];
+    for (bst_uint j = 0; j < inst.length; ++j) {
+      if (inst[j].index < nfeature) x[inst[j].index] = inst[j].fvalue;
+    }
+  }
+  const unsigned root = info.GetRoot(row);
+  std::vector<bst_float> margin(ngroup);
+  for (int k = 0; k < ngroup; ++k) {
+    margin[k] = info.base_margin_.size() != 0
+        ? info.base_margin_[row * ngroup + k] : model_.base_margin;
+  }
+  // the output driven to <= 0 is constant + the trees of each group times its sign
+  std::vector<bst_float> sign(ngroup, 0.0f);
+  double constant;
+  if (ngroup == 1) {
+    sign[0] = info.labels_[row] > 0.5f ? 1.0f : -1.0f;
+    constant = sign[0] * margin[0];
+  } else {
+    const int label = static_cast<int>(info.labels_[row]);
+    CHECK(label >= 0 && label < ngroup)
+        << "label must be in [0, num_class), label=" << info.labels_[row];
+    CHECK(target >= 0 && target < ngroup && target != label)
+        << "target must be a class other than the label, target=" << target;
+    sign[label] = 1.0f;
+    sign[target] = -1.0f;
+    constant = margin[label] - margin[target];
+  }
+
+  *out = MilpProblem();
+  std::vector<std::vector<FreeNode> > nodes(ntree);
+  std::vector<std::vector<bst_float> > leaves(ntree);
+  std::vector<std::pair<bst_uint, bst_float> >& preds = out->predicates;
+  for (size_t t = 0; t < ntree; ++t) {
+    const bst_float s = sign[model_.tree_info[t]];
+    if (s == 0.0f) continue;
+    VisitBox(*model_.trees[t], static_cast<int>(root), x, param_.milp_eps,
+             &nodes[t], &leaves[t]);
+    // a tree the box cannot move out of its leaf is a constant
+    if (leaves[t].size() == 1) constant += s * leaves[t][0];
+    for (const FreeNode& n : nodes[t]) preds.emplace_back(n.fid, n.cond);
+  }
+  // the nodes testing the same predicate share its variable
+  std::sort(preds.begin(), preds.end());
+  preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+  double guard = param_.milp_guard;
+  double min_diff = std::numeric_limits<double>::max();
+  for (size_t k = 1; k < preds.size(); ++k) {
+    if (preds[k].first != preds[k - 1].first) continue;
+    min_diff = std::min(min_diff, static_cast<double>(preds[k].second) - preds[k - 1].second);
+  }
+  if (min_diff < 2.0 * guard) guard = min_diff / 3.0;
+
+  std::ostringstream os;
+  os << "row " << row << ", label " << info.labels_[row] << ", target " << target
+     << ", box radius " << param_.milp_eps << ", guard " << guard;
+  out->comments.push_back(os.str());
+  for (size_t k = 0; k < preds.size(); ++k) {
+    os.str("");
+    os << std::setprecision(std::numeric_limits<bst_float>::max_digits10)
+       << 'p' << k << " = x[" << preds[k].first << "] < " << preds[k].second;
+    out->comments.push_back(os.str());
+    out->AddVar("p" + std::to_string(k), 1.0, !param_.milp_relax);
+  }
+  auto pred_var = [&preds](const FreeNode& n) {
+    return static_cast<size_t>(std::lower_bound(preds.begin(), preds.end(),
+                                                std::make_pair(n.fid, n.cond)) - preds.begin());
+  };
+  MilpProblem::Row mislabel;
+  mislabel.name = "mislabel";
+  for (size_t t = 0; t < ntree; ++t) {
+    if (leaves[t].size() < 2) continue;
+    const bst_float s = sign[model_.tree_info[t]];
+    const std::string tname = std::to_string(t);
+    const size_t base = out->var_name.size();
+    MilpProblem::Row sum;
+    sum.name = "leaf_sum_" + tname;
+    sum.sense = 'E';
+    sum.rhs = 1.0;
+    for (size_t i = 0; i < leaves[t].size(); ++i) {
+      out->AddVar("l" + tname + "_" + std::to_string(i), 1.0, false);
+      sum.terms.emplace_back(base + i, 1.0);
+      if (leaves[t][i] != 0.0f) mislabel.terms.emplace_back(base + i, s * leaves[t][i]);
+    }
+    out->rows.push_back(std::move(sum));
+    for (size_t j = 0; j < nodes[t].size(); ++j) {
+      const FreeNode& n = nodes[t][j];
+      const size_t p = pred_var(n);
+      // the first free node is the top of the reduced tree, its two sides
+      // hold all the leaves and its rows are equalities
+      MilpProblem::Row left, right;
+      left.name = "left_" + tname + "_" + std::to_string(j);
+      right.name = "right_" + tname + "_" + std::to_string(j);
+      left.sense = right.sense = j == 0 ? 'E' : 'L';
+      for (size_t i = n.begin; i < n.mid; ++i) left.terms.emplace_back(base + i, 1.0);
+      for (size_t i = n.mid; i < n.end; ++i) right.terms.emplace_back(base + i, 1.0);
+      left.terms.emplace_back(p, -1.0);
+      right.terms.emplace_back(p, 1.0);
+      right.rhs = 1.0;
+      out->rows.push_back(std::move(left));
+      out->rows.push_back(std::move(right));
+    }
+  }
+  // the label 0 of a binary model needs a positive output, as the prediction does
+  mislabel.rhs = -constant - (ngroup == 1 && sign[0] < 0.0f ? guard : 0.0);
+  out->rows.push_back(std::move(mislabel));
+  for (size_t k = 0; k + 1 < preds.size(); ++k) {
+    if (preds[k].first != preds[k + 1].first) continue;
+    MilpProblem::Row consis;
+    consis.name = "consis_" + std::to_string(k);
+    consis.terms = {{k, 1.0}, {k + 1, -1.0}};
+    out->rows.push_back(std::move(consis));
+  }
+
+  // the distance: the predicates of a feature cut its axis into cells, cost[c]
+  // is the distance to move x into cell c. As p[j] = 1 for all the cells left
+  // of threshold j, the distance is sum (cost[j] - cost[j + 1]) p[j] + cost.back()
+  const size_t dist = out->AddVar("b", std::numeric_limits<double>::infinity(), false);
+  out->objective.emplace_back(dist, 1.0);
+  const bool linf = param_.milp_norm == kNormInf;
+  MilpProblem::Row sum_dist;
+  sum_dist.name = "dist";
+  std::vector<double> cost;
+  for (size_t begin = 0, end = 0; begin < preds.size(); begin = end) {
+    const bst_uint fid = preds[begin].first;
+    while (end < preds.size() && preds[end].first == fid) ++end;
+    const double fvalue = x[fid];
+    cost.resize(end - begin + 1);
+    for (size_t c = 0; c < cost.size(); ++c) {
+      double d = 0.0;
+      if (c != 0 && fvalue < preds[begin + c - 1].second) {
+        d = preds[begin + c - 1].second - fvalue;
+      } else if (begin + c != end && fvalue >= preds[begin + c].second) {
+        d = fvalue - preds[begin + c].second + guard;
+      }
+      cost[c] = param_.milp_norm == kNormL2 ? d * d : d;
+    }
+    MilpProblem::Row feature;
+    MilpProblem::Row& dst = linf ? feature : sum_dist;
+    for (size_t c = 0; c + 1 < cost.size(); ++c) {
+      if (cost[c] != cost[c + 1]) dst.terms.emplace_back(begin + c, cost[c] - cost[c + 1]);
+    }
+    dst.rhs -= cost.back();
+    if (linf) {
+      feature.name = "linf_" + std::to_string(fid);
+      feature.terms.emplace_back(dist, -1.0);
+      out->rows.push_back(std::move(feature));
+    }
+  }
+  if (!linf) {
+    sum_dist.terms.emplace_back(dist, -1.0);
+    out->rows.push_back(std::move(sum_dist));
+  }
+}
+
+void RobustMilp::Export(DMatrix* p_fmat, size_t row, int target, std::ostream* os) const {
+  MilpProblem prob;
+  this->Build(p_fmat, row, target, &prob);
+  if (param_.milp_format == kMilpLp) {
+    prob.WriteLp(os);
+  } else {
+    prob.WriteMps(os);
+  }
+}
+
+}  // namespace robust
+}  // namespace xgboost
@@ -0,0 +1,141 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file robust_milp.h
+ * \brief export of the MILP of the minimal adversarial perturbation of a point.
+ *
+ *  The formulation is that of xgbKantchelianAttack.py: a binary predicate
+ *  variable per distinct (feature, threshold) pair of the trees, shared by
+ *  all the nodes testing it, and a leaf variable per leaf, bound to the
+ *  predicates of its path. The objective is the distance of the cell of the
+ *  predicates to the point. Within a box of radius milp_eps the nodes whose
+ *  split the box cannot cross are followed instead of modeled, so the leaves
+ *  and the predicates outside the box are never written, and trees reduced to
+ *  one leaf only add their value to the misclassification constraint.
+ */
+#ifndef XGBOOST_ROBUST_ROBUST_MILP_H_
+#define XGBOOST_ROBUST_ROBUST_MILP_H_
+
+#include <dmlc/parameter.h>
+#include <xgboost/data.h>
+#include <xgboost/tree_model.h>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../gbm/gbtree_model.h"
+#include "./robust_verifier.h"
+
+namespace xgboost {
+namespace robust {
+
+/*! \brief output format of the formulation */
+enum MilpFormat : int {
+  kMilpMps = 0,
+  kMilpLp = 1
+};
+
+/*! \brief parameters of the MILP export */
+struct MilpParam : public dmlc::Parameter<MilpParam> {
+  /*! \brief radius of the box the adversarial point is searched in, 0 for no box */
+  float milp_eps;
+  /*! \brief norm of the distance minimized, a VerifyNorm */
+  int milp_norm;
+  /*! \brief distance below a threshold at which a moved feature is placed */
+  float milp_guard;
+  /*! \brief whether the predicates are relaxed to [0, 1] */
+  bool milp_relax;
+  /*! \brief output format, a MilpFormat */
+  int milp_format;
+  /*! \brief whether absent features are treated as value 0 instead of missing */
+  bool milp_dense;
+  /*! \brief limit number of trees exported, 0 means all trees */
+  int ntree_limit;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(MilpParam) {
+    DMLC_DECLARE_FIELD(milp_eps).set_default(0.0f).set_lower_bound(0.0f)
+        .describe("L-inf radius of the box around the point the adversarial "
+                  "point is searched in, 0 searches everywhere.");
+    DMLC_DECLARE_FIELD(milp_norm).set_default(kNormInf)
+        .add_enum("inf", kNormInf)
+        .add_enum("l1", kNormL1)
+        .add_enum("l2", kNormL2)
+        .describe("Norm of the distance minimized, l2 minimizes its square.");
+    DMLC_DECLARE_FIELD(milp_guard).set_default(2e-7f).set_lower_bound(0.0f)
+        .describe("Distance below a threshold at which a feature moved left of "
+                  "it is placed, a third of the closest thresholds if smaller.");
+    DMLC_DECLARE_FIELD(milp_relax).set_default(false)
+        .describe("Relax the binary predicates to [0, 1], which gives the LP "
+                  "lower bound of the distance.");
+    DMLC_DECLARE_FIELD(milp_format).set_default(kMilpMps)
+        .add_enum("mps", kMilpMps)
+        .add_enum("lp", kMilpLp)
+        .describe("Format of the exported formulation: free MPS or CPLEX LP.");
+    DMLC_DECLARE_FIELD(milp_dense).set_default(true)
+        .describe("Treat absent features as value 0, as the dense arrays of "
+                  "xgbKantchelianAttack.py do. Otherwise absent features stay "
+                  "missing and follow the default directions.");
+    DMLC_DECLARE_FIELD(ntree_limit).set_default(0).set_lower_bound(0)
+        .describe("Number of trees exported, 0 means use all trees.");
+  }
+};
+
+/*! \brief a linear program over bounded variables, minimized */
+struct MilpProblem {
+  /*! \brief a constraint sum coef * var (sense) rhs, sense is 'L', 'E' or 'G' */
+  struct Row {
+    std::string name;
+    char sense{'L'};
+    std::vector<std::pair<size_t, double> > terms;
+    double rhs{0.0};
+  };
+  std::vector<std::string> var_name;
+  /*! \brief upper bound of each variable, the lower bounds are 0 */
+  std::vector<double> var_ub;
+  std::vector<bool> var_binary;
+  std::vector<std::pair<size_t, double> > objective;
+  std::vector<Row> rows;
+  /*! \brief the (feature, threshold) of each predicate, p<i> is x[feature] < threshold */
+  std::vector<std::pair<bst_uint, bst_float> > predicates;
+  /*! \brief comment lines of the header */
+  std::vector<std::string> comments;
+
+  /*! \return index of a new variable */
+  size_t AddVar(const std::string& name, double ub, bool binary);
+  /*! \brief write in free MPS */
+  void WriteMps(std::ostream* os) const;
+  /*! \brief write in CPLEX LP */
+  void WriteLp(std::ostream* os) const;
+};
+
+/*! \brief exporter of the attack MILP of a gbtree model */
+class RobustMilp {
+ public:
+  explicit RobustMilp(const gbm::GBTreeModel& model) : model_(model) {
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "MILP export does not support trees of vector leaves";
+  }
+  /*! \brief set the export parameters */
+  void Configure(const std::vector<std::pair<std::string, std::string> >& cfg);
+  /*! \brief the export parameters */
+  const MilpParam& Param() const {
+    return param_;
+  }
+  /*!
+   * \brief build the formulation of a row of a matrix.
+   * \param p_fmat the points, labels are the true classes
+   * \param row the row attacked
+   * \param target the class the point is moved to for multiclass models,
+   *   ignored for binary ones
+   */
+  void Build(DMatrix* p_fmat, size_t row, int target, MilpProblem* out) const;
+  /*! \brief build the formulation of a row and write it in milp_format */
+  void Export(DMatrix* p_fmat, size_t row, int target, std::ostream* os) const;
+
+ private:
+  const gbm::GBTreeModel& model_;
+  MilpParam param_;
+};
+
+}  // namespace robust
+}  // namespace xgboost
+#endif  // XGBOOST_ROBUST_ROBUST_MILP_H_
@@ -0,0 +1,710 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file robust_verifier.cc
+ * \brief certified L-inf, l1 and l2 robustness verification of tree ensembles.
+ */
+#include <dmlc/omp.h>
+#include <xgboost/logging.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+#include "./robust_verifier.h"
+
+namespace xgboost {
+namespace robust {
+
+DMLC_REGISTER_PARAMETER(VerifierParam);
+
+const char* VerifyStatusName(int status) {
+  switch (status) {
+    case kVerifiedRobust: return "verified_robust";
+    case kSearchedRobust: return "searched_robust";
+    case kVulnerable: return "vulnerable";
+    case kUnknown: return "unknown";
+    case kMisclassified: return "misclassified";
+    default: LOG(FATAL) << "unknown verification status " << status;
+  }
+  return "";
+}
+
+namespace {
+// severity used to combine the results of several class pairs
+inline int Severity(int status) {
+  switch (status) {
+    case kVerifiedRobust: return 0;
+    case kSearchedRobust: return 1;
+    case kUnknown: return 2;
+    case kVulnerable: return 3;
+    default: return 4;
+  }
+}
+
+// visit the leaves reachable from the box, with the constraints of their paths
+template<typename FVisit>
+void VisitReachable(const RegTree& tree, int nid, const std::vector<bst_float>& x,
+                    bst_float eps, std::vector<FeatureInterval>* path,
+                    FVisit& visit) {  // NOLINT(*)
+  const RegTree::Node& node = tree[nid];
+  if (node.IsLeaf()) {
+    visit(*path, node.LeafValue());
+    return;
+  }
+  const unsigned fid = node.SplitIndex();
+  const bst_float fvalue = fid < x.size() ? x[fid] : std::numeric_limits<bst_float>::quiet_NaN();
+  if (std::isnan(fvalue)) {
+    VisitReachable(tree, node.DefaultChild(), x, eps, path, visit);
+    return;
+  }
+  const bst_float split = node.SplitCond();
+  size_t pos = 0;
+  while (pos < path->size() && (*path)[pos].fid != fid) ++pos;
+  const bool found = pos != path->size();
+  FeatureInterval cur;
+  if (found) {
+    cur = (*path)[pos];
+  } else {
+    cur.fid = fid;
+    cur.lo = fvalue - eps;
+    cur.hi = std::nextafter(fvalue + eps, std::numeric_limits<bst_float>::infinity());
+    path->push_back(cur);
+  }
+  if (cur.lo < split) {
+    (*path)[pos] = cur;
+    (*path)[pos].hi = std::min(cur.hi, split);
+    VisitReachable(tree, node.LeftChild(), x, eps, path, visit);
+  }
+  if (cur.hi > split) {
+    (*path)[pos] = cur;
+    (*path)[pos].lo = std::max(cur.lo, split);
+    VisitReachable(tree, node.RightChild(), x, eps, path, visit);
+  }
+  if (found) {
+    (*path)[pos] = cur;
+  } else {
+    path->pop_back();
+  }
+}
+
+// distance from x to the values [lo, hi) of a feature
+inline double IntervalDistance(bst_float x, bst_float lo, bst_float hi) {
+  if (x < lo) return static_cast<double>(lo) - x;
+  if (x >= hi) return static_cast<double>(x) - hi;
+  return 0.0;
+}
+
+// all compatible pairs of regions of a and b that pass keep, false if more than cap
+template<typename FKeep>
+bool MergeRegions(const std::vector<LeafRegion>& a, const std::vector<LeafRegion>& b,
+                  size_t cap, FKeep keep, std::vector<LeafRegion>* out) {
+  out->clear();
+  LeafRegion region;
+  for (const LeafRegion& ra : a) {
+    for (const LeafRegion& rb : b) {
+      if (!RobustVerifier::Intersect(ra.box, rb.box, &region.box)) continue;
+      if (!keep(region)) continue;
+      region.value = ra.value + rb.value;
+      out->push_back(region);
+      if (out->size() > cap) return false;
+    }
+  }
+  return true;
+}
+
+inline bst_float MinValue(const std::vector<LeafRegion>& regions) {
+  bst_float ret = std::numeric_limits<bst_float>::max();
+  for (const LeafRegion& r : regions) ret = std::min(ret, r.value);
+  return ret;
+}
+
+// the regions reachable at a radius eps no larger than that of from, clipped
+// by the box of eps as VisitReachable clips them, in the same order
+void ShrinkRegions(const std::vector<LeafRegion>& from, const std::vector<bst_float>& x,
+                   bst_float eps, bst_float sign, std::vector<LeafRegion>* out) {
+  out->clear();
+  LeafRegion region;
+  for (const LeafRegion& r : from) {
+    region.box = r.box;
+    bool ok = true;
+    for (FeatureInterval& v : region.box) {
+      const bst_float fvalue = x[v.fid];
+      v.lo = std::max(v.lo, fvalue - eps);
+      v.hi = std::min(v.hi, std::nextafter(fvalue + eps,
+                                           std::numeric_limits<bst_float>::infinity()));
+      if (!(v.lo < v.hi)) {
+        ok = false; break;
+      }
+    }
+    if (!ok) continue;
+    region.value = sign * r.value;
+    out->push_back(region);
+  }
+}
+
+inline bool IsRobust(int status) {
+  return status == kVerifiedRobust || status == kSearchedRobust;
+}
+}  // namespace
+
+uint64_t VerifySummary::TreeHash(const RegTree& tree) {
+  // FNV-1a over the structure and the values of the nodes
+  uint64_t hash = 14695981039346656037ULL;
+  auto mix = [&hash](uint64_t v) {
+    hash ^= v;
+    hash *= 1099511628211ULL;
+  };
+  for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+    const RegTree::Node& node = tree[nid];
+    const bst_float value = node.IsLeaf() ? node.LeafValue() : node.SplitCond();
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    mix(static_cast<uint32_t>(node.LeftChild()));
+    mix(static_cast<uint32_t>(node.RightChild()));
+    mix(node.IsLeaf() ? 0U : (node.SplitIndex() << 1) | (node.DefaultLeft() ? 1U : 0U));
+    mix(bits);
+  }
+  return hash;
+}
+
+void RobustVerifier::Configure(
+    const std::vector<std::pair<std::string, std::string> >& cfg) {
+  param_.InitAllowUnknown(cfg);
+  // without verify_eps, verify at the radius the model was trained for
+  bool has_eps = false;
+  for (const auto& kv : cfg) has_eps = has_eps || kv.first == "verify_eps";
+  for (const auto& kv : cfg) {
+    if (!has_eps && kv.first == "robust_eps") {
+      param_.verify_eps = static_cast<float>(std::stod(kv.second));
+    }
+  }
+}
+
+bool RobustVerifier::InBall(const std::vector<FeatureInterval>& box,
+                            const std::vector<bst_float>& x, bst_float eps) const {
+  // the regions are inside the L-inf box of radius eps
+  if (param_.verify_norm == kNormInf) return true;
+  const double budget = this->NormTerm(eps);
+  double dist = 0.0;
+  for (const FeatureInterval& v : box) {
+    dist += this->NormTerm(IntervalDistance(x[v.fid], v.lo, v.hi));
+    if (dist > budget) return false;
+  }
+  return true;
+}
+
+void RobustVerifier::ReachableLeaves(const RegTree& tree, unsigned root,
+                                     const std::vector<bst_float>& x, bst_float eps,
+                                     bst_float sign, std::vector<LeafRegion>* out) {
+  std::vector<FeatureInterval> path;
+  auto visit = [sign, out](const std::vector<FeatureInterval>& box, bst_float value) {
+    LeafRegion region;
+    region.box = box;
+    std::sort(region.box.begin(), region.box.end(),
+              [](const FeatureInterval& a, const FeatureInterval& b) {
+                return a.fid < b.fid;
+              });
+    region.value = sign * value;
+    out->push_back(std::move(region));
+  };
+  VisitReachable(tree, static_cast<int>(root), x, eps, &path, visit);
+}
+
+void RobustVerifier::ReachableRange(const RegTree& tree, unsigned root,
+                                    const std::vector<bst_float>& x, bst_float eps,
+                                    std::vector<FeatureInterval>* path,
+                                    bst_float* out_min, bst_float* out_max) {
+  bst_float vmin = std::numeric_limits<bst_float>::max();
+  bst_float vmax = -std::numeric_limits<bst_float>::max();
+  auto visit = [&vmin, &vmax](const std::vector<FeatureInterval>&, bst_float value) {
+    vmin = std::min(vmin, value);
+    vmax = std::max(vmax, value);
+  };
+  path->clear();
+  VisitReachable(tree, static_cast<int>(root), x, eps, path, visit);
+  *out_min = vmin;
+  *out_max = vmax;
+}
+
+bst_float RobustVerifier::PointOutput(const RegTree& tree, unsigned root,
+                                      const std::vector<bst_float>& x) {
+  int nid = static_cast<int>(root);
+  while (!tree[nid].IsLeaf()) {
+    const unsigned fid = tree[nid].SplitIndex();
+    const bst_float fvalue = fid < x.size() ? x[fid] : std::numeric_limits<bst_float>::quiet_NaN();
+    nid = tree.GetNext(nid, fvalue, std::isnan(fvalue));
+  }
+  return tree[nid].LeafValue();
+}
+
+bool RobustVerifier::Intersect(const std::vector<FeatureInterval>& a,
+                               const std::vector<FeatureInterval>& b,
+                               std::vector<FeatureInterval>* out) {
+  out->clear();
+  size_t i = 0, j = 0;
+  while (i < a.size() || j < b.size()) {
+    if (j == b.size() || (i < a.size() && a[i].fid < b[j].fid)) {
+      out->push_back(a[i++]);
+    } else if (i == a.size() || b[j].fid < a[i].fid) {
+      out->push_back(b[j++]);
+    } else {
+      FeatureInterval v;
+      v.fid = a[i].fid;
+      v.lo = std::max(a[i].lo, b[j].lo);
+      v.hi = std::min(a[i].hi, b[j].hi);
+      if (!(v.lo < v.hi)) return false;
+      out->push_back(v);
+      ++i; ++j;
+    }
+  }
+  return true;
+}
+
+bst_float RobustVerifier::CliqueBound(Workspace* ws, bst_float constant,
+                                      bool* exact) const {
+  std::vector<std::vector<LeafRegion> >& groups = ws->groups;
+  groups = ws->leaves;
+  auto sum_min = [&]() {
+    double sum = constant;
+    for (const auto& g : groups) sum += MinValue(g);
+    return static_cast<bst_float>(sum);
+  };
+  const size_t clique = static_cast<size_t>(param_.verify_clique_size);
+  const size_t cap = static_cast<size_t>(param_.verify_max_regions);
+  bst_float bound = sum_min();
+  std::vector<std::vector<LeafRegion> > next;
+  std::vector<LeafRegion> merged, tmp;
+  auto keep = [this, ws](const LeafRegion& r) { return this->InBall(r.box, ws->x, ws->eps); };
+  while (bound <= 0.0f && groups.size() > 1) {
+    next.clear();
+    bool progress = false;
+    for (size_t i = 0; i < groups.size(); i += clique) {
+      const size_t end = std::min(i + clique, groups.size());
+      bool ok = end - i > 1;
+      merged = groups[i];
+      for (size_t j = i + 1; ok && j < end; ++j) {
+        ok = MergeRegions(merged, groups[j], cap, keep, &tmp);
+        merged.swap(tmp);
+      }
+      if (ok) {
+        next.push_back(std::move(merged));
+        progress = true;
+      } else {
+        for (size_t j = i; j < end; ++j) next.push_back(std::move(groups[j]));
+      }
+    }
+    groups.swap(next);
+    if (!progress) break;
+    bound = std::max(bound, sum_min());
+  }
+  *exact = groups.size() == 1;
+  return bound;
+}
+
+bool RobustVerifier::SearchTree(Workspace* ws, size_t t, bst_float partial) const {
+  if (partial + ws->suffix[t] > 0.0f) return false;
+  if (t == ws->order.size()) return true;
+  for (const LeafRegion& r : ws->leaves[ws->order[t]]) {
+    // regions are sorted by value, the remaining ones cannot reach 0
+    if (partial + r.value + ws->suffix[t + 1] > 0.0f) break;
+    if (++ws->nodes > param_.verify_max_nodes) return false;
+    bool ok = true;
+    for (const FeatureInterval& v : r.box) {
+      if (!(std::max(ws->lo[v.fid], v.lo) < std::min(ws->hi[v.fid], v.hi))) {
+        ok = false; break;
+      }
+    }
+    if (!ok) continue;
+    const double dist = ws->dist;
+    if (param_.verify_norm != kNormInf) {
+      // the l1 / l2 distance only grows as the box shrinks
+      double next = dist;
+      for (const FeatureInterval& v : r.box) {
+        const bst_float x = ws->x[v.fid];
+        next += this->NormTerm(IntervalDistance(x, std::max(ws->lo[v.fid], v.lo),
+                                                std::min(ws->hi[v.fid], v.hi)))
+            - this->NormTerm(IntervalDistance(x, ws->lo[v.fid], ws->hi[v.fid]));
+      }
+      if (next > this->NormTerm(ws->eps)) continue;
+      ws->dist = next;
+    }
+    const size_t mark = ws->undo.size();
+    for (const FeatureInterval& v : r.box) {
+      ws->undo.push_back({v.fid, ws->lo[v.fid], ws->hi[v.fid]});
+      ws->lo[v.fid] = std::max(ws->lo[v.fid], v.lo);
+      ws->hi[v.fid] = std::min(ws->hi[v.fid], v.hi);
+    }
+    const bool found = this->SearchTree(ws, t + 1, partial + r.value);
+    while (ws->undo.size() > mark) {
+      const FeatureInterval& v = ws->undo.back();
+      ws->lo[v.fid] = v.lo;
+      ws->hi[v.fid] = v.hi;
+      ws->undo.pop_back();
+    }
+    ws->dist = dist;
+    if (found) return true;
+    if (ws->nodes > param_.verify_max_nodes) return false;
+  }
+  return false;
+}
+
+int RobustVerifier::Search(Workspace* ws, bst_float constant) const {
+  const size_t ntree = ws->leaves.size();
+  for (auto& regions : ws->leaves) {
+    std::sort(regions.begin(), regions.end(),
+              [](const LeafRegion& a, const LeafRegion& b) { return a.value < b.value; });
+  }
+  // branch on the trees with the widest output range first
+  ws->order.resize(ntree);
+  for (size_t t = 0; t < ntree; ++t) ws->order[t] = t;
+  std::sort(ws->order.begin(), ws->order.end(), [ws](size_t a, size_t b) {
+      const auto& ra = ws->leaves[a];
+      const auto& rb = ws->leaves[b];
+      return ra.back().value - ra.front().value > rb.back().value - rb.front().value;
+    });
+  ws->suffix.assign(ntree + 1, 0.0f);
+  for (size_t t = ntree; t != 0; --t) {
+    ws->suffix[t - 1] = ws->suffix[t] + ws->leaves[ws->order[t - 1]].front().value;
+  }
+  ws->lo.assign(ws->x.size(), -std::numeric_limits<bst_float>::infinity());
+  ws->hi.assign(ws->x.size(), std::numeric_limits<bst_float>::infinity());
+  ws->undo.clear();
+  ws->nodes = 0;
+  ws->dist = 0.0;
+  if (this->SearchTree(ws, 0, constant)) return kVulnerable;
+  return ws->nodes > param_.verify_max_nodes ? kUnknown : kSearchedRobust;
+}
+
+size_t RobustVerifier::PrepareSummary(const DMatrix& fmat, size_t ntree,
+                                      VerifySummary* summary) const {
+  const size_t num_row = fmat.Info().num_row_;
+  const int ngroup = model_.param.num_output_group;
+  bool extends = summary->num_row_ == num_row && summary->num_group_ == ngroup &&
+      summary->eps_ == param_.verify_eps && summary->dense_ == param_.verify_dense &&
+      summary->tree_hash_.size() <= ntree;
+  for (size_t t = 0; extends && t < summary->tree_hash_.size(); ++t) {
+    extends = summary->tree_hash_[t] == VerifySummary::TreeHash(*model_.trees[t]);
+  }
+  if (!extends) {
+    summary->Clear();
+    summary->num_row_ = num_row;
+    summary->num_group_ = ngroup;
+    summary->eps_ = param_.verify_eps;
+    summary->dense_ = param_.verify_dense;
+    summary->clean_.resize(num_row * ngroup);
+    summary->min_sum_.resize(num_row * ngroup);
+    summary->max_sum_.resize(num_row * ngroup);
+  }
+  const size_t tree_begin = summary->tree_hash_.size();
+  for (size_t t = tree_begin; t < ntree; ++t) {
+    summary->tree_hash_.push_back(VerifySummary::TreeHash(*model_.trees[t]));
+  }
+  return tree_begin;
+}
+
+int RobustVerifier::VerifyObjective(
+    Workspace* ws, unsigned root,
+    const std::vector<std::pair<const RegTree*, bst_float> >& trees,
+    bst_float constant, bst_float* bound) const {
+  ws->leaves.resize(trees.size());
+  for (size_t t = 0; t < trees.size(); ++t) {
+    ws->leaves[t].clear();
+    ReachableLeaves(*trees[t].first, root, ws->x, ws->eps,
+                    trees[t].second, &ws->leaves[t]);
+  }
+  return this->DecideObjective(ws, constant, bound);
+}
+
+int RobustVerifier::VerifyCached(Workspace* ws,
+                                 const std::vector<std::pair<size_t, bst_float> >& trees,
+                                 bst_float constant, bst_float eps) const {
+  ws->eps = eps;
+  ws->leaves.resize(trees.size());
+  for (size_t t = 0; t < trees.size(); ++t) {
+    ShrinkRegions(ws->cache[trees[t].first], ws->x, eps, trees[t].second, &ws->leaves[t]);
+  }
+  bst_float bound;
+  return this->DecideObjective(ws, constant, &bound);
+}
+
+int RobustVerifier::DecideObjective(Workspace* ws, bst_float constant,
+                                    bst_float* bound) const {
+  if (param_.verify_norm != kNormInf) {
+    // the leaf of x is always kept, its distance is 0
+    for (std::vector<LeafRegion>& leaves : ws->leaves) {
+      leaves.erase(std::remove_if(leaves.begin(), leaves.end(), [this, ws](const LeafRegion& r) {
+            return !this->InBall(r.box, ws->x, ws->eps);
+          }), leaves.end());
+    }
+  }
+  bool exact;
+  *bound = this->CliqueBound(ws, constant, &exact);
+  if (*bound > 0.0f) return kVerifiedRobust;
+  // every region of a fully merged group is reachable, the bound is attained
+  if (exact) return kVulnerable;
+  if (param_.verify_max_nodes == 0) return kUnknown;
+  const int status = this->Search(ws, constant);
+  if (status == kSearchedRobust) *bound = 0.0f;
+  return status;
+}
+
+void RobustVerifier::Verify(DMatrix* p_fmat, std::vector<int>* out_status,
+                            std::vector<bst_float>* out_bound, VerifySummary* summary) {
+  const MetaInfo& info = p_fmat->Info();
+  CHECK_EQ(info.labels_.size(), info.num_row_)
+      << "verification needs the labels of the test points";
+  const int ngroup = model_.param.num_output_group;
+  size_t ntree = static_cast<size_t>(param_.ntree_limit) * ngroup;
+  if (ntree == 0 || ntree > model_.trees.size()) ntree = model_.trees.size();
+  std::vector<std::vector<const RegTree*> > group_trees(ngroup);
+  for (size_t i = 0; i < ntree; ++i) {
+    group_trees[model_.tree_info[i]].push_back(model_.trees[i].get());
+  }
+  if (ngroup != 1) {
+    for (bst_float label : info.labels_) {
+      CHECK(label >= 0.0f && label < ngroup)
+          << "label must be in [0, num_class), label=" << label;
+    }
+  }
+  const size_t nfeature = std::max(static_cast<size_t>(model_.param.num_feature),
+                                   static_cast<size_t>(info.num_col_));
+  const bst_float kMissing = param_.verify_dense
+      ? 0.0f : std::numeric_limits<bst_float>::quiet_NaN();
+  out_status->resize(info.num_row_);
+  out_bound->resize(info.num_row_);
+  const size_t tree_begin =
+      summary != nullptr ? this->PrepareSummary(*p_fmat, ntree, summary) : 0;
+  std::vector<Workspace> workspace(omp_get_max_threads());
+  auto iter = p_fmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    auto &batch = iter->Value();
+    const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+    #pragma omp parallel for schedule(dynamic)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      Workspace& ws = workspace[omp_get_thread_num()];
+      const size_t ridx = static_cast<size_t>(batch.base_rowid + i);
+      const unsigned root = info.GetRoot(ridx);
+      SparsePage::Inst inst = batch[i];
+      ws.x.assign(nfeature, kMissing);
+      for (bst_uint j = 0; j < inst.length; ++j) {
+        if (inst[j].index < nfeature) ws.x[inst[j].index] = inst[j].fvalue;
+      }
+      ws.eps = param_.verify_eps;
+      // margin of each output group at the unperturbed point
+      std::vector<bst_float> margin(ngroup);
+      for (int k = 0; k < ngroup; ++k) {
+        margin[k] = info.base_margin_.size() != 0
+            ? info.base_margin_[ridx * ngroup + k] : model_.base_margin;
+      }
+      std::vector<bst_float> clean(margin);
+      // the sums of the reachable leaf ranges start from the margins, as the
+      // clique bound does, and are only valid with a summary
+      double* min_sum = nullptr;
+      double* max_sum = nullptr;
+      if (summary == nullptr) {
+        for (int k = 0; k < ngroup; ++k) {
+          for (const RegTree* tree : group_trees[k]) {
+            clean[k] += PointOutput(*tree, root, ws.x);
+          }
+        }
+      } else {
+        bst_float* sum = dmlc::BeginPtr(summary->clean_) + ridx * ngroup;
+        min_sum = dmlc::BeginPtr(summary->min_sum_) + ridx * ngroup;
+        max_sum = dmlc::BeginPtr(summary->max_sum_) + ridx * ngroup;
+        if (tree_begin == 0) {
+          for (int k = 0; k < ngroup; ++k) {
+            sum[k] = margin[k];
+            min_sum[k] = max_sum[k] = margin[k];
+          }
+        }
+        // each group adds its trees in their order, as group_trees holds them,
+        // so that the outputs are those without a summary
+        for (size_t t = tree_begin; t < ntree; ++t) {
+          const RegTree& tree = *model_.trees[t];
+          const int k = model_.tree_info[t];
+          sum[k] += PointOutput(tree, root, ws.x);
+          bst_float vmin, vmax;
+          ReachableRange(tree, root, ws.x, param_.verify_eps, &ws.path, &vmin, &vmax);
+          min_sum[k] += vmin;
+          max_sum[k] += vmax;
+        }
+        std::copy(sum, sum + ngroup, clean.begin());
+      }
+      std::vector<std::pair<const RegTree*, bst_float> > trees;
+      int status = kVerifiedRobust;
+      bst_float bound = std::numeric_limits<bst_float>::max();
+      if (ngroup == 1) {
+        const bst_float sign = info.labels_[ridx] > 0.5f ? 1.0f : -1.0f;
+        // the first level of the clique bound, the leaf regions are not needed
+        const bst_float range_bound = min_sum == nullptr ? 0.0f :
+            static_cast<bst_float>(sign > 0.0f ? min_sum[0] : -max_sum[0]);
+        if (sign * clean[0] <= 0.0f) {
+          status = kMisclassified;
+          bound = sign * clean[0];
+        } else if (range_bound > 0.0f) {
+          bound = range_bound;
+        } else {
+          for (const RegTree* tree : group_trees[0]) trees.emplace_back(tree, sign);
+          status = this->VerifyObjective(&ws, root, trees, sign * margin[0], &bound);
+        }
+      } else {
+        const int label = static_cast<int>(info.labels_[ridx]);
+        for (int k = 0; k < ngroup; ++k) {
+          if (k != label && clean[label] - clean[k] <= 0.0f) {
+            status = kMisclassified;
+            bound = std::min(bound, clean[label] - clean[k]);
+          }
+        }
+        if (min_sum != nullptr && status != kMisclassified) {
+          for (int k = 0; k < ngroup; ++k) {
+            if (k == label) continue;
+            bound = std::min(bound, static_cast<bst_float>(min_sum[label] - max_sum[k]));
+          }
+          if (bound > 0.0f) {
+            (*out_status)[ridx] = status;
+            (*out_bound)[ridx] = bound;
+            continue;
+          }
+          bound = std::numeric_limits<bst_float>::max();
+        }
+        for (int k = 0; k < ngroup && status != kMisclassified; ++k) {
+          if (k == label) continue;
+          trees.clear();
+          for (const RegTree* tree : group_trees[label]) trees.emplace_back(tree, 1.0f);
+          for (const RegTree* tree : group_trees[k]) trees.emplace_back(tree, -1.0f);
+          bst_float b;
+          const int s = this->VerifyObjective(&ws, root, trees, margin[label] - margin[k], &b);
+          bound = std::min(bound, b);
+          if (Severity(s) > Severity(status)) status = s;
+          if (status == kVulnerable) break;
+        }
+      }
+      (*out_status)[ridx] = status;
+      (*out_bound)[ridx] = bound;
+    }
+  }
+}
+
+void RobustVerifier::SearchRadius(DMatrix* p_fmat, const std::vector<bst_float>& upper,
+                                  std::vector<bst_float>* out_lower,
+                                  std::vector<bst_float>* out_upper) {
+  const MetaInfo& info = p_fmat->Info();
+  CHECK_EQ(info.labels_.size(), info.num_row_)
+      << "verification needs the labels of the test points";
+  CHECK_EQ(upper.size(), info.num_row_) << "one upper radius per row is needed";
+  const int ngroup = model_.param.num_output_group;
+  size_t ntree = static_cast<size_t>(param_.ntree_limit) * ngroup;
+  if (ntree == 0 || ntree > model_.trees.size()) ntree = model_.trees.size();
+  std::vector<std::vector<size_t> > group_trees(ngroup);
+  for (size_t i = 0; i < ntree; ++i) {
+    group_trees[model_.tree_info[i]].push_back(i);
+  }
+  if (ngroup != 1) {
+    for (bst_float label : info.labels_) {
+      CHECK(label >= 0.0f && label < ngroup)
+          << "label must be in [0, num_class), label=" << label;
+    }
+  }
+  const size_t nfeature = std::max(static_cast<size_t>(model_.param.num_feature),
+                                   static_cast<size_t>(info.num_col_));
+  const bst_float kMissing = param_.verify_dense
+      ? 0.0f : std::numeric_limits<bst_float>::quiet_NaN();
+  out_lower->resize(info.num_row_);
+  out_upper->resize(info.num_row_);
+  std::vector<Workspace> workspace(omp_get_max_threads());
+  auto iter = p_fmat->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) {
+    auto &batch = iter->Value();
+    const auto nsize = static_cast<bst_omp_uint>(batch.Size());
+    #pragma omp parallel for schedule(dynamic)
+    for (bst_omp_uint i = 0; i < nsize; ++i) {
+      Workspace& ws = workspace[omp_get_thread_num()];
+      const size_t ridx = static_cast<size_t>(batch.base_rowid + i);
+      const unsigned root = info.GetRoot(ridx);
+      SparsePage::Inst inst = batch[i];
+      ws.x.assign(nfeature, kMissing);
+      for (bst_uint j = 0; j < inst.length; ++j) {
+        if (inst[j].index < nfeature) ws.x[inst[j].index] = inst[j].fvalue;
+      }
+      std::vector<bst_float> margin(ngroup);
+      for (int k = 0; k < ngroup; ++k) {
+        margin[k] = info.base_margin_.size() != 0
+            ? info.base_margin_[ridx * ngroup + k] : model_.base_margin;
+      }
+      std::vector<bst_float> clean(margin);
+      for (int k = 0; k < ngroup; ++k) {
+        for (size_t t : group_trees[k]) clean[k] += PointOutput(*model_.trees[t], root, ws.x);
+      }
+      const int label = ngroup == 1 ? 0 : static_cast<int>(info.labels_[ridx]);
+      const bst_float sign = ngroup != 1 || info.labels_[ridx] > 0.5f ? 1.0f : -1.0f;
+      bool misclassified = ngroup == 1 && sign * clean[0] <= 0.0f;
+      for (int k = 0; ngroup != 1 && k < ngroup; ++k) {
+        if (k != label && clean[label] - clean[k] <= 0.0f) misclassified = true;
+      }
+      if (misclassified) {
+        (*out_lower)[ridx] = 0.0f;
+        (*out_upper)[ridx] = 0.0f;
+        continue;
+      }
+      bst_float best = std::numeric_limits<bst_float>::infinity();
+      bst_float hi = param_.verify_eps;
+      if (upper[ridx] >= 0.0f) {
+        best = upper[ridx];
+        hi = std::min(hi, best);
+      }
+      ws.cache.resize(ntree);
+      for (size_t t = 0; t < ntree; ++t) {
+        ws.cache[t].clear();
+        ReachableLeaves(*model_.trees[t], root, ws.x, hi, 1.0f, &ws.cache[t]);
+      }
+      // the most severe status over the class pairs at radius eps
+      std::vector<std::pair<size_t, bst_float> > trees;
+      auto certify = [&](bst_float eps) -> int {
+        if (ngroup == 1) {
+          trees.clear();
+          for (size_t t : group_trees[0]) trees.emplace_back(t, sign);
+          return this->VerifyCached(&ws, trees, sign * margin[0], eps);
+        }
+        int status = kVerifiedRobust;
+        for (int k = 0; k < ngroup && status != kVulnerable; ++k) {
+          if (k == label) continue;
+          trees.clear();
+          for (size_t t : group_trees[label]) trees.emplace_back(t, 1.0f);
+          for (size_t t : group_trees[k]) trees.emplace_back(t, -1.0f);
+          const int s = this->VerifyCached(&ws, trees, margin[label] - margin[k], eps);
+          if (Severity(s) > Severity(status)) status = s;
+        }
+        return status;
+      };
+      // robustness only shrinks as the radius grows: lo is certified, hi is
+      // not once the upper end is tried
+      bst_float lo = 0.0f;
+      int status = hi > 0.0f ? certify(hi) : kVerifiedRobust;
+      if (IsRobust(status)) {
+        lo = hi;
+      } else {
+        if (status == kVulnerable) best = std::min(best, hi);
+        while (hi - lo > param_.verify_radius_tol) {
+          const bst_float mid = lo + 0.5f * (hi - lo);
+          if (!(mid > lo && mid < hi)) break;
+          status = certify(mid);
+          if (IsRobust(status)) {
+            lo = mid;
+          } else {
+            if (status == kVulnerable) best = std::min(best, mid);
+            hi = mid;
+          }
+        }
+      }
+      (*out_lower)[ridx] = lo;
+      (*out_upper)[ridx] = best;
+    }
+  }
+}
+
+}  // namespace robust
+}  // namespace xgboost
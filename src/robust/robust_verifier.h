@@ -0,0 +1,290 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file robust_verifier.h
+ * \brief certified L-inf robustness verification of tree ensembles.
+ *
+ *  For every test point the verifier answers whether some point within
+ *  L-inf distance verify_eps changes the predicted class. Cheap lower bounds
+ *  of the worst-case margin are computed first: the leaves of every tree
+ *  reachable from the perturbation box, then cliques of trees whose leaf
+ *  regions are merged level by level. Only points that the bounds cannot
+ *  decide go through an exact branch-and-bound search over leaf combinations.
+ *
+ *  The checkpoints of a model are prefixes of each other. A VerifySummary
+ *  kept between their verifications holds the sums of the reachable leaf
+ *  ranges of the trees at each point, so that each verification only walks
+ *  the trees added since the previous one before trying the cheapest bound.
+ *
+ *  The largest certified radius of a point is bisected between 0 and an upper
+ *  bound, e.g. the distortion found by RobustAttack. The leaf regions
+ *  reachable at a radius contain those of every smaller radius, so they are
+ *  collected once at the upper end and only clipped at each step.
+ */
+#ifndef XGBOOST_ROBUST_ROBUST_VERIFIER_H_
+#define XGBOOST_ROBUST_ROBUST_VERIFIER_H_
+
+#include <dmlc/parameter.h>
+#include <xgboost/data.h>
+#include <xgboost/tree_model.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../gbm/gbtree_model.h"
+
+namespace xgboost {
+namespace robust {
+
+/*! \brief norm of the perturbation */
+enum VerifyNorm : int {
+  kNormInf = 0,
+  kNormL1 = 1,
+  kNormL2 = 2
+};
+
+/*! \brief parameters of the robustness verifier */
+struct VerifierParam : public dmlc::Parameter<VerifierParam> {
+  /*! \brief radius of the perturbation */
+  float verify_eps;
+  /*! \brief norm of the perturbation, a VerifyNorm */
+  int verify_norm;
+  /*! \brief number of groups merged into one at each level of the bound */
+  int verify_clique_size;
+  /*! \brief maximum number of leaf regions of a merged group */
+  int verify_max_regions;
+  /*! \brief maximum number of search nodes per point and class pair */
+  int verify_max_nodes;
+  /*! \brief whether absent features are treated as value 0 instead of missing */
+  bool verify_dense;
+  /*! \brief limit number of trees used in verification, 0 means all trees */
+  int ntree_limit;
+  /*! \brief width of the radius interval at which the radius search stops */
+  float verify_radius_tol;
+  // declare parameters
+  DMLC_DECLARE_PARAMETER(VerifierParam) {
+    DMLC_DECLARE_FIELD(verify_eps).set_default(0.0f).set_lower_bound(0.0f)
+        .describe("Radius of the adversarial perturbation, robust_eps if not set.");
+    DMLC_DECLARE_FIELD(verify_norm).set_default(kNormInf)
+        .add_enum("inf", kNormInf)
+        .add_enum("l1", kNormL1)
+        .add_enum("l2", kNormL2)
+        .describe("Norm of the perturbation. The bounds use the L-inf box of "
+                  "radius verify_eps, which contains the l1 and l2 balls, and "
+                  "drop the leaf regions outside the ball.");
+    DMLC_DECLARE_FIELD(verify_clique_size).set_default(2).set_lower_bound(2)
+        .describe("Number of groups of trees merged into one at each level "
+                  "of the clique bound.");
+    DMLC_DECLARE_FIELD(verify_max_regions).set_default(4096).set_lower_bound(1)
+        .describe("Maximum number of leaf regions of a merged group, larger "
+                  "groups are left unmerged.");
+    DMLC_DECLARE_FIELD(verify_max_nodes).set_default(1000000).set_lower_bound(0)
+        .describe("Maximum number of branch-and-bound nodes per point and class "
+                  "pair, 0 disables the exact search.");
+    DMLC_DECLARE_FIELD(verify_dense).set_default(true)
+        .describe("Treat absent features as value 0, as the dense arrays of "
+                  "xgbKantchelianAttack.py do. Otherwise absent features stay "
+                  "missing and follow the default directions.");
+    DMLC_DECLARE_FIELD(ntree_limit).set_default(0).set_lower_bound(0)
+        .describe("Number of trees used for verification, 0 means use all trees.");
+    DMLC_DECLARE_FIELD(verify_radius_tol).set_default(1e-3f).set_lower_bound(0.0f)
+        .describe("The radius search stops when the certified radius and the "
+                  "smallest radius not certified are within verify_radius_tol.");
+  }
+};
+
+/*! \brief verification outcome of a point */
+enum VerifyStatus : int {
+  /*! \brief robust, certified by the clique bound */
+  kVerifiedRobust = 0,
+  /*! \brief robust, proven by the exact search */
+  kSearchedRobust = 1,
+  /*! \brief an adversarial point exists within the radius */
+  kVulnerable = 2,
+  /*! \brief the search budget ran out before a decision */
+  kUnknown = 3,
+  /*! \brief the unperturbed point is already misclassified */
+  kMisclassified = 4
+};
+
+/*! \return printable name of a verification status */
+const char* VerifyStatusName(int status);
+
+/*! \brief constraint of a region on one feature, values in [lo, hi) */
+struct FeatureInterval {
+  bst_uint fid;
+  bst_float lo;
+  bst_float hi;
+};
+
+/*!
+ * \brief a part of the perturbation box with a constant output.
+ *  box is sorted by fid, features not in box are only bounded by the radius.
+ */
+struct LeafRegion {
+  std::vector<FeatureInterval> box;
+  bst_float value;
+};
+
+/*!
+ * \brief the output at the point and the sums of the smallest and the
+ *  largest reachable leaf values of the first trees of a model at each row
+ *  of a matrix, see RobustVerifier::Verify. The caller keeps one per matrix.
+ */
+class VerifySummary {
+ public:
+  /*! \brief forget all the trees */
+  void Clear() {
+    tree_hash_.clear();
+    clean_.clear();
+    min_sum_.clear();
+    max_sum_.clear();
+  }
+  /*! \return number of trees summarised */
+  size_t NumTrees() const {
+    return tree_hash_.size();
+  }
+  /*! \brief fingerprint of the nodes of a tree */
+  static uint64_t TreeHash(const RegTree& tree);
+
+ private:
+  friend class RobustVerifier;
+  /*! \brief fingerprint of each tree summarised, to check the model is an extension */
+  std::vector<uint64_t> tree_hash_;
+  size_t num_row_{0};
+  int num_group_{0};
+  bst_float eps_{0.0f};
+  bool dense_{true};
+  /*! \brief num_row * num_group output of the trees at the point */
+  std::vector<bst_float> clean_;
+  /*! \brief num_row * num_group sums of the smallest, the largest reachable leaf value */
+  std::vector<double> min_sum_, max_sum_;
+};
+
+/*! \brief verifier of a gbtree model */
+class RobustVerifier {
+ public:
+  explicit RobustVerifier(const gbm::GBTreeModel& model) : model_(model) {
+    CHECK_EQ(model.param.size_leaf_vector, 0)
+        << "robustness verification does not support trees of vector leaves";
+  }
+  /*! \brief set the verifier parameters */
+  void Configure(const std::vector<std::pair<std::string, std::string> >& cfg);
+  /*! \brief the verifier parameters */
+  const VerifierParam& Param() const {
+    return param_;
+  }
+  /*!
+   * \brief verify every row of a matrix.
+   * \param p_fmat the test points, labels are the true classes
+   * \param out_status the VerifyStatus of each row
+   * \param out_bound certified lower bound of the worst-case margin of the
+   *   true class over any other class, or the margin of the unperturbed point
+   *   for misclassified rows
+   * \param summary optional summary of the trees at the rows of p_fmat. It is
+   *   extended with the trees added since the previous call, or rebuilt when
+   *   the model is not an extension of the trees summarised. The rows whose
+   *   sums of reachable leaf ranges decide robustness do not walk the other
+   *   trees again; their bound is that of the L-inf box for every norm.
+   */
+  void Verify(DMatrix* p_fmat, std::vector<int>* out_status,
+              std::vector<bst_float>* out_bound, VerifySummary* summary = nullptr);
+  /*!
+   * \brief bisect the largest radius, at most verify_eps, certified robust at
+   *  every row of a matrix.
+   * \param p_fmat the test points, labels are the true classes
+   * \param upper radius of an adversarial example of each row, e.g. the
+   *   distortion of RobustAttack, or -1 if none is known
+   * \param out_lower radius certified at each row, 0 for misclassified rows
+   * \param out_upper radius of an adversarial example at each row, the smaller
+   *   of upper and the radii the exact search found vulnerable, infinity if
+   *   none is known
+   */
+  void SearchRadius(DMatrix* p_fmat, const std::vector<bst_float>& upper,
+                    std::vector<bst_float>* out_lower, std::vector<bst_float>* out_upper);
+  /*!
+   * \brief collect the leaves of a tree reachable from the box of radius eps
+   *  around x, missing features are NaN and follow the default directions.
+   * \param sign factor applied to the leaf values
+   */
+  static void ReachableLeaves(const RegTree& tree, unsigned root,
+                              const std::vector<bst_float>& x, bst_float eps,
+                              bst_float sign, std::vector<LeafRegion>* out);
+  /*!
+   * \brief range of the leaf values reachable from the box of radius eps
+   *  around x, without materializing the leaf regions.
+   * \param path buffer for the constraints of the current path
+   */
+  static void ReachableRange(const RegTree& tree, unsigned root,
+                             const std::vector<bst_float>& x, bst_float eps,
+                             std::vector<FeatureInterval>* path,
+                             bst_float* out_min, bst_float* out_max);
+  /*! \brief output of a tree at x, missing features are NaN */
+  static bst_float PointOutput(const RegTree& tree, unsigned root,
+                               const std::vector<bst_float>& x);
+  /*!
+   * \brief intersect two sorted boxes.
+   * \return false if the intersection is empty
+   */
+  static bool Intersect(const std::vector<FeatureInterval>& a,
+                        const std::vector<FeatureInterval>& b,
+                        std::vector<FeatureInterval>* out);
+
+ private:
+  /*! \brief per thread buffers */
+  struct Workspace {
+    std::vector<bst_float> x;
+    std::vector<std::vector<LeafRegion> > leaves;
+    std::vector<std::vector<LeafRegion> > groups;
+    /*! \brief leaves of each tree at the upper end of the radius search */
+    std::vector<std::vector<LeafRegion> > cache;
+    std::vector<bst_float> lo, hi;
+    std::vector<FeatureInterval> undo;
+    std::vector<FeatureInterval> path;
+    std::vector<size_t> order;
+    std::vector<bst_float> suffix;
+    int64_t nodes;
+    /*! \brief radius of the point verified */
+    bst_float eps;
+    /*! \brief norm of the distance from x to the search box, to the power p */
+    double dist;
+  };
+  /*! \brief contribution of a distance on one feature to the norm, to the power p */
+  inline double NormTerm(double d) const {
+    return param_.verify_norm == kNormL2 ? d * d : d;
+  }
+  /*! \return whether the region box intersects the ball of radius eps around x */
+  bool InBall(const std::vector<FeatureInterval>& box,
+              const std::vector<bst_float>& x, bst_float eps) const;
+  /*!
+   * \brief clique bound of constant + sum of the signed tree outputs.
+   * \param exact set to whether all trees were merged, the bound is then exact
+   */
+  bst_float CliqueBound(Workspace* ws, bst_float constant, bool* exact) const;
+  /*! \brief exact search of a combination of leaves with output <= 0 */
+  int Search(Workspace* ws, bst_float constant) const;
+  bool SearchTree(Workspace* ws, size_t t, bst_float partial) const;
+  /*!
+   * \brief clear summary unless it holds a prefix of the first ntree trees
+   *  for p_fmat and the parameters, and size it
+   * \return the first tree not summarised
+   */
+  size_t PrepareSummary(const DMatrix& fmat, size_t ntree, VerifySummary* summary) const;
+  /*! \brief verify constant + sum of sign * trees > 0 over the box */
+  int VerifyObjective(Workspace* ws, unsigned root,
+                      const std::vector<std::pair<const RegTree*, bst_float> >& trees,
+                      bst_float constant, bst_float* bound) const;
+  /*! \brief verify constant + sum of the leaves collected in ws->leaves > 0 */
+  int DecideObjective(Workspace* ws, bst_float constant, bst_float* bound) const;
+  /*!
+   * \brief verify constant + sum of sign * trees > 0 over the box of radius
+   *  eps, from the leaves of ws->cache referred to by the tree indices
+   */
+  int VerifyCached(Workspace* ws, const std::vector<std::pair<size_t, bst_float> >& trees,
+                   bst_float constant, bst_float eps) const;
+
+  const gbm::GBTreeModel& model_;
+  VerifierParam param_;
+};
+
+}  // namespace robust
+}  // namespace xgboost
+#endif  // XGBOOST_ROBUST_ROBUST_VERIFIER_H_
@@ -27,6 +27,14 @@ struct FastHistParam : public dmlc::Parameter<FastHistParam> {
   // for that feature; to save time, only up to (max_search_group) of existing groups
   // will be considered. If set to zero, ALL existing groups will be examined
   unsigned max_search_group;
+  // whether to build the histograms from int16 quantized gradient pairs
+  int quantize_gradient;
+  // memory budget of the node histograms in MB, 0 means no bound
+  int max_hist_memory_mb;
+  // file the histogram cuts are cached in, empty means no cache
+  std::string cut_cache;
+  // add the eps boundary cuts of frequent values in robust training
+  int robust_cuts;
 
   // declare the parameters
   DMLC_DECLARE_PARAMETER(FastHistParam) {
@@ -45,6 +53,23 @@ struct FastHistParam : public dmlc::Parameter<FastHistParam> {
                   "groups before creating a new group for that feature; to save time, "
                   "only up to (max_search_group) of existing groups will be "
                   "considered. If set to zero, ALL existing groups will be examined.");
+    DMLC_DECLARE_FIELD(quantize_gradient).set_lower_bound(0).set_default(0)
+        .describe("if >0, quantize the gradient pairs of each round to int16 and "
+                  "sum the histograms in integers, which halves the gradient "
+                  "bytes read when building histograms.");
+    DMLC_DECLARE_FIELD(max_hist_memory_mb).set_lower_bound(0).set_default(0)
+        .describe("memory budget of the node histograms in MB. Histograms of "
+                  "nodes waiting to be split are dropped beyond it, and their "
+                  "children are then built without the subtraction trick. "
+                  "0 means no bound.");
+    DMLC_DECLARE_FIELD(cut_cache).set_default("")
+        .describe("file to cache the histogram cuts in. The cuts are loaded "
+                  "from it when it holds the cuts of the same data and max_bin, "
+                  "and recomputed and saved otherwise.");
+    DMLC_DECLARE_FIELD(robust_cuts).set_lower_bound(0).set_default(1)
+        .describe("if >0, robust training also cuts at value - robust_eps and "
+                  "value + robust_eps for the frequent values of each feature, "
+                  "within the max_bin budget.");
   }
 };
 
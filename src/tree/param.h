@@ -36,6 +36,8 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   int grow_policy;
   // flag to print out detailed breakdown of runtime
   int debug_verbose;
+  // whether the breakdown of debug_verbose also counts hardware events
+  bool perf_counters;
   //----- the rest parameters are less important ----
   // minimum amount of hessian(weight) allowed in a child
   float min_child_weight;
@@ -43,6 +45,22 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   float robust_eps;
   // verbose parameter for fobust training
   bool robust_training_verbose; 
+  // skip robust enumeration of features that cannot improve the best split
+  bool robust_gain_bound;
+  // enumerate the robust windows over the value runs of low cardinality features
+  bool robust_value_runs;
+  // find the eps window boundaries of the sorted columns once per data set
+  bool robust_eps_windows;
+  // skip the features that can no longer split a node in robust exact search
+  bool robust_skip_exhausted;
+  // evaluate both default directions of the sparse features in one robust scan
+  bool robust_single_pass;
+  // prune the tree at the end of the robust exact grow step
+  bool robust_fused_prune;
+  // compact the sorted columns to the active rows when fewer than this ratio of them are left
+  float robust_compact_ratio;
+  // place the threads and buffers of the robust exact updater by NUMA node
+  bool numa_mode;
   // random sample split at each node
   float splitsample_bynode; 
   // L2 regularization factor
@@ -73,6 +91,10 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
   int parallel_option;
   // option to open cacheline optimization
   bool cache_opt;
+  // whether histmaker ships sparse histograms and derives larger siblings
+  bool hist_sync_compress;
+  // whether histmaker ships the histogram sums in float
+  bool hist_sync_float;
   // whether to not print info during training.
   bool silent;
   // whether refresh updater needs to update the leaf values
@@ -102,6 +124,11 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
         .set_lower_bound(0)
         .set_default(0)
         .describe("flag to print out detailed breakdown of runtime");
+    DMLC_DECLARE_FIELD(perf_counters)
+        .set_default(false)
+        .describe("With debug_verbose, also count the cycles, instructions, LLC misses "
+                  "and branch misses of each phase of the updaters and of each thread, "
+                  "with Linux perf events, printed as JSON.");
     DMLC_DECLARE_FIELD(max_depth)
         .set_lower_bound(0)
         .set_default(6)
@@ -131,6 +158,51 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
     DMLC_DECLARE_FIELD(robust_training_verbose)
         .set_default(false)
         .describe("print information for robust training debugging");
+    DMLC_DECLARE_FIELD(robust_gain_bound)
+        .set_default(false)
+        .describe("EXP Param: bound the robust gain of each feature by its non-robust gain "
+                  "and skip the robust enumeration of features that cannot improve the "
+                  "best split of any node.");
+    DMLC_DECLARE_FIELD(robust_value_runs)
+        .set_default(false)
+        .describe("EXP Param: store the features with at most 256 distinct values, "
+                  "e.g. pixel intensities, as row indices grouped by value and move "
+                  "the robust windows a whole value group at a time.");
+    DMLC_DECLARE_FIELD(robust_eps_windows)
+        .set_default(false)
+        .describe("EXP Param: find for each entry of the sorted columns the first "
+                  "entries >= value - robust_eps and >= value - 2 * robust_eps once "
+                  "per data set, so that the robust scan moves its windows by "
+                  "position. Takes 8 bytes per nonzero.");
+    DMLC_DECLARE_FIELD(robust_skip_exhausted)
+        .set_default(false)
+        .describe("EXP Param: skip a feature in the subtree of a node where every "
+                  "row has the feature and all its values lie within 2 * robust_eps "
+                  "of the largest, so that no robust split of it gains.");
+    DMLC_DECLARE_FIELD(robust_single_pass)
+        .set_default(false)
+        .describe("EXP Param: for the sparse features, evaluate the splits sending "
+                  "the missing values right and left in one robust scan. The rows "
+                  "missing the feature are summed in a plain pre-pass instead of a "
+                  "second robust scan.");
+    DMLC_DECLARE_FIELD(robust_fused_prune)
+        .set_default(false)
+        .describe("Prune each tree at the end of the robust exact grow step, as "
+                  "the prune updater does, so that no updater has to follow it. "
+                  "Set by tree_method=robust_exact on a single machine.");
+    DMLC_DECLARE_FIELD(robust_compact_ratio)
+        .set_range(0.0f, 1.0f)
+        .set_default(0.0f)
+        .describe("EXP Param: with grow_policy=depthwise, copy the sorted columns "
+                  "keeping only the rows of the nodes still being expanded, each time "
+                  "the number of such rows drops below this ratio of the rows in the "
+                  "columns scanned. 0 means the full columns are always scanned.");
+    DMLC_DECLARE_FIELD(numa_mode)
+        .set_default(false)
+        .describe("EXP Param: pin the threads of the robust exact updater to the cpus "
+                  "NUMA node by node, write the per thread statistics from their own "
+                  "threads, and split the features of each level between the nodes. "
+                  "debug_verbose then also reports the busy time of each node.");
     DMLC_DECLARE_FIELD(splitsample_bynode)
         .set_range(0.0f, 1.0f)
         .set_default(1.0f)
@@ -184,10 +256,23 @@ struct TrainParam : public dmlc::Parameter<TrainParam> {
         .describe("Size of leaf vectors, reserved for vector trees");
     DMLC_DECLARE_FIELD(parallel_option)
         .set_default(0)
-        .describe("Different types of parallelization algorithm.");
+        .describe("Different types of parallelization algorithm. 0: the threads take "
+                  "the features, 1: all the threads scan each feature, 2: 1 when there "
+                  "are fewer than half as many features as threads, else 0, 3: time "
+                  "0 and 1 on the first calls of each level and number of nodes and "
+                  "keep the faster, in the robust exact updater.");
     DMLC_DECLARE_FIELD(cache_opt)
         .set_default(true)
         .describe("EXP Param: Cache aware optimization.");
+    DMLC_DECLARE_FIELD(hist_sync_compress)
+        .set_default(false)
+        .describe("EXP Param: Between the workers, histmaker ships the non empty "
+                  "bins only when it is smaller, and grow_histmaker only ships the "
+                  "smaller of two siblings, the other is its parent minus it.");
+    DMLC_DECLARE_FIELD(hist_sync_float)
+        .set_default(false)
+        .describe("EXP Param: Between the workers, histmaker ships the histogram "
+                  "sums in float instead of double.");
     DMLC_DECLARE_FIELD(silent)
         .set_default(false)
         .describe("Do not print information during trainig.");
@@ -368,12 +453,12 @@ struct XGBOOST_ALIGNAS(16) GradStats {
    * \param ridx instance index of this instance
    */
   inline void Add(const std::vector<GradientPair>& gpair, const MetaInfo& info,
-                  bst_uint ridx) {
+                  size_t ridx) {
     const GradientPair& b = gpair[ridx];
     this->Add(b.GetGrad(), b.GetHess());
   }
   inline void Subtract(const std::vector<GradientPair>& gpair, const MetaInfo& info,
-                  bst_uint ridx) {
+                  size_t ridx) {
     const GradientPair& b = gpair[ridx];
     this->Subtract(b.GetGrad(), b.GetHess());
   }
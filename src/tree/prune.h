@@ -0,0 +1,56 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file prune.h
+ * \brief pruning of a grown tree given its statistics, shared by the prune
+ *  updater and the builders that prune their trees themselves.
+ */
+#ifndef XGBOOST_TREE_PRUNE_H_
+#define XGBOOST_TREE_PRUNE_H_
+
+#include <xgboost/tree_model.h>
+#include "./param.h"
+
+namespace xgboost {
+namespace tree {
+
+// try to prune off the leaf nid, and then its parent, bottom up
+inline int TryPruneLeaf(const TrainParam& param, RegTree* p_tree,
+                        int nid, int depth, int npruned) {
+  RegTree &tree = *p_tree;
+  if (tree[nid].IsRoot()) return npruned;
+  int pid = tree[nid].Parent();
+  RegTree::NodeStat &s = tree.Stat(pid);
+  ++s.leaf_child_cnt;
+  if (s.leaf_child_cnt >= 2 && param.NeedPrune(s.loss_chg, depth - 1)) {
+    // need to be pruned
+    tree.ChangeToLeaf(pid, param.learning_rate * s.base_weight);
+    // tail recursion
+    return TryPruneLeaf(param, p_tree, pid, depth - 1, npruned + 2);
+  } else {
+    return npruned;
+  }
+}
+
+/*!
+ * \brief turn the splits whose loss change is below min_split_loss into
+ *  leaves, the leaf value being base_weight scaled by learning_rate.
+ * \return the number of pruned nodes
+ */
+inline int PruneTree(const TrainParam& param, RegTree* p_tree) {
+  RegTree &tree = *p_tree;
+  int npruned = 0;
+  // initialize auxiliary statistics
+  for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+    tree.Stat(nid).leaf_child_cnt = 0;
+  }
+  for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
+    if (tree[nid].IsLeaf()) {
+      npruned = TryPruneLeaf(param, p_tree, nid, tree.GetDepth(nid), npruned);
+    }
+  }
+  return npruned;
+}
+
+}  // namespace tree
+}  // namespace xgboost
+#endif  // XGBOOST_TREE_PRUNE_H_
@@ -0,0 +1,191 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file robust_trace.h
+ * \brief tracing hooks for the robust split enumeration.
+ *
+ *  The enumeration kernel is templated on a trace policy. NoRobustTrace
+ *  compiles every hook away, so the production kernel carries no debugging
+ *  code; SinkRobustTrace forwards structured events to a RobustTraceSink.
+ */
+#ifndef XGBOOST_TREE_ROBUST_TRACE_H_
+#define XGBOOST_TREE_ROBUST_TRACE_H_
+
+#include <xgboost/base.h>
+#include <cstdint>
+#include <cstdio>
+#include "./param.h"
+
+namespace xgboost {
+namespace tree {
+
+/*! \brief kind of a robust split candidate */
+enum class RobustCandidate : int {
+  /*! \brief natural assignment, data < eta go to the left */
+  kNatural = 0,
+  /*! \brief all uncertain data go to the left */
+  kAllLeft = 1,
+  /*! \brief all uncertain data go to the right */
+  kAllRight = 2,
+  /*! \brief the two halves of the uncertain range are swapped */
+  kSwap = 3,
+  /*! \brief split after all the data of the node */
+  kAllSum = 4
+};
+
+/*! \brief receiver of the events emitted by the robust enumeration */
+class RobustTraceSink {
+ public:
+  virtual ~RobustTraceSink() = default;
+  /*! \brief start scanning a feature, entries are visited in ascending order */
+  virtual void BeginFeature(bst_uint fid, int d_step, bst_float eps,
+                            size_t length, bool descent) {}
+  /*! \brief an entry of node nid is scanned */
+  virtual void Entry(bst_uint fid, int nid, bst_float fvalue, bst_float eta,
+                     GradientPair gpair) {}
+  /*! \brief sizes of the certain left / uncertain / certain right sets */
+  virtual void Window(bst_uint fid, int nid, unsigned c_left, size_t unc,
+                      unsigned c_right) {}
+  /*! \brief a candidate loss change is evaluated */
+  virtual void Candidate(bst_uint fid, int nid, RobustCandidate kind,
+                         bst_float loss_chg) {}
+  /*! \brief count data of node nid enter the uncertain window */
+  virtual void WindowPush(bst_uint fid, int nid, unsigned count) {}
+  /*! \brief count data of node nid leave the uncertain window to the certain left */
+  virtual void WindowPop(bst_uint fid, int nid, unsigned count) {}
+  /*! \brief the best split of node nid after a stage of the scan */
+  virtual void NodeBest(bst_uint fid, int nid, const SplitEntry &best) {}
+  /*! \brief the threshold of node nid is moved to the middle of two values */
+  virtual void MoveThreshold(bst_uint fid, int nid, bst_float from,
+                             bst_float to) {}
+  /*! \brief the scan of a feature is finished */
+  virtual void EndFeature(bst_uint fid) {}
+};
+
+/*! \brief sink that prints the events to stdout, used by robust_training_verbose */
+class ConsoleRobustTraceSink : public RobustTraceSink {
+ public:
+  void BeginFeature(bst_uint fid, int d_step, bst_float eps,
+                    size_t length, bool descent) override {
+    printf("\n[robust] feature %u: d_step=%d, length=%lu, eps=%4.5f, %s order\n",
+           fid, d_step, static_cast<unsigned long>(length), eps,  // NOLINT(*)
+           descent ? "descent" : "ascent");
+  }
+  void Entry(bst_uint fid, int nid, bst_float fvalue, bst_float eta,
+             GradientPair gpair) override {
+    printf("[robust] nid %d: fvalue %4.5f, eta %4.5f, gradient %4.5f, hessian %4.5f\n",
+           nid, fvalue, eta, gpair.GetGrad(), gpair.GetHess());
+  }
+  void Window(bst_uint fid, int nid, unsigned c_left, size_t unc,
+              unsigned c_right) override {
+    printf("[robust] nid %d: left certain %u, uncertain %lu, right certain %u\n",
+           nid, c_left, static_cast<unsigned long>(unc), c_right);  // NOLINT(*)
+  }
+  void Candidate(bst_uint fid, int nid, RobustCandidate kind,
+                 bst_float loss_chg) override {
+    static const char *names[] = {"natural", "all left", "all right", "swap", "all sum"};
+    printf("[robust] nid %d: %s loss change %4.5f\n",
+           nid, names[static_cast<int>(kind)], loss_chg);
+  }
+  void NodeBest(bst_uint fid, int nid, const SplitEntry &best) override {
+    printf("[robust] nid %d: current best split fid=%u, threshold=%4.5f, loss change=%4.5f\n",
+           nid, best.SplitIndex(), best.split_value, best.loss_chg);
+  }
+  void MoveThreshold(bst_uint fid, int nid, bst_float from, bst_float to) override {
+    printf("[robust] nid %d: threshold of fid %u moved from %4.5f to %4.5f\n",
+           nid, fid, from, to);
+  }
+  void EndFeature(bst_uint fid) override {
+    printf("[robust] feature %u finished\n", fid);
+  }
+};
+
+/*!
+ * \brief sink that only counts the events, one per thread for the per tree
+ *  summary of debug_verbose
+ */
+class CountingRobustTraceSink : public RobustTraceSink {
+ public:
+  void Entry(bst_uint fid, int nid, bst_float fvalue, bst_float eta,
+             GradientPair gpair) override {
+    ++num_entry;
+  }
+  void Candidate(bst_uint fid, int nid, RobustCandidate kind,
+                 bst_float loss_chg) override {
+    ++num_candidate;
+  }
+  void WindowPush(bst_uint fid, int nid, unsigned count) override {
+    num_push += count;
+  }
+  void WindowPop(bst_uint fid, int nid, unsigned count) override {
+    num_pop += count;
+  }
+  inline void Clear() {
+    num_entry = num_candidate = num_push = num_pop = 0;
+  }
+  inline void Add(const CountingRobustTraceSink &b) {
+    num_entry += b.num_entry;
+    num_candidate += b.num_candidate;
+    num_push += b.num_push;
+    num_pop += b.num_pop;
+  }
+  uint64_t num_entry{0};
+  uint64_t num_candidate{0};
+  uint64_t num_push{0};
+  uint64_t num_pop{0};
+};
+
+/*! \brief trace policy that compiles all hooks away */
+struct NoRobustTrace {
+  static constexpr bool kEnabled = false;
+  inline void BeginFeature(bst_uint, int, bst_float, size_t, bool) {}
+  inline void Entry(bst_uint, int, bst_float, bst_float, GradientPair) {}
+  inline void Window(bst_uint, int, unsigned, size_t, unsigned) {}
+  inline void Candidate(bst_uint, int, RobustCandidate, bst_float) {}
+  inline void WindowPush(bst_uint, int, unsigned) {}
+  inline void WindowPop(bst_uint, int, unsigned) {}
+  inline void NodeBest(bst_uint, int, const SplitEntry&) {}
+  inline void MoveThreshold(bst_uint, int, bst_float, bst_float) {}
+  inline void EndFeature(bst_uint) {}
+};
+
+/*! \brief trace policy that forwards the hooks to a sink */
+struct SinkRobustTrace {
+  static constexpr bool kEnabled = true;
+  explicit SinkRobustTrace(RobustTraceSink *sink) : sink(sink) {}
+  inline void BeginFeature(bst_uint fid, int d_step, bst_float eps,
+                           size_t length, bool descent) {
+    sink->BeginFeature(fid, d_step, eps, length, descent);
+  }
+  inline void Entry(bst_uint fid, int nid, bst_float fvalue, bst_float eta,
+                    GradientPair gpair) {
+    sink->Entry(fid, nid, fvalue, eta, gpair);
+  }
+  inline void Window(bst_uint fid, int nid, unsigned c_left, size_t unc,
+                     unsigned c_right) {
+    sink->Window(fid, nid, c_left, unc, c_right);
+  }
+  inline void Candidate(bst_uint fid, int nid, RobustCandidate kind,
+                        bst_float loss_chg) {
+    sink->Candidate(fid, nid, kind, loss_chg);
+  }
+  inline void WindowPush(bst_uint fid, int nid, unsigned count) {
+    sink->WindowPush(fid, nid, count);
+  }
+  inline void WindowPop(bst_uint fid, int nid, unsigned count) {
+    sink->WindowPop(fid, nid, count);
+  }
+  inline void NodeBest(bst_uint fid, int nid, const SplitEntry &best) {
+    sink->NodeBest(fid, nid, best);
+  }
+  inline void MoveThreshold(bst_uint fid, int nid, bst_float from, bst_float to) {
+    sink->MoveThreshold(fid, nid, from, to);
+  }
+  inline void EndFeature(bst_uint fid) {
+    sink->EndFeature(fid);
+  }
+  RobustTraceSink *sink;
+};
+
+}  // namespace tree
+}  // namespace xgboost
+#endif  // XGBOOST_TREE_ROBUST_TRACE_H_
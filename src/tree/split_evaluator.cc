@@ -47,6 +47,9 @@ void SplitEvaluator::AddSplit(bst_uint nodeid,
                               bst_uint featureid,
                               bst_float leftweight,
                               bst_float rightweight) {}
+bool SplitEvaluator::GetElasticNet(bst_float* reg_alpha, bst_float* reg_lambda) const {
+  return false;
+}
 bst_float SplitEvaluator::ComputeSplitScore(bst_uint nodeid,
                                             bst_uint featureid,
                                             const GradStats& left_stats,
@@ -137,6 +140,12 @@ class ElasticNet final : public SplitEvaluator {
     return -ThresholdL1(stats.sum_grad) / (stats.sum_hess + params_.reg_lambda);
   }
 
+  bool GetElasticNet(bst_float* reg_alpha, bst_float* reg_lambda) const override {
+    *reg_alpha = params_.reg_alpha;
+    *reg_lambda = params_.reg_lambda;
+    return true;
+  }
+
  private:
   ElasticNetParams params_;
 
@@ -68,6 +68,10 @@ class SplitEvaluator {
                         bst_uint featureid,
                         bst_float leftweight,
                         bst_float rightweight);
+
+  // Returns true if this evaluator is a plain elastic net penalty and sets its
+  // penalties, so that hot loops can inline the split score
+  virtual bool GetElasticNet(bst_float* reg_alpha, bst_float* reg_lambda) const;
 };
 
 struct SplitEvaluatorReg
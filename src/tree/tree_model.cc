@@ -39,15 +39,28 @@ void DumpRegTree(std::stringstream& fo,  // NOLINT(*)
     }
   }
   if (tree[nid].IsLeaf()) {
+    // the leaf value, or the leaf vector as [v0,v1,...]
+    std::stringstream leaf;
+    leaf << std::setprecision(float_max_precision);
+    if (tree.param.size_leaf_vector != 0) {
+      const bst_float* vec = tree.Leafvec(nid);
+      leaf << '[';
+      for (int k = 0; k < tree.param.size_leaf_vector; ++k) {
+        leaf << (k == 0 ? "" : ",") << vec[k];
+      }
+      leaf << ']';
+    } else {
+      leaf << tree[nid].LeafValue();
+    }
     if (format == "json") {
       fo << "{ \"nodeid\": " << nid
-         << ", \"leaf\": " << std::setprecision(float_max_precision) << tree[nid].LeafValue();
+         << ", \"leaf\": " << leaf.str();
       if (with_stats) {
         fo << ", \"cover\": " << std::setprecision(float_max_precision) << tree.Stat(nid).sum_hess;
       }
       fo << " }";
     } else {
-      fo << nid << ":leaf=" << std::setprecision(float_max_precision) << tree[nid].LeafValue();
+      fo << nid << ":leaf=" << leaf.str();
       if (with_stats) {
         fo << ",cover=" << std::setprecision(float_max_precision) << tree.Stat(nid).sum_hess;
       }
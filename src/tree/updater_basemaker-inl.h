@@ -76,12 +76,13 @@ class BaseMaker: public TreeUpdater {
     inline bst_float MaxValue(bst_uint fid) const {
       return fminmax_[fid *2 + 1];
     }
-    inline void SampleCol(float p, std::vector<bst_uint> *p_findex) const {
+    inline void SampleCol(float p, const MetaInfo &info,
+                          std::vector<bst_uint> *p_findex) const {
       std::vector<bst_uint> &findex = *p_findex;
       findex.clear();
       for (size_t i = 0; i < fminmax_.size(); i += 2) {
         const auto fid = static_cast<bst_uint>(i / 2);
-        if (this->Type(fid) != 0) findex.push_back(fid);
+        if (this->Type(fid) != 0 && info.IsSplitFeature(fid)) findex.push_back(fid);
       }
       auto n = static_cast<unsigned>(p * findex.size());
       std::shuffle(findex.begin(), findex.end(), common::GlobalRandom());
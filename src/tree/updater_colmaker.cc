@@ -12,7 +12,11 @@
 #include "./param.h"
 #include "../common/random.h"
 #include "../common/bitmap.h"
+#include "../common/feature_scheduler.h"
+#include "../common/node_arena.h"
 #include "../common/sync.h"
+#include "../common/threading.h"
+#include "../common/timer.h"
 #include "split_evaluator.h"
 
 namespace xgboost {
@@ -27,6 +31,9 @@ class ColMaker: public TreeUpdater {
     param_.InitAllowUnknown(args);
     spliteval_.reset(SplitEvaluator::Create(param_.split_evaluator));
     spliteval_->Init(args);
+    // parameters may have changed, rebuild the workspace on next update
+    builder_.reset();
+    wide_builder_.reset();
   }
 
   void Update(HostDeviceVector<GradientPair> *gpair,
@@ -36,12 +43,13 @@ class ColMaker: public TreeUpdater {
     // rescale learning rate according to size of trees
     float lr = param_.learning_rate;
     param_.learning_rate = lr / trees.size();
-    // build tree
-    for (auto tree : trees) {
-      Builder builder(
-        param_,
-        std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone()));
-      builder.Update(gpair->HostVector(), dmat, tree);
+    // build tree, the builder and its node records are kept across rounds
+    // the omp thread count may have changed since the last round, e.g. through
+    // a new nthread or thread limit, and the builder buffers are per thread
+    if (dmat->WideRowIds()) {
+      this->UpdateTrees(gpair->HostVector(), dmat, trees, &wide_builder_);
+    } else {
+      this->UpdateTrees(gpair->HostVector(), dmat, trees, &builder_);
     }
     param_.learning_rate = lr;
   }
@@ -51,6 +59,18 @@ class ColMaker: public TreeUpdater {
   TrainParam param_;
   // SplitEvaluator that will be cloned for each Builder
   std::unique_ptr<SplitEvaluator> spliteval_;
+  template <typename BuilderT>
+  void UpdateTrees(const std::vector<GradientPair>& gpair, DMatrix* dmat,
+                   const std::vector<RegTree*>& trees, std::unique_ptr<BuilderT>* builder) {
+    if (!*builder || (*builder)->NumThreads() != omp_get_max_threads()) {
+      builder->reset(new BuilderT(
+        param_,
+        std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone())));
+    }
+    for (auto tree : trees) {
+      (*builder)->Update(gpair, dmat, tree);
+    }
+  }
   // data structure
   /*! \brief per thread x per node entry to store tmp data */
   struct ThreadEntry {
@@ -83,26 +103,49 @@ class ColMaker: public TreeUpdater {
         : stats(param), root_gain(0.0f), weight(0.0f){
     }
   };
-  // actual builder that runs the algorithm
+  // actual builder that runs the algorithm, on the columns of 32 or 64 bit
+  // row ids, see DMatrix::WideRowIds
+  template <typename PageT>
   class Builder {
    public:
+    using Access = ColumnAccess<PageT>;
+    using Index = typename PageT::Index;
+    using EntryT = typename PageT::EntryT;
+    using Inst = typename PageT::Inst;
     // constructor
     explicit Builder(const TrainParam& param,
                      std::unique_ptr<SplitEvaluator> spliteval)
         : param_(param), nthread_(omp_get_max_threads()),
-          spliteval_(std::move(spliteval)) {}
+          spliteval_(std::move(spliteval)) {
+      monitor_.Init("ColMaker", param_.debug_verbose > 0, param_.perf_counters);
+    }
+    // number of threads the per-thread buffers are sized for
+    inline int NumThreads() const {
+      return nthread_;
+    }
     // update one tree, growing
     virtual void Update(const std::vector<GradientPair>& gpair,
                         DMatrix* p_fmat,
                         RegTree* p_tree) {
       std::vector<int> newnodes;
+      spliteval_->Reset();
+      monitor_.Start("InitData");
       this->InitData(gpair, *p_fmat, *p_tree);
+      monitor_.Stop("InitData");
+      monitor_.Start("InitNewNode");
       this->InitNewNode(qexpand_, gpair, *p_fmat, *p_tree);
+      monitor_.Stop("InitNewNode");
       for (int depth = 0; depth < param_.max_depth; ++depth) {
+        monitor_.Start("FindSplit");
         this->FindSplit(depth, qexpand_, gpair, p_fmat, p_tree);
+        monitor_.Stop("FindSplit");
+        monitor_.Start("ResetPosition");
         this->ResetPosition(qexpand_, p_fmat, *p_tree);
+        monitor_.Stop("ResetPosition");
         this->UpdateQueueExpand(*p_tree, qexpand_, &newnodes);
+        monitor_.Start("InitNewNode");
         this->InitNewNode(newnodes, gpair, *p_fmat, *p_tree);
+        monitor_.Stop("InitNewNode");
         for (auto nid : qexpand_) {
           if ((*p_tree)[nid].IsLeaf()) {
             continue;
@@ -141,7 +184,7 @@ class ColMaker: public TreeUpdater {
       CHECK_EQ(tree.param.num_nodes, tree.param.num_roots)
           << "ColMaker: can only grow new tree";
       const std::vector<unsigned>& root_index = fmat.Info().root_index_;
-      const RowSet& rowset = fmat.BufferedRowset();
+      const auto& rowset = Access::Rowset(fmat);
       {
         // setup position
         position_.resize(gpair.size());
@@ -151,14 +194,14 @@ class ColMaker: public TreeUpdater {
           }
         } else {
           for (size_t i = 0; i < rowset.Size(); ++i) {
-            const bst_uint ridx = rowset[i];
+            const Index ridx = rowset[i];
             position_[ridx] = root_index[ridx];
             CHECK_LT(root_index[ridx], (unsigned)tree.param.num_roots);
           }
         }
         // mark delete for the deleted datas
         for (size_t i = 0; i < rowset.Size(); ++i) {
-          const bst_uint ridx = rowset[i];
+          const Index ridx = rowset[i];
           if (gpair[ridx].GetHess() < 0.0f) position_[ridx] = ~position_[ridx];
         }
         // mark subsample
@@ -166,7 +209,7 @@ class ColMaker: public TreeUpdater {
           std::bernoulli_distribution coin_flip(param_.subsample);
           auto& rnd = common::GlobalRandom();
           for (size_t i = 0; i < rowset.Size(); ++i) {
-            const bst_uint ridx = rowset[i];
+            const Index ridx = rowset[i];
             if (gpair[ridx].GetHess() < 0.0f) continue;
             if (!coin_flip(rnd)) position_[ridx] = ~position_[ridx];
           }
@@ -176,7 +219,7 @@ class ColMaker: public TreeUpdater {
         // initialize feature index
         auto ncol = static_cast<unsigned>(fmat.Info().num_col_);
         for (unsigned i = 0; i < ncol; ++i) {
-          if (fmat.GetColSize(i) != 0) {
+          if (fmat.GetColSize(i) != 0 && fmat.Info().IsSplitFeature(i)) {
             feat_index_.push_back(i);
           }
         }
@@ -189,13 +232,13 @@ class ColMaker: public TreeUpdater {
       }
       {
         // setup temp space for each thread
-        // reserve a small space
-        stemp_.clear();
-        stemp_.resize(this->nthread_, std::vector<ThreadEntry>());
+        // the records of a previous tree are kept, InitNewNode resets them
+        stemp_.resize(this->nthread_);
         for (auto& i : stemp_) {
-          i.clear(); i.reserve(256);
+          i.Clear(); i.Reserve(256);
         }
-        snode_.reserve(256);
+        snode_.Clear();
+        snode_.Reserve(256);
       }
       {
         // expand query
@@ -216,21 +259,20 @@ class ColMaker: public TreeUpdater {
       {
         // setup statistics space for each tree node
         for (auto& i : stemp_) {
-          i.resize(tree.param.num_nodes, ThreadEntry(param_));
+          i.Resize(tree.param.num_nodes, ThreadEntry(param_));
         }
-        snode_.resize(tree.param.num_nodes, NodeEntry(param_));
+        snode_.Resize(tree.param.num_nodes, NodeEntry(param_));
       }
-      const RowSet &rowset = fmat.BufferedRowset();
+      const auto& rowset = Access::Rowset(fmat);
       const MetaInfo& info = fmat.Info();
       // setup position
-      const auto ndata = static_cast<bst_omp_uint>(rowset.Size());
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < ndata; ++i) {
-        const bst_uint ridx = rowset[i];
-        const int tid = omp_get_thread_num();
-        if (position_[ridx] < 0) continue;
+      const size_t ndata = rowset.Size();
+      common::ParallelFor(ndata, [&](size_t i) {
+        const Index ridx = rowset[i];
+        const int tid = common::ThreadId();
+        if (position_[ridx] < 0) return;
         stemp_[tid][position_[ridx]].stats.Add(gpair, info, ridx);
-      }
+      });
       // sum the per thread statistics together
       for (int nid : qexpand) {
         GradStats stats(param_);
@@ -263,7 +305,7 @@ class ColMaker: public TreeUpdater {
     }
     // parallel find the best split of current fid
     // this function does not support nested functions
-    inline void ParallelFindSplit(const SparsePage::Inst &col,
+    inline void ParallelFindSplit(const Inst &col,
                                   bst_uint fid,
                                   const DMatrix &fmat,
                                   const std::vector<GradientPair> &gpair) {
@@ -276,15 +318,15 @@ class ColMaker: public TreeUpdater {
       #pragma omp parallel
       {
         const int tid = omp_get_thread_num();
-        std::vector<ThreadEntry> &temp = stemp_[tid];
+        common::NodeArena<ThreadEntry> &temp = stemp_[tid];
         // cleanup temp statistics
         for (int j : qexpand) {
           temp[j].stats.Clear();
         }
-        bst_uint step = (col.length + this->nthread_ - 1) / this->nthread_;
-        bst_uint end = std::min(col.length, step * (tid + 1));
-        for (bst_uint i = tid * step; i < end; ++i) {
-          const bst_uint ridx = col[i].index;
+        Index step = (col.length + this->nthread_ - 1) / this->nthread_;
+        Index end = std::min(col.length, step * (tid + 1));
+        for (Index i = tid * step; i < end; ++i) {
+          const Index ridx = col[i].index;
           const int nid = position_[ridx];
           if (nid < 0) continue;
           const bst_float fvalue = col[i].fvalue;
@@ -297,8 +339,7 @@ class ColMaker: public TreeUpdater {
       }
       // start collecting the partial sum statistics
       auto nnode = static_cast<bst_omp_uint>(qexpand.size());
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint j = 0; j < nnode; ++j) {
+      common::ParallelFor(nnode, [&](size_t j) {
         const int nid = qexpand[j];
         GradStats sum(param_), tmp(param_), c(param_);
         for (int tid = 0; tid < this->nthread_; ++tid) {
@@ -356,17 +397,17 @@ class ColMaker: public TreeUpdater {
             e.best.Update(loss_chg, fid, e.last_fvalue + kRtEps, true);
           }
         }
-      }
+      });
       // rescan, generate candidate split
       #pragma omp parallel
       {
         GradStats c(param_), cright(param_);
         const int tid = omp_get_thread_num();
-        std::vector<ThreadEntry> &temp = stemp_[tid];
-        bst_uint step = (col.length + this->nthread_ - 1) / this->nthread_;
-        bst_uint end = std::min(col.length, step * (tid + 1));
-        for (bst_uint i = tid * step; i < end; ++i) {
-          const bst_uint ridx = col[i].index;
+        common::NodeArena<ThreadEntry> &temp = stemp_[tid];
+        Index step = (col.length + this->nthread_ - 1) / this->nthread_;
+        Index end = std::min(col.length, step * (tid + 1));
+        for (Index i = tid * step; i < end; ++i) {
+          const Index ridx = col[i].index;
           const int nid = position_[ridx];
           if (nid < 0) continue;
           const bst_float fvalue = col[i].fvalue;
@@ -410,7 +451,7 @@ class ColMaker: public TreeUpdater {
     // update enumeration solution
     inline void UpdateEnumeration(int nid, GradientPair gstats,
                                   bst_float fvalue, int d_step, bst_uint fid,
-                                  GradStats &c, std::vector<ThreadEntry> &temp) { // NOLINT(*)
+                                  GradStats &c, common::NodeArena<ThreadEntry> &temp) { // NOLINT(*)
       // get the statistics of nid
       ThreadEntry &e = temp[nid];
       // test if first hit, this is fine, because we set 0 during init
@@ -443,12 +484,12 @@ class ColMaker: public TreeUpdater {
       }
     }
     // same as EnumerateSplit, with cacheline prefetch optimization
-    inline void EnumerateSplitCacheOpt(const Entry *begin,
-                                       const Entry *end,
+    inline void EnumerateSplitCacheOpt(const EntryT *begin,
+                                       const EntryT *end,
                                        int d_step,
                                        bst_uint fid,
                                        const std::vector<GradientPair> &gpair,
-                                       std::vector<ThreadEntry> &temp) { // NOLINT(*)
+                                       common::NodeArena<ThreadEntry> &temp) { // NOLINT(*)
       const std::vector<int> &qexpand = qexpand_;
       // clear all the temp statistics
       for (auto nid : qexpand) {
@@ -461,18 +502,18 @@ class ColMaker: public TreeUpdater {
       int buf_position[kBuffer] = {};
       GradientPair buf_gpair[kBuffer] = {};
       // aligned ending position
-      const Entry *align_end;
+      const EntryT *align_end;
       if (d_step > 0) {
         align_end = begin + (end - begin) / kBuffer * kBuffer;
       } else {
         align_end = begin - (begin - end) / kBuffer * kBuffer;
       }
       int i;
-      const Entry *it;
+      const EntryT *it;
       const int align_step = d_step * kBuffer;
       // internal cached loop
       for (it = begin; it != align_end; it += align_step) {
-        const Entry *p;
+        const EntryT *p;
         for (i = 0, p = it; i < kBuffer; ++i, p += d_step) {
           buf_position[i] = position_[p->index];
           buf_gpair[i] = gpair[p->index];
@@ -521,13 +562,13 @@ class ColMaker: public TreeUpdater {
     }
 
     // enumerate the split values of specific feature
-    inline void EnumerateSplit(const Entry *begin,
-                               const Entry *end,
+    inline void EnumerateSplit(const EntryT *begin,
+                               const EntryT *end,
                                int d_step,
                                bst_uint fid,
                                const std::vector<GradientPair> &gpair,
                                const MetaInfo &info,
-                               std::vector<ThreadEntry> &temp) { // NOLINT(*)
+                               common::NodeArena<ThreadEntry> &temp) { // NOLINT(*)
       // use cacheline aware optimization
       if (GradStats::kSimpleStats != 0 && param_.cache_opt != 0) {
         EnumerateSplitCacheOpt(begin, end, d_step, fid, gpair, temp);
@@ -540,8 +581,8 @@ class ColMaker: public TreeUpdater {
       }
       // left statistics
       GradStats c(param_);
-      for (const Entry *it = begin; it != end; it += d_step) {
-        const bst_uint ridx = it->index;
+      for (const EntryT *it = begin; it != end; it += d_step) {
+        const Index ridx = it->index;
         const int nid = position_[ridx];
         if (nid < 0) continue;
         // start working
@@ -600,34 +641,40 @@ class ColMaker: public TreeUpdater {
     }
 
     // update the solution candidate
-    virtual void UpdateSolution(const SparsePage &batch,
+    virtual void UpdateSolution(const PageT &batch,
                                 const std::vector<bst_uint> &feat_set,
                                 const std::vector<GradientPair> &gpair,
                                 const DMatrix &fmat) {
       const MetaInfo& info = fmat.Info();
       // start enumeration
       const auto num_features = static_cast<bst_omp_uint>(feat_set.size());
-      #if defined(_OPENMP)
-      const int batch_size = std::max(static_cast<int>(num_features / this->nthread_ / 32), 1);
-      #endif
       int poption = param_.parallel_option;
-      if (poption == 2) {
+      // only the robust updater tunes the option, 3 is the heuristic here
+      if (poption == 2 || poption == 3) {
         poption = static_cast<int>(num_features) * 2 < this->nthread_ ? 1 : 0;
       }
       if (poption == 0) {
-        #pragma omp parallel for schedule(dynamic, batch_size)
+        // the columns are scanned longest first, idle threads steal the rest
+        std::vector<size_t> cost(num_features);
         for (bst_omp_uint i = 0; i < num_features; ++i) {
-          int fid = feat_set[i];
+          cost[i] = batch[feat_set[i]].length;
+        }
+        scheduler_.Init(feat_set, cost, this->nthread_, false);
+        #pragma omp parallel num_threads(this->nthread_)
+        {
           const int tid = omp_get_thread_num();
-          auto c = batch[fid];
-          const bool ind = c.length != 0 && c.data[0].fvalue == c.data[c.length - 1].fvalue;
-          if (param_.NeedForwardSearch(fmat.GetColDensity(fid), ind)) {
-            this->EnumerateSplit(c.data, c.data + c.length, +1,
-                                 fid, gpair, info, stemp_[tid]);
-          }
-          if (param_.NeedBackwardSearch(fmat.GetColDensity(fid), ind)) {
-            this->EnumerateSplit(c.data + c.length - 1, c.data - 1, -1,
-                                 fid, gpair, info, stemp_[tid]);
+          bst_uint fid;
+          while (scheduler_.Next(tid, &fid)) {
+            auto c = batch[fid];
+            const bool ind = c.length != 0 && c.data[0].fvalue == c.data[c.length - 1].fvalue;
+            if (param_.NeedForwardSearch(fmat.GetColDensity(fid), ind)) {
+              this->EnumerateSplit(c.data, c.data + c.length, +1,
+                                   fid, gpair, info, stemp_[tid]);
+            }
+            if (param_.NeedBackwardSearch(fmat.GetColDensity(fid), ind)) {
+              this->EnumerateSplit(c.data + c.length - 1, c.data - 1, -1,
+                                   fid, gpair, info, stemp_[tid]);
+            }
           }
         }
       } else {
@@ -652,7 +699,7 @@ class ColMaker: public TreeUpdater {
             << "colsample_bylevel cannot be zero.";
         feat_set.resize(n);
       }
-      auto iter = p_fmat->ColIterator();
+      auto iter = Access::Iterator(p_fmat, feat_index_);
       while (iter->Next()) {
         this->UpdateSolution(iter->Value(), feat_set, gpair, *p_fmat);
       }
@@ -680,15 +727,14 @@ class ColMaker: public TreeUpdater {
       // set the positions in the nondefault
       this->SetNonDefaultPosition(qexpand, p_fmat, tree);
       // set rest of instances to default position
-      const RowSet &rowset = p_fmat->BufferedRowset();
+      const auto& rowset = Access::Rowset(*p_fmat);
       // set default direct nodes to default
       // for leaf nodes that are not fresh, mark then to ~nid,
       // so that they are ignored in future statistics collection
-      const auto ndata = static_cast<bst_omp_uint>(rowset.Size());
+      const size_t ndata = rowset.Size();
 
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < ndata; ++i) {
-        const bst_uint ridx = rowset[i];
+      common::ParallelFor(ndata, [&](size_t i) {
+        const Index ridx = rowset[i];
         CHECK_LT(ridx, position_.size())
             << "ridx exceed bound " << "ridx="<<  ridx << " pos=" << position_.size();
         const int nid = this->DecodePosition(ridx);
@@ -705,7 +751,7 @@ class ColMaker: public TreeUpdater {
             this->SetEncodePosition(ridx, tree[nid].RightChild());
           }
         }
-      }
+      });
     }
     // customization part
     // synchronize the best solution of each node
@@ -729,15 +775,14 @@ class ColMaker: public TreeUpdater {
       }
       std::sort(fsplits.begin(), fsplits.end());
       fsplits.resize(std::unique(fsplits.begin(), fsplits.end()) - fsplits.begin());
-      auto iter = p_fmat->ColIterator();
+      auto iter = Access::Iterator(p_fmat, fsplits);
       while (iter->Next()) {
         auto batch = iter->Value();
         for (auto fid : fsplits) {
           auto col = batch[fid];
-          const auto ndata = static_cast<bst_omp_uint>(col.length);
-          #pragma omp parallel for schedule(static)
-          for (bst_omp_uint j = 0; j < ndata; ++j) {
-            const bst_uint ridx = col[j].index;
+          const size_t ndata = col.length;
+          common::ParallelFor(ndata, [&](size_t j) {
+            const Index ridx = col[j].index;
             const int nid = this->DecodePosition(ridx);
             const bst_float fvalue = col[j].fvalue;
             // go back to parent, correct those who are not default
@@ -748,18 +793,18 @@ class ColMaker: public TreeUpdater {
                 this->SetEncodePosition(ridx, tree[nid].RightChild());
               }
             }
-          }
+          });
         }
       }
     }
     // utils to get/set position, with encoded format
     // return decoded position
-    inline int DecodePosition(bst_uint ridx) const {
+    inline int DecodePosition(Index ridx) const {
       const int pid = position_[ridx];
       return pid < 0 ? ~pid : pid;
     }
     // encode the encoded position value for ridx
-    inline void SetEncodePosition(bst_uint ridx, int nid) {
+    inline void SetEncodePosition(Index ridx, int nid) {
       if (position_[ridx] < 0) {
         position_[ridx] = ~nid;
       } else {
@@ -775,14 +820,22 @@ class ColMaker: public TreeUpdater {
     // Instance Data: current node position in the tree of each instance
     std::vector<int> position_;
     // PerThread x PerTreeNode: statistics for per thread construction
-    std::vector< std::vector<ThreadEntry> > stemp_;
+    std::vector<common::NodeArena<ThreadEntry> > stemp_;
     /*! \brief TreeNode Data: statistics for each constructed node */
-    std::vector<NodeEntry> snode_;
+    common::NodeArena<NodeEntry> snode_;
     /*! \brief queue of nodes to be expanded */
     std::vector<int> qexpand_;
+    /*! \brief schedule of the features of UpdateSolution */
+    common::FeatureScheduler scheduler_;
     // Evaluates splits and computes optimal weights for a given split
     std::unique_ptr<SplitEvaluator> spliteval_;
+    // time and hardware events of the phases, with debug_verbose
+    common::Monitor monitor_;
   };
+  // persistent builders, reused for every tree, of the columns of 32 and of
+  // 64 bit row ids
+  std::unique_ptr<Builder<SparsePage> > builder_;
+  std::unique_ptr<Builder<SparsePage64> > wide_builder_;
 };
 
 // distributed column maker
@@ -800,6 +853,8 @@ class DistColMaker : public ColMaker {
               const std::vector<RegTree*> &trees) override {
     GradStats::CheckInfo(dmat->Info());
     CHECK_EQ(trees.size(), 1U) << "DistColMaker: only support one tree at a time";
+    CHECK(!dmat->WideRowIds())
+        << "DistColMaker: 2^32 rows or more need the exact or hist tree method";
     Builder builder(
       param_,
       std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone()));
@@ -812,16 +867,15 @@ class DistColMaker : public ColMaker {
   }
 
  private:
-  class Builder : public ColMaker::Builder {
+  class Builder : public ColMaker::Builder<SparsePage> {
    public:
     explicit Builder(const TrainParam &param,
                      std::unique_ptr<SplitEvaluator> spliteval)
-        : ColMaker::Builder(param, std::move(spliteval)) {}
+        : ColMaker::Builder<SparsePage>(param, std::move(spliteval)) {}
     inline void UpdatePosition(DMatrix* p_fmat, const RegTree &tree) {
       const RowSet &rowset = p_fmat->BufferedRowset();
       const auto ndata = static_cast<bst_omp_uint>(rowset.Size());
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < ndata; ++i) {
+      common::ParallelFor(ndata, [&](size_t i) {
         const bst_uint ridx = rowset[i];
         int nid = this->DecodePosition(ridx);
         while (tree[nid].IsDeleted()) {
@@ -829,7 +883,7 @@ class DistColMaker : public ColMaker {
           CHECK_GE(nid, 0);
         }
         this->position_[ridx] = nid;
-      }
+      });
     }
     inline const int* GetLeafPosition() const {
       return dmlc::BeginPtr(this->position_);
@@ -855,19 +909,17 @@ class DistColMaker : public ColMaker {
       {
         auto ndata = static_cast<bst_omp_uint>(this->position_.size());
         boolmap_.resize(ndata);
-        #pragma omp parallel for schedule(static)
-        for (bst_omp_uint j = 0; j < ndata; ++j) {
+        common::ParallelFor(ndata, [&](size_t j) {
             boolmap_[j] = 0;
-        }
+        });
       }
-      auto iter = p_fmat->ColIterator();
+      auto iter = p_fmat->ColIteratorFor(fsplits);
       while (iter->Next()) {
         auto batch = iter->Value();
         for (auto fid : fsplits) {
           auto col = batch[fid];
           const auto ndata = static_cast<bst_omp_uint>(col.length);
-          #pragma omp parallel for schedule(static)
-          for (bst_omp_uint j = 0; j < ndata; ++j) {
+          common::ParallelFor(ndata, [&](size_t j) {
             const bst_uint ridx = col[j].index;
             const bst_float fvalue = col[j].fvalue;
             const int nid = this->DecodePosition(ridx);
@@ -878,7 +930,7 @@ class DistColMaker : public ColMaker {
                 if (tree[nid].DefaultLeft()) boolmap_[ridx] = 1;
               }
             }
-          }
+          });
         }
       }
 
@@ -888,8 +940,7 @@ class DistColMaker : public ColMaker {
       const RowSet &rowset = p_fmat->BufferedRowset();
       // get the new position
       const auto ndata = static_cast<bst_omp_uint>(rowset.Size());
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < ndata; ++i) {
+      common::ParallelFor(ndata, [&](size_t i) {
         const bst_uint ridx = rowset[i];
         const int nid = this->DecodePosition(ridx);
         if (bitmap_.Get(ridx)) {
@@ -900,7 +951,7 @@ class DistColMaker : public ColMaker {
             this->SetEncodePosition(ridx, tree[nid].LeftChild());
           }
         }
-      }
+      });
     }
     // synchronize the best solution of each node
     void SyncBestSolution(const std::vector<int> &qexpand) override {
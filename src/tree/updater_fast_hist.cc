@@ -22,6 +22,7 @@
 #include "../common/hist_util.h"
 #include "../common/row_set.h"
 #include "../common/column_matrix.h"
+#include "../common/timer.h"
 
 namespace xgboost {
 namespace tree {
@@ -45,6 +46,12 @@ DMLC_REGISTER_PARAMETER(FastHistParam);
 /*! \brief construct a tree using quantized feature values */
 class FastHistMaker: public TreeUpdater {
  public:
+  /*!
+   * \param robust whether to evaluate splits with the eps-robust
+   *  worst-case gain used by robust_exact
+   */
+  explicit FastHistMaker(bool robust = false) : robust_(robust) {}
+
   void Init(const std::vector<std::pair<std::string, std::string> >& args) override {
     // initialize pruner
     if (!pruner_) {
@@ -53,6 +60,8 @@ class FastHistMaker: public TreeUpdater {
     pruner_->Init(args);
     param_.InitAllowUnknown(args);
     fhparam_.InitAllowUnknown(args);
+    CHECK(fhparam_.quantize_gradient == 0 || fhparam_.enable_feature_grouping == 0)
+        << "quantize_gradient does not support enable_feature_grouping";
     is_gmat_initialized_ = false;
 
     // initialise the split evaluator
@@ -67,14 +76,31 @@ class FastHistMaker: public TreeUpdater {
               DMatrix* dmat,
               const std::vector<RegTree*>& trees) override {
     GradStats::CheckInfo(dmat->Info());
+    if (is_gmat_initialized_ && gmat_fmat_ == dmat &&
+        gmat_.row_ptr.size() - 1 < dmat->Info().num_row_ &&
+        gmat_.cut.row_ptr.size() - 1 >= dmat->Info().num_col_) {
+      // rows were appended to the matrix, they are binned with its cuts
+      gmat_.AppendRows(dmat);
+      column_matrix_.Init(gmat_, fhparam_.sparse_threshold);
+      if (fhparam_.enable_feature_grouping > 0) {
+        gmatb_ = GHistIndexBlockMatrix();
+        gmatb_.Init(gmat_, column_matrix_, fhparam_);
+      }
+    } else if (gmat_fmat_ != dmat || gmat_.row_ptr.size() - 1 != dmat->Info().num_row_) {
+      is_gmat_initialized_ = false;
+    }
     if (is_gmat_initialized_ == false) {
       double tstart = dmlc::GetTime();
-      gmat_.Init(dmat, static_cast<uint32_t>(param_.max_bin));
+      // the robust updater also cuts at the eps boundaries of frequent values
+      const auto cut_eps = robust_ && fhparam_.robust_cuts > 0 ?
+          static_cast<bst_float>(param_.robust_eps) : 0.0f;
+      gmat_.Init(dmat, static_cast<uint32_t>(param_.max_bin), fhparam_.cut_cache, cut_eps);
       column_matrix_.Init(gmat_, fhparam_.sparse_threshold);
       if (fhparam_.enable_feature_grouping > 0) {
         gmatb_.Init(gmat_, column_matrix_, fhparam_);
       }
       is_gmat_initialized_ = true;
+      gmat_fmat_ = dmat;
       if (param_.debug_verbose > 0) {
         LOG(INFO) << "Generating gmat: " << dmlc::GetTime() - tstart << " sec";
       }
@@ -88,7 +114,8 @@ class FastHistMaker: public TreeUpdater {
         param_,
         fhparam_,
         std::move(pruner_),
-        std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone())));
+        std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone()),
+        robust_));
     }
     for (auto tree : trees) {
       builder_->Update
@@ -106,6 +133,11 @@ class FastHistMaker: public TreeUpdater {
     }
   }
 
+  // the positions of the rows in deleted nodes are walked up to their leaf
+  bool CacheFollowsDeletedNodes() const override {
+    return true;
+  }
+
  protected:
   // training parameter
   TrainParam param_;
@@ -117,6 +149,10 @@ class FastHistMaker: public TreeUpdater {
   // column accessor
   ColumnMatrix column_matrix_;
   bool is_gmat_initialized_;
+  // the matrix indexed in gmat_
+  const DMatrix* gmat_fmat_{nullptr};
+  // whether to use robust split enumeration
+  bool robust_;
 
   // data structure
   struct NodeEntry {
@@ -141,10 +177,14 @@ class FastHistMaker: public TreeUpdater {
     explicit Builder(const TrainParam& param,
                      const FastHistParam& fhparam,
                      std::unique_ptr<TreeUpdater> pruner,
-                     std::unique_ptr<SplitEvaluator> spliteval)
+                     std::unique_ptr<SplitEvaluator> spliteval,
+                     bool robust = false)
       : param_(param), fhparam_(fhparam), pruner_(std::move(pruner)),
         spliteval_(std::move(spliteval)), p_last_tree_(nullptr),
-        p_last_fmat_(nullptr) {}
+        p_last_fmat_(nullptr), robust_(robust) {
+      monitor_.Init(robust ? "RobustFastHist" : "FastHist", param_.debug_verbose > 0,
+                    param_.perf_counters);
+    }
     // update one tree, growing
     virtual void Update(const GHistIndexMatrix& gmat,
                         const GHistIndexBlockMatrix& gmatb,
@@ -169,8 +209,13 @@ class FastHistMaker: public TreeUpdater {
       spliteval_->Reset();
 
       tstart = dmlc::GetTime();
+      monitor_.Start("InitData");
       this->InitData(gmat, gpair_h, *p_fmat, *p_tree);
+      if (fhparam_.quantize_gradient > 0) {
+        qgpair_.Build(gpair_h);
+      }
       std::vector<bst_uint> feat_set = feat_index_;
+      monitor_.Stop("InitData");
       time_init_data = dmlc::GetTime() - tstart;
 
       // FIXME(hcho3): this code is broken when param.num_roots > 1. Please fix it
@@ -178,16 +223,22 @@ class FastHistMaker: public TreeUpdater {
         << "tree_method=hist does not support multiple roots at this moment";
       for (int nid = 0; nid < p_tree->param.num_roots; ++nid) {
         tstart = dmlc::GetTime();
+        monitor_.Start("BuildHist");
         hist_.AddHistRow(nid);
         BuildHist(gpair_h, row_set_collection_[nid], gmat, gmatb, feat_set, hist_[nid]);
+        monitor_.Stop("BuildHist");
         time_build_hist += dmlc::GetTime() - tstart;
 
         tstart = dmlc::GetTime();
+        monitor_.Start("InitNewNode");
         this->InitNewNode(nid, gmat, gpair_h, *p_fmat, *p_tree);
+        monitor_.Stop("InitNewNode");
         time_init_new_node += dmlc::GetTime() - tstart;
 
         tstart = dmlc::GetTime();
+        monitor_.Start("EvaluateSplit");
         this->EvaluateSplit(nid, gmat, hist_, *p_fmat, *p_tree, feat_set);
+        monitor_.Stop("EvaluateSplit");
         time_evaluate_split += dmlc::GetTime() - tstart;
         qexpand_->push(ExpandEntry(nid, p_tree->GetDepth(nid),
                                    snode_[nid].best.loss_chg,
@@ -195,44 +246,65 @@ class FastHistMaker: public TreeUpdater {
         ++num_leaves;
       }
 
+      // the depthwise policy expands a level at a time, whose histograms are
+      // built in one pass when the memory budget can not drop them
+      const bool batch_level = param_.grow_policy == TrainParam::kDepthWise &&
+                               fhparam_.enable_feature_grouping == 0 &&
+                               fhparam_.max_hist_memory_mb == 0;
+      std::vector<int> split_nodes;
       while (!qexpand_->empty()) {
-        const ExpandEntry candidate = qexpand_->top();
-        const int nid = candidate.nid;
-        qexpand_->pop();
-        if (candidate.loss_chg <= kRtEps
-            || (param_.max_depth > 0 && candidate.depth == param_.max_depth)
-            || (param_.max_leaves > 0 && num_leaves == param_.max_leaves) ) {
-          (*p_tree)[nid].SetLeaf(snode_[nid].weight * param_.learning_rate);
+        const int depth = qexpand_->top().depth;
+        split_nodes.clear();
+        do {
+          const ExpandEntry candidate = qexpand_->top();
+          const int nid = candidate.nid;
+          qexpand_->pop();
+          if (candidate.loss_chg <= kRtEps
+              || (param_.max_depth > 0 && candidate.depth == param_.max_depth)
+              || (param_.max_leaves > 0 && num_leaves == param_.max_leaves) ) {
+            (*p_tree)[nid].SetLeaf(snode_[nid].weight * param_.learning_rate);
+            hist_.FreeHistRow(nid);
+          } else {
+            tstart = dmlc::GetTime();
+            monitor_.Start("ApplySplit");
+            this->ApplySplit(nid, gmat, column_matrix, hist_, *p_fmat, p_tree);
+            monitor_.Stop("ApplySplit");
+            time_apply_split += dmlc::GetTime() - tstart;
+            split_nodes.push_back(nid);
+            ++num_leaves;  // give two and take one, as parent is no longer a leaf
+          }
+        } while (batch_level && !qexpand_->empty() && qexpand_->top().depth == depth);
+
+        tstart = dmlc::GetTime();
+        monitor_.Start("BuildHist");
+        if (batch_level) {
+          this->BuildLevelHist(split_nodes, gmat, gpair_h, *p_tree);
         } else {
-          tstart = dmlc::GetTime();
-          this->ApplySplit(nid, gmat, column_matrix, hist_, *p_fmat, p_tree);
-          time_apply_split += dmlc::GetTime() - tstart;
+          for (int nid : split_nodes) {
+            this->BuildChildHist(nid, gmat, gmatb, gpair_h, feat_set, *p_tree);
+          }
+        }
+        monitor_.Stop("BuildHist");
+        time_build_hist += dmlc::GetTime() - tstart;
 
-          tstart = dmlc::GetTime();
+        for (int nid : split_nodes) {
           const int cleft = (*p_tree)[nid].LeftChild();
           const int cright = (*p_tree)[nid].RightChild();
-          hist_.AddHistRow(cleft);
-          hist_.AddHistRow(cright);
-          if (row_set_collection_[cleft].Size() < row_set_collection_[cright].Size()) {
-            BuildHist(gpair_h, row_set_collection_[cleft], gmat, gmatb, feat_set, hist_[cleft]);
-            SubtractionTrick(hist_[cright], hist_[cleft], hist_[nid]);
-          } else {
-            BuildHist(gpair_h, row_set_collection_[cright], gmat, gmatb, feat_set, hist_[cright]);
-            SubtractionTrick(hist_[cleft], hist_[cright], hist_[nid]);
-          }
-          time_build_hist += dmlc::GetTime() - tstart;
-
           tstart = dmlc::GetTime();
+          monitor_.Start("InitNewNode");
           this->InitNewNode(cleft, gmat, gpair_h, *p_fmat, *p_tree);
           this->InitNewNode(cright, gmat, gpair_h, *p_fmat, *p_tree);
           bst_uint featureid = snode_[nid].best.SplitIndex();
           spliteval_->AddSplit(nid, cleft, cright, featureid,
               snode_[cleft].weight, snode_[cright].weight);
+          monitor_.Stop("InitNewNode");
           time_init_new_node += dmlc::GetTime() - tstart;
 
           tstart = dmlc::GetTime();
+          monitor_.Start("EvaluateSplit");
           this->EvaluateSplit(cleft, gmat, hist_, *p_fmat, *p_tree, feat_set);
           this->EvaluateSplit(cright, gmat, hist_, *p_fmat, *p_tree, feat_set);
+          monitor_.Stop("EvaluateSplit");
           time_evaluate_split += dmlc::GetTime() - tstart;
 
           qexpand_->push(ExpandEntry(cleft, p_tree->GetDepth(cleft),
@@ -241,8 +313,6 @@ class FastHistMaker: public TreeUpdater {
           qexpand_->push(ExpandEntry(cright, p_tree->GetDepth(cright),
                                      snode_[cright].best.loss_chg,
                                      timestamp++));
-
-          ++num_leaves;  // give two and take one, as parent is no longer a leaf
         }
       }
 
@@ -300,11 +370,74 @@ class FastHistMaker: public TreeUpdater {
                           GHistRow hist) {
       if (fhparam_.enable_feature_grouping > 0) {
         hist_builder_.BuildBlockHist(gpair, row_indices, gmatb, feat_set, hist);
+      } else if (fhparam_.quantize_gradient > 0) {
+        hist_builder_.BuildHist(qgpair_, row_indices, gmat, feat_set, hist);
       } else {
         hist_builder_.BuildHist(gpair, row_indices, gmat, feat_set, hist);
       }
     }
 
+    // build the histograms of the children of a split node
+    inline void BuildChildHist(int nid,
+                               const GHistIndexMatrix& gmat,
+                               const GHistIndexBlockMatrix& gmatb,
+                               const std::vector<GradientPair>& gpair,
+                               const std::vector<bst_uint>& feat_set,
+                               const RegTree& tree) {
+      const int cleft = tree[nid].LeftChild();
+      const int cright = tree[nid].RightChild();
+      hist_.Evict(2, nid);
+      hist_.AddHistRow(cleft);
+      hist_.AddHistRow(cright);
+      if (!hist_.RowExists(nid)) {
+        // dropped by the memory budget while the node waited
+        BuildHist(gpair, row_set_collection_[cleft], gmat, gmatb, feat_set, hist_[cleft]);
+        BuildHist(gpair, row_set_collection_[cright], gmat, gmatb, feat_set, hist_[cright]);
+      } else if (row_set_collection_[cleft].Size() < row_set_collection_[cright].Size()) {
+        BuildHist(gpair, row_set_collection_[cleft], gmat, gmatb, feat_set, hist_[cleft]);
+        SubtractionTrick(hist_[cright], hist_[cleft], hist_[nid]);
+      } else {
+        BuildHist(gpair, row_set_collection_[cright], gmat, gmatb, feat_set, hist_[cright]);
+        SubtractionTrick(hist_[cleft], hist_[cright], hist_[nid]);
+      }
+      // only the children are split further
+      hist_.FreeHistRow(nid);
+    }
+
+    // build the histograms of the children of all split nodes of a level, the
+    // smaller children in one pass over their rows and the others by subtraction
+    inline void BuildLevelHist(const std::vector<int>& split_nodes,
+                               const GHistIndexMatrix& gmat,
+                               const std::vector<GradientPair>& gpair,
+                               const RegTree& tree) {
+      level_rows_.clear();
+      level_hists_.clear();
+      for (int nid : split_nodes) {
+        hist_.AddHistRow(tree[nid].LeftChild());
+        hist_.AddHistRow(tree[nid].RightChild());
+      }
+      for (int nid : split_nodes) {
+        const int cleft = tree[nid].LeftChild();
+        const int cright = tree[nid].RightChild();
+        const int build = row_set_collection_[cleft].Size() < row_set_collection_[cright].Size() ?
+            cleft : cright;
+        level_rows_.push_back(row_set_collection_[build]);
+        level_hists_.push_back(hist_[build]);
+      }
+      if (fhparam_.quantize_gradient > 0) {
+        hist_builder_.BuildHists(qgpair_, level_rows_, gmat, level_hists_);
+      } else {
+        hist_builder_.BuildHists(gpair, level_rows_, gmat, level_hists_);
+      }
+      for (size_t i = 0; i < split_nodes.size(); ++i) {
+        const int nid = split_nodes[i];
+        const int cleft = tree[nid].LeftChild();
+        const int sibling = level_rows_[i].node_id == cleft ? tree[nid].RightChild() : cleft;
+        SubtractionTrick(hist_[sibling], level_hists_[i], hist_[nid]);
+        hist_.FreeHistRow(nid);
+      }
+    }
+
     inline void SubtractionTrick(GHistRow self, GHistRow sibling, GHistRow parent) {
       hist_builder_.SubtractionTrick(self, sibling, parent);
     }
@@ -318,6 +451,10 @@ class FastHistMaker: public TreeUpdater {
       if (!p_last_fmat_ || !p_last_tree_ || data != p_last_fmat_) {
         return false;
       }
+      // the deleted rows are in no row set, their predictions are not updated
+      if (row_set_collection_.row_indices_.size() != data->Info().num_row_) {
+        return false;
+      }
 
       if (leaf_value_cache_.empty()) {
         leaf_value_cache_.resize(p_last_tree_->param.num_nodes,
@@ -373,7 +510,7 @@ class FastHistMaker: public TreeUpdater {
         leaf_value_cache_.clear();
         // initialize histogram collection
         uint32_t nbins = gmat.cut.row_ptr.back();
-        hist_.Init(nbins);
+        hist_.Init(nbins, static_cast<size_t>(fhparam_.max_hist_memory_mb) << 20);
 
         // initialize histogram builder
         #pragma omp parallel
@@ -429,14 +566,10 @@ class FastHistMaker: public TreeUpdater {
         // initialize feature index
         auto ncol = static_cast<bst_uint>(info.num_col_);
         feat_index_.clear();
-        if (data_layout_ == kDenseDataOneBased) {
-          for (bst_uint i = 1; i < ncol; ++i) {
-            feat_index_.push_back(i);
-          }
-        } else {
-          for (bst_uint i = 0; i < ncol; ++i) {
-            feat_index_.push_back(i);
-          }
+        // the features that can not split are left out
+        const bst_uint first = data_layout_ == kDenseDataOneBased ? 1 : 0;
+        for (bst_uint i = first; i < ncol; ++i) {
+          if (info.IsSplitFeature(i)) feat_index_.push_back(i);
         }
         bst_uint n = std::max(static_cast<bst_uint>(1),
                               static_cast<bst_uint>(param_.colsample_bytree * feat_index_.size()));
@@ -488,6 +621,9 @@ class FastHistMaker: public TreeUpdater {
       const auto nfeature = static_cast<bst_uint>(feat_set.size());
       const auto nthread = static_cast<bst_omp_uint>(this->nthread_);
       best_split_tloc_.resize(nthread);
+      if (robust_) {
+        prefix_tloc_.resize(nthread);
+      }
       #pragma omp parallel for schedule(static) num_threads(nthread)
       for (bst_omp_uint tid = 0; tid < nthread; ++tid) {
         best_split_tloc_[tid] = snode_[nid].best;
@@ -496,6 +632,11 @@ class FastHistMaker: public TreeUpdater {
       for (bst_omp_uint i = 0; i < nfeature; ++i) {
         const bst_uint fid = feat_set[i];
         const unsigned tid = omp_get_thread_num();
+        if (robust_) {
+          this->EnumerateRobustSplit(gmat, hist[nid], snode_[nid],
+            &best_split_tloc_[tid], &prefix_tloc_[tid], fid, nid);
+          continue;
+        }
         this->EnumerateSplit(-1, gmat, hist[nid], snode_[nid], info,
           &best_split_tloc_[tid], fid, nid);
         this->EnumerateSplit(+1, gmat, hist[nid], snode_[nid], info,
@@ -716,6 +857,14 @@ class FastHistMaker: public TreeUpdater {
             const GHistEntry et = hist.begin[i];
             stats.Add(et.sum_grad, et.sum_hess);
           }
+        } else if (fhparam_.quantize_gradient > 0) {
+          // the sums of the histograms, so that the split statistics agree
+          const RowSetCollection::Elem e = row_set_collection_[nid];
+          common::GHistEntryInt sum;
+          for (const size_t* it = e.begin; it < e.end; ++it) {
+            sum.Add(qgpair_[*it]);
+          }
+          stats.Add(sum.sum_grad * qgpair_.GradScale(), sum.sum_hess * qgpair_.HessScale());
         } else {
           const RowSetCollection::Elem e = row_set_collection_[nid];
           for (const size_t* it = e.begin; it < e.end; ++it) {
@@ -808,6 +957,107 @@ class FastHistMaker: public TreeUpdater {
       p_best->Update(best);
     }
 
+    /*!
+     * \brief enumerate the split values of specific feature, using the
+     *  eps-robust worst-case gain of RobustColMaker.
+     *
+     *  For a threshold t = cut[i], bins lying entirely below t - eps are
+     *  certainly left, bins whose lower bound is at least t + eps are
+     *  certainly right, and the bins in between form the uncertain band
+     *  [t - eps, t + eps). The gain of a candidate is the minimum over the
+     *  natural assignment, putting all uncertain bins left, putting all of
+     *  them right, and swapping the two halves of the band. Both default
+     *  directions are tried for the missing values, which are never perturbed.
+     */
+    inline void EnumerateRobustSplit(const GHistIndexMatrix& gmat,
+                                     const GHistRow& hist,
+                                     const NodeEntry& snode,
+                                     SplitEntry* p_best,
+                                     std::vector<GHistEntry>* p_prefix,
+                                     bst_uint fid,
+                                     bst_uint nodeID) {
+      const std::vector<uint32_t>& cut_ptr = gmat.cut.row_ptr;
+      const std::vector<bst_float>& cut_val = gmat.cut.cut;
+      const auto eps = static_cast<bst_float>(param_.robust_eps);
+
+      const uint32_t ibegin = cut_ptr[fid];
+      const uint32_t iend = cut_ptr[fid + 1];
+      if (ibegin == iend) return;
+      const uint32_t nbins = iend - ibegin;
+
+      // inclusive prefix sums over the bins of this feature
+      std::vector<GHistEntry>& prefix = *p_prefix;
+      prefix.resize(nbins);
+      GHistEntry acc;
+      for (uint32_t k = 0; k < nbins; ++k) {
+        acc.Add(hist.begin[ibegin + k]);
+        prefix[k] = acc;
+      }
+      // sum of the first k bins
+      auto head = [&prefix](uint32_t k) {
+        return k == 0 ? GHistEntry() : prefix[k - 1];
+      };
+      GHistEntry missing;
+      missing.sum_grad = snode.stats.sum_grad - acc.sum_grad;
+      missing.sum_hess = snode.stats.sum_hess - acc.sum_hess;
+
+      GradStats left(param_), right(param_);
+      // gain of moving the first bins described by `left_bins` to the left
+      auto gain = [&](const GHistEntry& left_bins, bool default_left) {
+        left.Clear();
+        left.Add(left_bins.sum_grad, left_bins.sum_hess);
+        if (default_left) left.Add(missing.sum_grad, missing.sum_hess);
+        right.SetSubstract(snode.stats, left);
+        return static_cast<bst_float>(
+            spliteval_->ComputeSplitScore(nodeID, fid, left, right) -
+            snode.root_gain);
+      };
+
+      SplitEntry best;
+      // [0, lo) certainly left, [lo, hi) uncertain, [hi, nbins) certainly right
+      uint32_t lo = 0, hi = 0;
+      // the last cut is the maximum value and does not yield a split
+      for (uint32_t i = 0; i + 1 < nbins; ++i) {
+        const bst_float split_pt = cut_val[ibegin + i];
+        while (lo < nbins && cut_val[ibegin + lo] <= split_pt - eps) ++lo;
+        // lower bound of bin j is cut[j - 1]
+        if (hi < i + 1) hi = i + 1;
+        while (hi < nbins && cut_val[ibegin + hi - 1] < split_pt + eps) ++hi;
+
+        const GHistEntry natural = prefix[i];
+        const bool uncertain = lo < hi;
+        GHistEntry all_left, all_right, swap;
+        if (uncertain) {
+          all_left = head(hi);
+          all_right = head(lo);
+          swap.SetSubtract(head(hi), natural);
+          swap.Add(all_right);
+        }
+        for (int dir = 0; dir < 2; ++dir) {
+          const bool default_left = dir == 1;
+          // default_direction: 0 learn, 1 left, 2 right
+          if ((default_left && param_.default_direction == 2) ||
+              (!default_left && param_.default_direction == 1)) {
+            continue;
+          }
+          const double lhess = natural.sum_hess +
+                               (default_left ? missing.sum_hess : 0.0);
+          if (lhess < param_.min_child_weight ||
+              snode.stats.sum_hess - lhess < param_.min_child_weight) {
+            continue;
+          }
+          bst_float loss_chg = gain(natural, default_left);
+          if (uncertain) {
+            loss_chg = std::min(loss_chg, gain(all_left, default_left));
+            loss_chg = std::min(loss_chg, gain(all_right, default_left));
+            loss_chg = std::min(loss_chg, gain(swap, default_left));
+          }
+          best.Update(loss_chg, fid, split_pt, default_left);
+        }
+      }
+      p_best->Update(best);
+    }
+
     /* tree growing policies */
     struct ExpandEntry {
       int nid;
@@ -844,6 +1094,8 @@ class FastHistMaker: public TreeUpdater {
     // the temp space for split
     std::vector<RowSetCollection::Split> row_split_tloc_;
     std::vector<SplitEntry> best_split_tloc_;
+    // per thread prefix sums of a feature histogram, used by robust enumeration
+    std::vector<std::vector<GHistEntry> > prefix_tloc_;
     /*! \brief TreeNode Data: statistics for each constructed node */
     std::vector<NodeEntry> snode_;
     /*! \brief culmulative histogram of gradients. */
@@ -855,8 +1107,12 @@ class FastHistMaker: public TreeUpdater {
     std::vector<float> leaf_value_cache_;
 
     GHistBuilder hist_builder_;
+    // gradient of the current round quantized to int16, with quantize_gradient
+    common::QuantizedGradient qgpair_;
     std::unique_ptr<TreeUpdater> pruner_;
     std::unique_ptr<SplitEvaluator> spliteval_;
+    // time and hardware events of the phases, with debug_verbose
+    common::Monitor monitor_;
 
     // back pointers to tree and data matrix
     const RegTree* p_last_tree_;
@@ -866,9 +1122,14 @@ class FastHistMaker: public TreeUpdater {
         std::priority_queue<ExpandEntry, std::vector<ExpandEntry>,
                             std::function<bool(ExpandEntry, ExpandEntry)>>;
     std::unique_ptr<ExpandQueue> qexpand_;
+    // the rows and histograms of the children built in a level pass
+    std::vector<RowSetCollection::Elem> level_rows_;
+    std::vector<GHistRow> level_hists_;
 
     enum DataLayout { kDenseDataZeroBased, kDenseDataOneBased, kSparseData };
     DataLayout data_layout_;
+    // whether to use robust split enumeration
+    bool robust_;
   };
 
   std::unique_ptr<Builder> builder_;
@@ -882,5 +1143,11 @@ XGBOOST_REGISTER_TREE_UPDATER(FastHistMaker, "grow_fast_histmaker")
     return new FastHistMaker();
   });
 
+XGBOOST_REGISTER_TREE_UPDATER(RobustFastHistMaker, "robust_grow_fast_histmaker")
+.describe("Grow robust tree using quantized histogram.")
+.set_body([]() {
+    return new FastHistMaker(true);
+  });
+
 }  // namespace tree
 }  // namespace xgboost
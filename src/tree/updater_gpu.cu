@@ -280,11 +280,99 @@ DEV_INLINE void atomicArgMax(ExactSplitCandidate* address,
   } while (assumed != old);
 }
 
+/**
+ * @brief First index in [begin, end) whose element is not before the element
+ *  at key, for the node-ids sorted within a column (unused nodes sort last)
+ * @param upper whether to skip the elements equal to the key too
+ */
+DEV_INLINE int nodeBound(const NodeIdT* nodeAssigns, int begin, int end,
+                         NodeIdT key, bool upper) {
+  unsigned k = static_cast<unsigned>(key);
+  while (begin < end) {
+    int middle = begin + (end - begin) / 2;
+    unsigned m = static_cast<unsigned>(nodeAssigns[middle]);
+    if (m < k || (upper && m == k)) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return begin;
+}
+
+/** @brief First index in [begin, end) of the sorted vals not less than v */
+DEV_INLINE int valueBound(const float* vals, int begin, int end, float v) {
+  while (begin < end) {
+    int middle = begin + (end - begin) / 2;
+    if (vals[middle] < v) {
+      begin = middle + 1;
+    } else {
+      end = middle;
+    }
+  }
+  return begin;
+}
+
+/**
+ * @brief Loss change of the split at the feature value of element id, the
+ *  elements before it in its node segment going left. With eps > 0 it is the
+ *  eps-robust worst case of robust_exact: binary searches over the sorted
+ *  segment give the window [lo, hi) of the values in [v - eps, v + eps), and
+ *  the loss is the minimum over the natural split, the whole window left,
+ *  the whole window right and its two halves swapped, each read from the
+ *  exclusive scans.
+ * @param colSum gradient sum of the segment
+ * @param missing gradient sum of the rows of the node missing the feature
+ * @param missingLeft whether the missing values should go left
+ */
+DEV_INLINE float robustLossChangeMissing(
+    int id, const GradientPair* gradScans, GradientPair colSum,
+    GradientPair missing, const DeviceNodeStats& n, const float* vals,
+    const int* colIds, const int* colOffsets, const NodeIdT* nodeAssigns,
+    float eps, const GPUTrainingParam& param, bool& missingLeft) {  // NOLINT
+  GradientPair natural = gradScans[id];
+  if (eps <= 0.0f) {
+    return LossChangeMissing(natural, missing, n.sum_gradients, n.root_gain,
+                             param, missingLeft);
+  }
+  int colId = colIds[id];
+  int begin = nodeBound(nodeAssigns, colOffsets[colId], id, nodeAssigns[id],
+                        false);
+  int end = nodeBound(nodeAssigns, id, colOffsets[colId + 1], nodeAssigns[id],
+                      true);
+  float v = vals[id];
+  // [begin, lo) certainly left, [lo, hi) uncertain, [hi, end) certainly right
+  int lo = valueBound(vals, begin, id, v - eps);
+  int hi = valueBound(vals, id, end, v + eps);
+  GradientPair allLeft = hi < end ? gradScans[hi] : colSum;
+  GradientPair allRight = gradScans[lo];
+  GradientPair swap = allLeft - natural + allRight;
+  float loss[2];
+  for (int dir = 0; dir < 2; ++dir) {
+    GradientPair extra = dir == 1 ? missing : GradientPair();
+    float l = DeviceCalcLossChange(param, natural + extra, n.sum_gradients,
+                                   n.root_gain);
+    if (lo < hi) {
+      l = fminf(l, DeviceCalcLossChange(param, allLeft + extra,
+                                        n.sum_gradients, n.root_gain));
+      l = fminf(l, DeviceCalcLossChange(param, allRight + extra,
+                                        n.sum_gradients, n.root_gain));
+      l = fminf(l, DeviceCalcLossChange(param, swap + extra, n.sum_gradients,
+                                        n.root_gain));
+    }
+    loss[dir] = l;
+  }
+  // ties send the missing values left, as LossChangeMissing does
+  missingLeft = loss[1] >= loss[0];
+  return missingLeft ? loss[1] : loss[0];
+}
+
 DEV_INLINE void argMaxWithAtomics(
     int id, ExactSplitCandidate* nodeSplits, const GradientPair* gradScans,
     const GradientPair* gradSums, const float* vals, const int* colIds,
-    const NodeIdT* nodeAssigns, const DeviceNodeStats* nodes, int nUniqKeys,
-    NodeIdT nodeStart, int len, const GPUTrainingParam& param) {
+    const int* colOffsets, const NodeIdT* nodeAssigns,
+    const DeviceNodeStats* nodes, int nUniqKeys, NodeIdT nodeStart, int len,
+    float eps, const GPUTrainingParam& param) {
   int nodeId = nodeAssigns[id];
   // @todo: this is really a bad check! but will be fixed when we move
   //  to key-based reduction
@@ -296,13 +384,12 @@ DEV_INLINE void argMaxWithAtomics(
       GradientPair colSum = gradSums[sumId];
       int uid = nodeId - nodeStart;
       DeviceNodeStats n = nodes[nodeId];
-      GradientPair parentSum = n.sum_gradients;
-      float parentGain = n.root_gain;
       bool tmp;
       ExactSplitCandidate s;
-      GradientPair missing = parentSum - colSum;
-      s.score = LossChangeMissing(gradScans[id], missing, parentSum, parentGain,
-                                 param, tmp);
+      GradientPair missing = n.sum_gradients - colSum;
+      s.score = robustLossChangeMissing(id, gradScans, colSum, missing, n, vals,
+                                        colIds, colOffsets, nodeAssigns, eps,
+                                        param, tmp);
       s.index = id;
       atomicArgMax(nodeSplits + uid, s);
     }  // end if nodeId != UNUSED_NODE
@@ -312,22 +399,24 @@ DEV_INLINE void argMaxWithAtomics(
 __global__ void atomicArgMaxByKeyGmem(
     ExactSplitCandidate* nodeSplits, const GradientPair* gradScans,
     const GradientPair* gradSums, const float* vals, const int* colIds,
-    const NodeIdT* nodeAssigns, const DeviceNodeStats* nodes, int nUniqKeys,
-    NodeIdT nodeStart, int len, const TrainParam param) {
+    const int* colOffsets, const NodeIdT* nodeAssigns,
+    const DeviceNodeStats* nodes, int nUniqKeys, NodeIdT nodeStart, int len,
+    float eps, const TrainParam param) {
   int id = threadIdx.x + (blockIdx.x * blockDim.x);
   const int stride = blockDim.x * gridDim.x;
   for (; id < len; id += stride) {
     argMaxWithAtomics(id, nodeSplits, gradScans, gradSums, vals, colIds,
-                      nodeAssigns, nodes, nUniqKeys, nodeStart, len,
-                      GPUTrainingParam(param));
+                      colOffsets, nodeAssigns, nodes, nUniqKeys, nodeStart,
+                      len, eps, GPUTrainingParam(param));
   }
 }
 
 __global__ void atomicArgMaxByKeySmem(
     ExactSplitCandidate* nodeSplits, const GradientPair* gradScans,
     const GradientPair* gradSums, const float* vals, const int* colIds,
-    const NodeIdT* nodeAssigns, const DeviceNodeStats* nodes, int nUniqKeys,
-    NodeIdT nodeStart, int len, const GPUTrainingParam param) {
+    const int* colOffsets, const NodeIdT* nodeAssigns,
+    const DeviceNodeStats* nodes, int nUniqKeys, NodeIdT nodeStart, int len,
+    float eps, const GPUTrainingParam param) {
   extern __shared__ char sArr[];
   ExactSplitCandidate* sNodeSplits =
       reinterpret_cast<ExactSplitCandidate*>(sArr);
@@ -342,7 +431,8 @@ __global__ void atomicArgMaxByKeySmem(
   const int stride = blockDim.x * gridDim.x;
   for (; id < len; id += stride) {
     argMaxWithAtomics(id, sNodeSplits, gradScans, gradSums, vals, colIds,
-                      nodeAssigns, nodes, nUniqKeys, nodeStart, len, param);
+                      colOffsets, nodeAssigns, nodes, nUniqKeys, nodeStart,
+                      len, eps, param);
   }
   __syncthreads();
   for (int i = tid; i < nUniqKeys; i += blockDim.x) {
@@ -359,21 +449,23 @@ __global__ void atomicArgMaxByKeySmem(
  * @param gradSums gradient sum for each column in DMatrix based on to node-ids
  * @param vals feature values
  * @param colIds column index for each element in the feature values array
+ * @param colOffsets column offsets for the feature values
  * @param nodeAssigns node-id assignments to each element in DMatrix
  * @param nodes pointer to all nodes for this tree in BFS order
  * @param nUniqKeys number of unique node-ids in this level
  * @param nodeStart start index of the node-ids in this level
  * @param len number of elements
+ * @param eps robust_eps of the robust worst-case gain, 0 for the plain gain
  * @param param training parameters
  * @param algo which algorithm to use for argmax_by_key
  */
 template <int BLKDIM = 256, int ITEMS_PER_THREAD = 4>
 void argMaxByKey(ExactSplitCandidate* nodeSplits, const GradientPair* gradScans,
                  const GradientPair* gradSums, const float* vals,
-                 const int* colIds, const NodeIdT* nodeAssigns,
-                 const DeviceNodeStats* nodes, int nUniqKeys,
-                 NodeIdT nodeStart, int len, const TrainParam param,
-                 ArgMaxByKeyAlgo algo) {
+                 const int* colIds, const int* colOffsets,
+                 const NodeIdT* nodeAssigns, const DeviceNodeStats* nodes,
+                 int nUniqKeys, NodeIdT nodeStart, int len, float eps,
+                 const TrainParam param, ArgMaxByKeyAlgo algo) {
   dh::FillConst<ExactSplitCandidate, BLKDIM, ITEMS_PER_THREAD>(
       dh::GetDeviceIdx(param.gpu_id), nodeSplits, nUniqKeys,
       ExactSplitCandidate());
@@ -381,14 +473,15 @@ void argMaxByKey(ExactSplitCandidate* nodeSplits, const GradientPair* gradScans,
   switch (algo) {
     case kAbkGmem:
       atomicArgMaxByKeyGmem<<<nBlks, BLKDIM>>>(
-          nodeSplits, gradScans, gradSums, vals, colIds, nodeAssigns, nodes,
-          nUniqKeys, nodeStart, len, param);
+          nodeSplits, gradScans, gradSums, vals, colIds, colOffsets,
+          nodeAssigns, nodes, nUniqKeys, nodeStart, len, eps, param);
       break;
     case kAbkSmem:
       atomicArgMaxByKeySmem<<<nBlks, BLKDIM,
                               sizeof(ExactSplitCandidate) * nUniqKeys>>>(
-          nodeSplits, gradScans, gradSums, vals, colIds, nodeAssigns, nodes,
-          nUniqKeys, nodeStart, len, GPUTrainingParam(param));
+          nodeSplits, gradScans, gradSums, vals, colIds, colOffsets,
+          nodeAssigns, nodes, nUniqKeys, nodeStart, len, eps,
+          GPUTrainingParam(param));
       break;
     default:
       throw std::runtime_error("argMaxByKey: Bad algo passed!");
@@ -474,6 +567,8 @@ class GPUMaker : public TreeUpdater {
   TrainParam param;
   /** whether we have initialized memory already (so as not to repeat!) */
   bool allocated;
+  /** whether to evaluate splits with the eps-robust worst-case gain */
+  bool robust;
   /** feature values stored in column-major compressed format */
   dh::DVec2<float> vals;
   dh::DVec<float> vals_cached;
@@ -507,7 +602,11 @@ class GPUMaker : public TreeUpdater {
   dh::BulkAllocator<dh::MemoryType::kDevice> ba;
 
  public:
-  GPUMaker() : allocated(false) {}
+  /**
+   * @param robust whether to evaluate splits with the eps-robust worst-case
+   *  gain used by robust_exact
+   */
+  explicit GPUMaker(bool robust = false) : allocated(false), robust(robust) {}
   ~GPUMaker() {}
 
   void Init(
@@ -567,10 +666,12 @@ class GPUMaker : public TreeUpdater {
     auto d_gradSums = gradSums.Data();
     auto d_nodeAssigns = nodeAssigns.Current();
     auto d_colIds = colIds.Data();
+    auto d_colOffsets = colOffsets.Data();
     auto d_vals = vals.Current();
     auto d_nodeSplits = nodeSplits.Data();
     int nUniqKeys = nNodes;
     float min_split_loss = param.min_split_loss;
+    float eps = robustEps();
     auto gpu_param = GPUTrainingParam(param);
 
     dh::LaunchN(param.gpu_id, nNodes, [=] __device__(int uid) {
@@ -588,8 +689,9 @@ class GPUMaker : public TreeUpdater {
         int colId = d_colIds[idx];
         // get the default direction for the current node
         GradientPair missing = n.sum_gradients - gradSum;
-        LossChangeMissing(gradScan, missing, n.sum_gradients, n.root_gain,
-                         gpu_param, missingLeft);
+        robustLossChangeMissing(idx, d_gradScans, gradSum, missing, n, d_vals,
+                                d_colIds, d_colOffsets, d_nodeAssigns, eps,
+                                gpu_param, missingLeft);
         // get the score/weight/id/gradSum for left and right child nodes
         GradientPair lGradSum = missingLeft ? gradScan + missing : gradScan;
         GradientPair rGradSum = n.sum_gradients - lGradSum;
@@ -616,12 +718,15 @@ class GPUMaker : public TreeUpdater {
                     nCols, tmpScanGradBuff.Data(), tmpScanKeyBuff.Data(),
                     colIds.Data(), nodeStart);
     argMaxByKey(nodeSplits.Data(), gradScans.Data(), gradSums.Data(),
-                vals.Current(), colIds.Data(), nodeAssigns.Current(),
-                nodes.Data(), nNodes, nodeStart, nVals, param,
+                vals.Current(), colIds.Data(), colOffsets.Data(),
+                nodeAssigns.Current(), nodes.Data(), nNodes, nodeStart, nVals,
+                robustEps(), param,
                 level <= kMaxAbkLevels ? kAbkSmem : kAbkGmem);
     split2node(nNodes, nodeStart);
   }
 
+  float robustEps() const { return robust ? param.robust_eps : 0.0f; }
+
   void allocateAllData(int offsetSize) {
     int tmpBuffSize = ScanTempBufferSize(nVals);
     ba.Allocate(dh::GetDeviceIdx(param.gpu_id), param.silent, &vals, nVals,
@@ -759,5 +864,9 @@ XGBOOST_REGISTER_TREE_UPDATER(GPUMaker, "grow_gpu")
     .describe("Grow tree with GPU.")
     .set_body([]() { return new GPUMaker(); });
 
+XGBOOST_REGISTER_TREE_UPDATER(RobustGPUMaker, "robust_grow_gpu")
+    .describe("Grow robust tree with GPU, exact split enumeration.")
+    .set_body([]() { return new GPUMaker(true); });
+
 }  // namespace tree
 }  // namespace xgboost
@@ -18,6 +18,7 @@
 #include "../common/device_helpers.cuh"
 #include "../common/hist_util.h"
 #include "../common/host_device_vector.h"
+#include "../common/sync.h"
 #include "../common/timer.h"
 #include "param.h"
 #include "updater_gpu_common.cuh"
@@ -166,6 +167,191 @@ __global__ void evaluate_split_kernel(
   }
 }
 
+// Number of values of the sorted array cuts[0, n) that are less than v
+__device__ int CountLess(const float* cuts, int n, float v) {
+  int left = 0, right = n;
+  while (left < right) {
+    int middle = left + (right - left) / 2;
+    if (cuts[middle] < v) {
+      left = middle + 1;
+    } else {
+      right = middle;
+    }
+  }
+  return left;
+}
+
+/**
+ * \brief Evaluate the splits of a feature with the eps-robust worst-case gain,
+ *  see EnumerateRobustSplit of robust_grow_fast_histmaker.
+ *
+ *  The block first writes the exclusive prefix sums of the bins into d_prefix.
+ *  A thread then takes the threshold t = cut[k - 1], which sends the first k
+ *  bins left. Binary searches over the cuts give the window of the uncertain
+ *  bins [lo, hi), which are neither entirely below t - eps nor entirely at or
+ *  above t + eps. The gain is the minimum over the natural split, all
+ *  uncertain bins left, all of them right and the two halves of the window
+ *  swapped, each read from the prefix sums.
+ */
+template <int BLOCK_THREADS, typename ReduceT, typename scan_t,
+          typename max_ReduceT, typename TempStorageT>
+__device__ void EvaluateRobustFeature(int fidx, const GradientPairSumT* hist,
+                                      GradientPairSumT* d_prefix,
+                                      const int* feature_segments,
+                                      const float* gidx_fvalue_map,
+                                      DeviceSplitCandidate* best_split,
+                                      const DeviceNodeStats& node,
+                                      const GPUTrainingParam& param,
+                                      TempStorageT* temp_storage, int constraint,
+                                      const ValueConstraint& value_constraint,
+                                      float eps, int default_direction) {
+  int gidx_begin = feature_segments[fidx];
+  int gidx_end = feature_segments[fidx + 1];
+  int n_bins = gidx_end - gidx_begin;
+  const float* cuts = gidx_fvalue_map + gidx_begin;
+
+  GradientPairSumT feature_sum = ReduceFeature<BLOCK_THREADS, ReduceT>(
+      hist + gidx_begin, hist + gidx_end, temp_storage);
+
+  auto prefix_op = SumCallbackOp<GradientPairSumT>();
+  for (int scan_begin = gidx_begin; scan_begin < gidx_end;
+       scan_begin += BLOCK_THREADS) {
+    bool thread_active = scan_begin + threadIdx.x < gidx_end;
+    GradientPairSumT bin =
+        thread_active ? hist[scan_begin + threadIdx.x] : GradientPairSumT();
+    scan_t(temp_storage->scan).ExclusiveScan(bin, bin, cub::Sum(), prefix_op);
+    if (thread_active) {
+      d_prefix[scan_begin + threadIdx.x] = bin;
+    }
+    __syncthreads();
+  }
+  GradientPairSumT parent_sum = GradientPairSumT(node.sum_gradients);
+  GradientPairSumT missing = parent_sum - feature_sum;
+  // sum of the first m bins of the feature
+  auto head = [&](int m) {
+    return m < n_bins ? d_prefix[gidx_begin + m] : feature_sum;
+  };
+  auto split_gain = [&](const GradientPairSumT& left) {
+    return static_cast<float>(
+        value_constraint.CalcSplitGain(param, constraint, GradStats(left),
+                                       GradStats(parent_sum - left)) -
+        node.root_gain);
+  };
+
+  // the last cut is the maximum value and does not yield a split
+  for (int scan_begin = 1; scan_begin < n_bins; scan_begin += BLOCK_THREADS) {
+    int k = scan_begin + threadIdx.x;
+    bool thread_active = k < n_bins;
+    const float null_gain = -FLT_MAX;
+    float gain = null_gain;
+    bool missing_left = true;
+    GradientPairSumT natural;
+    float split_pt = 0.0f;
+    if (thread_active) {
+      split_pt = cuts[k - 1];
+      natural = head(k);
+      // [0, lo) certainly left, [lo, hi) uncertain, [hi, n_bins) certainly right
+      int lo = dh::UpperBound(cuts, n_bins, split_pt - eps);
+      int hi = max(k, min(n_bins, CountLess(cuts, n_bins, split_pt + eps) + 1));
+      bool uncertain = lo < hi;
+      GradientPairSumT all_left = head(hi);
+      GradientPairSumT all_right = head(lo);
+      GradientPairSumT swap = all_left - natural + all_right;
+      for (int dir = 0; dir < 2; ++dir) {
+        bool default_left = dir == 1;
+        // default_direction: 0 learn, 1 left, 2 right
+        if ((default_left && default_direction == 2) ||
+            (!default_left && default_direction == 1)) {
+          continue;
+        }
+        GradientPairSumT extra = default_left ? missing : GradientPairSumT();
+        GradientPairSumT left = natural + extra;
+        if (left.GetHess() < param.min_child_weight ||
+            (parent_sum - left).GetHess() < param.min_child_weight) {
+          continue;
+        }
+        float loss_chg = split_gain(left);
+        if (uncertain) {
+          loss_chg = fminf(loss_chg, split_gain(all_left + extra));
+          loss_chg = fminf(loss_chg, split_gain(all_right + extra));
+          loss_chg = fminf(loss_chg, split_gain(swap + extra));
+        }
+        // ties keep the default right direction, as SplitEntry::Update does
+        if (loss_chg > gain) {
+          gain = loss_chg;
+          missing_left = default_left;
+        }
+      }
+    }
+
+    // Find thread with best gain
+    cub::KeyValuePair<int, float> tuple(threadIdx.x, gain);
+    cub::KeyValuePair<int, float> best =
+        max_ReduceT(temp_storage->max_reduce).Reduce(tuple, cub::ArgMax());
+
+    __shared__ cub::KeyValuePair<int, float> block_max;
+    if (threadIdx.x == 0) {
+      block_max = best;
+    }
+
+    __syncthreads();
+
+    // Best thread updates split
+    if (threadIdx.x == block_max.key && thread_active) {
+      GradientPairSumT left = missing_left ? natural + missing : natural;
+      GradientPairSumT right = parent_sum - left;
+      best_split->Update(gain, missing_left ? kLeftDir : kRightDir, split_pt,
+                         fidx, GradientPair(left), GradientPair(right), param);
+    }
+    __syncthreads();
+  }
+}
+
+template <int BLOCK_THREADS>
+__global__ void evaluate_robust_split_kernel(
+    const GradientPairSumT* d_hist, GradientPairSumT* d_prefix,
+    DeviceNodeStats nodes, const int* d_feature_segments,
+    const float* d_gidx_fvalue_map, GPUTrainingParam gpu_param,
+    DeviceSplitCandidate* d_split, ValueConstraint value_constraint,
+    int* d_monotonic_constraints, float eps, int default_direction) {
+  typedef cub::KeyValuePair<int, float> ArgMaxT;
+  typedef cub::BlockScan<GradientPairSumT, BLOCK_THREADS, cub::BLOCK_SCAN_WARP_SCANS>
+      BlockScanT;
+  typedef cub::BlockReduce<ArgMaxT, BLOCK_THREADS> MaxReduceT;
+
+  typedef cub::BlockReduce<GradientPairSumT, BLOCK_THREADS> SumReduceT;
+
+  union TempStorage {
+    typename BlockScanT::TempStorage scan;
+    typename MaxReduceT::TempStorage max_reduce;
+    typename SumReduceT::TempStorage sum_reduce;
+  };
+
+  __shared__ cub::Uninitialized<DeviceSplitCandidate> uninitialized_split;
+  DeviceSplitCandidate& best_split = uninitialized_split.Alias();
+  __shared__ TempStorage temp_storage;
+
+  if (threadIdx.x == 0) {
+    best_split = DeviceSplitCandidate();
+  }
+
+  __syncthreads();
+
+  auto fidx = blockIdx.x;
+  auto constraint = d_monotonic_constraints[fidx];
+  EvaluateRobustFeature<BLOCK_THREADS, SumReduceT, BlockScanT, MaxReduceT>(
+      fidx, d_hist, d_prefix, d_feature_segments, d_gidx_fvalue_map,
+      &best_split, nodes, gpu_param, &temp_storage, constraint,
+      value_constraint, eps, default_direction);
+
+  __syncthreads();
+
+  if (threadIdx.x == 0) {
+    // Record best loss
+    d_split[fidx] = best_split;
+  }
+}
+
 // Find a gidx value for a given feature otherwise return -1 if not found
 template <typename GidxIterT>
 __device__ int BinarySearchRow(bst_uint begin, bst_uint end, GidxIterT data,
@@ -325,6 +511,9 @@ struct DeviceShard {
   int device_idx;
   int normalised_device_idx;  // Device index counting from param.gpu_id
   dh::BulkAllocator<dh::MemoryType::kDevice> ba;
+  // holds the compressed matrix when it does not fit in device memory
+  dh::BulkAllocator<dh::MemoryType::kDeviceManaged> ba_managed;
+  bool gidx_managed{false};
   dh::DVec<common::CompressedByteT> gidx_buffer;
   dh::DVec<GradientPair> gpair;
   dh::DVec2<bst_uint> ridx;  // Row index relative to this shard
@@ -346,6 +535,8 @@ struct DeviceShard {
   int n_bins;
   int null_gidx_value;
   DeviceHistogram hist;
+  // exclusive prefix sums of the node histograms, used by robust evaluation
+  thrust::device_vector<GradientPairSumT> hist_prefix;
   TrainParam param;
   bool prediction_cache_initialised;
   bool can_use_smem_atomics;
@@ -408,7 +599,19 @@ struct DeviceShard {
     CHECK(!(param.max_leaves == 0 && param.max_depth == 0))
         << "Max leaves and max depth cannot both be unconstrained for "
            "gpu_hist.";
-    ba.Allocate(device_idx, param.silent, &gidx_buffer, compressed_size_bytes);
+    // a compressed matrix beyond half of the free device memory is kept in
+    // managed memory, it is paged in from the host as the kernels read it and
+    // evicted for the node data, so only its working set takes device memory
+    gidx_managed = compressed_size_bytes > dh::AvailableMemory(device_idx) / 2;
+    if (gidx_managed) {
+      if (!param.silent) {
+        LOG(CONSOLE) << "Device " << device_idx << ": the compressed matrix of "
+                     << compressed_size_bytes << " bytes is paged from host memory";
+      }
+      ba_managed.Allocate(device_idx, param.silent, &gidx_buffer, compressed_size_bytes);
+    } else {
+      ba.Allocate(device_idx, param.silent, &gidx_buffer, compressed_size_bytes);
+    }
     gidx_buffer.Fill(0);
 
     int nbits = common::detail::SymbolBits(num_symbols);
@@ -456,6 +659,12 @@ struct DeviceShard {
     row_ptrs.shrink_to_fit();
     entries_d.resize(0);
     entries_d.shrink_to_fit();
+    if (gidx_managed) {
+      // the matrix is only read from now on, so the pages brought to the
+      // device are copies that are dropped rather than written back
+      dh::safe_cuda(cudaMemAdvise(gidx_buffer.Data(), compressed_size_bytes,
+                                  cudaMemAdviseSetReadMostly, device_idx));
+    }
 
     gidx = common::CompressedIterator<uint32_t>(gidx_buffer.Data(), num_symbols);
 
@@ -524,7 +733,9 @@ struct DeviceShard {
 
     std::fill(ridx_segments.begin(), ridx_segments.end(), Segment(0, 0));
     ridx_segments.front() = Segment(0, ridx.Size());
-    this->gpair.copy(dh_gpair->tbegin(device_idx), dh_gpair->tend(device_idx));
+    // read only, so the host copy of a CPU objective stays valid
+    thrust::device_ptr<const GradientPair> d_gpair(dh_gpair->ConstDevicePointer(device_idx));
+    this->gpair.copy(d_gpair, d_gpair + dh_gpair->DeviceSize(device_idx));
     SubsampleGradientPair(&gpair, param.subsample, row_begin_idx);
     hist.Reset();
   }
@@ -584,7 +795,7 @@ struct DeviceShard {
   }
 
   void SubtractionTrick(int nidx_parent, int nidx_histogram,
-                        int nidx_subtraction) {
+                        int nidx_subtraction, cudaStream_t stream = nullptr) {
     // Make sure histograms are already allocated
     hist.GetHistPtr(nidx_parent);
     hist.GetHistPtr(nidx_histogram);
@@ -593,7 +804,7 @@ struct DeviceShard {
     auto d_node_hist_histogram = hist.GetHistPtr(nidx_histogram);
     auto d_node_hist_subtraction = hist.GetHistPtr(nidx_subtraction);
 
-    dh::LaunchN(device_idx, hist.n_bins, [=] __device__(size_t idx) {
+    dh::LaunchN(device_idx, hist.n_bins, stream, [=] __device__(size_t idx) {
       d_node_hist_subtraction[idx] =
           d_node_hist_parent[idx] - d_node_hist_histogram[idx];
     });
@@ -722,7 +933,12 @@ class GPUHistMaker : public TreeUpdater {
  public:
   struct ExpandEntry;
 
-  GPUHistMaker() : initialised_(false), p_last_fmat_(nullptr) {}
+  /*!
+   * \param robust whether to evaluate splits with the eps-robust
+   *  worst-case gain used by robust_exact
+   */
+  explicit GPUHistMaker(bool robust = false)
+      : initialised_(false), p_last_fmat_(nullptr), robust_(robust) {}
   void Init(
       const std::vector<std::pair<std::string, std::string>>& args) override {
     param_.InitAllowUnknown(args);
@@ -738,7 +954,7 @@ class GPUHistMaker : public TreeUpdater {
       qexpand_.reset(new ExpandQueue(DepthWise));
     }
 
-    monitor_.Init("updater_gpu_hist", param_.debug_verbose);
+    monitor_.Init("updater_gpu_hist", param_.debug_verbose, param_.perf_counters);
   }
 
   void Update(HostDeviceVector<GradientPair>* gpair, DMatrix* dmat,
@@ -827,7 +1043,8 @@ class GPUHistMaker : public TreeUpdater {
     monitor_.Stop("InitDataReset", device_list_);
   }
 
-  void AllReduceHist(int nidx) {
+  // Enqueue the reduction of the histograms of nidx on the streams of reducer_
+  void AllReduceHistAsync(int nidx) {
     reducer_.GroupStart();
     for (auto& shard : shards_) {
       auto d_node_hist = shard->hist.GetHistPtr(nidx);
@@ -838,8 +1055,33 @@ class GPUHistMaker : public TreeUpdater {
           n_bins_ * (sizeof(GradientPairSumT) / sizeof(GradientPairSumT::ValueT)));
     }
     reducer_.GroupEnd();
+  }
 
+  // Sum the histograms of nidx over the rabit workers once the reduction of
+  // the process is done. Only the first shard ships its histogram, through
+  // the host, and all shards receive the sum.
+  void AllReduceHistWorkers(int nidx) {
+    auto& first = shards_.front();
+    dh::safe_cuda(cudaSetDevice(first->device_idx));
+    host_hist_.resize(n_bins_);
+    const size_t nbytes = sizeof(GradientPairSumT) * n_bins_;
+    dh::safe_cuda(cudaMemcpy(host_hist_.data(), first->hist.GetHistPtr(nidx), nbytes,
+                             cudaMemcpyDeviceToHost));
+    rabit::Allreduce<rabit::op::Sum>(
+        reinterpret_cast<GradientPairSumT::ValueT*>(host_hist_.data()),
+        n_bins_ * (sizeof(GradientPairSumT) / sizeof(GradientPairSumT::ValueT)));
+    dh::ExecuteShards(&shards_, [&](std::unique_ptr<DeviceShard>& shard) {
+        dh::safe_cuda(cudaSetDevice(shard->device_idx));
+        dh::safe_cuda(cudaMemcpy(shard->hist.GetHistPtr(nidx), host_hist_.data(), nbytes,
+                                 cudaMemcpyHostToDevice));
+      });
+  }
+
+  // NCCL within the process, then rabit across the workers
+  void AllReduceHist(int nidx) {
+    this->AllReduceHistAsync(nidx);
     reducer_.Synchronize();
+    if (rabit::IsDistributed()) this->AllReduceHistWorkers(nidx);
   }
 
   void BuildHistLeftRight(int nidx_parent, int nidx_left, int nidx_right) {
@@ -851,6 +1093,13 @@ class GPUHistMaker : public TreeUpdater {
       right_node_max_elements = (std::max)(
           right_node_max_elements, shard->ridx_segments[nidx_right].Size());
     }
+    if (rabit::IsDistributed()) {
+      // all workers must build the same child
+      uint64_t max_elements[2] = {left_node_max_elements, right_node_max_elements};
+      rabit::Allreduce<rabit::op::Max>(max_elements, 2);
+      left_node_max_elements = max_elements[0];
+      right_node_max_elements = max_elements[1];
+    }
 
     auto build_hist_nidx = nidx_left;
     auto subtraction_trick_nidx = nidx_right;
@@ -861,14 +1110,32 @@ class GPUHistMaker : public TreeUpdater {
     }
 
     dh::ExecuteShards(&shards_, [&](std::unique_ptr<DeviceShard>& shard) {
+        // allocate both children first, a later allocation may move the
+        // histogram under the reduction
+        shard->hist.GetHistPtr(subtraction_trick_nidx);
         shard->BuildHist(build_hist_nidx);
       });
 
-    this->AllReduceHist(build_hist_nidx);
+    // The host does not wait for the reduction. The streams EvaluateSplits
+    // uses for the left and right child wait for it on the device, and the
+    // subtraction runs on the stream of its child, so the evaluation of the
+    // built child overlaps the subtraction of the other.
+    this->AllReduceHistAsync(build_hist_nidx);
+    if (rabit::IsDistributed()) {
+      // the workers only see the sum of the process
+      reducer_.Synchronize();
+      this->AllReduceHistWorkers(build_hist_nidx);
+    }
 
     dh::ExecuteShards(&shards_, [&](std::unique_ptr<DeviceShard>& shard) {
+        dh::safe_cuda(cudaSetDevice(shard->device_idx));
+        auto& streams = shard->GetStreams(2);
+        for (int i = 0; i < 2; ++i) {
+          reducer_.StreamWait(shard->normalised_device_idx, streams[i]);
+        }
         shard->SubtractionTrick(nidx_parent, build_hist_nidx,
-                               subtraction_trick_nidx);
+                                subtraction_trick_nidx,
+                                streams[subtraction_trick_nidx == nidx_left ? 0 : 1]);
       });
   }
 
@@ -887,6 +1154,9 @@ class GPUHistMaker : public TreeUpdater {
     auto d_split = shard->temp_memory.Pointer<DeviceSplitCandidate>();
 
     auto& streams = shard->GetStreams(static_cast<int>(nidx_set.size()));
+    if (robust_) {
+      shard->hist_prefix.resize(static_cast<size_t>(n_bins_) * nidx_set.size());
+    }
 
     // Use streams to process nodes concurrently
     for (auto i = 0; i < nidx_set.size(); i++) {
@@ -894,6 +1164,18 @@ class GPUHistMaker : public TreeUpdater {
       DeviceNodeStats node(shard->node_sum_gradients[nidx], nidx, param_);
 
       const int BLOCK_THREADS = 256;
+      if (robust_) {
+        evaluate_robust_split_kernel<BLOCK_THREADS>
+            <<<uint32_t(columns), BLOCK_THREADS, 0, streams[i]>>>(
+                shard->hist.GetHistPtr(nidx),
+                shard->hist_prefix.data().get() + static_cast<size_t>(i) * n_bins_,
+                node, shard->feature_segments.Data(),
+                shard->gidx_fvalue_map.Data(), GPUTrainingParam(param_),
+                d_split + i * columns, node_value_constraints_[nidx],
+                shard->monotone_constraints.Data(), param_.robust_eps,
+                param_.default_direction);
+        continue;
+      }
       evaluate_split_kernel<BLOCK_THREADS>
           <<<uint32_t(columns), BLOCK_THREADS, 0, streams[i]>>>(
               shard->hist.GetHistPtr(nidx), nidx, info_->num_col_, node,
@@ -936,6 +1218,11 @@ class GPUHistMaker : public TreeUpdater {
       });
     auto sum_gradient =
         std::accumulate(tmp_sums.begin(), tmp_sums.end(), GradientPair());
+    if (rabit::IsDistributed()) {
+      double sums[2] = {sum_gradient.GetGrad(), sum_gradient.GetHess()};
+      rabit::Allreduce<rabit::op::Sum>(sums, 2);
+      sum_gradient = GradientPair(static_cast<float>(sums[0]), static_cast<float>(sums[1]));
+    }
 
     // Generate root histogram
     dh::ExecuteShards(&shards_, [&](std::unique_ptr<DeviceShard>& shard) {
@@ -1159,15 +1446,23 @@ class GPUHistMaker : public TreeUpdater {
   std::unique_ptr<ExpandQueue> qexpand_;
   common::Monitor monitor_;
   dh::AllReducer reducer_;
+  // staging of a node histogram for the allreduce of rabit
+  std::vector<GradientPairSumT> host_hist_;
   std::vector<ValueConstraint> node_value_constraints_;
   std::vector<int> device_list_;
 
   DMatrix* p_last_fmat_;
   GPUSet devices_;
+  // whether to use robust split enumeration
+  bool robust_;
 };
 
 XGBOOST_REGISTER_TREE_UPDATER(GPUHistMaker, "grow_gpu_hist")
     .describe("Grow tree with GPU.")
     .set_body([]() { return new GPUHistMaker(); });
+
+XGBOOST_REGISTER_TREE_UPDATER(RobustGPUHistMaker, "robust_grow_gpu_hist")
+    .describe("Grow robust tree with GPU.")
+    .set_body([]() { return new GPUHistMaker(true); });
 }  // namespace tree
 }  // namespace xgboost
@@ -8,7 +8,11 @@
 #include <xgboost/tree_updater.h>
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
 #include "../common/sync.h"
+#include "../common/threading.h"
 #include "../common/quantile.h"
 #include "../common/group_data.h"
 #include "./updater_basemaker-inl.h"
@@ -21,10 +25,17 @@ DMLC_REGISTRY_FILE_TAG(updater_histmaker);
 template<typename TStats>
 class HistMaker: public BaseMaker {
  public:
+  /*!
+   * \param robust whether to evaluate splits with the eps-robust
+   *  worst-case gain used by robust_exact
+   */
+  explicit HistMaker(bool robust = false) : robust_(robust) {}
   void Update(HostDeviceVector<GradientPair> *gpair,
               DMatrix *p_fmat,
               const std::vector<RegTree*> &trees) override {
     TStats::CheckInfo(p_fmat->Info());
+    CHECK(!p_fmat->WideRowIds())
+        << "HistMaker: 2^32 rows or more need the exact or hist tree method";
     // rescale learning rate according to size of trees
     float lr = param_.learning_rate;
     param_.learning_rate = lr / trees.size();
@@ -99,12 +110,11 @@ class HistMaker: public BaseMaker {
     // aggregate all statistics to hset[0]
     inline void Aggregate() {
       bst_omp_uint nsize = static_cast<bst_omp_uint>(cut.size());
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < nsize; ++i) {
+      common::ParallelFor(nsize, [&](size_t i) {
         for (size_t tid = 1; tid < hset.size(); ++tid) {
           hset[0].data[i].Add(hset[tid].data[i]);
         }
-      }
+      });
     }
     /*! \brief clear the workspace */
     inline void Clear() {
@@ -121,6 +131,210 @@ class HistMaker: public BaseMaker {
   rabit::Reducer<TStats, TStats::Reduce> histred_;
   // set of working features
   std::vector<bst_uint> fwork_set_;
+  // whether to use robust split enumeration
+  bool robust_;
+  // per thread prefix sums of a feature histogram, used by robust enumeration
+  std::vector<std::vector<TStats> > prefix_tloc_;
+  // whether each cut of wspace_ is a split candidate, set beside the cuts by
+  // a proposal that adds the window bounds of the candidates; empty when all
+  // cuts are candidates
+  std::vector<uint8_t> candidate_;
+  // synced histograms of the last level and the work index of its nodes, -1
+  // for the others, kept for the subtraction of siblings
+  std::vector<TStats> last_hist_;
+  std::vector<int> last_workindex_;
+  // payloads of SyncStats
+  std::string send_buf_, recv_buf_;
+
+  /*! \brief whether the histograms are synced by SyncHist */
+  inline bool CustomSync() const {
+    return param_.hist_sync_compress || param_.hist_sync_float;
+  }
+  /*!
+   * \brief sum the histograms of the expanded nodes over the workers
+   * \param num_feature number of histograms of a node besides its statistics
+   * \param subtract whether a node may be its parent of the last level minus
+   *  its sibling, the nodes of both levels must then share their cuts
+   */
+  inline void SyncHist(const RegTree &tree, size_t num_feature, bool subtract) {
+    std::vector<TStats> &data = wspace_.hset[0].data;
+    const size_t nexpand = qexpand_.size();
+    auto node_begin = [&](size_t wid) {
+      return static_cast<size_t>(wspace_.rptr[wid * (num_feature + 1)]);
+    };
+    // work index of the sibling a node is derived from, else -1
+    std::vector<int> sibling(nexpand, -1);
+    subtract = subtract && param_.hist_sync_compress && rabit::GetWorldSize() > 1;
+    if (subtract && nexpand != 0 && tree[qexpand_[0]].IsRoot()) {
+      last_hist_.clear();
+      last_workindex_.clear();
+    }
+    for (size_t wid = 0; subtract && wid < nexpand; ++wid) {
+      const int nid = qexpand_[wid];
+      if (tree[nid].IsRoot()) continue;
+      const int parent = tree[nid].Parent();
+      if (parent >= static_cast<int>(last_workindex_.size()) ||
+          last_workindex_[parent] < 0) {
+        continue;
+      }
+      const int other = tree[nid].IsLeftChild() ? tree[parent].RightChild()
+                                                : tree[parent].LeftChild();
+      // the child with more hessian is derived, the right one on ties; the
+      // statistics are those of the split, the same on all workers
+      const double hess = tree.Stat(nid).sum_hess, other_hess = tree.Stat(other).sum_hess;
+      if (hess > other_hess || (hess == other_hess && !tree[nid].IsLeftChild())) {
+        sibling[wid] = node2workindex_[other];
+      }
+    }
+    // pack the shipped nodes
+    std::vector<TStats> buf;
+    for (size_t wid = 0; wid < nexpand; ++wid) {
+      if (sibling[wid] < 0) {
+        buf.insert(buf.end(), data.begin() + node_begin(wid), data.begin() + node_begin(wid + 1));
+      }
+    }
+    this->SyncStats(&buf);
+    size_t pos = 0;
+    for (size_t wid = 0; wid < nexpand; ++wid) {
+      if (sibling[wid] < 0) {
+        std::copy(buf.begin() + pos, buf.begin() + pos + node_begin(wid + 1) - node_begin(wid),
+                  data.begin() + node_begin(wid));
+        pos += node_begin(wid + 1) - node_begin(wid);
+      }
+    }
+    for (size_t wid = 0; wid < nexpand; ++wid) {
+      if (sibling[wid] < 0) continue;
+      const size_t begin = node_begin(wid), size = node_begin(wid + 1) - begin;
+      const size_t other = node_begin(sibling[wid]);
+      // the nodes of both levels have the same size, so the parent is the
+      // same number of nodes into the last level
+      const size_t parent = last_workindex_[tree[qexpand_[wid]].Parent()] * size;
+      CHECK_EQ(node_begin(sibling[wid] + 1) - other, size) << "siblings must share their cuts";
+      CHECK_LE(parent + size, last_hist_.size()) << "siblings must share their cuts";
+      for (size_t i = 0; i < size; ++i) {
+        data[begin + i].SetSubstract(last_hist_[parent + i], data[other + i]);
+      }
+    }
+    if (subtract) {
+      last_hist_ = data;
+      last_workindex_.assign(tree.param.num_nodes, -1);
+      for (size_t wid = 0; wid < nexpand; ++wid) {
+        last_workindex_[qexpand_[wid]] = static_cast<int>(wid);
+      }
+    }
+  }
+  /*!
+   * \brief sum stats over the workers. Every worker sends the non empty
+   *  entries of its stats, in float with hist_sync_float, unless all of them
+   *  are not smaller than the dense stats, and all workers add the payloads
+   *  in the order of their rank, so they agree on the sums.
+   */
+  inline void SyncStats(std::vector<TStats> *p_stats) {
+    std::vector<TStats> &stats = *p_stats;
+    const int world = rabit::GetWorldSize();
+    if (world == 1) return;
+    const bool use_float = param_.hist_sync_float;
+    const size_t value_bytes = use_float ? sizeof(float) : sizeof(double);
+    const size_t dense_bytes = stats.size() * 2 * value_bytes;
+    std::vector<uint64_t> sizes(world, 0);
+    if (param_.hist_sync_compress) {
+      EncodeStats(stats, use_float, &send_buf_);
+      sizes[rabit::GetRank()] = send_buf_.size();
+      rabit::Allreduce<rabit::op::Sum>(dmlc::BeginPtr(sizes), sizes.size());
+    }
+    uint64_t total = 0;
+    for (uint64_t n : sizes) total += n;
+    if (!param_.hist_sync_compress || total >= dense_bytes) {
+      if (!use_float) {
+        histred_.Allreduce(dmlc::BeginPtr(stats), stats.size());
+        return;
+      }
+      std::vector<float> values(stats.size() * 2);
+      for (size_t i = 0; i < stats.size(); ++i) {
+        values[2 * i] = static_cast<float>(stats[i].sum_grad);
+        values[2 * i + 1] = static_cast<float>(stats[i].sum_hess);
+      }
+      rabit::Allreduce<rabit::op::Sum>(dmlc::BeginPtr(values), values.size());
+      for (size_t i = 0; i < stats.size(); ++i) {
+        stats[i].sum_grad = values[2 * i];
+        stats[i].sum_hess = values[2 * i + 1];
+      }
+      return;
+    }
+    for (TStats &s : stats) s.Clear();
+    for (int r = 0; r < world; ++r) {
+      if (sizes[r] == 0) continue;
+      if (r == rabit::GetRank()) {
+        rabit::Broadcast(&send_buf_, r);
+        DecodeStats(send_buf_, use_float, &stats);
+      } else {
+        rabit::Broadcast(&recv_buf_, r);
+        DecodeStats(recv_buf_, use_float, &stats);
+      }
+    }
+  }
+  // append a little endian base 128 varint
+  inline static void PutVarint(uint64_t v, std::string *out) {
+    while (v >= 0x80) {
+      out->push_back(static_cast<char>((v & 0x7F) | 0x80));
+      v >>= 7;
+    }
+    out->push_back(static_cast<char>(v));
+  }
+  inline static uint64_t GetVarint(const std::string &in, size_t *pos) {
+    uint64_t v = 0;
+    for (int shift = 0;; shift += 7) {
+      const auto b = static_cast<uint8_t>(in[(*pos)++]);
+      v |= static_cast<uint64_t>(b & 0x7F) << shift;
+      if ((b & 0x80) == 0) return v;
+    }
+  }
+  template <typename T>
+  inline static void PutValue(T value, std::string *out) {
+    out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  template <typename T>
+  inline static T GetValue(const std::string &in, size_t *pos) {
+    T value;
+    std::memcpy(&value, in.data() + *pos, sizeof(value));
+    *pos += sizeof(value);
+    return value;
+  }
+  // encode the non empty entries, each is its gap to the previous one and
+  // its sums
+  inline static void EncodeStats(const std::vector<TStats> &stats, bool use_float,
+                                 std::string *out) {
+    out->clear();
+    size_t last = 0;
+    for (size_t i = 0; i < stats.size(); ++i) {
+      if (stats[i].sum_grad == 0.0 && stats[i].sum_hess == 0.0) continue;
+      PutVarint(i - last, out);
+      if (use_float) {
+        PutValue(static_cast<float>(stats[i].sum_grad), out);
+        PutValue(static_cast<float>(stats[i].sum_hess), out);
+      } else {
+        PutValue(stats[i].sum_grad, out);
+        PutValue(stats[i].sum_hess, out);
+      }
+      last = i;
+    }
+  }
+  // add the encoded entries to stats
+  inline static void DecodeStats(const std::string &in, bool use_float,
+                                 std::vector<TStats> *stats) {
+    size_t pos = 0, i = 0;
+    while (pos < in.size()) {
+      i += GetVarint(in, &pos);
+      CHECK_LT(i, stats->size()) << "inconsistent histogram information";
+      if (use_float) {
+        const double grad = GetValue<float>(in, &pos);
+        (*stats)[i].Add(grad, GetValue<float>(in, &pos));
+      } else {
+        const double grad = GetValue<double>(in, &pos);
+        (*stats)[i].Add(grad, GetValue<double>(in, &pos));
+      }
+    }
+  }
   // update function implementation
   virtual void Update(const std::vector<GradientPair> &gpair,
                       DMatrix *p_fmat,
@@ -211,6 +425,92 @@ class HistMaker: public BaseMaker {
       }
     }
   }
+  /*!
+   * \brief enumerate the split values of a feature with the eps-robust
+   *  worst-case gain of RobustColMaker, see EnumerateRobustSplit of
+   *  robust_grow_fast_histmaker. The histograms are summed over all workers
+   *  before this, so the gain is the one of the whole distributed data set.
+   *  The eps window of a split value is rounded out to the cuts around it,
+   *  unless the cuts hold the window bounds of every candidate.
+   * \param candidate whether each cut is a split candidate, nullptr for all
+   */
+  inline void EnumerateRobustSplit(const HistUnit &hist,
+                                   const uint8_t *candidate,
+                                   const TStats &node_sum,
+                                   bst_uint fid,
+                                   SplitEntry *best,
+                                   TStats *left_sum,
+                                   std::vector<TStats> *p_prefix) {
+    if (hist.size == 0) return;
+    const auto eps = static_cast<bst_float>(param_.robust_eps);
+    const unsigned nbins = hist.size;
+    // inclusive prefix sums over the bins of this feature
+    std::vector<TStats> &prefix = *p_prefix;
+    prefix.resize(nbins, TStats(param_));
+    TStats acc(param_);
+    for (unsigned k = 0; k < nbins; ++k) {
+      acc.Add(hist.data[k]);
+      prefix[k] = acc;
+    }
+    const TStats empty(param_);
+    // sum of the first k bins
+    auto head = [&](unsigned k) -> const TStats& {
+      return k == 0 ? empty : prefix[k - 1];
+    };
+    TStats missing(param_);
+    missing.SetSubstract(node_sum, acc);
+
+    double root_gain = node_sum.CalcGain(param_);
+    TStats left(param_), right(param_);
+    // gain of moving the bins summed in `bins` to the left
+    auto gain = [&](const TStats &bins, bool default_left) {
+      left = bins;
+      if (default_left) left.Add(missing);
+      right.SetSubstract(node_sum, left);
+      return left.CalcGain(param_) + right.CalcGain(param_) - root_gain;
+    };
+    // [0, lo) certainly left, [lo, hi) uncertain, [hi, nbins) certainly right
+    unsigned lo = 0, hi = 0;
+    for (unsigned i = 0; i < nbins; ++i) {
+      const bst_float split_pt = hist.cut[i];
+      while (lo < nbins && hist.cut[lo] <= split_pt - eps) ++lo;
+      // lower bound of bin j is cut[j - 1]
+      if (hi < i + 1) hi = i + 1;
+      while (hi < nbins && hist.cut[hi - 1] < split_pt + eps) ++hi;
+      if (candidate != nullptr && candidate[i] == 0) continue;
+
+      const TStats &natural = prefix[i];
+      const bool uncertain = lo < hi;
+      TStats swap(param_);
+      if (uncertain) {
+        swap.SetSubstract(head(hi), natural);
+        swap.Add(head(lo));
+      }
+      for (int dir = 0; dir < 2; ++dir) {
+        const bool default_left = dir == 1;
+        // default_direction: 0 learn, 1 left, 2 right
+        if ((default_left && param_.default_direction == 2) ||
+            (!default_left && param_.default_direction == 1)) {
+          continue;
+        }
+        const double lhess = natural.sum_hess + (default_left ? missing.sum_hess : 0.0);
+        if (lhess < param_.min_child_weight ||
+            node_sum.sum_hess - lhess < param_.min_child_weight) {
+          continue;
+        }
+        double loss_chg = gain(natural, default_left);
+        if (uncertain) {
+          loss_chg = std::min(loss_chg, gain(head(hi), default_left));
+          loss_chg = std::min(loss_chg, gain(head(lo), default_left));
+          loss_chg = std::min(loss_chg, gain(swap, default_left));
+        }
+        if (best->Update(static_cast<bst_float>(loss_chg), fid, split_pt, default_left)) {
+          *left_sum = natural;
+          if (default_left) left_sum->Add(missing);
+        }
+      }
+    }
+  }
   inline void FindSplit(int depth,
                         const std::vector<GradientPair> &gpair,
                         DMatrix *p_fmat,
@@ -221,17 +521,26 @@ class HistMaker: public BaseMaker {
     std::vector<SplitEntry> sol(qexpand_.size());
     std::vector<TStats> left_sum(qexpand_.size());
     auto nexpand = static_cast<bst_omp_uint>(qexpand_.size());
-    #pragma omp parallel for schedule(dynamic, 1)
-    for (bst_omp_uint wid = 0; wid < nexpand; ++wid) {
+    prefix_tloc_.resize(omp_get_max_threads());
+    common::ParallelFor(nexpand, common::Sched::Dyn(1), [&](size_t wid) {
       const int nid = qexpand_[wid];
       CHECK_EQ(node2workindex_[nid], static_cast<int>(wid));
       SplitEntry &best = sol[wid];
       TStats &node_sum = wspace_.hset[0][num_feature + wid * (num_feature + 1)].data[0];
       for (size_t i = 0; i < fset.size(); ++i) {
-        EnumerateSplit(this->wspace_.hset[0][i + wid * (num_feature+1)],
-                       node_sum, fset[i], &best, &left_sum[wid]);
+        if (robust_) {
+          const size_t unit = i + wid * (num_feature + 1);
+          EnumerateRobustSplit(this->wspace_.hset[0][unit],
+                               candidate_.empty() ? nullptr
+                                                  : &candidate_[wspace_.rptr[unit]],
+                               node_sum, fset[i], &best, &left_sum[wid],
+                               &prefix_tloc_[common::ThreadId()]);
+        } else {
+          EnumerateSplit(this->wspace_.hset[0][i + wid * (num_feature+1)],
+                         node_sum, fset[i], &best, &left_sum[wid]);
+        }
       }
-    }
+    });
     // get the best result, we can synchronize the solution
     for (bst_omp_uint wid = 0; wid < nexpand; ++wid) {
       const int nid = qexpand_[wid];
@@ -269,7 +578,7 @@ class HistMaker: public BaseMaker {
 template<typename TStats>
 class CQHistMaker: public HistMaker<TStats> {
  public:
-  CQHistMaker()  = default;
+  explicit CQHistMaker(bool robust = false) : HistMaker<TStats>(robust) {}
 
  protected:
   struct HistEntry {
@@ -315,12 +624,13 @@ class CQHistMaker: public HistMaker<TStats> {
   void InitWorkSet(DMatrix *p_fmat,
                    const RegTree &tree,
                    std::vector<bst_uint> *p_fset) override {
-    if (p_fmat != cache_dmatrix_) {
+    if (p_fmat != cache_dmatrix_ || p_fmat->Info().num_row_ != cache_num_row_) {
       feat_helper_.InitByCol(p_fmat, tree);
       cache_dmatrix_ = p_fmat;
+      cache_num_row_ = p_fmat->Info().num_row_;
     }
     feat_helper_.SyncInfo();
-    feat_helper_.SampleCol(this->param_.colsample_bytree, p_fset);
+    feat_helper_.SampleCol(this->param_.colsample_bytree, p_fmat->Info(), p_fset);
   }
   // code to create histogram
   void CreateHist(const std::vector<GradientPair> &gpair,
@@ -350,16 +660,15 @@ class CQHistMaker: public HistMaker<TStats> {
         auto batch = iter->Value();
         // start enumeration
         const auto nsize = static_cast<bst_omp_uint>(fset.size());
-        #pragma omp parallel for schedule(dynamic, 1)
-        for (bst_omp_uint i = 0; i < nsize; ++i) {
+        common::ParallelFor(nsize, common::Sched::Dyn(1), [&](size_t i) {
           int fid = fset[i];
           int offset = feat2workindex_[fid];
           if (offset >= 0) {
             this->UpdateHistCol(gpair, batch[fid], info, tree,
                                 fset, offset,
-                                &thread_hist_[omp_get_thread_num()]);
+                                &thread_hist_[common::ThreadId()]);
           }
-        }
+        });
       }
       // update node statistics.
       this->GetNodeStats(gpair, *p_fmat, tree,
@@ -371,6 +680,14 @@ class CQHistMaker: public HistMaker<TStats> {
             .data[0] = node_stats_[nid];
       }
     };
+    // the cuts are proposed per node, siblings can not be subtracted
+    if (this->CustomSync()) {
+#if __cplusplus >= 201103L
+      lazy_get_hist();
+#endif
+      this->SyncHist(tree, fset.size(), false);
+      return;
+    }
     // sync the histogram
     // if it is C++11, use lazy evaluation for Allreduce
 #if __cplusplus >= 201103L
@@ -435,16 +752,15 @@ class CQHistMaker: public HistMaker<TStats> {
 
         // start enumeration
         const auto nsize = static_cast<bst_omp_uint>(work_set_.size());
-        #pragma omp parallel for schedule(dynamic, 1)
-        for (bst_omp_uint i = 0; i < nsize; ++i) {
+        common::ParallelFor(nsize, common::Sched::Dyn(1), [&](size_t i) {
           int fid = work_set_[i];
           int offset = feat2workindex_[fid];
           if (offset >= 0) {
             this->UpdateSketchCol(gpair, batch[fid], tree,
                                   work_set_size, offset,
-                                  &thread_sketch_[omp_get_thread_num()]);
+                                  &thread_sketch_[common::ThreadId()]);
           }
-        }
+        });
       }
       for (size_t i = 0; i < sketchs_.size(); ++i) {
         common::WXQuantileSketch<bst_float, bst_float>::SummaryContainer out;
@@ -628,6 +944,8 @@ class CQHistMaker: public HistMaker<TStats> {
   }
   // cached dmatrix where we initialized the feature on.
   const DMatrix* cache_dmatrix_{nullptr};
+  // its number of rows then, rows may be appended to it
+  uint64_t cache_num_row_{0};
   // feature helper
   BaseMaker::FMetaHelper feat_helper_;
   // temp space to map feature id to working index
@@ -655,6 +973,16 @@ class CQHistMaker: public HistMaker<TStats> {
 // global proposal
 template<typename TStats>
 class GlobalProposalHistMaker: public CQHistMaker<TStats> {
+ public:
+  /*!
+   * \param robust whether to evaluate splits with the eps-robust gain
+   * \param exact_window whether the cuts also hold the eps window bounds of
+   *  the proposed candidates, so the robust gain of each candidate is the one
+   *  of robust_exact at that split value
+   */
+  explicit GlobalProposalHistMaker(bool robust = false, bool exact_window = false)
+      : CQHistMaker<TStats>(robust), exact_window_(exact_window) {}
+
  protected:
   void ResetPosAndPropose(const std::vector<GradientPair> &gpair,
                           DMatrix *p_fmat,
@@ -669,21 +997,76 @@ class GlobalProposalHistMaker: public CQHistMaker<TStats> {
       CQHistMaker<TStats>::ResetPosAndPropose(gpair, p_fmat, fset, tree);
       cached_rptr_ = this->wspace_.rptr;
       cached_cut_ = this->wspace_.cut;
-    } else {
-      this->wspace_.cut.clear();
-      this->wspace_.rptr.clear();
-      this->wspace_.rptr.push_back(0);
-      for (size_t i = 0; i < this->qexpand_.size(); ++i) {
-        for (size_t j = 0; j < cached_rptr_.size() - 1; ++j) {
-          this->wspace_.rptr.push_back(
-              this->wspace_.rptr.back() + cached_rptr_[j + 1] - cached_rptr_[j]);
+      cached_candidate_.clear();
+      if (exact_window_ && this->param_.robust_eps > 0.0f) this->AddWindowCuts();
+    }
+    this->wspace_.cut.clear();
+    this->wspace_.rptr.clear();
+    this->wspace_.rptr.push_back(0);
+    this->candidate_.clear();
+    for (size_t i = 0; i < this->qexpand_.size(); ++i) {
+      for (size_t j = 0; j < cached_rptr_.size() - 1; ++j) {
+        this->wspace_.rptr.push_back(
+            this->wspace_.rptr.back() + cached_rptr_[j + 1] - cached_rptr_[j]);
+      }
+      this->wspace_.cut.insert(this->wspace_.cut.end(), cached_cut_.begin(), cached_cut_.end());
+      this->candidate_.insert(this->candidate_.end(), cached_candidate_.begin(),
+                              cached_candidate_.end());
+    }
+    CHECK_EQ(this->wspace_.rptr.size(),
+             (fset.size() + 1) * this->qexpand_.size() + 1);
+    CHECK_EQ(this->wspace_.rptr.back(), this->wspace_.cut.size());
+  }
+  /*!
+   * \brief add split_pt - eps and split_pt + eps of each proposed cut to the
+   *  cached cuts of its feature and mark the proposed cuts as the candidates.
+   *
+   *  The proposal comes from the sketches merged over all workers, so every
+   *  worker adds the same bounds. A bin then never straddles the window of a
+   *  candidate: the window statistics of each candidate are sums of whole
+   *  bins, exact for the rows of every worker, and only these bins are summed
+   *  over the workers. The bounds are computed as EnumerateRobustSplit
+   *  computes them, in bst_float, so they compare equal there. The window of
+   *  the last cut, above all values, is cut off at it.
+   */
+  inline void AddWindowCuts() {
+    const auto eps = static_cast<bst_float>(this->param_.robust_eps);
+    std::vector<unsigned> rptr(1, 0);
+    std::vector<bst_float> cut;
+    std::vector<std::pair<bst_float, uint8_t> > unit;
+    cached_candidate_.clear();
+    for (size_t j = 0; j + 1 < cached_rptr_.size(); ++j) {
+      const unsigned begin = cached_rptr_[j], end = cached_rptr_[j + 1];
+      // the unit of the node statistics is the last one
+      if (j + 2 == cached_rptr_.size() || begin == end) {
+        for (unsigned k = begin; k < end; ++k) {
+          cut.push_back(cached_cut_[k]);
+          cached_candidate_.push_back(1);
+        }
+        rptr.push_back(static_cast<unsigned>(cut.size()));
+        continue;
+      }
+      const bst_float last = cached_cut_[end - 1];
+      unit.clear();
+      for (unsigned k = begin; k < end; ++k) {
+        const bst_float split_pt = cached_cut_[k];
+        unit.emplace_back(split_pt, 1);
+        unit.emplace_back(split_pt - eps, 0);
+        if (split_pt + eps < last) unit.emplace_back(split_pt + eps, 0);
+      }
+      std::sort(unit.begin(), unit.end());
+      for (const auto &c : unit) {
+        if (cut.size() != rptr.back() && cut.back() == c.first) {
+          cached_candidate_.back() |= c.second;
+        } else {
+          cut.push_back(c.first);
+          cached_candidate_.push_back(c.second);
         }
-        this->wspace_.cut.insert(this->wspace_.cut.end(), cached_cut_.begin(), cached_cut_.end());
       }
-      CHECK_EQ(this->wspace_.rptr.size(),
-               (fset.size() + 1) * this->qexpand_.size() + 1);
-      CHECK_EQ(this->wspace_.rptr.back(), this->wspace_.cut.size());
+      rptr.push_back(static_cast<unsigned>(cut.size()));
     }
+    cached_rptr_.swap(rptr);
+    cached_cut_.swap(cut);
   }
 
   // code to create histogram
@@ -723,16 +1106,15 @@ class GlobalProposalHistMaker: public CQHistMaker<TStats> {
 
         // start enumeration
         const auto nsize = static_cast<bst_omp_uint>(this->work_set_.size());
-        #pragma omp parallel for schedule(dynamic, 1)
-        for (bst_omp_uint i = 0; i < nsize; ++i) {
+        common::ParallelFor(nsize, common::Sched::Dyn(1), [&](size_t i) {
           int fid = this->work_set_[i];
           int offset = this->feat2workindex_[fid];
           if (offset >= 0) {
             this->UpdateHistCol(gpair, batch[fid], info, tree,
                                 fset, offset,
-                                &this->thread_hist_[omp_get_thread_num()]);
+                                &this->thread_hist_[common::ThreadId()]);
           }
-        }
+        });
       }
 
       // update node statistics.
@@ -745,6 +1127,11 @@ class GlobalProposalHistMaker: public CQHistMaker<TStats> {
             .data[0] = this->node_stats_[nid];
       }
     }
+    if (this->CustomSync()) {
+      // all nodes share the cached cuts
+      this->SyncHist(tree, fset.size(), true);
+      return;
+    }
     this->histred_.Allreduce(dmlc::BeginPtr(this->wspace_.hset[0].data),
                             this->wspace_.hset[0].data.size());
   }
@@ -753,6 +1140,10 @@ class GlobalProposalHistMaker: public CQHistMaker<TStats> {
   std::vector<unsigned> cached_rptr_;
   // cached cut value.
   std::vector<bst_float> cached_cut_;
+  // whether each cached cut is a split candidate, empty without window cuts
+  std::vector<uint8_t> cached_candidate_;
+  // whether to add the eps window bounds of the candidates to the cuts
+  bool exact_window_;
 };
 
 
@@ -781,6 +1172,8 @@ class QuantileHistMaker: public HistMaker<TStats> {
           builder(&col_ptr_, &col_data_, &thread_col_ptr_);
       builder.InitBudget(tree.param.num_feature, nthread);
 
+      // the builder takes the rows of each thread in both passes, so they stay
+      // OpenMP loops of the static schedule
       const bst_omp_uint nbatch = static_cast<bst_omp_uint>(batch.Size());
       #pragma omp parallel for schedule(static)
       for (bst_omp_uint i = 0; i < nbatch; ++i) {
@@ -816,14 +1209,13 @@ class QuantileHistMaker: public HistMaker<TStats> {
       }
       // start putting things into sketch
       const bst_omp_uint nfeat = col_ptr_.size() - 1;
-      #pragma omp parallel for schedule(dynamic, 1)
-      for (bst_omp_uint k = 0; k < nfeat; ++k) {
+      common::ParallelFor(nfeat, common::Sched::Dyn(1), [&](size_t k) {
         for (size_t i = col_ptr_[k]; i < col_ptr_[k+1]; ++i) {
           const Entry &e = col_data_[i];
           const int wid = this->node2workindex_[e.index];
           sketchs_[wid * tree.param.num_feature + k].Push(e.fvalue, gpair[e.index].GetHess());
         }
-      }
+      });
     }
     // setup maximum size
     unsigned max_size = this->param_.MaxSketchSize();
@@ -899,5 +1291,18 @@ XGBOOST_REGISTER_TREE_UPDATER(HistMaker, "grow_histmaker")
 .set_body([]() {
     return new GlobalProposalHistMaker<GradStats>();
   });
+
+XGBOOST_REGISTER_TREE_UPDATER(RobustHistMaker, "robust_grow_histmaker")
+.describe("Robust tree constructor that uses approximate global proposal of histogram construction.")
+.set_body([]() {
+    return new GlobalProposalHistMaker<GradStats>(true);
+  });
+
+XGBOOST_REGISTER_TREE_UPDATER(RobustDistRowMaker, "robust_distrow")
+.describe("Robust tree constructor for row-split distributed data, with the exact eps "
+          "windows of the globally proposed candidates.")
+.set_body([]() {
+    return new GlobalProposalHistMaker<GradStats>(true, true);
+  });
 }  // namespace tree
 }  // namespace xgboost
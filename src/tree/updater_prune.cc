@@ -9,6 +9,7 @@
 #include <string>
 #include <memory>
 #include "./param.h"
+#include "./prune.h"
 #include "../common/sync.h"
 #include "../common/io.h"
 
@@ -42,34 +43,14 @@ class TreePruner: public TreeUpdater {
     syncher_->Update(gpair, p_fmat, trees);
   }
 
- private:
-  // try to prune off current leaf
-  inline int TryPruneLeaf(RegTree &tree, int nid, int depth, int npruned) { // NOLINT(*)
-    if (tree[nid].IsRoot()) return npruned;
-    int pid = tree[nid].Parent();
-    RegTree::NodeStat &s = tree.Stat(pid);
-    ++s.leaf_child_cnt;
-    if (s.leaf_child_cnt >= 2 && param_.NeedPrune(s.loss_chg, depth - 1)) {
-      // need to be pruned
-      tree.ChangeToLeaf(pid, param_.learning_rate * s.base_weight);
-      // tail recursion
-      return this->TryPruneLeaf(tree, pid, depth - 1, npruned + 2);
-    } else {
-      return npruned;
-    }
+  bool OnlyDeletesNodes() const override {
+    return true;
   }
+
+ private:
   /*! \brief do pruning of a tree */
   inline void DoPrune(RegTree &tree) { // NOLINT(*)
-    int npruned = 0;
-    // initialize auxiliary statistics
-    for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
-      tree.Stat(nid).leaf_child_cnt = 0;
-    }
-    for (int nid = 0; nid < tree.param.num_nodes; ++nid) {
-      if (tree[nid].IsLeaf()) {
-        npruned = this->TryPruneLeaf(tree, nid, tree.GetDepth(nid), npruned);
-      }
-    }
+    const int npruned = PruneTree(param_, &tree);
     if (!param_.silent) {
       LOG(INFO) << "tree pruning end, " << tree.param.num_roots << " roots, "
                 << tree.NumExtraNodes() << " extra nodes, " << npruned
@@ -10,6 +10,7 @@
 #include <limits>
 #include "./param.h"
 #include "../common/sync.h"
+#include "../common/threading.h"
 #include "../common/io.h"
 
 namespace xgboost {
@@ -63,11 +64,10 @@ class TreeRefresher: public TreeUpdater {
          auto batch = iter->Value();
         CHECK_LT(batch.Size(), std::numeric_limits<unsigned>::max());
         const auto nbatch = static_cast<bst_omp_uint>(batch.Size());
-        #pragma omp parallel for schedule(static)
-        for (bst_omp_uint i = 0; i < nbatch; ++i) {
+        common::ParallelFor(nbatch, [&](size_t i) {
           SparsePage::Inst inst = batch[i];
-          const int tid = omp_get_thread_num();
-          const auto ridx = static_cast<bst_uint>(batch.base_rowid + i);
+          const int tid = common::ThreadId();
+          const size_t ridx = batch.base_rowid + i;
           RegTree::FVec &feats = fvec_temp[tid];
           feats.Fill(inst);
           int offset = 0;
@@ -77,16 +77,15 @@ class TreeRefresher: public TreeUpdater {
             offset += tree->param.num_nodes;
           }
           feats.Drop(inst);
-        }
+        });
       }
       // aggregate the statistics
       auto num_nodes = static_cast<int>(stemp[0].size());
-      #pragma omp parallel for schedule(static)
-      for (int nid = 0; nid < num_nodes; ++nid) {
+      common::ParallelFor(num_nodes, [&](size_t nid) {
         for (int tid = 1; tid < nthread; ++tid) {
           stemp[0][nid].Add(stemp[tid][nid]);
         }
-      }
+      });
     };
 #if __cplusplus >= 201103L
     reducer_.Allreduce(dmlc::BeginPtr(stemp[0]), stemp[0].size(), lazy_get_stats);
@@ -112,7 +111,7 @@ class TreeRefresher: public TreeUpdater {
                               const RegTree::FVec &feat,
                               const std::vector<GradientPair> &gpair,
                               const MetaInfo &info,
-                              const bst_uint ridx,
+                              const size_t ridx,
                               TStats *gstats) {
     // start from groups that belongs to current data
     auto pid = static_cast<int>(info.GetRoot(ridx));
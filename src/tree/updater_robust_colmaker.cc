@@ -6,24 +6,83 @@
  * \author Tianqi Chen, Hongge Chen, Huan Zhang
  */
 #include <xgboost/tree_updater.h>
+#include <dmlc/timer.h>
 #include <memory>
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+#include <sstream>
+#include <string>
 #include "./param.h"
+#include "./prune.h"
 #include "../common/random.h"
 #include "../common/bitmap.h"
+#include "../common/eps_window.h"
+#include "../common/feature_scheduler.h"
+#include "../common/node_arena.h"
+#include "../common/numa.h"
+#include "../common/strategy_tuner.h"
 #include "../common/sync.h"
+#include "../common/threading.h"
+#include "../common/timer.h"
+#include "../common/row_set.h"
+#include "../common/run_column.h"
 #include "split_evaluator.h"
+#include "robust_trace.h"
 
 // global define for prototype
 #define EPS 0.00
 
+#if defined(__GNUC__)
+#define XGBOOST_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define XGBOOST_PREFETCH(addr)
+#endif
+
 namespace xgboost {
 namespace tree {
 
 DMLC_REGISTRY_FILE_TAG(updater_robust_colmaker);
 
+/*! \brief split score of the robust enumeration through the SplitEvaluator chain */
+struct EvaluatorSplitScore {
+  const SplitEvaluator *eval;
+  inline bst_float operator()(int nid, bst_uint fid, const GradStats &left,
+                              const GradStats &right) const {
+    return eval->ComputeSplitScore(nid, fid, left, right);
+  }
+};
+
+/*!
+ * \brief split score of ElasticNet inlined into the enumeration, used when
+ *  the evaluator chain has no constraint. Gives the same values as the chain.
+ */
+struct ElasticNetSplitScore {
+  bst_float reg_alpha;
+  bst_float reg_lambda;
+  inline double ThresholdL1(double g) const {
+    if (g > reg_alpha) {
+      return g - reg_alpha;
+    } else if (g < -reg_alpha) {
+      return g + reg_alpha;
+    } else {
+      return 0.0;
+    }
+  }
+  inline bst_float Score(const GradStats &stats) const {
+    return Sqr(ThresholdL1(stats.sum_grad)) / (stats.sum_hess + reg_lambda);
+  }
+  inline bst_float operator()(int nid, bst_uint fid, const GradStats &left,
+                              const GradStats &right) const {
+    return Score(left) + Score(right);
+  }
+};
+
 /*! \brief column-wise update to construct a tree */
 class RobustColMaker: public TreeUpdater {
  public:
@@ -31,25 +90,47 @@ class RobustColMaker: public TreeUpdater {
     param_.InitAllowUnknown(args);
     spliteval_.reset(SplitEvaluator::Create(param_.split_evaluator));
     spliteval_->Init(args);
+    // parameters may have changed, rebuild the workspace on next update
+    builder_.reset();
   }
 
   void Update(HostDeviceVector<GradientPair> *gpair,
               DMatrix* dmat,
               const std::vector<RegTree*> &trees) override {
     GradStats::CheckInfo(dmat->Info());
+    CHECK(!dmat->WideRowIds())
+        << "RobustColMaker: 2^32 rows or more need the exact or hist tree method";
     // rescale learning rate according to size of trees
     float lr = param_.learning_rate;
     param_.learning_rate = lr / trees.size();
-    // build tree
-    for (auto tree : trees) {
-      Builder builder(
+    // build tree, the builder and its buffers are kept across rounds
+    // the omp thread count may have changed since the last round, e.g. through
+    // a new nthread or thread limit, and the builder buffers are per thread
+    if (!builder_ || builder_->NumThreads() != omp_get_max_threads()) {
+      builder_.reset(new Builder(
         param_,
-        std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone()));
-      builder.Update(gpair->HostVector(), dmat, tree);
+        std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone())));
+    }
+    for (auto tree : trees) {
+      builder_->Update(gpair->HostVector(), dmat, tree);
     }
     param_.learning_rate = lr;
   }
 
+  bool UpdatePredictionCache(const DMatrix* data,
+                             HostDeviceVector<bst_float>* out_preds) override {
+    if (!builder_) {
+      return false;
+    } else {
+      return builder_->UpdatePredictionCache(data, out_preds);
+    }
+  }
+
+  // the positions of the rows in deleted nodes are walked up to their leaf
+  bool CacheFollowsDeletedNodes() const override {
+    return true;
+  }
+
  protected:
   // training parameter
   TrainParam param_;
@@ -65,25 +146,122 @@ class RobustColMaker: public TreeUpdater {
     /*! \brief statistics of data: <eta-eps */
     GradStats stats_c_left;
     unsigned int c_left_counter;
-    /*! \brief statistics of data: [eta, eta+eps) shoule be the stats of data_unc_right*/
+    /*! \brief number of data in stats_left */
+    unsigned int left_counter;
+    /*! \brief largest feature value in stats_left, valid if left_counter > 0 */
+    bst_float left_last_fvalue;
+    /*! \brief statistics of data: [eta, eta+eps) the stats of data_scanned[unc_right_begin:]*/
     GradStats stats_unc_right;
-    /*! \brief statistics of data: [eta-eps, eta+eps) shoule be the stats of data_unc*/
+    /*! \brief statistics of data: [eta-eps, eta+eps) the stats of data_scanned[unc_begin:]*/
     GradStats stats_unc;
     /*! \brief extra statistics of data */
     GradStats stats_extra;
-    /*! \brief queue of seen data not added to stats_left: [eta, eta+eps)*/
-    std::deque<const Entry*> data_unc_right;
-    /*! \brief queue of uncertain data: [eta-eps, eta+eps)*/
-    std::deque<const Entry*> data_unc;
+    /*!
+     * \brief entries of this node scanned so far in the current feature,
+     *  in ascending order. Its capacity is kept across features, so the
+     *  scan does not allocate once the buffers are warmed up.
+     */
+    std::vector<const Entry*> data_scanned;
+    /*!
+     * \brief prefix_scanned[k]: stats before data_scanned[k] was added, so
+     *  that the windows move without summing the data they pass over
+     */
+    std::vector<GradStats> prefix_scanned;
+    /*! \brief statistics of the data before data_scanned[k] */
+    inline const GradStats &PrefixStats(size_t k) const {
+      return k < prefix_scanned.size() ? prefix_scanned[k] : stats;
+    }
+    /*! \brief start of seen data not added to stats_left: [eta, eta+eps)*/
+    size_t unc_right_begin{0};
+    /*! \brief start of uncertain data: [eta-eps, eta+eps)*/
+    size_t unc_begin{0};
+    /*! \brief number of uncertain entries */
+    inline size_t UncSize() const {
+      return data_scanned.size() - unc_begin;
+    }
+    /*! \brief the scanned data of this node with one feature value */
+    struct ValueRun {
+      bst_float fvalue;
+      GradStats stats;
+      unsigned int count;
+    };
+    /*!
+     * \brief value runs of this node scanned so far, in ascending order.
+     *  EnumerateRuns keeps its windows here instead of data_scanned.
+     */
+    std::vector<ValueRun> runs_scanned;
+    /*! \brief statistics of the data of this node in the current run */
+    GradStats run_stats;
+    unsigned int run_count;
+    /*! \brief index of the run that run_stats belongs to, -1 if none */
+    int run_mark{-1};
+    /*! \brief number of data in runs_scanned */
+    unsigned int scanned_counter;
+    /*! \brief clear the windows, keep the allocated space */
+    inline void ClearWindow() {
+      data_scanned.clear();
+      prefix_scanned.clear();
+      runs_scanned.clear();
+      unc_right_begin = 0;
+      unc_begin = 0;
+    }
     /*! \brief last feature value scanned */
     bst_float last_fvalue;
     /*! \brief first feature value scanned */
     bst_float first_fvalue;
+    /*!
+     * \brief whether the scan also evaluates the splits sending the rows that
+     *  miss the feature left, see robust_single_pass
+     */
+    bool missing_left{false};
+    /*! \brief statistics of the rows of this node missing the feature, valid if missing_left */
+    GradStats stats_missing;
+    /*! \brief number of rows counted by this thread in InitNewNode */
+    bst_uint num_row{0};
+    /*!
+     * \brief midpoint between the neighbouring feature values of the best
+     *  threshold found in the current scan, valid if has_mid is set
+     */
+    bst_float mid_value{0.0f};
+    /*! \brief whether best was found in the current scan and can be moved to mid_value */
+    bool has_mid{false};
+    /*! \brief upper bound of the loss change of the current feature, see CanImprove */
+    bst_float gain_bound{0.0f};
+    /*! \brief whether last_fvalue has been set in the current bound scan */
+    bool has_last{false};
+    /*! \brief whether the current feature is exhausted at this node, see SetSkipped */
+    bool skip{false};
     /*! \brief current best solution */
     SplitEntry best;
     // constructor  
     explicit ThreadEntry(const TrainParam &param)
-        : stats(param), stats_left(param), stats_extra(param) {
+        : stats(param), stats_left(param), stats_extra(param), stats_missing(param) {
+    }
+  };
+  /*! \brief statistics of the data of one node in a chunk of a sorted column */
+  struct ChunkStat {
+    /*! \brief sum of the statistics */
+    GradStats stats;
+    /*! \brief number of data */
+    unsigned int count;
+    /*! \brief largest feature value, valid if count > 0 */
+    bst_float last_fvalue;
+    explicit ChunkStat(const TrainParam &param)
+        : stats(param), count(0), last_fvalue(0.0f) {}
+    inline void Clear() {
+      stats.Clear();
+      count = 0;
+    }
+    inline void Add(const Entry *it, const std::vector<GradientPair> &gpair,
+                    const MetaInfo &info) {
+      stats.Add(gpair, info, it->index);
+      ++count;
+      last_fvalue = it->fvalue;
+    }
+    inline void Add(const ChunkStat &b) {
+      stats.Add(b.stats);
+      count += b.count;
+      if (b.count != 0) last_fvalue = b.last_fvalue;
     }
   };
   struct NodeEntry {
@@ -93,11 +271,13 @@ class RobustColMaker: public TreeUpdater {
     bst_float root_gain;
     /*! \brief weight calculated related to current data */
     bst_float weight;
+    /*! \brief number of active rows in this node */
+    bst_uint num_row;
     /*! \brief current best solution */
     SplitEntry best;
     // constructor
     explicit NodeEntry(const TrainParam& param)
-        : stats(param), root_gain(0.0f), weight(0.0f){
+        : stats(param), root_gain(0.0f), weight(0.0f), num_row(0) {
     }
   };
   // actual builder that runs the algorithm
@@ -107,19 +287,76 @@ class RobustColMaker: public TreeUpdater {
     explicit Builder(const TrainParam& param,
                      std::unique_ptr<SplitEvaluator> spliteval)
         : param_(param), nthread_(omp_get_max_threads()),
-          spliteval_(std::move(spliteval)) {}
+          spliteval_(std::move(spliteval)) {
+      if (param_.robust_training_verbose) {
+        trace_sink_.reset(new ConsoleRobustTraceSink());
+      }
+      monitor_.Init("RobustColMaker", param_.debug_verbose > 0, param_.perf_counters);
+      if (param_.debug_verbose > 0) {
+        count_sinks_.resize(nthread_);
+        busy_timers_.resize(nthread_);
+      }
+      elastic_net_ = spliteval_->GetElasticNet(&elastic_net_score_.reg_alpha,
+                                               &elastic_net_score_.reg_lambda);
+      if (param_.numa_mode) {
+        thread_node_ = common::PinThreadsByNode(nthread_);
+        num_numa_node_ = *std::max_element(thread_node_.begin(), thread_node_.end()) + 1;
+      }
+    }
+    // number of threads the per-thread buffers are sized for
+    inline int NumThreads() const {
+      return nthread_;
+    }
     // update one tree, growing
     virtual void Update(const std::vector<GradientPair>& gpair,
                         DMatrix* p_fmat,
                         RegTree* p_tree) {
       std::vector<int> newnodes;
+      spliteval_->Reset();
+      p_last_tree_ = p_tree;
+      p_last_fmat_ = p_fmat;
+      this->BeginTreeSummary();
+      monitor_.Start("InitData");
       this->InitData(gpair, *p_fmat, *p_tree);
+      this->InitRunColumns(p_fmat);
+      this->InitEpsWindows(p_fmat);
+      monitor_.Stop("InitData");
+      monitor_.Start("InitNewNode");
       this->InitNewNode(qexpand_, gpair, *p_fmat, *p_tree);
+      monitor_.Stop("InitNewNode");
+      compact_columns_ = false;
+      if (param_.grow_policy == TrainParam::kLossGuide) {
+        this->UpdateLossGuide(gpair, p_fmat, p_tree);
+        this->FinishTree(p_tree);
+        return;
+      }
+      // with a single root, the rows of each node are kept in row sets, so a
+      // level only touches the rows of the nodes being expanded
+      const bool use_row_set = p_tree->param.num_roots == 1;
+      if (use_row_set) this->InitRowSet(*p_fmat);
+      // the full columns hold every row, so the rows left out by sampling
+      // already count towards compacting them at the root
+      compact_rows_ = p_fmat->Info().num_row_;
       for (int depth = 0; depth < param_.max_depth; ++depth) {
+        this->CompactColumns(p_fmat);
+        monitor_.Start("FindSplit");
         this->FindSplit(depth, qexpand_, gpair, p_fmat, p_tree);
-        this->ResetPosition(qexpand_, p_fmat, *p_tree);
+        monitor_.Stop("FindSplit");
+        monitor_.Start("ResetPosition");
+        if (use_row_set) {
+          this->PartitionLevel(qexpand_, p_fmat, *p_tree);
+        } else {
+          this->ResetPosition(qexpand_, p_fmat, *p_tree);
+        }
+        monitor_.Stop("ResetPosition");
         this->UpdateQueueExpand(*p_tree, qexpand_, &newnodes);
-        this->InitNewNode(newnodes, gpair, *p_fmat, *p_tree);
+        monitor_.Start("InitNewNode");
+        if (use_row_set) {
+          this->InitNewNodeRows(newnodes, gpair, *p_fmat, *p_tree);
+        } else {
+          this->InitNewNode(newnodes, gpair, *p_fmat, *p_tree);
+        }
+        monitor_.Stop("InitNewNode");
         for (auto nid : qexpand_) {
           if ((*p_tree)[nid].IsLeaf()) {
             continue;
@@ -141,7 +378,69 @@ class RobustColMaker: public TreeUpdater {
       for (const int nid : qexpand_) {
         (*p_tree)[nid].SetLeaf(snode_[nid].weight * param_.learning_rate);
       }
-      // remember auxiliary statistics in the tree node
+      this->FinishTree(p_tree);
+    }
+
+    /*!
+     * \brief add the leaf values of the last grown tree to the predictions
+     *  of its training data, using the final positions of the rows.
+     * \return false if the positions cannot be used, e.g. under subsample
+     */
+    inline bool UpdatePredictionCache(const DMatrix* data,
+                                      HostDeviceVector<bst_float>* p_out_preds) const {
+      if (p_last_tree_ == nullptr || data != p_last_fmat_ || num_inactive_ != 0) {
+        return false;
+      }
+      std::vector<bst_float>& out_preds = p_out_preds->HostVector();
+      if (out_preds.size() != position_.size()) return false;
+      const RegTree &tree = *p_last_tree_;
+      const auto ndata = static_cast<bst_omp_uint>(position_.size());
+      common::ParallelFor(ndata, [&](size_t ridx) {
+        int nid = this->DecodePosition(ridx);
+        // the pruner turns the parent of deleted leaves into a leaf
+        while (tree[nid].IsDeleted()) {
+          nid = tree[nid].Parent();
+        }
+        out_preds[ridx] += tree[nid].LeafValue();
+      });
+      return true;
+    }
+
+   protected:
+    /*!
+     * \brief store the statistics of the grown tree and prune it under
+     *  robust_fused_prune. The positions stay valid for UpdatePredictionCache,
+     *  which maps the rows of a pruned subtree to its new leaf.
+     */
+    inline void FinishTree(RegTree *p_tree) {
+      this->TrackWorkspace();
+      this->SetTreeStats(p_tree);
+      this->PrintTreeSummary(*p_tree);
+      if (param_.robust_fused_prune) {
+        const int npruned = PruneTree(param_, p_tree);
+        if (!param_.silent) {
+          LOG(INFO) << "tree pruning end, " << p_tree->param.num_roots << " roots, "
+                    << p_tree->NumExtraNodes() << " extra nodes, " << npruned
+                    << " pruned nodes, max_depth=" << p_tree->MaxDepth();
+        }
+      }
+    }
+    // count the buffers kept across trees, beside the records of the node arenas
+    inline void TrackWorkspace() {
+      size_t bytes = position_.capacity() * sizeof(int) + compact_page_.MemCostBytes() +
+          compact_temp_.MemCostBytes() + merged_page_.MemCostBytes() +
+          eps_windows_.MemCostBytes();
+      for (const auto& temp : stemp_) {
+        for (size_t nid = 0; nid < temp.Size(); ++nid) {
+          bytes += temp[nid].data_scanned.capacity() * sizeof(const Entry*) +
+              temp[nid].prefix_scanned.capacity() * sizeof(GradStats);
+        }
+      }
+      for (const auto& buf : merge_buf_) bytes += buf.capacity() * sizeof(Entry);
+      workspace_bytes_.Set(bytes);
+    }
+    // remember auxiliary statistics in the tree node
+    inline void SetTreeStats(RegTree *p_tree) {
       for (int nid = 0; nid < p_tree->param.num_nodes; ++nid) {
         p_tree->Stat(nid).loss_chg = snode_[nid].best.loss_chg;
         p_tree->Stat(nid).base_weight = snode_[nid].weight;
@@ -149,8 +448,283 @@ class RobustColMaker: public TreeUpdater {
         snode_[nid].stats.SetLeafVec(param_, p_tree->Leafvec(nid));
       }
     }
-
-   protected:
+    // sink of the enumeration trace of the calling thread, nullptr when off
+    inline RobustTraceSink *TraceSink() {
+      if (trace_sink_ != nullptr) return trace_sink_.get();
+      if (count_sinks_.empty()) return nullptr;
+      return &count_sinks_[omp_get_thread_num()];
+    }
+    // start the per tree summary of debug_verbose
+    inline void BeginTreeSummary() {
+      if (!monitor_.debug_verbose) return;
+      tree_begin_.clear();
+      for (const auto &kv : monitor_.timer_map) {
+        tree_begin_[kv.first] = kv.second.ElapsedSeconds();
+      }
+      for (auto &timer : busy_timers_) timer.Reset();
+      for (auto &sink : count_sinks_) sink.Clear();
+    }
+    /*!
+     * \brief print the summary of the tree just built as one line of JSON:
+     *  the seconds of each phase, FindSplit includes UpdateSolution and
+     *  SyncBestSolution, the busy seconds of each thread in UpdateSolution and
+     *  the event counts of the robust enumeration. The counts are not taken
+     *  under robust_training_verbose or parallel_option=1, nor when
+     *  parallel_option=3 enumerates by column. With parallel_option=3 the
+     *  strategy kept by each "level/nodes" bucket is listed.
+     */
+    inline void PrintTreeSummary(const RegTree &tree) {
+      if (!monitor_.debug_verbose) return;
+      CountingRobustTraceSink total;
+      for (const auto &sink : count_sinks_) total.Add(sink);
+      std::ostringstream os;
+      os << "{\"tree\":" << num_tree_++ << ",\"num_nodes\":" << tree.param.num_nodes
+         << ",\"phase\":{";
+      bool first = true;
+      for (const auto &kv : monitor_.timer_map) {
+        if (!first) os << ',';
+        first = false;
+        os << '"' << kv.first << "\":" << kv.second.ElapsedSeconds() - tree_begin_[kv.first];
+      }
+      os << "},\"thread_busy\":[";
+      for (size_t tid = 0; tid < busy_timers_.size(); ++tid) {
+        if (tid != 0) os << ',';
+        os << busy_timers_[tid].ElapsedSeconds();
+      }
+      os << ']';
+      if (!thread_node_.empty()) {
+        std::vector<double> node_busy(num_numa_node_, 0.0);
+        for (size_t tid = 0; tid < busy_timers_.size(); ++tid) {
+          node_busy[thread_node_[tid]] += busy_timers_[tid].ElapsedSeconds();
+        }
+        os << ",\"numa_node_busy\":[";
+        for (size_t node = 0; node < node_busy.size(); ++node) {
+          if (node != 0) os << ',';
+          os << node_busy[node];
+        }
+        os << ']';
+      }
+      const std::map<uint64_t, int> decisions = tuner_.Decisions();
+      if (!decisions.empty()) {
+        // the strategy of each level/nodes bucket of parallel_option=3
+        os << ",\"parallel_option\":{";
+        for (auto it = decisions.begin(); it != decisions.end(); ++it) {
+          if (it != decisions.begin()) os << ',';
+          os << "\"" << (it->first >> 8) << '/' << (1 << (it->first & 0xff)) << "\":"
+             << it->second;
+        }
+        os << '}';
+      }
+      os << ",\"entries\":" << total.num_entry
+         << ",\"window_push\":" << total.num_push
+         << ",\"window_pop\":" << total.num_pop
+         << ",\"candidates\":" << total.num_candidate << '}';
+      LOG(CONSOLE) << "[robust] tree summary " << os.str();
+    }
+    /* tree growing policies */
+    struct ExpandEntry {
+      int nid;
+      int depth;
+      bst_float loss_chg;
+      unsigned timestamp;
+      ExpandEntry(int nid, int depth, bst_float loss_chg, unsigned tstmp)
+        : nid(nid), depth(depth), loss_chg(loss_chg), timestamp(tstmp) {}
+    };
+    inline static bool LossGuide(ExpandEntry lhs, ExpandEntry rhs) {
+      if (lhs.loss_chg == rhs.loss_chg) {
+        return lhs.timestamp > rhs.timestamp;  // favor small timestamp
+      } else {
+        return lhs.loss_chg < rhs.loss_chg;  // favor large loss_chg
+      }
+    }
+    /*!
+     * \brief grow the tree best first, always expanding the leaf with the
+     *  largest loss change.
+     *
+     *  Only the two children of the expanded node are evaluated in each step.
+     *  The rows of all the other leaves are parked with the ~nid encoding, so
+     *  the column scans skip them, and the rows of each node are kept in a
+     *  RowSetCollection so that parking, splitting and computing the node
+     *  statistics only touch the rows of the node being expanded.
+     */
+    inline void UpdateLossGuide(const std::vector<GradientPair>& gpair,
+                                DMatrix* p_fmat,
+                                RegTree* p_tree) {
+      CHECK(param_.max_depth > 0 || param_.max_leaves > 0)
+          << "max_depth or max_leaves cannot be both 0 (unlimited); "
+          << "at least one should be a positive quantity.";
+      CHECK_EQ(p_tree->param.num_roots, 1)
+          << "grow_policy=lossguide does not support multiple roots";
+      this->InitRowSet(*p_fmat);
+      std::priority_queue<ExpandEntry, std::vector<ExpandEntry>,
+                          std::function<bool(ExpandEntry, ExpandEntry)> > queue(LossGuide);
+      unsigned timestamp = 0;
+      int num_leaves = 1;
+      level_ = 0;
+      this->EvaluateSplit(qexpand_, gpair, p_fmat);
+      monitor_.Start("ResetPosition");
+      this->ParkRows(0);
+      monitor_.Stop("ResetPosition");
+      queue.push(ExpandEntry(0, 0, snode_[0].best.loss_chg, timestamp++));
+      while (!queue.empty()) {
+        const ExpandEntry candidate = queue.top();
+        const int nid = candidate.nid;
+        queue.pop();
+        if (candidate.loss_chg <= kRtEps
+            || (param_.max_depth > 0 && candidate.depth == param_.max_depth)
+            || (param_.max_leaves > 0 && num_leaves == param_.max_leaves)) {
+          // the rows stay parked, they are finished
+          (*p_tree)[nid].SetLeaf(snode_[nid].weight * param_.learning_rate);
+          continue;
+        }
+        // copy, snode_ is resized when the children are added
+        const SplitEntry best = snode_[nid].best;
+        p_tree->AddChilds(nid);
+        (*p_tree)[nid].SetSplit(best.SplitIndex(), best.split_value, best.DefaultLeft());
+        this->InheritExhausted(nid, *p_tree);
+        const int cleft = (*p_tree)[nid].LeftChild();
+        const int cright = (*p_tree)[nid].RightChild();
+        // mark the children as 0, to indicate fresh leaf
+        (*p_tree)[cleft].SetLeaf(0.0f, 0);
+        (*p_tree)[cright].SetLeaf(0.0f, 0);
+        qexpand_.clear();
+        qexpand_.push_back(nid);
+        // the non-default rows, SetEncodePosition keeps them parked
+        monitor_.Start("ResetPosition");
+        this->SetNonDefaultPosition(qexpand_, p_fmat, *p_tree);
+        this->SplitRows(nid, *p_tree);
+        monitor_.Stop("ResetPosition");
+        qexpand_.clear();
+        qexpand_.push_back(cleft);
+        qexpand_.push_back(cright);
+        monitor_.Start("InitNewNode");
+        this->InitNewNodeRows(qexpand_, gpair, *p_fmat, *p_tree);
+        monitor_.Stop("InitNewNode");
+        spliteval_->AddSplit(nid, cleft, cright, best.SplitIndex(),
+                             snode_[cleft].weight, snode_[cright].weight);
+        level_ = p_tree->GetDepth(cleft);
+        this->EvaluateSplit(qexpand_, gpair, p_fmat);
+        monitor_.Start("ResetPosition");
+        this->ParkRows(cleft);
+        this->ParkRows(cright);
+        monitor_.Stop("ResetPosition");
+        queue.push(ExpandEntry(cleft, p_tree->GetDepth(cleft),
+                               snode_[cleft].best.loss_chg, timestamp++));
+        queue.push(ExpandEntry(cright, p_tree->GetDepth(cright),
+                               snode_[cright].best.loss_chg, timestamp++));
+        // give two and take one, as parent is no longer a leaf
+        ++num_leaves;
+      }
+      qexpand_.clear();
+    }
+    // put all active rows in the row set of the root, the inactive rows
+    // are left out and keep their position
+    inline void InitRowSet(const DMatrix& fmat) {
+      const RowSet &rowset = fmat.BufferedRowset();
+      row_set_collection_.Clear();
+      std::vector<size_t> &row_indices = row_set_collection_.row_indices_;
+      row_indices.reserve(rowset.Size());
+      for (size_t i = 0; i < rowset.Size(); ++i) {
+        if (position_[rowset[i]] >= 0) row_indices.push_back(rowset[i]);
+      }
+      row_set_collection_.Init();
+    }
+    /*!
+     * \brief ResetPosition over the row sets, for the depthwise policy.
+     *
+     *  The non-default rows are still found by scanning the columns of the
+     *  split features, but the rows that go to the default child and the rows
+     *  of the nodes that became leaves are found from the row sets of the
+     *  expanded nodes instead of a pass over all rows.
+     */
+    inline void PartitionLevel(const std::vector<int> &qexpand,
+                               DMatrix *p_fmat,
+                               const RegTree &tree) {
+      this->SetNonDefaultPosition(qexpand, p_fmat, tree);
+      for (int nid : qexpand) {
+        if (tree[nid].IsLeaf()) {
+          // mark finish, a node of qexpand is not a fresh leaf here
+          this->ParkRows(nid);
+        } else {
+          this->SplitRows(nid, tree);
+        }
+      }
+    }
+    // mark the rows of node nid as inactive, so that column scans skip them
+    inline void ParkRows(int nid) {
+      const auto &elem = row_set_collection_[nid];
+      const auto nrow = static_cast<bst_omp_uint>(elem.Size());
+      common::ParallelFor(nrow, [&](size_t i) {
+        position_[elem.begin[i]] = ~nid;
+      });
+    }
+    /*!
+     * \brief move the rows of the split node nid to its children, and activate
+     *  them; SetNonDefaultPosition must have moved the non-default rows already
+     */
+    inline void SplitRows(int nid, const RegTree &tree) {
+      const int cleft = tree[nid].LeftChild();
+      const int cright = tree[nid].RightChild();
+      const int cdefault = tree[nid].DefaultLeft() ? cleft : cright;
+      const auto &elem = row_set_collection_[nid];
+      const auto nrow = static_cast<bst_omp_uint>(elem.Size());
+      row_split_tloc_.resize(this->nthread_);
+      for (auto &split : row_split_tloc_) {
+        split.left.clear();
+        split.right.clear();
+      }
+      // the rows of the children keep their order only if each thread takes a
+      // block of the rows in order, so the loop stays an OpenMP static schedule
+      #pragma omp parallel for schedule(static)
+      for (bst_omp_uint i = 0; i < nrow; ++i) {
+        const size_t ridx = elem.begin[i];
+        int cid = this->DecodePosition(ridx);
+        if (cid == nid) cid = cdefault;
+        position_[ridx] = cid;
+        auto &split = row_split_tloc_[omp_get_thread_num()];
+        if (cid == cleft) {
+          split.left.push_back(ridx);
+        } else {
+          split.right.push_back(ridx);
+        }
+      }
+      row_set_collection_.AddSplit(nid, row_split_tloc_, cleft, cright);
+    }
+    // InitNewNode over the row sets, used when the rows are kept in row sets
+    inline void InitNewNodeRows(const std::vector<int>& qexpand,
+                                const std::vector<GradientPair>& gpair,
+                                const DMatrix& fmat,
+                                const RegTree& tree) {
+      this->ResizeThreadEntries(tree.param.num_nodes);
+      snode_.Resize(tree.param.num_nodes, NodeEntry(param_));
+      const MetaInfo& info = fmat.Info();
+      // nodes with fewer rows are summed by a single thread
+      constexpr bst_omp_uint kMinParallelRows = 1024;
+      std::vector<GradStats> thread_stats(this->nthread_, GradStats(param_));
+      for (int nid : qexpand) {
+        const auto &elem = row_set_collection_[nid];
+        const auto nrow = static_cast<bst_omp_uint>(elem.Size());
+        for (auto &s : thread_stats) {
+          s.Clear();
+        }
+        #pragma omp parallel for schedule(static) if (nrow >= kMinParallelRows)
+        for (bst_omp_uint i = 0; i < nrow; ++i) {
+          thread_stats[omp_get_thread_num()].Add(
+              gpair, info, static_cast<bst_uint>(elem.begin[i]));
+        }
+        GradStats stats(param_);
+        for (const auto &s : thread_stats) {
+          stats.Add(s);
+        }
+        NodeEntry &e = snode_[nid];
+        e.stats = stats;
+        e.num_row = static_cast<bst_uint>(elem.Size());
+        bst_uint parentid = tree[nid].Parent();
+        e.weight = static_cast<float>(spliteval_->ComputeWeight(parentid, e.stats));
+        e.root_gain = static_cast<float>(
+            spliteval_->ComputeScore(parentid, e.stats, e.weight));
+      }
+    }
     // initialize temp data structure
     inline void InitData(const std::vector<GradientPair>& gpair,
                          const DMatrix& fmat,
@@ -160,13 +734,10 @@ class RobustColMaker: public TreeUpdater {
       const std::vector<unsigned>& root_index = fmat.Info().root_index_;
       const RowSet& rowset = fmat.BufferedRowset();
       {
-        // setup position
+        // setup position, first written in the static schedule of InitNewNode
         position_.resize(gpair.size());
-        if (root_index.size() == 0) {
-          for (size_t i = 0; i < rowset.Size(); ++i) {
-            position_[rowset[i]] = 0;
-          }
-        } else {
+        common::ParallelFill(&position_, 0, nthread_);
+        if (root_index.size() != 0) {
           for (size_t i = 0; i < rowset.Size(); ++i) {
             const bst_uint ridx = rowset[i];
             position_[ridx] = root_index[ridx];
@@ -188,12 +759,18 @@ class RobustColMaker: public TreeUpdater {
             if (!coin_flip(rnd)) position_[ridx] = ~position_[ridx];
           }
         }
+        // rows that do not follow the splits, their final positions are not leaves
+        num_inactive_ = gpair.size() - rowset.Size();
+        for (size_t i = 0; i < rowset.Size(); ++i) {
+          if (position_[rowset[i]] < 0) ++num_inactive_;
+        }
       }
       {
         // initialize feature index
         auto ncol = static_cast<unsigned>(fmat.Info().num_col_);
+        feat_index_.clear();
         for (unsigned i = 0; i < ncol; ++i) {
-          if (fmat.GetColSize(i) != 0) {
+          if (fmat.GetColSize(i) != 0 && fmat.Info().IsSplitFeature(i)) {
             feat_index_.push_back(i);
           }
         }
@@ -206,13 +783,17 @@ class RobustColMaker: public TreeUpdater {
       }
       {
         // setup temp space for each thread
-        // reserve a small space
-        stemp_.clear();
-        stemp_.resize(this->nthread_, std::vector<ThreadEntry>());
+        // the entries left by a previous tree are kept, InitNewNode resets
+        // them in place, so that their buffers are reused
+        stemp_.resize(this->nthread_);
+        run_nodes_.resize(this->nthread_);
         for (auto& i : stemp_) {
-          i.clear(); i.reserve(256);
+          i.Clear(); i.Reserve(256);
         }
-        snode_.reserve(256);
+        snode_.Clear();
+        snode_.Reserve(256);
+        exhausted_.clear();
+        exhausted_found_.resize(this->nthread_);
       }
       {
         // expand query
@@ -222,6 +803,117 @@ class RobustColMaker: public TreeUpdater {
         }
       }
     }
+    // build the run storage of the columns once per data set, see robust_value_runs
+    inline void InitRunColumns(DMatrix *p_fmat) {
+      if (!param_.robust_value_runs) return;
+      const uint64_t nnz = p_fmat->Info().num_nonzero_;
+      if (run_columns_fmat_ == p_fmat && run_columns_nnz_ == nnz) return;
+      run_columns_fmat_ = p_fmat;
+      run_columns_nnz_ = nnz;
+      run_columns_.Clear();
+      auto iter = p_fmat->ColIterator();
+      iter->BeforeFirst();
+      if (!iter->Next()) return;
+      run_columns_.Init(iter->Value());
+      // the runs index a single column page, external memory data is not stored
+      if (iter->Next()) run_columns_.Clear();
+    }
+    // find the eps window boundaries of the columns once per data set and eps,
+    // see robust_eps_windows
+    inline void InitEpsWindows(DMatrix *p_fmat) {
+      if (!param_.robust_eps_windows) {
+        eps_windows_fmat_ = nullptr;
+        eps_windows_.Clear();
+        return;
+      }
+      const uint64_t nnz = p_fmat->Info().num_nonzero_;
+      const auto eps = static_cast<bst_float>(param_.robust_eps);
+      if (eps_windows_fmat_ == p_fmat && eps_windows_nnz_ == nnz &&
+          eps_windows_.Eps() == eps) {
+        return;
+      }
+      eps_windows_fmat_ = p_fmat;
+      eps_windows_nnz_ = nnz;
+      eps_windows_.Clear();
+      auto iter = p_fmat->ColIterator();
+      iter->BeforeFirst();
+      if (!iter->Next()) return;
+      eps_windows_.Init(iter->Value(), eps);
+      // the boundaries index a single column page, as the value runs
+      if (iter->Next()) eps_windows_.Clear();
+    }
+    /*!
+     * \brief copy the sorted columns keeping only the active rows, once fewer
+     *  than robust_compact_ratio of the rows of the columns scanned are left.
+     *
+     *  Only used by the depthwise policy, where a finished row never becomes
+     *  active again. The entries keep their order, so the scans see the same
+     *  entries of the active rows as in the full columns. The full columns
+     *  tell which features are indicators, as a compacted column may lose
+     *  its distinct values.
+     */
+    inline void CompactColumns(DMatrix *p_fmat) {
+      if (param_.robust_compact_ratio <= 0.0f || !p_fmat->SingleColBlock()) return;
+      size_t nactive = 0;
+      for (int nid : qexpand_) {
+        nactive += snode_[nid].num_row;
+      }
+      if (static_cast<double>(nactive) >=
+          static_cast<double>(param_.robust_compact_ratio) * compact_rows_) {
+        return;
+      }
+      if (compact_columns_) {
+        this->CompactPage(compact_page_, &compact_temp_);
+      } else {
+        auto iter = p_fmat->ColIteratorFor(feat_index_);
+        iter->BeforeFirst();
+        if (!iter->Next()) return;
+        const SparsePage &batch = iter->Value();
+        compact_indicator_.assign(batch.Size(), 0);
+        for (bst_uint fid : feat_index_) {
+          const SparsePage::Inst c = batch[fid];
+          compact_indicator_[fid] =
+              c.length != 0 && c.data[0].fvalue == c.data[c.length - 1].fvalue;
+        }
+        this->CompactPage(batch, &compact_temp_);
+      }
+      std::swap(compact_page_, compact_temp_);
+      compact_columns_ = true;
+      compact_rows_ = nactive;
+    }
+    // copy the columns of feat_index_ of batch, keeping the entries of active rows
+    inline void CompactPage(const SparsePage &batch, SparsePage *out) {
+      const size_t ncol = batch.Size();
+      const auto nfeat = static_cast<bst_omp_uint>(feat_index_.size());
+      std::vector<size_t> &offset = out->offset;
+      offset.assign(ncol + 1, 0);
+      common::ParallelFor(nfeat, common::Sched::Dyn(1), [&](size_t i) {
+        const bst_uint fid = feat_index_[i];
+        const SparsePage::Inst c = batch[fid];
+        size_t n = 0;
+        for (bst_uint j = 0; j < c.length; ++j) {
+          if (position_[c.data[j].index] >= 0) ++n;
+        }
+        offset[fid + 1] = n;
+      });
+      for (size_t fid = 0; fid < ncol; ++fid) {
+        offset[fid + 1] += offset[fid];
+      }
+      out->data.resize(offset[ncol]);
+      common::ParallelFor(nfeat, common::Sched::Dyn(1), [&](size_t i) {
+        const bst_uint fid = feat_index_[i];
+        const SparsePage::Inst c = batch[fid];
+        Entry *dst = dmlc::BeginPtr(out->data) + offset[fid];
+        for (bst_uint j = 0; j < c.length; ++j) {
+          if (position_[c.data[j].index] >= 0) *dst++ = c.data[j];
+        }
+      });
+    }
+    // whether all values of column fid are equal, decided on the full column
+    inline bool IsIndicator(const SparsePage::Inst &c, bst_uint fid) const {
+      if (compact_columns_ || merged_columns_) return compact_indicator_[fid] != 0;
+      return c.length != 0 && c.data[0].fvalue == c.data[c.length - 1].fvalue;
+    }
     /*!
      * \brief initialize the base_weight, root_gain,
      *  and NodeEntry for all the new nodes in qexpand
@@ -232,30 +924,32 @@ class RobustColMaker: public TreeUpdater {
                             const RegTree& tree) {
       {
         // setup statistics space for each tree node
-        for (auto& i : stemp_) {
-          i.resize(tree.param.num_nodes, ThreadEntry(param_));
-        }
-        snode_.resize(tree.param.num_nodes, NodeEntry(param_));
+        this->ResizeThreadEntries(tree.param.num_nodes);
+        snode_.Resize(tree.param.num_nodes, NodeEntry(param_));
       }
       const RowSet &rowset = fmat.BufferedRowset();
       const MetaInfo& info = fmat.Info();
       // setup position
       const auto ndata = static_cast<bst_omp_uint>(rowset.Size());
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < ndata; ++i) {
+      common::ParallelFor(ndata, [&](size_t i) {
         const bst_uint ridx = rowset[i];
-        const int tid = omp_get_thread_num();
-        if (position_[ridx] < 0) continue;
-        stemp_[tid][position_[ridx]].stats.Add(gpair, info, ridx);
-      }
+        const int tid = common::ThreadId();
+        if (position_[ridx] < 0) return;
+        ThreadEntry &e = stemp_[tid][position_[ridx]];
+        e.stats.Add(gpair, info, ridx);
+        e.num_row++;
+      });
       // sum the per thread statistics together
       for (int nid : qexpand) {
         GradStats stats(param_);
+        bst_uint num_row = 0;
         for (auto& s : stemp_) {
           stats.Add(s[nid].stats);
+          num_row += s[nid].num_row;
         }
         // update node statistics
         snode_[nid].stats = stats;
+        snode_[nid].num_row = num_row;
       }
       // calculating the weights
       for (int nid : qexpand) {
@@ -284,637 +978,1088 @@ class RobustColMaker: public TreeUpdater {
                                   bst_uint fid,
                                   const DMatrix &fmat,
                                   const std::vector<GradientPair> &gpair) {
-      // TODO(tqchen): double check stats order.
-      const MetaInfo& info = fmat.Info();
-      const bool ind = col.length != 0 && col.data[0].fvalue == col.data[col.length - 1].fvalue;
-      bool need_forward = param_.NeedForwardSearch(fmat.GetColDensity(fid), ind);
-      bool need_backward = param_.NeedBackwardSearch(fmat.GetColDensity(fid), ind);
+      if (this->AllExhausted(fid)) return;
+      const bool ind = this->IsIndicator(col, fid);
+      for (int d_step : {+1, -1}) {
+        const bool need = d_step == +1
+            ? param_.NeedForwardSearch(fmat.GetColDensity(fid), ind)
+            : param_.NeedBackwardSearch(fmat.GetColDensity(fid), ind);
+        if (!need) continue;
+        if (elastic_net_) {
+          this->ParallelEnumerateSplit(col, d_step, fid, gpair, fmat.Info(),
+                                       elastic_net_score_);
+        } else {
+          this->ParallelEnumerateSplit(col, d_step, fid, gpair, fmat.Info(),
+                                       EvaluatorSplitScore{spliteval_.get()});
+        }
+      }
+    }
+    /*!
+     * \brief robust enumeration of one feature, with the sorted column split
+     *  into one chunk per thread.
+     *
+     *  A first pass sums the statistics of every chunk per node, and an
+     *  exclusive scan over the chunks gives the state of the sequential scan
+     *  at each chunk boundary. Before scanning its chunk, a thread restores
+     *  the eps windows: data below (v - eps) - eps, where v is the first value
+     *  of the chunk, can never be uncertain again and go straight to the
+     *  certain left statistics, while the data between that bound and the
+     *  chunk start are replayed into the windows. The candidates evaluated are
+     *  then the same as in EnumerateSplit, and the per thread best splits are
+     *  merged in chunk order by SyncBestSolution.
+     */
+    template <typename Score>
+    inline void ParallelEnumerateSplit(const SparsePage::Inst &col,
+                                       int d_step,
+                                       bst_uint fid,
+                                       const std::vector<GradientPair> &gpair,
+                                       const MetaInfo &info,
+                                       const Score &score) {
       const std::vector<int> &qexpand = qexpand_;
+      const Entry *data = col.data;
+      const bst_uint length = col.length;
+      const bst_float eps = static_cast<bst_float>(param_.robust_eps);
+      const bst_uint step = (length + this->nthread_ - 1) / this->nthread_;
+      if (length == 0) return;
+      const common::EpsWindow win = eps_windows_.GetColumn(fid, data, length);
+      // chunk_stats_[t][nid]: statistics of node nid in chunk t,
+      // after the scan, the statistics of the chunks before t
+      chunk_stats_.resize(this->nthread_ + 1);
+      for (auto &t : chunk_stats_) {
+        t.resize(snode_.Size(), ChunkStat(param_));
+      }
       #pragma omp parallel
       {
         const int tid = omp_get_thread_num();
-        std::vector<ThreadEntry> &temp = stemp_[tid];
-        // cleanup temp statistics
-        for (int j : qexpand) {
-          temp[j].stats.Clear();
+        std::vector<ChunkStat> &cs = chunk_stats_[tid];
+        for (int nid : qexpand) {
+          cs[nid].Clear();
         }
-        bst_uint step = (col.length + this->nthread_ - 1) / this->nthread_;
-        bst_uint end = std::min(col.length, step * (tid + 1));
+        const bst_uint end = std::min(length, step * (tid + 1));
         for (bst_uint i = tid * step; i < end; ++i) {
-          const bst_uint ridx = col[i].index;
-          const int nid = position_[ridx];
+          const int nid = position_[data[i].index];
           if (nid < 0) continue;
-          const bst_float fvalue = col[i].fvalue;
-          if (temp[nid].stats.Empty()) {
-            temp[nid].first_fvalue = fvalue;
-          }
-          temp[nid].stats.Add(gpair, info, ridx);
-          temp[nid].last_fvalue = fvalue;
+          cs[nid].Add(data + i, gpair, info);
         }
       }
-      // start collecting the partial sum statistics
-      auto nnode = static_cast<bst_omp_uint>(qexpand.size());
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint j = 0; j < nnode; ++j) {
+      const auto nnode = static_cast<bst_omp_uint>(qexpand.size());
+      common::ParallelFor(nnode, [&](size_t j) {
         const int nid = qexpand[j];
-        GradStats sum(param_), tmp(param_), c(param_);
+        ChunkStat sum(param_), tmp(param_);
         for (int tid = 0; tid < this->nthread_; ++tid) {
-          tmp = stemp_[tid][nid].stats;
-          stemp_[tid][nid].stats = sum;
+          tmp = chunk_stats_[tid][nid];
+          chunk_stats_[tid][nid] = sum;
           sum.Add(tmp);
-          if (tid != 0) {
-            std::swap(stemp_[tid - 1][nid].last_fvalue, stemp_[tid][nid].first_fvalue);
-          }
         }
-        for (int tid = 0; tid < this->nthread_; ++tid) {
-          stemp_[tid][nid].stats_extra = sum;
-          ThreadEntry &e = stemp_[tid][nid];
-          bst_float fsplit;
-          if (tid != 0) {
-            if (stemp_[tid - 1][nid].last_fvalue != e.first_fvalue) {
-              fsplit = (stemp_[tid - 1][nid].last_fvalue + e.first_fvalue) * 0.5f;
-            } else {
-              continue;
-            }
-          } else {
-            fsplit = e.first_fvalue - kRtEps;
+        chunk_stats_[this->nthread_][nid] = sum;
+      });
+      #pragma omp parallel
+      {
+        const int tid = omp_get_thread_num();
+        common::NodeArena<ThreadEntry> &temp = stemp_[tid];
+        this->SetSkipped(fid, temp);
+        const bst_uint begin = std::min(length, step * tid);
+        const bst_uint end = std::min(length, step * (tid + 1));
+        if (begin < end) {
+          // everything before data[certain] stays certain left for the whole chunk
+          const bst_float bound = (data[begin].fvalue - eps) - eps;
+          const auto certain = static_cast<bst_uint>(
+              std::lower_bound(data, data + begin, bound,
+                               [](const Entry &e, bst_float v) {
+                                 return e.fvalue < v;
+                               }) - data);
+          // restore the state at the boundary of the chunk containing data[certain]
+          const int k = static_cast<int>(certain / step);
+          for (int nid : qexpand) {
+            ThreadEntry &e = temp[nid];
+            const ChunkStat &pre = chunk_stats_[k][nid];
+            e.ClearWindow();
+            e.stats = pre.stats;
+            e.stats_left = pre.stats;
+            e.stats_c_left = pre.stats;
+            e.stats_unc_right.Clear();
+            e.stats_unc.Clear();
+            e.left_counter = pre.count;
+            e.c_left_counter = pre.count;
+            e.last_fvalue = pre.last_fvalue;
+            e.left_last_fvalue = pre.last_fvalue;
+            e.has_mid = false;
           }
-          if (need_forward && tid != 0) {
-            c.SetSubstract(snode_[nid].stats, e.stats);
-            if (c.sum_hess >= param_.min_child_weight &&
-                e.stats.sum_hess >= param_.min_child_weight) {
-              auto loss_chg = static_cast<bst_float>(
-                  spliteval_->ComputeSplitScore(nid, fid, e.stats, c) -
-                  snode_[nid].root_gain);
-              e.best.Update(loss_chg, fid, fsplit, false);
-            }
+          for (bst_uint i = k * step; i < certain; ++i) {
+            const int nid = position_[data[i].index];
+            if (nid < 0) continue;
+            ThreadEntry &e = temp[nid];
+            const bst_uint ridx = data[i].index;
+            e.stats.Add(gpair, info, ridx);
+            e.stats_left.Add(gpair, info, ridx);
+            e.stats_c_left.Add(gpair, info, ridx);
+            e.left_counter++;
+            e.c_left_counter++;
+            e.last_fvalue = data[i].fvalue;
+            e.left_last_fvalue = data[i].fvalue;
+          }
+          for (bst_uint i = certain; i < begin; ++i) {
+            const int nid = position_[data[i].index];
+            if (nid < 0) continue;
+            this->PushEntry(data + i, gpair[data[i].index], &temp[nid]);
           }
-          if (need_backward) {
-            tmp.SetSubstract(sum, e.stats);
-            c.SetSubstract(snode_[nid].stats, tmp);
-            if (c.sum_hess >= param_.min_child_weight &&
-                tmp.sum_hess >= param_.min_child_weight) {
-              auto loss_chg = static_cast<bst_float>(
-                  spliteval_->ComputeSplitScore(nid, fid, tmp, c) -
-                  snode_[nid].root_gain);
-              e.best.Update(loss_chg, fid, fsplit, true);
+          GradStats c(param_);
+          NoRobustTrace trace;
+          if (param_.cache_opt) {
+            this->ScanBlocks(data + begin, static_cast<int>(end - begin), 1, d_step, fid, eps,
+                             win, gpair, temp, &c, trace, score);
+          } else {
+            for (bst_uint i = begin; i < end; ++i) {
+              const int nid = position_[data[i].index];
+              if (nid < 0) continue;
+              this->ScanEntry(data + i, nid, gpair[data[i].index], d_step, fid, eps, win,
+                              &temp[nid], &c, trace, score);
             }
           }
+          for (int nid : qexpand) {
+            this->MoveToMid(nid, fid, &temp[nid], trace);
+          }
         }
-        if (need_backward) {
-          tmp = sum;
-          ThreadEntry &e = stemp_[this->nthread_-1][nid];
-          c.SetSubstract(snode_[nid].stats, tmp);
-          if (c.sum_hess >= param_.min_child_weight &&
-              tmp.sum_hess >= param_.min_child_weight) {
-            auto loss_chg = static_cast<bst_float>(
-                spliteval_->ComputeSplitScore(nid, fid, tmp, c) -
-                snode_[nid].root_gain);
-            e.best.Update(loss_chg, fid, e.last_fvalue + kRtEps, true);
+      }
+      // split after all the data, this comes last in the sequential scan
+      GradStats c(param_);
+      NoRobustTrace trace;
+      for (int nid : qexpand) {
+        const ChunkStat &sum = chunk_stats_[this->nthread_][nid];
+        if (sum.count == 0) continue;
+        this->UpdateAllSum(nid, d_step, fid, eps, sum.stats, sum.last_fvalue,
+                           &stemp_[this->nthread_ - 1][nid], &c, trace, score);
+      }
+    }
+    // compute the loss change of splitting nid into left and right
+    // Score is EvaluatorSplitScore or the inlined ElasticNetSplitScore
+    template <typename Score>
+    inline bst_float SplitLossChange(const Score &score, int nid, bst_uint fid,
+                                     int d_step, const GradStats &left,
+                                     const GradStats &right) const {
+      if (d_step == -1) {
+        return static_cast<bst_float>(score(nid, fid, right, left) - snode_[nid].root_gain);
+      } else {
+        return static_cast<bst_float>(score(nid, fid, left, right) - snode_[nid].root_gain);
+      }
+    }
+    inline bst_float SplitLossChange(int nid, bst_uint fid, int d_step,
+                                     const GradStats &left,
+                                     const GradStats &right) const {
+      return this->SplitLossChange(EvaluatorSplitScore{spliteval_.get()},
+                                   nid, fid, d_step, left, right);
+    }
+    // minimum loss change of the worst-case assignments of the uncertain data
+    // of node nid: all to the left, all to the right and the two halves swapped.
+    // With kMissingLeft the rows missing the feature are added to the left.
+    template <bool kMissingLeft, typename Trace, typename Score>
+    inline bst_float WorstCaseLossChange(const Score &score, int nid, bst_uint fid,
+                                         int d_step, const ThreadEntry &e,
+                                         Trace &trace) const {  // NOLINT(*)
+      const GradStats &total = snode_[nid].stats;
+      GradStats left(param_), right(param_);
+      // all uncertainty to left
+      left.SetUnion(e.stats_c_left, e.stats_unc);
+      if (kMissingLeft) left.Add(e.stats_missing);
+      right.SetSubstract(total, left);
+      const bst_float put_left_loss_chg =
+          this->SplitLossChange(score, nid, fid, d_step, left, right);
+      trace.Candidate(fid, nid, RobustCandidate::kAllLeft, put_left_loss_chg);
+      // all uncertainty to right
+      left.SetCopy(e.stats_c_left);
+      if (kMissingLeft) left.Add(e.stats_missing);
+      right.SetSubstract(total, left);
+      const bst_float put_right_loss_chg =
+          this->SplitLossChange(score, nid, fid, d_step, left, right);
+      trace.Candidate(fid, nid, RobustCandidate::kAllRight, put_right_loss_chg);
+      // swap
+      left.SetUnion(e.stats_c_left, e.stats_unc_right);
+      if (kMissingLeft) left.Add(e.stats_missing);
+      right.SetSubstract(total, left);
+      const bst_float swap_loss_chg =
+          this->SplitLossChange(score, nid, fid, d_step, left, right);
+      trace.Candidate(fid, nid, RobustCandidate::kSwap, swap_loss_chg);
+      return std::min(std::min(put_left_loss_chg, put_right_loss_chg), swap_loss_chg);
+    }
+    // add a scanned entry to the statistics and the windows of its node
+    inline void PushEntry(const Entry *it, GradientPair gstats, ThreadEntry *p_e) {
+      ThreadEntry &e = *p_e;
+      e.prefix_scanned.push_back(e.stats);
+      e.stats.Add(gstats);
+      e.last_fvalue = it->fvalue;
+      e.data_scanned.push_back(it);
+    }
+    /*!
+     * \brief move the starts of the windows of a node to data_scanned[left_end]
+     *  and data_scanned[certain_end], the window statistics are then prefix
+     *  differences
+     */
+    template <typename Trace>
+    inline void MoveWindows(size_t left_end, size_t certain_end, bst_uint fid, int nid,
+                            ThreadEntry *p_e, Trace &trace) {  // NOLINT(*)
+      ThreadEntry &e = *p_e;
+      if (left_end != e.unc_right_begin) {
+        e.left_counter += static_cast<unsigned>(left_end - e.unc_right_begin);
+        e.left_last_fvalue = e.data_scanned[left_end - 1]->fvalue;
+        e.unc_right_begin = left_end;
+        e.stats_left.SetCopy(e.PrefixStats(left_end));
+      }
+      if (certain_end != e.unc_begin) {
+        const auto npop = static_cast<unsigned>(certain_end - e.unc_begin);
+        trace.WindowPop(fid, nid, npop);
+        e.c_left_counter += npop;
+        e.unc_begin = certain_end;
+        e.stats_c_left.SetCopy(e.PrefixStats(certain_end));
+      }
+      e.stats_unc_right.SetSubstract(e.stats, e.stats_left);
+      e.stats_unc.SetSubstract(e.stats, e.stats_c_left);
+    }
+    // record the neighbours of eta when the best split of the scan is at eta:
+    // the last datum added to stats_left is the largest value < eta, the next
+    // scanned value (or the current one) is >= eta
+    inline void SetMid(bst_float fvalue, ThreadEntry *p_e) {
+      ThreadEntry &e = *p_e;
+      e.has_mid = e.left_counter > 0;
+      if (e.has_mid) {
+        const bst_float next = e.unc_right_begin < e.data_scanned.size() ?
+            e.data_scanned[e.unc_right_begin]->fvalue : fvalue;
+        e.mid_value = (e.left_last_fvalue + next) * 0.5f;
+      }
+    }
+    // evaluate the robust split of node nid at eta that sends the rows missing
+    // the feature left, the split the backward scan would find
+    template <typename Trace, typename Score>
+    inline void MissingLeftSplit(int nid, bst_uint fid, bst_float eta, bst_float fvalue,
+                                 ThreadEntry *p_e, Trace &trace,  // NOLINT(*)
+                                 const Score &score) {
+      ThreadEntry &e = *p_e;
+      if (e.stats.sum_hess + e.stats_missing.sum_hess < param_.min_child_weight) return;
+      GradStats left(param_), right(param_);
+      left.SetUnion(e.stats_left, e.stats_missing);
+      right.SetSubstract(snode_[nid].stats, left);
+      if (right.sum_hess < param_.min_child_weight) return;
+      // the split index carries the default direction, the score takes (left, right)
+      bst_float loss_chg = this->SplitLossChange(score, nid, fid, +1, left, right);
+      trace.Candidate(fid, nid, RobustCandidate::kNatural, loss_chg);
+      if (e.UncSize() > 0) {
+        loss_chg = std::min(loss_chg,
+                            this->WorstCaseLossChange<true>(score, nid, fid, +1, e, trace));
+      }
+      if (e.best.Update(loss_chg, fid, eta, true)) {
+        this->SetMid(fvalue, &e);
+      }
+    }
+    // scan one entry of node nid in ascending order and evaluate the robust split before it
+    template <typename Trace, typename Score>
+    inline void ScanEntry(const Entry *it, int nid, GradientPair gstats, int d_step,
+                          bst_uint fid, bst_float eps, const common::EpsWindow &win,
+                          ThreadEntry *p_e,
+                          GradStats *p_c, Trace &trace,  // NOLINT(*)
+                          const Score &score) {
+      ThreadEntry &e = *p_e;
+      if (e.skip) return;
+      GradStats &c = *p_c;
+      const bst_float fvalue = it->fvalue;
+      // if we are using descent order, eta = x + eps, if we are using ascent order, eta = x - eps
+      const bst_float eta = fvalue - eps;
+      trace.Entry(fid, nid, fvalue, eta, gstats);
+      // test if first hit, this is fine, because we set 0 during init
+      if (e.stats.Empty()) {
+        this->PushEntry(it, gstats, &e);
+        trace.WindowPush(fid, nid, 1);
+        return;
+      }
+      // the data < eta join stats_left, the data < eta - eps leave the uncertain range
+      const size_t nscanned = e.data_scanned.size();
+      size_t left_end = e.unc_right_begin, certain_end = e.unc_begin;
+      if (win.data != nullptr) {
+        // the scanned entries are in column order, compare their positions
+        const size_t i = it - win.data;
+        const Entry *left_bound = win.data + win.left[i];
+        const Entry *certain_bound = win.data + win.certain[i];
+        while (left_end < nscanned && e.data_scanned[left_end] < left_bound) ++left_end;
+        while (certain_end < nscanned && e.data_scanned[certain_end] < certain_bound) {
+          ++certain_end;
+        }
+      } else {
+        while (left_end < nscanned && e.data_scanned[left_end]->fvalue < eta) ++left_end;
+        while (certain_end < nscanned && e.data_scanned[certain_end]->fvalue < eta - eps) {
+          ++certain_end;
+        }
+      }
+      this->MoveWindows(left_end, certain_end, fid, nid, &e, trace);
+      if (Trace::kEnabled) {
+        // certain right data, including the rows that miss this feature
+        const unsigned c_right_counter =
+            snode_[nid].num_row - e.c_left_counter - e.UncSize();
+        trace.Window(fid, nid, e.c_left_counter, e.UncSize(), c_right_counter);
+      }
+      // try to find a split
+      if (fvalue != e.last_fvalue &&
+          e.stats.sum_hess >= param_.min_child_weight) {
+        c.SetSubstract(snode_[nid].stats, e.stats_left);
+        if (c.sum_hess >= param_.min_child_weight) {
+          bst_float loss_chg =
+              this->SplitLossChange(score, nid, fid, d_step, e.stats_left, c);
+          trace.Candidate(fid, nid, RobustCandidate::kNatural, loss_chg);
+          // one-side/swap minimization
+          if (e.UncSize() > 0) {
+            loss_chg = std::min(
+                loss_chg, this->WorstCaseLossChange<false>(score, nid, fid, d_step, e, trace));
+          }
+          if (e.best.Update(loss_chg, fid, eta, d_step == -1)) {
+            this->SetMid(fvalue, &e);
+          }
+        }
+      }
+      if (e.missing_left && fvalue != e.last_fvalue) {
+        this->MissingLeftSplit(nid, fid, eta, fvalue, &e, trace, score);
+      }
+      // update the statistics, add data to the two windows
+      this->PushEntry(it, gstats, &e);
+      trace.WindowPush(fid, nid, 1);
+      trace.NodeBest(fid, nid, e.best);
+    }
+    // try the split after all the data of node nid, given their sum and largest value
+    template <typename Trace, typename Score>
+    inline void UpdateAllSum(int nid, int d_step, bst_uint fid, bst_float eps,
+                             const GradStats &sum, bst_float last_fvalue,
+                             ThreadEntry *p_e, GradStats *p_c,
+                             Trace &trace, const Score &score) {  // NOLINT(*)
+      GradStats &c = *p_c;
+      c.SetSubstract(snode_[nid].stats, sum);
+      if (sum.sum_hess >= param_.min_child_weight &&
+          c.sum_hess >= param_.min_child_weight) {
+        const bst_float loss_chg = this->SplitLossChange(score, nid, fid, d_step, sum, c);
+        trace.Candidate(fid, nid, RobustCandidate::kAllSum, loss_chg);
+        const bst_float gap = std::abs(last_fvalue) + kRtEps + eps;
+        const bst_float delta = d_step == +1 ? gap: -gap;
+        if (p_e->best.Update(loss_chg, fid, last_fvalue + delta, d_step == -1)) {
+          p_e->has_mid = false;
+        }
+      }
+    }
+    // try the split sending only the rows missing the feature left, before
+    // all the data of node nid
+    template <typename Trace, typename Score>
+    inline void UpdateAllMissing(int nid, bst_uint fid, bst_float eps, ThreadEntry *p_e,
+                                 GradStats *p_c, Trace &trace,  // NOLINT(*)
+                                 const Score &score) {
+      ThreadEntry &e = *p_e;
+      GradStats &c = *p_c;
+      c.SetSubstract(snode_[nid].stats, e.stats_missing);
+      if (e.stats_missing.sum_hess >= param_.min_child_weight &&
+          c.sum_hess >= param_.min_child_weight) {
+        const bst_float loss_chg =
+            this->SplitLossChange(score, nid, fid, +1, e.stats_missing, c);
+        trace.Candidate(fid, nid, RobustCandidate::kAllSum, loss_chg);
+        const bst_float gap = std::abs(e.first_fvalue) + kRtEps + eps;
+        if (e.best.Update(loss_chg, fid, e.first_fvalue - gap, true)) {
+          e.has_mid = false;
+        }
+      }
+    }
+    // move the threshold found in the current scan to the middle of its neighbours
+    template <typename Trace>
+    inline void MoveToMid(int nid, bst_uint fid, ThreadEntry *p_e,
+                          Trace &trace) {  // NOLINT(*)
+      ThreadEntry &e = *p_e;
+      if (e.has_mid) {
+        trace.MoveThreshold(fid, nid, e.best.split_value, e.mid_value);
+        e.best.update_split_value(e.mid_value);
+        e.has_mid = false;
+      }
+      trace.NodeBest(fid, nid, e.best);
+    }
+    // clear all the temp statistics of the scan of a feature
+    inline void ClearScan(common::NodeArena<ThreadEntry> &temp) {  // NOLINT(*)
+      for (auto nid : qexpand_) {
+        temp[nid].stats.Clear();
+        temp[nid].stats_left.Clear();
+        temp[nid].ClearWindow();
+        temp[nid].stats_unc_right.Clear();
+        temp[nid].stats_c_left.Clear();
+        temp[nid].c_left_counter = 0;
+        temp[nid].left_counter = 0;
+        temp[nid].stats_unc.Clear();
+        temp[nid].has_mid = false;
+        temp[nid].run_mark = -1;
+        temp[nid].scanned_counter = 0;
+      }
+    }
+    /*!
+     * \brief scan the entries of a column in blocks: the nodes and the gradients
+     *  of a block are gathered first, with those of the next block prefetched,
+     *  so that the eps windows of the block run without waiting on the random
+     *  accesses of position_ and gpair. The entries are scanned in order.
+     */
+    template <typename Trace, typename Score>
+    inline void ScanBlocks(const Entry *first, int length, int step, int d_step,
+                           bst_uint fid, bst_float eps, const common::EpsWindow &win,
+                           const std::vector<GradientPair> &gpair,
+                           common::NodeArena<ThreadEntry> &temp,  // NOLINT(*)
+                           GradStats *p_c, Trace &trace,  // NOLINT(*)
+                           const Score &score) {
+      constexpr int kBuffer = 32;
+      int buf_position[kBuffer];
+      GradientPair buf_gpair[kBuffer];
+      const int *position = dmlc::BeginPtr(position_);
+      for (int begin = 0; begin < length; begin += kBuffer) {
+        const int n = std::min(kBuffer, length - begin);
+        const Entry *block = first + static_cast<std::ptrdiff_t>(begin) * step;
+        const int nnext = std::min(kBuffer, length - begin - n);
+        for (int i = 0; i < nnext; ++i) {
+          const bst_uint ridx = block[static_cast<std::ptrdiff_t>(n + i) * step].index;
+          XGBOOST_PREFETCH(position + ridx);
+          XGBOOST_PREFETCH(dmlc::BeginPtr(gpair) + ridx);
+        }
+        for (int i = 0; i < n; ++i) {
+          const bst_uint ridx = block[static_cast<std::ptrdiff_t>(i) * step].index;
+          buf_position[i] = position[ridx];
+          buf_gpair[i] = gpair[ridx];
+        }
+        for (int i = 0; i < n; ++i) {
+          const int nid = buf_position[i];
+          if (nid < 0) continue;
+          this->ScanEntry(block + static_cast<std::ptrdiff_t>(i) * step, nid, buf_gpair[i],
+                          d_step, fid, eps, win, &temp[nid], p_c, trace, score);
+        }
+      }
+    }
+    // enumerate the split values of specific feature
+    // Trace is a trace policy in robust_trace.h, NoRobustTrace removes all tracing code
+    template <typename Trace, typename Score>
+    inline void EnumerateSplit(const Entry *begin,
+                               const Entry *end,
+                               int d_step,
+                               bst_uint fid,
+                               const std::vector<GradientPair> &gpair,
+                               const MetaInfo &info,
+                               common::NodeArena<ThreadEntry> &temp,  // NOLINT(*)
+                               Trace trace, const Score &score) {
+      // check descent ordering or ascent ordering.
+      const bool descent = (begin->fvalue) > ((end - d_step)->fvalue);
+      // here we enforce ascent order since in xgboost the split is defined as <eta vs. >=eta
+      const Entry *first = descent ? end - d_step : begin;
+      const int step = descent ? -d_step : d_step;
+      const int length = std::abs(begin - end);
+      const Entry *last = first + step * length;
+      const bst_float eps = static_cast<bst_float>(param_.robust_eps);
+      const common::EpsWindow win = eps_windows_.GetColumn(fid, first, length);
+      trace.BeginFeature(fid, d_step, eps, length, descent);
+
+      const std::vector<int> &qexpand = qexpand_;
+      this->ClearScan(temp);
+      // left statistics
+      GradStats c(param_);
+
+      if (param_.cache_opt) {
+        this->ScanBlocks(first, length, step, d_step, fid, eps, win, gpair, temp, &c,
+                         trace, score);
+      } else {
+        for (const Entry *it = first; it != last; it += step) {
+          const int nid = position_[it->index];
+          if (nid < 0) continue;
+          this->ScanEntry(it, nid, gpair[it->index], d_step, fid, eps, win, &temp[nid], &c,
+                          trace, score);
+        }
+      }
+      // finish updating all statistics, check if it is possible to include all sum statistics
+      for (int nid : qexpand) {
+        ThreadEntry &e = temp[nid];
+        this->UpdateAllSum(nid, d_step, fid, eps, e.stats, e.last_fvalue, &e, &c, trace, score);
+        if (e.missing_left) {
+          this->UpdateAllMissing(nid, fid, eps, &e, &c, trace, score);
+        }
+        this->MoveToMid(nid, fid, &e, trace);
+        if (!e.data_scanned.empty()) {
+          this->CheckExhausted(nid, fid, e.data_scanned.front()->fvalue, e.last_fvalue,
+                               e.data_scanned.size());
+        }
+      }
+      trace.EndFeature(fid);
+    }
+    // enumerate the split values of specific feature, dispatch on the trace policy
+    template <typename Score>
+    inline void EnumerateSplit(const Entry *begin,
+                               const Entry *end,
+                               int d_step,
+                               bst_uint fid,
+                               const std::vector<GradientPair> &gpair,
+                               const MetaInfo &info,
+                               common::NodeArena<ThreadEntry> &temp,  // NOLINT(*)
+                               const Score &score) {
+      RobustTraceSink *sink = this->TraceSink();
+      if (sink != nullptr) {
+        this->EnumerateSplit(begin, end, d_step, fid, gpair, info, temp,
+                             SinkRobustTrace(sink), score);
+      } else {
+        this->EnumerateSplit(begin, end, d_step, fid, gpair, info, temp,
+                             NoRobustTrace(), score);
+      }
+    }
+    // dispatch on the split score, the virtual evaluator chain is the fallback
+    inline void EnumerateSplit(const Entry *begin,
+                               const Entry *end,
+                               int d_step,
+                               bst_uint fid,
+                               const std::vector<GradientPair> &gpair,
+                               const MetaInfo &info,
+                               common::NodeArena<ThreadEntry> &temp) {  // NOLINT(*)
+      if (elastic_net_) {
+        this->EnumerateSplit(begin, end, d_step, fid, gpair, info, temp,
+                             elastic_net_score_);
+      } else {
+        this->EnumerateSplit(begin, end, d_step, fid, gpair, info, temp,
+                             EvaluatorSplitScore{spliteval_.get()});
+      }
+    }
+    // add the current run of a node to the statistics and the windows
+    inline void PushRun(bst_float fvalue, ThreadEntry *p_e) {
+      ThreadEntry &e = *p_e;
+      e.stats.Add(e.run_stats);
+      e.last_fvalue = fvalue;
+      e.runs_scanned.push_back(ThreadEntry::ValueRun{fvalue, e.run_stats, e.run_count});
+      e.scanned_counter += e.run_count;
+      e.stats_unc_right.Add(e.run_stats);
+      e.stats_unc.Add(e.run_stats);
+    }
+    /*!
+     * \brief scan the run of value fvalue of node nid, the run version of
+     *  ScanEntry: the data of a run share eta, so the windows move and the
+     *  robust split before the run is evaluated once for the whole run.
+     */
+    template <typename Trace, typename Score>
+    inline void ScanRun(bst_float fvalue, int nid, int d_step, bst_uint fid,
+                        bst_float eps, ThreadEntry *p_e, GradStats *p_c,
+                        Trace &trace, const Score &score) {  // NOLINT(*)
+      ThreadEntry &e = *p_e;
+      GradStats &c = *p_c;
+      const bst_float eta = fvalue - eps;
+      if (e.stats.Empty()) {
+        this->PushRun(fvalue, &e);
+        trace.WindowPush(fid, nid, e.run_count);
+        return;
+      }
+      // move the runs < eta to stats_left
+      const size_t nscanned = e.runs_scanned.size();
+      while (e.unc_right_begin < nscanned &&
+             e.runs_scanned[e.unc_right_begin].fvalue < eta) {
+        const ThreadEntry::ValueRun &run = e.runs_scanned[e.unc_right_begin];
+        e.stats_left.Add(run.stats);
+        e.stats_unc_right.Subtract(run.stats);
+        e.left_counter += run.count;
+        e.left_last_fvalue = run.fvalue;
+        ++e.unc_right_begin;
+      }
+      // move the runs < eta - eps out of the uncertain range
+      while (e.unc_begin < nscanned &&
+             e.runs_scanned[e.unc_begin].fvalue < eta - eps) {
+        const ThreadEntry::ValueRun &run = e.runs_scanned[e.unc_begin];
+        e.stats_c_left.Add(run.stats);
+        e.c_left_counter += run.count;
+        e.stats_unc.Subtract(run.stats);
+        trace.WindowPop(fid, nid, run.count);
+        ++e.unc_begin;
+      }
+      const unsigned unc_counter = e.scanned_counter - e.c_left_counter;
+      if (Trace::kEnabled) {
+        const unsigned c_right_counter =
+            snode_[nid].num_row - e.c_left_counter - unc_counter;
+        trace.Window(fid, nid, e.c_left_counter, unc_counter, c_right_counter);
+      }
+      if (e.stats.sum_hess >= param_.min_child_weight) {
+        c.SetSubstract(snode_[nid].stats, e.stats_left);
+        if (c.sum_hess >= param_.min_child_weight) {
+          bst_float loss_chg =
+              this->SplitLossChange(score, nid, fid, d_step, e.stats_left, c);
+          trace.Candidate(fid, nid, RobustCandidate::kNatural, loss_chg);
+          if (unc_counter > 0) {
+            loss_chg = std::min(
+                loss_chg, this->WorstCaseLossChange<false>(score, nid, fid, d_step, e, trace));
+          }
+          if (e.best.Update(loss_chg, fid, eta, d_step == -1)) {
+            e.has_mid = e.left_counter > 0;
+            if (e.has_mid) {
+              const bst_float next = e.unc_right_begin < nscanned ?
+                  e.runs_scanned[e.unc_right_begin].fvalue : fvalue;
+              e.mid_value = (e.left_last_fvalue + next) * 0.5f;
+            }
           }
         }
       }
-      // rescan, generate candidate split
-      #pragma omp parallel
-      {
-        GradStats c(param_), cright(param_);
-        const int tid = omp_get_thread_num();
-        std::vector<ThreadEntry> &temp = stemp_[tid];
-        bst_uint step = (col.length + this->nthread_ - 1) / this->nthread_;
-        bst_uint end = std::min(col.length, step * (tid + 1));
-        for (bst_uint i = tid * step; i < end; ++i) {
-          const bst_uint ridx = col[i].index;
+      this->PushRun(fvalue, &e);
+      trace.WindowPush(fid, nid, e.run_count);
+      trace.NodeBest(fid, nid, e.best);
+    }
+    /*!
+     * \brief enumerate the split values of a feature stored as value runs,
+     *  gives the same candidates as EnumerateSplit on the column.
+     * \param nodes buffer of the nodes with data in the current run
+     */
+    template <typename Trace, typename Score>
+    inline void EnumerateRuns(const common::RunColumn &col,
+                              int d_step,
+                              bst_uint fid,
+                              const std::vector<GradientPair> &gpair,
+                              const MetaInfo &info,
+                              common::NodeArena<ThreadEntry> &temp,  // NOLINT(*)
+                              std::vector<int> *nodes,
+                              Trace trace, const Score &score) {
+      const bst_float eps = static_cast<bst_float>(param_.robust_eps);
+      trace.BeginFeature(fid, d_step, eps, col.run_ptr[col.num_run], false);
+      this->ClearScan(temp);
+      GradStats c(param_);
+      for (uint32_t r = 0; r < col.num_run; ++r) {
+        const bst_float fvalue = col.value[r];
+        // sum the data of the run per node
+        nodes->clear();
+        for (uint32_t i = col.run_ptr[r]; i < col.run_ptr[r + 1]; ++i) {
+          const bst_uint ridx = col.index[i];
           const int nid = position_[ridx];
-          if (nid < 0) continue;
-          const bst_float fvalue = col[i].fvalue;
-          // get the statistics of nid
+          if (nid < 0 || temp[nid].skip) continue;
           ThreadEntry &e = temp[nid];
-          if (e.stats.Empty()) {
-            e.stats.Add(gpair, info, ridx);
-            e.first_fvalue = fvalue;
-          } else {
-            // forward default right
-            if (fvalue != e.first_fvalue) {
-              if (need_forward) {
-                c.SetSubstract(snode_[nid].stats, e.stats);
-                if (c.sum_hess >= param_.min_child_weight &&
-                    e.stats.sum_hess >= param_.min_child_weight) {
-                  auto loss_chg = static_cast<bst_float>(
-                      spliteval_->ComputeSplitScore(nid, fid, e.stats, c) -
-                      snode_[nid].root_gain);
-                  e.best.Update(loss_chg, fid, (fvalue + e.first_fvalue) * 0.5f,
-                                false);
-                }
-              }
-              if (need_backward) {
-                cright.SetSubstract(e.stats_extra, e.stats);
-                c.SetSubstract(snode_[nid].stats, cright);
-                if (c.sum_hess >= param_.min_child_weight &&
-                    cright.sum_hess >= param_.min_child_weight) {
-                  auto loss_chg = static_cast<bst_float>(
-                      spliteval_->ComputeSplitScore(nid, fid, c, cright) -
-                      snode_[nid].root_gain);
-                  e.best.Update(loss_chg, fid, (fvalue + e.first_fvalue) * 0.5f, true);
-                }
-              }
-            }
-            e.stats.Add(gpair, info, ridx);
-            e.first_fvalue = fvalue;
+          if (e.run_mark != static_cast<int>(r)) {
+            e.run_mark = static_cast<int>(r);
+            e.run_stats.Clear();
+            e.run_count = 0;
+            nodes->push_back(nid);
           }
+          trace.Entry(fid, nid, fvalue, fvalue - eps, gpair[ridx]);
+          e.run_stats.Add(gpair, info, ridx);
+          ++e.run_count;
+        }
+        for (int nid : *nodes) {
+          this->ScanRun(fvalue, nid, d_step, fid, eps, &temp[nid], &c, trace, score);
+        }
+      }
+      for (int nid : qexpand_) {
+        ThreadEntry &e = temp[nid];
+        this->UpdateAllSum(nid, d_step, fid, eps, e.stats, e.last_fvalue, &e, &c, trace, score);
+        this->MoveToMid(nid, fid, &e, trace);
+        if (!e.runs_scanned.empty()) {
+          this->CheckExhausted(nid, fid, e.runs_scanned.front().fvalue, e.last_fvalue,
+                               e.scanned_counter);
         }
       }
+      trace.EndFeature(fid);
     }
-    // update enumeration solution
-    inline void UpdateEnumeration(int nid, GradientPair gstats,
-                                  bst_float fvalue, int d_step, bst_uint fid,
-                                  GradStats &c, std::vector<ThreadEntry> &temp) { // NOLINT(*)
-      // get the statistics of nid
-      ThreadEntry &e = temp[nid];
-      // test if first hit, this is fine, because we set 0 during init
-      if (e.stats.Empty()) {
-        e.stats.Add(gstats);
-        e.last_fvalue = fvalue;
-      } else {
-        // try to find a split
-        if (fvalue != e.last_fvalue &&
-            e.stats.sum_hess >= param_.min_child_weight) {
-          c.SetSubstract(snode_[nid].stats, e.stats);
-          if (c.sum_hess >= param_.min_child_weight) {
-            bst_float loss_chg;
-            if (d_step == -1) {
-              loss_chg = static_cast<bst_float>(
-                  spliteval_->ComputeSplitScore(nid, fid, c, e.stats) -
-                  snode_[nid].root_gain);
-            } else {
-              loss_chg = static_cast<bst_float>(
-                  spliteval_->ComputeSplitScore(nid, fid, e.stats, c) -
-                  snode_[nid].root_gain);
-            }
-            e.best.Update(loss_chg, fid, (fvalue + e.last_fvalue) * 0.5f,
-                          d_step == -1);
-          }
+    // enumerate the value runs of a feature, dispatch on the trace policy and the split score
+    inline void EnumerateRuns(const common::RunColumn &col,
+                              int d_step,
+                              bst_uint fid,
+                              const std::vector<GradientPair> &gpair,
+                              const MetaInfo &info,
+                              common::NodeArena<ThreadEntry> &temp,  // NOLINT(*)
+                              std::vector<int> *nodes) {
+      const EvaluatorSplitScore chain{spliteval_.get()};
+      RobustTraceSink *sink = this->TraceSink();
+      if (sink != nullptr) {
+        const SinkRobustTrace trace(sink);
+        if (elastic_net_) {
+          this->EnumerateRuns(col, d_step, fid, gpair, info, temp, nodes, trace,
+                              elastic_net_score_);
+        } else {
+          this->EnumerateRuns(col, d_step, fid, gpair, info, temp, nodes, trace, chain);
         }
-        // update the statistics
-        e.stats.Add(gstats);
-        e.last_fvalue = fvalue;
+      } else if (elastic_net_) {
+        this->EnumerateRuns(col, d_step, fid, gpair, info, temp, nodes, NoRobustTrace(),
+                            elastic_net_score_);
+      } else {
+        this->EnumerateRuns(col, d_step, fid, gpair, info, temp, nodes, NoRobustTrace(),
+                            chain);
       }
     }
-    // same as EnumerateSplit, with cacheline prefetch optimization
-    inline void EnumerateSplitCacheOpt(const Entry *begin,
-                                       const Entry *end,
-                                       int d_step,
-                                       bst_uint fid,
-                                       const std::vector<GradientPair> &gpair,
-                                       std::vector<ThreadEntry> &temp) { // NOLINT(*)
-      const std::vector<int> &qexpand = qexpand_;
-      // clear all the temp statistics
-      for (auto nid : qexpand) {
-        temp[nid].stats.Clear();
+    /*!
+     * \brief prepare the single pass of robust_single_pass: sum the data of each
+     *  node in the column with a plain scan, so that the statistics of the rows
+     *  missing the feature are known before the robust scan.
+     */
+    inline void InitMissingLeft(const SparsePage::Inst &col,
+                                const std::vector<GradientPair> &gpair,
+                                const MetaInfo &info,
+                                common::NodeArena<ThreadEntry> &temp) {  // NOLINT(*)
+      for (int nid : qexpand_) {
+        temp[nid].stats_missing.Clear();
       }
-      // left statistics
-      GradStats c(param_);
-      // local cache buffer for position and gradient pair
-      constexpr int kBuffer = 32;
-      int buf_position[kBuffer] = {};
-      GradientPair buf_gpair[kBuffer] = {};
-      // aligned ending position
-      const Entry *align_end;
-      if (d_step > 0) {
-        align_end = begin + (end - begin) / kBuffer * kBuffer;
-      } else {
-        align_end = begin - (begin - end) / kBuffer * kBuffer;
-      }
-      int i;
-      const Entry *it;
-      const int align_step = d_step * kBuffer;
-      // internal cached loop
-      for (it = begin; it != align_end; it += align_step) {
-        const Entry *p;
-        for (i = 0, p = it; i < kBuffer; ++i, p += d_step) {
-          buf_position[i] = position_[p->index];
-          buf_gpair[i] = gpair[p->index];
-        }
-        for (i = 0, p = it; i < kBuffer; ++i, p += d_step) {
-          const int nid = buf_position[i];
-          if (nid < 0) continue;
-          this->UpdateEnumeration(nid, buf_gpair[i],
-                                  p->fvalue, d_step,
-                                  fid, c, temp);
+      for (bst_uint i = 0; i < col.length; ++i) {
+        const bst_uint ridx = col[i].index;
+        const int nid = position_[ridx];
+        if (nid < 0) continue;
+        ThreadEntry &e = temp[nid];
+        // the column is in ascending order
+        if (!e.missing_left) {
+          e.missing_left = true;
+          e.first_fvalue = col[i].fvalue;
         }
+        e.stats_missing.Add(gpair, info, ridx);
       }
-      // finish up the ending piece
-      for (it = align_end, i = 0; it != end; ++i, it += d_step) {
-        buf_position[i] = position_[it->index];
-        buf_gpair[i] = gpair[it->index];
+      for (int nid : qexpand_) {
+        ThreadEntry &e = temp[nid];
+        e.stats_missing.SetSubstract(snode_[nid].stats, e.stats_missing);
       }
-      for (it = align_end, i = 0; it != end; ++i, it += d_step) {
-        const int nid = buf_position[i];
-        if (nid < 0) continue;
-        this->UpdateEnumeration(nid, buf_gpair[i],
-                                it->fvalue, d_step,
-                                fid, c, temp);
+    }
+    /*!
+     * \brief record that feature fid is exhausted at node nid, see
+     *  robust_skip_exhausted, given the first and the last value scanned, in
+     *  either order, and the number of entries. When every row of the node
+     *  has the feature and no value is below (largest - eps) - eps, no datum
+     *  is ever certain left: the worst case assignment sending the uncertain data
+     *  right leaves the left child empty, so no robust split of the feature
+     *  gains at the node. The rows of its subtree are fewer and closer, so the
+     *  feature is skipped there too.
+     */
+    inline void CheckExhausted(int nid, bst_uint fid, bst_float first, bst_float last,
+                               size_t count) {
+      if (!param_.robust_skip_exhausted || count != snode_[nid].num_row) return;
+      const auto eps = static_cast<bst_float>(param_.robust_eps);
+      const bst_float lo = std::min(first, last), hi = std::max(first, last);
+      if (lo >= (hi - eps) - eps) {
+        exhausted_found_[omp_get_thread_num()].emplace_back(nid, fid);
       }
-      // finish updating all statistics, check if it is possible to include all sum statistics
-      for (int nid : qexpand) {
-          ThreadEntry &e = temp[nid];
-          c.SetSubstract(snode_[nid].stats, e.stats);
-          if (e.stats.sum_hess >= param_.min_child_weight &&
-              c.sum_hess >= param_.min_child_weight) {
-            bst_float loss_chg;
-            if (d_step == -1) {
-              loss_chg = static_cast<bst_float>(
-                  spliteval_->ComputeSplitScore(nid, fid, c, e.stats) -
-                  snode_[nid].root_gain);
-            } else {
-              loss_chg = static_cast<bst_float>(
-                  spliteval_->ComputeSplitScore(nid, fid, e.stats, c) -
-                  snode_[nid].root_gain);
-            }
-            const bst_float gap = std::abs(e.last_fvalue) + kRtEps;
-            const bst_float delta = d_step == +1 ? gap: -gap;
-            e.best.Update(loss_chg, fid, e.last_fvalue + delta, d_step == -1);
+    }
+    // add the exhausted features found by the threads to their nodes
+    inline void MergeExhausted() {
+      for (auto &found : exhausted_found_) {
+        for (const auto &nf : found) {
+          if (exhausted_.size() <= static_cast<size_t>(nf.first)) {
+            exhausted_.resize(nf.first + 1);
           }
+          std::vector<bst_uint> &fids = exhausted_[nf.first];
+          // both directions of a scan find the feature
+          auto it = std::lower_bound(fids.begin(), fids.end(), nf.second);
+          if (it == fids.end() || *it != nf.second) fids.insert(it, nf.second);
         }
+        found.clear();
       }
-
-      // enumerate the split values of specific feature
-      inline void EnumerateSplit(const Entry *begin,
-                                 const Entry *end,
-                                 int d_step,
-                               bst_uint fid,
-                               const std::vector<GradientPair> &gpair,
-                               const MetaInfo &info,
-                               std::vector<ThreadEntry> &temp) { // NOLINT(*)
-      // use cacheline aware optimization
-      //if (GradStats::kSimpleStats != 0 && param_.cache_opt != 0) {
-      //  EnumerateSplitCacheOpt(begin, end, d_step, fid, gpair, temp);
-      //  return;
-      //}
-      
-      bool descent = (begin->fvalue) > ((end-d_step)->fvalue);//check descent ordering or ascent ordering.
-      
-      if (param_.robust_training_verbose) {
-        
-        printf ("\n\n\n########################## We are now using the new robust xgboost code on feature id %d ##########################\n", int(fid)); 
-        printf("end-begin=%ld\n",end-begin);
-        printf("d_step is %d\n",d_step);
-      }
-
-      
-      // here we enforce ascent order since in xgboost the split is defined as <eta vs. >=eta
-      const Entry *first;
-      if (descent) {
-        if (param_.robust_training_verbose) printf("\n descent ordering. begin = %4.5f, end = %4.5f, need to use <=eta vs. >eta. swap the order!\n",begin->fvalue, (end-d_step)->fvalue);
-        first = end - d_step; 
-      }
-      else {
-        if (param_.robust_training_verbose) printf("\n ascent ordering. begin = %4.5f, end = %4.5f, need to use <eta vs. >=eta  \n",begin->fvalue, (end-d_step)->fvalue);
-        first = begin;
+    }
+    // the children of a split node inherit its exhausted features
+    inline void InheritExhausted(int nid, const RegTree &tree) {
+      if (static_cast<size_t>(nid) >= exhausted_.size() || exhausted_[nid].empty()) return;
+      const int cleft = tree[nid].LeftChild();
+      const int cright = tree[nid].RightChild();
+      exhausted_.resize(std::max(exhausted_.size(), static_cast<size_t>(cright) + 1));
+      exhausted_[cleft] = exhausted_[nid];
+      exhausted_[cright] = exhausted_[nid];
+    }
+    // index the nodes of qexpand by the features exhausted at them
+    inline void InitSkipped(const std::vector<int> &qexpand) {
+      skip_fids_.clear();
+      skip_ptr_.assign(1, 0);
+      skip_nodes_.clear();
+      if (!param_.robust_skip_exhausted) return;
+      std::vector<std::pair<bst_uint, int> > pairs;
+      for (int nid : qexpand) {
+        if (static_cast<size_t>(nid) >= exhausted_.size()) continue;
+        for (bst_uint fid : exhausted_[nid]) pairs.emplace_back(fid, nid);
       }
-
-      
-      const int length = std::abs(begin - end);
-      int counter = 1;
-
-      if (param_.robust_training_verbose) {
-        printf ("\n feature values:\n");
-        counter = 1;
-        for (const Entry *it = first; counter <= length; it += descent ? -d_step : d_step, counter++) {   //enforce ascent order             
-          printf ("%4.5f ",it->fvalue);
+      std::sort(pairs.begin(), pairs.end());
+      for (const auto &fn : pairs) {
+        if (skip_fids_.empty() || skip_fids_.back() != fn.first) {
+          skip_fids_.push_back(fn.first);
+          skip_ptr_.push_back(skip_nodes_.size());
         }
-        printf("\n");
+        skip_nodes_.push_back(fn.second);
+        skip_ptr_.back() = skip_nodes_.size();
       }
-      
-
+    }
+    // the nodes of qexpand_ where feature fid is exhausted, empty if none
+    inline std::pair<const int *, const int *> SkippedNodes(bst_uint fid) const {
+      auto it = std::lower_bound(skip_fids_.begin(), skip_fids_.end(), fid);
+      if (it == skip_fids_.end() || *it != fid) return {nullptr, nullptr};
+      const size_t k = it - skip_fids_.begin();
+      return {dmlc::BeginPtr(skip_nodes_) + skip_ptr_[k],
+              dmlc::BeginPtr(skip_nodes_) + skip_ptr_[k + 1]};
+    }
+    // whether feature fid is exhausted at all the nodes of qexpand_
+    inline bool AllExhausted(bst_uint fid) const {
+      const auto nodes = this->SkippedNodes(fid);
+      return static_cast<size_t>(nodes.second - nodes.first) == qexpand_.size();
+    }
+    /*!
+     * \brief flag the nodes of qexpand_ where feature fid is exhausted, so
+     *  that the scan passes over their data
+     * \return false when the feature is exhausted at all of them
+     */
+    inline bool SetSkipped(bst_uint fid, common::NodeArena<ThreadEntry> &temp) {  // NOLINT(*)
+      // the entries of a node are reused by the later trees
+      for (int nid : qexpand_) temp[nid].skip = false;
+      if (skip_fids_.empty()) return true;
+      const auto nodes = this->SkippedNodes(fid);
+      if (static_cast<size_t>(nodes.second - nodes.first) == qexpand_.size()) return false;
+      for (const int *p = nodes.first; p != nodes.second; ++p) temp[*p].skip = true;
+      return true;
+    }
+    inline void ClearMissingLeft(common::NodeArena<ThreadEntry> &temp) {  // NOLINT(*)
+      for (int nid : qexpand_) {
+        temp[nid].missing_left = false;
+      }
+    }
+    /*!
+     * \brief whether the robust enumeration of a feature can improve the
+     *  best split of any node in qexpand_.
+     *
+     *  Every robust candidate is the minimum of several assignments, one of
+     *  which is the natural split at a threshold, so its loss change never
+     *  exceeds the best non-robust loss change of the feature. That bound is
+     *  computed by a plain prefix scan, checking only the right hand side
+     *  weight so that it stays an upper bound of the robust scan.
+     */
+    inline bool CanImprove(const SparsePage::Inst &col,
+                           bool need_forward, bool need_backward,
+                           bst_uint fid,
+                           const std::vector<GradientPair> &gpair,
+                           const MetaInfo &info,
+                           common::NodeArena<ThreadEntry> &temp) {  // NOLINT(*)
       const std::vector<int> &qexpand = qexpand_;
-      // clear all the temp statistics
-      for (auto nid : qexpand) {
+      const bst_float kNoGain = -std::numeric_limits<bst_float>::max();
+      for (int nid : qexpand) {
         temp[nid].stats.Clear();
-        temp[nid].stats_left.Clear();
-        temp[nid].data_unc_right.clear();
-        temp[nid].data_unc.clear();
-        temp[nid].stats_unc_right.Clear();
-        temp[nid].stats_c_left.Clear();
-        temp[nid].c_left_counter = 0;
-        temp[nid].stats_unc.Clear();
+        temp[nid].gain_bound = kNoGain;
+        temp[nid].has_last = false;
       }
-      
-      const bst_float eps = static_cast<bst_float>(param_.robust_eps);
-      if (param_.robust_training_verbose) printf("epsilon is %4.5f\n", eps);
-      // left statistics 
-      GradStats c(param_);
-
-
-      if (param_.robust_training_verbose) printf ("\n******************************* feature id %d main loop starts ************************************", int(fid));
-      
-      std::map<int, int> n_node_point;
-      std::map<int, int>::iterator p; 
-      if (param_.robust_training_verbose){// if  verbose, need to count points at each node
-        counter = 1;
-        for (const Entry *it = first; counter <= length; it += descent ? -d_step : d_step, counter++) {
-          const bst_uint ridx = it->index;
-          int nid = position_[ridx];
-          p = n_node_point.find(nid);
-          if (p == n_node_point.end()){
-            n_node_point.insert(std::make_pair(nid, 1));
-          }
-          else {
-            p->second ++;
+      GradStats c(param_), left(param_), right(param_);
+      auto bound = [&](int nid, const ThreadEntry &e) {
+        c.SetSubstract(snode_[nid].stats, e.stats);
+        if (c.sum_hess < param_.min_child_weight) return kNoGain;
+        bst_float gain = kNoGain;
+        if (need_forward) {
+          gain = std::max(gain, this->SplitLossChange(nid, fid, +1, e.stats, c));
+        }
+        if (need_backward) {
+          gain = std::max(gain, this->SplitLossChange(nid, fid, -1, e.stats, c));
+        }
+        if (e.missing_left) {
+          // the splits of the single pass that send the missing rows left
+          left.SetUnion(e.stats, e.stats_missing);
+          right.SetSubstract(snode_[nid].stats, left);
+          if (right.sum_hess >= param_.min_child_weight) {
+            gain = std::max(gain, this->SplitLossChange(nid, fid, +1, left, right));
           }
         }
-      }
-      counter = 1;
-      for (const Entry *it = first; counter <= length; it += descent ? -d_step : d_step, counter++) {//enforce ascent order
-        
-        const bst_uint ridx = it->index;
+        return gain;
+      };
+      for (bst_uint i = 0; i < col.length; ++i) {
+        const bst_uint ridx = col[i].index;
         const int nid = position_[ridx];
-
-        if (param_.robust_training_verbose) {
-          printf("\n------------------------------------------------------------------------------------------------------------------------\n");
-          printf("nid: %d, it-begin %ld, fid %d\n", nid, it-begin, int(fid)); 
-        }
-
         if (nid < 0) continue;
-        // start working
-        const bst_float fvalue = it->fvalue;
-
-        if (param_.robust_training_verbose) printf("it->fvalue: %4.5f\n",it->fvalue); 
-
-        // if we are using descent order, eta = x + eps, if we are using ascent order, eta = x - eps
-        bst_float eta = fvalue - eps;
-
-        if (param_.robust_training_verbose) printf("eta %4.5f, uncertainty range: %4.5f ~ %4.5f, gradient:%4.5f, hessian:%4.5f\n", eta, eta-eps, eta+eps, gpair[ridx].GetGrad(), gpair[ridx].GetHess());
-        
-        // get the statistics of nid
         ThreadEntry &e = temp[nid];
-        // test if first hit, this is fine, because we set 0 during init
-        if (e.stats.Empty()) {
-          if (param_.robust_training_verbose) printf("first hit\n");
-          e.stats.Add(gpair, info, ridx);
-          e.last_fvalue = fvalue;
-          e.data_unc_right.push_back(it); 
-          e.data_unc.push_back(it);
-          e.stats_unc_right.Add(gpair, info, ridx);
-          e.stats_unc.Add(gpair, info, ridx);
-          
-        } 
-        else {
-
-          if (param_.robust_training_verbose) {
-            printf("e.data_unc_right: %4.5f ~ %4.5f\n",e.data_unc_right.front()->fvalue, e.data_unc_right.back()->fvalue);
-            printf("e.data_unc: %4.5f ~ %4.5f\n", e.data_unc.front()->fvalue, e.data_unc.back()->fvalue);
-          }
-
-          // add the unadded data to stats_left and remove them from the queue of data that <eta but unadded  
-          while (!e.data_unc_right.empty()){
-            const Entry *unadded_front = e.data_unc_right.front();
-            if (unadded_front->fvalue < eta){
-              const bst_uint unadded_front_ridx = unadded_front->index;
-              e.stats_left.Add(gpair, info, unadded_front_ridx);
-              e.stats_unc_right.Subtract(gpair, info, unadded_front_ridx);
-              e.data_unc_right.pop_front();
-            }
-            else{break;}
-          }
-          // remove the data from queue of data that is in the uncertain range
-          while (!e.data_unc.empty()){
-            const Entry *unc_front = e.data_unc.front();
-            if (unc_front->fvalue < eta - eps){
-              e.data_unc.pop_front();
-              const bst_uint unc_front_ridx = unc_front->index;
-              e.stats_c_left.Add(gpair, info, unc_front_ridx);
-              e.c_left_counter++;
-              e.stats_unc.Subtract(gpair, info, unc_front_ridx);
-              
-            }
-            else{break;}
-          }
-          // try to find a split
-          if (param_.robust_training_verbose) {
-            printf("fvalue != e.last_fvalue: %d, e.stats.sum_hess >= param_.min_child_weight: %d\n",int(fvalue != e.last_fvalue), int(e.stats.sum_hess >= param_.min_child_weight));
-            printf("s.stats_left.sum_hess %4.5f \n",e.stats_left.sum_hess);
-          }
-
-          std::map<int,int>::const_iterator p = n_node_point.find(nid);
-          int cur_node_num = 0;
-          if ( p != n_node_point.end() ) cur_node_num= p->second;
-          unsigned int c_right_counter = cur_node_num - e.c_left_counter - e.data_unc.size(); // if c_right_counter<=0, means we didn't count the number of points on this node
-          //unsigned int c_right_counter = length- e.c_left_counter - e.data_unc.size();
-          if (param_.robust_training_verbose) printf("\n left certain:%u, uncertain:%lu, right certain:%u\n",e.c_left_counter, e.data_unc.size(),c_right_counter);
-
-          if (fvalue != e.last_fvalue &&
-              e.stats.sum_hess >= param_.min_child_weight) {
-            c.SetSubstract(snode_[nid].stats, e.stats_left);
-            if (param_.robust_training_verbose) printf("c.sum_hess %4.5f, param_.min_child_weight %4.5f\n", c.sum_hess, param_.min_child_weight);
-            if (c.sum_hess >= param_.min_child_weight) {
-              if (param_.robust_training_verbose) printf("try to find a split\n");
-              bst_float loss_chg;
-              if (d_step == -1) {
-                loss_chg = static_cast<bst_float>(
-                    spliteval_->ComputeSplitScore(nid, fid, c, e.stats_left) -
-                    snode_[nid].root_gain);
-              } else {
-                loss_chg = static_cast<bst_float>(
-                    spliteval_->ComputeSplitScore(nid, fid, e.stats_left, c) -
-                    snode_[nid].root_gain);
-              }
-              if (param_.robust_training_verbose) printf("\ninitial loss change is %4.5f\n",loss_chg);
-              
-
-              // one-side/swap minimization 
-              if (e.data_unc.size()>0){
-                if (param_.robust_training_verbose) printf("\n [start minimization]\n");
-                  //all uncertainty to left
-                bst_float put_left_loss_chg;
-                GradStats all_left(param_);
-                GradStats c_right(param_);
-                all_left.SetUnion(e.stats_c_left, e.stats_unc);
-                c_right.SetSubstract(snode_[nid].stats, all_left);
-                if (d_step == -1) {
-                  put_left_loss_chg = static_cast<bst_float>(
-                      spliteval_->ComputeSplitScore(nid, fid, c_right, all_left) -
-                      snode_[nid].root_gain);
-                } else {
-                  put_left_loss_chg = static_cast<bst_float>(
-                      spliteval_->ComputeSplitScore(nid, fid, all_left, c_right) -
-                      snode_[nid].root_gain);
-                }
-                if (param_.robust_training_verbose) printf("\n put all left loss change is %4.5f\n",put_left_loss_chg);
-                if (put_left_loss_chg < loss_chg) { 
-                  loss_chg = put_left_loss_chg;
-                  if (param_.robust_training_verbose) printf("\n update loss change to %4.5f\n",loss_chg);
-                }
-                //all uncertainty to right
-                bst_float put_right_loss_chg;
-                GradStats all_right(param_);
-                all_right.SetSubstract(snode_[nid].stats, e.stats_c_left);
-                if (d_step == -1) {
-                  put_right_loss_chg = static_cast<bst_float>(
-                      spliteval_->ComputeSplitScore(nid, fid, all_right, e.stats_c_left) -
-                      snode_[nid].root_gain);
-                } else {
-                  put_right_loss_chg = static_cast<bst_float>(
-                      spliteval_->ComputeSplitScore(nid, fid, e.stats_c_left, all_right) -
-                      snode_[nid].root_gain);
-                }
-                if (param_.robust_training_verbose) printf("\n all right loss change is %4.5f\n",put_right_loss_chg);
-                if (put_right_loss_chg < loss_chg) { 
-                  loss_chg = put_right_loss_chg;
-                  if (param_.robust_training_verbose) printf("\n update loss change to %4.5f\n",loss_chg);
-                }
-                //swap  
-                bst_float swap_loss_chg;
-                GradStats swap_left(param_);
-                GradStats swap_right(param_);
-                swap_left.SetUnion(e.stats_c_left, e.stats_unc_right);
-                swap_right.SetSubstract(snode_[nid].stats, swap_left);
-                if (d_step == -1) {
-                  swap_loss_chg = static_cast<bst_float>(
-                      spliteval_->ComputeSplitScore(nid, fid, swap_right, swap_left) -
-                      snode_[nid].root_gain);
-                } else {
-                  swap_loss_chg = static_cast<bst_float>(
-                      spliteval_->ComputeSplitScore(nid, fid, swap_left, swap_right) -
-                      snode_[nid].root_gain);
-                }
-                if (param_.robust_training_verbose) printf("\n swapping loss change is %4.5f\n",swap_loss_chg);
-                if (swap_loss_chg < loss_chg) { 
-                  loss_chg = swap_loss_chg;
-                  if (param_.robust_training_verbose) printf("\n update loss change to %4.5f\n",loss_chg);
-                }
-              } 
-              e.best.Update(loss_chg, fid, eta, d_step == -1);
-            }
-          }
-          // update the statistics
-          e.stats.Add(gpair, info, ridx);
-          e.last_fvalue = fvalue;
-          // add data to the two queues
-          e.data_unc_right.push_back(it); 
-          e.data_unc.push_back(it);
-          e.stats_unc_right.Add(gpair, info, ridx);
-          e.stats_unc.Add(gpair, info, ridx);
-        }
-        //if (it == last) break;
-        if (param_.robust_training_verbose) printf("\n [main loop] current best splilt for nid %d is fid=%d, threshold=%4.5f and with loss change=%4.5f", nid, e.best.SplitIndex(), e.best.split_value, e.best.loss_chg);
-      }
-      if (param_.robust_training_verbose) printf ("\n**************** We now finished the main loop on feature id %d, all statistics starts  ****************\n", int(fid));
-      // if (param_.robust_training_verbose) printf("final loss change for nid=0: %4.5f\n",temp[0].best.loss_chg);
-      // finish updating all statistics, check if it is possible to include all sum statistics
-      // don't need this any more?
-      
+        // every prefix of the node's sorted values, including the empty one
+        if (!e.has_last || col[i].fvalue != e.last_fvalue) {
+          e.gain_bound = std::max(e.gain_bound, bound(nid, e));
+        }
+        e.stats.Add(gpair, info, ridx);
+        e.last_fvalue = col[i].fvalue;
+        e.has_last = true;
+      }
+      bool improve = false;
       for (int nid : qexpand) {
         ThreadEntry &e = temp[nid];
-        c.SetSubstract(snode_[nid].stats, e.stats);
-        if (e.stats.sum_hess >= param_.min_child_weight &&
-            c.sum_hess >= param_.min_child_weight) {
-          bst_float loss_chg;
-          if (d_step == -1) {
-            loss_chg = static_cast<bst_float>(
-                spliteval_->ComputeSplitScore(nid, fid, c, e.stats) -
-                snode_[nid].root_gain);
-          } else {
-            loss_chg = static_cast<bst_float>(
-                spliteval_->ComputeSplitScore(nid, fid, e.stats, c) -
-                snode_[nid].root_gain);
-          }
-          if (param_.robust_training_verbose) printf("\nall sum statistics loss_chg: %4.5f \n", loss_chg);
-          const bst_float gap = std::abs(e.last_fvalue) + kRtEps + eps;
-          const bst_float delta = d_step == +1 ? gap: -gap;
-          e.best.Update(loss_chg, fid, e.last_fvalue + delta, d_step == -1);
-        }
-        if (param_.robust_training_verbose) {
-          printf("\n [all statistics (nomid)] current best splilt for nid %d is fid=%d, threshold=%4.5f and with loss change=%4.5f", nid, e.best.SplitIndex(), e.best.split_value, e.best.loss_chg);
-        }
-      }
-      
-      // move thresholds to mid
-      counter = 1;
-      std::map<int,bst_float> last_fvalue_map;
-      std::set<int> updated_nid;
-      for (const Entry *it = first; counter <= length; it += descent ? -d_step : d_step, counter++) { //enforce ascent order
-          const bst_uint ridx = it->index;
-          const int nid = position_[ridx];
-          if (nid < 0) continue;
-          ThreadEntry &e = temp[nid];
-          if (e.best.SplitIndex() != fid || updated_nid.find(nid)!=updated_nid.end()) {
-            continue;
-          }
-          if (last_fvalue_map.find(nid)!=last_fvalue_map.end()){
-            if (last_fvalue_map[nid] < e.best.split_value && e.best.split_value <= it->fvalue) {
-              if (param_.robust_training_verbose) {
-              std::cout << "\nmoved! " << "nodeid: " << nid << " fid: " << fid << '\t' << last_fvalue_map[nid] << '\t' << e.best.split_value << '\t' << it->fvalue << '\t' << e.best.split_value-0.5f*(it->fvalue + last_fvalue_map[nid])<<'\n';
-              }
-              e.best.update_split_value((it->fvalue + last_fvalue_map[nid]) * 0.5f);
-              if (param_.robust_training_verbose) {
-                std::cout << e.best.split_value <<'\n';
-              }
-              updated_nid.insert(nid);
-            }
-          }
-          last_fvalue_map[nid] = it->fvalue;
+        e.gain_bound = std::max(e.gain_bound, bound(nid, e));
+        if (e.gain_bound != kNoGain && e.best.NeedReplace(e.gain_bound, fid)) {
+          improve = true;
+        }
+      }
+      return improve;
+    }
+    // enumerate the splits of one feature with the buffers of thread tid
+    inline void EnumerateFeature(const SparsePage::Inst &c, bst_uint fid,
+                                 const DMatrix &fmat,
+                                 const std::vector<GradientPair> &gpair,
+                                 int tid) {
+      const MetaInfo& info = fmat.Info();
+      // a compacted column is empty when all of its rows are finished
+      if (c.length == 0) return;
+      if (!this->SetSkipped(fid, stemp_[tid])) return;
+      const bool ind = this->IsIndicator(c, fid);
+      const bool need_forward = param_.NeedForwardSearch(fmat.GetColDensity(fid), ind);
+      const bool need_backward = param_.NeedBackwardSearch(fmat.GetColDensity(fid), ind);
+      // one robust scan evaluates both default directions, see robust_single_pass
+      const bool single_pass = param_.robust_single_pass && need_forward && need_backward &&
+          !run_columns_.HasColumn(fid);
+      if (single_pass) {
+        this->InitMissingLeft(c, gpair, info, stemp_[tid]);
+      }
+      if (param_.robust_gain_bound &&
+          !this->CanImprove(c, need_forward, need_backward, fid, gpair, info, stemp_[tid])) {
+        if (single_pass) this->ClearMissingLeft(stemp_[tid]);
+        return;
+      }
+      if (single_pass) {
+        this->EnumerateSplit(c.data, c.data + c.length, +1,
+                             fid, gpair, info, stemp_[tid]);
+        this->ClearMissingLeft(stemp_[tid]);
+        return;
+      }
+      if (run_columns_.HasColumn(fid)) {
+        const common::RunColumn col = run_columns_.GetColumn(fid);
+        if (need_forward) {
+          this->EnumerateRuns(col, +1, fid, gpair, info, stemp_[tid], &run_nodes_[tid]);
+        }
+        if (need_backward) {
+          this->EnumerateRuns(col, -1, fid, gpair, info, stemp_[tid], &run_nodes_[tid]);
+        }
+        return;
+      }
+      if (need_forward) {
+        this->EnumerateSplit(c.data, c.data + c.length, +1,
+                             fid, gpair, info, stemp_[tid]);
+      }
+      if (need_backward) {
+        this->EnumerateSplit(c.data + c.length - 1, c.data - 1, -1,
+                             fid, gpair, info, stemp_[tid]);
       }
-      
     }
     // update the solution candidate
     virtual void UpdateSolution(const SparsePage &batch,
                                 const std::vector<bst_uint> &feat_set,
                                 const std::vector<GradientPair> &gpair,
                                 const DMatrix &fmat) {
-      const MetaInfo& info = fmat.Info();
       // start enumeration
       const auto num_features = static_cast<bst_omp_uint>(feat_set.size());
-      #if defined(_OPENMP)
-      const int batch_size = std::max(static_cast<int>(num_features / this->nthread_ / 32), 1);
-      #endif
       int poption = param_.parallel_option;
+      // under the automatic options, the columns longer than the share of a
+      // thread are each enumerated by all threads
+      const bool split_heavy = poption == 2 || poption == 3;
       if (poption == 2) {
         poption = static_cast<int>(num_features) * 2 < this->nthread_ ? 1 : 0;
+      } else if (poption == 3) {
+        this->TunedUpdateSolution(batch, feat_set, gpair, fmat);
+        return;
       }
-      if (poption == 0) {
-        #pragma omp parallel for schedule(dynamic, batch_size)
+      this->UpdateSolutionBy(batch, feat_set, gpair, fmat, poption, split_heavy);
+    }
+    // enumerate the features by thread with poption 0, or each by all the threads with 1
+    inline void UpdateSolutionBy(const SparsePage &batch,
+                                 const std::vector<bst_uint> &feat_set,
+                                 const std::vector<GradientPair> &gpair,
+                                 const DMatrix &fmat, int poption, bool split_heavy) {
+      const auto num_features = static_cast<bst_omp_uint>(feat_set.size());
+      if (poption == 0 && !thread_node_.empty()) {
+        this->UpdateSolutionByNode(batch, feat_set, gpair, fmat);
+      } else if (poption == 0) {
+        // the columns are scanned longest first, idle threads steal the rest
+        std::vector<size_t> cost(num_features);
         for (bst_omp_uint i = 0; i < num_features; ++i) {
-          int fid = feat_set[i];
+          cost[i] = batch[feat_set[i]].length;
+        }
+        scheduler_.Init(feat_set, cost, this->nthread_, split_heavy);
+        for (bst_uint fid : scheduler_.Heavy()) {
+          this->ParallelFindSplit(batch[fid], fid, fmat, gpair);
+        }
+        #pragma omp parallel num_threads(this->nthread_)
+        {
           const int tid = omp_get_thread_num();
-          auto c = batch[fid];
-          const bool ind = c.length != 0 && c.data[0].fvalue == c.data[c.length - 1].fvalue;
-          if (param_.NeedForwardSearch(fmat.GetColDensity(fid), ind)) {
-            this->EnumerateSplit(c.data, c.data + c.length, +1,
-                                 fid, gpair, info, stemp_[tid]);
-          }
-          if (param_.NeedBackwardSearch(fmat.GetColDensity(fid), ind)) {
-            this->EnumerateSplit(c.data + c.length - 1, c.data - 1, -1,
-                                 fid, gpair, info, stemp_[tid]);
+          bst_uint fid;
+          while (scheduler_.Next(tid, &fid)) {
+            if (busy_timers_.empty()) {
+              this->EnumerateFeature(batch[fid], fid, fmat, gpair, tid);
+            } else {
+              busy_timers_[tid].Start();
+              this->EnumerateFeature(batch[fid], fid, fmat, gpair, tid);
+              busy_timers_[tid].Stop();
+            }
           }
         }
       } else {
-        for (bst_omp_uint fid = 0; fid < num_features; ++fid) {
+        for (bst_omp_uint i = 0; i < num_features; ++i) {
+          const bst_uint fid = feat_set[i];
           this->ParallelFindSplit(batch[fid], fid,
                                   fmat, gpair);
         }
       }
     }
+    /*!
+     * \brief UpdateSolution under parallel_option=3. The calls are bucketed by
+     *  the level and the power of two above the number of nodes expanded: the
+     *  first calls of a bucket time the enumeration by feature and by column
+     *  per entry of the columns, then the bucket keeps the faster one.
+     */
+    inline void TunedUpdateSolution(const SparsePage &batch,
+                                    const std::vector<bst_uint> &feat_set,
+                                    const std::vector<GradientPair> &gpair,
+                                    const DMatrix &fmat) {
+      static const char *names[] = {"UpdateSolution:by_feature", "UpdateSolution:by_column"};
+      int log_nodes = 0;
+      while ((static_cast<size_t>(1) << log_nodes) < qexpand_.size()) ++log_nodes;
+      const uint64_t bucket = (static_cast<uint64_t>(level_) << 8) | log_nodes;
+      const int strategy = tuner_.Choose(bucket);
+      double entries = 0.0;
+      for (bst_uint fid : feat_set) entries += batch[fid].length;
+      monitor_.Start(names[strategy]);
+      const double start = dmlc::GetTime();
+      this->UpdateSolutionBy(batch, feat_set, gpair, fmat, strategy, true);
+      const double seconds = dmlc::GetTime() - start;
+      monitor_.Stop(names[strategy]);
+      if (tuner_.Record(bucket, strategy, seconds, entries) && monitor_.debug_verbose) {
+        LOG(CONSOLE) << "[robust] level " << level_ << ", up to " << (1 << log_nodes)
+                     << " nodes: parallel_option=" << tuner_.Chosen(bucket) << " ("
+                     << tuner_.Cost(bucket, 0) << " vs " << tuner_.Cost(bucket, 1)
+                     << " seconds per entry by feature and by column)";
+      }
+    }
+    /*!
+     * \brief UpdateSolution under numa_mode. The features are split between the
+     *  NUMA nodes in proportion to their threads, and the threads of a node take
+     *  the features of its share in turn, so that a column is read by one node.
+     *  A thread done with its node's share helps the other nodes.
+     */
+    inline void UpdateSolutionByNode(const SparsePage &batch,
+                                     const std::vector<bst_uint> &feat_set,
+                                     const std::vector<GradientPair> &gpair,
+                                     const DMatrix &fmat) {
+      const size_t num_features = feat_set.size();
+      std::vector<size_t> node_end(num_numa_node_, 0);
+      for (int tid = 0; tid < nthread_; ++tid) ++node_end[thread_node_[tid]];
+      std::vector<std::atomic<size_t> > next(num_numa_node_);
+      size_t nthread_before = 0;
+      for (int node = 0; node < num_numa_node_; ++node) {
+        next[node] = num_features * nthread_before / nthread_;
+        nthread_before += node_end[node];
+        node_end[node] = num_features * nthread_before / nthread_;
+      }
+      #pragma omp parallel num_threads(nthread_)
+      {
+        const int tid = omp_get_thread_num();
+        for (int k = 0; k < num_numa_node_; ++k) {
+          const int node = (thread_node_[tid] + k) % num_numa_node_;
+          for (size_t i = next[node]++; i < node_end[node]; i = next[node]++) {
+            const bst_uint fid = feat_set[i];
+            if (busy_timers_.empty()) {
+              this->EnumerateFeature(batch[fid], fid, fmat, gpair, tid);
+            } else {
+              busy_timers_[tid].Start();
+              this->EnumerateFeature(batch[fid], fid, fmat, gpair, tid);
+              busy_timers_[tid].Stop();
+            }
+          }
+        }
+      }
+    }
+    // grow the per thread statistics to num_nodes entries; under numa_mode
+    // each thread writes its own, which places them on its node
+    inline void ResizeThreadEntries(int num_nodes) {
+      if (thread_node_.empty()) {
+        for (auto& i : stemp_) {
+          i.Resize(num_nodes, ThreadEntry(param_));
+        }
+        return;
+      }
+      #pragma omp parallel num_threads(nthread_)
+      {
+        for (int tid = omp_get_thread_num(); tid < nthread_; tid += omp_get_num_threads()) {
+          stemp_[tid].Resize(num_nodes, ThreadEntry(param_));
+        }
+      }
+    }
     // find splits at current level, do split per level
     inline void FindSplit(int depth,
                           const std::vector<int> &qexpand,
                           const std::vector<GradientPair> &gpair,
                           DMatrix *p_fmat,
                           RegTree *p_tree) {
-      std::vector<bst_uint> feat_set = feat_index_;
-      if (param_.colsample_bylevel != 1.0f) {
-        std::shuffle(feat_set.begin(), feat_set.end(), common::GlobalRandom());
-        unsigned n = std::max(static_cast<unsigned>(1),
-                              static_cast<unsigned>(param_.colsample_bylevel * feat_index_.size()));
-        CHECK_GT(param_.colsample_bylevel, 0U)
-            << "colsample_bylevel cannot be zero.";
-        feat_set.resize(n);
-      }
-      auto iter = p_fmat->ColIterator();
-      while (iter->Next()) {
-        this->UpdateSolution(iter->Value(), feat_set, gpair, *p_fmat);
-      }
-      // after this each thread's stemp will get the best candidates, aggregate results
-      this->SyncBestSolution(qexpand);
+      level_ = depth;
+      this->EvaluateSplit(qexpand, gpair, p_fmat);
       // get the best result, we can synchronize the solution
       for (int nid : qexpand) {
         NodeEntry &e = snode_[nid];
@@ -925,11 +2070,134 @@ class RobustColMaker: public TreeUpdater {
           // mark right child as 0, to indicate fresh leaf
           (*p_tree)[(*p_tree)[nid].LeftChild()].SetLeaf(0.0f, 0);
           (*p_tree)[(*p_tree)[nid].RightChild()].SetLeaf(0.0f, 0);
+          this->InheritExhausted(nid, *p_tree);
         } else {
           (*p_tree)[nid].SetLeaf(e.weight * param_.learning_rate);
         }
       }
     }
+    // find the best split of each node in qexpand, without applying them
+    inline void EvaluateSplit(const std::vector<int> &qexpand,
+                              const std::vector<GradientPair> &gpair,
+                              DMatrix *p_fmat) {
+      std::vector<bst_uint> feat_set = feat_index_;
+      if (param_.colsample_bylevel != 1.0f) {
+        std::shuffle(feat_set.begin(), feat_set.end(), common::GlobalRandom());
+        unsigned n = std::max(static_cast<unsigned>(1),
+                              static_cast<unsigned>(param_.colsample_bylevel * feat_index_.size()));
+        CHECK_GT(param_.colsample_bylevel, 0U)
+            << "colsample_bylevel cannot be zero.";
+        feat_set.resize(n);
+      }
+      this->InitSkipped(qexpand);
+      monitor_.Start("UpdateSolution");
+      if (compact_columns_) {
+        this->UpdateSolution(compact_page_, feat_set, gpair, *p_fmat);
+      } else if (!p_fmat->SingleColBlock()) {
+        this->UpdateSolutionPages(feat_set, gpair, p_fmat);
+      } else {
+        auto iter = p_fmat->ColIteratorFor(feat_index_);
+        while (iter->Next()) {
+          this->UpdateSolution(iter->Value(), feat_set, gpair, *p_fmat);
+        }
+      }
+      monitor_.Stop("UpdateSolution");
+      this->MergeExhausted();
+      // after this each thread's stemp will get the best candidates, aggregate results
+      monitor_.Start("SyncBestSolution");
+      this->SyncBestSolution(qexpand);
+      monitor_.Stop("SyncBestSolution");
+    }
+    /*!
+     * \brief UpdateSolution over data with several column pages.
+     *
+     *  A page holds the sorted columns of a block of rows, so scanning the
+     *  pages one at a time would see each column in pieces and restart the
+     *  statistics and the eps windows at every page. Instead the features are
+     *  taken in groups of at most kMergeEntries entries: the entries of the
+     *  active rows of a group are gathered from all the pages, which the page
+     *  iterator reads ahead in the background, and the sorted pieces are
+     *  merged, so that every feature is enumerated once over its whole column.
+     */
+    inline void UpdateSolutionPages(const std::vector<bst_uint> &feat_set,
+                                    const std::vector<GradientPair> &gpair,
+                                    DMatrix *p_fmat) {
+      std::vector<bst_uint> group;
+      size_t pos = 0;
+      while (pos < feat_set.size()) {
+        group.clear();
+        size_t nentry = 0;
+        while (pos < feat_set.size() &&
+               (group.empty() || nentry + p_fmat->GetColSize(feat_set[pos]) <= kMergeEntries)) {
+          nentry += p_fmat->GetColSize(feat_set[pos]);
+          group.push_back(feat_set[pos++]);
+        }
+        this->MergeColumns(group, p_fmat);
+        merged_columns_ = true;
+        this->UpdateSolution(merged_page_, group, gpair, *p_fmat);
+        merged_columns_ = false;
+      }
+    }
+    // gather the entries of the active rows of the features in group from all
+    // pages into merged_page_, sorted by value
+    inline void MergeColumns(const std::vector<bst_uint> &group, DMatrix *p_fmat) {
+      const auto ngroup = static_cast<bst_omp_uint>(group.size());
+      const size_t ncol = p_fmat->Info().num_col_;
+      merge_buf_.resize(ngroup);
+      merge_runs_.resize(ngroup);
+      std::vector<bst_float> fmin(ngroup, std::numeric_limits<bst_float>::max());
+      std::vector<bst_float> fmax(ngroup, -std::numeric_limits<bst_float>::max());
+      for (bst_omp_uint i = 0; i < ngroup; ++i) {
+        merge_buf_[i].clear();
+        merge_runs_[i].clear();
+      }
+      auto iter = p_fmat->ColIterator();
+      while (iter->Next()) {
+        const SparsePage &batch = iter->Value();
+        common::ParallelFor(ngroup, common::Sched::Dyn(1), [&](size_t i) {
+          const SparsePage::Inst c = batch[group[i]];
+          std::vector<Entry> &buf = merge_buf_[i];
+          merge_runs_[i].push_back(buf.size());
+          if (c.length == 0) return;
+          fmin[i] = std::min(fmin[i], c.data[0].fvalue);
+          fmax[i] = std::max(fmax[i], c.data[c.length - 1].fvalue);
+          for (bst_uint j = 0; j < c.length; ++j) {
+            if (position_[c.data[j].index] >= 0) buf.push_back(c.data[j]);
+          }
+        });
+      }
+      compact_indicator_.resize(ncol, 0);
+      std::vector<size_t> &offset = merged_page_.offset;
+      offset.assign(ncol + 1, 0);
+      for (bst_omp_uint i = 0; i < ngroup; ++i) {
+        // the full column is an indicator if all its values are the same
+        compact_indicator_[group[i]] = fmin[i] == fmax[i];
+        offset[group[i] + 1] = merge_buf_[i].size();
+      }
+      for (size_t fid = 0; fid < ncol; ++fid) {
+        offset[fid + 1] += offset[fid];
+      }
+      merged_page_.data.resize(offset[ncol]);
+      common::ParallelFor(ngroup, common::Sched::Dyn(1), [&](size_t i) {
+        std::vector<Entry> &buf = merge_buf_[i];
+        std::vector<size_t> &runs = merge_runs_[i];
+        runs.push_back(buf.size());
+        // merge neighbouring pieces until one is left
+        while (runs.size() > 2) {
+          size_t n = 0;
+          for (size_t r = 0; r + 2 < runs.size(); r += 2) {
+            std::inplace_merge(buf.begin() + runs[r], buf.begin() + runs[r + 1],
+                               buf.begin() + runs[r + 2], Entry::CmpValue);
+            runs[n++] = runs[r];
+          }
+          if (runs.size() % 2 == 0) runs[n++] = runs[runs.size() - 2];
+          runs[n++] = runs.back();
+          runs.resize(n);
+        }
+        std::copy(buf.begin(), buf.end(),
+                  merged_page_.data.begin() + offset[group[i]]);
+      });
+    }
     // reset position of each data points after split is created in the tree
     inline void ResetPosition(const std::vector<int> &qexpand,
                               DMatrix* p_fmat,
@@ -943,8 +2211,7 @@ class RobustColMaker: public TreeUpdater {
       // so that they are ignored in future statistics collection
       const auto ndata = static_cast<bst_omp_uint>(rowset.Size());
 
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < ndata; ++i) {
+      common::ParallelFor(ndata, [&](size_t i) {
         const bst_uint ridx = rowset[i];
         CHECK_LT(ridx, position_.size())
             << "ridx exceed bound " << "ridx="<<  ridx << " pos=" << position_.size();
@@ -962,7 +2229,7 @@ class RobustColMaker: public TreeUpdater {
             this->SetEncodePosition(ridx, tree[nid].RightChild());
           }
         }
-      }
+      });
     }
     // customization part
     // synchronize the best solution of each node
@@ -986,14 +2253,11 @@ class RobustColMaker: public TreeUpdater {
       }
       std::sort(fsplits.begin(), fsplits.end());
       fsplits.resize(std::unique(fsplits.begin(), fsplits.end()) - fsplits.begin());
-      auto iter = p_fmat->ColIterator();
-      while (iter->Next()) {
-        auto batch = iter->Value();
+      auto classify = [&](const SparsePage &batch) {
         for (auto fid : fsplits) {
           auto col = batch[fid];
           const auto ndata = static_cast<bst_omp_uint>(col.length);
-          #pragma omp parallel for schedule(static)
-          for (bst_omp_uint j = 0; j < ndata; ++j) {
+          common::ParallelFor(ndata, [&](size_t j) {
             const bst_uint ridx = col[j].index;
             const int nid = this->DecodePosition(ridx);
             const bst_float fvalue = col[j].fvalue;
@@ -1005,7 +2269,16 @@ class RobustColMaker: public TreeUpdater {
                 this->SetEncodePosition(ridx, tree[nid].RightChild());
               }
             }
-          }
+          });
+        }
+      };
+      // the rows of the split nodes are active, the compacted columns hold them
+      if (compact_columns_) {
+        classify(compact_page_);
+      } else {
+        auto iter = p_fmat->ColIteratorFor(fsplits);
+        while (iter->Next()) {
+          classify(iter->Value());
         }
       }
     }
@@ -1030,16 +2303,95 @@ class RobustColMaker: public TreeUpdater {
     // Per feature: shuffle index of each feature index
     std::vector<bst_uint> feat_index_;
     // Instance Data: current node position in the tree of each instance
-    std::vector<int> position_;
+    std::vector<int, common::FirstTouchAllocator<int> > position_;
+    // number of rows that are deleted or not sampled in the current tree
+    size_t num_inactive_{0};
+    // the last grown tree and its data, used by UpdatePredictionCache
+    const RegTree *p_last_tree_{nullptr};
+    const DMatrix *p_last_fmat_{nullptr};
     // PerThread x PerTreeNode: statistics for per thread construction
-    std::vector< std::vector<ThreadEntry> > stemp_;
+    std::vector<common::NodeArena<ThreadEntry> > stemp_;
     /*! \brief TreeNode Data: statistics for each constructed node */
-    std::vector<NodeEntry> snode_;
+    common::NodeArena<NodeEntry> snode_;
     /*! \brief queue of nodes to be expanded */
     std::vector<int> qexpand_;
+    /*! \brief row sets of the leaves, not used when the tree has several roots */
+    common::RowSetCollection row_set_collection_;
+    /*! \brief PerThread: temp space to split a row set */
+    std::vector<common::RowSetCollection::Split> row_split_tloc_;
+    /*! \brief PerChunk x PerTreeNode: statistics used by ParallelEnumerateSplit */
+    std::vector< std::vector<ChunkStat> > chunk_stats_;
+    /*! \brief the sorted columns of the active rows, see CompactColumns */
+    SparsePage compact_page_;
+    SparsePage compact_temp_;
+    /*! \brief whether compact_page_ is scanned instead of the columns of the data */
+    bool compact_columns_{false};
+    /*! \brief number of active rows when the columns scanned were built */
+    size_t compact_rows_{0};
+    /*! \brief PerFeature: whether the full column is an indicator, see IsIndicator */
+    std::vector<uint8_t> compact_indicator_;
+    /*! \brief the merged columns of a group of features, see UpdateSolutionPages */
+    SparsePage merged_page_;
+    /*! \brief whether merged_page_ is being scanned */
+    bool merged_columns_{false};
+    /*! \brief PerFeature in group: gathered entries and the start of each page's piece */
+    std::vector<std::vector<Entry> > merge_buf_;
+    std::vector<std::vector<size_t> > merge_runs_;
+    /*! \brief maximum number of entries merged at once, 256MB */
+    static const size_t kMergeEntries = static_cast<size_t>(1) << 25;
+    /*! \brief columns of few distinct values as value runs, see robust_value_runs */
+    common::RunColumnMatrix run_columns_;
+    /*! \brief data set and its number of nonzeros that run_columns_ was built from */
+    const DMatrix *run_columns_fmat_{nullptr};
+    uint64_t run_columns_nnz_{0};
+    /*! \brief eps window boundaries of the columns, see robust_eps_windows */
+    common::EpsWindowMatrix eps_windows_;
+    /*! \brief data set and its number of nonzeros that eps_windows_ was built from */
+    const DMatrix *eps_windows_fmat_{nullptr};
+    uint64_t eps_windows_nnz_{0};
+    /*! \brief sorted features exhausted at each node, see CheckExhausted */
+    std::vector<std::vector<bst_uint> > exhausted_;
+    /*! \brief PerThread: (node, feature) exhausted found in the current UpdateSolution */
+    std::vector<std::vector<std::pair<int, bst_uint> > > exhausted_found_;
+    /*!
+     * \brief the features exhausted at some node of qexpand_, sorted, and the
+     *  nodes of skip_fids_[k] in skip_nodes_[skip_ptr_[k], skip_ptr_[k + 1])
+     */
+    std::vector<bst_uint> skip_fids_;
+    std::vector<size_t> skip_ptr_;
+    std::vector<int> skip_nodes_;
+    /*! \brief PerThread: nodes with data in the current run of EnumerateRuns */
+    std::vector<std::vector<int> > run_nodes_;
+    /*! \brief bytes of the buffers counted by TrackWorkspace */
+    common::TrackedBytes workspace_bytes_{common::kMemWorkspace};
     // Evaluates splits and computes optimal weights for a given split
     std::unique_ptr<SplitEvaluator> spliteval_;
+    // whether spliteval_ is a plain elastic net, its score is then inlined
+    bool elastic_net_;
+    ElasticNetSplitScore elastic_net_score_;
+    // receiver of the enumeration trace, nullptr when tracing is off
+    std::unique_ptr<RobustTraceSink> trace_sink_;
+    // phase timers, printed over the lifetime of the builder with debug_verbose
+    common::Monitor monitor_;
+    /*! \brief PerThread: event counts and time spent in EnumerateFeature, for debug_verbose */
+    std::vector<CountingRobustTraceSink> count_sinks_;
+    std::vector<common::Timer> busy_timers_;
+    /*! \brief phase times when the current tree was started */
+    std::map<std::string, double> tree_begin_;
+    /*! \brief number of trees built */
+    int num_tree_{0};
+    /*! \brief schedule of the features of UpdateSolution */
+    common::FeatureScheduler scheduler_;
+    /*! \brief strategy of each level and number of nodes, see TunedUpdateSolution */
+    common::StrategyTuner tuner_;
+    /*! \brief depth of the nodes being evaluated */
+    int level_{0};
+    /*! \brief PerThread: NUMA node of the thread with numa_mode, empty otherwise */
+    std::vector<int> thread_node_;
+    int num_numa_node_{1};
   };
+  // persistent builder, reused for every tree
+  std::unique_ptr<Builder> builder_;
 };
 
 // distributed column maker
@@ -1057,6 +2409,8 @@ class RobustDistColMaker : public RobustColMaker {
               const std::vector<RegTree*> &trees) override {
     GradStats::CheckInfo(dmat->Info());
     CHECK_EQ(trees.size(), 1U) << "RobustDistColMaker: only support one tree at a time";
+    CHECK(!dmat->WideRowIds())
+        << "RobustDistColMaker: 2^32 rows or more need the exact or hist tree method";
     Builder builder(
       param_,
       std::unique_ptr<SplitEvaluator>(spliteval_->GetHostClone()));
@@ -1077,8 +2431,7 @@ class RobustDistColMaker : public RobustColMaker {
     inline void UpdatePosition(DMatrix* p_fmat, const RegTree &tree) {
       const RowSet &rowset = p_fmat->BufferedRowset();
       const auto ndata = static_cast<bst_omp_uint>(rowset.Size());
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < ndata; ++i) {
+      common::ParallelFor(ndata, [&](size_t i) {
         const bst_uint ridx = rowset[i];
         int nid = this->DecodePosition(ridx);
         while (tree[nid].IsDeleted()) {
@@ -1086,10 +2439,10 @@ class RobustDistColMaker : public RobustColMaker {
           CHECK_GE(nid, 0);
         }
         this->position_[ridx] = nid;
-      }
+      });
     }
     inline const int* GetLeafPosition() const {
-      return dmlc::BeginPtr(this->position_);
+      return this->position_.data();
     }
 
    protected:
@@ -1112,19 +2465,17 @@ class RobustDistColMaker : public RobustColMaker {
       {
         auto ndata = static_cast<bst_omp_uint>(this->position_.size());
         boolmap_.resize(ndata);
-        #pragma omp parallel for schedule(static)
-        for (bst_omp_uint j = 0; j < ndata; ++j) {
+        common::ParallelFor(ndata, [&](size_t j) {
             boolmap_[j] = 0;
-        }
+        });
       }
-      auto iter = p_fmat->ColIterator();
+      auto iter = p_fmat->ColIteratorFor(fsplits);
       while (iter->Next()) {
         auto batch = iter->Value();
         for (auto fid : fsplits) {
           auto col = batch[fid];
           const auto ndata = static_cast<bst_omp_uint>(col.length);
-          #pragma omp parallel for schedule(static)
-          for (bst_omp_uint j = 0; j < ndata; ++j) {
+          common::ParallelFor(ndata, [&](size_t j) {
             const bst_uint ridx = col[j].index;
             const bst_float fvalue = col[j].fvalue;
             const int nid = this->DecodePosition(ridx);
@@ -1135,21 +2486,19 @@ class RobustDistColMaker : public RobustColMaker {
                 if (tree[nid].DefaultLeft()) boolmap_[ridx] = 1;
               }
             }
-          }
+          });
         }
       }
 
-      bitmap_.InitFromBool(boolmap_);
-      // communicate bitmap
-      rabit::Allreduce<rabit::op::BitOR>(dmlc::BeginPtr(bitmap_.data), bitmap_.data.size());
+      const double tstart = dmlc::GetTime();
+      const size_t nbytes = this->SyncChangedRows();
       const RowSet &rowset = p_fmat->BufferedRowset();
       // get the new position
       const auto ndata = static_cast<bst_omp_uint>(rowset.Size());
-      #pragma omp parallel for schedule(static)
-      for (bst_omp_uint i = 0; i < ndata; ++i) {
+      common::ParallelFor(ndata, [&](size_t i) {
         const bst_uint ridx = rowset[i];
         const int nid = this->DecodePosition(ridx);
-        if (bitmap_.Get(ridx)) {
+        if (boolmap_[ridx]) {
           CHECK(!tree[nid].IsLeaf()) << "inconsistent reduce information";
           if (tree[nid].DefaultLeft()) {
             this->SetEncodePosition(ridx, tree[nid].RightChild());
@@ -1157,6 +2506,96 @@ class RobustDistColMaker : public RobustColMaker {
             this->SetEncodePosition(ridx, tree[nid].LeftChild());
           }
         }
+      });
+      if (this->param_.robust_training_verbose && rabit::GetRank() == 0) {
+        LOG(CONSOLE) << "robust_distcol position sync: " << nbytes << " bytes, "
+                     << (dmlc::GetTime() - tstart) * 1000.0 << " ms";
+      }
+    }
+    /*!
+     * \brief OR the rows marked in boolmap_ over all workers.
+     *
+     *  Only a few rows usually leave the default direction, so each worker
+     *  sends its marked rows as (gap, run length) varint pairs instead of a
+     *  bitmap of all rows. The encoded sizes are reduced first, and the
+     *  bitmap allreduce is kept when the runs would be larger.
+     * \return number of payload bytes communicated
+     */
+    inline size_t SyncChangedRows() {
+      const int world = rabit::GetWorldSize();
+      if (world == 1) return 0;
+      const int rank = rabit::GetRank();
+      std::string runs;
+      EncodeRuns(boolmap_, &runs);
+      std::vector<uint64_t> sizes(world, 0);
+      sizes[rank] = runs.size();
+      rabit::Allreduce<rabit::op::Sum>(dmlc::BeginPtr(sizes), sizes.size());
+      uint64_t total = 0;
+      for (uint64_t n : sizes) total += n;
+      const size_t bitmap_bytes = (boolmap_.size() + 31) / 32 * sizeof(uint32_t);
+      if (total >= bitmap_bytes) {
+        bitmap_.InitFromBool(boolmap_);
+        // communicate bitmap
+        rabit::Allreduce<rabit::op::BitOR>(dmlc::BeginPtr(bitmap_.data), bitmap_.data.size());
+        const auto ndata = static_cast<bst_omp_uint>(boolmap_.size());
+        common::ParallelFor(ndata, [&](size_t j) {
+          boolmap_[j] = bitmap_.Get(j) ? 1 : 0;
+        });
+        return bitmap_bytes;
+      }
+      std::string recv;
+      for (int r = 0; r < world; ++r) {
+        if (sizes[r] == 0) continue;
+        if (r == rank) {
+          rabit::Broadcast(&runs, r);
+        } else {
+          rabit::Broadcast(&recv, r);
+          DecodeRuns(recv, &boolmap_);
+        }
+      }
+      return static_cast<size_t>(total);
+    }
+    // append a little endian base 128 varint
+    inline static void PutVarint(uint64_t v, std::string *out) {
+      while (v >= 0x80) {
+        out->push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+      }
+      out->push_back(static_cast<char>(v));
+    }
+    inline static uint64_t GetVarint(const std::string &in, size_t *pos) {
+      uint64_t v = 0;
+      for (int shift = 0;; shift += 7) {
+        const auto b = static_cast<uint8_t>(in[(*pos)++]);
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) return v;
+      }
+    }
+    // encode the marked rows as runs, each run is the gap since the end of
+    // the previous run and its length
+    inline static void EncodeRuns(const std::vector<int> &boolmap, std::string *out) {
+      out->clear();
+      size_t last = 0;
+      for (size_t i = 0; i < boolmap.size();) {
+        if (!boolmap[i]) {
+          ++i;
+          continue;
+        }
+        size_t end = i;
+        while (end < boolmap.size() && boolmap[end]) ++end;
+        PutVarint(i - last, out);
+        PutVarint(end - i, out);
+        last = i = end;
+      }
+    }
+    // mark the rows of encoded runs
+    inline static void DecodeRuns(const std::string &in, std::vector<int> *boolmap) {
+      size_t pos = 0, row = 0;
+      while (pos < in.size()) {
+        row += GetVarint(in, &pos);
+        const size_t end = row + GetVarint(in, &pos);
+        CHECK_LE(end, boolmap->size()) << "inconsistent reduce information";
+        for (; row < end; ++row) (*boolmap)[row] = 1;
       }
     }
     // synchronize the best solution of each node
@@ -1169,8 +2608,13 @@ class RobustDistColMaker : public RobustColMaker {
         vec.push_back(this->snode_[nid].best);
       }
       // TODO(tqchen) lazy version
-      // communicate best solution
+      // communicate the best solutions of the whole level in one reduce
+      const double tstart = dmlc::GetTime();
       reducer_.Allreduce(dmlc::BeginPtr(vec), vec.size());
+      if (this->param_.robust_training_verbose && rabit::GetRank() == 0) {
+        LOG(CONSOLE) << "robust_distcol split sync: " << vec.size() * sizeof(SplitEntry)
+                     << " bytes, " << (dmlc::GetTime() - tstart) * 1000.0 << " ms";
+      }
       // assign solution back
       for (size_t i = 0; i < qexpand.size(); ++i) {
         const int nid = qexpand[i];
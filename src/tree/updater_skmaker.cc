@@ -11,6 +11,7 @@
 #include <vector>
 #include <algorithm>
 #include "../common/sync.h"
+#include "../common/threading.h"
 #include "../common/quantile.h"
 #include "../common/group_data.h"
 #include "./updater_basemaker-inl.h"
@@ -25,6 +26,8 @@ class SketchMaker: public BaseMaker {
   void Update(HostDeviceVector<GradientPair> *gpair,
               DMatrix *p_fmat,
               const std::vector<RegTree*> &trees) override {
+    CHECK(!p_fmat->WideRowIds())
+        << "SketchMaker: 2^32 rows or more need the exact or hist tree method";
     // rescale learning rate according to size of trees
     float lr = param_.learning_rate;
     param_.learning_rate = lr / trees.size();
@@ -174,14 +177,13 @@ class SketchMaker: public BaseMaker {
       auto batch = iter->Value();
       // start enumeration
       const auto nsize = static_cast<bst_omp_uint>(batch.Size());
-      #pragma omp parallel for schedule(dynamic, 1)
-      for (bst_omp_uint fidx = 0; fidx < nsize; ++fidx) {
+      common::ParallelFor(nsize, common::Sched::Dyn(1), [&](size_t fidx) {
         this->UpdateSketchCol(gpair, batch[fidx], tree,
                               node_stats_,
                               fidx,
                               batch[fidx].length == nrows,
-                              &thread_sketch_[omp_get_thread_num()]);
-      }
+                              &thread_sketch_[common::ThreadId()]);
+      });
     }
     // setup maximum size
     unsigned max_size = param_.MaxSketchSize();
@@ -293,8 +295,7 @@ class SketchMaker: public BaseMaker {
     // get the best split condition for each node
     std::vector<SplitEntry> sol(qexpand_.size());
     auto nexpand = static_cast<bst_omp_uint>(qexpand_.size());
-    #pragma omp parallel for schedule(dynamic, 1)
-    for (bst_omp_uint wid = 0; wid < nexpand; ++wid) {
+    common::ParallelFor(nexpand, common::Sched::Dyn(1), [&](size_t wid) {
       const int nid = qexpand_[wid];
       CHECK_EQ(node2workindex_[nid], static_cast<int>(wid));
       SplitEntry &best = sol[wid];
@@ -305,7 +306,7 @@ class SketchMaker: public BaseMaker {
                        summary_array_[base + 2],
                        node_stats_[nid], fid, &best);
       }
-    }
+    });
     // get the best result, we can synchronize the solution
     for (bst_omp_uint wid = 0; wid < nexpand; ++wid) {
       const int nid = qexpand_[wid];
@@ -0,0 +1,503 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file updater_vector_colmaker.cc
+ * \brief grow one tree of vector leaves for all the output groups.
+ *
+ *  The gradient of a row holds one pair per output group, as the objectives
+ *  of several groups produce them. A leaf keeps a weight per group in its
+ *  leaf vector, and a split is scored by the sum over the groups of their
+ *  gains, so a round scans each column once instead of once per group. The
+ *  robust variant scores a split by the worst of that sum over the
+ *  assignments of the rows within robust_eps of the threshold: the natural
+ *  one, all of them left, all of them right and the two halves swapped.
+ */
+#include <xgboost/tree_updater.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "./param.h"
+#include "../common/random.h"
+#include "../common/threading.h"
+
+namespace xgboost {
+namespace tree {
+
+DMLC_REGISTRY_FILE_TAG(updater_vector_colmaker);
+
+/*! \brief column-wise update to construct a tree of vector leaves */
+class VectorColMaker: public TreeUpdater {
+ public:
+  explicit VectorColMaker(bool robust) : robust_(robust) {}
+  void Init(const std::vector<std::pair<std::string, std::string> >& args) override {
+    param_.InitAllowUnknown(args);
+    builder_.reset();
+  }
+
+  void Update(HostDeviceVector<GradientPair> *gpair,
+              DMatrix* dmat,
+              const std::vector<RegTree*> &trees) override {
+    CHECK(!dmat->WideRowIds())
+        << "VectorColMaker: 2^32 rows or more need the exact or hist tree method";
+    // rescale learning rate according to size of trees
+    float lr = param_.learning_rate;
+    param_.learning_rate = lr / trees.size();
+    // the builder buffers are per thread, rebuild when the thread count changed
+    if (!builder_ || builder_->NumThreads() != omp_get_max_threads()) {
+      builder_.reset(new Builder(param_, robust_));
+    }
+    for (auto tree : trees) {
+      builder_->Update(gpair->HostVector(), dmat, tree);
+    }
+    param_.learning_rate = lr;
+  }
+
+  bool UpdatePredictionCache(const DMatrix* data,
+                             HostDeviceVector<bst_float>* out_preds) override {
+    return builder_ && builder_->UpdatePredictionCache(data, out_preds);
+  }
+
+  // the positions of the rows in deleted nodes are walked up to their leaf
+  bool CacheFollowsDeletedNodes() const override {
+    return true;
+  }
+
+ protected:
+  class Builder {
+   public:
+    Builder(const TrainParam& param, bool robust)
+        : param_(param), group_param_(param), nthread_(omp_get_max_threads()),
+          robust_(robust && param.robust_eps > 0.0f) {
+      // the groups of a child are scored whatever their own hessians, the
+      // summed hessians of the child are bound by min_child_weight
+      group_param_.min_child_weight = 0.0f;
+    }
+    // number of threads the per-thread buffers are sized for
+    inline int NumThreads() const {
+      return nthread_;
+    }
+    // update one tree, growing
+    inline void Update(const std::vector<GradientPair>& gpair,
+                       DMatrix* p_fmat, RegTree* p_tree) {
+      num_group_ = p_tree->param.size_leaf_vector;
+      CHECK_GT(num_group_, 0) << "vector colmaker only grows trees of vector leaves";
+      CHECK_EQ(gpair.size(), p_fmat->Info().num_row_ * num_group_)
+          << "must have exactly ngroup*nrow gpairs";
+      CHECK(p_fmat->SingleColBlock())
+          << "vector colmaker only supports the columns of in-memory data";
+      p_last_fmat_ = nullptr;
+      std::vector<int> newnodes;
+      this->InitData(gpair, *p_fmat, *p_tree);
+      this->InitNewNode(qexpand_, gpair, *p_fmat, *p_tree);
+      for (int depth = 0; depth < param_.max_depth; ++depth) {
+        this->FindSplit(qexpand_, gpair, p_fmat, p_tree);
+        this->ResetPosition(qexpand_, p_fmat, *p_tree);
+        newnodes.clear();
+        for (int nid : qexpand_) {
+          if (!(*p_tree)[nid].IsLeaf()) {
+            newnodes.push_back((*p_tree)[nid].LeftChild());
+            newnodes.push_back((*p_tree)[nid].RightChild());
+          }
+        }
+        this->InitNewNode(newnodes, gpair, *p_fmat, *p_tree);
+        qexpand_ = newnodes;
+        if (qexpand_.size() == 0) break;
+      }
+      for (int nid : qexpand_) {
+        (*p_tree)[nid].SetLeaf(0.0f);
+      }
+      // every node keeps its weights, so a pruned node is a valid leaf
+      for (int nid = 0; nid < p_tree->param.num_nodes; ++nid) {
+        p_tree->Stat(nid).loss_chg = best_[nid].loss_chg;
+        p_tree->Stat(nid).base_weight = 0.0f;
+        p_tree->Stat(nid).sum_hess = static_cast<bst_float>(node_hess_[nid]);
+        bst_float* leaf = p_tree->Leafvec(nid);
+        for (int k = 0; k < num_group_; ++k) {
+          leaf[k] = weight_[nid * num_group_ + k] * param_.learning_rate;
+        }
+      }
+      p_last_fmat_ = p_fmat;
+      p_last_tree_ = p_tree;
+    }
+    // add the leaf vectors of the rows of the last tree to their margins
+    inline bool UpdatePredictionCache(const DMatrix* data,
+                                      HostDeviceVector<bst_float>* p_out_preds) {
+      if (p_last_fmat_ == nullptr || data != p_last_fmat_) return false;
+      std::vector<bst_float>& out_preds = p_out_preds->HostVector();
+      const RegTree& tree = *p_last_tree_;
+      CHECK_EQ(out_preds.size(), position_.size() * num_group_);
+      const auto ndata = static_cast<bst_omp_uint>(position_.size());
+      common::ParallelFor(ndata, [&](size_t ridx) {
+        // the rows left out of the tree follow its splits all the same
+        int nid = this->DecodePosition(ridx);
+        while (tree[nid].IsDeleted()) nid = tree[nid].Parent();
+        const bst_float* leaf = tree.Leafvec(nid);
+        for (int k = 0; k < num_group_; ++k) {
+          out_preds[ridx * num_group_ + k] += leaf[k];
+        }
+      });
+      return true;
+    }
+
+   protected:
+    // workspace of a thread scanning the columns
+    struct ThreadEntry {
+      // the scanned entries of each expanded node, in ascending order
+      std::vector<std::vector<const Entry*> > node_entries;
+      // best split of each expanded node
+      std::vector<SplitEntry> best;
+      // sums of the groups: present rows, rows left of the candidate, rows
+      // certainly left, rows left or uncertain, and a candidate assignment
+      std::vector<GradStats> present, left, cleft, uleft, assign, missing;
+    };
+    inline void InitData(const std::vector<GradientPair>& gpair,
+                         const DMatrix& fmat, const RegTree& tree) {
+      CHECK_EQ(tree.param.num_nodes, tree.param.num_roots)
+          << "VectorColMaker: can only grow new tree";
+      const std::vector<unsigned>& root_index = fmat.Info().root_index_;
+      const RowSet& rowset = fmat.BufferedRowset();
+      position_.resize(fmat.Info().num_row_);
+      for (size_t i = 0; i < rowset.Size(); ++i) {
+        const bst_uint ridx = rowset[i];
+        position_[ridx] = root_index.size() == 0 ? 0 : static_cast<int>(root_index[ridx]);
+        // the rows of a negative hessian in the first group are deleted
+        if (gpair[ridx * num_group_].GetHess() < 0.0f) position_[ridx] = ~position_[ridx];
+      }
+      if (param_.subsample < 1.0f) {
+        std::bernoulli_distribution coin_flip(param_.subsample);
+        auto& rnd = common::GlobalRandom();
+        for (size_t i = 0; i < rowset.Size(); ++i) {
+          const bst_uint ridx = rowset[i];
+          if (position_[ridx] < 0) continue;
+          if (!coin_flip(rnd)) position_[ridx] = ~position_[ridx];
+        }
+      }
+      feat_index_.clear();
+      const auto ncol = static_cast<unsigned>(fmat.Info().num_col_);
+      for (unsigned i = 0; i < ncol; ++i) {
+        if (fmat.GetColSize(i) != 0 && fmat.Info().IsSplitFeature(i)) {
+          feat_index_.push_back(i);
+        }
+      }
+      CHECK_GT(param_.colsample_bytree, 0U) << "colsample_bytree cannot be zero.";
+      const unsigned n = std::max(static_cast<unsigned>(1),
+          static_cast<unsigned>(param_.colsample_bytree * feat_index_.size()));
+      std::shuffle(feat_index_.begin(), feat_index_.end(), common::GlobalRandom());
+      feat_index_.resize(std::min(n, static_cast<unsigned>(feat_index_.size())));
+      std::sort(feat_index_.begin(), feat_index_.end());
+      stemp_.resize(nthread_);
+      for (ThreadEntry& e : stemp_) {
+        e.present.resize(num_group_, GradStats(param_));
+        e.left.resize(num_group_, GradStats(param_));
+        e.cleft.resize(num_group_, GradStats(param_));
+        e.uleft.resize(num_group_, GradStats(param_));
+        e.assign.resize(num_group_, GradStats(param_));
+        e.missing.resize(num_group_, GradStats(param_));
+      }
+      qexpand_.clear();
+      for (int i = 0; i < tree.param.num_roots; ++i) qexpand_.push_back(i);
+    }
+    // sum the gradients of the new nodes and compute their weights and gains
+    inline void InitNewNode(const std::vector<int>& qexpand,
+                            const std::vector<GradientPair>& gpair,
+                            const DMatrix& fmat, const RegTree& tree) {
+      const size_t nnode = tree.param.num_nodes;
+      node_sum_.resize(nnode * num_group_, GradStats(param_));
+      node_hess_.resize(nnode);
+      node_gain_.resize(nnode);
+      weight_.resize(nnode * num_group_);
+      best_.resize(nnode);
+      slot_.assign(nnode, -1);
+      for (size_t j = 0; j < qexpand.size(); ++j) slot_[qexpand[j]] = static_cast<int>(j);
+      const size_t width = qexpand.size() * num_group_;
+      thread_sum_.resize(nthread_);
+      for (auto& sum : thread_sum_) sum.assign(width, GradStats(param_));
+      const RowSet& rowset = fmat.BufferedRowset();
+      const auto ndata = static_cast<bst_omp_uint>(rowset.Size());
+      #pragma omp parallel for schedule(static) num_threads(nthread_)
+      for (bst_omp_uint i = 0; i < ndata; ++i) {
+        const bst_uint ridx = rowset[i];
+        if (position_[ridx] < 0) continue;
+        const int j = slot_[position_[ridx]];
+        if (j < 0) continue;
+        GradStats* sum = &thread_sum_[omp_get_thread_num()][j * num_group_];
+        const GradientPair* g = &gpair[ridx * num_group_];
+        for (int k = 0; k < num_group_; ++k) sum[k].Add(g[k]);
+      }
+      for (size_t j = 0; j < qexpand.size(); ++j) {
+        const int nid = qexpand[j];
+        GradStats* total = &node_sum_[nid * num_group_];
+        double gain = 0.0, hess = 0.0;
+        for (int k = 0; k < num_group_; ++k) {
+          total[k].Clear();
+          for (const auto& sum : thread_sum_) total[k].Add(sum[j * num_group_ + k]);
+          weight_[nid * num_group_ + k] =
+              static_cast<bst_float>(this->GroupWeight(total[k]));
+          gain += this->GroupGain(total[k]);
+          hess += total[k].sum_hess;
+        }
+        node_gain_[nid] = gain;
+        node_hess_[nid] = hess;
+        best_[nid] = SplitEntry();
+      }
+    }
+    // gain and weight of a group, an empty group without reg_lambda has none
+    inline double GroupGain(const GradStats& stats) const {
+      if (stats.sum_hess + param_.reg_lambda <= 0.0) return 0.0;
+      return stats.CalcGain(group_param_);
+    }
+    inline double GroupWeight(const GradStats& stats) const {
+      if (stats.sum_hess + param_.reg_lambda <= 0.0) return 0.0;
+      return stats.CalcWeight(group_param_);
+    }
+    // loss change of sending left of node nid left and the rest right
+    inline double LossChange(int nid, const GradStats* left) const {
+      const GradStats* total = &node_sum_[nid * num_group_];
+      GradStats right(param_);
+      double gain = 0.0;
+      for (int k = 0; k < num_group_; ++k) {
+        right.SetSubstract(total[k], left[k]);
+        gain += this->GroupGain(left[k]) + this->GroupGain(right);
+      }
+      return gain - node_gain_[nid];
+    }
+    // evaluate the split of node nid at threshold whose present rows left
+    // are e.left, with the missing rows sent to either side
+    inline void EvaluateSplit(int nid, bst_uint fid, bst_float threshold, bool uncertain,
+                              ThreadEntry* p_e, SplitEntry* best) const {
+      ThreadEntry& e = *p_e;
+      GradStats* assign = dmlc::BeginPtr(e.assign);
+      const GradStats* missing = dmlc::BeginPtr(e.missing);
+      for (int default_left = 0; default_left < 2; ++default_left) {
+        double hess = 0.0;
+        for (int k = 0; k < num_group_; ++k) {
+          assign[k].SetCopy(e.left[k]);
+          if (default_left) assign[k].Add(missing[k]);
+          hess += assign[k].sum_hess;
+        }
+        if (hess < param_.min_child_weight ||
+            node_hess_[nid] - hess < param_.min_child_weight) {
+          continue;
+        }
+        double loss_chg = this->LossChange(nid, assign);
+        if (uncertain) {
+          // the uncertain rows all left, all right, and the two halves swapped
+          for (int k = 0; k < num_group_; ++k) {
+            assign[k].SetCopy(e.uleft[k]);
+            if (default_left) assign[k].Add(missing[k]);
+          }
+          loss_chg = std::min(loss_chg, this->LossChange(nid, assign));
+          for (int k = 0; k < num_group_; ++k) {
+            assign[k].SetCopy(e.cleft[k]);
+            if (default_left) assign[k].Add(missing[k]);
+          }
+          loss_chg = std::min(loss_chg, this->LossChange(nid, assign));
+          for (int k = 0; k < num_group_; ++k) {
+            assign[k].SetSubstract(e.uleft[k], e.left[k]);
+            assign[k].Add(e.cleft[k]);
+            if (default_left) assign[k].Add(missing[k]);
+          }
+          loss_chg = std::min(loss_chg, this->LossChange(nid, assign));
+        }
+        best->Update(static_cast<bst_float>(loss_chg), fid, threshold, default_left != 0);
+      }
+    }
+    // enumerate the thresholds of feature fid over the ascending entries of node nid
+    inline void EnumerateSplit(const std::vector<const Entry*>& entries, int nid,
+                               bst_uint fid, const std::vector<GradientPair>& gpair,
+                               ThreadEntry* p_e, SplitEntry* best) const {
+      ThreadEntry& e = *p_e;
+      const size_t n = entries.size();
+      const bst_float eps = robust_ ? static_cast<bst_float>(param_.robust_eps) : 0.0f;
+      for (int k = 0; k < num_group_; ++k) {
+        e.present[k].Clear();
+        e.left[k].Clear();
+        e.cleft[k].Clear();
+        e.uleft[k].Clear();
+      }
+      for (const Entry* it : entries) {
+        const GradientPair* g = &gpair[it->index * num_group_];
+        for (int k = 0; k < num_group_; ++k) e.present[k].Add(g[k]);
+      }
+      const GradStats* total = &node_sum_[nid * num_group_];
+      for (int k = 0; k < num_group_; ++k) e.missing[k].SetSubstract(total[k], e.present[k]);
+      // rows [0, a) are certainly left, [a, b) within eps of the threshold
+      size_t a = 0, b = 0;
+      const auto add = [&](size_t i, std::vector<GradStats>* sum) {
+        const GradientPair* g = &gpair[entries[i]->index * num_group_];
+        for (int k = 0; k < num_group_; ++k) (*sum)[k].Add(g[k]);
+      };
+      for (size_t i = 0; i <= n; ++i) {
+        if (i == 0 || i == n || entries[i - 1]->fvalue < entries[i]->fvalue) {
+          bst_float threshold;
+          if (i == 0) {
+            threshold = entries[0]->fvalue - (std::abs(entries[0]->fvalue) + kRtEps);
+          } else if (i == n) {
+            threshold = entries[n - 1]->fvalue + (std::abs(entries[n - 1]->fvalue) + kRtEps);
+          } else {
+            threshold = (entries[i - 1]->fvalue + entries[i]->fvalue) * 0.5f;
+          }
+          if (robust_) {
+            while (a < n && entries[a]->fvalue < threshold - eps) add(a++, &e.cleft);
+            while (b < n && entries[b]->fvalue <= threshold + eps) add(b++, &e.uleft);
+          }
+          this->EvaluateSplit(nid, fid, threshold, robust_ && a < b, &e, best);
+        }
+        if (i < n) add(i, &e.left);
+      }
+    }
+    inline void FindSplit(const std::vector<int>& qexpand,
+                          const std::vector<GradientPair>& gpair,
+                          DMatrix* p_fmat, RegTree* p_tree) {
+      std::vector<bst_uint> feat_set = feat_index_;
+      if (param_.colsample_bylevel != 1.0f) {
+        CHECK_GT(param_.colsample_bylevel, 0U) << "colsample_bylevel cannot be zero.";
+        std::shuffle(feat_set.begin(), feat_set.end(), common::GlobalRandom());
+        const unsigned n = std::max(static_cast<unsigned>(1),
+            static_cast<unsigned>(param_.colsample_bylevel * feat_index_.size()));
+        feat_set.resize(std::min(n, static_cast<unsigned>(feat_set.size())));
+      }
+      const size_t nexpand = qexpand.size();
+      for (ThreadEntry& e : stemp_) {
+        e.node_entries.resize(nexpand);
+        e.best.assign(nexpand, SplitEntry());
+      }
+      auto iter = p_fmat->ColIteratorFor(feat_index_);
+      iter->BeforeFirst();
+      CHECK(iter->Next());
+      const SparsePage& batch = iter->Value();
+      const auto nfeature = static_cast<bst_omp_uint>(feat_set.size());
+      #pragma omp parallel for schedule(dynamic, 1) num_threads(nthread_)
+      for (bst_omp_uint i = 0; i < nfeature; ++i) {
+        ThreadEntry& e = stemp_[omp_get_thread_num()];
+        const bst_uint fid = feat_set[i];
+        const SparsePage::Inst col = batch[fid];
+        for (auto& entries : e.node_entries) entries.clear();
+        for (bst_uint j = 0; j < col.length; ++j) {
+          const int nid = position_[col[j].index];
+          if (nid < 0 || slot_[nid] < 0) continue;
+          e.node_entries[slot_[nid]].push_back(&col[j]);
+        }
+        for (size_t j = 0; j < nexpand; ++j) {
+          if (e.node_entries[j].empty()) continue;
+          this->EnumerateSplit(e.node_entries[j], qexpand[j], fid, gpair,
+                               &e, &e.best[j]);
+        }
+      }
+      for (size_t j = 0; j < nexpand; ++j) {
+        const int nid = qexpand[j];
+        for (const ThreadEntry& e : stemp_) best_[nid].Update(e.best[j]);
+        const SplitEntry& best = best_[nid];
+        if (best.loss_chg > kRtEps) {
+          p_tree->AddChilds(nid);
+          (*p_tree)[nid].SetSplit(best.SplitIndex(), best.split_value, best.DefaultLeft());
+          // mark right child as 0, to indicate fresh leaf
+          (*p_tree)[(*p_tree)[nid].LeftChild()].SetLeaf(0.0f, 0);
+          (*p_tree)[(*p_tree)[nid].RightChild()].SetLeaf(0.0f, 0);
+        } else {
+          (*p_tree)[nid].SetLeaf(0.0f);
+        }
+      }
+    }
+    // move the rows of the split nodes to their children, the rows left out
+    // of the tree included
+    inline void ResetPosition(const std::vector<int>& qexpand,
+                              DMatrix* p_fmat, const RegTree& tree) {
+      std::vector<unsigned> fsplits;
+      for (int nid : qexpand) {
+        if (!tree[nid].IsLeaf()) fsplits.push_back(tree[nid].SplitIndex());
+      }
+      std::sort(fsplits.begin(), fsplits.end());
+      fsplits.resize(std::unique(fsplits.begin(), fsplits.end()) - fsplits.begin());
+      const RowSet& rowset = p_fmat->BufferedRowset();
+      const auto ndata = static_cast<bst_omp_uint>(rowset.Size());
+      // the rows missing the feature of their split take the default branch
+      common::ParallelFor(ndata, [&](size_t i) {
+        const bst_uint ridx = rowset[i];
+        const int nid = this->DecodePosition(ridx);
+        if (tree[nid].IsLeaf()) {
+          // mark finish when it is not a fresh leaf
+          if (tree[nid].RightChild() == -1) position_[ridx] = ~nid;
+        } else {
+          this->SetEncodePosition(ridx, tree[nid].DefaultChild());
+        }
+      });
+      auto iter = p_fmat->ColIteratorFor(fsplits);
+      while (iter->Next()) {
+        const SparsePage& batch = iter->Value();
+        for (auto fid : fsplits) {
+          const SparsePage::Inst col = batch[fid];
+          const auto nentry = static_cast<bst_omp_uint>(col.length);
+          common::ParallelFor(nentry, [&](size_t j) {
+            const bst_uint ridx = col[j].index;
+            const int nid = this->DecodePosition(ridx);
+            if (tree[nid].IsRoot()) return;
+            const int pid = tree[nid].Parent();
+            const RegTree::Node& parent = tree[pid];
+            // only the rows that just took the default branch of fid move
+            if (slot_[pid] < 0 || parent.SplitIndex() != fid || nid != parent.DefaultChild()) {
+              return;
+            }
+            if (col[j].fvalue < parent.SplitCond()) {
+              this->SetEncodePosition(ridx, parent.LeftChild());
+            } else {
+              this->SetEncodePosition(ridx, parent.RightChild());
+            }
+          });
+        }
+      }
+    }
+    inline int DecodePosition(bst_uint ridx) const {
+      const int pid = position_[ridx];
+      return pid < 0 ? ~pid : pid;
+    }
+    inline void SetEncodePosition(bst_uint ridx, int nid) {
+      position_[ridx] = position_[ridx] < 0 ? ~nid : nid;
+    }
+
+    const TrainParam& param_;
+    // param_ without the min_child_weight bound of each group
+    TrainParam group_param_;
+    const int nthread_;
+    const bool robust_;
+    int num_group_{0};
+    // the features of the tree
+    std::vector<bst_uint> feat_index_;
+    // node of each row, ~nid for the rows left out or finished
+    std::vector<int> position_;
+    // index of each node in the expanded nodes, -1 for the others
+    std::vector<int> slot_;
+    // per node: sums of the groups, summed hessian, gain, weights of the
+    // groups and best split
+    std::vector<GradStats> node_sum_;
+    std::vector<double> node_hess_;
+    std::vector<double> node_gain_;
+    std::vector<bst_float> weight_;
+    std::vector<SplitEntry> best_;
+    // workspace of each thread
+    std::vector<ThreadEntry> stemp_;
+    std::vector<std::vector<GradStats> > thread_sum_;
+    std::vector<int> qexpand_;
+    // the matrix and tree of the last update, for the prediction cache
+    const DMatrix* p_last_fmat_{nullptr};
+    const RegTree* p_last_tree_{nullptr};
+  };
+
+  TrainParam param_;
+  const bool robust_;
+  std::unique_ptr<Builder> builder_;
+};
+
+XGBOOST_REGISTER_TREE_UPDATER(VectorColMaker, "grow_vector_colmaker")
+.describe("Grow one tree of vector leaves for all the output groups.")
+.set_body([]() {
+    return new VectorColMaker(false);
+  });
+
+XGBOOST_REGISTER_TREE_UPDATER(RobustVectorColMaker, "robust_grow_vector_colmaker")
+.describe("Grow one robust tree of vector leaves for all the output groups.")
+.set_body([]() {
+    return new VectorColMaker(true);
+  });
+}  // namespace tree
+}  // namespace xgboost
@@ -0,0 +1,135 @@
+# pylint: skip-file
+import sys, argparse
+import glob
+import json
+import os
+import platform
+import resource
+import subprocess
+import time
+import xgboost as xgb
+
+# keys of the CLI configs that are tasks, not training parameters
+TASK_KEYS = ['data', 'test:data', 'num_round', 'save_period', 'model_dir',
+             'model_out', 'model_in', 'task', 'name_pred']
+
+
+def parse_conf(fname):
+    conf = []
+    with open(fname) as fi:
+        for line in fi:
+            line = line.split('#', 1)[0].strip()
+            if '=' not in line:
+                continue
+            key, value = [s.strip() for s in line.split('=', 1)]
+            conf.append((key, value.strip('"')))
+    return conf
+
+
+def peak_rss_mb():
+    # ru_maxrss is in KB on Linux and in bytes on macOS
+    rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    return rss / (1024.0 * 1024.0) if sys.platform == 'darwin' else rss / 1024.0
+
+
+def run_conf(args):
+    conf = parse_conf(args.conf)
+    kv = dict(conf)
+    param = {k: v for k, v in conf if k not in TASK_KEYS and not k.startswith('eval[')}
+    param['seed'] = args.seed
+    param['silent'] = 1
+    if args.nthread > 0:
+        param['nthread'] = args.nthread
+    num_round = args.rounds if args.rounds > 0 else int(kv['num_round'])
+
+    tmp = time.time()
+    dtrain = xgb.DMatrix(os.path.join(args.root, kv['data']), silent=True)
+    evals = [(xgb.DMatrix(os.path.join(args.root, v), silent=True), k[len('eval['):-1])
+             for k, v in conf if k.startswith('eval[')]
+    load_time = time.time() - tmp
+
+    # the callback runs after the update and the evaluation of each round
+    round_end = []
+    result = []
+    def record(env):
+        round_end.append(time.time())
+        result[:] = env.evaluation_result_list
+    tmp = time.time()
+    bst = xgb.train(param, dtrain, num_round, evals=evals, callbacks=[record],
+                    verbose_eval=False)
+    train_time = time.time() - tmp
+    round_time = [t - s for s, t in zip([tmp] + round_end[:-1], round_end)]
+
+    dtest = xgb.DMatrix(os.path.join(args.root, kv['test:data']), silent=True)
+    pred_time = None
+    for r in range(args.repeat):
+        tmp = time.time()
+        bst.predict(dtest)
+        elapsed = time.time() - tmp
+        pred_time = elapsed if pred_time is None else min(pred_time, elapsed)
+
+    return {'conf': args.conf,
+            'tree_method': param.get('tree_method', 'auto'),
+            'robust_eps': float(param.get('robust_eps', 0)),
+            'num_round': num_round,
+            'num_row': dtrain.num_row(),
+            'num_col': dtrain.num_col(),
+            'load_time': load_time,
+            'train_time': train_time,
+            'round_time': round_time,
+            'predict_rows_per_sec': dtest.num_row() / pred_time,
+            'peak_rss_mb': peak_rss_mb(),
+            'final_metric': {k: v for k, v in result}}
+
+
+def git_commit(root):
+    try:
+        return subprocess.check_output(['git', 'rev-parse', 'HEAD'], cwd=root).decode().strip()
+    except Exception:
+        return None
+
+
+def run_benchmark(args):
+    confs = args.conf if args.conf else sorted(glob.glob(os.path.join(args.root, 'data', '*.conf')))
+    runs = []
+    for conf in confs:
+        # one process per config, so that the peak RSS is its own
+        cmd = [sys.executable, os.path.abspath(__file__), '--single', conf,
+               '--root', args.root, '--seed', str(args.seed), '--nthread', str(args.nthread),
+               '--rounds', str(args.rounds), '--repeat', str(args.repeat)]
+        print("Running %s" % conf)
+        try:
+            runs.append(json.loads(subprocess.check_output(cmd).decode().splitlines()[-1]))
+        except subprocess.CalledProcessError as e:
+            runs.append({'conf': conf, 'error': e.returncode})
+            continue
+        print("Train Time: %s seconds, Peak RSS: %.1f MB, Metric: %s"
+              % (str(runs[-1]['train_time']), runs[-1]['peak_rss_mb'], runs[-1]['final_metric']))
+    report = {'commit': git_commit(args.root),
+              'host': platform.node(),
+              'machine': platform.machine(),
+              'processor': platform.processor(),
+              'cpu_count': os.cpu_count() if hasattr(os, 'cpu_count') else None,
+              'seed': args.seed,
+              'runs': runs}
+    with open(args.output, 'w') as fo:
+        json.dump(report, fo, indent=2)
+    print("Report written to %s" % args.output)
+
+parser = argparse.ArgumentParser(
+    description='Run the data/*.conf experiments and write a JSON report of their cost.')
+parser.add_argument('conf', nargs='*', help='configs to run, all data/*.conf by default')
+parser.add_argument('--root', default='.', help='directory the data paths of the configs are relative to')
+parser.add_argument('--output', default='benchmark_conf.json')
+parser.add_argument('--seed', type=int, default=0)
+parser.add_argument('--nthread', type=int, default=0, help='0 uses all cores')
+parser.add_argument('--rounds', type=int, default=0, help='override num_round of the configs if > 0')
+parser.add_argument('--repeat', type=int, default=3, help='predictions timed, the best is reported')
+parser.add_argument('--single', default='', help=argparse.SUPPRESS)
+args = parser.parse_args()
+
+if args.single:
+    args.conf = args.single
+    print(json.dumps(run_conf(args)))
+else:
+    run_benchmark(args)
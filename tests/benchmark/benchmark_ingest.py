@@ -0,0 +1,51 @@
+# pylint: skip-file
+import sys, argparse
+import os
+import xgboost as xgb
+import numpy as np
+import time
+
+rng = np.random.RandomState(1994)
+
+
+def write_libsvm(fname, rows, columns, sparsity):
+    print("Generating LibSVM file: {} rows * {} columns, sparsity {}".format(rows, columns, sparsity))
+    tmp = time.time()
+    with open(fname, 'w') as fo:
+        for begin in range(0, rows, 10000):
+            n = min(10000, rows - begin)
+            X = rng.uniform(0, 1, size=(n, columns))
+            y = rng.randint(0, 2, size=n)
+            mask = rng.uniform(0, 1, size=(n, columns)) >= sparsity
+            lines = []
+            for i in range(n):
+                idx = np.nonzero(mask[i])[0]
+                lines.append(str(y[i]) + ''.join(' %d:%.6g' % (j, X[i, j]) for j in idx))
+            fo.write('\n'.join(lines) + '\n')
+    print("Generate Time: %s seconds" % (str(time.time() - tmp)))
+
+
+def run_benchmark(args):
+    if not os.path.exists(args.file):
+        write_libsvm(args.file, args.rows, args.columns, args.sparsity)
+    size_mb = os.path.getsize(args.file) / 1e6
+    times = []
+    for r in range(args.repeat):
+        tmp = time.time()
+        dtrain = xgb.DMatrix(args.file, silent=True)
+        times.append(time.time() - tmp)
+        nrow = dtrain.num_row()
+        del dtrain
+    best = min(times)
+    print("Load Time: %s seconds (best of %d)" % (str(best), args.repeat))
+    print("Throughput: %.1f MB/s, %.0f rows/s" % (size_mb / best, nrow / best))
+
+parser = argparse.ArgumentParser(description='Measure the LibSVM text ingestion throughput of DMatrix.')
+parser.add_argument('--file', default='ingest.libsvm', help='LibSVM file, generated if it does not exist')
+parser.add_argument('--rows', type=int, default=1000000)
+parser.add_argument('--columns', type=int, default=784)
+parser.add_argument('--sparsity', type=float, default=0.8)
+parser.add_argument('--repeat', type=int, default=3)
+args = parser.parse_args()
+
+run_benchmark(args)
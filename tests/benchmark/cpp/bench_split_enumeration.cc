@@ -0,0 +1,257 @@
+/*!
+ * Copyright 2018 by Contributors
+ * \file bench_split_enumeration.cc
+ * \brief micro benchmarks of the split enumeration kernels.
+ *
+ *  Each benchmark grows depth limited trees on a fixed data shape and
+ *  reports entries/s as items_per_second. The thread count is the last
+ *  argument and 1 thread runs first, so the runs of more threads report
+ *  their scaling efficiency t1 / (nthread * t) as a counter.
+ *
+ *  Shapes: 0 is MNIST like, 784 dense columns of 256 levels; 1 is HIGGS
+ *  like, 28 continuous columns with 30% missing; 2 is the LibSVM file in
+ *  XGBOOST_BENCHMARK_DATA, when it is set.
+ */
+#include <benchmark/benchmark.h>
+#include <dmlc/omp.h>
+#include <xgboost/c_api.h>
+#include <xgboost/data.h>
+#include <xgboost/tree_updater.h>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../../src/common/hist_util.h"
+#include "../../../src/common/row_set.h"
+
+namespace {
+
+using xgboost::bst_float;
+using xgboost::DMatrix;
+using xgboost::GradientPair;
+
+const int kShapeMnist = 0;
+const int kShapeHiggs = 1;
+const int kShapeFile = 2;
+
+// create the data of a synthetic shape, labels follow a noisy linear model
+std::shared_ptr<DMatrix> CreateShape(int shape) {
+  const bool mnist = shape == kShapeMnist;
+  const size_t nrow = mnist ? 10000 : 100000;
+  const size_t ncol = mnist ? 784 : 28;
+  std::mt19937 gen(shape);
+  std::uniform_real_distribution<float> unif(0.0f, 1.0f);
+  std::normal_distribution<float> normal(0.0f, 1.0f);
+  std::vector<float> data(nrow * ncol);
+  std::vector<float> weight(ncol);
+  for (auto &w : weight) w = normal(gen);
+  std::vector<float> labels(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    double margin = normal(gen);
+    for (size_t j = 0; j < ncol; ++j) {
+      float &v = data[i * ncol + j];
+      if (mnist) {
+        // most pixels are 0, the rest take one of 256 levels
+        v = unif(gen) < 0.8f ? 0.0f : std::floor(unif(gen) * 256.0f) / 255.0f;
+      } else {
+        v = unif(gen) < 0.3f ? NAN : normal(gen);
+      }
+      if (!std::isnan(v)) margin += weight[j] * v;
+    }
+    labels[i] = margin > 0.0 ? 1.0f : 0.0f;
+  }
+  DMatrixHandle handle;
+  XGDMatrixCreateFromMat(data.data(), nrow, ncol, NAN, &handle);
+  XGDMatrixSetFloatInfo(handle, "label", labels.data(), nrow);
+  std::shared_ptr<DMatrix> dmat = *static_cast<std::shared_ptr<DMatrix> *>(handle);
+  XGDMatrixFree(handle);
+  return dmat;
+}
+
+// the data of a shape with column access, created once
+DMatrix *GetShape(int shape) {
+  static std::map<int, std::shared_ptr<DMatrix> > cache;
+  std::shared_ptr<DMatrix> &dmat = cache[shape];
+  if (dmat == nullptr) {
+    if (shape == kShapeFile) {
+      dmat.reset(DMatrix::Load(std::getenv("XGBOOST_BENCHMARK_DATA"), true, false));
+    } else {
+      dmat = CreateShape(shape);
+    }
+    dmat->InitColAccess(std::numeric_limits<size_t>::max(), true);
+  }
+  return dmat.get();
+}
+
+// gradient of the logistic loss at margin 0
+std::vector<GradientPair> LogisticGradient(const DMatrix &dmat) {
+  const std::vector<bst_float> &labels = dmat.Info().labels_;
+  std::vector<GradientPair> gpair(labels.size());
+  for (size_t i = 0; i < labels.size(); ++i) {
+    gpair[i] = GradientPair(0.5f - labels[i], 0.25f);
+  }
+  return gpair;
+}
+
+// scaling efficiency against the 1 thread run of the same key
+void ReportScaling(benchmark::State &state, const std::string &key,  // NOLINT(*)
+                   int nthread, double seconds) {
+  static std::map<std::string, double> single_thread;
+  if (nthread == 1) single_thread[key] = seconds;
+  auto it = single_thread.find(key);
+  if (it != single_thread.end() && seconds > 0.0) {
+    state.counters["efficiency"] = it->second / (nthread * seconds);
+  }
+}
+
+// key of a benchmark run without its thread count, the last argument
+std::string ScalingKey(const benchmark::State &state, const char *name, int nargs) {
+  std::ostringstream os;
+  os << name;
+  for (int i = 0; i + 1 < nargs; ++i) os << '/' << state.range(i);
+  return os.str();
+}
+
+/*!
+ * \brief grow trees with a tree updater.
+ * \param args shape, depth, nthread and, for the robust updater, eps * 100
+ */
+void GrowTrees(benchmark::State &state, const char *updater,  // NOLINT(*)
+               const std::vector<std::pair<std::string, std::string> > &extra,
+               int nargs) {
+  const auto shape = static_cast<int>(state.range(0));
+  const auto depth = static_cast<int>(state.range(1));
+  const auto nthread = static_cast<int>(state.range(nargs - 1));
+  if (shape == kShapeFile && std::getenv("XGBOOST_BENCHMARK_DATA") == nullptr) {
+    state.SkipWithError("XGBOOST_BENCHMARK_DATA is not set");
+    return;
+  }
+  omp_set_num_threads(nthread);
+  DMatrix *dmat = GetShape(shape);
+  xgboost::HostDeviceVector<GradientPair> gpair(LogisticGradient(*dmat));
+  std::vector<std::pair<std::string, std::string> > args(extra);
+  args.emplace_back("max_depth", std::to_string(depth));
+  args.emplace_back("silent", "1");
+  std::unique_ptr<xgboost::TreeUpdater> up(xgboost::TreeUpdater::Create(updater));
+  up->Init(args);
+  double seconds = 0.0;
+  for (auto _ : state) {
+    xgboost::RegTree tree;
+    tree.param.InitAllowUnknown(args);
+    tree.param.num_feature = static_cast<int>(dmat->Info().num_col_);
+    tree.InitModel();
+    const auto start = std::chrono::high_resolution_clock::now();
+    up->Update(&gpair, dmat, {&tree});
+    seconds += std::chrono::duration<double>(
+        std::chrono::high_resolution_clock::now() - start).count();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(dmat->Info().num_nonzero_));
+  ReportScaling(state, ScalingKey(state, updater, nargs), nthread,
+                seconds / state.iterations());
+}
+
+void BM_RobustColMaker(benchmark::State &state) {  // NOLINT(*)
+  const double eps = state.range(2) / 100.0;
+  GrowTrees(state, "robust_grow_colmaker", {{"robust_eps", std::to_string(eps)}}, 4);
+}
+
+void BM_ColMaker(benchmark::State &state) {  // NOLINT(*)
+  GrowTrees(state, "grow_colmaker", {}, 3);
+}
+
+void BM_FastHistMaker(benchmark::State &state) {  // NOLINT(*)
+  GrowTrees(state, "grow_fast_histmaker", {{"max_bin", "256"}}, 3);
+}
+
+// histogram of all rows, the root of the hist updater; args shape, nthread
+void BM_BuildHist(benchmark::State &state) {  // NOLINT(*)
+  const auto shape = static_cast<int>(state.range(0));
+  const auto nthread = static_cast<int>(state.range(1));
+  if (shape == kShapeFile && std::getenv("XGBOOST_BENCHMARK_DATA") == nullptr) {
+    state.SkipWithError("XGBOOST_BENCHMARK_DATA is not set");
+    return;
+  }
+  omp_set_num_threads(nthread);
+  DMatrix *dmat = GetShape(shape);
+  const std::vector<GradientPair> gpair = LogisticGradient(*dmat);
+  xgboost::common::GHistIndexMatrix gmat;
+  gmat.Init(dmat, 256);
+  const uint32_t nbins = gmat.cut.row_ptr.back();
+  xgboost::common::GHistBuilder builder;
+  builder.Init(nthread, nbins);
+  std::vector<xgboost::common::GHistEntry> hist(nbins);
+  std::vector<size_t> rows(dmat->Info().num_row_);
+  for (size_t i = 0; i < rows.size(); ++i) rows[i] = i;
+  const xgboost::common::RowSetCollection::Elem elem(rows.data(), rows.data() + rows.size(), 0);
+  std::vector<xgboost::bst_uint> feat_set(dmat->Info().num_col_);
+  for (size_t i = 0; i < feat_set.size(); ++i) feat_set[i] = i;
+  double seconds = 0.0;
+  for (auto _ : state) {
+    const auto start = std::chrono::high_resolution_clock::now();
+    builder.BuildHist(gpair, elem, gmat, feat_set,
+                      xgboost::common::GHistRow(hist.data(), nbins));
+    seconds += std::chrono::duration<double>(
+        std::chrono::high_resolution_clock::now() - start).count();
+    benchmark::DoNotOptimize(hist.data());
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(gmat.index.size()));
+  ReportScaling(state, ScalingKey(state, "BuildHist", 2), nthread,
+                seconds / state.iterations());
+}
+
+// thread counts 1, 2, 4, ... up to the number of cores
+std::vector<int64_t> ThreadGrid() {
+  std::vector<int64_t> grid;
+  const int max_thread = omp_get_num_procs();
+  for (int n = 1; n < max_thread; n *= 2) grid.push_back(n);
+  grid.push_back(max_thread);
+  return grid;
+}
+
+std::vector<int64_t> ShapeGrid() {
+  std::vector<int64_t> grid{kShapeMnist, kShapeHiggs};
+  if (std::getenv("XGBOOST_BENCHMARK_DATA") != nullptr) grid.push_back(kShapeFile);
+  return grid;
+}
+
+void RobustGrid(benchmark::internal::Benchmark *b) {
+  for (int64_t shape : ShapeGrid()) {
+    for (int64_t depth : {4, 8}) {
+      for (int64_t eps : {0, 10, 30}) {
+        for (int64_t nthread : ThreadGrid()) b->Args({shape, depth, eps, nthread});
+      }
+    }
+  }
+}
+
+void TreeGrid(benchmark::internal::Benchmark *b) {
+  for (int64_t shape : ShapeGrid()) {
+    for (int64_t depth : {4, 8}) {
+      for (int64_t nthread : ThreadGrid()) b->Args({shape, depth, nthread});
+    }
+  }
+}
+
+void HistGrid(benchmark::internal::Benchmark *b) {
+  for (int64_t shape : ShapeGrid()) {
+    for (int64_t nthread : ThreadGrid()) b->Args({shape, nthread});
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_RobustColMaker)->Apply(RobustGrid)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_ColMaker)->Apply(TreeGrid)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_FastHistMaker)->Apply(TreeGrid)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_BuildHist)->Apply(HistGrid)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -1,7 +1,18 @@
 // Copyright by Contributors
+#include <dmlc/omp.h>
 #include <gtest/gtest.h>
 #include <xgboost/c_api.h>
 #include <xgboost/data.h>
+#include <xgboost/objective.h>
+#include <atomic>
+#include <cstdio>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../helpers.h"
 
 TEST(c_api, XGDMatrixCreateFromMatDT) {
   std::vector<int> col0 = {0, -1, 3};
@@ -31,6 +42,71 @@ TEST(c_api, XGDMatrixCreateFromMatDT) {
   }
 }
 
+TEST(c_api, XGDMatrixMergeDuplicateRows) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  // rows 0, 2 and 4 are the same, row 3 has another label, -0 is 0
+  std::vector<float> data = {
+    1.0f, nan,
+    2.0f, 3.0f,
+    1.0f, nan,
+    1.0f, nan,
+    1.0f, nan,
+    -0.0f, 1.0f,
+    0.0f, 1.0f};
+  std::vector<float> labels = {1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.5f, 0.5f};
+  std::vector<float> weights = {1.0f, 1.0f, 2.0f, 1.0f, 0.5f, 1.0f, 1.0f};
+  DMatrixHandle handle, merged;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), 7, 2, nan, &handle), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(handle, "label", labels.data(), 7), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(handle, "weight", weights.data(), 7), 0);
+  xgboost::bst_ulong num_merged;
+  ASSERT_EQ(XGDMatrixMergeDuplicateRows(handle, &merged, &num_merged), 0);
+  EXPECT_EQ(num_merged, 3);
+  auto dmat = *static_cast<std::shared_ptr<xgboost::DMatrix> *>(merged);
+  const xgboost::MetaInfo &info = dmat->Info();
+  ASSERT_EQ(info.num_row_, 4);
+  EXPECT_EQ(info.num_nonzero_, 6);
+  EXPECT_EQ(info.labels_, std::vector<float>({1.0f, 0.0f, 0.0f, 0.5f}));
+  EXPECT_EQ(info.weights_, std::vector<float>({3.5f, 1.0f, 1.0f, 2.0f}));
+  auto iter = dmat->RowIterator();
+  iter->BeforeFirst();
+  ASSERT_TRUE(iter->Next());
+  const auto &batch = iter->Value();
+  ASSERT_EQ(batch[0].length, 1);
+  EXPECT_EQ(batch[1][1].fvalue, 3.0f);
+  EXPECT_EQ(batch[2][0].fvalue, 1.0f);
+  XGDMatrixFree(handle);
+  XGDMatrixFree(merged);
+}
+
+TEST(c_api, XGDMatrixCreateFromCSCEx64) {
+  // the same rows from 32 and from 64 bit row indices
+  std::vector<size_t> col_ptr = {0, 2, 3};
+  std::vector<unsigned> indices = {0, 2, 1};
+  std::vector<uint64_t> indices64(indices.begin(), indices.end());
+  std::vector<float> data = {1.0f, 2.0f, 3.0f};
+  DMatrixHandle handle, handle64;
+  ASSERT_EQ(XGDMatrixCreateFromCSCEx(col_ptr.data(), indices.data(), data.data(),
+                                     3, 3, 4, &handle), 0);
+  ASSERT_EQ(XGDMatrixCreateFromCSCEx64(col_ptr.data(), indices64.data(), data.data(),
+                                       3, 3, 4, &handle64), 0);
+  auto dmat = *static_cast<std::shared_ptr<xgboost::DMatrix> *>(handle);
+  auto dmat64 = *static_cast<std::shared_ptr<xgboost::DMatrix> *>(handle64);
+  ASSERT_EQ(dmat64->Info().num_row_, 4);
+  EXPECT_EQ(dmat64->Info().num_col_, 2);
+  auto iter = dmat->RowIterator();
+  auto iter64 = dmat64->RowIterator();
+  iter->BeforeFirst();
+  iter64->BeforeFirst();
+  ASSERT_TRUE(iter->Next());
+  ASSERT_TRUE(iter64->Next());
+  EXPECT_EQ(iter64->Value().offset, iter->Value().offset);
+  EXPECT_EQ(iter64->Value().data, iter->Value().data);
+  EXPECT_EQ(iter64->Value()[1][0].index, 1U);
+  XGDMatrixFree(handle);
+  XGDMatrixFree(handle64);
+}
+
 TEST(c_api, XGDMatrixCreateFromMat_omp) {
   std::vector<int> num_rows = {100, 11374, 15000};
   for (auto row : num_rows) {
@@ -65,4 +141,416 @@ TEST(c_api, XGDMatrixCreateFromMat_omp) {
       }
     }
   }
-}
\ No newline at end of file
+}
+
+TEST(c_api, XGDMatrixCreateFromMatColMajor) {
+  // more rows than a block, some missing
+  const int nrow = 2500, ncol = 7;
+  std::vector<double> col_major(nrow * ncol);
+  std::vector<float> row_major(nrow * ncol);
+  for (int i = 0; i < nrow; ++i) {
+    for (int j = 0; j < ncol; ++j) {
+      const double v = (i * 7 + j * 3) % 5 == 0 ? -1.0 : 0.25 * (i % 13) - j;
+      col_major[i + j * nrow] = v;
+      row_major[i * ncol + j] = static_cast<float>(v);
+    }
+  }
+  DMatrixHandle col_handle, row_handle;
+  ASSERT_EQ(XGDMatrixCreateFromMatColMajor(col_major.data(), nrow, ncol, -1.0, &col_handle, 0),
+            0);
+  ASSERT_EQ(XGDMatrixCreateFromMat(row_major.data(), nrow, ncol, -1.0f, &row_handle), 0);
+  std::shared_ptr<xgboost::DMatrix> col_dmat =
+      *static_cast<std::shared_ptr<xgboost::DMatrix> *>(col_handle);
+  std::shared_ptr<xgboost::DMatrix> row_dmat =
+      *static_cast<std::shared_ptr<xgboost::DMatrix> *>(row_handle);
+  ASSERT_EQ(col_dmat->Info().num_row_, nrow);
+  ASSERT_EQ(col_dmat->Info().num_col_, ncol);
+  ASSERT_EQ(col_dmat->Info().num_nonzero_, row_dmat->Info().num_nonzero_);
+
+  auto col_iter = col_dmat->RowIterator();
+  auto row_iter = row_dmat->RowIterator();
+  col_iter->BeforeFirst();
+  row_iter->BeforeFirst();
+  ASSERT_TRUE(col_iter->Next());
+  ASSERT_TRUE(row_iter->Next());
+  const auto &col_batch = col_iter->Value();
+  const auto &row_batch = row_iter->Value();
+  for (int i = 0; i < nrow; ++i) {
+    auto a = col_batch[i];
+    auto b = row_batch[i];
+    ASSERT_EQ(a.length, b.length);
+    for (size_t k = 0; k < a.length; ++k) {
+      ASSERT_EQ(a[k].index, b[k].index);
+      ASSERT_EQ(a[k].fvalue, b[k].fvalue);
+    }
+  }
+  XGDMatrixFree(col_handle);
+  XGDMatrixFree(row_handle);
+}
+
+TEST(c_api, XGPredictorConcurrent) {
+  const int nrow = 64, ncol = 3;
+  std::vector<float> data(nrow * ncol), labels(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    for (int j = 0; j < ncol; ++j) data[i * ncol + j] = static_cast<float>((i * (j + 3)) % 7);
+    labels[i] = data[i * ncol] + data[i * ncol + 1] > 6.0f ? 1.0f : 0.0f;
+  }
+  data[5] = std::numeric_limits<float>::quiet_NaN();
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), nrow, ncol,
+                                   std::numeric_limits<float>::quiet_NaN(), &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), nrow), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "objective", "binary:logistic");
+  XGBoosterSetParam(booster, "max_depth", "3");
+  XGBoosterSetParam(booster, "silent", "1");
+  for (int iter = 0; iter < 4; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, dmat), 0);
+  }
+  std::vector<float> expected(nrow);
+  xgboost::bst_ulong len;
+  ASSERT_EQ(XGBoosterPredictFromDense(booster, data.data(), nrow, ncol,
+                                      std::numeric_limits<float>::quiet_NaN(), 0, 0,
+                                      nrow, expected.data(), &len), 0);
+  PredictorHandle predictor;
+  ASSERT_EQ(XGBoosterCreatePredictor(booster, &predictor), 0);
+  // the snapshot outlives the booster it is taken from
+  XGBoosterFree(booster);
+  XGDMatrixFree(dmat);
+
+  const int nthread = 4;
+  std::vector<std::vector<float> > out(nthread, std::vector<float>(nrow));
+  std::vector<int> status(nthread, -1);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthread; ++t) {
+    threads.emplace_back([&, t]() {
+      xgboost::bst_ulong out_len;
+      for (int repeat = 0; repeat < 32; ++repeat) {
+        status[t] = XGPredictorPredictFromDense(predictor, data.data(), nrow, ncol,
+                                                std::numeric_limits<float>::quiet_NaN(),
+                                                0, 0, nrow, out[t].data(), &out_len);
+        if (status[t] != 0 || out_len != static_cast<xgboost::bst_ulong>(nrow)) return;
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  for (int t = 0; t < nthread; ++t) {
+    ASSERT_EQ(status[t], 0);
+    for (int i = 0; i < nrow; ++i) ASSERT_EQ(out[t][i], expected[i]);
+  }
+  ASSERT_EQ(XGPredictorFree(predictor), 0);
+}
+
+namespace {
+// squared error, recording the threads of the regions of its last transform
+std::atomic<int> transform_threads(0);
+class ThreadsObj : public xgboost::ObjFunction {
+ public:
+  void Configure(const std::vector<std::pair<std::string, std::string> >& args) override {}
+  void GetGradient(xgboost::HostDeviceVector<xgboost::bst_float>* preds,
+                   const xgboost::MetaInfo& info, int iteration,
+                   xgboost::HostDeviceVector<xgboost::GradientPair>* out_gpair) override {
+    const std::vector<xgboost::bst_float>& p = preds->HostVector();
+    out_gpair->Resize(p.size());
+    for (size_t i = 0; i < p.size(); ++i) {
+      out_gpair->HostVector()[i] = xgboost::GradientPair(p[i] - info.labels_[i], 1.0f);
+    }
+  }
+  const char* DefaultEvalMetric() const override {
+    return "rmse";
+  }
+  void PredTransform(xgboost::HostDeviceVector<xgboost::bst_float>* io_preds) override {
+    transform_threads = omp_get_max_threads();
+  }
+};
+XGBOOST_REGISTER_OBJECTIVE(ThreadsObj, "test:threads")
+.set_body([]() { return new ThreadsObj(); });
+}  // namespace
+
+TEST(c_api, NumThreadsOfEntryPoints) {
+  const int nrow = 32, ncol = 2;
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> data(nrow * ncol), labels(nrow);
+  for (int i = 0; i < nrow * ncol; ++i) data[i] = static_cast<float>(i % 5);
+  for (int i = 0; i < nrow; ++i) labels[i] = data[i * ncol];
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), nrow, ncol, nan, &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), nrow), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "objective", "test:threads");
+  XGBoosterSetParam(booster, "nthread", "2");
+  XGBoosterSetParam(booster, "silent", "1");
+  ASSERT_EQ(XGBoosterUpdateOneIter(booster, 0, dmat), 0);
+  PredictorHandle predictor;
+  ASSERT_EQ(XGBoosterCreatePredictor(booster, &predictor), 0);
+  RegistryHandle registry;
+  ASSERT_EQ(XGRegistryCreate(&registry), 0);
+  ASSERT_EQ(XGRegistryAddBooster(registry, "model", booster), 0);
+
+  // the calls run with the nthread of the booster, whatever the caller has
+  const int before = omp_get_max_threads();
+  omp_set_num_threads(1);
+  std::vector<float> out(nrow);
+  xgboost::bst_ulong len;
+  transform_threads = 0;
+  ASSERT_EQ(XGBoosterPredictFromDense(booster, data.data(), nrow, ncol, nan, 0, 0,
+                                      nrow, out.data(), &len), 0);
+  EXPECT_EQ(transform_threads.load(), 2);
+  transform_threads = 0;
+  ASSERT_EQ(XGPredictorPredictFromDense(predictor, data.data(), nrow, ncol, nan, 0, 0,
+                                        nrow, out.data(), &len), 0);
+  EXPECT_EQ(transform_threads.load(), 2);
+  transform_threads = 0;
+  ASSERT_EQ(XGRegistryPredictFromDense(registry, "model", data.data(), nrow, ncol, nan,
+                                       0, 0, nrow, out.data(), &len), 0);
+  EXPECT_EQ(transform_threads.load(), 2);
+  EXPECT_EQ(omp_get_max_threads(), 1);
+
+  // and within the limit of the process
+  ASSERT_EQ(XGBSetThreadLimit(1), 0);
+  omp_set_num_threads(before);
+  ASSERT_EQ(XGPredictorPredictFromDense(predictor, data.data(), nrow, ncol, nan, 0, 0,
+                                        nrow, out.data(), &len), 0);
+  EXPECT_EQ(transform_threads.load(), 1);
+  ASSERT_EQ(XGBSetThreadLimit(0), 0);
+  EXPECT_EQ(omp_get_max_threads(), before);
+
+  ASSERT_EQ(XGRegistryFree(registry), 0);
+  ASSERT_EQ(XGPredictorFree(predictor), 0);
+  XGBoosterFree(booster);
+  XGDMatrixFree(dmat);
+}
+
+TEST(c_api, XGRegistrySharedTrees) {
+  const int nrow = 64, ncol = 3;
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> data(nrow * ncol), labels(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    for (int j = 0; j < ncol; ++j) data[i * ncol + j] = static_cast<float>((i * (j + 2)) % 5);
+    labels[i] = data[i * ncol] + data[i * ncol + 2];
+  }
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), nrow, ncol, nan, &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), nrow), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "max_depth", "2");
+  XGBoosterSetParam(booster, "silent", "1");
+  RegistryHandle registry;
+  ASSERT_EQ(XGRegistryCreate(&registry), 0);
+  // the model of 2 rounds is a prefix of the one of 4 rounds
+  std::vector<std::vector<float> > expected(2, std::vector<float>(nrow));
+  xgboost::bst_ulong len;
+  for (int iter = 0; iter < 4; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, dmat), 0);
+    if (iter % 2 == 0) continue;
+    const int k = iter / 2;
+    ASSERT_EQ(XGBoosterPredictFromDense(booster, data.data(), nrow, ncol, nan, 0, 0,
+                                        nrow, expected[k].data(), &len), 0);
+    ASSERT_EQ(XGRegistryAddBooster(registry, k == 0 ? "short" : "long", booster), 0);
+  }
+  XGBoosterFree(booster);
+  XGDMatrixFree(dmat);
+
+  xgboost::bst_ulong num_model, num_tree, num_stored;
+  ASSERT_EQ(XGRegistryGetSize(registry, &num_model, &num_tree, &num_stored), 0);
+  ASSERT_EQ(num_model, 2);
+  ASSERT_EQ(num_tree, 6);
+  ASSERT_EQ(num_stored, 4);
+  std::vector<float> out(nrow);
+  for (int k = 0; k < 2; ++k) {
+    ASSERT_EQ(XGRegistryPredictFromDense(registry, k == 0 ? "short" : "long", data.data(),
+                                         nrow, ncol, nan, 0, 0, nrow, out.data(), &len), 0);
+    ASSERT_EQ(len, nrow);
+    for (int i = 0; i < nrow; ++i) ASSERT_EQ(out[i], expected[k][i]);
+  }
+  ASSERT_NE(XGRegistryPredictFromDense(registry, "none", data.data(), nrow, ncol, nan,
+                                       0, 0, nrow, out.data(), &len), 0);
+  ASSERT_EQ(XGRegistryFree(registry), 0);
+}
+
+TEST(c_api, XGBatcherConcurrent) {
+  const int nrow = 48, ncol = 3;
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> data(nrow * ncol), labels(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    for (int j = 0; j < ncol; ++j) data[i * ncol + j] = static_cast<float>((i * (j + 1)) % 6);
+    labels[i] = data[i * ncol + 1] > 2.0f ? 1.0f : 0.0f;
+  }
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), nrow, ncol, nan, &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), nrow), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "objective", "binary:logistic");
+  XGBoosterSetParam(booster, "silent", "1");
+  for (int iter = 0; iter < 3; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, dmat), 0);
+  }
+  PredictorHandle predictor;
+  ASSERT_EQ(XGBoosterCreatePredictor(booster, &predictor), 0);
+  XGBoosterFree(booster);
+  XGDMatrixFree(dmat);
+  std::vector<float> expected(nrow);
+  xgboost::bst_ulong len;
+  ASSERT_EQ(XGPredictorPredictFromDense(predictor, data.data(), nrow, ncol, nan, 0, 0,
+                                        nrow, expected.data(), &len), 0);
+
+  BatcherHandle batcher;
+  ASSERT_EQ(XGPredictorCreateBatcher(predictor, 8, 200, 0, 0, &batcher), 0);
+  // every thread predicts its share of the rows one at a time
+  const int nthread = 4;
+  std::vector<float> out(nrow);
+  std::vector<int> status(nthread, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthread; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = t; i < nrow; i += nthread) {
+        xgboost::bst_ulong out_len;
+        status[t] |= XGBatcherPredict(batcher, &data[i * ncol], ncol, nan, 1, &out[i], &out_len);
+        if (out_len != 1) status[t] = -1;
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  for (int t = 0; t < nthread; ++t) ASSERT_EQ(status[t], 0);
+  for (int i = 0; i < nrow; ++i) ASSERT_EQ(out[i], expected[i]);
+  ASSERT_EQ(XGBatcherFree(batcher), 0);
+  ASSERT_EQ(XGPredictorFree(predictor), 0);
+}
+
+TEST(c_api, XGPredictorPredictDecision) {
+  const int nrow = 64, ncol = 3, nround = 20;
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> data(nrow * ncol), labels(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    for (int j = 0; j < ncol; ++j) data[i * ncol + j] = static_cast<float>((i * (j + 3)) % 7);
+    labels[i] = data[i * ncol] + data[i * ncol + 1] > 6.0f ? 1.0f : 0.0f;
+  }
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), nrow, ncol, nan, &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), nrow), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "objective", "binary:logistic");
+  XGBoosterSetParam(booster, "max_depth", "3");
+  XGBoosterSetParam(booster, "silent", "1");
+  for (int iter = 0; iter < nround; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, dmat), 0);
+  }
+  PredictorHandle predictor;
+  ASSERT_EQ(XGBoosterCreatePredictor(booster, &predictor), 0);
+  XGBoosterFree(booster);
+  XGDMatrixFree(dmat);
+  std::vector<float> margin(nrow);
+  xgboost::bst_ulong len;
+  ASSERT_EQ(XGPredictorPredictFromDense(predictor, data.data(), nrow, ncol, nan, 1, 0,
+                                        nrow, margin.data(), &len), 0);
+  std::vector<float> decision(nrow);
+  std::vector<unsigned> ntree(nrow);
+  ASSERT_EQ(XGPredictorPredictDecision(predictor, data.data(), nrow, ncol, nan, 0.0f,
+                                       decision.data(), ntree.data()), 0);
+  size_t total = 0;
+  for (int i = 0; i < nrow; ++i) {
+    if (std::fabs(margin[i]) > 1e-4f) ASSERT_EQ(decision[i], margin[i] > 0.0f ? 1.0f : 0.0f);
+    ASSERT_LE(ntree[i], nround);
+    total += ntree[i];
+  }
+  // the confident rows stop before the last trees
+  ASSERT_LT(total, static_cast<size_t>(nrow) * nround);
+  ASSERT_EQ(XGPredictorFree(predictor), 0);
+}
+
+TEST(c_api, XGQuantizedModel) {
+  const int nrow = 64, ncol = 3, nround = 20;
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> data(nrow * ncol), labels(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    for (int j = 0; j < ncol; ++j) data[i * ncol + j] = static_cast<float>((i * (j + 3)) % 7);
+    labels[i] = data[i * ncol] + data[i * ncol + 1] > 6.0f ? 1.0f : 0.0f;
+  }
+  // some missing values take the default directions
+  for (int i = 0; i < nrow; i += 5) data[i * ncol + i % ncol] = nan;
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), nrow, ncol, nan, &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), nrow), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "objective", "binary:logistic");
+  XGBoosterSetParam(booster, "max_depth", "3");
+  XGBoosterSetParam(booster, "silent", "1");
+  for (int iter = 0; iter < nround; ++iter) {
+    ASSERT_EQ(XGBoosterUpdateOneIter(booster, iter, dmat), 0);
+  }
+  std::vector<float> margin(nrow);
+  xgboost::bst_ulong len;
+  ASSERT_EQ(XGBoosterPredictFromDense(booster, data.data(), nrow, ncol, nan, 1, 0,
+                                      nrow, margin.data(), &len), 0);
+  const std::string fname = TempFileName();
+  ASSERT_EQ(XGBoosterSaveQuantizedModel(booster, fname.c_str()), 0);
+  XGBoosterFree(booster);
+  XGDMatrixFree(dmat);
+  QuantizedModelHandle model;
+  ASSERT_EQ(XGQuantizedModelLoad(fname.c_str(), &model), 0);
+  std::remove(fname.c_str());
+  std::vector<float> quantized(nrow);
+  ASSERT_EQ(XGQuantizedModelPredictFromDense(model, data.data(), nrow, ncol, nan, nrow,
+                                             quantized.data(), &len), 0);
+  ASSERT_EQ(len, nrow);
+  // the same leaves are reached, only their values are rounded to float16
+  for (int i = 0; i < nrow; ++i) ASSERT_NEAR(quantized[i], margin[i], 1e-2f);
+  ASSERT_EQ(XGQuantizedModelFree(model), 0);
+}
+
+TEST(c_api, XGBoosterSweep) {
+  const int nrow = 64, ncol = 3, nround = 8;
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> data(nrow * ncol), labels(nrow);
+  for (int i = 0; i < nrow; ++i) {
+    for (int j = 0; j < ncol; ++j) data[i * ncol + j] = static_cast<float>((i * (j + 3)) % 7);
+    labels[i] = data[i * ncol] + data[i * ncol + 1] > 6.0f ? 1.0f : 0.0f;
+  }
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), nrow, ncol, nan, &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), nrow), 0);
+  const char* keys[] = {"objective", "max_depth", "silent",
+                        "objective", "max_depth", "silent",
+                        "objective", "max_depth", "silent", "eval_metric"};
+  const char* values[] = {"binary:logistic", "1", "1",
+                          "binary:logistic", "2", "1",
+                          "binary:logistic", "3", "1", "auc"};
+  const xgboost::bst_ulong config_ptr[] = {0, 3, 6, 10};
+  const int nconfig = 3;
+  BoosterHandle boosters[nconfig];
+  float best_score[nconfig];
+  int best_iteration[nconfig];
+  ASSERT_EQ(XGBoosterSweep(dmat, nullptr, keys, values, config_ptr, nconfig, nround, 0, 2,
+                           boosters, best_score, best_iteration), 0);
+  for (int c = 0; c < nconfig; ++c) {
+    // the same model as a booster trained alone
+    BoosterHandle alone;
+    ASSERT_EQ(XGBoosterCreate(&dmat, 1, &alone), 0);
+    for (xgboost::bst_ulong j = config_ptr[c]; j < config_ptr[c + 1]; ++j) {
+      ASSERT_EQ(XGBoosterSetParam(alone, keys[j], values[j]), 0);
+    }
+    for (int iter = 0; iter < nround; ++iter) {
+      ASSERT_EQ(XGBoosterUpdateOneIter(alone, iter, dmat), 0);
+    }
+    std::vector<float> expected(nrow), swept(nrow);
+    xgboost::bst_ulong len;
+    ASSERT_EQ(XGBoosterPredictFromDense(alone, data.data(), nrow, ncol, nan, 1, 0, nrow,
+                                        expected.data(), &len), 0);
+    ASSERT_EQ(XGBoosterPredictFromDense(boosters[c], data.data(), nrow, ncol, nan, 1, 0, nrow,
+                                        swept.data(), &len), 0);
+    for (int i = 0; i < nrow; ++i) ASSERT_NEAR(swept[i], expected[i], 1e-5f);
+    ASSERT_GE(best_iteration[c], 0);
+    ASSERT_LT(best_iteration[c], nround);
+    XGBoosterFree(alone);
+    ASSERT_EQ(XGBoosterFree(boosters[c]), 0);
+  }
+  // auc is maximized
+  ASSERT_GT(best_score[2], 0.5f);
+  XGDMatrixFree(dmat);
+}
@@ -0,0 +1,48 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <vector>
+#include "../../../src/common/eps_window.h"
+
+namespace xgboost {
+namespace common {
+
+TEST(EpsWindowMatrix, Boundaries) {
+  SparsePage page;
+  const std::vector<std::vector<bst_float> > columns = {
+    {0.0f, 0.1f, 0.25f, 0.5f, 0.5f, 0.9f, 1.6f}, {}, {-1.0f, -1.0f, 2.0f}};
+  for (const auto& col : columns) {
+    for (size_t i = 0; i < col.size(); ++i) {
+      page.data.emplace_back(static_cast<bst_uint>(i), col[i]);
+    }
+    page.offset.push_back(page.data.size());
+  }
+  const bst_float eps = 0.3f;
+  EpsWindowMatrix windows;
+  windows.Init(page, eps);
+  EXPECT_EQ(windows.Eps(), eps);
+  for (bst_uint fid = 0; fid < columns.size(); ++fid) {
+    const SparsePage::Inst col = page[fid];
+    const EpsWindow win = windows.GetColumn(fid, col.data, col.length);
+    ASSERT_EQ(win.data, col.data);
+    for (bst_uint i = 0; i < col.length; ++i) {
+      const bst_float eta = col[i].fvalue - eps;
+      uint32_t left = 0, certain = 0;
+      while (col[left].fvalue < eta) ++left;
+      while (col[certain].fvalue < eta - eps) ++certain;
+      EXPECT_EQ(win.left[i], left);
+      EXPECT_EQ(win.certain[i], certain);
+    }
+  }
+  // 0.9 - 0.3 is first reached by 0.9, (0.9 - 0.3) - 0.3 by 0.5
+  EXPECT_EQ(windows.GetColumn(0, page[0].data, page[0].length).left[5], 5U);
+  EXPECT_EQ(windows.GetColumn(0, page[0].data, page[0].length).certain[5], 3U);
+  // a column of another page, e.g. a compacted one, has no boundaries
+  const SparsePage::Inst col = page[0];
+  EXPECT_EQ(windows.GetColumn(0, col.data + 1, col.length - 1).data, nullptr);
+  EXPECT_EQ(windows.GetColumn(3, col.data, col.length).data, nullptr);
+  windows.Clear();
+  EXPECT_EQ(windows.GetColumn(0, col.data, col.length).data, nullptr);
+}
+
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,60 @@
+// Copyright by Contributors
+#include <dmlc/omp.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+#include "../../../src/common/feature_scheduler.h"
+
+namespace xgboost {
+namespace common {
+
+TEST(FeatureScheduler, TakesEachFeatureOnce) {
+  std::vector<bst_uint> feat_set;
+  std::vector<size_t> cost;
+  for (bst_uint fid = 0; fid < 100; ++fid) {
+    feat_set.push_back(fid * 2);
+    cost.push_back((fid * 37) % 101);
+  }
+  const int nthread = 4;
+  FeatureScheduler scheduler;
+  scheduler.Init(feat_set, cost, nthread, false);
+  EXPECT_TRUE(scheduler.Heavy().empty());
+
+  // the first feature of each queue is one of the heaviest
+  bst_uint fid;
+  ASSERT_TRUE(scheduler.Next(0, &fid));
+  EXPECT_EQ(cost[fid / 2], *std::max_element(cost.begin(), cost.end()));
+
+  std::vector<int> taken(200, 0);
+  ++taken[fid];
+  #pragma omp parallel num_threads(nthread)
+  {
+    const int tid = omp_get_thread_num();
+    bst_uint f;
+    while (scheduler.Next(tid, &f)) {
+      #pragma omp atomic
+      ++taken[f];
+    }
+  }
+  for (bst_uint f = 0; f < 200; ++f) {
+    EXPECT_EQ(taken[f], f % 2 == 0 ? 1 : 0) << f;
+  }
+}
+
+TEST(FeatureScheduler, Heavy) {
+  // a column of over a quarter of the entries is set apart for 4 threads
+  std::vector<bst_uint> feat_set{3, 5, 7, 9};
+  std::vector<size_t> cost{10, 100, 10, 10};
+  FeatureScheduler scheduler;
+  scheduler.Init(feat_set, cost, 4, true);
+  ASSERT_EQ(scheduler.Heavy().size(), 1U);
+  EXPECT_EQ(scheduler.Heavy()[0], 5U);
+  std::vector<bst_uint> rest;
+  bst_uint fid;
+  while (scheduler.Next(1, &fid)) rest.push_back(fid);
+  std::sort(rest.begin(), rest.end());
+  EXPECT_EQ(rest, std::vector<bst_uint>({3, 7, 9}));
+}
+
+}  // namespace common
+}  // namespace xgboost
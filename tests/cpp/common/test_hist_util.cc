@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../../src/common/column_matrix.h"
+#include "../../../src/common/hist_util.h"
+#include "../helpers.h"
+#include "gtest/gtest.h"
+
+namespace xgboost {
+namespace common {
+TEST(QuantizedGradient, BuildHist) {
+  auto dmat = CreateDMatrix(100, 10, 0.3);
+  GHistIndexMatrix gmat;
+  gmat.Init(dmat.get(), 16);
+  const uint32_t nbins = gmat.cut.row_ptr.back();
+
+  std::vector<GradientPair> gpair(dmat->Info().num_row_);
+  for (size_t i = 0; i < gpair.size(); ++i) {
+    gpair[i] = GradientPair(std::sin(i * 0.7f), 0.1f + (i % 5) * 0.2f);
+  }
+  gpair[3] = GradientPair(5.0f, -1.0f);  // a deleted row
+  QuantizedGradient qgpair;
+  qgpair.Build(gpair);
+  EXPECT_EQ(qgpair[3].grad, 0);
+  EXPECT_EQ(qgpair[3].hess, 0);
+
+  std::vector<size_t> rows;
+  for (size_t i = 0; i < gpair.size(); ++i) {
+    if (i != 3) rows.push_back(i);
+  }
+  const RowSetCollection::Elem elem(rows.data(), rows.data() + rows.size(), 0);
+  std::vector<bst_uint> feat_set(dmat->Info().num_col_);
+  for (size_t i = 0; i < feat_set.size(); ++i) feat_set[i] = i;
+  GHistBuilder builder;
+  builder.Init(4, nbins);
+  std::vector<GHistEntry> exact(nbins), quantized(nbins);
+  builder.BuildHist(gpair, elem, gmat, feat_set, GHistRow(exact.data(), nbins));
+  builder.BuildHist(qgpair, elem, gmat, feat_set, GHistRow(quantized.data(), nbins));
+
+  // each gradient is off by at most half a step of the scale
+  for (uint32_t bin = 0; bin < nbins; ++bin) {
+    EXPECT_NEAR(quantized[bin].sum_grad, exact[bin].sum_grad,
+                rows.size() * qgpair.GradScale() / 2);
+    EXPECT_NEAR(quantized[bin].sum_hess, exact[bin].sum_hess,
+                rows.size() * qgpair.HessScale() / 2);
+    // the bins are multiples of the scales
+    const double steps = quantized[bin].sum_grad / qgpair.GradScale();
+    EXPECT_NEAR(steps, std::round(steps), 1e-6);
+  }
+}
+
+TEST(GHistBuilder, BuildHists) {
+  // the level pass matches one BuildHist per node, for dense rows over
+  // several bin tiles and for sparse rows
+  for (float sparsity : {0.0f, 0.3f}) {
+    const int ncol = sparsity == 0.0f ? 300 : 20;
+    auto dmat = CreateDMatrix(400, ncol, sparsity);
+    GHistIndexMatrix gmat;
+    gmat.Init(dmat.get(), 64);
+    const uint32_t nbins = gmat.cut.row_ptr.back();
+    EXPECT_EQ(gmat.index.FeatureOffset().empty(), sparsity != 0.0f);
+
+    std::vector<GradientPair> gpair(dmat->Info().num_row_);
+    for (size_t i = 0; i < gpair.size(); ++i) {
+      gpair[i] = GradientPair(std::sin(i * 0.3f), 0.5f + (i % 3) * 0.25f);
+    }
+    const size_t nnode = 40;
+    std::vector<std::vector<size_t> > node_rows(nnode);
+    for (size_t i = 0; i < gpair.size(); ++i) {
+      // the last node is empty
+      node_rows[i % (nnode - 1)].push_back(i);
+    }
+    std::vector<bst_uint> feat_set(ncol);
+    for (size_t i = 0; i < feat_set.size(); ++i) feat_set[i] = i;
+
+    GHistBuilder builder;
+    builder.Init(4, nbins);
+    std::vector<GHistEntry> single(nnode * nbins), level(nnode * nbins);
+    std::vector<RowSetCollection::Elem> elems;
+    std::vector<GHistRow> hists;
+    for (size_t n = 0; n < nnode; ++n) {
+      const RowSetCollection::Elem elem(node_rows[n].data(),
+                                        node_rows[n].data() + node_rows[n].size(),
+                                        static_cast<int>(n));
+      builder.BuildHist(gpair, elem, gmat, feat_set, GHistRow(&single[n * nbins], nbins));
+      elems.push_back(elem);
+      hists.emplace_back(&level[n * nbins], nbins);
+    }
+    builder.BuildHists(gpair, elems, gmat, hists);
+    for (size_t i = 0; i < single.size(); ++i) {
+      EXPECT_NEAR(level[i].sum_grad, single[i].sum_grad, 1e-6);
+      EXPECT_NEAR(level[i].sum_hess, single[i].sum_hess, 1e-6);
+    }
+  }
+}
+
+TEST(GHistIndexMatrix, BinIndexWidth) {
+  // dense rows store the bins relative to their feature
+  auto dense = CreateDMatrix(50, 300, 0.0);
+  GHistIndexMatrix gmat;
+  gmat.Init(dense.get(), 256);
+  ASSERT_GT(gmat.cut.row_ptr.back(), 256U);
+  EXPECT_EQ(gmat.index.Width(), 1);
+  ASSERT_EQ(gmat.index.FeatureOffset().size(), 300U);
+  for (size_t i = 0; i < gmat.index.size(); ++i) {
+    const size_t fid = i % 300;
+    EXPECT_GE(gmat.index[i], gmat.cut.row_ptr[fid]);
+    EXPECT_LT(gmat.index[i], gmat.cut.row_ptr[fid + 1]);
+  }
+
+  // the histogram of the packed index is the one of the global bins
+  const uint32_t nbins = gmat.cut.row_ptr.back();
+  std::vector<GradientPair> gpair(dense->Info().num_row_);
+  for (size_t i = 0; i < gpair.size(); ++i) {
+    gpair[i] = GradientPair(static_cast<float>(i % 3) - 1.0f, 1.0f);
+  }
+  std::vector<size_t> rows(gpair.size());
+  for (size_t i = 0; i < rows.size(); ++i) rows[i] = i;
+  const RowSetCollection::Elem elem(rows.data(), rows.data() + rows.size(), 0);
+  GHistBuilder builder;
+  builder.Init(2, nbins);
+  std::vector<GHistEntry> hist(nbins), expected(nbins);
+  builder.BuildHist(gpair, elem, gmat, {}, GHistRow(hist.data(), nbins));
+  for (size_t rid = 0; rid < rows.size(); ++rid) {
+    for (size_t j = gmat.row_ptr[rid]; j < gmat.row_ptr[rid + 1]; ++j) {
+      expected[gmat.index[j]].Add(gpair[rid]);
+    }
+  }
+  for (uint32_t bin = 0; bin < nbins; ++bin) {
+    EXPECT_EQ(hist[bin].sum_grad, expected[bin].sum_grad);
+    EXPECT_EQ(hist[bin].sum_hess, expected[bin].sum_hess);
+  }
+
+  // sparse rows store the global bins in 2 bytes
+  auto sparse = CreateDMatrix(50, 300, 0.5);
+  GHistIndexMatrix gmat_sparse;
+  gmat_sparse.Init(sparse.get(), 64);
+  EXPECT_TRUE(gmat_sparse.index.FeatureOffset().empty());
+  EXPECT_EQ(gmat_sparse.index.Width(), 2);
+}
+
+TEST(GHistIndexMatrix, AppendRows) {
+  auto dmat = CreateDMatrix(200, 10, 0.3);
+  auto more = CreateDMatrix(100, 10, 0.3, 5);
+  GHistIndexMatrix gmat;
+  gmat.Init(dmat.get(), 16);
+  const size_t old_nnz = gmat.index.size();
+  std::vector<uint32_t> old_index(old_nnz);
+  for (size_t i = 0; i < old_nnz; ++i) old_index[i] = gmat.index[i];
+
+  SparsePage rows;
+  auto iter = more->RowIterator();
+  iter->BeforeFirst();
+  while (iter->Next()) rows.Push(iter->Value());
+  dmat->AppendRows(rows, {}, {});
+  gmat.AppendRows(dmat.get());
+  ASSERT_EQ(gmat.row_ptr.size(), 301U);
+  for (size_t i = 0; i < old_nnz; ++i) ASSERT_EQ(gmat.index[i], old_index[i]);
+  // the new rows are binned with the cuts of the first ones
+  std::vector<size_t> hit_count(gmat.cut.row_ptr.back(), 0);
+  for (size_t i = 0; i < old_nnz; ++i) ++hit_count[old_index[i]];
+  for (size_t rid = 0; rid < rows.Size(); ++rid) {
+    auto inst = rows[rid];
+    std::vector<uint32_t> bins;
+    for (bst_uint j = 0; j < inst.length; ++j) bins.push_back(gmat.cut.GetBinIdx(inst[j]));
+    std::sort(bins.begin(), bins.end());
+    const size_t ibegin = gmat.row_ptr[200 + rid];
+    ASSERT_EQ(gmat.row_ptr[200 + rid + 1] - ibegin, bins.size());
+    for (size_t j = 0; j < bins.size(); ++j) {
+      ASSERT_EQ(gmat.index[ibegin + j], bins[j]);
+      ++hit_count[bins[j]];
+    }
+  }
+  EXPECT_EQ(gmat.hit_count, hit_count);
+}
+
+TEST(GHistIndexBlockMatrix, SparseFeaturesShareBlocks) {
+  // the sparse features are packed into a few blocks, whose histogram is the
+  // one of the global bins
+  auto dmat = CreateDMatrix(200, 400, 0.99);
+  GHistIndexMatrix gmat;
+  gmat.Init(dmat.get(), 16);
+  ColumnMatrix colmat;
+  FastHistParam param;
+  param.Init(std::vector<std::pair<std::string, std::string> >());
+  colmat.Init(gmat, param.sparse_threshold);
+  GHistIndexBlockMatrix gmatb;
+  gmatb.Init(gmat, colmat, param);
+  EXPECT_LT(gmatb.GetNumBlock(), 400U / 10);
+
+  const uint32_t nbins = gmat.cut.row_ptr.back();
+  std::vector<GradientPair> gpair(dmat->Info().num_row_);
+  for (size_t i = 0; i < gpair.size(); ++i) {
+    gpair[i] = GradientPair(std::cos(i * 0.5f), 0.5f + (i % 4) * 0.25f);
+  }
+  std::vector<size_t> rows;
+  for (size_t i = 0; i < gpair.size(); i += 2) rows.push_back(i);
+  const RowSetCollection::Elem elem(rows.data(), rows.data() + rows.size(), 0);
+  GHistBuilder builder;
+  builder.Init(4, nbins);
+  std::vector<GHistEntry> rowwise(nbins), blockwise(nbins);
+  builder.BuildHist(gpair, elem, gmat, {}, GHistRow(rowwise.data(), nbins));
+  builder.BuildBlockHist(gpair, elem, gmatb, {}, GHistRow(blockwise.data(), nbins));
+  for (uint32_t bin = 0; bin < nbins; ++bin) {
+    EXPECT_NEAR(blockwise[bin].sum_grad, rowwise[bin].sum_grad, 1e-6);
+    EXPECT_NEAR(blockwise[bin].sum_hess, rowwise[bin].sum_hess, 1e-6);
+  }
+}
+
+TEST(HistCutMatrix, Cache) {
+  auto dmat = CreateDMatrix(200, 12, 0.2);
+  std::string tmp_file = TempFileName();
+  HistCutMatrix computed;
+  computed.Init(dmat.get(), 32, tmp_file);
+
+  HistCutMatrix loaded;
+  loaded.Init(dmat.get(), 32, tmp_file);
+  EXPECT_EQ(loaded.row_ptr, computed.row_ptr);
+  EXPECT_EQ(loaded.min_val, computed.min_val);
+  EXPECT_EQ(loaded.cut, computed.cut);
+
+  // the cuts of another max_bin are not taken from the cache
+  HistCutMatrix other;
+  other.Init(dmat.get(), 8, tmp_file);
+  HistCutMatrix direct;
+  direct.Init(dmat.get(), 8);
+  EXPECT_EQ(other.cut, direct.cut);
+  EXPECT_LT(other.cut.size(), computed.cut.size());
+  std::remove(tmp_file.c_str());
+}
+
+TEST(HistCutMatrix, RobustBoundary) {
+  // a feature of four frequent values, 0, 2, 4 and 6, between rare ones
+  using WXQSketch = HistCutMatrix::WXQSketch;
+  const size_t n = 1000;
+  const uint32_t max_bin = 16;
+  std::vector<WXQSketch> sketchs(1);
+  sketchs[0].Init(n, 1.0 / (max_bin * 8));
+  for (size_t i = 0; i < n; ++i) {
+    sketchs[0].Push(i % 2 == 0 ? static_cast<bst_float>(i % 8) : i * 0.01f, 1.0f);
+  }
+  HistCutMatrix cut;
+  cut.Init(&sketchs, max_bin, 0.25f);
+  ASSERT_EQ(cut.row_ptr.size(), 2U);
+  EXPECT_LE(cut.cut.size(), max_bin);
+  auto has_cut = [&cut](bst_float v) {
+    return std::find(cut.cut.begin(), cut.cut.end(), v) != cut.cut.end();
+  };
+  EXPECT_TRUE(has_cut(0.25f));
+  for (bst_float v : {2.0f, 4.0f, 6.0f}) {
+    EXPECT_TRUE(has_cut(v - 0.25f)) << v;
+    EXPECT_TRUE(has_cut(v + 0.25f)) << v;
+  }
+  // no cut below the minimum value
+  EXPECT_GT(cut.cut.front(), 0.0f);
+  EXPECT_TRUE(std::is_sorted(cut.cut.begin(), cut.cut.end()));
+}
+
+TEST(HistCollection, Pool) {
+  const uint32_t nbins = 64;
+  HistCollection hist;
+  // room for 4 histograms
+  hist.Init(nbins, 4 * nbins * sizeof(GHistEntry));
+  for (bst_uint nid = 0; nid < 4; ++nid) {
+    hist.AddHistRow(nid);
+    hist[nid].begin[0].sum_grad = nid + 1;
+  }
+  EXPECT_EQ(hist.NumRows(), 4U);
+
+  // a freed buffer is reused, and cleared
+  GHistEntry* first = hist[1].begin;
+  hist.FreeHistRow(1);
+  EXPECT_FALSE(hist.RowExists(1));
+  hist.AddHistRow(4);
+  EXPECT_EQ(hist[4].begin, first);
+  EXPECT_EQ(hist[4].begin[0].sum_grad, 0.0);
+
+  // the oldest nodes but the kept one are evicted for two more
+  hist.Evict(2, 0);
+  EXPECT_EQ(hist.NumRows(), 2U);
+  EXPECT_TRUE(hist.RowExists(0));
+  EXPECT_FALSE(hist.RowExists(2));
+  EXPECT_TRUE(hist.RowExists(4));
+  EXPECT_EQ(hist[0].begin[0].sum_grad, 1.0);
+}
+}  // namespace common
+}  // namespace xgboost
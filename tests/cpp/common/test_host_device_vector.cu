@@ -0,0 +1,58 @@
+/*!
+ * Copyright 2018 XGBoost contributors
+ */
+#include <thrust/copy.h>
+#include <thrust/device_ptr.h>
+#include <thrust/sequence.h>
+#include <vector>
+#include "../../../src/common/host_device_vector.h"
+#include "gtest/gtest.h"
+
+namespace xgboost {
+
+// the device copy of device 0
+static std::vector<float> DeviceCopy(HostDeviceVector<float>* v) {
+  std::vector<float> out(v->DeviceSize(0));
+  thrust::device_ptr<const float> begin(v->ConstDevicePointer(0));
+  thrust::copy(begin, begin + out.size(), out.begin());
+  return out;
+}
+
+TEST(HostDeviceVector, HostRange) {
+  HostDeviceVector<float> v(10, 1.0f, GPUSet::Range(0, 1));
+  thrust::sequence(v.tbegin(0), v.tend(0));
+  // only the range is copied to the host, the rest stays on the device
+  float* range = v.HostRange(2, 4);
+  EXPECT_EQ(range[0], 2.0f);
+  EXPECT_EQ(range[1], 3.0f);
+  range[0] = 20.0f;
+  range[1] = 30.0f;
+  std::vector<float> expected = {0, 1, 20, 30, 4, 5, 6, 7, 8, 9};
+  EXPECT_EQ(v.ConstHostVector(), expected);
+  EXPECT_EQ(DeviceCopy(&v), expected);
+
+  // two ranges written on a valid host copy
+  v.HostRange(5, 6)[0] = 50.0f;
+  v.HostRange(8, 9)[0] = 80.0f;
+  expected[5] = 50.0f;
+  expected[8] = 80.0f;
+  EXPECT_EQ(DeviceCopy(&v), expected);
+
+  // a write on the device is kept though the host writes another range
+  thrust::device_ptr<float> d(v.DevicePointer(0));
+  d[0] = 100.0f;
+  v.HostRange(9, 10)[0] = 90.0f;
+  expected[0] = 100.0f;
+  expected[9] = 90.0f;
+  EXPECT_EQ(v.ConstHostVector(), expected);
+  EXPECT_EQ(DeviceCopy(&v), expected);
+
+  // the whole host copy written drops the device copy
+  v.HostVector()[4] = 40.0f;
+  expected[4] = 40.0f;
+  v.PrefetchDevices();
+  EXPECT_EQ(DeviceCopy(&v), expected);
+  EXPECT_EQ(v.Size(), 10U);
+}
+
+}  // namespace xgboost
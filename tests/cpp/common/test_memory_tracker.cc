@@ -0,0 +1,74 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../../src/common/hist_util.h"
+#include "../../../src/common/memory_tracker.h"
+
+namespace xgboost {
+namespace common {
+
+TEST(MemoryTracker, TrackedBytes) {
+  MemoryTracker* tracker = MemoryTracker::Get();
+  const int64_t base = tracker->Current(kMemWorkspace);
+  const int64_t base_total = tracker->Total();
+  tracker->ResetPeak();
+  {
+    TrackedBytes a(kMemWorkspace);
+    a.Set(1000);
+    EXPECT_EQ(tracker->Current(kMemWorkspace), base + 1000);
+    TrackedBytes b(a);
+    EXPECT_EQ(tracker->Current(kMemWorkspace), base + 2000);
+    a.Set(200);
+    EXPECT_EQ(tracker->Current(kMemWorkspace), base + 1200);
+    // a moved from one holds nothing
+    TrackedBytes c(std::move(b));
+    EXPECT_EQ(b.Bytes(), 0U);
+    EXPECT_EQ(tracker->Current(kMemWorkspace), base + 1200);
+    EXPECT_EQ(tracker->Peak(kMemWorkspace), base + 2000);
+    EXPECT_EQ(tracker->Total(), base_total + 1200);
+  }
+  EXPECT_EQ(tracker->Current(kMemWorkspace), base);
+  EXPECT_EQ(tracker->Peak(kMemWorkspace), base + 2000);
+  tracker->ResetPeak();
+  EXPECT_EQ(tracker->Peak(kMemWorkspace), base);
+  EXPECT_EQ(tracker->TotalPeak(), tracker->Total());
+}
+
+TEST(MemoryTracker, HistCollection) {
+  MemoryTracker* tracker = MemoryTracker::Get();
+  const int64_t base = tracker->Current(kMemHistogram);
+  const auto row_bytes = static_cast<int64_t>(64 * sizeof(GHistEntry));
+  {
+    HistCollection hist;
+    hist.Init(64);
+    hist.AddHistRow(0);
+    hist.AddHistRow(1);
+    EXPECT_EQ(tracker->Current(kMemHistogram), base + 2 * row_bytes);
+    // the buffer of a freed histogram stays in the pool
+    hist.FreeHistRow(1);
+    hist.AddHistRow(2);
+    EXPECT_EQ(tracker->Current(kMemHistogram), base + 2 * row_bytes);
+    hist.Init(32);
+    EXPECT_EQ(tracker->Current(kMemHistogram), base);
+  }
+  EXPECT_EQ(tracker->Current(kMemHistogram), base);
+}
+
+TEST(MemoryTracker, Json) {
+  const std::string json = MemoryTracker::Get()->Json();
+  for (const char* key : {"\"sparse_page\":{\"current\":", "\"histogram\":{\"current\":",
+                          "\"total\":{\"current\":", "\"rss\":{\"current\":"}) {
+    EXPECT_NE(json.find(key), std::string::npos) << key;
+  }
+  uint64_t rss, peak_rss;
+  MemoryTracker::ReadRSS(&rss, &peak_rss);
+#if defined(__linux__)
+  EXPECT_GT(rss, 0U);
+  EXPECT_GT(peak_rss, 0U);
+#endif
+}
+
+}  // namespace common
+}  // namespace xgboost
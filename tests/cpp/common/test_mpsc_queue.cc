@@ -0,0 +1,53 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "../../../src/common/mpsc_queue.h"
+
+namespace xgboost {
+namespace common {
+
+namespace {
+struct Item : public MPSCQueue::Node {
+  int producer;
+  int seq;
+};
+}  // namespace
+
+TEST(MPSCQueue, ProducersKeepTheirOrder) {
+  const int nproducer = 4, nitem = 1000;
+  // the atomic link of the nodes can not be copied
+  std::vector<std::vector<Item> > items(nproducer);
+  for (auto& producer_items : items) producer_items = std::vector<Item>(nitem);
+  MPSCQueue queue;
+  ASSERT_EQ(queue.Pop(), nullptr);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < nproducer; ++p) {
+    producers.emplace_back([&, p]() {
+      for (int i = 0; i < nitem; ++i) {
+        items[p][i].producer = p;
+        items[p][i].seq = i;
+        queue.Push(&items[p][i]);
+      }
+    });
+  }
+  // the items of each producer come out in the order they were pushed
+  std::vector<int> next(nproducer, 0);
+  int npopped = 0;
+  while (npopped < nproducer * nitem) {
+    MPSCQueue::Node* node = queue.Pop();
+    if (node == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+    const Item& item = *static_cast<Item*>(node);
+    ASSERT_EQ(item.seq, next[item.producer]);
+    ++next[item.producer];
+    ++npopped;
+  }
+  for (std::thread& producer : producers) producer.join();
+  ASSERT_EQ(queue.Pop(), nullptr);
+}
+
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,49 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <vector>
+#include "../../../src/common/node_arena.h"
+
+namespace xgboost {
+namespace common {
+
+namespace {
+struct Record {
+  int value;
+  std::vector<int> buffer;
+  explicit Record(int v) : value(v) {}
+};
+}  // namespace
+
+TEST(NodeArena, ReusesRecords) {
+  NodeArena<Record> arena;
+  arena.Resize(3, Record(1));
+  ASSERT_EQ(arena.Size(), 3U);
+  for (size_t i = 0; i < arena.Size(); ++i) {
+    EXPECT_EQ(arena[i].value, 1);
+    arena[i].value = 5;
+    arena[i].buffer.assign(100, 7);
+  }
+  const Record* first = &arena[0];
+
+  // a new tree resets the records it grows over, keeping their buffers
+  arena.Clear();
+  EXPECT_EQ(arena.Size(), 0U);
+  arena.Resize(2, Record(2));
+  EXPECT_EQ(&arena[0], first);
+  for (size_t i = 0; i < 2; ++i) {
+    EXPECT_EQ(arena[i].value, 2);
+    EXPECT_TRUE(arena[i].buffer.empty());
+    EXPECT_GE(arena[i].buffer.capacity(), 100U);
+  }
+  // slots left by the previous tree and new slots both start from proto
+  arena[1].value = 9;
+  arena.Resize(5, Record(3));
+  EXPECT_EQ(arena[1].value, 9);
+  for (size_t i = 2; i < 5; ++i) {
+    EXPECT_EQ(arena[i].value, 3);
+    EXPECT_TRUE(arena[i].buffer.empty());
+  }
+}
+
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,52 @@
+// Copyright by Contributors
+#include <dmlc/omp.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "../../../src/common/perf_counters.h"
+#include "../../../src/common/timer.h"
+
+namespace xgboost {
+namespace common {
+
+TEST(PerfCounts, Since) {
+  PerfCounts begin, end;
+  begin.value[PerfCounts::kCycles] = 10;
+  end.value[PerfCounts::kCycles] = 25;
+  begin.value[PerfCounts::kLLCMisses] = 7;
+  end.value[PerfCounts::kLLCMisses] = 3;
+  const PerfCounts delta = end.Since(begin);
+  EXPECT_EQ(delta.value[PerfCounts::kCycles], 15U);
+  // counters that went back count nothing
+  EXPECT_EQ(delta.value[PerfCounts::kLLCMisses], 0U);
+  PerfCounts total;
+  total.Add(delta);
+  total.Add(delta);
+  EXPECT_EQ(total.value[PerfCounts::kCycles], 30U);
+}
+
+TEST(Monitor, PerfCounters) {
+  Monitor monitor;
+  monitor.Init("test", true, true);
+  std::vector<double> data(1 << 16, 1.0);
+  double sum = 0.0;
+  monitor.Start("Sum");
+  for (int k = 0; k < 10; ++k) {
+    for (double v : data) sum += v;
+  }
+  monitor.Stop("Sum");
+  EXPECT_EQ(sum, 10.0 * data.size());
+  if (!monitor.perf) return;  // no counters in this environment
+  ASSERT_EQ(monitor.perf_map.count("Sum"), 1U);
+  const std::vector<PerfCounts>& counts = monitor.perf_map["Sum"];
+  EXPECT_EQ(counts.size(), static_cast<size_t>(omp_get_max_threads()));
+  uint64_t instructions = 0;
+  for (const PerfCounts& c : counts) instructions += c.value[PerfCounts::kInstructions];
+  EXPECT_GT(instructions, 0U);
+  const std::string json = monitor.PerfJson();
+  EXPECT_NE(json.find("\"Sum\":{\"seconds\":"), std::string::npos);
+  EXPECT_NE(json.find("\"thread_llc_misses\":["), std::string::npos);
+}
+
+}  // namespace common
+}  // namespace xgboost
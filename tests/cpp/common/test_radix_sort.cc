@@ -0,0 +1,69 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+#include "../../../src/common/math.h"
+#include "../../../src/common/radix_sort.h"
+
+namespace xgboost {
+namespace common {
+
+TEST(RadixSort, FirstDescending) {
+  std::mt19937 rng(1994);
+  std::uniform_real_distribution<float> dist(-4.0f, 4.0f);
+  std::vector<std::pair<float, unsigned> > data;
+  for (unsigned i = 0; i < 100000; ++i) {
+    // a few values repeat, to check that equal keys keep their order
+    const float value = i % 7 == 0 ? 0.5f : dist(rng);
+    data.emplace_back(value, i);
+  }
+  data.emplace_back(-0.0f, 100000);
+  data.emplace_back(0.0f, 100001);
+  std::vector<std::pair<float, unsigned> > expected = data;
+  std::stable_sort(expected.begin(), expected.end(), CmpFirst);
+  std::vector<std::pair<float, unsigned> > scratch;
+  RadixSortFirstDescending(&data, &scratch);
+  ASSERT_EQ(data.size(), expected.size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    ASSERT_EQ(data[i].first, expected[i].first);
+    if (data[i].first != 0.0f) {
+      ASSERT_EQ(data[i].second, expected[i].second);
+    }
+  }
+
+  // probabilities share their top digit, the pass is skipped
+  std::vector<std::pair<float, unsigned> > prob;
+  for (unsigned i = 0; i < 1000; ++i) {
+    prob.emplace_back(static_cast<float>(i % 100) / 100.0f + 0.5f, i);
+  }
+  expected = prob;
+  std::stable_sort(expected.begin(), expected.end(), CmpFirst);
+  RadixSortFirstDescending(&prob, &scratch);
+  EXPECT_EQ(prob, expected);
+}
+
+TEST(RadixSort, EntriesByValue) {
+  std::mt19937 rng(2018);
+  std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+  for (size_t n : {10, 5000}) {
+    std::vector<Entry> data;
+    for (bst_uint i = 0; i < n; ++i) {
+      data.emplace_back(i, i % 5 == 0 ? 1.0f : dist(rng));
+    }
+    std::vector<Entry> expected = data;
+    std::stable_sort(expected.begin(), expected.end(), Entry::CmpValue);
+    std::vector<Entry> scratch(n);
+    SortEntriesByValue(dmlc::BeginPtr(data), dmlc::BeginPtr(data) + n,
+                       dmlc::BeginPtr(scratch));
+    for (size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(data[i].fvalue, expected[i].fvalue);
+      // short ranges are not sorted stably
+      if (n >= 512) ASSERT_EQ(data[i].index, expected[i].index);
+    }
+  }
+}
+
+}  // namespace common
+}  // namespace xgboost
@@ -0,0 +1,35 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include "../../../src/common/strategy_tuner.h"
+
+namespace xgboost {
+namespace common {
+
+TEST(StrategyTuner, Choose) {
+  StrategyTuner tuner(2, 2);
+  // the strategies are tried in turn, timed per unit of work
+  EXPECT_EQ(tuner.Choose(7), 0);
+  EXPECT_FALSE(tuner.Record(7, 0, 1.0, 100.0));
+  EXPECT_EQ(tuner.Choose(7), 1);
+  EXPECT_FALSE(tuner.Record(7, 1, 1.0, 400.0));
+  EXPECT_EQ(tuner.Choose(7), 0);
+  EXPECT_FALSE(tuner.Record(7, 0, 1.0, 100.0));
+  EXPECT_EQ(tuner.Chosen(7), -1);
+  EXPECT_TRUE(tuner.Record(7, tuner.Choose(7), 3.0, 400.0));
+  EXPECT_EQ(tuner.Chosen(7), 1);
+  EXPECT_DOUBLE_EQ(tuner.Cost(7, 0), 0.01);
+  EXPECT_DOUBLE_EQ(tuner.Cost(7, 1), 0.005);
+  // the choice is kept for the rest of the calls
+  EXPECT_FALSE(tuner.Record(7, 1, 100.0, 1.0));
+  EXPECT_EQ(tuner.Choose(7), 1);
+  // other buckets are tuned on their own
+  EXPECT_EQ(tuner.Choose(8), 0);
+  EXPECT_EQ(tuner.Chosen(8), -1);
+  EXPECT_EQ(tuner.Decisions().size(), 1U);
+  EXPECT_EQ(tuner.Decisions().at(7), 1);
+  tuner.Clear();
+  EXPECT_EQ(tuner.Chosen(7), -1);
+}
+
+}  // namespace common
+}  // namespace xgboost
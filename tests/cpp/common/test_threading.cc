@@ -0,0 +1,131 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../../../src/common/threading.h"
+
+namespace xgboost {
+namespace common {
+
+TEST(Threading, OmpThreadScope) {
+  const int before = omp_get_max_threads();
+  {
+    OmpThreadScope threads(1);
+    EXPECT_EQ(omp_get_max_threads(), 1);
+  }
+  EXPECT_EQ(omp_get_max_threads(), before);
+  {
+    OmpThreadScope threads(0);
+    EXPECT_EQ(omp_get_max_threads(), before);
+  }
+  // the limit caps the threads of the thread and those asked for
+  const int limit = ThreadLimit();
+  ThreadLimit() = 1;
+  {
+    OmpThreadScope threads(0);
+    EXPECT_EQ(omp_get_max_threads(), 1);
+    OmpThreadScope inner(4);
+    EXPECT_EQ(omp_get_max_threads(), 1);
+  }
+  EXPECT_EQ(omp_get_max_threads(), before);
+  ThreadLimit() = limit;
+}
+
+namespace {
+// runs each task on a thread of its own
+void SpawnTask(void (*task)(void*), void* arg, void* ctx) {
+  static_cast<std::atomic<int>*>(ctx)->fetch_add(1);
+  std::thread(task, arg).detach();
+}
+
+// each iteration of each schedule runs once, with an id below the threads
+void CheckLoops() {
+  const int nthread = omp_get_max_threads();
+  for (Sched sched : {Sched::Static(), Sched::Static(7), Sched::Dyn(), Sched::Dyn(3),
+                      Sched::Guided()}) {
+    for (size_t n : {0, 1, 5, 1000}) {
+      std::vector<int> seen(n, 0);
+      std::atomic<bool> bad_id(false);
+      ParallelFor(n, sched, [&](size_t i) {
+        const int tid = ThreadId();
+        if (tid < 0 || tid >= nthread) bad_id = true;
+        seen[i] += 1;
+      });
+      EXPECT_FALSE(bad_id.load());
+      for (size_t i = 0; i < n; ++i) EXPECT_EQ(seen[i], 1) << "iteration " << i;
+    }
+  }
+  // a loop inside another runs in the thread of the outer iteration
+  std::vector<int> inner(64 * 16, 0);
+  std::atomic<bool> bad_id(false);
+  ParallelFor(64, [&](size_t i) {
+    ParallelFor(16, [&](size_t j) {
+      if (ThreadId() != 0) bad_id = true;
+      inner[i * 16 + j] += 1;
+    });
+  });
+  EXPECT_FALSE(bad_id.load());
+  for (int v : inner) EXPECT_EQ(v, 1);
+  double sums[2];
+  ParallelSum(10000, sums, [](size_t i, double* out) {
+    out[0] += static_cast<double>(i);
+    out[1] += 1.0;
+  });
+  EXPECT_EQ(sums[0], 10000.0 * 9999.0 / 2);
+  EXPECT_EQ(sums[1], 10000.0);
+}
+}  // namespace
+
+TEST(Threading, ParallelFor) {
+  const ThreadBackend backend = GetThreadBackend();
+  OmpThreadScope threads(4);
+  SetThreadBackend(ThreadBackend::kOpenMP);
+  CheckLoops();
+  SetThreadBackend(ThreadBackend::kPool);
+  CheckLoops();
+  // the callers share the pool
+  std::vector<std::thread> callers;
+  std::atomic<int> failures(0);
+  for (int k = 0; k < 4; ++k) {
+    callers.emplace_back([&failures]() {
+      OmpThreadScope threads(3);
+      std::vector<int> seen(5000, 0);
+      ParallelFor(seen.size(), Sched::Dyn(), [&](size_t i) { seen[i] += 1; });
+      for (int v : seen) {
+        if (v != 1) ++failures;
+      }
+    });
+  }
+  for (auto& t : callers) t.join();
+  EXPECT_EQ(failures.load(), 0);
+  // the first exception is rethrown once the loop is done
+  std::atomic<int> done(0);
+  EXPECT_THROW(ParallelFor(1000, [&](size_t i) {
+    if (i == 10) throw std::runtime_error("stop");
+    ++done;
+  }), std::runtime_error);
+  EXPECT_LT(done.load(), 1000);
+  SetThreadBackend(backend);
+}
+
+TEST(Threading, Executor) {
+  const ThreadBackend backend = GetThreadBackend();
+  OmpThreadScope threads(4);
+  SetExecutor(nullptr, nullptr);
+  EXPECT_EQ(GetThreadBackend(), ThreadBackend::kOpenMP);
+  EXPECT_ANY_THROW(SetThreadBackend(ThreadBackend::kExecutor));
+  std::atomic<int> submitted(0);
+  SetExecutor(SpawnTask, &submitted);
+  EXPECT_EQ(GetThreadBackend(), ThreadBackend::kExecutor);
+  CheckLoops();
+  EXPECT_GT(submitted.load(), 0);
+  SetExecutor(nullptr, nullptr);
+  EXPECT_EQ(ParseThreadBackend("pool"), ThreadBackend::kPool);
+  EXPECT_ANY_THROW(ParseThreadBackend("tbb"));
+  SetThreadBackend(backend);
+}
+
+}  // namespace common
+}  // namespace xgboost
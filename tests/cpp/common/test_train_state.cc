@@ -0,0 +1,51 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/learner.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../helpers.h"
+#include "../../../src/common/io.h"
+#include "../../../src/common/train_state.h"
+
+namespace xgboost {
+TEST(train_state, RestoreMargins) {
+  auto mat = CreateDMatrix(64, 3, 0.0f);
+  std::vector<bst_float>& labels = mat->Info().labels_;
+  labels.resize(mat->Info().num_row_);
+  for (size_t i = 0; i < labels.size(); ++i) labels[i] = static_cast<bst_float>(i % 3);
+  const std::vector<std::pair<std::string, std::string> > cfg{
+    {"max_depth", "2"}, {"silent", "1"}};
+  std::unique_ptr<Learner> learner(Learner::Create({mat}));
+  learner->Configure(cfg);
+  learner->InitModel();
+  for (int iter = 0; iter < 3; ++iter) learner->UpdateOneIter(iter, mat.get());
+  std::string model, state;
+  common::MemoryBufferStream model_out(&model);
+  learner->Save(&model_out);
+  common::MemoryBufferStream state_out(&state);
+  common::TrainState(learner.get(), mat.get()).Save(&state_out);
+  HostDeviceVector<bst_float> expected;
+  learner->Predict(mat.get(), true, &expected);
+
+  std::unique_ptr<Learner> loaded(Learner::Create({mat}));
+  common::MemoryBufferStream model_in(&model);
+  loaded->Load(&model_in);
+  loaded->Configure(cfg);
+  common::TrainState restored(loaded.get(), mat.get());
+  ASSERT_FALSE(restored.Restore());
+  common::MemoryBufferStream state_in(&state);
+  restored.Load(&state_in);
+  ASSERT_TRUE(restored.Restore());
+  HostDeviceVector<bst_float> margin;
+  loaded->Predict(mat.get(), true, &margin);
+  ASSERT_EQ(margin.HostVector(), expected.HostVector());
+
+  // the state of three trees does not match a model of four
+  loaded->UpdateOneIter(3, mat.get());
+  common::MemoryBufferStream state_again(&state);
+  restored.Load(&state_again);
+  ASSERT_FALSE(restored.Restore());
+}
+}  // namespace xgboost
@@ -1,6 +1,7 @@
 // Copyright by Contributors
 #include <xgboost/data.h>
 #include "../../../src/data/simple_csr_source.h"
+#include "../../../src/data/mapped_csr_source.h"
 
 #include "../helpers.h"
 
@@ -30,3 +31,68 @@ TEST(SimpleCSRSource, SaveLoadBinary) {
   EXPECT_EQ(first_row[2].fvalue, first_row_read[2].fvalue);
   row_iter = nullptr; row_iter_read = nullptr;
 }
+
+TEST(SimpleCSRSource, SaveLoadSortedColumn) {
+  std::string tmp_file = CreateSimpleTestData();
+  xgboost::DMatrix * dmat = xgboost::DMatrix::Load(tmp_file, true, false);
+  std::remove(tmp_file.c_str());
+  dmat->InitColAccess(0, true);
+
+  std::string tmp_binfile = TempFileName();
+  dmat->SaveToLocalFile(tmp_binfile);
+  xgboost::DMatrix * dmat_read = xgboost::DMatrix::Load(tmp_binfile, true, false);
+  std::remove(tmp_binfile.c_str());
+
+  // the sorted columns saved with the rows are used as they are
+  dmat_read->InitColAccess(0, true);
+  ASSERT_TRUE(dmat_read->HaveColAccess(true));
+  EXPECT_EQ(dmat_read->BufferedRowset().Size(), dmat->Info().num_row_);
+  auto col_iter = dmat->ColIterator();
+  auto col_iter_read = dmat_read->ColIterator();
+  col_iter->BeforeFirst(); ASSERT_TRUE(col_iter->Next());
+  col_iter_read->BeforeFirst(); ASSERT_TRUE(col_iter_read->Next());
+  const xgboost::SparsePage& page = col_iter->Value();
+  const xgboost::SparsePage& page_read = col_iter_read->Value();
+  ASSERT_EQ(page.Size(), page_read.Size());
+  for (size_t i = 0; i < page.Size(); ++i) {
+    ASSERT_EQ(page[i].length, page_read[i].length);
+    for (size_t j = 0; j < page[i].length; ++j) {
+      EXPECT_EQ(page[i][j].index, page_read[i][j].index);
+      EXPECT_EQ(page[i][j].fvalue, page_read[i][j].fvalue);
+    }
+  }
+  delete dmat;
+  delete dmat_read;
+}
+
+TEST(MappedCSRSource, ReadRows) {
+  std::string tmp_file = CreateSimpleTestData();
+  xgboost::DMatrix * dmat = xgboost::DMatrix::Load(tmp_file, true, false);
+  std::remove(tmp_file.c_str());
+  std::string tmp_binfile = TempFileName();
+  dmat->SaveToLocalFile(tmp_binfile);
+
+  std::unique_ptr<xgboost::data::MappedCSRSource> source(
+      xgboost::data::MappedCSRSource::Open(tmp_binfile));
+  ASSERT_TRUE(source != nullptr);
+  EXPECT_EQ(source->info.num_row_, dmat->Info().num_row_);
+  EXPECT_EQ(source->info.labels_, dmat->Info().labels_);
+  // a second pass gives the same rows
+  for (int pass = 0; pass < 2; ++pass) {
+    auto row_iter = dmat->RowIterator();
+    row_iter->BeforeFirst(); ASSERT_TRUE(row_iter->Next());
+    const xgboost::SparsePage& page = row_iter->Value();
+    source->BeforeFirst(); ASSERT_TRUE(source->Next());
+    const xgboost::SparsePage& page_read = source->Value();
+    ASSERT_EQ(page.Size(), page_read.Size());
+    EXPECT_EQ(page.offset, page_read.offset);
+    for (size_t i = 0; i < page.data.size(); ++i) {
+      EXPECT_EQ(page.data[i].index, page_read.data[i].index);
+      EXPECT_EQ(page.data[i].fvalue, page_read.data[i].fvalue);
+    }
+    EXPECT_FALSE(source->Next());
+  }
+  source.reset();
+  std::remove(tmp_binfile.c_str());
+  delete dmat;
+}
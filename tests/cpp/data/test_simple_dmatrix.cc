@@ -1,6 +1,17 @@
 // Copyright by Contributors
+#include <xgboost/c_api.h>
 #include <xgboost/data.h>
+#include <xgboost/learner.h>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../../src/common/random.h"
+#include "../../../src/data/simple_csr_source.h"
 #include "../../../src/data/simple_dmatrix.h"
+#include "../../../src/gbm/gbtree_model.h"
 
 #include "../helpers.h"
 
@@ -77,3 +88,227 @@ TEST(SimpleDMatrix, ColAccessWithoutBatches) {
   EXPECT_EQ(num_col_batch, 1) << "Expected number of batches to be 1";
   col_iter = nullptr;
 }
+
+TEST(SimpleDMatrix, SortedColumnsOfManyColumns) {
+  // more columns than partition bins, and long columns for the radix sort
+  const int nrow = 1000, ncol = 700;
+  auto dmat = CreateDMatrix(nrow, ncol, 0.1f);
+  std::vector<std::vector<xgboost::Entry> > expected(ncol);
+  auto row_iter = dmat->RowIterator();
+  row_iter->BeforeFirst();
+  while (row_iter->Next()) {
+    const auto& batch = row_iter->Value();
+    for (size_t i = 0; i < batch.Size(); ++i) {
+      auto inst = batch[i];
+      for (xgboost::bst_uint j = 0; j < inst.length; ++j) {
+        expected[inst[j].index].emplace_back(
+            static_cast<xgboost::bst_uint>(batch.base_rowid + i), inst[j].fvalue);
+      }
+    }
+  }
+  for (auto& col : expected) {
+    std::stable_sort(col.begin(), col.end(), xgboost::Entry::CmpValue);
+  }
+
+  dmat->InitColAccess(nrow, true);
+  auto* col_iter = dmat->ColIterator();
+  col_iter->BeforeFirst();
+  ASSERT_TRUE(col_iter->Next());
+  const auto& batch = col_iter->Value();
+  ASSERT_EQ(batch.Size(), static_cast<size_t>(ncol));
+  for (int c = 0; c < ncol; ++c) {
+    auto col = batch[c];
+    ASSERT_EQ(col.length, expected[c].size());
+    for (xgboost::bst_uint k = 0; k < col.length; ++k) {
+      ASSERT_EQ(col[k].index, expected[c][k].index);
+      ASSERT_EQ(col[k].fvalue, expected[c][k].fvalue);
+    }
+  }
+}
+
+TEST(SimpleDMatrix, LazyColumns) {
+  const int nrow = 100, ncol = 20;
+  auto eager = CreateDMatrix(nrow, ncol, 0.3f);
+  auto lazy = CreateDMatrix(nrow, ncol, 0.3f);
+  eager->InitColAccess(nrow, true);
+  const xgboost::SparsePage expected = eager->ColIterator()->Value();
+  auto check_col = [&](const xgboost::SparsePage& batch, size_t fid) {
+    auto col = batch[fid];
+    auto expected_col = expected[fid];
+    ASSERT_EQ(col.length, expected_col.length);
+    for (xgboost::bst_uint k = 0; k < col.length; ++k) {
+      ASSERT_EQ(col[k].index, expected_col[k].index);
+      ASSERT_EQ(col[k].fvalue, expected_col[k].fvalue);
+    }
+  };
+
+  // room for the columns of one request only
+  lazy->InitLazyColAccess(nrow, nrow * sizeof(xgboost::Entry));
+  ASSERT_TRUE(lazy->HaveColAccess(true));
+  for (size_t fid = 0; fid < ncol; ++fid) {
+    EXPECT_EQ(lazy->GetColSize(fid), eager->GetColSize(fid));
+  }
+  auto* iter = lazy->ColIteratorFor({3, 5});
+  ASSERT_TRUE(iter->Next());
+  check_col(iter->Value(), 3);
+  check_col(iter->Value(), 5);
+  EXPECT_EQ(iter->Value()[4].length, 0);
+  EXPECT_FALSE(iter->Next());
+
+  // the columns of the previous request are dropped
+  iter = lazy->ColIteratorFor({7});
+  ASSERT_TRUE(iter->Next());
+  check_col(iter->Value(), 7);
+  EXPECT_EQ(iter->Value()[3].length, 0);
+
+  // all the columns are built by ColIterator
+  iter = lazy->ColIterator();
+  ASSERT_TRUE(iter->Next());
+  for (size_t fid = 0; fid < ncol; ++fid) check_col(iter->Value(), fid);
+}
+
+TEST(SimpleDMatrix, AppendRows) {
+  const int nrow = 300, nappend = 200, ncol = 20;
+  auto dmat = CreateDMatrix(nrow, ncol, 0.2f);
+  auto more = CreateDMatrix(nappend, ncol + 2, 0.2f, 3);
+  // the same rows in one matrix
+  std::unique_ptr<xgboost::data::SimpleCSRSource> source(new xgboost::data::SimpleCSRSource());
+  xgboost::SparsePage rows;
+  auto row_iter = dmat->RowIterator();
+  row_iter->BeforeFirst();
+  while (row_iter->Next()) source->page_.Push(row_iter->Value());
+  row_iter = more->RowIterator();
+  row_iter->BeforeFirst();
+  while (row_iter->Next()) {
+    source->page_.Push(row_iter->Value());
+    rows.Push(row_iter->Value());
+  }
+  source->info.num_row_ = nrow + nappend;
+  source->info.num_col_ = ncol + 2;
+  source->info.num_nonzero_ = source->page_.data.size();
+  std::unique_ptr<xgboost::DMatrix> full(xgboost::DMatrix::Create(std::move(source)));
+  full->InitColAccess(nrow + nappend, true);
+
+  dmat->InitColAccess(nrow, true);
+  dmat->AppendRows(rows, {}, {});
+  EXPECT_EQ(dmat->Info().num_row_, nrow + nappend);
+  EXPECT_EQ(dmat->Info().num_col_, ncol + 2);
+  EXPECT_EQ(dmat->Info().num_nonzero_, full->Info().num_nonzero_);
+  EXPECT_EQ(dmat->BufferedRowset().Size(), static_cast<size_t>(nrow + nappend));
+  ASSERT_TRUE(dmat->HaveColAccess(true));
+  const xgboost::SparsePage& merged = dmat->ColIterator()->Value();
+  const xgboost::SparsePage& expected = full->ColIterator()->Value();
+  ASSERT_EQ(merged.Size(), expected.Size());
+  for (size_t fid = 0; fid < expected.Size(); ++fid) {
+    auto col = merged[fid];
+    auto expected_col = expected[fid];
+    ASSERT_EQ(col.length, expected_col.length);
+    for (xgboost::bst_uint k = 0; k < col.length; ++k) {
+      ASSERT_EQ(col[k].index, expected_col[k].index);
+      ASSERT_EQ(col[k].fvalue, expected_col[k].fvalue);
+    }
+  }
+  // the labels must come with the rows iff the matrix has them
+  EXPECT_ANY_THROW(dmat->AppendRows(rows, std::vector<float>(nappend, 1.0f), {}));
+}
+
+TEST(SimpleDMatrix, FeatureMap) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  // columns: constant, missing, constant where present, varying, constant zero
+  std::vector<float> data = {
+    1.0f, nan, 2.0f, 0.5f, 0.0f,
+    1.0f, nan, nan,  1.5f, 0.0f,
+    1.0f, nan, 2.0f, 0.5f, 0.0f};
+  DMatrixHandle handle;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), 3, 5, nan, &handle), 0);
+  auto dmat = *static_cast<std::shared_ptr<xgboost::DMatrix>*>(handle);
+  dmat->InitFeatureMap(false);
+  const xgboost::MetaInfo& info = dmat->Info();
+  EXPECT_EQ(info.feature_map_, std::vector<xgboost::bst_uint>({2, 3}));
+  EXPECT_FALSE(info.IsSplitFeature(0));
+  EXPECT_TRUE(info.IsSplitFeature(2));
+
+  // the ids are kept in the trees
+  std::vector<std::pair<std::string, std::string> > args {
+    {"tree_method", "exact"}, {"max_depth", "2"}, {"min_child_weight", "0"}, {"silent", "1"}};
+  std::vector<float> labels = {0.0f, 1.0f, 0.0f};
+  dmat->Info().labels_ = labels;
+  std::unique_ptr<xgboost::Learner> learner(xgboost::Learner::Create({dmat}));
+  learner->Configure(args);
+  learner->InitModel();
+  learner->UpdateOneIter(0, dmat.get());
+  const auto* model = learner->GetGradientBooster()->GetTreeModel();
+  ASSERT_TRUE(model != nullptr);
+  const xgboost::RegTree& tree = *model->trees[0];
+  ASSERT_FALSE(tree[0].IsLeaf());
+  EXPECT_TRUE(tree[0].SplitIndex() == 2 || tree[0].SplitIndex() == 3);
+  delete static_cast<std::shared_ptr<xgboost::DMatrix>*>(handle);
+}
+
+TEST(SimpleDMatrix, WideRowIds) {
+  // a page of three rows past 2^32, the rows before it are empty
+  const uint64_t base = static_cast<uint64_t>(std::numeric_limits<xgboost::bst_uint>::max()) + 1;
+  std::unique_ptr<xgboost::data::SimpleCSRSource> source(
+      new xgboost::data::SimpleCSRSource());
+  source->page_.offset = {0, 2, 3, 5};
+  source->page_.data = {xgboost::Entry(0, 3.0f), xgboost::Entry(1, 1.0f),
+                        xgboost::Entry(0, 1.0f),
+                        xgboost::Entry(0, 2.0f), xgboost::Entry(1, 0.5f)};
+  source->page_.base_rowid = base;
+  source->info.num_row_ = base + 3;
+  source->info.num_col_ = 2;
+  source->info.num_nonzero_ = 5;
+  std::unique_ptr<xgboost::DMatrix> dmat(xgboost::DMatrix::Create(std::move(source)));
+  ASSERT_TRUE(dmat->WideRowIds());
+  dmat->InitColAccess(std::numeric_limits<size_t>::max(), true);
+  ASSERT_TRUE(dmat->HaveColAccess(true));
+  // the row ids are not wrapped around by the 32 bit accessors
+  EXPECT_ANY_THROW(dmat->ColIterator());
+  EXPECT_ANY_THROW(dmat->BufferedRowset());
+  const xgboost::RowSet64& rowset = dmat->BufferedRowset64();
+  ASSERT_EQ(rowset.Size(), 3U);
+  EXPECT_EQ(rowset[0], base);
+  EXPECT_EQ(rowset[2], base + 2);
+  EXPECT_EQ(dmat->GetColSize(1), 2U);
+
+  auto iter = dmat->ColIterator64();
+  ASSERT_TRUE(iter->Next());
+  const xgboost::SparsePage64& page = iter->Value();
+  ASSERT_EQ(page.Size(), 2U);
+  auto col = page[0];
+  ASSERT_EQ(col.length, 3U);
+  EXPECT_EQ(col[0].index, base + 1);
+  EXPECT_EQ(col[1].index, base + 2);
+  EXPECT_EQ(col[2].index, base);
+  EXPECT_EQ(col[2].fvalue, 3.0f);
+  ASSERT_EQ(page[1].length, 2U);
+  EXPECT_EQ(page[1][0].index, base + 2);
+  EXPECT_EQ(page[1][1].index, base);
+  EXPECT_FALSE(iter->Next());
+}
+
+TEST(SimpleDMatrix, WideRowIdsTrain) {
+  // the exact updater grows the same trees on the columns of 64 bit row ids
+  std::vector<std::pair<std::string, std::string> > args {
+    {"tree_method", "exact"}, {"max_depth", "4"}, {"silent", "1"}};
+  std::vector<std::vector<float> > preds;
+  for (bool wide : {false, true}) {
+    auto dmat = CreateDMatrix(200, 5, 0.2f, 3);
+    if (wide) dynamic_cast<xgboost::data::SimpleDMatrix*>(dmat.get())->UseWideRowIds();
+    std::vector<float>& labels = dmat->Info().labels_;
+    labels.resize(200);
+    for (size_t i = 0; i < labels.size(); ++i) labels[i] = static_cast<float>(i % 3);
+    xgboost::common::GlobalRandom().seed(0);
+    std::unique_ptr<xgboost::Learner> learner(xgboost::Learner::Create({dmat}));
+    learner->Configure(args);
+    learner->InitModel();
+    for (int iter = 0; iter < 3; ++iter) learner->UpdateOneIter(iter, dmat.get());
+    EXPECT_EQ(dmat->WideRowIds(), wide);
+    EXPECT_EQ(dmat->HaveColAccess(true), true);
+    xgboost::HostDeviceVector<float> out;
+    learner->Predict(dmat.get(), false, &out);
+    preds.push_back(out.HostVector());
+  }
+  ASSERT_EQ(preds[0].size(), preds[1].size());
+  for (size_t i = 0; i < preds[0].size(); ++i) EXPECT_FLOAT_EQ(preds[0][i], preds[1][i]);
+}
@@ -85,3 +85,30 @@ TEST(SparsePageDMatrix, ColAcess) {
   std::remove((tmp_file + ".cache.col.page").c_str());
   std::remove((tmp_file + ".cache.row.page").c_str());
 }
+
+TEST(SparsePageDMatrix, RowAccessRestart) {
+  std::string tmp_file = CreateBigTestData(300);
+  xgboost::DMatrix * dmat = xgboost::DMatrix::Load(
+    tmp_file + "#" + tmp_file + ".cache", true, false);
+  std::remove(tmp_file.c_str());
+
+  // a pass stopped after its first page starts over, and a repeated
+  // BeforeFirst does not skip a page
+  auto row_iter = dmat->RowIterator();
+  ASSERT_TRUE(row_iter->Next());
+  for (int pass = 0; pass < 2; ++pass) {
+    row_iter = dmat->RowIterator();
+    row_iter->BeforeFirst();
+    size_t row_count = 0;
+    while (row_iter->Next()) {
+      EXPECT_EQ(row_iter->Value().base_rowid, row_count);
+      row_count += row_iter->Value().Size();
+    }
+    EXPECT_EQ(row_count, dmat->Info().num_row_);
+  }
+  row_iter = nullptr;
+  delete dmat;
+
+  std::remove((tmp_file + ".cache").c_str());
+  std::remove((tmp_file + ".cache.row.page").c_str());
+}
@@ -0,0 +1,60 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/data.h>
+#include <dmlc/io.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../helpers.h"
+#include "../../../src/data/sparse_page_writer.h"
+
+namespace xgboost {
+namespace data {
+
+TEST(SparsePageWriter, ParallelEncodeKeepsOrder) {
+  const std::string prefix = TempFileName();
+  const std::vector<std::string> name_shards = {prefix + ".0.page", prefix + ".1.page"};
+  const size_t npage = 40;
+  {
+    // three encoders for each of the two shards
+    SparsePageWriter writer(name_shards, {"raw", "raw"}, 2, 3);
+    for (size_t i = 0; i < npage; ++i) {
+      std::shared_ptr<SparsePage> page;
+      writer.Alloc(&page);
+      page->Clear();
+      // pages of different sizes, so that they take different times to encode
+      std::vector<Entry> entries;
+      for (size_t j = 0; j < 1 + (i * 7) % 13; ++j) {
+        entries.emplace_back(static_cast<bst_uint>(j), static_cast<bst_float>(i));
+      }
+      page->Push(SparsePage::Inst(entries.data(), static_cast<bst_uint>(entries.size())));
+      writer.PushWrite(std::move(page));
+    }
+    EXPECT_EQ(writer.PageSize(123), 123U);
+  }
+  // the pages are striped over the shards in the order they were pushed
+  for (size_t s = 0; s < name_shards.size(); ++s) {
+    std::unique_ptr<dmlc::SeekStream> fi(
+        dmlc::SeekStream::CreateForRead(name_shards[s].c_str()));
+    std::string format;
+    ASSERT_TRUE(fi->Read(&format));
+    ASSERT_EQ(format, "raw");
+    std::unique_ptr<SparsePageFormat> fmt(SparsePageFormat::Create(format));
+    SparsePage page;
+    size_t i = s;
+    while (fmt->Read(&page, fi.get())) {
+      ASSERT_LT(i, npage);
+      ASSERT_EQ(page.Size(), 1U);
+      EXPECT_EQ(page.data.size(), 1 + (i * 7) % 13);
+      EXPECT_EQ(page.data[0].fvalue, static_cast<bst_float>(i));
+      i += name_shards.size();
+    }
+    EXPECT_EQ(i - s, npage);
+    fi.reset(nullptr);
+    std::remove(name_shards[s].c_str());
+  }
+}
+
+}  // namespace data
+}  // namespace xgboost
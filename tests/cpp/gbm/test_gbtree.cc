@@ -0,0 +1,271 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/gbm.h>
+#include <xgboost/predictor.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../helpers.h"
+#include "../../../src/common/io.h"
+#include "../../../src/common/random.h"
+#include "../../../src/gbm/gbtree_model.h"
+
+namespace xgboost {
+// the predictions of a dart booster with and without the margin cache
+static std::vector<std::vector<bst_float> > DartPredictions(
+    std::shared_ptr<DMatrix> mat, bool cached, int nround) {
+  std::vector<std::shared_ptr<DMatrix> > cache;
+  if (cached) cache.push_back(mat);
+  std::unique_ptr<GradientBooster> gbm(GradientBooster::Create("dart", cache, 0.5f));
+  gbm->Configure({{"num_feature", std::to_string(mat->Info().num_col_)},
+                  {"rate_drop", "0.5"}, {"max_depth", "2"}, {"silent", "1"}});
+  common::GlobalRandom().seed(7);
+  std::vector<std::vector<bst_float> > result;
+  HostDeviceVector<bst_float> preds;
+  for (int r = 0; r < nround; ++r) {
+    gbm->PredictBatch(mat.get(), &preds, 0);
+    result.push_back(preds.HostVector());
+    std::vector<GradientPair> gpair(mat->Info().num_row_);
+    for (size_t i = 0; i < gpair.size(); ++i) {
+      gpair[i] = GradientPair(static_cast<float>((i * (r + 3)) % 5) - 2.0f, 1.0f);
+    }
+    HostDeviceVector<GradientPair> gpair_d(gpair);
+    gbm->DoBoost(mat.get(), &gpair_d);
+  }
+  return result;
+}
+
+TEST(gbtree, DartMarginCache) {
+  auto mat = CreateDMatrix(64, 4, 0.2f);
+  mat->InitColAccess(1 << 16, false);
+  const int nround = 12;
+  // the same trees are dropped and grown, only the sums are kept otherwise
+  auto cached = DartPredictions(mat, true, nround);
+  auto recomputed = DartPredictions(mat, false, nround);
+  for (int r = 0; r < nround; ++r) {
+    ASSERT_EQ(cached[r].size(), recomputed[r].size());
+    for (size_t i = 0; i < cached[r].size(); ++i) {
+      ASSERT_NEAR(cached[r][i], recomputed[r][i], 1e-4f);
+    }
+  }
+}
+
+// the predictions of a gbtree of multi output trees of 3 groups
+static std::vector<std::vector<bst_float> > MultiOutputPredictions(
+    std::shared_ptr<DMatrix> mat, bool cached, int nround, size_t* ntree) {
+  const int ngroup = 3;
+  std::vector<std::shared_ptr<DMatrix> > cache;
+  if (cached) cache.push_back(mat);
+  std::unique_ptr<GradientBooster> gbm(GradientBooster::Create("gbtree", cache, 0.5f));
+  gbm->Configure({{"num_feature", std::to_string(mat->Info().num_col_)},
+                  {"num_output_group", std::to_string(ngroup)},
+                  {"multi_output_tree", "1"}, {"max_depth", "3"}, {"silent", "1"}});
+  std::vector<std::vector<bst_float> > result;
+  HostDeviceVector<bst_float> preds;
+  for (int r = 0; r < nround; ++r) {
+    gbm->PredictBatch(mat.get(), &preds, 0);
+    result.push_back(preds.HostVector());
+    std::vector<GradientPair> gpair(mat->Info().num_row_ * ngroup);
+    for (size_t i = 0; i < gpair.size(); ++i) {
+      gpair[i] = GradientPair(static_cast<float>((i * (r + 3)) % 7) - 3.0f, 1.0f);
+    }
+    HostDeviceVector<GradientPair> gpair_d(gpair);
+    gbm->DoBoost(mat.get(), &gpair_d);
+  }
+  *ntree = gbm->GetTreeModel()->trees.size();
+  return result;
+}
+
+TEST(gbtree, MultiOutputTreeCache) {
+  auto mat = CreateDMatrix(64, 4, 0.2f);
+  mat->InitColAccess(1 << 16, false);
+  const int nround = 6;
+  size_t ntree_cached, ntree_recomputed;
+  // the updater adds the leaf vectors of the rows to the cached margins
+  auto cached = MultiOutputPredictions(mat, true, nround, &ntree_cached);
+  auto recomputed = MultiOutputPredictions(mat, false, nround, &ntree_recomputed);
+  ASSERT_EQ(ntree_cached, static_cast<size_t>(nround));
+  ASSERT_EQ(ntree_recomputed, static_cast<size_t>(nround));
+  for (int r = 0; r < nround; ++r) {
+    ASSERT_EQ(cached[r].size(), recomputed[r].size());
+    for (size_t i = 0; i < cached[r].size(); ++i) {
+      ASSERT_NEAR(cached[r][i], recomputed[r][i], 1e-4f);
+    }
+  }
+  // the groups get weights of their own
+  const std::vector<bst_float>& last = cached.back();
+  bool differ = false;
+  for (size_t i = 0; i < last.size(); i += 3) {
+    differ = differ || last[i] != last[i + 1] || last[i] != last[i + 2];
+  }
+  ASSERT_TRUE(differ);
+}
+
+TEST(gbtree, ReconfigureKeepsCache) {
+  auto mat = CreateDMatrix(64, 4, 0.2f);
+  mat->InitColAccess(1 << 16, false);
+  std::vector<std::shared_ptr<DMatrix> > cache = {mat};
+  std::unique_ptr<GradientBooster> gbm(GradientBooster::Create("gbtree", cache, 0.5f));
+  std::vector<std::pair<std::string, std::string> > cfg = {
+    {"num_feature", std::to_string(mat->Info().num_col_)},
+    {"max_depth", "2"}, {"silent", "1"}};
+  // the margins of the cache against those of all the trees predicted again
+  std::unique_ptr<Predictor> predictor(Predictor::Create("cpu_predictor"));
+  predictor->Init({}, {});
+  HostDeviceVector<bst_float> cached, recomputed;
+  const int nround = 8;
+  for (int r = 0; r < nround; ++r) {
+    // the same parameters for two rounds, then a changed one
+    cfg[1].second = r % 4 < 2 ? "2" : "3";
+    gbm->Configure(cfg);
+    gbm->PredictBatch(mat.get(), &cached, 0);
+    predictor->PredictBatch(mat.get(), &recomputed, *gbm->GetTreeModel(), 0);
+    ASSERT_EQ(cached.Size(), recomputed.Size());
+    for (size_t i = 0; i < cached.Size(); ++i) {
+      ASSERT_NEAR(cached.HostVector()[i], recomputed.HostVector()[i], 1e-4f);
+    }
+    std::vector<GradientPair> gpair(mat->Info().num_row_);
+    for (size_t i = 0; i < gpair.size(); ++i) {
+      gpair[i] = GradientPair(static_cast<float>((i * (r + 3)) % 5) - 2.0f, 1.0f);
+    }
+    HostDeviceVector<GradientPair> gpair_d(gpair);
+    gbm->DoBoost(mat.get(), &gpair_d);
+  }
+  // the new trees take the parameters of the configuration of their round
+  const auto& trees = gbm->GetTreeModel()->trees;
+  ASSERT_EQ(trees.size(), static_cast<size_t>(nround));
+  for (size_t i = 0; i < trees.size(); ++i) {
+    EXPECT_EQ(trees[i]->param.num_feature, static_cast<int>(mat->Info().num_col_));
+    EXPECT_LE(trees[i]->MaxDepth(), i % 4 < 2 ? 2 : 3);
+  }
+}
+
+// the dump of a gbtree of 3 groups trained on subsamples from a fixed seed
+static std::vector<std::string> SubsampledDump(
+    std::shared_ptr<DMatrix> mat,
+    std::vector<std::pair<std::string, std::string> > cfg) {
+  const int ngroup = 3;
+  std::unique_ptr<GradientBooster> gbm(GradientBooster::Create("gbtree", {}, 0.5f));
+  cfg.emplace_back("num_feature", std::to_string(mat->Info().num_col_));
+  cfg.emplace_back("num_output_group", std::to_string(ngroup));
+  cfg.emplace_back("subsample", "0.5");
+  cfg.emplace_back("max_depth", "3");
+  cfg.emplace_back("silent", "1");
+  gbm->Configure(cfg);
+  common::GlobalRandom().seed(11);
+  for (int r = 0; r < 3; ++r) {
+    std::vector<GradientPair> gpair(mat->Info().num_row_ * ngroup);
+    for (size_t i = 0; i < gpair.size(); ++i) {
+      gpair[i] = GradientPair(static_cast<float>((i * (r + 3)) % 7) - 3.0f, 1.0f);
+    }
+    HostDeviceVector<GradientPair> gpair_d(gpair);
+    gbm->DoBoost(mat.get(), &gpair_d);
+  }
+  return gbm->DumpModel(FeatureMap(), true, "text");
+}
+
+TEST(gbtree, ConcurrentTreesReproducible) {
+  auto mat = CreateDMatrix(256, 4, 0.2f);
+  mat->InitColAccess(1 << 16, false);
+  // the groups and the trees of a forest grown on the pool threads sample
+  // from seeds drawn on the calling thread, whichever thread grows them
+  const std::vector<std::vector<std::pair<std::string, std::string> > > cfgs = {
+    {{"parallel_groups", "1"}},
+    {{"parallel_forest", "1"}, {"num_parallel_tree", "4"}}};
+  for (const auto& cfg : cfgs) {
+    auto first = SubsampledDump(mat, cfg);
+    for (int run = 0; run < 3; ++run) {
+      ASSERT_EQ(SubsampledDump(mat, cfg), first);
+    }
+  }
+}
+
+// a stump of feature fid with the statistics of its split
+static void AddStatStump(unsigned fid, bst_float loss_chg, bst_float sum_hess,
+                         gbm::GBTreeModel* model) {
+  std::vector<std::unique_ptr<RegTree> > trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  RegTree& tree = *trees.back();
+  tree.InitModel();
+  tree.AddChilds(0);
+  tree[0].SetSplit(fid, 0.5f, true);
+  tree.Stat(0).loss_chg = loss_chg;
+  tree.Stat(0).sum_hess = sum_hess;
+  tree[tree[0].LeftChild()].SetLeaf(1.0f);
+  tree[tree[0].RightChild()].SetLeaf(-1.0f);
+  model->CommitModel(std::move(trees), 0);
+}
+
+TEST(gbtree, FeatureImportance) {
+  gbm::GBTreeModel model(0.5f);
+  model.param.num_feature = 4;
+  model.param.num_output_group = 1;
+  AddStatStump(2, 3.0f, 10.0f, &model);
+  AddStatStump(0, 1.5f, 4.0f, &model);
+  AddStatStump(2, 0.5f, 6.0f, &model);
+  const gbm::FeatureImportance& imp = model.GetImportance();
+  ASSERT_EQ(imp.count.size(), 3U);
+  EXPECT_EQ(imp.count[0], 1U);
+  EXPECT_EQ(imp.count[1], 0U);
+  EXPECT_EQ(imp.count[2], 2U);
+  EXPECT_EQ(imp.gain[2], 3.5);
+  EXPECT_EQ(imp.cover[2], 16.0);
+  EXPECT_EQ(imp.gain[0], 1.5);
+  // rebuilt from the node statistics of a loaded model
+  std::string buffer;
+  common::MemoryBufferStream fo(&buffer);
+  model.Save(&fo);
+  gbm::GBTreeModel loaded(0.5f);
+  common::MemoryBufferStream fi(&buffer);
+  loaded.Load(&fi);
+  EXPECT_EQ(loaded.GetImportance().count, imp.count);
+  EXPECT_EQ(loaded.GetImportance().gain, imp.gain);
+  EXPECT_EQ(loaded.GetImportance().cover, imp.cover);
+  // the trees of an update are committed again
+  model.InitTreesToUpdate();
+  EXPECT_EQ(model.GetImportance().count.size(), 0U);
+}
+
+TEST(gbtree, PackedLayoutLoad) {
+  gbm::GBTreeModel model(0.5f);
+  model.param.num_feature = 4;
+  model.param.num_output_group = 1;
+  AddStatStump(2, 3.0f, 10.0f, &model);
+  AddStatStump(0, 1.5f, 4.0f, &model);
+  std::string classic, packed;
+  common::MemoryBufferStream fc(&classic);
+  model.Save(&fc);
+  common::MemoryBufferStream fp(&packed);
+  model.SavePacked(&fp);
+  // the packed arrays are loaded without the trees
+  gbm::GBTreeModel loaded(0.5f);
+  common::MemoryBufferStream fi(&packed);
+  loaded.Load(&fi);
+  EXPECT_EQ(loaded.param.num_trees, 2);
+  EXPECT_EQ(loaded.trees.size(), 0U);
+  const gbm::PackedForest& forest = loaded.GetPackedForest();
+  const gbm::PackedForest& expected = model.GetPackedForest();
+  EXPECT_EQ(forest.split_index, expected.split_index);
+  EXPECT_EQ(forest.split_cond, expected.split_cond);
+  EXPECT_EQ(forest.children, expected.children);
+  EXPECT_EQ(forest.leaf_value, expected.leaf_value);
+  EXPECT_EQ(forest.tree_root, expected.tree_root);
+  EXPECT_EQ(loaded.tree_info, model.tree_info);
+  // saved again without building the trees
+  std::string repacked;
+  common::MemoryBufferStream fr(&repacked);
+  loaded.SavePacked(&fr);
+  EXPECT_EQ(repacked, packed);
+  // the trees built on first use are those saved, and keep the packed arrays
+  EXPECT_EQ(loaded.GetImportance().count, model.GetImportance().count);
+  ASSERT_EQ(loaded.trees.size(), 2U);
+  EXPECT_EQ(loaded.GetPackedForest().tree_root.size(), 2U);
+  std::string rebuilt;
+  common::MemoryBufferStream fb(&rebuilt);
+  loaded.Save(&fb);
+  EXPECT_EQ(rebuilt, classic);
+  AddStatStump(1, 0.5f, 2.0f, &loaded);
+  EXPECT_EQ(loaded.GetPackedForest().tree_root.size(), 3U);
+}
+}  // namespace xgboost
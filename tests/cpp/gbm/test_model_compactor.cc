@@ -0,0 +1,137 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/tree_model.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../../../src/gbm/model_compactor.h"
+
+namespace xgboost {
+namespace gbm {
+
+// a split of feature 0 whose left child splits feature 1 into two leaves of
+// the same value; pruned adds two children to the right leaf and deletes them
+static void AddTree(bst_float left, bst_float right, bool pruned, GBTreeModel* model) {
+  std::vector<std::unique_ptr<RegTree> > trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  RegTree& tree = *trees.back();
+  tree.InitModel();
+  tree.AddChilds(0);
+  tree[0].SetSplit(0, 0.5f, true);
+  const int lid = tree[0].LeftChild();
+  const int rid = tree[0].RightChild();
+  tree.AddChilds(lid);
+  tree[lid].SetSplit(1, 0.3f, false);
+  tree[tree[lid].LeftChild()].SetLeaf(left);
+  tree[tree[lid].RightChild()].SetLeaf(left);
+  tree[rid].SetLeaf(right);
+  if (pruned) {
+    tree.AddChilds(rid);
+    tree[rid].SetSplit(1, 0.8f, false);
+    tree[tree[rid].LeftChild()].SetLeaf(0.0f);
+    tree[tree[rid].RightChild()].SetLeaf(0.0f);
+    tree.ChangeToLeaf(rid, right);
+  }
+  model->CommitModel(std::move(trees), 0);
+}
+
+// a stump of feature 1
+static void AddStump(bst_float left, bst_float right, GBTreeModel* model) {
+  std::vector<std::unique_ptr<RegTree> > trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  RegTree& tree = *trees.back();
+  tree.InitModel();
+  tree.AddChilds(0);
+  tree[0].SetSplit(1, 0.3f, true);
+  tree[tree[0].LeftChild()].SetLeaf(left);
+  tree[tree[0].RightChild()].SetLeaf(right);
+  model->CommitModel(std::move(trees), 0);
+}
+
+static std::unique_ptr<GBTreeModel> MakeModel() {
+  std::unique_ptr<GBTreeModel> model(new GBTreeModel(0.5f));
+  model->param.num_feature = 2;
+  model->param.num_output_group = 1;
+  AddTree(1.0f, -1.0f, true, model.get());
+  AddStump(0.5f, -0.5f, model.get());
+  AddTree(1.0f, -1.0f, false, model.get());
+  AddTree(0.25f, 2.0f, false, model.get());
+  return model;
+}
+
+// the margins of the rows of two features, -1 marking a missing value
+static std::vector<bst_float> Margins(const GBTreeModel& model) {
+  const std::vector<bst_float> rows = {0.2f, 0.1f, 0.2f, 0.6f, 0.7f, 0.1f,
+                                       0.7f, 0.9f, -1.0f, 0.6f, 0.7f, -1.0f};
+  std::vector<bst_float> out;
+  RegTree::FVec feat;
+  feat.Init(2);
+  for (size_t i = 0; i < rows.size(); i += 2) {
+    feat.FillDense(&rows[i], 2, -1.0f);
+    bst_float margin = model.base_margin;
+    for (const auto& tree : model.trees) margin += tree->Predict(feat);
+    out.push_back(margin);
+  }
+  return out;
+}
+
+TEST(ModelCompactor, MergeLeaves) {
+  std::unique_ptr<GBTreeModel> model = MakeModel();
+  const std::vector<bst_float> margins = Margins(*model);
+  CompactParam param;
+  param.InitAllowUnknown(std::vector<std::pair<std::string, std::string> >());
+  CompactStats stats;
+  CompactModel(param, model.get(), &stats);
+  EXPECT_EQ(stats.num_trees_before, 4U);
+  EXPECT_EQ(stats.num_trees_after, 4U);
+  EXPECT_EQ(stats.num_nodes_before, 7U + 3U + 5U + 5U);
+  EXPECT_EQ(stats.num_nodes_after, 4U * 3U);
+  EXPECT_EQ(stats.num_merged, 3U);
+  ASSERT_EQ(model->param.num_trees, 4);
+  for (const auto& tree : model->trees) {
+    EXPECT_EQ(tree->param.num_deleted, 0);
+    EXPECT_TRUE((*tree)[1].IsLeaf());
+  }
+  EXPECT_TRUE((*model->trees[0])[0].DefaultLeft());
+  EXPECT_EQ((*model->trees[3])[1].LeafValue(), 0.25f);
+  // the trees are not summed, so the margins keep their bits
+  const std::vector<bst_float> compacted = Margins(*model);
+  for (size_t i = 0; i < margins.size(); ++i) {
+    EXPECT_EQ(compacted[i], margins[i]);
+  }
+}
+
+TEST(ModelCompactor, FoldTrees) {
+  std::unique_ptr<GBTreeModel> model = MakeModel();
+  const std::vector<bst_float> margins = Margins(*model);
+  CompactParam param;
+  param.InitAllowUnknown(std::vector<std::pair<std::string, std::string> >{
+      {"compact_fold", "identical"}});
+  CompactStats stats;
+  CompactModel(param, model.get(), &stats);
+  // the third tree is the first one without its deleted nodes
+  ASSERT_EQ(stats.num_trees_after, 3U);
+  EXPECT_EQ((*model->trees[0])[1].LeafValue(), 2.0f);
+  EXPECT_EQ((*model->trees[0])[2].LeafValue(), -2.0f);
+  std::vector<bst_float> folded = Margins(*model);
+  for (size_t i = 0; i < margins.size(); ++i) {
+    EXPECT_NEAR(folded[i], margins[i], 1e-6f);
+  }
+
+  param.InitAllowUnknown(std::vector<std::pair<std::string, std::string> >{
+      {"compact_fold", "structure"}});
+  CompactModel(param, model.get(), &stats);
+  ASSERT_EQ(stats.num_trees_after, 2U);
+  ASSERT_EQ(model->tree_info.size(), 2U);
+  EXPECT_EQ((*model->trees[0])[1].LeafValue(), 2.25f);
+  EXPECT_EQ((*model->trees[0])[2].LeafValue(), 0.0f);
+  EXPECT_EQ((*model->trees[1])[0].SplitIndex(), 1U);
+  folded = Margins(*model);
+  for (size_t i = 0; i < margins.size(); ++i) {
+    EXPECT_NEAR(folded[i], margins[i], 1e-6f);
+  }
+}
+
+}  // namespace gbm
+}  // namespace xgboost
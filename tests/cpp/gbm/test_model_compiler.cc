@@ -0,0 +1,116 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/c_api.h>
+#include <xgboost/learner.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../helpers.h"
+#include "../../../src/gbm/model_compiler.h"
+
+namespace xgboost {
+namespace gbm {
+
+// reads nrow and the rows from argv[1], writes the margins to argv[2]
+static const char* kDriver =
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "int main(int argc, char** argv) {\n"
+    "  FILE* fi = fopen(argv[1], \"rb\");\n"
+    "  FILE* fo = fopen(argv[2], \"wb\");\n"
+    "  size_t nrow;\n"
+    "  float *x, *out;\n"
+    "  if (argc != 3 || fi == NULL || fo == NULL) return 1;\n"
+    "  if (fread(&nrow, sizeof(nrow), 1, fi) != 1) return 1;\n"
+    "  x = (float*)malloc(nrow * num_feature() * sizeof(float));\n"
+    "  out = (float*)malloc(nrow * num_output_group() * sizeof(float));\n"
+    "  if (fread(x, sizeof(float), nrow * num_feature(), fi)\n"
+    "      != nrow * num_feature()) return 1;\n"
+    "  predict_batch(x, nrow, out);\n"
+    "  fwrite(out, sizeof(float), nrow * num_output_group(), fo);\n"
+    "  fclose(fi);\n"
+    "  fclose(fo);\n"
+    "  return 0;\n"
+    "}\n";
+
+TEST(ModelCompiler, MatchesPredict) {
+  if (std::system("cc --version > /dev/null 2>&1") != 0) {
+    LOG(CONSOLE) << "no C compiler found, skipping";
+    return;
+  }
+  const size_t n_row = 128, n_col = 4;
+  const int n_class = 3;
+  const bst_float kNaN = std::numeric_limits<bst_float>::quiet_NaN();
+  std::vector<bst_float> data(n_row * n_col);
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<bst_float> dis(0.0f, 1.0f);
+  for (auto& e : data) e = dis(gen) < 0.2f ? kNaN : dis(gen);
+  DMatrixHandle handle;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), n_row, n_col, kNaN, &handle), 0);
+  std::shared_ptr<DMatrix> mat = *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  std::vector<bst_float>& labels = mat->Info().labels_;
+  labels.resize(n_row);
+  for (size_t i = 0; i < n_row; ++i) {
+    const bst_float x0 = data[i * n_col], x1 = data[i * n_col + 1];
+    // missing values take part in the splits, so the default branches are tested
+    labels[i] = std::isnan(x0) ? 2.0f : (x0 + (std::isnan(x1) ? 0.5f : x1) > 1.0f ? 1.0f : 0.0f);
+  }
+  const std::vector<std::pair<std::string, std::string> > cfg{
+    {"tree_method", "exact"}, {"objective", "multi:softprob"},
+    {"num_class", std::to_string(n_class)}, {"max_depth", "3"},
+    {"base_score", "0.3"}, {"silent", "1"}};
+  std::unique_ptr<Learner> learner(Learner::Create({mat}));
+  learner->Configure(cfg);
+  learner->InitModel();
+  for (int iter = 0; iter < 4; ++iter) learner->UpdateOneIter(iter, mat.get());
+  HostDeviceVector<bst_float> preds;
+  learner->Predict(mat.get(), true, &preds);
+  const GBTreeModel* model = learner->GetGradientBooster()->GetTreeModel();
+  ASSERT_NE(model, nullptr);
+
+  const std::string source = TempFileName() + ".c";
+  const std::string binary = TempFileName();
+  const std::string rows = TempFileName();
+  const std::string margins = TempFileName();
+  {
+    std::ofstream fo(source);
+    std::ostringstream os;
+    CompileModel(*model, 0, &os);
+    fo << os.str() << kDriver;
+  }
+  {
+    std::ofstream fo(rows, std::ios::binary);
+    fo.write(reinterpret_cast<const char*>(&n_row), sizeof(n_row));
+    fo.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(bst_float));
+  }
+  const std::string compile = "cc -std=c99 -O2 -o " + binary + " " + source + " -lm";
+  ASSERT_EQ(std::system(compile.c_str()), 0);
+  const std::string run = binary + " " + rows + " " + margins;
+  ASSERT_EQ(std::system(run.c_str()), 0);
+
+  std::vector<bst_float> out(n_row * n_class);
+  {
+    std::ifstream fi(margins, std::ios::binary);
+    fi.read(reinterpret_cast<char*>(out.data()), out.size() * sizeof(bst_float));
+    ASSERT_TRUE(fi.good());
+  }
+  const std::vector<bst_float>& expected = preds.HostVector();
+  ASSERT_EQ(expected.size(), out.size());
+  for (size_t i = 0; i < out.size(); ++i) {
+    EXPECT_FLOAT_EQ(out[i], expected[i]) << "row " << i / n_class;
+  }
+  for (const std::string& name : {source, binary, rows, margins}) {
+    std::remove(name.c_str());
+  }
+  XGDMatrixFree(handle);
+}
+}  // namespace gbm
+}  // namespace xgboost
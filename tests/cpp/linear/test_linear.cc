@@ -1,5 +1,6 @@
 // Copyright by Contributors
 #include <xgboost/linear_updater.h>
+#include <cmath>
 #include "../helpers.h"
 #include "xgboost/gbm.h"
 
@@ -24,6 +25,75 @@ TEST(Linear, shotgun) {
   ASSERT_EQ(model.bias()[0], 5.0f);
 }
 
+TEST(Linear, shotgun_block) {
+  auto mat = CreateDMatrix(64, 16, 0.5);
+  mat->InitColAccess(1 << 16, false);
+  auto updater = std::unique_ptr<xgboost::LinearUpdater>(
+      xgboost::LinearUpdater::Create("shotgun"));
+  updater->Init({{"eta", "1."}, {"feature_partition", "block"}});
+  std::vector<xgboost::GradientPair> init(mat->Info().num_row_);
+  for (size_t i = 0; i < init.size(); ++i) {
+    init[i] = xgboost::GradientPair(static_cast<float>(i % 7) - 3.0f, 1.0f);
+  }
+  xgboost::HostDeviceVector<xgboost::GradientPair> gpair(init);
+  xgboost::gbm::GBLinearModel model;
+  model.param.num_feature = mat->Info().num_col_;
+  model.param.num_output_group = 1;
+  model.LazyInitModel();
+  updater->Update(&gpair, mat.get(), &model, gpair.Size());
+
+  // the merged residuals are the changes of the margin made by the weights
+  std::vector<double> margin(init.size(), model.bias()[0]);
+  auto iter = mat->ColIterator();
+  while (iter->Next()) {
+    auto batch = iter->Value();
+    for (size_t fid = 0; fid < batch.Size(); ++fid) {
+      auto col = batch[fid];
+      for (xgboost::bst_uint j = 0; j < col.length; ++j) {
+        margin[col[j].index] += model[fid][0] * col[j].fvalue;
+      }
+    }
+  }
+  for (size_t i = 0; i < init.size(); ++i) {
+    EXPECT_NEAR(gpair.HostVector()[i].GetGrad(), init[i].GetGrad() + margin[i], 1e-4);
+  }
+}
+
+TEST(Linear, coordinate_robust) {
+  auto mat = CreateDMatrix(64, 8, 0.2);
+  mat->InitColAccess(1 << 16, false);
+  std::vector<xgboost::bst_float> &labels = mat->Info().labels_;
+  labels.resize(mat->Info().num_row_);
+  for (size_t i = 0; i < labels.size(); ++i) labels[i] = static_cast<float>(i % 2);
+  // the logistic gradient at margin 0
+  std::vector<xgboost::GradientPair> init(labels.size());
+  for (size_t i = 0; i < init.size(); ++i) {
+    init[i] = xgboost::GradientPair(0.5f - labels[i], 0.25f);
+  }
+  double norm[2];
+  const char *eps[2] = {"0", "0.1"};
+  for (int k = 0; k < 2; ++k) {
+    auto updater = std::unique_ptr<xgboost::LinearUpdater>(
+        xgboost::LinearUpdater::Create("coord_descent"));
+    updater->Init({{"eta", "1."}, {"robust_eps", eps[k]}});
+    xgboost::gbm::GBLinearModel model;
+    model.param.num_feature = mat->Info().num_col_;
+    model.param.num_output_group = 1;
+    model.LazyInitModel();
+    for (int iter = 0; iter < 4; ++iter) {
+      xgboost::HostDeviceVector<xgboost::GradientPair> gpair(init);
+      updater->Update(&gpair, mat.get(), &model, gpair.Size());
+    }
+    norm[k] = 0.0;
+    for (unsigned fid = 0; fid < model.param.num_feature; ++fid) {
+      norm[k] += std::abs(model[fid][0]);
+    }
+  }
+  // the worst case margin penalises the L1 norm of the weights
+  EXPECT_GT(norm[0], 0.0);
+  EXPECT_LT(norm[1], norm[0]);
+}
+
 TEST(Linear, coordinate) {
   typedef std::pair<std::string, std::string> arg;
   auto mat = CreateDMatrix(10, 10, 0);
@@ -41,4 +111,37 @@ TEST(Linear, coordinate) {
   updater->Update(&gpair, mat.get(), &model, gpair.Size());
 
   ASSERT_EQ(model.bias()[0], 5.0f);
-}
\ No newline at end of file
+}
+TEST(Linear, coordinate_feature_block) {
+  auto mat = CreateDMatrix(3000, 10, 0.3);
+  mat->InitColAccess(1 << 16, false);
+  std::vector<xgboost::GradientPair> init(mat->Info().num_row_);
+  for (size_t i = 0; i < init.size(); ++i) {
+    init[i] = xgboost::GradientPair(static_cast<float>(i % 7) - 3.0f,
+                                    i % 11 == 0 ? -1.0f : 1.0f + (i % 3));
+  }
+  std::vector<std::vector<float>> weights;
+  std::vector<std::vector<xgboost::GradientPair>> grads;
+  for (const char *block : {"1", "4"}) {
+    auto updater = std::unique_ptr<xgboost::LinearUpdater>(
+        xgboost::LinearUpdater::Create("coord_descent"));
+    updater->Init({{"eta", "1."}, {"lambda", "0.1"}, {"feature_block", block}});
+    xgboost::gbm::GBLinearModel model;
+    model.param.num_feature = mat->Info().num_col_;
+    model.param.num_output_group = 1;
+    model.LazyInitModel();
+    xgboost::HostDeviceVector<xgboost::GradientPair> gpair(init);
+    for (int iter = 0; iter < 2; ++iter) {
+      updater->Update(&gpair, mat.get(), &model, gpair.Size());
+    }
+    weights.push_back(model.weight);
+    grads.push_back(gpair.HostVector());
+  }
+  // the blocks give the weights of updating the features one at a time
+  for (size_t i = 0; i < weights[0].size(); ++i) {
+    EXPECT_NEAR(weights[0][i], weights[1][i], 1e-4);
+  }
+  for (size_t i = 0; i < init.size(); ++i) {
+    EXPECT_NEAR(grads[0][i].GetGrad(), grads[1][i].GetGrad(), 1e-3);
+  }
+}
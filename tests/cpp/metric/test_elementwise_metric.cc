@@ -67,3 +67,24 @@ TEST(Metric, PoissionNegLogLik) {
                             {  0,   0,   1,   1}),
               1.1280f, 0.001f);
 }
+
+TEST(Metric, EvalRows) {
+  // the statistics summed over blocks give the same value as Eval
+  std::vector<xgboost::bst_float> preds {0.1f, 0.9f, 0.4f, 0.7f, 0.2f};
+  xgboost::MetaInfo info;
+  info.labels_ = {0, 1, 1, 0, 1};
+  info.weights_ = {1.0f, 2.0f, 0.5f, 1.0f, 1.5f};
+  for (const char* name : {"rmse", "mae", "logloss", "error"}) {
+    xgboost::Metric * metric = xgboost::Metric::Create(name);
+    double stats[2] = {0.0, 0.0};
+    ASSERT_TRUE(metric->EvalRows(preds, info, 0, 0, stats));
+    metric->EvalRows(preds, info, 0, 2, stats);
+    metric->EvalRows(preds, info, 2, 5, stats);
+    EXPECT_NEAR(metric->EvalFinal(stats), metric->Eval(preds, info, false), 1e-6) << name;
+    delete metric;
+  }
+  xgboost::Metric * metric = xgboost::Metric::Create("auc");
+  double stats[2] = {0.0, 0.0};
+  EXPECT_FALSE(metric->EvalRows(preds, info, 0, 0, stats));
+  delete metric;
+}
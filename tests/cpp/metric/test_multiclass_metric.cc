@@ -26,3 +26,44 @@ TEST(Metric, MultiClassLogLoss) {
                             {0, 1, 2}),
               2.302f, 0.001f);
 }
+
+TEST(Metric, MultiClassTopKError) {
+  xgboost::Metric * metric = xgboost::Metric::Create("merror@2");
+  ASSERT_STREQ(metric->Name(), "merror@2");
+  // the labels rank 0, 1 and 2, the first of equal scores first
+  EXPECT_NEAR(GetMetricEval(
+    metric, {0.5f, 0.3f, 0.2f, 0.4f, 0.4f, 0.2f, 0.1f, 0.3f, 0.6f}, {0, 1, 0}),
+              1.0f / 3.0f, 1e-6f);
+  delete metric;
+  metric = xgboost::Metric::Create("merror@1");
+  ASSERT_STREQ(metric->Name(), "merror");
+  EXPECT_NEAR(GetMetricEval(
+    metric, {0.5f, 0.3f, 0.2f, 0.4f, 0.4f, 0.2f, 0.1f, 0.3f, 0.6f}, {0, 1, 0}),
+              2.0f / 3.0f, 1e-6f);
+  delete metric;
+  EXPECT_ANY_THROW(xgboost::Metric::Create("merror@0"));
+}
+
+TEST(Metric, MultiClassEvalRows) {
+  // the statistics summed over blocks give the same value as Eval
+  std::vector<xgboost::bst_float> preds {0.6f, 0.3f, 0.1f, 0.2f, 0.2f, 0.6f,
+                                         0.3f, 0.4f, 0.3f, 0.1f, 0.1f, 0.8f};
+  xgboost::MetaInfo info;
+  info.labels_ = {0, 1, 1, 2};
+  info.weights_ = {1.0f, 2.0f, 0.5f, 1.5f};
+  for (const char* name : {"merror", "merror@2", "mlogloss"}) {
+    xgboost::Metric * metric = xgboost::Metric::Create(name);
+    double stats[2] = {0.0, 0.0};
+    ASSERT_TRUE(metric->EvalRows(preds, info, 0, 0, stats));
+    metric->EvalRows(preds, info, 0, 1, stats);
+    metric->EvalRows(preds, info, 1, 4, stats);
+    EXPECT_NEAR(metric->EvalFinal(stats), metric->Eval(preds, info, false), 1e-6) << name;
+    delete metric;
+  }
+  // a label out of range fails before any block
+  info.labels_[3] = 3;
+  xgboost::Metric * metric = xgboost::Metric::Create("merror");
+  double stats[2] = {0.0, 0.0};
+  EXPECT_ANY_THROW(metric->EvalRows(preds, info, 0, 0, stats));
+  delete metric;
+}
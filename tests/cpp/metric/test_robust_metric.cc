@@ -0,0 +1,71 @@
+// Copyright by Contributors
+#include <xgboost/learner.h>
+#include <xgboost/metric.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../helpers.h"
+
+namespace {
+// a learner of depth 6 trees fit to the labels of mat, of two classes
+std::unique_ptr<xgboost::Learner> FitLearner(std::shared_ptr<xgboost::DMatrix> mat,
+                                             bool multiclass) {
+  std::vector<std::pair<std::string, std::string> > cfg{
+    {"tree_method", "exact"}, {"max_depth", "6"}, {"min_child_weight", "0"},
+    {"eta", "1"}, {"silent", "1"}};
+  if (multiclass) {
+    cfg.emplace_back("objective", "multi:softmax");
+    cfg.emplace_back("num_class", "2");
+  } else {
+    cfg.emplace_back("objective", "binary:logistic");
+  }
+  std::unique_ptr<xgboost::Learner> learner(xgboost::Learner::Create({mat}));
+  learner->Configure(cfg);
+  learner->InitModel();
+  for (int iter = 0; iter < 3; ++iter) learner->UpdateOneIter(iter, mat.get());
+  return learner;
+}
+}  // namespace
+
+TEST(Metric, RobustErrorLabelRange) {
+  std::shared_ptr<xgboost::DMatrix> mat = CreateDMatrix(16, 2, 0, 3);
+  std::vector<xgboost::bst_float>& labels = mat->Info().labels_;
+  labels.resize(16);
+  for (size_t i = 0; i < labels.size(); ++i) labels[i] = static_cast<float>(i % 2);
+  auto learner = FitLearner(mat, true);
+  std::unique_ptr<xgboost::Metric> metric(xgboost::Metric::Create("robust_error@0.01"));
+  xgboost::bst_float value;
+  ASSERT_TRUE(metric->EvalModel(*learner->GetGradientBooster(), mat.get(), false, &value));
+  labels[5] = 2.0f;
+  EXPECT_ANY_THROW(metric->EvalModel(*learner->GetGradientBooster(), mat.get(), false, &value));
+}
+
+TEST(Metric, RobustErrorCacheMatrices) {
+  // two copies of the same rows, fit to opposite labels
+  std::shared_ptr<xgboost::DMatrix> mat = CreateDMatrix(64, 2, 0, 3);
+  std::shared_ptr<xgboost::DMatrix> flipped = CreateDMatrix(64, 2, 0, 3);
+  mat->Info().labels_.resize(64);
+  flipped->Info().labels_.resize(64);
+  for (size_t i = 0; i < 64; ++i) {
+    mat->Info().labels_[i] = static_cast<float>(i % 2);
+    flipped->Info().labels_[i] = static_cast<float>(1 - i % 2);
+  }
+  auto learner = FitLearner(mat, false);
+  auto other = FitLearner(flipped, false);
+  std::unique_ptr<xgboost::Metric> metric(xgboost::Metric::Create("robust_error@0.001"));
+  xgboost::bst_float fit, opposite, fresh;
+  ASSERT_TRUE(metric->EvalModel(*learner->GetGradientBooster(), mat.get(), false, &fit));
+  EXPECT_LT(fit, 0.5f);
+  // the same number of trees, but mat is not a cache matrix of the other
+  // booster, so the sums of the first one must not be reused
+  metric->EvalModel(*other->GetGradientBooster(), mat.get(), false, &opposite);
+  std::unique_ptr<xgboost::Metric> reference(xgboost::Metric::Create("robust_error@0.001"));
+  reference->EvalModel(*other->GetGradientBooster(), mat.get(), false, &fresh);
+  EXPECT_GT(opposite, 0.5f);
+  EXPECT_EQ(opposite, fresh);
+  // and the state of the cache matrix is built again
+  metric->EvalModel(*learner->GetGradientBooster(), mat.get(), false, &opposite);
+  EXPECT_EQ(opposite, fit);
+}
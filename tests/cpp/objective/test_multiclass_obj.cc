@@ -0,0 +1,85 @@
+// Copyright by Contributors
+#include <xgboost/objective.h>
+#include <algorithm>
+#include <cmath>
+
+#include "../helpers.h"
+
+namespace {
+// softmax of a row in double precision
+std::vector<double> ReferenceSoftmax(const std::vector<xgboost::bst_float>& margin,
+                                     size_t row, int nclass) {
+  std::vector<double> prob(nclass);
+  double wmax = margin[row * nclass];
+  for (int k = 1; k < nclass; ++k) {
+    wmax = std::max(wmax, static_cast<double>(margin[row * nclass + k]));
+  }
+  double wsum = 0.0;
+  for (int k = 0; k < nclass; ++k) {
+    prob[k] = std::exp(margin[row * nclass + k] - wmax);
+    wsum += prob[k];
+  }
+  for (int k = 0; k < nclass; ++k) {
+    prob[k] /= wsum;
+  }
+  return prob;
+}
+}  // namespace
+
+TEST(Objective, SoftmaxMultiClassBlocks) {
+  // 11 rows, a full block of 8 rows and a partial one
+  const int nclass = 3;
+  const size_t nrow = 11;
+  xgboost::ObjFunction * obj = xgboost::ObjFunction::Create("multi:softprob");
+  std::vector<std::pair<std::string, std::string> > args;
+  args.emplace_back("num_class", "3");
+  obj->Configure(args);
+
+  std::vector<xgboost::bst_float> margin(nrow * nclass);
+  xgboost::MetaInfo info;
+  info.num_row_ = nrow;
+  info.labels_.resize(nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    for (int k = 0; k < nclass; ++k) {
+      margin[i * nclass + k] = static_cast<xgboost::bst_float>((i * 7 + k * 3) % 11) / 2.0f - 2.5f;
+    }
+    info.labels_[i] = static_cast<xgboost::bst_float>(i % nclass);
+  }
+
+  xgboost::HostDeviceVector<xgboost::bst_float> preds(margin);
+  xgboost::HostDeviceVector<xgboost::GradientPair> gpair;
+  obj->GetGradient(&preds, info, 0, &gpair);
+  ASSERT_EQ(gpair.Size(), margin.size());
+  for (size_t i = 0; i < nrow; ++i) {
+    std::vector<double> prob = ReferenceSoftmax(margin, i, nclass);
+    for (int k = 0; k < nclass; ++k) {
+      const double p = prob[k];
+      const double grad = static_cast<int>(info.labels_[i]) == k ? p - 1.0 : p;
+      EXPECT_NEAR(gpair.HostVector()[i * nclass + k].GetGrad(), grad, 1e-5);
+      EXPECT_NEAR(gpair.HostVector()[i * nclass + k].GetHess(), 2.0 * p * (1.0 - p), 1e-5);
+    }
+  }
+
+  obj->PredTransform(&preds);
+  ASSERT_EQ(preds.Size(), margin.size());
+  for (size_t i = 0; i < nrow; ++i) {
+    std::vector<double> prob = ReferenceSoftmax(margin, i, nclass);
+    for (int k = 0; k < nclass; ++k) {
+      EXPECT_NEAR(preds.HostVector()[i * nclass + k], prob[k], 1e-5);
+    }
+  }
+  delete obj;
+
+  // multi:softmax outputs the class of the largest margin
+  obj = xgboost::ObjFunction::Create("multi:softmax");
+  obj->Configure(args);
+  xgboost::HostDeviceVector<xgboost::bst_float> classes(margin);
+  obj->PredTransform(&classes);
+  ASSERT_EQ(classes.Size(), nrow);
+  for (size_t i = 0; i < nrow; ++i) {
+    std::vector<double> prob = ReferenceSoftmax(margin, i, nclass);
+    const int best = static_cast<int>(std::max_element(prob.begin(), prob.end()) - prob.begin());
+    EXPECT_EQ(classes.HostVector()[i], static_cast<xgboost::bst_float>(best));
+  }
+  delete obj;
+}
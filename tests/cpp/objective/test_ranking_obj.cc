@@ -25,4 +25,38 @@ TEST(Objective, PairwiseRankingGPair) {
                    {0.9975f, 0.9975f, 0.9975f, 0.9975f});
 
   ASSERT_NO_THROW(obj->DefaultEvalMetric());
-}
\ No newline at end of file
+}
+
+TEST(Objective, PairwiseRankingLargeGroup) {
+  xgboost::ObjFunction * obj = xgboost::ObjFunction::Create("rank:pairwise");
+  obj->Configure({{"num_pairsample", "3"}});
+  // graded labels are bucketed by counting, fractional ones by a sort
+  for (float step : {1.0f, 0.25f}) {
+    const size_t n = 203;
+    std::vector<xgboost::bst_float> preds(n), labels(n);
+    for (size_t i = 0; i < n; ++i) {
+      preds[i] = static_cast<float>((i * 37) % 11) * 0.1f;
+      labels[i] = static_cast<float>(i % 5) * step;
+    }
+    xgboost::MetaInfo info;
+    info.num_row_ = n;
+    info.labels_ = labels;
+    info.group_ptr_ = {0, static_cast<unsigned>(n)};
+    xgboost::HostDeviceVector<xgboost::bst_float> in_preds(preds);
+    xgboost::HostDeviceVector<xgboost::GradientPair> out_gpair;
+    obj->GetGradient(&in_preds, info, 0, &out_gpair);
+    const std::vector<xgboost::GradientPair>& gpair = out_gpair.HostVector();
+    ASSERT_EQ(gpair.size(), n);
+    // every pair adds opposite gradients to its two rows
+    double sum = 0.0, top = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+      sum += gpair[i].GetGrad();
+      EXPECT_GT(gpair[i].GetHess(), 0.0f);
+      if (i % 5 == 4) top += gpair[i].GetGrad();
+    }
+    EXPECT_NEAR(sum, 0.0, 1e-2);
+    // the rows of the best label are pushed up
+    EXPECT_LT(top, 0.0);
+  }
+  delete obj;
+}
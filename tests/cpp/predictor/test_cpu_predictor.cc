@@ -1,6 +1,10 @@
 // Copyright by Contributors
 #include <gtest/gtest.h>
 #include <xgboost/predictor.h>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
 #include "../helpers.h"
 
 namespace xgboost {
@@ -59,4 +63,261 @@ TEST(cpu_predictor, Test) {
     ASSERT_EQ(out_contribution[i], 1.5);
   }
 }
+
+TEST(cpu_predictor, SetCachedPredictions) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  trees.back()->InitModel();
+  (*trees.back())[0].SetLeaf(1.5f);
+  gbm::GBTreeModel model(0.5);
+  model.CommitModel(std::move(trees), 0);
+  model.param.num_output_group = 1;
+
+  auto dmat = CreateDMatrix(5, 5, 0);
+  auto other = CreateDMatrix(5, 5, 0);
+  cpu_predictor->Init({}, {dmat});
+  // a saved margin is served as is, the trees are not evaluated
+  std::vector<bst_float> margin = {0.0f, 1.0f, 2.0f, 3.0f, 4.0f};
+  ASSERT_TRUE(cpu_predictor->SetCachedPredictions(dmat.get(), margin));
+  ASSERT_FALSE(cpu_predictor->SetCachedPredictions(other.get(), margin));
+  HostDeviceVector<float> out_predictions;
+  cpu_predictor->PredictBatch(dmat.get(), &out_predictions, model, 0);
+  ASSERT_EQ(out_predictions.HostVector(), margin);
+}
+
+// one tree per group on different features, with a leaf and a split on
+// the second level, missing values go left at the root and right below
+static void AddTwoLevelTrees(int n_col, int n_group, gbm::GBTreeModel* p_model) {
+  gbm::GBTreeModel& model = *p_model;
+  model.param.num_feature = n_col;
+  model.param.num_output_group = n_group;
+  model.base_margin = 0;
+  for (int gid = 0; gid < n_group; ++gid) {
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    RegTree& tree = *trees.back();
+    tree.InitModel();
+    tree.AddChilds(0);
+    tree[0].SetSplit(gid, 0.5f, true);
+    const int left = tree[0].LeftChild();
+    tree.AddChilds(left);
+    tree[left].SetSplit(gid + 1, 0.25f, false);
+    tree[tree[left].LeftChild()].SetLeaf(-2.0f - gid);
+    tree[tree[left].RightChild()].SetLeaf(-1.0f - gid);
+    tree[tree[0].RightChild()].SetLeaf(1.0f + gid);
+    model.CommitModel(std::move(trees), gid);
+  }
+}
+
+TEST(cpu_predictor, DenseAndSparseBatch) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  const int n_col = 4;
+  const int n_group = 2;
+  gbm::GBTreeModel model(0.5);
+  AddTwoLevelTrees(n_col, n_group, &model);
+
+  for (float sparsity : {0.0f, 0.5f}) {
+    auto dmat = CreateDMatrix(50, n_col, sparsity);
+    HostDeviceVector<float> out_predictions;
+    cpu_predictor->PredictBatch(dmat.get(), &out_predictions, model, 0);
+    std::vector<float>& out_predictions_h = out_predictions.HostVector();
+    ASSERT_EQ(out_predictions_h.size(), 50 * n_group);
+    // the same rows in caller buffers
+    std::vector<float> dense(50 * n_col, std::numeric_limits<float>::quiet_NaN());
+    std::vector<size_t> indptr(1, 0);
+    std::vector<unsigned> indices;
+    std::vector<float> values;
+    auto iter = dmat->RowIterator();
+    iter->BeforeFirst();
+    while (iter->Next()) {
+      const auto& batch = iter->Value();
+      for (size_t i = 0; i < batch.Size(); ++i) {
+        std::vector<float> instance_out_predictions;
+        cpu_predictor->PredictInstance(batch[i], &instance_out_predictions, model);
+        for (int gid = 0; gid < n_group; ++gid) {
+          ASSERT_EQ(out_predictions_h[(batch.base_rowid + i) * n_group + gid],
+                    instance_out_predictions[gid]);
+        }
+        for (bst_uint j = 0; j < batch[i].length; ++j) {
+          dense[(batch.base_rowid + i) * n_col + batch[i][j].index] = batch[i][j].fvalue;
+          indices.push_back(batch[i][j].index);
+          values.push_back(batch[i][j].fvalue);
+        }
+        indptr.push_back(indices.size());
+      }
+    }
+    std::vector<float> dense_out(50 * n_group), csr_out(50 * n_group);
+    cpu_predictor->PredictFromDense(dense.data(), 50, n_col,
+                                    std::numeric_limits<float>::quiet_NaN(),
+                                    model, 0, dense_out.data());
+    cpu_predictor->PredictFromCSR(indptr.data(), indices.data(), values.data(), 50,
+                                  model, 0, csr_out.data());
+    for (size_t i = 0; i < out_predictions_h.size(); ++i) {
+      ASSERT_EQ(dense_out[i], out_predictions_h[i]);
+      ASSERT_EQ(csr_out[i], out_predictions_h[i]);
+    }
+  }
+}
+
+TEST(cpu_predictor, PredictStaged) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  const int n_col = 4;
+  const int n_group = 2;
+  gbm::GBTreeModel model(0.5);
+  for (int round = 0; round < 3; ++round) AddTwoLevelTrees(n_col, n_group, &model);
+  auto dmat = CreateDMatrix(37, n_col, 0.5);
+  // stride 2 of 3 rounds ends at rounds 2 and 3, a limit of 2 rounds at 1 and 2
+  for (auto stride_limit : {std::make_pair(2U, 0U), std::make_pair(1U, 2U)}) {
+    const std::vector<unsigned> rounds = stride_limit.second == 0 ?
+        std::vector<unsigned>{2, 3} : std::vector<unsigned>{1, 2};
+    ASSERT_EQ(Predictor::NumStages(model, stride_limit.first, stride_limit.second), 2U);
+    std::vector<float> staged;
+    cpu_predictor->PredictStaged(dmat.get(), &staged, model, stride_limit.first,
+                                 stride_limit.second);
+    ASSERT_EQ(staged.size(), 37 * 2 * n_group);
+    for (size_t s = 0; s < rounds.size(); ++s) {
+      HostDeviceVector<float> out_predictions;
+      cpu_predictor->PredictBatch(dmat.get(), &out_predictions, model, 0, rounds[s]);
+      const std::vector<float>& out_predictions_h = out_predictions.HostVector();
+      for (size_t r = 0; r < 37; ++r) {
+        for (int gid = 0; gid < n_group; ++gid) {
+          ASSERT_NEAR(staged[(r * 2 + s) * n_group + gid],
+                      out_predictions_h[r * n_group + gid], 1e-6);
+        }
+      }
+    }
+  }
+}
+
+TEST(cpu_predictor, PredictLeafCodes) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  const int n_col = 4;
+  const int n_group = 2;
+  gbm::GBTreeModel model(0.5);
+  AddTwoLevelTrees(n_col, n_group, &model);
+  auto dmat = CreateDMatrix(37, n_col, 0.5);
+  std::vector<float> leaf;
+  cpu_predictor->PredictLeaf(dmat.get(), &leaf, model);
+  ASSERT_EQ(leaf.size(), 37U * n_group);
+
+  gbm::LeafCodes codes;
+  model.InitLeafCodes(0, false, &codes);
+  ASSERT_EQ(codes.num_tree, 2U);
+  ASSERT_EQ(codes.num_code, 5U);
+  ASSERT_EQ(codes.index_size, 2);
+  std::vector<uint16_t> ids(leaf.size());
+  cpu_predictor->PredictLeafCodes(dmat.get(), model, codes, ids.data());
+  for (size_t i = 0; i < leaf.size(); ++i) {
+    ASSERT_EQ(ids[i], static_cast<uint16_t>(leaf[i]));
+  }
+  // leaves 2, 3 and 4 of each tree are the next three columns
+  model.InitLeafCodes(0, true, &codes);
+  ASSERT_EQ(codes.num_code, 6U);
+  codes.index_size = 4;
+  std::vector<uint32_t> columns(leaf.size());
+  cpu_predictor->PredictLeafCodes(dmat.get(), model, codes, columns.data());
+  for (size_t i = 0; i < leaf.size(); ++i) {
+    ASSERT_EQ(columns[i], (i % n_group) * 3 + static_cast<uint32_t>(leaf[i]) - 2);
+  }
+}
+
+// node cover for TreeShap, the children come after their parent
+static void SetNodeCover(gbm::GBTreeModel* p_model) {
+  for (auto& tree : p_model->trees) {
+    for (int nid = tree->param.num_nodes - 1; nid >= 0; --nid) {
+      const auto& node = (*tree)[nid];
+      tree->Stat(nid).sum_hess = node.IsLeaf() ? 1.0f + nid :
+          tree->Stat(node.LeftChild()).sum_hess + tree->Stat(node.RightChild()).sum_hess;
+    }
+  }
+}
+
+TEST(cpu_predictor, ContributionsSumToMargin) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  const int n_col = 4;
+  const int n_group = 2;
+  gbm::GBTreeModel model(0.5);
+  AddTwoLevelTrees(n_col, n_group, &model);
+  AddTwoLevelTrees(n_col, n_group, &model);
+  SetNodeCover(&model);
+  // more rows than a block, the last block is partial
+  auto dmat = CreateDMatrix(37, n_col, 0.5);
+  HostDeviceVector<float> out_predictions;
+  cpu_predictor->PredictBatch(dmat.get(), &out_predictions, model, 0);
+  for (bool approximate : {false, true}) {
+    std::vector<float> out_contribs;
+    cpu_predictor->PredictContribution(dmat.get(), &out_contribs, model, 0, approximate);
+    ASSERT_EQ(out_contribs.size(), 37 * n_group * (n_col + 1));
+    for (size_t r = 0; r < 37 * n_group; ++r) {
+      float sum = 0;
+      for (int k = 0; k <= n_col; ++k) sum += out_contribs[r * (n_col + 1) + k];
+      ASSERT_NEAR(sum, out_predictions.HostVector()[r], 1e-5);
+    }
+  }
+}
+
+TEST(cpu_predictor, InteractionContributions) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  const int n_col = 4;
+  const int n_group = 2;
+  gbm::GBTreeModel model(0.5);
+  AddTwoLevelTrees(n_col, n_group, &model);
+  AddTwoLevelTrees(n_col, n_group, &model);
+  SetNodeCover(&model);
+  const size_t ncolumns = n_col + 1;
+  auto dmat = CreateDMatrix(20, n_col, 0.25);
+  std::vector<float> out_contribs;
+  cpu_predictor->PredictInteractionContributions(dmat.get(), &out_contribs, model);
+  ASSERT_EQ(out_contribs.size(), 20 * n_group * ncolumns * ncolumns);
+  // the conditioned contributions of all rows and trees, feature by feature
+  std::vector<float> diag, on, off;
+  cpu_predictor->PredictContribution(dmat.get(), &diag, model, 0, false, 0, 0);
+  for (size_t i = 0; i < ncolumns; ++i) {
+    cpu_predictor->PredictContribution(dmat.get(), &on, model, 0, false, 1, i);
+    cpu_predictor->PredictContribution(dmat.get(), &off, model, 0, false, -1, i);
+    for (size_t r = 0; r < 20 * n_group; ++r) {
+      const float* p_row = &out_contribs[(r * ncolumns + i) * ncolumns];
+      float expected_diag = diag[r * ncolumns + i];
+      for (size_t k = 0; k < ncolumns; ++k) {
+        if (k == i) continue;
+        const float interaction = (on[r * ncolumns + k] - off[r * ncolumns + k]) / 2.0f;
+        ASSERT_NEAR(p_row[k], interaction, 1e-5);
+        expected_diag -= interaction;
+      }
+      ASSERT_NEAR(p_row[i], expected_diag, 1e-5);
+    }
+  }
+}
+
+TEST(cpu_predictor, QuickScorer) {
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  std::unique_ptr<Predictor> qs_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("quickscorer_cpu"));
+  const int n_col = 4;
+  const int n_group = 2;
+  gbm::GBTreeModel model(0.5);
+  AddTwoLevelTrees(n_col, n_group, &model);
+  // a second round, so that the index covers several trees per group
+  AddTwoLevelTrees(n_col, n_group, &model);
+  for (float sparsity : {0.0f, 0.5f}) {
+    auto dmat = CreateDMatrix(50, n_col, sparsity);
+    for (unsigned ntree_limit : {0U, 1U}) {
+      HostDeviceVector<float> expected, out_predictions;
+      cpu_predictor->PredictBatch(dmat.get(), &expected, model, 0, ntree_limit);
+      qs_predictor->PredictBatch(dmat.get(), &out_predictions, model, 0, ntree_limit);
+      ASSERT_EQ(out_predictions.Size(), expected.Size());
+      for (size_t i = 0; i < expected.Size(); ++i) {
+        ASSERT_EQ(out_predictions.HostVector()[i], expected.HostVector()[i]);
+      }
+    }
+  }
+}
 }  // namespace xgboost
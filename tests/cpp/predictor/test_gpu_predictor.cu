@@ -74,5 +74,54 @@ TEST(gpu_predictor, Test) {
     ASSERT_EQ(gpu_out_contribution[i], cpu_out_contribution[i]);
   }
 }
+
+TEST(gpu_predictor, TiledTrees) {
+  std::unique_ptr<Predictor> gpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("gpu_predictor"));
+  std::unique_ptr<Predictor> cpu_predictor =
+      std::unique_ptr<Predictor>(Predictor::Create("cpu_predictor"));
+  gpu_predictor->Init({}, {});
+  cpu_predictor->Init({}, {});
+
+  // enough trees to fill several tiles of shared memory
+  const int n_col = 8;
+  const int n_group = 3;
+  gbm::GBTreeModel model(0.5);
+  model.param.num_feature = n_col;
+  model.param.num_output_group = n_group;
+  for (int round = 0; round < 300; ++round) {
+    for (int gid = 0; gid < n_group; ++gid) {
+      std::vector<std::unique_ptr<RegTree>> trees;
+      trees.push_back(std::unique_ptr<RegTree>(new RegTree()));
+      RegTree& tree = *trees.back();
+      tree.InitModel();
+      tree.AddChilds(0);
+      tree[0].SetSplit((round + gid) % n_col, 0.5f, round % 2 == 0);
+      const int left = tree[0].LeftChild();
+      tree.AddChilds(left);
+      tree[left].SetSplit((round + 1) % n_col, 0.25f, gid % 2 == 0);
+      tree[tree[left].LeftChild()].SetLeaf(-0.02f * gid);
+      tree[tree[left].RightChild()].SetLeaf(0.01f);
+      tree[tree[0].RightChild()].SetLeaf(0.03f * (round % 5));
+      model.CommitModel(std::move(trees), gid);
+    }
+  }
+
+  // the dense matrix is predicted with the tiled kernel, the sparse one with
+  // the row kernel
+  for (float sparsity : {0.0f, 0.9f}) {
+    auto dmat = CreateDMatrix(200, n_col, sparsity);
+    HostDeviceVector<float> gpu_out_predictions;
+    HostDeviceVector<float> cpu_out_predictions;
+    gpu_predictor->PredictBatch(dmat.get(), &gpu_out_predictions, model, 0);
+    cpu_predictor->PredictBatch(dmat.get(), &cpu_out_predictions, model, 0);
+    std::vector<float>& gpu_out_predictions_h = gpu_out_predictions.HostVector();
+    std::vector<float>& cpu_out_predictions_h = cpu_out_predictions.HostVector();
+    ASSERT_EQ(gpu_out_predictions_h.size(), cpu_out_predictions_h.size());
+    for (size_t i = 0; i < gpu_out_predictions_h.size(); i++) {
+      ASSERT_NEAR(gpu_out_predictions_h[i], cpu_out_predictions_h[i], 1e-3);
+    }
+  }
+}
 }  // namespace predictor
 }  // namespace xgboost
@@ -0,0 +1,26 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+#include "../../../src/predictor/quantized_forest.h"
+
+namespace xgboost {
+TEST(quantized_forest, Half) {
+  static_assert(sizeof(predictor::QuantizedForest::Node) == 8, "nodes must be 8 bytes");
+  // exactly representable values survive the round trip
+  const float exact[] = {0.0f, -0.0f, 1.0f, -2.5f, 0.125f, 65504.0f, 6.103515625e-05f,
+                         5.9604644775390625e-08f};
+  for (float v : exact) ASSERT_EQ(predictor::HalfToFloat(predictor::FloatToHalf(v)), v);
+  // ties round to even, 1 + 2^-11 is half way between 1 and 1 + 2^-10
+  ASSERT_EQ(predictor::HalfToFloat(predictor::FloatToHalf(1.0f + std::ldexp(1.0f, -11))), 1.0f);
+  ASSERT_EQ(predictor::HalfToFloat(predictor::FloatToHalf(1.0f + 3 * std::ldexp(1.0f, -11))),
+            1.0f + std::ldexp(1.0f, -9));
+  for (float v = -4.0f; v < 4.0f; v += 0.0137f) {
+    ASSERT_NEAR(predictor::HalfToFloat(predictor::FloatToHalf(v)), v,
+                std::fabs(v) * std::ldexp(1.0f, -11) + 1e-7f);
+  }
+  ASSERT_TRUE(std::isinf(predictor::HalfToFloat(predictor::FloatToHalf(1e6f))));
+  ASSERT_TRUE(std::isnan(predictor::HalfToFloat(
+      predictor::FloatToHalf(std::numeric_limits<float>::quiet_NaN()))));
+}
+}  // namespace xgboost
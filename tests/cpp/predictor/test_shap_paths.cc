@@ -0,0 +1,132 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/c_api.h>
+#include <xgboost/predictor.h>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "../helpers.h"
+#include "../../../src/predictor/shap_paths.h"
+
+namespace xgboost {
+namespace predictor {
+
+// set node nid to a split with the cover of its children
+static void Split(RegTree* tree, int nid, unsigned fid, float cond, bool default_left,
+                  float left_hess, float right_hess) {
+  tree->AddChilds(nid);
+  (*tree)[nid].SetSplit(fid, cond, default_left);
+  tree->Stat((*tree)[nid].LeftChild()).sum_hess = left_hess;
+  tree->Stat((*tree)[nid].RightChild()).sum_hess = right_hess;
+}
+
+// a tree splitting feature 0 twice on a path, and a stump of feature 1
+static void MakeModel(gbm::GBTreeModel* model) {
+  model->param.num_feature = 3;
+  model->param.num_output_group = 1;
+  std::vector<std::unique_ptr<RegTree> > trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  RegTree& tree = *trees.back();
+  tree.InitModel();
+  tree.Stat(0).sum_hess = 10.0f;
+  Split(&tree, 0, 0, 0.5f, true, 6.0f, 4.0f);
+  const int l = tree[0].LeftChild(), r = tree[0].RightChild();
+  Split(&tree, l, 1, 0.3f, false, 2.0f, 4.0f);
+  tree[tree[l].LeftChild()].SetLeaf(1.0f);
+  const int lr = tree[l].RightChild();
+  Split(&tree, lr, 0, 0.2f, true, 1.0f, 3.0f);
+  tree[tree[lr].LeftChild()].SetLeaf(-0.5f);
+  tree[tree[lr].RightChild()].SetLeaf(2.0f);
+  Split(&tree, r, 2, 0.7f, true, 3.0f, 1.0f);
+  tree[tree[r].LeftChild()].SetLeaf(0.25f);
+  tree[tree[r].RightChild()].SetLeaf(-1.0f);
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  RegTree& stump = *trees.back();
+  stump.InitModel();
+  stump.Stat(0).sum_hess = 10.0f;
+  Split(&stump, 0, 1, 0.6f, false, 7.0f, 3.0f);
+  stump[stump[0].LeftChild()].SetLeaf(0.5f);
+  stump[stump[0].RightChild()].SetLeaf(-0.75f);
+  model->CommitModel(std::move(trees), 0);
+}
+
+TEST(ShapPaths, MatchTreeShap) {
+  gbm::GBTreeModel model(0.5f);
+  MakeModel(&model);
+  ShapPaths paths;
+  ExtractShapPaths(model, 0, model.trees.size(), &paths);
+  ASSERT_EQ(paths.Size(), 7U);
+  // the two splits of feature 0 are merged
+  EXPECT_EQ(paths.max_length, 3U);
+
+  // -1 marks a missing value
+  const std::vector<float> rows = {0.1f, 0.4f, 0.9f,  0.3f, -1.0f, 0.2f,
+                                   -1.0f, 0.2f, -1.0f, 0.8f, 0.7f, 0.75f,
+                                   0.15f, 0.35f, 0.5f};
+  const size_t nrow = rows.size() / 3, ncol = 4;
+  DMatrixHandle handle;
+  XGDMatrixCreateFromMat(rows.data(), nrow, 3, -1.0f, &handle);
+  std::shared_ptr<DMatrix> dmat = *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  std::unique_ptr<Predictor> cpu_predictor(Predictor::Create("cpu_predictor"));
+  cpu_predictor->Init({}, {});
+
+  // the values of the rows summed over the paths, base margin to the bias
+  auto path_values = [&](int condition, int feature,
+                         bool interactions) -> std::vector<float> {
+    const size_t row_size = interactions ? ncol * ncol : ncol;
+    std::vector<float> out(nrow * row_size, 0.0f);
+    for (size_t r = 0; r < nrow; ++r) {
+      float* row = &out[r * row_size];
+      row[row_size - 1] += model.base_margin;
+      for (size_t p = 0; p < paths.Size(); ++p) {
+        const ShapPathElement* elements = &paths.elements[paths.path_ptr[p]];
+        const int n = static_cast<int>(paths.path_ptr[p + 1] - paths.path_ptr[p]);
+        float fvalue[kMaxShapPathLength];
+        bool missing[kMaxShapPathLength];
+        for (int i = 0; i < n; ++i) {
+          const int fidx = elements[i].feature_idx;
+          fvalue[i] = fidx < 0 ? 0.0f : rows[r * 3 + fidx];
+          missing[i] = fidx >= 0 && fvalue[i] == -1.0f;
+        }
+        if (interactions) {
+          ShapPathInteractions(elements, fvalue, missing, n, paths.leaf_value[p],
+                               [&](int i, int j, float v) {
+                                 const size_t ci = i < 0 ? ncol - 1 : i;
+                                 const size_t cj = j < 0 ? ncol - 1 : j;
+                                 row[ci * ncol + cj] += v;
+                               });
+        } else {
+          ShapPathContributions(elements, fvalue, missing, n, paths.leaf_value[p],
+                                condition, feature, [&](int f, float v) {
+                                  row[f < 0 ? ncol - 1 : f] += v;
+                                });
+        }
+      }
+    }
+    return out;
+  };
+
+  for (int condition = -1; condition <= 1; ++condition) {
+    for (unsigned feature = 0; feature < (condition == 0 ? 1U : 3U); ++feature) {
+      std::vector<float> expected;
+      cpu_predictor->PredictContribution(dmat.get(), &expected, model, 0, false,
+                                         condition, feature);
+      const std::vector<float> values = path_values(condition, feature, false);
+      ASSERT_EQ(values.size(), expected.size());
+      for (size_t i = 0; i < values.size(); ++i) {
+        EXPECT_NEAR(values[i], expected[i], 1e-5f) << condition << " " << feature << " " << i;
+      }
+    }
+  }
+  std::vector<float> expected;
+  cpu_predictor->PredictInteractionContributions(dmat.get(), &expected, model);
+  const std::vector<float> values = path_values(0, 0, true);
+  ASSERT_EQ(values.size(), expected.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_NEAR(values[i], expected[i], 1e-5f) << i;
+  }
+  XGDMatrixFree(handle);
+}
+
+}  // namespace predictor
+}  // namespace xgboost
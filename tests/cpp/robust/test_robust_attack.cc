@@ -0,0 +1,84 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/c_api.h>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "../helpers.h"
+#include "../../../src/robust/robust_attack.h"
+
+namespace xgboost {
+namespace robust {
+
+TEST(RobustAttack, Stump) {
+  // x0 < 0.5 gives class 1, x1 is not tested
+  gbm::GBTreeModel model(0.5);
+  model.param.num_feature = 2;
+  model.param.num_output_group = 1;
+  model.base_margin = 0;
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  RegTree& tree = *trees.back();
+  tree.InitModel();
+  tree.AddChilds(0);
+  tree[0].SetSplit(0, 0.5f, true);
+  tree[tree[0].LeftChild()].SetLeaf(1.0f);
+  tree[tree[0].RightChild()].SetLeaf(-1.0f);
+  model.CommitModel(std::move(trees), 0);
+  std::vector<float> data = {0.3f, 0.2f, 0.7f, 0.2f, 0.9f, 0.2f, 0.1f, 0.2f};
+  DMatrixHandle handle;
+  XGDMatrixCreateFromMat(data.data(), 4, 2, -1.0f, &handle);
+  std::shared_ptr<DMatrix> dmat = *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  dmat->Info().labels_ = {1.0f, 0.0f, 1.0f, 1.0f};
+
+  RobustAttack attack(model);
+  attack.Configure({{"attack_eps", "0.3"}});
+  std::vector<bst_float> dist, adv;
+  attack.Attack(dmat.get(), &dist, &adv);
+  ASSERT_EQ(dist.size(), 4U);
+  ASSERT_EQ(adv.size(), 8U);
+  // the closest points across the threshold, from either side of it
+  const float below = std::nextafter(0.5f, -std::numeric_limits<float>::infinity());
+  EXPECT_EQ(adv[0], 0.5f);
+  EXPECT_EQ(dist[0], 0.5f - 0.3f);
+  EXPECT_EQ(adv[2], below);
+  EXPECT_EQ(dist[1], 0.7f - below);
+  EXPECT_EQ(adv[1], 0.2f);
+  EXPECT_EQ(adv[3], 0.2f);
+  // already misclassified, and beyond the radius
+  EXPECT_EQ(dist[2], 0.0f);
+  EXPECT_EQ(dist[3], -1.0f);
+  EXPECT_EQ(adv[6], 0.1f);
+  XGDMatrixFree(handle);
+}
+
+TEST(RobustAttack, CAPI) {
+  // a trained stump splits x0 at 0.5, between the classes
+  std::vector<float> data = {0.2f, 0.4f, 0.6f, 0.8f};
+  std::vector<float> labels = {1.0f, 1.0f, 0.0f, 0.0f};
+  DMatrixHandle dmat;
+  ASSERT_EQ(XGDMatrixCreateFromMat(data.data(), 4, 1, -1.0f, &dmat), 0);
+  ASSERT_EQ(XGDMatrixSetFloatInfo(dmat, "label", labels.data(), 4), 0);
+  BoosterHandle booster;
+  ASSERT_EQ(XGBoosterCreate(&dmat, 1, &booster), 0);
+  XGBoosterSetParam(booster, "objective", "binary:logistic");
+  XGBoosterSetParam(booster, "max_depth", "1");
+  XGBoosterSetParam(booster, "min_child_weight", "0");
+  XGBoosterSetParam(booster, "eta", "1");
+  XGBoosterSetParam(booster, "silent", "1");
+  ASSERT_EQ(XGBoosterUpdateOneIter(booster, 0, dmat), 0);
+  xgboost::bst_ulong len;
+  const float* dist;
+  ASSERT_EQ(XGBoosterAttackLinf(booster, dmat, 0.25f, &len, &dist), 0);
+  ASSERT_EQ(len, 4U);
+  const float below = std::nextafter(0.5f, -std::numeric_limits<float>::infinity());
+  EXPECT_EQ(dist[0], -1.0f);
+  EXPECT_EQ(dist[1], 0.5f - 0.4f);
+  EXPECT_EQ(dist[2], 0.6f - below);
+  EXPECT_EQ(dist[3], -1.0f);
+  ASSERT_EQ(XGBoosterFree(booster), 0);
+  ASSERT_EQ(XGDMatrixFree(dmat), 0);
+}
+}  // namespace robust
+}  // namespace xgboost
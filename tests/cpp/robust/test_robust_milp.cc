@@ -0,0 +1,89 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <xgboost/c_api.h>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../helpers.h"
+#include "../../../src/robust/robust_milp.h"
+
+namespace xgboost {
+namespace robust {
+
+static void AddStump(unsigned fid, float cond, float left, float right,
+                     gbm::GBTreeModel* model) {
+  std::vector<std::unique_ptr<RegTree>> trees;
+  trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+  RegTree& tree = *trees.back();
+  tree.InitModel();
+  tree.AddChilds(0);
+  tree[0].SetSplit(fid, cond, true);
+  tree[tree[0].LeftChild()].SetLeaf(left);
+  tree[tree[0].RightChild()].SetLeaf(right);
+  model->CommitModel(std::move(trees), 0);
+}
+
+static const MilpProblem::Row* FindRow(const MilpProblem& prob, const std::string& name) {
+  for (const MilpProblem::Row& row : prob.rows) {
+    if (row.name == name) return &row;
+  }
+  return nullptr;
+}
+
+TEST(RobustMilp, BoxReduction) {
+  gbm::GBTreeModel model(0.5);
+  model.param.num_feature = 2;
+  model.param.num_output_group = 1;
+  model.base_margin = 0;
+  // the first two trees test the same predicate
+  AddStump(0, 0.5f, 1.0f, -1.0f, &model);
+  AddStump(0, 0.5f, 0.5f, -0.5f, &model);
+  AddStump(1, 0.2f, -2.0f, 0.25f, &model);
+  std::vector<float> data = {0.3f, 0.7f, 0.9f, 0.1f};
+  DMatrixHandle handle;
+  XGDMatrixCreateFromMat(data.data(), 2, 2, -1.0f, &handle);
+  std::shared_ptr<DMatrix> dmat = *static_cast<std::shared_ptr<DMatrix>*>(handle);
+  dmat->Info().labels_ = {1.0f, 0.0f};
+
+  RobustMilp milp(model);
+  MilpProblem full, boxed;
+  milp.Build(dmat.get(), 0, -1, &full);
+  ASSERT_EQ(full.predicates.size(), 2U);
+  ASSERT_NE(FindRow(full, "leaf_sum_2"), nullptr);
+  // the box of radius 0.25 crosses the split of feature 0 only, the third
+  // tree is the constant of the misclassification constraint
+  milp.Configure({{"milp_eps", "0.25"}});
+  milp.Build(dmat.get(), 0, -1, &boxed);
+  ASSERT_EQ(boxed.predicates.size(), 1U);
+  ASSERT_EQ(FindRow(boxed, "leaf_sum_2"), nullptr);
+  ASSERT_LT(boxed.var_name.size(), full.var_name.size());
+  const MilpProblem::Row* mislabel = FindRow(boxed, "mislabel");
+  ASSERT_NE(mislabel, nullptr);
+  EXPECT_EQ(mislabel->rhs, -0.25);
+  EXPECT_EQ(mislabel->terms.size(), 4U);
+  // x[0] = 0.3 moves by 0.2 to the right of the threshold
+  const MilpProblem::Row* linf = FindRow(boxed, "linf_0");
+  ASSERT_NE(linf, nullptr);
+  EXPECT_NEAR(linf->rhs, -0.2, 1e-6);
+  // the second row has label 0 and needs a positive output
+  milp.Build(dmat.get(), 1, -1, &boxed);
+  EXPECT_EQ(FindRow(boxed, "mislabel")->rhs, -1.5 - 2e-7f);
+
+  std::ostringstream mps, lp, relaxed;
+  milp.Export(dmat.get(), 0, -1, &mps);
+  EXPECT_NE(mps.str().find(" BV bnd p0\n"), std::string::npos);
+  EXPECT_NE(mps.str().find("ENDATA\n"), std::string::npos);
+  milp.Configure({{"milp_eps", "0.25"}, {"milp_format", "lp"}});
+  milp.Export(dmat.get(), 0, -1, &lp);
+  EXPECT_NE(lp.str().find("Binaries\n p0\n"), std::string::npos);
+  EXPECT_NE(lp.str().find(" mislabel:"), std::string::npos);
+  milp.Configure({{"milp_eps", "0.25"}, {"milp_format", "mps"}, {"milp_relax", "1"}});
+  milp.Export(dmat.get(), 0, -1, &relaxed);
+  EXPECT_EQ(relaxed.str().find(" BV "), std::string::npos);
+  EXPECT_NE(relaxed.str().find(" UP bnd p0 1\n"), std::string::npos);
+  XGDMatrixFree(handle);
+}
+
+}  // namespace robust
+}  // namespace xgboost
@@ -0,0 +1,124 @@
+// Copyright by Contributors
+#include <gtest/gtest.h>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include "../helpers.h"
+#include "../../../src/robust/robust_verifier.h"
+
+namespace xgboost {
+namespace robust {
+
+// stumps on the features in turn, the split value moves with the round
+static void AddStumps(int n_col, int begin, int end, float shift, gbm::GBTreeModel* p_model) {
+  gbm::GBTreeModel& model = *p_model;
+  model.param.num_feature = n_col;
+  model.param.num_output_group = 1;
+  model.base_margin = 0;
+  for (int t = begin; t < end; ++t) {
+    std::vector<std::unique_ptr<RegTree>> trees;
+    trees.push_back(std::unique_ptr<RegTree>(new RegTree));
+    RegTree& tree = *trees.back();
+    tree.InitModel();
+    tree.AddChilds(0);
+    tree[0].SetSplit(t % n_col, 0.2f + 0.15f * (t % 5) + shift, true);
+    tree[tree[0].LeftChild()].SetLeaf(-1.0f + 0.1f * t);
+    tree[tree[0].RightChild()].SetLeaf(1.0f);
+    model.CommitModel(std::move(trees), 0);
+  }
+}
+
+TEST(RobustVerifier, IncrementalSummary) {
+  const int n_row = 60, n_col = 4;
+  auto dmat = CreateDMatrix(n_row, n_col, 0);
+  std::vector<bst_float>& labels = dmat->Info().labels_;
+  labels.resize(n_row);
+  for (int i = 0; i < n_row; ++i) labels[i] = static_cast<bst_float>(i % 3 != 0);
+  gbm::GBTreeModel prefix(0.5), model(0.5), other(0.5);
+  AddStumps(n_col, 0, 4, 0.0f, &prefix);
+  AddStumps(n_col, 0, 8, 0.0f, &model);
+  AddStumps(n_col, 0, 8, 0.05f, &other);
+
+  VerifySummary summary;
+  std::vector<int> status, expected_status;
+  std::vector<bst_float> bound, expected_bound;
+  RobustVerifier first(prefix);
+  first.Configure({{"verify_eps", "0.1"}});
+  first.Verify(dmat.get(), &status, &bound, &summary);
+  ASSERT_EQ(summary.NumTrees(), 4U);
+  first.Verify(dmat.get(), &expected_status, &expected_bound);
+  ASSERT_EQ(status, expected_status);
+  ASSERT_EQ(bound, expected_bound);
+  // the model extends the prefix, only its new trees are summarised; a
+  // model that does not is summarised again
+  for (const gbm::GBTreeModel* next : {&model, &other}) {
+    RobustVerifier verifier(*next);
+    verifier.Configure({{"verify_eps", "0.1"}});
+    verifier.Verify(dmat.get(), &status, &bound, &summary);
+    ASSERT_EQ(summary.NumTrees(), 8U);
+    verifier.Verify(dmat.get(), &expected_status, &expected_bound);
+    ASSERT_EQ(status, expected_status);
+    ASSERT_EQ(bound, expected_bound);
+  }
+  // a limit below the trees summarised starts over
+  RobustVerifier limited(model);
+  limited.Configure({{"verify_eps", "0.1"}, {"ntree_limit", "2"}});
+  limited.Verify(dmat.get(), &status, &bound, &summary);
+  ASSERT_EQ(summary.NumTrees(), 2U);
+  limited.Verify(dmat.get(), &expected_status, &expected_bound);
+  ASSERT_EQ(status, expected_status);
+}
+
+TEST(RobustVerifier, SearchRadius) {
+  const int n_row = 40, n_col = 4;
+  const float max_eps = 0.5f, tol = 1e-3f;
+  auto dmat = CreateDMatrix(n_row, n_col, 0);
+  std::vector<bst_float>& labels = dmat->Info().labels_;
+  labels.resize(n_row);
+  for (int i = 0; i < n_row; ++i) labels[i] = static_cast<bst_float>(i % 3 != 0);
+  gbm::GBTreeModel model(0.5);
+  AddStumps(n_col, 0, 6, 0.0f, &model);
+
+  RobustVerifier verifier(model);
+  verifier.Configure({{"verify_eps", "0.5"}, {"verify_radius_tol", "0.001"}});
+  std::vector<bst_float> lower, upper;
+  verifier.SearchRadius(dmat.get(), std::vector<bst_float>(n_row, -1.0f), &lower, &upper);
+  ASSERT_EQ(lower.size(), static_cast<size_t>(n_row));
+  // the verification at each end of the interval agrees with the search
+  auto verify = [&](int row, bst_float eps) {
+    std::ostringstream os;
+    os << std::setprecision(std::numeric_limits<float>::max_digits10) << eps;
+    RobustVerifier at(model);
+    at.Configure({{"verify_eps", os.str()}});
+    std::vector<int> status;
+    std::vector<bst_float> bound;
+    at.Verify(dmat.get(), &status, &bound);
+    return status[row];
+  };
+  for (int i = 0; i < n_row; ++i) {
+    ASSERT_LE(lower[i], upper[i]);
+    if (upper[i] == 0.0f) {
+      ASSERT_EQ(verify(i, 0.0f), kMisclassified);
+      continue;
+    }
+    ASSERT_LE(verify(i, lower[i]), kSearchedRobust);
+    if (lower[i] < max_eps) {
+      ASSERT_EQ(verify(i, lower[i] + 2 * tol), kVulnerable);
+      // the stumps are searched exactly, the vulnerable radius is found
+      ASSERT_LE(upper[i] - lower[i], tol);
+      ASSERT_EQ(verify(i, upper[i]), kVulnerable);
+    }
+  }
+  // a known adversarial radius caps the search
+  std::vector<bst_float> cap_lower, cap_upper;
+  verifier.SearchRadius(dmat.get(), upper, &cap_lower, &cap_upper);
+  for (int i = 0; i < n_row; ++i) {
+    ASSERT_LE(cap_lower[i], upper[i]);
+    ASSERT_LE(cap_upper[i], upper[i]);
+  }
+}
+
+}  // namespace robust
+}  // namespace xgboost
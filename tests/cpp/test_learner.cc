@@ -1,5 +1,9 @@
 // Copyright by Contributors
 #include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 #include "helpers.h"
 #include "xgboost/learner.h"
 
@@ -11,4 +15,29 @@ TEST(learner, Test) {
   auto learner = std::unique_ptr<Learner>(Learner::Create(mat));
   learner->Configure(args);
 }
-}  // namespace xgboost
\ No newline at end of file
+
+TEST(learner, AdversarialTraining) {
+  const size_t n_row = 64;
+  auto mat = CreateDMatrix(n_row, 4, 0);
+  std::vector<bst_float>& labels = mat->Info().labels_;
+  labels.resize(n_row);
+  for (size_t i = 0; i < n_row; ++i) labels[i] = static_cast<bst_float>(i % 2);
+  const std::vector<std::pair<std::string, std::string> > cfg{
+    {"tree_method", "exact"}, {"objective", "binary:logistic"}, {"max_depth", "3"},
+    {"adv_train_period", "2"}, {"adv_train_eps", "0.2"}, {"silent", "1"}};
+  std::unique_ptr<Learner> learner(Learner::Create({mat}));
+  learner->Configure(cfg);
+  learner->InitModel();
+  for (int iter = 0; iter < 2; ++iter) learner->UpdateOneIter(iter, mat.get());
+  ASSERT_EQ(mat->Info().num_row_, n_row);
+  // the model fits the labels of the noise, so the attack succeeds on rows
+  learner->UpdateOneIter(2, mat.get());
+  const size_t with_copies = mat->Info().num_row_;
+  ASSERT_GT(with_copies, n_row);
+  ASSERT_LE(with_copies, 2 * n_row);
+  ASSERT_EQ(mat->Info().labels_.size(), with_copies);
+  // only the original rows are attacked again
+  for (int iter = 3; iter < 5; ++iter) learner->UpdateOneIter(iter, mat.get());
+  ASSERT_LE(mat->Info().num_row_, with_copies + n_row);
+}
+}  // namespace xgboost
@@ -0,0 +1,40 @@
+#!/usr/bin/python
+# Benchmark of the communication of robust_distcol.
+# Every worker holds the columns c with c % world_size == rank of the same
+# rows, and robust_training_verbose prints the bytes and the latency of the
+# position and split synchronization of every level on rank 0.
+import argparse
+import time
+import numpy as np
+from scipy import sparse
+from sklearn.datasets import make_classification
+import xgboost as xgb
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--rows', type=int, default=100000)
+parser.add_argument('--columns', type=int, default=64)
+parser.add_argument('--iterations', type=int, default=5)
+parser.add_argument('--max_depth', type=int, default=8)
+parser.add_argument('--eps', type=float, default=0.1)
+args = parser.parse_args()
+
+xgb.rabit.init()
+rank = xgb.rabit.get_rank()
+world = xgb.rabit.get_world_size()
+
+X, y = make_classification(args.rows, n_features=args.columns, n_redundant=0,
+                           n_informative=args.columns, n_repeated=0, random_state=7)
+# keep the columns of this worker, the others are absent
+X[:, np.arange(args.columns) % world != rank] = 0
+dtrain = xgb.DMatrix(sparse.csr_matrix(X), label=y)
+
+param = {'objective': 'binary:logistic', 'silent': 1,
+         'tree_method': 'robust_exact', 'updater': 'robust_distcol',
+         'dsplit': 'col', 'max_depth': args.max_depth,
+         'robust_eps': args.eps, 'robust_training_verbose': 1}
+tstart = time.time()
+xgb.train(param, dtrain, args.iterations)
+if rank == 0:
+    xgb.rabit.tracker_print('{} workers, train time: {} seconds\n'.format(
+        world, time.time() - tstart))
+xgb.rabit.finalize()
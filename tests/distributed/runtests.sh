@@ -7,3 +7,17 @@ PYTHONPATH=../../python-package/ ../../dmlc-core/tracker/dmlc-submit  --cluster=
 echo "====== 2. Regression test for issue #3402 ======"
 PYTHONPATH=../../python-package/ ../../dmlc-core/tracker/dmlc-submit  --cluster=local --num-workers=2 --worker-cores=1\
   python test_issue3402.py
+
+echo "====== 3. Communication benchmark of robust_distcol ======"
+for n in 4 8 16; do
+  PYTHONPATH=../../python-package/ ../../dmlc-core/tracker/dmlc-submit  --cluster=local --num-workers=$n --worker-cores=1\
+    python benchmark_robust_distcol.py
+done
+
+echo "====== 4. Compressed histogram sync of grow_histmaker ======"
+PYTHONPATH=../../python-package/ ../../dmlc-core/tracker/dmlc-submit  --cluster=local --num-workers=3\
+  python test_hist_sync.py
+
+echo "====== 5. robust_exact on row-split data ======"
+PYTHONPATH=../../python-package/ ../../dmlc-core/tracker/dmlc-submit  --cluster=local --num-workers=3\
+  python test_robust_distrow.py
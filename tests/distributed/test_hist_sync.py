@@ -0,0 +1,27 @@
+#!/usr/bin/python
+# The compressed histogram sync of grow_histmaker must grow models as good
+# as the dense one.
+import xgboost as xgb
+
+xgb.rabit.init()
+
+dtrain = xgb.DMatrix('../../demo/data/agaricus.txt.train')
+dtest = xgb.DMatrix('../../demo/data/agaricus.txt.test')
+
+param = {'max_depth': 4, 'eta': 1, 'silent': 1, 'objective': 'binary:logistic',
+         'tree_method': 'approx', 'eval_metric': 'error'}
+errors = {}
+for sync in [{}, {'hist_sync_compress': 1}, {'hist_sync_float': 1},
+             {'hist_sync_compress': 1, 'hist_sync_float': 1}]:
+    p = dict(param, **sync)
+    result = {}
+    xgb.train(p, dtrain, 10, [(dtest, 'eval')], evals_result=result)
+    errors[str(sorted(sync.items()))] = result['eval']['error'][-1]
+
+base = errors[str([])]
+for key, error in errors.items():
+    assert abs(error - base) < 1e-2, (key, error, base)
+
+if xgb.rabit.get_rank() == 0:
+    xgb.rabit.tracker_print("Finished histogram sync test\n")
+xgb.rabit.finalize()
@@ -0,0 +1,27 @@
+#!/usr/bin/python
+# robust_exact on row-split data grows the same trees on every worker, and
+# they are as good as the ones of the histogram windows of robust_grow_histmaker.
+import xgboost as xgb
+
+xgb.rabit.init()
+
+dtrain = xgb.DMatrix('../../demo/data/agaricus.txt.train')
+dtest = xgb.DMatrix('../../demo/data/agaricus.txt.test')
+
+param = {'max_depth': 4, 'eta': 1, 'silent': 1, 'objective': 'binary:logistic',
+         'robust_eps': 0.1, 'eval_metric': 'error'}
+errors = {}
+for updater in ['robust_distrow,prune', 'robust_grow_histmaker,prune']:
+    p = dict(param, tree_method='robust_exact', updater=updater)
+    result = {}
+    bst = xgb.train(p, dtrain, 10, [(dtest, 'eval')], evals_result=result)
+    errors[updater] = result['eval']['error'][-1]
+    # the model of rank 0 is the one of all workers
+    dump = ''.join(bst.get_dump())
+    assert xgb.rabit.broadcast(dump, 0) == dump
+
+assert errors['robust_distrow,prune'] < errors['robust_grow_histmaker,prune'] + 1e-2, errors
+
+if xgb.rabit.get_rank() == 0:
+    xgb.rabit.tracker_print("Finished robust_distrow test\n")
+xgb.rabit.finalize()
@@ -38,3 +38,40 @@ class TestGPU(unittest.TestCase):
             param['tree_method'] = 'hist'
             cpu_results = run_suite(param, select_datasets=datasets)
             assert_gpu_results(cpu_results, gpu_results)
+
+    def test_gpu_hist_refresh_prediction_cache(self):
+        # the grower keeps leaf values of the tree before the refresh, so the
+        # cached margins of the CPU predictor must not be updated by it
+        rng = np.random.RandomState(1994)
+        X = rng.randn(1000, 8)
+        y = (X[:, 0] + X[:, 1] * X[:, 2] > 0.2).astype(float)
+        dtrain = xgb.DMatrix(X, label=y)
+        dfresh = xgb.DMatrix(X, label=y)
+        param = {'tree_method': 'gpu_hist', 'updater': 'grow_gpu_hist,refresh',
+                 'predictor': 'cpu_predictor', 'max_depth': 4, 'silent': 1,
+                 'objective': 'binary:logistic', 'eval_metric': 'logloss'}
+        bst = xgb.train(param, dtrain, 5)
+        cached = float(bst.eval(dtrain).split(':')[1])
+        fresh = float(bst.eval(dfresh).split(':')[1])
+        assert abs(cached - fresh) < 1e-5
+
+    def test_robust_gpu_hist(self):
+        variable_param = {'n_gpus': [1, -1], 'max_depth': [2, 6],
+                          'max_bin': [16, 256], 'robust_eps': [0.05, 0.3]}
+        for param in parameter_combinations(variable_param):
+            param['tree_method'] = 'robust_gpu_hist'
+            gpu_results = run_suite(param, select_datasets=datasets)
+            assert_results_non_increasing(gpu_results, 1e-2)
+            param['tree_method'] = 'robust_hist'
+            cpu_results = run_suite(param, select_datasets=datasets)
+            assert_gpu_results(cpu_results, gpu_results)
+
+    def test_robust_gpu_exact(self):
+        variable_param = {'max_depth': [2, 6], 'robust_eps': [0.05, 0.3]}
+        for param in parameter_combinations(variable_param):
+            param['tree_method'] = 'robust_gpu_exact'
+            gpu_results = run_suite(param, select_datasets=datasets)
+            assert_results_non_increasing(gpu_results, 1e-2)
+            param['tree_method'] = 'robust_exact'
+            cpu_results = run_suite(param, select_datasets=datasets)
+            assert_gpu_results(cpu_results, gpu_results)
@@ -101,6 +101,312 @@ class TestBasic(unittest.TestCase):
         # assert they are the same
         assert np.sum(np.abs(preds2 - preds)) == 0
 
+    def test_packed_model(self):
+        # a model saved in the packed layout is predicted without its trees,
+        # which are built to train it further
+        dtrain = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        dtest = xgb.DMatrix(dpath + 'agaricus.txt.test')
+        param = {'max_depth': 3, 'silent': 1, 'objective': 'multi:softprob', 'num_class': 2}
+        bst = xgb.train(param, dtrain, 4)
+        bst.set_param('packed_model', 1)
+        bst.save_model('packed.model')
+        packed = xgb.Booster(param, [dtrain], model_file='packed.model')
+        assert np.array_equal(packed.predict(dtest), bst.predict(dtest))
+        for i in range(4, 6):
+            bst.update(dtrain, i)
+            packed.update(dtrain, i)
+        assert packed.get_dump() == bst.get_dump()
+        assert np.array_equal(packed.predict(dtest), bst.predict(dtest))
+
+    def test_inplace_predict(self):
+        import scipy.sparse
+        X = rng.randn(100, 5)
+        X[X < -1] = 0
+        y = rng.randint(0, 3, size=100)
+        param = {'max_depth': 3, 'silent': 1, 'objective': 'multi:softprob', 'num_class': 3}
+        bst = xgb.train(param, xgb.DMatrix(X, label=y, missing=0.0), 4)
+        for output_margin in [False, True]:
+            expected = bst.predict(xgb.DMatrix(X, missing=0.0), output_margin=output_margin)
+            dense = bst.inplace_predict(X, output_margin=output_margin, missing=0.0)
+            csr = bst.inplace_predict(scipy.sparse.csr_matrix(X), output_margin=output_margin)
+            assert dense.shape == expected.shape
+            np.testing.assert_allclose(dense, expected, rtol=1e-6)
+            np.testing.assert_allclose(csr, expected, rtol=1e-6)
+        row = bst.inplace_predict(X[3], missing=0.0)
+        np.testing.assert_allclose(row[0], bst.predict(xgb.DMatrix(X, missing=0.0))[3], rtol=1e-6)
+        self.assertRaises(TypeError, bst.inplace_predict, [[0.0] * 5])
+
+    def test_predict_staged(self):
+        dtrain = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        dtest = xgb.DMatrix(dpath + 'agaricus.txt.test')
+        param = {'max_depth': 2, 'eta': 1, 'silent': 1, 'objective': 'binary:logistic'}
+        bst = xgb.train(param, dtrain, 7)
+        for output_margin in [False, True]:
+            staged = bst.predict_staged(dtest, 3, output_margin=output_margin)
+            # the last stage takes the 7th round too
+            assert staged.shape == (dtest.num_row(), 3)
+            for s, ntree_limit in enumerate([3, 6, 7]):
+                expected = bst.predict(dtest, output_margin=output_margin,
+                                       ntree_limit=ntree_limit)
+                np.testing.assert_allclose(staged[:, s], expected, rtol=1e-6)
+        assert bst.predict_staged(dtest, 2, ntree_limit=4).shape == (dtest.num_row(), 2)
+
+        X = rng.randn(100, 5)
+        y = rng.randint(0, 3, size=100)
+        param = {'max_depth': 3, 'silent': 1, 'objective': 'multi:softprob', 'num_class': 3}
+        dmat = xgb.DMatrix(X, label=y)
+        bst = xgb.train(param, dmat, 4)
+        staged = bst.predict_staged(dmat, 2)
+        assert staged.shape == (100, 2, 3)
+        np.testing.assert_allclose(staged[:, 0], bst.predict(dmat, ntree_limit=2), rtol=1e-6)
+        np.testing.assert_allclose(staged[:, 1], bst.predict(dmat), rtol=1e-6)
+
+    def test_predict_leaf_index(self):
+        dtrain = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        dtest = xgb.DMatrix(dpath + 'agaricus.txt.test')
+        param = {'max_depth': 3, 'eta': 1, 'silent': 1, 'objective': 'binary:logistic'}
+        bst = xgb.train(param, dtrain, 5)
+        leaf = bst.predict(dtest, pred_leaf=True)
+        index = bst.predict_leaf_index(dtest)
+        assert index.dtype == np.uint16
+        np.testing.assert_array_equal(index, leaf)
+        assert bst.predict_leaf_index(dtest, ntree_limit=2).shape == (dtest.num_row(), 2)
+        one_hot = bst.predict_leaf_index(dtest, one_hot=True)
+        assert one_hot.shape[0] == dtest.num_row()
+        np.testing.assert_array_equal(one_hot.sum(axis=1), 5)
+        # the columns of a tree follow those of the trees before it
+        assert (np.diff(one_hot.indices.reshape(-1, 5), axis=1) > 0).all()
+
+    def test_export_milp(self):
+        dtrain = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        dtest = xgb.DMatrix(dpath + 'agaricus.txt.test')
+        param = {'max_depth': 2, 'eta': 1, 'silent': 1, 'objective': 'binary:logistic'}
+        bst = xgb.train(param, dtrain, 4)
+        mps = bst.export_milp(dtest, 0)
+        assert mps.strip().endswith('ENDATA')
+        assert ' BV bnd p0' in mps
+        lp = bst.export_milp(dtest, 0, fmt='lp')
+        assert 'Binaries' in lp and lp.strip().endswith('End')
+        # a box this small crosses none of the thresholds of the binary features
+        boxed = bst.export_milp(dtest, 0, eps=1e-7)
+        assert len(boxed) < len(mps)
+        assert 'leaf_sum_' not in boxed
+
+    def test_compact(self):
+        dtrain = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        dtest = xgb.DMatrix(dpath + 'agaricus.txt.test')
+        param = {'max_depth': 2, 'eta': 0.1, 'silent': 1, 'objective': 'binary:logistic'}
+        bst = xgb.train(param, dtrain, 10)
+        margin = bst.predict(dtest, output_margin=True)
+        num_tree, num_node = bst.compact()
+        assert num_tree == 10
+        assert np.array_equal(bst.predict(dtest, output_margin=True), margin)
+        # the first rounds of a small eta split alike
+        folded, folded_node = bst.compact(fold='structure')
+        assert folded < num_tree and folded_node < num_node
+        np.testing.assert_allclose(bst.predict(dtest, output_margin=True), margin, atol=1e-5)
+
+    def test_feature_importance(self):
+        dtrain = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        param = {'max_depth': 3, 'eta': 1, 'silent': 1, 'objective': 'binary:logistic'}
+        bst = xgb.train(param, dtrain, 4)
+        importance = bst.feature_importance()
+        assert len(importance['weight']) >= dtrain.num_col()
+        # the sums agree with those parsed from the dump with stats
+        gain, count = {}, {}
+        for tree in bst.get_dump(with_stats=True):
+            for line in tree.split('\n'):
+                if '[' not in line:
+                    continue
+                fid = line.split('[')[1].split('<')[0]
+                stat = line.split('gain=')[1].split(',')[0]
+                gain[fid] = gain.get(fid, 0) + float(stat)
+                count[fid] = count.get(fid, 0) + 1
+        assert bst.get_score(importance_type='weight') == count
+        total_gain = bst.get_score(importance_type='total_gain')
+        assert sorted(total_gain) == sorted(gain)
+        for fid in gain:
+            assert abs(total_gain[fid] - gain[fid]) <= 1e-4 * max(1.0, abs(gain[fid]))
+
+    def test_dmatrix_from_iterator(self):
+        import scipy.sparse
+        X = rng.randn(250, 6)
+        X[X < -1] = np.nan
+        y = rng.randint(0, 2, size=250)
+        w = rng.uniform(0.5, 1.5, size=250)
+
+        def chunks():
+            for begin in range(0, 250, 64):
+                end = begin + 64
+                data = X[begin:end]
+                if begin % 128 != 0:
+                    data = scipy.sparse.csr_matrix(np.nan_to_num(data))
+                    data.data[data.data == 0] = np.nan
+                yield data, y[begin:end], w[begin:end]
+
+        dfull = xgb.DMatrix(X, label=y, weight=w)
+        dchunk = xgb.DMatrix(chunks())
+        assert dchunk.num_row() == 250
+        assert dchunk.num_col() == 6
+        np.testing.assert_array_equal(dchunk.get_label(), dfull.get_label())
+        np.testing.assert_allclose(dchunk.get_weight(), dfull.get_weight())
+
+        param = {'max_depth': 3, 'silent': 1, 'objective': 'binary:logistic'}
+        bst = xgb.train(param, dfull, 4)
+        np.testing.assert_allclose(bst.predict(dchunk), bst.predict(dfull), rtol=1e-6)
+
+        # either all or none of the chunks carry labels
+        mixed = iter([(X[:10], y[:10]), X[10:20]])
+        self.assertRaises(ValueError, xgb.DMatrix, mixed)
+
+    def test_dmatrix_append(self):
+        X = rng.randn(300, 5)
+        y = rng.randint(0, 2, size=300)
+        dappend = xgb.DMatrix(X[:200], label=y[:200])
+        dappend.append(X[200:], label=y[200:])
+        dfull = xgb.DMatrix(X, label=y)
+        assert dappend.num_row() == 300
+        np.testing.assert_array_equal(dappend.get_label(), dfull.get_label())
+        self.assertRaises(xgb.core.XGBoostError, dappend.append, X[:10])
+
+        for tree_method in ['exact', 'hist']:
+            param = {'max_depth': 3, 'silent': 1, 'objective': 'binary:logistic',
+                     'tree_method': tree_method}
+            bst_full = xgb.train(param, dfull, 4)
+            bst_append = xgb.train(param, dappend, 4)
+            np.testing.assert_allclose(bst_append.predict(dfull), bst_full.predict(dfull),
+                                       rtol=1e-6)
+
+            # a booster keeps training on the rows appended to its matrix
+            dtrain = xgb.DMatrix(X[:200], label=y[:200])
+            bst = xgb.Booster(param, [dtrain])
+            for i in range(2):
+                bst.update(dtrain, i)
+            dtrain.append(X[200:], label=y[200:])
+            for i in range(2, 4):
+                bst.update(dtrain, i)
+            np.testing.assert_allclose(bst.predict(dtrain), bst.predict(xgb.DMatrix(X)),
+                                       rtol=1e-6)
+
+    def test_native_train(self):
+        X = rng.randn(400, 8)
+        y = (X[:, 0] + 0.5 * rng.randn(400) > 0).astype(int)
+        dtrain = xgb.DMatrix(X[:300], label=y[:300])
+        dtest = xgb.DMatrix(X[300:], label=y[300:])
+        watchlist = [(dtrain, 'train'), (dtest, 'eval')]
+        param = {'max_depth': 3, 'eta': 0.3, 'silent': 1, 'objective': 'binary:logistic',
+                 'eval_metric': ['error', 'auc']}
+        results = {}, {}
+        bst_python = xgb.train(param, dtrain, 10, watchlist, evals_result=results[0],
+                               verbose_eval=False)
+        bst_native = xgb.train(param, dtrain, 10, watchlist, evals_result=results[1],
+                               verbose_eval=False, native=True)
+        np.testing.assert_allclose(bst_native.predict(dtest), bst_python.predict(dtest),
+                                   rtol=1e-6)
+        for name in ['train', 'eval']:
+            for metric in ['error', 'auc']:
+                np.testing.assert_allclose(results[1][name][metric], results[0][name][metric],
+                                           rtol=1e-5)
+
+        # early stopping on the auc of eval, which is maximized
+        bst_python = xgb.train(param, dtrain, 100, watchlist, early_stopping_rounds=3,
+                               verbose_eval=False)
+        bst_native = xgb.train(param, dtrain, 100, watchlist, early_stopping_rounds=3,
+                               verbose_eval=False, native=True)
+        assert bst_native.best_iteration == bst_python.best_iteration
+        assert abs(bst_native.best_score - bst_python.best_score) < 1e-5
+        assert len(bst_native.get_dump()) == len(bst_python.get_dump())
+
+        # a callback stops the training
+        bst = xgb.Booster(param, [dtrain, dtest])
+        rounds = []
+
+        def stop_at_five(iteration, result):
+            rounds.append(iteration)
+            assert [name for name, _ in result] == ['train-error', 'train-auc',
+                                                    'eval-error', 'eval-auc']
+            return iteration == 4
+        assert bst.train_native(dtrain, 10, watchlist, callback=stop_at_five) == 5
+        assert rounds == list(range(5))
+        assert len(bst.get_dump()) == 5
+
+        self.assertRaises(ValueError, xgb.train, param, dtrain, 2, native=True,
+                          obj=lambda preds, d: (preds, preds))
+
+    def test_memory_usage(self):
+        X = rng.randn(500, 10)
+        y = rng.randint(0, 2, size=500)
+        dtrain = xgb.DMatrix(X, label=y)
+        usage = xgb.core.memory_usage()
+        # the rows of dtrain and their offsets
+        assert usage['sparse_page']['current'] >= X.size * 8
+        bst = xgb.train({'tree_method': 'hist', 'silent': 1}, dtrain, 2)
+        usage = xgb.core.memory_usage(reset_peak=True)
+        for kind in ['gradient_index', 'histogram', 'host_device_vector']:
+            assert usage[kind]['peak'] > 0
+            assert usage[kind]['peak'] >= usage[kind]['current']
+        assert usage['total']['current'] == sum(
+            usage[kind]['current'] for kind in usage if kind not in ['total', 'rss'])
+        usage = xgb.core.memory_usage()
+        assert usage['total']['peak'] == usage['total']['current']
+        del bst, dtrain
+
+    def test_thread_limit(self):
+        X = rng.randn(200, 5)
+        dtrain = xgb.DMatrix(X, label=X[:, 0] > 0)
+        param = {'max_depth': 2, 'silent': 1, 'nthread': 4}
+        bst = xgb.train(param, dtrain, 3)
+        pred = bst.predict(dtrain)
+        # the threads change the schedule of the sums only
+        xgb.core.set_thread_limit(1)
+        try:
+            np.testing.assert_allclose(bst.predict(dtrain), pred, rtol=1e-6)
+            limited = xgb.train(param, dtrain, 3)
+            np.testing.assert_allclose(limited.predict(dtrain), pred, rtol=1e-5)
+        finally:
+            xgb.core.set_thread_limit(0)
+        self.assertRaises(xgb.core.XGBoostError, xgb.core.set_thread_limit, -1)
+
+    def test_thread_backend(self):
+        X = rng.randn(200, 5)
+        dtrain = xgb.DMatrix(X, label=X[:, 0] > 0)
+        param = {'max_depth': 2, 'silent': 1, 'nthread': 4,
+                 'objective': 'binary:logistic', 'eval_metric': 'logloss'}
+        result = {}
+        bst = xgb.train(param, dtrain, 3, [(dtrain, 'train')], evals_result=result)
+        pred = bst.predict(dtrain)
+        # the loops of the pool take the same rows, in another schedule
+        xgb.core.set_thread_backend('pool')
+        try:
+            np.testing.assert_allclose(bst.predict(dtrain), pred, rtol=1e-6)
+            pooled = {}
+            other = xgb.train(param, dtrain, 3, [(dtrain, 'train')], evals_result=pooled)
+            np.testing.assert_allclose(other.predict(dtrain), pred, rtol=1e-5)
+            np.testing.assert_allclose(pooled['train']['logloss'],
+                                       result['train']['logloss'], rtol=1e-5)
+        finally:
+            xgb.core.set_thread_backend('omp')
+        self.assertRaises(xgb.core.XGBoostError, xgb.core.set_thread_backend, 'tbb')
+        # there is no executor of the host
+        self.assertRaises(xgb.core.XGBoostError, xgb.core.set_thread_backend, 'executor')
+
+    def test_eval_parallel(self):
+        dtrain = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        dtest = xgb.DMatrix(dpath + 'agaricus.txt.test')
+        param = [('max_depth', 2), ('silent', 1), ('objective', 'binary:logistic'),
+                 ('eval_metric', 'error'), ('eval_metric', 'auc'),
+                 ('eval_metric', 'logloss')]
+        watchlist = [(dtest, 'eval'), (dtrain, 'train')]
+        results = [{}, {}]
+        xgb.train(param, dtrain, 3, watchlist, evals_result=results[0])
+        xgb.train(param + [('eval_parallel', 1)], dtrain, 3, watchlist,
+                  evals_result=results[1])
+        # the sets share the threads, which only change the schedule of the sums
+        for name in ['eval', 'train']:
+            for metric in ['error', 'auc', 'logloss']:
+                np.testing.assert_allclose(results[1][name][metric],
+                                           results[0][name][metric], rtol=1e-5)
+
     def test_dmatrix_init(self):
         data = np.random.randn(5, 5)
 
@@ -300,6 +606,21 @@ class TestBasic(unittest.TestCase):
             output = out.getvalue().strip()
         assert output == '[array([5., 8.], dtype=float32), array([23., 43., 11.], dtype=float32)]'
 
+    def test_merge_duplicate_rows(self):
+        X = rng.randint(0, 3, size=(400, 4)).astype(np.float32)
+        y = (X[:, 0] + rng.randint(0, 2, size=400) > 2).astype(np.float32)
+        dtrain = xgb.DMatrix(X, label=y)
+        dmerged = dtrain.merge_duplicate_rows()
+        assert dmerged.num_row() < dtrain.num_row()
+        assert dmerged.get_weight().sum() == dtrain.num_row()
+
+        param = {'tree_method': 'exact', 'max_depth': 3, 'silent': 1,
+                 'objective': 'binary:logistic'}
+        bst = xgb.train(param, dtrain, num_boost_round=5)
+        bst_merged = xgb.train(param, dmerged, num_boost_round=5)
+        np.testing.assert_allclose(bst.predict(dtrain), bst_merged.predict(dtrain),
+                                   rtol=1e-5)
+
     def test_get_info(self):
         dtrain = xgb.DMatrix(dpath + 'agaricus.txt.train')
         dtrain.get_float_info('label')
@@ -1,3 +1,6 @@
+import glob
+import numpy as np
+import os
 import testing as tm
 import unittest
 import xgboost as xgb
@@ -8,6 +11,78 @@ try:
 except ImportError:
     None
 
+# the parameters of the robust exact trees compared by assert_same_trees
+ROBUST_PARAM = {'max_depth': 6,
+                'tree_method': 'robust_exact',
+                'robust_eps': 0.15,
+                'silent': 1,
+                'objective': 'binary:logistic'}
+
+
+def robust_data(nrow=1000, ncol=8, seed=1994):
+    # continuous features on a grid of spacing 0.1, with ties and missing
+    # values, so that the robust_eps windows of ROBUST_PARAM hold a few values
+    rng = np.random.RandomState(seed)
+    X = np.round(rng.randn(nrow, ncol) * 10) / 10
+    y = (X[:, 0] + X[:, 1] * X[:, 2] > 0.2).astype(float)
+    X[rng.rand(nrow, ncol) < 0.1] = np.nan
+    return X, y
+
+
+def robust_dmatrix():
+    X, y = robust_data()
+    return xgb.DMatrix(X, label=y)
+
+
+def assert_same_trees(dtrain, variants, param=None, num_round=5):
+    """Train ROBUST_PARAM updated with param, and again with each of the
+    variant parameters on top, which must grow the same trees. Returns the
+    dump of the trees."""
+    base = dict(ROBUST_PARAM, **(param or {}))
+    expected = xgb.train(base, dtrain, num_round).get_dump()
+    # the trees split on the features, not only the leaves of the root
+    assert any('<' in tree for tree in expected)
+    for variant in variants:
+        dump = xgb.train(dict(base, **variant), dtrain, num_round).get_dump()
+        assert dump == expected, variant
+    return expected
+
+
+def fragile_dmatrix(nrow=1000, seed=1994):
+    # f0 separates the labels by a margin far below the robust_eps of
+    # FRAGILE_PARAM, f1 by a margin far above it but with 10% label noise
+    rng = np.random.RandomState(seed)
+    y = (rng.rand(nrow) < 0.5).astype(float)
+    sign = np.where(y > 0, 1.0, -1.0)
+    flip = np.where(rng.rand(nrow) < 0.1, -1.0, 1.0)
+    X = np.column_stack([0.05 * sign, sign * flip])
+    return xgb.DMatrix(X, label=y)
+
+
+# one split, the robust gain of f0 vanishes as all its rows are in the eps ball
+FRAGILE_PARAM = {'max_depth': 1,
+                 'robust_eps': 0.3,
+                 'silent': 1,
+                 'objective': 'binary:logistic'}
+
+
+def root_feature(dtrain, param):
+    dump = xgb.train(dict(FRAGILE_PARAM, **param), dtrain, 1).get_dump()
+    return dump[0].split('<')[0]
+
+
+def assert_fits_like_robust_exact(param):
+    """The training error of ROBUST_PARAM updated with param must be close
+    to that of robust_exact on the continuous data."""
+    dtrain = robust_dmatrix()
+    labels = dtrain.get_label()
+    err = []
+    for variant in [{}, param]:
+        bst = xgb.train(dict(ROBUST_PARAM, **variant), dtrain, 5)
+        err.append(np.mean((bst.predict(dtrain) > 0.5) != labels))
+    assert err[1] < 0.25, param
+    assert abs(err[1] - err[0]) < 0.05, param
+
 
 class TestUpdaters(unittest.TestCase):
     def test_histmaker(self):
@@ -53,3 +128,272 @@ class TestUpdaters(unittest.TestCase):
                   evals_result=exact_res)
         assert hist_res['train']['auc'] == exact_res['train']['auc']
         assert hist_res['test']['auc'] == exact_res['test']['auc']
+
+    def test_robust_exact_prediction_cache(self):
+        # the training margins updated from the leaf positions must match a
+        # full prediction on a matrix that is not cached
+        X, y = robust_data()
+        dtrain = xgb.DMatrix(X, label=y)
+        dfresh = xgb.DMatrix(X, label=y)
+        for policy in ['depthwise', 'lossguide']:
+            param = dict(ROBUST_PARAM, grow_policy=policy, eval_metric='logloss')
+            bst = xgb.train(param, dtrain, 10)
+            cached = float(bst.eval(dtrain).split(':')[1])
+            fresh = float(bst.eval(dfresh).split(':')[1])
+            assert abs(cached - fresh) < 1e-5
+
+    def test_prediction_cache_updater_sequence(self):
+        # only a trailing pruner lets the grower before it update the cached
+        # margins, after a refresh they are predicted again
+        X, y = robust_data()
+        dtrain = xgb.DMatrix(X, label=y)
+        dfresh = xgb.DMatrix(X, label=y)
+        base = {'max_depth': 4, 'silent': 1, 'objective': 'binary:logistic',
+                'eval_metric': 'logloss', 'predictor': 'cpu_predictor'}
+        for param in [{'updater': 'grow_fast_histmaker,refresh'},
+                      {'updater': 'grow_fast_histmaker,prune', 'gamma': 1.0},
+                      {'updater': 'robust_grow_colmaker,refresh', 'robust_eps': 0.15},
+                      {'updater': 'robust_grow_colmaker,prune', 'robust_eps': 0.15,
+                       'gamma': 1.0}]:
+            bst = xgb.train(dict(base, **param), dtrain, 5)
+            cached = float(bst.eval(dtrain).split(':')[1])
+            fresh = float(bst.eval(dfresh).split(':')[1])
+            assert abs(cached - fresh) < 1e-5, param
+
+    def test_colmaker_thread_count_change(self):
+        # the builders are kept across rounds with buffers of one slot a
+        # thread, they must follow a raised thread limit, which does not
+        # configure the updaters again
+        dpath = 'demo/data/'
+        dtrain = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        dfresh = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        for method in ['exact', 'robust_exact']:
+            param = {'max_depth': 4,
+                     'tree_method': method,
+                     'robust_eps': 0.3,
+                     'nthread': 8,
+                     'silent': 1,
+                     'objective': 'binary:logistic',
+                     'eval_metric': 'logloss'}
+            bst = xgb.Booster(param, [dtrain])
+            xgb.core.set_thread_limit(2)
+            try:
+                for i in range(6):
+                    if i == 3:
+                        xgb.core.set_thread_limit(0)
+                    bst.update(dtrain, i)
+            finally:
+                xgb.core.set_thread_limit(0)
+            assert len(bst.get_dump()) == 6
+            cached = float(bst.eval(dtrain).split(':')[1])
+            fresh = float(bst.eval(dfresh).split(':')[1])
+            assert abs(cached - fresh) < 1e-5
+            assert cached < 0.1
+
+    def test_robust_exact_compact_columns(self):
+        # the compacted columns hold the same entries of the active rows
+        assert_same_trees(robust_dmatrix(), [{'robust_compact_ratio': 0.5}])
+
+    def test_robust_exact_eps_windows(self):
+        # the precomputed boundaries split the scanned values as the
+        # comparisons do, also when the compacted columns fall back to them
+        assert_same_trees(robust_dmatrix(),
+                          [{'robust_eps_windows': 1},
+                           {'robust_eps_windows': 1, 'robust_compact_ratio': 0.5}])
+
+    def test_robust_exact_skip_exhausted(self):
+        # a feature exhausted at the parent has no robust split of any gain
+        # in the children
+        dtrain = robust_dmatrix()
+        assert_same_trees(dtrain, [{'robust_skip_exhausted': 1}])
+        assert_same_trees(dtrain, [{'robust_skip_exhausted': 1}],
+                          {'grow_policy': 'lossguide', 'max_leaves': 16})
+
+    def test_robust_exact_cache_opt(self):
+        # the blocked scan gathers the same entries in the same order
+        assert_same_trees(robust_dmatrix(), [{'cache_opt': 0}])
+
+    def test_robust_exact_tuned_parallel_option(self):
+        # each bucket tries both strategies, which find the same candidates
+        dtrain = robust_dmatrix()
+        default = xgb.train(ROBUST_PARAM, dtrain, 5)
+        tuned = xgb.train(dict(ROBUST_PARAM, parallel_option=3), dtrain, 5)
+        assert len(tuned.get_dump()) == 5
+        assert np.allclose(tuned.predict(dtrain), default.predict(dtrain), atol=1e-3)
+
+    def test_robust_exact_numa_mode(self):
+        # the features are only assigned to the threads differently
+        assert_same_trees(robust_dmatrix(), [{'numa_mode': 1}])
+
+    def test_robust_exact_fused_prune(self):
+        # robust_exact prunes in the grow step, the trees and the cached
+        # training margins must be those of the separate prune updater
+        X, y = robust_data()
+        dtrain = xgb.DMatrix(X, label=y)
+        dfresh = xgb.DMatrix(X, label=y)
+        param = {'gamma': 1.0, 'eval_metric': 'logloss'}
+        assert_same_trees(dtrain, [{'updater': 'robust_grow_colmaker,prune'}], param)
+        fused = xgb.train(dict(ROBUST_PARAM, **param), dtrain, 5)
+        cached = float(fused.eval(dtrain).split(':')[1])
+        fresh = float(fused.eval(dfresh).split(':')[1])
+        assert abs(cached - fresh) < 1e-5
+
+    def test_robust_exact_single_pass(self):
+        # the single pass evaluates the splits of the forward scan and those
+        # sending the missing values left, so it fits sparse data as well
+        rng = np.random.RandomState(1994)
+        X = rng.randn(2000, 10)
+        y = (X[:, 0] + X[:, 1] > 0).astype(float)
+        X[rng.rand(2000, 10) < 0.5] = np.nan
+        dtrain = xgb.DMatrix(X, label=y)
+        param = {'max_depth': 4,
+                 'tree_method': 'robust_exact',
+                 'robust_eps': 0.1,
+                 'silent': 1,
+                 'objective': 'binary:logistic',
+                 'eval_metric': 'logloss'}
+        res = {}
+        for single_pass in [0, 1]:
+            param['robust_single_pass'] = single_pass
+            bst = xgb.train(param, dtrain, 10)
+            res[single_pass] = float(bst.eval(dtrain).split(':')[1])
+        assert res[1] <= res[0] + 1e-2
+
+    def test_robust_exact_external_memory(self):
+        # the pieces of each column in the pages are merged before the robust
+        # enumeration, so the trees must be the same as in memory
+        X, y = robust_data()
+        with open('robust.libsvm', 'w') as fo:
+            for row, label in zip(X, y):
+                fo.write('%d %s\n' % (label, ' '.join(
+                    '%d:%g' % (i, v) for i, v in enumerate(row) if not np.isnan(v))))
+        dtrain = xgb.DMatrix('robust.libsvm')
+        dext = xgb.DMatrix('robust.libsvm#tmprobust_')
+        in_memory = assert_same_trees(dtrain, [], {'max_depth': 4})
+        external = xgb.train(dict(ROBUST_PARAM, max_depth=4), dext, 5).get_dump()
+        del dext
+        for f in glob.glob('tmprobust_*') + ['robust.libsvm']:
+            os.remove(f)
+        assert in_memory == external
+
+    def test_robust_exact_debug_verbose(self):
+        # the per tree summary counts the events through a trace sink, the
+        # enumeration and so the trees must not change
+        dtrain = robust_dmatrix()
+        for policy in ['depthwise', 'lossguide']:
+            assert_same_trees(dtrain, [{'debug_verbose': 1}],
+                              {'max_depth': 4, 'grow_policy': policy}, num_round=3)
+
+    def test_robust_hist(self):
+        # the robust split of the histograms leaves the fragile feature
+        dfragile = fragile_dmatrix()
+        assert root_feature(dfragile, {'tree_method': 'exact'}) == '0:[f0'
+        assert root_feature(dfragile, {'tree_method': 'robust_exact'}) == '0:[f1'
+        assert root_feature(dfragile, {'tree_method': 'robust_hist'}) == '0:[f1'
+        # and fits about as well as robust_exact on continuous data
+        assert_fits_like_robust_exact({'tree_method': 'robust_hist'})
+
+    def test_robust_approx(self):
+        dfragile = fragile_dmatrix()
+        assert root_feature(dfragile, {'tree_method': 'robust_approx'}) == '0:[f1'
+        assert_fits_like_robust_exact({'tree_method': 'robust_approx'})
+
+    def test_robust_exact_value_runs(self):
+        # the columns of the grid data have fewer than 256 values, and the
+        # windows move a value run at a time over the same candidates
+        assert_same_trees(robust_dmatrix(), [{'robust_value_runs': 1}])
+        assert root_feature(fragile_dmatrix(), {'tree_method': 'robust_exact',
+                                                'robust_value_runs': 1}) == '0:[f1'
+
+    def test_robust_exact_lossguide(self):
+        dfragile = fragile_dmatrix()
+        assert root_feature(dfragile, {'tree_method': 'robust_exact',
+                                       'grow_policy': 'lossguide',
+                                       'max_leaves': 2}) == '0:[f1'
+        # bounded by the depth only, best first grows the nodes of depthwise
+        dtrain = robust_dmatrix()
+        param = dict(ROBUST_PARAM, max_depth=4)
+        depthwise = xgb.train(param, dtrain, 5)
+        lossguide = xgb.train(dict(param, grow_policy='lossguide'), dtrain, 5)
+        assert np.allclose(lossguide.predict(dtrain), depthwise.predict(dtrain), atol=1e-5)
+        # and max_leaves stops it
+        param = dict(ROBUST_PARAM, max_depth=0, grow_policy='lossguide', max_leaves=5)
+        dump = xgb.train(param, dtrain, 5).get_dump()
+        assert all(tree.count('leaf=') <= 5 for tree in dump)
+        assert any(tree.count('leaf=') == 5 for tree in dump)
+
+    def test_goss(self):
+        # keeping all the top rows is no sampling, and the training margins
+        # must stay those of a full prediction with the rows left out
+        dpath = 'demo/data/'
+        dtrain = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        dfresh = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        for method in ['exact', 'hist', 'robust_exact']:
+            param = {'max_depth': 4,
+                     'tree_method': method,
+                     'silent': 1,
+                     'objective': 'binary:logistic',
+                     'eval_metric': 'logloss'}
+            full = xgb.train(param, dtrain, 3).get_dump()
+            param['goss_top_rate'] = 1.0
+            assert xgb.train(param, dtrain, 3).get_dump() == full
+            param['goss_top_rate'] = 0.2
+            param['goss_other_rate'] = 0.1
+            param['robust_compact_ratio'] = 0.5
+            bst = xgb.train(param, dtrain, 5)
+            cached = float(bst.eval(dtrain).split(':')[1])
+            fresh = float(bst.eval(dfresh).split(':')[1])
+            assert abs(cached - fresh) < 1e-5
+
+    def test_multi_output_tree(self):
+        # one tree of vector leaves a round, served by the prediction cache
+        # and kept by the saved model
+        rng = np.random.RandomState(3)
+        X = rng.randn(300, 5)
+        y = np.argmax(X[:, :3], axis=1)
+        dtrain = xgb.DMatrix(X, label=y)
+        dfresh = xgb.DMatrix(X, label=y)
+        for method in ['exact', 'robust_exact']:
+            param = {'max_depth': 3,
+                     'tree_method': method,
+                     'silent': 1,
+                     'objective': 'multi:softprob',
+                     'num_class': 3,
+                     'eval_metric': 'mlogloss',
+                     'multi_output_tree': 1}
+            bst = xgb.train(param, dtrain, 4)
+            assert len(bst.get_dump()) == 4
+            cached = float(bst.eval(dtrain).split(':')[1])
+            fresh = float(bst.eval(dfresh).split(':')[1])
+            assert abs(cached - fresh) < 1e-5
+            preds = bst.predict(dfresh)
+            assert preds.shape == (300, 3)
+            assert np.mean(np.argmax(preds, axis=1) == y) > 0.8
+            bst.save_model('multi_output.model')
+            loaded = xgb.Booster(model_file='multi_output.model')
+            os.remove('multi_output.model')
+            assert np.allclose(loaded.predict(dfresh), preds)
+            assert np.allclose(bst.predict(dfresh, ntree_limit=2),
+                               loaded.predict(dfresh, ntree_limit=2))
+
+    def test_parallel_forest(self):
+        # the trees of a round are grown at once on their own bootstrap samples
+        dpath = 'demo/data/'
+        dtrain = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        dfresh = xgb.DMatrix(dpath + 'agaricus.txt.train')
+        for method in ['exact', 'robust_exact']:
+            param = {'max_depth': 4,
+                     'tree_method': method,
+                     'silent': 1,
+                     'objective': 'binary:logistic',
+                     'eval_metric': 'logloss',
+                     'num_parallel_tree': 4,
+                     'parallel_forest': 1}
+            bst = xgb.train(param, dtrain, 2)
+            dump = bst.get_dump()
+            assert len(dump) == 8
+            assert len(set(dump[:4])) > 1
+            cached = float(bst.eval(dtrain).split(':')[1])
+            fresh = float(bst.eval(dfresh).split(':')[1])
+            assert abs(cached - fresh) < 1e-5
+            assert cached < 0.3
@@ -357,6 +357,27 @@ def test_sklearn_n_jobs():
     assert clf.get_xgb_params()['nthread'] == 2
 
 
+def test_sklearn_chunked_predict():
+    tm._skip_if_no_sklearn()
+    import scipy.sparse
+    X = rng.randn(1000, 6)
+    y = (X[:, 0] + X[:, 1] > 0).astype(int)
+    clf = xgb.XGBClassifier(n_estimators=5).fit(X, y)
+    for data in [X, scipy.sparse.csr_matrix(X)]:
+        # the last window is shorter than the others
+        for chunk_size in [7, 96, 1000, 4096]:
+            np.testing.assert_allclose(clf.predict_proba(data, chunk_size=chunk_size),
+                                       clf.predict_proba(data), rtol=1e-6)
+        np.testing.assert_array_equal(clf.predict(data, chunk_size=300), clf.predict(data))
+        np.testing.assert_array_equal(clf.apply(data, chunk_size=300), clf.apply(data))
+
+    bst = clf.get_booster()
+    expected = bst.predict(xgb.DMatrix(X), output_margin=True)
+    for overlap in [False, True]:
+        preds = bst.predict_chunked(X, chunk_size=128, output_margin=True, overlap=overlap)
+        np.testing.assert_allclose(preds, expected, rtol=1e-6)
+
+
 def test_kwargs():
     tm._skip_if_no_sklearn()
 
@@ -22,6 +22,22 @@ def sigmoid(x):
 
 
 
+def load_trees(booster):
+	# build the json dump structure from the flat node arrays of the booster, without a temporary dump file
+	arrays = booster.export_trees()
+	tree_ptr = arrays['tree_ptr']
+	def build(begin, nid):
+		i = begin + nid
+		if arrays['split_index'][i] < 0:
+			return {'nodeid': nid, 'leaf': float(arrays['leaf_value'][i])}
+		yes, no = int(arrays['left_child'][i]), int(arrays['right_child'][i])
+		return {'nodeid': nid, 'split': int(arrays['split_index'][i]), 'split_condition': float(arrays['split_cond'][i]),
+				'yes': yes, 'no': no, 'missing': yes if arrays['default_left'][i] else no,
+				'children': [build(begin, yes), build(begin, no)]}
+	return [build(int(tree_ptr[t]), 0) for t in range(len(tree_ptr) - 1)]
+
+
+
 class xgboost_wrapper():
 	def __init__(self, model, binary=False):
 		self.model = model 
@@ -41,11 +57,9 @@ class xgboost_wrapper():
 
 	def predict(self, input_data):
 		input_data, _ = self.maybe_flat(input_data)
-		ori_input = np.copy(input_data)
 		np.clip(input_data, 0, 1, input_data)
-		input_data = xgb.DMatrix(sparse.csr_matrix(input_data)) 
-		ori_input = xgb.DMatrix(sparse.csr_matrix(ori_input))
-		test_predict = np.array(self.model.predict(input_data))
+		# zeros are missing, as in a DMatrix built from sparse.csr_matrix(input_data)
+		test_predict = np.array(self.model.inplace_predict(input_data, missing=0.0))
 		if self.binary:
 			test_predict = (test_predict > 0.5).astype(int)
 		else:
@@ -54,10 +68,7 @@ class xgboost_wrapper():
 
 	def predict_logits(self, input_data):
 		input_data, _ = self.maybe_flat(input_data) 
-		input_back = np.copy(input_data)
-		input_data = sparse.csr_matrix(input_data) 
-		input_data = xgb.DMatrix(input_data) 
-		test_predict = np.array(self.model.predict(input_data))
+		test_predict = np.array(self.model.inplace_predict(input_data, missing=0.0))
 		return test_predict
 
 	def predict_label(self, input_data):
@@ -118,15 +129,7 @@ class xgbKantchelianAttack(object):
 		# here model is a mnist_xgboost_wrapper model
 		self.model = model
 		if self.binary :
-			temp = 'temporary{}.json'.format(str(round(time.time() * 1000))[-4:])
-			print('temp file:', temp)
-			model.model.dump_model(temp,dump_format='json')
-			with open(temp) as f:
-				self.json_file = json.load(f)
-			if type(self.json_file) is not list:
-				raise ValueError('model input should be a list of dict loaded by json')
-			else:
-				os.remove(temp)
+			self.json_file = load_trees(model.model)
 			print('number of trees:',len(self.json_file))
 		else:
 			self.pos_json_file = pos_json_input
@@ -414,15 +417,7 @@ class xgbMultiClassKantchelianAttack(object):
 		self.guard_val = guard_val
 		self.round_digits = round_digits
 		self.LP = LP
-		temp = 'temporary{}.json'.format(str(round(time.time() * 1000))[-4:])
-		print('temp file: ', temp)
-		model.model.dump_model(temp,dump_format='json')
-		with open(temp) as f:
-			self.json_file = json.load(f)
-		if type(self.json_file) is not list:
-			raise ValueError('model input should be a list of dict loaded by json')
-		else:
-			os.remove(temp)
+		self.json_file = load_trees(model.model)
 		print('number of trees:',len(self.json_file))
 		self.json_inputs = [[] for l in range(self.num_classes)]
 		for i,tree in enumerate(self.json_file):